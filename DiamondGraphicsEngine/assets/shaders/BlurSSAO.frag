@@ -11,6 +11,8 @@ uniform sampler2D Depth_Texture;
 uniform sampler2D SSAO_Texture;
 uniform bool HorizontalBlur;
 
+#include "GBufferPacking.glsl"
+
 float GenSSAOFactor(in vec3 pixelNormal, in float pixelDepth,
                     in vec2 uvPos, in vec2 pixelFrac)
 {
@@ -35,7 +37,7 @@ float GenSSAOFactor(in vec3 pixelNormal, in float pixelDepth,
         totalWeight += 1;
         continue;
       }
-      vec3 thisNormal = texture(WorldNormal_ReceiveLight_Texture, vec2(x, y)).xyz*2-1;
+      vec3 thisNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, vec2(x, y));
       float thisDepth = texture(Depth_Texture, vec2(x, y)).r;
       float weight = i*max(dot(thisNormal, pixelNormal),0)+ exp(-pow(thisDepth - pixelDepth, 2)/(2*variance))/ sqrt(2*PI*variance);
       SSAOWeights[i] = weight;
@@ -50,7 +52,7 @@ float GenSSAOFactor(in vec3 pixelNormal, in float pixelDepth,
         totalWeight += 1;
         continue;
       }
-      vec3 thisNormal = texture(WorldNormal_ReceiveLight_Texture, vec2(x, y)).xyz*2-1;
+      vec3 thisNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, vec2(x, y));
       float thisDepth = texture(Depth_Texture, vec2(x, y)).r;
       float weight = i*max(dot(thisNormal, pixelNormal),0)+ exp(-pow(thisDepth - pixelDepth, 2)/(2*variance))/ sqrt(2*PI*variance);
       SSAOWeights[width2-i] = weight;
@@ -68,7 +70,7 @@ float GenSSAOFactor(in vec3 pixelNormal, in float pixelDepth,
         totalWeight += 1;
         continue;
       }
-      vec3 thisNormal = texture(WorldNormal_ReceiveLight_Texture, vec2(x, y)).xyz*2-1;
+      vec3 thisNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, vec2(x, y));
       float thisDepth = texture(Depth_Texture, vec2(x, y)).r;
       float weight = i*max(dot(thisNormal, pixelNormal),0)+ exp(-pow(thisDepth - pixelDepth, 2)/(2*variance))/ sqrt(2*PI*variance);
       SSAOWeights[i] = weight;
@@ -83,7 +85,7 @@ float GenSSAOFactor(in vec3 pixelNormal, in float pixelDepth,
         totalWeight += 1;
         continue;
       }
-      vec3 thisNormal = texture(WorldNormal_ReceiveLight_Texture, vec2(x, y)).xyz*2-1;
+      vec3 thisNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, vec2(x, y));
       float thisDepth = texture(Depth_Texture, vec2(x, y)).r;
       float weight = i*max(dot(thisNormal, pixelNormal),0)+ exp(-pow(thisDepth - pixelDepth, 2)/(2*variance))/ sqrt(2*PI*variance);
       SSAOWeights[width2-i] = weight;
@@ -128,7 +130,7 @@ void main()
   vec2 pixelFrac = vec2(1.0f/ScreenDimension.x,1.0f/ScreenDimension.y );
   vec2 uvPos = vec2(gl_FragCoord.xy * pixelFrac);
   
-  vec3 pixelNormal = texture(WorldNormal_ReceiveLight_Texture, uvPos).xyz*2-1;
+  vec3 pixelNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, uvPos);
   float pixelDepth = texture(Depth_Texture, uvPos).r;
   
   gl_FragDepth = GenSSAOFactor(pixelNormal, pixelDepth, uvPos, pixelFrac); ;
@@ -37,6 +37,9 @@ uniform mat4 LightViewProj;
 uniform float LightNearPlane;
 uniform float LightFarPlane;
 uniform float LightShadowExp;
+
+#include "GBufferPacking.glsl"
+
 struct Light
 {
   bool isActive;
@@ -129,7 +132,7 @@ vec4 DoSpotLight(in Light light, in vec4 worldNormal, in vec4 worldPos,in vec2 u
   vec3 reflectVec = reflect(-lightVec.xyz, worldNormal.xyz);
   
   vec4 specFactor=texture(SpecColor_Empty_Texture, uv);
-  float specPow=texture(WorldPosition_SpecPow_Texture, uv).w;
+  float specPow=GBufferSpecularPower(WorldPosition_SpecPow_Texture, SpecColor_Empty_Texture, uv);
   
   vec4 specular = light.specular
                 * vec4(specFactor.xyz, 1)
@@ -177,7 +180,7 @@ vec4 DoDirectionalLight(in Light light, in vec4 worldNormal, in vec4 worldPos,in
   
   vec4 specFactor=texture(SpecColor_Empty_Texture, uv);
 
-  float specPow=texture(WorldPosition_SpecPow_Texture, uv).w;
+  float specPow=GBufferSpecularPower(WorldPosition_SpecPow_Texture, SpecColor_Empty_Texture, uv);
   
   vec4 specular = light.specular
                 * vec4(specFactor.xyz, 1)
@@ -297,10 +300,9 @@ void main()
 {
   vec2 pixelFrac = vec2(1.0f/ScreenDimension.x,1.0f/ScreenDimension.y );
   vec2 uvPos = vec2(gl_FragCoord.xy * pixelFrac);
-  vec3 pixelPos = texture(WorldPosition_SpecPow_Texture, uvPos).xyz;
+  vec3 pixelPos = GBufferWorldPosition(WorldPosition_SpecPow_Texture, Depth_Texture, uvPos);
   vec4 worldPos = vec4(pixelPos,1);
-  vec4 normalTextureData = texture(WorldNormal_ReceiveLight_Texture, uvPos);
-  vec3 pixelNormal = normalTextureData.xyz*2-1;
+  vec3 pixelNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, uvPos);
   // if (pixelNormal == vec3(0,0,0))
     // discard;
   vec4 worldNormal = vec4(pixelNormal, 0);
@@ -316,7 +318,7 @@ void main()
     //////////////////////////////////////////////////////////////////////////////////////////////////
     
     vec3 outputColor;     
-    if (normalTextureData.w > 0.5)
+    if (GBufferReceiveLight(DiffuseColor_Empty_Texture, WorldNormal_ReceiveLight_Texture, uvPos))
     {
       vec3 lightColor = computeSurfaceColor(worldNormal, worldPos,uvPos).xyz;
       outputColor = pixelMatColor*lightColor;
@@ -337,7 +339,7 @@ void main()
   }
   else if (DebugOutputIndex == DEBUG_OUTPUT_WORLD_NORMAL)
   {
-    vFragColor.xyz = texture(WorldNormal_ReceiveLight_Texture, uvPos).xyz;
+    vFragColor.xyz = pixelNormal*0.5f+0.5f;
   }
   else if (DebugOutputIndex == DEBUG_OUTPUT_SPECULAR_COLOR)
   {
@@ -0,0 +1,79 @@
+// G-buffer encode/decode shared by every deferred stage.
+// Mirrors inc/graphics/GBufferPacking.h, keep the two in sync.
+//
+// Compact layout (CompactGBuffer != 0):
+//   attachment 0 RGBA8 : diffuse.rgb, receive light flag
+//   attachment 1 none  : world position is rebuilt from depth
+//   attachment 2 RG16  : octahedral normal
+//   attachment 3 RGBA8 : specular.rgb, encoded spec power
+// Regular layout keeps position.xyz/spec power in attachment 1 and
+// normal*0.5+0.5/receive light in attachment 2.
+
+#define GBUFFER_SPEC_POW_LOG2_MAX 11.0
+
+uniform bool CompactGBuffer;
+uniform mat4 InverseViewProj;
+
+vec2 EncodeOctahedral(in vec3 normal)
+{
+  vec2 e = normal.xy / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+  if (normal.z < 0.0)
+  {
+    e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return e * 0.5 + 0.5;
+}
+
+vec3 DecodeOctahedral(in vec2 encoded)
+{
+  vec2 e = encoded * 2.0 - 1.0;
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = clamp(-n.z, 0.0, 1.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+float EncodeSpecularPower(in float specPow)
+{
+  return clamp(log2(max(specPow, 1.0)) / GBUFFER_SPEC_POW_LOG2_MAX, 0.0, 1.0);
+}
+
+float DecodeSpecularPower(in float encoded)
+{
+  return exp2(encoded * GBUFFER_SPEC_POW_LOG2_MAX);
+}
+
+vec3 ReconstructWorldPosition(in vec2 uv, in float depth)
+{
+  vec4 world = InverseViewProj * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+  return world.xyz / world.w;
+}
+
+vec3 GBufferWorldPosition(in sampler2D positionTexture, in sampler2D depthTexture, in vec2 uv)
+{
+  if (CompactGBuffer)
+    return ReconstructWorldPosition(uv, texture(depthTexture, uv).r);
+  return texture(positionTexture, uv).xyz;
+}
+
+vec3 GBufferWorldNormal(in sampler2D normalTexture, in vec2 uv)
+{
+  if (CompactGBuffer)
+    return DecodeOctahedral(texture(normalTexture, uv).rg);
+  return texture(normalTexture, uv).xyz * 2 - 1;
+}
+
+bool GBufferReceiveLight(in sampler2D diffuseTexture, in sampler2D normalTexture, in vec2 uv)
+{
+  if (CompactGBuffer)
+    return texture(diffuseTexture, uv).a > 0.5;
+  return texture(normalTexture, uv).w > 0.5;
+}
+
+float GBufferSpecularPower(in sampler2D positionTexture, in sampler2D specularTexture, in vec2 uv)
+{
+  if (CompactGBuffer)
+    return DecodeSpecularPower(texture(specularTexture, uv).a);
+  return texture(positionTexture, uv).w;
+}
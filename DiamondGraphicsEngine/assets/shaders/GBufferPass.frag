@@ -12,6 +12,8 @@ layout(location = 1) out vec4 vWorldPosition_SpecPow;
 layout(location = 2) out vec4 vWorldNormal_ReceiveLight;
 layout(location = 3) out vec4 vSpecColor_Empty;
 
+#include "GBufferPacking.glsl"
+
 // represents material properties of the surface passed by the application
 uniform struct
 {
@@ -30,51 +32,69 @@ uniform struct
   sampler2D NormalMapTexture;
 } Material;
 
+#include "MaterialTable.glsl"
+
 void main()
 {
+  LoadMaterial();
   vec2 uv;
   uv.x = ( fwidth( Uv0.x ) < fwidth( Uv1.x )-0.001f )? Uv0.x : Uv1.x; 
   uv.y = ( fwidth( Uv0.y ) < fwidth( Uv1.y )-0.001f )? Uv0.y : Uv1.y;
 
-  vec4 materialColor = Material.AmbientColor + Material.DiffuseColor + Material.EmissiveColor;  
-  vec4 textureColor  = Material.DiffuseTextureEnabled ? texture(Material.DiffuseTexture, uv) : vec4(1,1,1,1);
+  vec4 materialColor = Surface.AmbientColor + Surface.DiffuseColor + Surface.EmissiveColor;  
+  vec4 textureColor  = Surface.DiffuseTextureEnabled ? SampleDiffuseTexture(uv) : vec4(1,1,1,1);
 
   //layout 0
   vDiffuseColor_Empty.xyz = clamp(vec3(materialColor.xyz)*vec3(textureColor.xyz), 0, 1);
   //vDiffuseColor_TexU.w = uv.x;
    vDiffuseColor_Empty.w = 1;
 
-  //layout 1
-  vWorldPosition_SpecPow.xyz = WorldPosition.xyz;
-  //vWorldPosition_TexV.w = uv.y;
-   vWorldPosition_SpecPow.w = Material.SpecularExponent;
-
-
-  //layout 2
-  if (Material.NormalMapTextureEnabled)
+  vec3 worldNormal;
+  if (Surface.NormalMapTextureEnabled)
   {
-    vWorldNormal_ReceiveLight = normalize(inverse(TBN) * (vec4(texture(Material.NormalMapTexture, uv).rgb, 0) * 2 - 1));
+    // z is rebuilt from x and y, BC5 compressed normal maps only store those two
+    vec2 tangentXY = SampleNormalMapTexture(uv).rg * 2 - 1;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(0, 1 - dot(tangentXY, tangentXY))));
+    worldNormal = normalize(inverse(TBN) * vec4(tangentNormal, 0)).xyz;
   }
   else
   {
-    vWorldNormal_ReceiveLight.xyz = normalize(WorldNormal.xyz);
+    worldNormal = normalize(WorldNormal.xyz);
   }
-  vWorldNormal_ReceiveLight.xyz = (vWorldNormal_ReceiveLight.xyz+1)*0.5f;
-  if (Material.ReceiveLight)
+
+  if (CompactGBuffer)
   {
-    vWorldNormal_ReceiveLight.w = 1.0f;
+    //layout 0 alpha carries receive light, layout 1 is not attached,
+    //layout 2 is RG16 and layout 3 alpha carries spec power
+    vDiffuseColor_Empty.w = Surface.ReceiveLight ? 1.0f : 0.0f;
+    vWorldNormal_ReceiveLight = vec4(EncodeOctahedral(worldNormal), 0, 0);
+    vSpecColor_Empty.w = EncodeSpecularPower(Surface.SpecularExponent);
   }
   else
   {
-    vWorldNormal_ReceiveLight.w = 0.0f;
+    //layout 1
+    vWorldPosition_SpecPow.xyz = WorldPosition.xyz;
+    //vWorldPosition_TexV.w = uv.y;
+    vWorldPosition_SpecPow.w = Surface.SpecularExponent;
+
+    //layout 2
+    vWorldNormal_ReceiveLight.xyz = (worldNormal+1)*0.5f;
+    if (Surface.ReceiveLight)
+    {
+      vWorldNormal_ReceiveLight.w = 1.0f;
+    }
+    else
+    {
+      vWorldNormal_ReceiveLight.w = 0.0f;
+    }
   }
   //layout 3
-  if (Material.SpecularTextureEnabled)
+  if (Surface.SpecularTextureEnabled)
   {
-    vSpecColor_Empty.xyz = texture(Material.SpecularTexture, uv).xyz;
+    vSpecColor_Empty.xyz = SampleSpecularTexture(uv).xyz;
   }
   else
   {
-    vSpecColor_Empty.xyz = Material.SpecularColor.xyz;
+    vSpecColor_Empty.xyz = Surface.SpecularColor.xyz;
   }
 }
@@ -43,6 +43,8 @@ uniform sampler2D WorldPosition_TexV_Texture;
 uniform sampler2D WorldNormal_ReceiveLight_Texture;
 uniform sampler2D Depth_Texture;
 
+#include "GBufferPacking.glsl"
+
 uniform vec2 ControlVariable; 
 uniform int SamplePointNum;
 uniform float RangeOfInfluence;
@@ -73,7 +75,7 @@ float SSAO_Spiral(in vec3 worldPosition, in vec3 worldNormal,
       float theta = c_2PI*alpha*(7*n/9)+phi;    
       vec2 uvPos = vec2(x,y) + h*vec2(cos(theta), sin(theta));  
       //vec2 uvPos = vec2(x,y) ;  
-      SamplePoints[i] = texture(WorldPosition_TexV_Texture, uvPos).xyz;  
+      SamplePoints[i] = GBufferWorldPosition(WorldPosition_TexV_Texture, Depth_Texture, uvPos);
       Depths[i] = texture(Depth_Texture, uvPos).r;  
     }
     
@@ -184,8 +186,8 @@ void main()
 {
   vec2 pixelFrac = vec2(1.0f/ScreenDimension.x,1.0f/ScreenDimension.y );
   vec2 uvPos = vec2(gl_FragCoord.xy * pixelFrac);
-  vec3 pixelPos = texture(WorldPosition_TexV_Texture, uvPos).xyz;
-  vec3 pixelNormal = texture(WorldNormal_ReceiveLight_Texture, uvPos).xyz*2-1;
+  vec3 pixelPos = GBufferWorldPosition(WorldPosition_TexV_Texture, Depth_Texture, uvPos);
+  vec3 pixelNormal = GBufferWorldNormal(WorldNormal_ReceiveLight_Texture, uvPos);
   
   float depth = texture(Depth_Texture, uvPos).r;
   
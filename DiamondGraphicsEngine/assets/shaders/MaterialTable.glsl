@@ -0,0 +1,109 @@
+// Material table shared by the material shaders.
+// Mirrors inc/graphics/MaterialTable.h, keep the two in sync.
+//
+// Materials drawn through the table (MaterialIndex >= 0) read their
+// parameters from the table buffer and their textures from the texture
+// arrays, the others from the Material uniform, which is declared before
+// this file is included. Call LoadMaterial once at the top of main.
+
+#define MATERIAL_RECEIVE_LIGHT 1u
+#define MATERIAL_DIFFUSE_TEXTURE 2u
+#define MATERIAL_SPECULAR_TEXTURE 4u
+#define MATERIAL_NORMAL_MAP_TEXTURE 8u
+#define MAX_TEXTURE_ARRAYS 8
+
+struct MaterialRecord
+{
+  vec4 AmbientColor;
+  vec4 DiffuseColor;
+  vec4 EmissiveColor;
+  vec4 SpecularColor;
+  float SpecularExponent;
+  uint Flags;
+  uvec2 DiffuseTexture;   // texture array, layer | finest level with pixels << 16
+  uvec2 SpecularTexture;
+  uvec2 NormalMapTexture;
+};
+
+layout(std430, binding = 3) readonly buffer MaterialTableBuffer
+{
+  MaterialRecord MaterialRecords[];
+};
+uniform sampler2DArray MaterialTextureArrays[MAX_TEXTURE_ARRAYS];
+uniform int MaterialIndex = -1;
+
+// the material being drawn, without its samplers
+struct SurfaceMaterial
+{
+  bool ReceiveLight;
+  vec4 AmbientColor;
+  vec4 DiffuseColor;
+  vec4 EmissiveColor;
+  vec4 SpecularColor;
+  float SpecularExponent;
+  bool DiffuseTextureEnabled;
+  bool SpecularTextureEnabled;
+  bool NormalMapTextureEnabled;
+};
+SurfaceMaterial Surface;
+
+void LoadMaterial()
+{
+  if (MaterialIndex >= 0)
+  {
+    MaterialRecord record = MaterialRecords[MaterialIndex];
+    Surface.ReceiveLight = (record.Flags & MATERIAL_RECEIVE_LIGHT) != 0u;
+    Surface.AmbientColor = record.AmbientColor;
+    Surface.DiffuseColor = record.DiffuseColor;
+    Surface.EmissiveColor = record.EmissiveColor;
+    Surface.SpecularColor = record.SpecularColor;
+    Surface.SpecularExponent = record.SpecularExponent;
+    Surface.DiffuseTextureEnabled = (record.Flags & MATERIAL_DIFFUSE_TEXTURE) != 0u;
+    Surface.SpecularTextureEnabled = (record.Flags & MATERIAL_SPECULAR_TEXTURE) != 0u;
+    Surface.NormalMapTextureEnabled = (record.Flags & MATERIAL_NORMAL_MAP_TEXTURE) != 0u;
+  }
+  else
+  {
+    Surface.ReceiveLight = Material.ReceiveLight;
+    Surface.AmbientColor = Material.AmbientColor;
+    Surface.DiffuseColor = Material.DiffuseColor;
+    Surface.EmissiveColor = Material.EmissiveColor;
+    Surface.SpecularColor = Material.SpecularColor;
+    Surface.SpecularExponent = Material.SpecularExponent;
+    Surface.DiffuseTextureEnabled = Material.DiffuseTextureEnabled;
+    Surface.SpecularTextureEnabled = Material.SpecularTextureEnabled;
+    Surface.NormalMapTextureEnabled = Material.NormalMapTextureEnabled;
+  }
+}
+
+// MaterialIndex is the same for the whole draw, so the array index is
+// dynamically uniform as GLSL requires for sampler arrays, and so is the
+// branch. Streamed textures have no pixels in levels finer than their
+// resident one, the sample is clamped to it.
+vec4 SampleTextureArray(in uvec2 reference, in vec2 uv)
+{
+  vec3 coordinate = vec3(uv, float(reference.y & 0xffffu));
+  uint minLevel = reference.y >> 16;
+  if (minLevel == 0u)
+    return texture(MaterialTextureArrays[reference.x], coordinate);
+  float level = max(textureQueryLod(MaterialTextureArrays[reference.x], uv).y, float(minLevel));
+  return textureLod(MaterialTextureArrays[reference.x], coordinate, level);
+}
+
+vec4 SampleDiffuseTexture(in vec2 uv)
+{
+  return MaterialIndex >= 0 ? SampleTextureArray(MaterialRecords[MaterialIndex].DiffuseTexture, uv)
+                            : texture(Material.DiffuseTexture, uv);
+}
+
+vec4 SampleSpecularTexture(in vec2 uv)
+{
+  return MaterialIndex >= 0 ? SampleTextureArray(MaterialRecords[MaterialIndex].SpecularTexture, uv)
+                            : texture(Material.SpecularTexture, uv);
+}
+
+vec4 SampleNormalMapTexture(in vec2 uv)
+{
+  return MaterialIndex >= 0 ? SampleTextureArray(MaterialRecords[MaterialIndex].NormalMapTexture, uv)
+                            : texture(Material.NormalMapTexture, uv);
+}
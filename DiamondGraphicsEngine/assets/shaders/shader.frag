@@ -52,6 +52,8 @@ uniform struct
   sampler2D NormalMapTexture;
 } Material;
 
+#include "MaterialTable.glsl"
+
 uniform struct
 {
   vec3 ViewDir_world;
@@ -77,15 +79,15 @@ vec4 DoDirectionalLight(in Light light, in vec4 worldNormal)
   vec4 viewVec = WorldPosition - vec4(Camera.Position_world, 1);
 
   // ambient contribution from the light is always constant
-  vec4 ambient = light.ambient * Material.AmbientColor;
+  vec4 ambient = light.ambient * Surface.AmbientColor;
   
   // compute diffuse contribution on the surface
-  vec4 diffuse = max(dot(worldNormal, lightVec), 0) * light.diffuse * Material.DiffuseColor;
+  vec4 diffuse = max(dot(worldNormal, lightVec), 0) * light.diffuse * Surface.DiffuseColor;
   
   
   vec4 specular = light.specular
-                * Material.SpecularColor
-                * pow(max(dot(reflect(lightVec, worldNormal),viewVec),0),Material.SpecularExponent);
+                * Surface.SpecularColor
+                * pow(max(dot(reflect(lightVec, worldNormal),viewVec),0),Surface.SpecularExponent);
   return light.intensity*(ambient + diffuse + specular); // total contribution from this light
 }
 vec4 computeLightingTerm(in int lightIdx, in vec4 worldNormal)
@@ -129,33 +131,37 @@ vec4 computeLightingTerm(in int lightIdx, in vec4 worldNormal)
 vec4 computeLightColor(in vec4 worldNormal, vec2 uv)
 {
   vec4 normal = worldNormal;
-  if (Material.NormalMapTextureEnabled)
+  if (Surface.NormalMapTextureEnabled)
   {
-    normal= normalize(inverse(TBN) * (vec4(texture(Material.NormalMapTexture, uv).rgb, 0) * 2 - 1));
+    // z is rebuilt from x and y, BC5 compressed normal maps only store those two
+    vec2 tangentXY = SampleNormalMapTexture(uv).rg * 2 - 1;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(0, 1 - dot(tangentXY, tangentXY))));
+    normal= normalize(inverse(TBN) * vec4(tangentNormal, 0));
   }
   // Phong: total contribution of light is sum of all individual light contribs.
   vec4 color = vec4(0, 0, 0, 0); // no light = black
   for (int i = 0; i < LightCount; ++i)
     color += computeLightingTerm(i, normal); // contribution of light i
-  return color + Material.EmissiveColor; // contribution from all lights onto surface
+  return color + Surface.EmissiveColor; // contribution from all lights onto surface
 }
 
 
 void main()
 {
+  LoadMaterial();
   vec4 lightColor;
   vec4 textureColor;
   vec2 uv;
   uv.x = ( fwidth( Uv0.x ) < fwidth( Uv1.x )-0.001f )? Uv0.x : Uv1.x; 
   uv.y = ( fwidth( Uv0.y ) < fwidth( Uv1.y )-0.001f )? Uv0.y : Uv1.y;
   
-  lightColor = Material.ReceiveLight ? computeLightColor(WorldNormal, uv) : vec4(1,1,1,1);
-  textureColor = Material.DiffuseTextureEnabled ? texture(Material.DiffuseTexture, uv) : vec4(1,1,1,1);
+  lightColor = Surface.ReceiveLight ? computeLightColor(WorldNormal, uv) : vec4(1,1,1,1);
+  textureColor = Surface.DiffuseTextureEnabled ? SampleDiffuseTexture(uv) : vec4(1,1,1,1);
   //for now I use specular texture as a diffuse texture so 
   //that you can see they blend.
   //multiplicative blending.
-  // if (Material.SpecularTextureEnabled)
-    // textureColor*=texture(Material.SpecularTexture, uv).x;
+  // if (Surface.SpecularTextureEnabled)
+    // textureColor*=SampleSpecularTexture(uv).x;
     
   vFragColor = vec4(lightColor*textureColor).rgba;
   
@@ -18,6 +18,7 @@ out vec2 Uv1;//fixed border line
 out mat4 TBN;
 
 uniform mat4 ModelMatrix; // local->world matrix
+uniform mat3 NormalMatrix; // inverse transpose of ModelMatrix, local->world for normals
 uniform mat4 ModelViewProjectionMatrix; // local->NDC matrix [no camera support]
 
 
@@ -33,7 +34,7 @@ void main()
   
   vec4 fragTan = ModelMatrix * vec4(vTangent, 0);
 	vec4 fragBitan = ModelMatrix * vec4(vBitangent, 0);
-	vec4 fragNormal = ModelMatrix * vec4(vNormal, 0);
+	vec4 fragNormal = vec4(NormalMatrix * vNormal, 0);
   TBN = transpose(mat4(fragTan, fragBitan, fragNormal, vec4(0, 0, 0, 1)));  
   
   
@@ -41,9 +42,8 @@ void main()
   // deal with position and normal in world space  
   WorldPosition = ModelMatrix * vec4(vPosition, 1);
 
-  // vec4(vNormal, 0) because we don't want to translate a normal;
-  // NOTE: this code is wrong if we support non-uniform scaling
-  WorldNormal = normalize(ModelMatrix * vec4(vNormal, 0));
+  // the normal matrix keeps normals perpendicular under non-uniform scaling
+  WorldNormal = vec4(normalize(NormalMatrix * vNormal), 0);
 
   
   // compute the final result of passing this vertex through the transformation
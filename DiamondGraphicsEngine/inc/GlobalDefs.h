@@ -26,6 +26,14 @@
 #define ASSIGNMENT_1_HIDE_SHADER 0
 #define VERBOSE 1
 #define DEFERRED_SHADING_TEST 1
+#define COMPACT_GBUFFER 1
+//headless mode makes its context through EGL (needs EGL headers/libEGL and GLEW built with GLEW_EGL),
+//otherwise through a hidden FreeGLUT window, which runs on Mesa llvmpipe's opengl32.dll; that window
+//still needs a display (a desktop session for WGL, an X server on Linux), so with the default of 0
+//--headless, --benchmark and --selftest do not run on a machine without one
+#define HEADLESS_EGL 0
+//scoped CPU markers and GPU pass timers (framework/Profiler.h), 0 compiles every marker out
+#define PROFILING 1
 #define UNUSED_VAR(x) static_cast<void>(x);
 
 #if VERBOSE
@@ -18,6 +18,7 @@
 #include <array>
 #include <list>
 #include <forward_list>
+#include <functional>
 #include <set>
 #include <queue>
 #include <stack>
@@ -1,9 +1,11 @@
 #pragma once
 #include "math/Vector3.h"
 
+namespace Math {
+    struct Matrix4;
+}
 
 class Ray;
-//todo finish bouding volume architecture
 class BoundingVolume
 {
 public:
@@ -18,6 +20,8 @@ struct BoundingSphere : public BoundingVolume
 {
     BoundingSphere(Math::Vector3 const& c = {0,0,0}, float r = 0.0f);
     bool CheckRayCollision(Ray const& ray, float* t) const override;
+    //sphere enclosing this one after the transform, the radius follows the largest axis scale
+    BoundingSphere Transformed(Math::Matrix4 const& transform) const;
 
 
     float radius = 0.0f;
@@ -27,8 +31,17 @@ struct BoundingSphere : public BoundingVolume
 struct BoundingAABB : public BoundingVolume
 {
     BoundingAABB(Math::Vector3 const& _min = { 0,0,0 }, Math::Vector3 const& _max = { 0,0,0 });
+    static BoundingAABB FromSphere(BoundingSphere const& sphere);
     bool CheckRayCollision(Ray const& ray, float* t) const override;
 
+    //smallest box containing both
+    static BoundingAABB Merged(BoundingAABB const& lhs, BoundingAABB const& rhs);
+    BoundingAABB Expanded(float margin) const;
+    bool Contains(BoundingAABB const& other) const;
+    bool Overlaps(BoundingAABB const& other) const;
+    float SurfaceArea() const;
+    Math::Vector3 GetCenter() const { return (aabbMin + aabbMax) * 0.5f; }
+
 
     Math::Vector3 aabbMin = { 0,0,0 };
     Math::Vector3 aabbMax = { 0,0,0 };
@@ -0,0 +1,331 @@
+#pragma once
+#include "core/BoundingVolume.h"
+#include "core/Ray.h"
+#include "framework/Utilities.h"
+#include "graphics/FrustumCuller.h"
+#include "math/MathBatch.h"
+#include "math/Reals.h"
+
+#include <cfloat>
+
+/*******************************************************
+ * @brief
+ * Dynamic AABB tree over scene objects. Every leaf holds one
+ * object with its box grown by a margin ("fat" box), so small
+ * movements do not touch the tree at all. Larger movements refit
+ * the leaf and its ancestors without changing the topology, which
+ * is cheap but lets the tree degrade. The quality is tracked as
+ * the SAH cost of the tree and a full binned SAH rebuild is done
+ * once it exceeds the cost after the last rebuild by a ratio.
+ *
+ * Frustum, ray and box queries walk the tree and hand candidate
+ * objects to a callback, which can run an exact test on its own
+ * bounding volume. No GL calls are made, the whole tree can be
+ * used and measured on the CPU.
+ *******************************************************/
+class BoundingVolumeHierarchy
+{
+public:
+    static const s32 NullNode = -1;
+
+    /*******************************************************
+     * @param fatMargin Growth of leaf boxes, in world units.
+     * @param rebuildCostRatio Rebuild when the SAH cost passes
+     * this multiple of the cost right after the last rebuild.
+     *******************************************************/
+    explicit BoundingVolumeHierarchy(float fatMargin = 0.1f, float rebuildCostRatio = 1.5f);
+
+    // Add an object, returns its leaf to update/remove it later.
+    s32 Insert(ObjectId id, BoundingAABB const& aabb);
+    void Remove(s32 leaf);
+    /*******************************************************
+     * @brief Move an object. Nothing happens while the new box is
+     * still inside the fat box, otherwise the leaf gets a new fat
+     * box and its ancestors are refit.
+     * @return true if the tree changed.
+     *******************************************************/
+    bool Update(s32 leaf, BoundingAABB const& aabb);
+    void Clear();
+
+    // Top down rebuild of the whole tree with binned SAH.
+    void Rebuild();
+    // Rebuild if the tree changed and its cost degraded past the ratio.
+    bool RebuildIfDegraded();
+    /*******************************************************
+     * @brief SAH cost: expected number of nodes visited by a random
+     * ray hitting the root, i.e. the sum of all node surface areas
+     * over the root surface area.
+     *******************************************************/
+    float GetCost() const;
+
+    u32 GetObjectCount() const { return m_leafCount; }
+    s32 GetHeight() const;
+    ObjectId GetObjectId(s32 leaf) const { return m_nodes[leaf].Object; }
+    BoundingAABB const& GetFatAABB(s32 leaf) const { return m_nodes[leaf].Box; }
+    // Check the structure and every box, for debugging.
+    bool Validate() const;
+
+    /*******************************************************
+     * @brief Call callback(ObjectId) for every object whose fat box
+     * overlaps the box.
+     *******************************************************/
+    template <typename TCallback>
+    void QueryOverlap(BoundingAABB const& aabb, TCallback&& callback) const;
+
+    /*******************************************************
+     * @brief Call callback(ObjectId, bool fullyInside) for every object
+     * whose fat box intersects the frustum. Subtrees entirely inside
+     * are reported without further tests and fullyInside set, so the
+     * callback only needs its exact test when it is false.
+     *******************************************************/
+    template <typename TCallback>
+    void QueryFrustum(Graphics::Frustum const& frustum, TCallback&& callback) const;
+
+    /*******************************************************
+     * @brief Walk the tree front to back along a ray with a normalized
+     * direction. callback(ObjectId, float& distance) runs the exact
+     * test, returns true on a hit and sets the distance, which then
+     * prunes every node further away.
+     * @return true if anything was hit, distance is the nearest hit.
+     *******************************************************/
+    template <typename TCallback>
+    bool RayCast(Ray const& ray, float* distance, TCallback&& callback, float maxDistance = FLT_MAX) const;
+
+    /*******************************************************
+     * @brief Walk the tree with a packet of rays together, every
+     * node box tested against all of them with Batch::IntersectBox.
+     * callback(ObjectId) runs for every object whose fat box any
+     * ray reaches within its distance; it runs the exact tests and
+     * lowers the distances of the rays it hits, which prunes the
+     * rest of the walk.
+     *******************************************************/
+    template <typename TCallback>
+    void RayCastPacket(Math::RaySpan rays, TCallback&& callback) const;
+
+    struct Benchmark
+    {
+        u32 ObjectCount = 0;
+        float InsertMilliseconds = 0.0f;
+        float RebuildMilliseconds = 0.0f;
+        float CostInserted = 0.0f;
+        float CostRebuilt = 0.0f;
+        //all query times are for the whole query batch
+        u32 QueryCount = 0;
+        float FrustumMilliseconds = 0.0f;
+        float FrustumBruteForceMilliseconds = 0.0f;
+        float RayMilliseconds = 0.0f;
+        float RayBruteForceMilliseconds = 0.0f;
+        float OverlapMilliseconds = 0.0f;
+        float OverlapBruteForceMilliseconds = 0.0f;
+        //the tree and brute force found exactly the same objects
+        bool ResultsMatch = true;
+    };
+    // Compare the tree against testing every object, objects are random spheres.
+    static Benchmark MeasureQueries(u32 objectCount, u32 queryCount = 100);
+
+private:
+    struct Node
+    {
+        BoundingAABB Box;
+        ObjectId Object = -1;
+        s32 Parent = NullNode;//next free node while on the free list
+        s32 Left = NullNode;
+        s32 Right = NullNode;
+        bool IsLeaf() const { return Left == NullNode; }
+    };
+
+    s32 allocateNode();
+    void freeNode(s32 node);
+    void insertLeaf(s32 leaf);
+    void removeLeaf(s32 leaf);
+    void refitAncestors(s32 node);
+    s32 buildSAH(std::vector<s32>& leaves, std::vector<Math::Vector3> const& centers, u32 begin, u32 end);
+    s32 validate(s32 node, bool& valid) const;
+
+    std::vector<Node> m_nodes;
+    s32 m_root = NullNode;
+    s32 m_freeList = NullNode;
+    u32 m_leafCount = 0;
+
+    float m_fatMargin;
+    float m_rebuildCostRatio;
+    float m_rebuiltCost = 0.0f;
+    bool m_changed = false;
+};
+
+template <typename TCallback>
+void BoundingVolumeHierarchy::QueryOverlap(BoundingAABB const& aabb, TCallback&& callback) const
+{
+    if (m_root == NullNode)
+        return;
+    std::vector<s32> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while (!stack.empty())
+    {
+        Node const& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!node.Box.Overlaps(aabb))
+            continue;
+        if (node.IsLeaf())
+        {
+            callback(node.Object);
+            continue;
+        }
+        stack.push_back(node.Left);
+        stack.push_back(node.Right);
+    }
+}
+
+template <typename TCallback>
+void BoundingVolumeHierarchy::QueryFrustum(Graphics::Frustum const& frustum, TCallback&& callback) const
+{
+    if (m_root == NullNode)
+        return;
+    //second member set when every node below is known to be inside
+    std::vector<std::pair<s32, bool>> stack;
+    stack.reserve(64);
+    stack.emplace_back(m_root, false);
+    while (!stack.empty())
+    {
+        std::pair<s32, bool> entry = stack.back();
+        stack.pop_back();
+        Node const& node = m_nodes[entry.first];
+        bool inside = entry.second;
+        if (!inside)
+        {
+            Math::Vector3 center = node.Box.GetCenter();
+            Math::Vector3 extent = node.Box.aabbMax - center;
+            bool outside = false;
+            inside = true;
+            for (Math::Vector4 const& plane : frustum.Planes)
+            {
+                float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+                float reach = Math::Abs(plane.x) * extent.x + Math::Abs(plane.y) * extent.y + Math::Abs(plane.z) * extent.z;
+                if (dist + reach < 0.0f)
+                {
+                    outside = true;
+                    break;
+                }
+                if (dist - reach < 0.0f)
+                    inside = false;
+            }
+            if (outside)
+                continue;
+        }
+        if (node.IsLeaf())
+        {
+            callback(node.Object, inside);
+            continue;
+        }
+        stack.emplace_back(node.Left, inside);
+        stack.emplace_back(node.Right, inside);
+    }
+}
+
+template <typename TCallback>
+bool BoundingVolumeHierarchy::RayCast(Ray const& ray, float* distance, TCallback&& callback, float maxDistance) const
+{
+    if (m_root == NullNode)
+        return false;
+    Math::Vector3 start = ray.GetStartPosition();
+    Math::Vector3 direction = ray.GetRayDirection();
+    Math::Vector3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    //entry distance of the box, FLT_MAX when it is missed or beyond maxT
+    auto slab = [&start, &invDirection](BoundingAABB const& box, float maxT)
+    {
+        float tmin = 0.0f;
+        float tmax = maxT;
+        //by component, Vector3::operator[] is an out of line checked call
+        auto axis = [&tmin, &tmax](float minimum, float maximum, float origin, float inverse)
+        {
+            float tNear = (minimum - origin) * inverse;
+            float tFar = (maximum - origin) * inverse;
+            //NaN (0 * inf on a slab border) must not shrink the interval
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+            tmin = tNear > tmin ? tNear : tmin;
+            tmax = tFar < tmax ? tFar : tmax;
+        };
+        axis(box.aabbMin.x, box.aabbMax.x, start.x, invDirection.x);
+        axis(box.aabbMin.y, box.aabbMax.y, start.y, invDirection.y);
+        axis(box.aabbMin.z, box.aabbMax.z, start.z, invDirection.z);
+        return tmin <= tmax ? tmin : FLT_MAX;
+    };
+
+    bool hit = false;
+    float nearest = maxDistance;
+    std::vector<std::pair<s32, float>> stack;
+    stack.reserve(64);
+    float rootT = slab(m_nodes[m_root].Box, nearest);
+    if (rootT != FLT_MAX)
+        stack.emplace_back(m_root, rootT);
+    while (!stack.empty())
+    {
+        std::pair<s32, float> entry = stack.back();
+        stack.pop_back();
+        if (entry.second > nearest)
+            continue;
+        Node const& node = m_nodes[entry.first];
+        if (node.IsLeaf())
+        {
+            float t = nearest;
+            if (callback(node.Object, t) && t <= nearest)
+            {
+                nearest = t;
+                hit = true;
+            }
+            continue;
+        }
+        float leftT = slab(m_nodes[node.Left].Box, nearest);
+        float rightT = slab(m_nodes[node.Right].Box, nearest);
+        //push the far child first so the near one is visited first
+        if (leftT < rightT)
+        {
+            if (rightT != FLT_MAX) stack.emplace_back(node.Right, rightT);
+            stack.emplace_back(node.Left, leftT);
+        }
+        else
+        {
+            if (leftT != FLT_MAX) stack.emplace_back(node.Left, leftT);
+            if (rightT != FLT_MAX) stack.emplace_back(node.Right, rightT);
+        }
+    }
+    if (hit && distance)
+        *distance = nearest;
+    return hit;
+}
+
+template <typename TCallback>
+void BoundingVolumeHierarchy::RayCastPacket(Math::RaySpan rays, TCallback&& callback) const
+{
+    if (m_root == NullNode || rays.count == 0)
+        return;
+    std::vector<float> entries(rays.count);
+    //nodes are tested when popped, so the distances lowered by the callback prune them
+    std::vector<s32> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while (!stack.empty())
+    {
+        Node const& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (Math::Batch::IntersectBox(node.Box.aabbMin, node.Box.aabbMax, rays, entries.data()) == FLT_MAX)
+            continue;
+        if (node.IsLeaf())
+        {
+            callback(node.Object);
+            continue;
+        }
+        //near child first for the first ray, along the axis the children are furthest apart on
+        Math::Vector3 separation = m_nodes[node.Right].Box.GetCenter() - m_nodes[node.Left].Box.GetCenter();
+        float towardsRight = rays.inverseX[0] * separation.x;
+        if (Math::Abs(separation.y) > Math::Abs(separation.x) && Math::Abs(separation.y) >= Math::Abs(separation.z))
+            towardsRight = rays.inverseY[0] * separation.y;
+        else if (Math::Abs(separation.z) > Math::Abs(separation.x) && Math::Abs(separation.z) > Math::Abs(separation.y))
+            towardsRight = rays.inverseZ[0] * separation.z;
+        bool leftNear = towardsRight >= 0.0f;
+        stack.push_back(leftNear ? node.Right : node.Left);
+        stack.push_back(leftNear ? node.Left : node.Right);
+    }
+}
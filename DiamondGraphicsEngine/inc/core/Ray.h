@@ -12,8 +12,8 @@ namespace Math {
  * ray casting to test if the ray hits any objects. If it hits,
  * we picks the nearest object as selected objcet.
  * This is how we select objects in a 3D scene.
- * @note For now it only support RaySphere collision test.
- * You could add more such as RayAABB, RayPlane etc.
+ * @note Ray-sphere is tested here, ray-box by BoundingAABB and
+ * ray-triangle by Graphics::TriangleBvh.
  *******************************************************/
 class Ray
 {
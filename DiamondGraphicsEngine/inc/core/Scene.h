@@ -2,6 +2,8 @@
 #include "core/Object.h"
 #include "core/HierarchicalObjectHandler.h"
 #include "graphics/ShaderManager.h"
+#include "graphics/FrustumCuller.h"
+#include "core/BoundingVolumeHierarchy.h"
 namespace Math {
     struct Matrix4;
 }
@@ -42,6 +44,39 @@ public:
     void UpdateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matrix4 const& parentWorldMatrix);
     void OnObjectShaderTypeChanged(Object* obj, Graphics::ShaderType oldType, Graphics::ShaderType newType);
     auto& GetRenderObjectListRef() { return m_renderObjectList; }
+    /**************************************************
+     * @brief Recompute the world bounding sphere the renderer
+     * culls the object with. Called whenever the world transform
+     * or the meshes of the object change.
+     ***************************************************/
+    void UpdateCullingSphere(Object& obj);
+    /**************************************************
+     * @brief UpdateCullingSphere for many objects at once: the
+     * mesh spheres of all of them are transformed in one pass
+     * of the Math::Batch kernels. The transform tree updates
+     * collect the objects they move and end with this.
+     ***************************************************/
+    void UpdateCullingSpheres(std::vector<ObjectId> const& ids);
+    Graphics::FrustumCuller const& GetFrustumCullerRef() const { return m_frustumCuller; }
+    BoundingVolumeHierarchy const& GetObjectTreeRef() const { return m_objectTree; }
+    /**************************************************
+     * @brief Find the objects whose bounding sphere intersects the
+     * frustum. Large scenes walk the object tree, small ones are
+     * faster with a linear SIMD sweep over all spheres.
+     * @param visible Visible object ids, in id order.
+     * @param visibleMask 1 for every visible id, indexed by ObjectId.
+     ***************************************************/
+    Graphics::CullStats CullObjects(Graphics::Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const;
+    /**************************************************
+     * @brief Nearest object the ray hits, tested against the
+     * world sphere first and then, through the cached inverse
+     * world transform, each of its meshes (the triangles of a
+     * TriangleMesh, the local sphere of other meshes).
+     * @param ray Ray with a normalized direction.
+     * @param distance Distance to the hit, can be nullptr.
+     * @return nullptr if nothing is hit.
+     ***************************************************/
+    Object* PickObject(Ray const& ray, float* distance = nullptr);
 
     std::vector<Object*>& GetEditorObjectRef() { return m_editorObjects; }
 
@@ -49,6 +84,13 @@ protected:
     //void renderShadedComponents(Graphics::GraphicsEngine* graphics);
     void initializeHierarchicalTransform();
     void initializeRenderObjectList();
+    //the tree walks behind InitTransformTree and UpdateTransformTree, they add every object they move to updated
+    void initTransformTree(HierarchicalObjectHandlerNode* node, std::vector<ObjectId>& updated);
+    void updateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matrix4 const& parentWorldMatrix, std::vector<ObjectId>& updated);
+    //hand the world sphere of an object to the culler and the object tree, hasBounds false for objects without meshes
+    void setCullingSphere(ObjectId id, bool hasBounds, BoundingSphere const& bounds);
+    //nearest Mesh::RayCast hit of any of the object's meshes, as a distance along ray
+    bool rayCastMeshes(Object& obj, Ray const& ray, float* distance);
 
     ObjectHashTable m_objects;
     HierarchicalObjectHandler m_hierarchicalObjectHandler;
@@ -62,6 +104,11 @@ protected:
      *          ... ...
      */
     std::unordered_map<Graphics::ShaderType, std::unordered_map<ObjectId, RenderObject*> > m_renderObjectList;
+    //world bounding spheres of all objects, indexed by ObjectId
+    Graphics::FrustumCuller m_frustumCuller;
+    //AABB tree over the same spheres, objects without bounds are not in it
+    BoundingVolumeHierarchy m_objectTree;
+    std::vector<s32> m_objectTreeLeaves;
 
 private:
     ObjectId m_nextFreeId = 0;
@@ -6,6 +6,7 @@
 namespace Graphics
 {
 	class Material;
+	class TriangleMesh;
 }
 
 namespace Component
@@ -62,6 +63,18 @@ namespace Component
 		 *******************************************************/
 		Renderer& AttachMesh(std::shared_ptr<Graphics::Mesh> mesh);
 		Renderer& ReplaceMesh(size_t meshId, std::shared_ptr<Graphics::Mesh> mesh);
+	    /*******************************************************
+		 * @brief Make the object hide what is behind it in the
+		 * software occlusion culling.
+		 * @param occluder A simplified mesh drawn instead of the
+		 * object's own triangle meshes, in the same object space.
+		 * It must not stick out of them, or it hides things that
+		 * should be seen. nullptr uses the object's meshes.
+		 * @return this reference.
+		 *******************************************************/
+		Renderer& SetOccluder(bool isOccluder, std::shared_ptr<Graphics::TriangleMesh> occluder = nullptr);
+		bool IsOccluder() const { return m_isOccluder; }
+		std::shared_ptr<Graphics::TriangleMesh> GetOccluderMesh() const { return m_occluderMesh; }
         
         REGISTER_EDITOR_COMPONENT(Renderer)
 		void Reflect(TwBar* editor, std::string const& barName, std::string const& groupName,
@@ -70,6 +83,11 @@ namespace Component
 	protected:
 		void OnMaterialChanged();
 		void OnMeshChanged();
+		/*******************************************************
+		 * @brief Ask for the texture levels the object needs at
+		 * its size on screen, for texture streaming.
+		 *******************************************************/
+		void requestTextureDetail(Graphics::GraphicsEngine* g);
 
 
 		///object material that will be set to shader
@@ -79,6 +97,10 @@ namespace Component
         std::vector<std::pair<bool /*IfRender*/, std::shared_ptr<Graphics::Mesh> > > m_meshes;
 	    std::shared_ptr<Graphics::Material> mat;
 
+		///occlusion culling, off unless asked for since only large solid objects are worth it
+		bool m_isOccluder = false;
+		std::shared_ptr<Graphics::TriangleMesh> m_occluderMesh;
+
 	private://this field is used for editor
         /////////////////////////////////////////
         /// Mesh Editor fields
@@ -1,7 +1,10 @@
 #pragma once
 #include "core/ComponentBase.h"
 #include "math/Vector3.h"
+#include "math/Matrix3.h"
 #include "math/Matrix4.h"
+#include "math/Quaternion.h"
+#include "math/FastMath.h"
 
 namespace Component
 {
@@ -26,23 +29,84 @@ namespace Component
         Transform& Translate(Math::Vector3 const& trans);
         Transform& Scale(Math::Vector3 const& scale);
         Transform& Scale(float uniformScale);
+        // Rotate by Euler angles (X, then Y, then Z) on top of the current rotation.
         Transform& Rotate(Math::Vector3 const& angleRadianXYZ);
+        // Rotate by a unit quaternion on top of the current rotation, no trigonometry.
+        Transform& Rotate(Math::Quaternion const& rotation);
+        // Rotate by Euler angles with the sines and cosines of MathPolicy (math/FastMath.h).
+        template <typename MathPolicy>
+        Transform& Rotate(Math::Vector3 const& angleRadianXYZ)
+        {
+            return Rotate(eulerToQuaternion<MathPolicy>(angleRadianXYZ));
+        }
         Transform& Orbit(Math::Vector3 const& axis, float angleRadian);
 
         Math::Vector3 const& GetPosition() const { return m_position; }
-        Math::Vector3 const& GetRotationEuler() const { return m_rotationEuler; }
+        Math::Quaternion const& GetRotation() const { return m_rotation; }
+        // The angles last set, or converted from the quaternion after it was rotated.
+        Math::Vector3 const& GetRotationEuler() const;
         Math::Vector3 const& GetScale() const { return m_scale; }
 
         Math::Matrix4 const& GetLocalTransform() const;
         Math::Matrix4 const& GetWorldTransform() const;
+        // Inverse of the world transform, recomputed only after the world transform changes.
+        Math::Matrix4 const& GetInverseWorldTransform() const;
+        // Inverse transpose of the world transform's upper 3x3, takes normals to world space.
+        Math::Matrix3 const& GetNormalMatrix() const;
         
         Transform& SetPosition(Math::Vector3 const& pos);
         Transform& SetRotation(Math::Vector3 const& rotEuler);
+        Transform& SetRotation(Math::Quaternion const& rotation);
+        // SetRotation with the sines and cosines of MathPolicy, PreciseMath gives the same bits as SetRotation.
+        template <typename MathPolicy>
+        Transform& SetRotation(Math::Vector3 const& rotEuler)
+        {
+            return setRotation(eulerToQuaternion<MathPolicy>(rotEuler), rotEuler);
+        }
         Transform& SetScale(Math::Vector3 const& scale);
         Transform& SetScale(float uniformScale);
 
         Math::Matrix4 CalcLocalTransform();
 
+        struct InverseBenchmark
+        {
+            //per matrix, over random world transforms
+            float GeneralNanoseconds = 0.0f;
+            float AffineNanoseconds = 0.0f;
+            float TrsNanoseconds = 0.0f;
+            //GetInverseWorldTransform right after the world transform changed, and again after that
+            float UpdateNanoseconds = 0.0f;
+            float CachedNanoseconds = 0.0f;
+            //largest element of TrsInverted * matrix - identity
+            float MaxError = 0.0f;
+        };
+        /*******************************************************
+         * @brief Time Inverted, AffineInverted and TrsInverted, then
+         * the cached inverse of Transforms, on count random
+         * translate * rotate * scale matrices.
+         *******************************************************/
+        static InverseBenchmark MeasureInverse(unsigned count = 1 << 14, unsigned seed = 1);
+
+        struct RotationBenchmark
+        {
+            unsigned Objects = 0;
+            //per object and frame, local and world transform included
+            float EulerNanoseconds = 0.0f;
+            float FastEulerNanoseconds = 0.0f;
+            float QuaternionNanoseconds = 0.0f;
+            //largest difference between the two local matrices after the last frame
+            float MaxError = 0.0f;
+            //largest difference the FastMath sines and cosines make to the local matrices
+            float FastEulerError = 0.0f;
+        };
+        /*******************************************************
+         * @brief Spin count objects for frames frames, once by
+         * setting new Euler angles (6 sin/cos per update), once
+         * more with FastMath's sin/cos, and once by rotating with
+         * a quaternion (none).
+         *******************************************************/
+        static RotationBenchmark MeasureRotation(unsigned count = 100000, unsigned frames = 10, unsigned seed = 1);
+
         REGISTER_EDITOR_COMPONENT(Transform)
 		void Reflect(TwBar* editor, std::string const& barName, std::string const& groupName, Graphics::GraphicsEngine* graphics) override;
 
@@ -56,17 +120,42 @@ namespace Component
     
     private:
 
+        void updateInverse() const;
+
+        Transform& setRotation(Math::Quaternion const& rotation, Math::Vector3 const& rotEuler);
+
+        //ToQuaternion(EulerAngles(angles, EulerOrders::XYZs)) step for step, with MathPolicy's sin and cos
+        template <typename MathPolicy>
+        static Math::Quaternion eulerToQuaternion(Math::Vector3 const& angles)
+        {
+            float cosX = MathPolicy::Cos(angles.x * 0.5f), sinX = MathPolicy::Sin(angles.x * 0.5f);
+            float cosY = MathPolicy::Cos(angles.y * 0.5f), sinY = MathPolicy::Sin(angles.y * 0.5f);
+            float cosZ = MathPolicy::Cos(angles.z * 0.5f), sinZ = MathPolicy::Sin(angles.z * 0.5f);
+            float cc = cosX * cosZ, cs = cosX * sinZ;
+            float sc = sinX * cosZ, ss = sinX * sinZ;
+            return Math::Quaternion(cosY * sc - sinY * cs, cosY * ss + sinY * cc, cosY * cs - sinY * sc, cosY * cc + sinY * ss);
+        }
+
         //local position
         Math::Vector3 m_position = {0,0,0};
 
         //local rotation
-        Math::Vector3 m_rotationEuler = {0,0,0};
+        Math::Quaternion m_rotation = Math::Quaternion::c_Identity;
+
+        //m_rotation as Euler angles for the editor, converted on demand
+        mutable Math::Vector3 m_rotationEuler = {0,0,0};
+        mutable bool m_eulerDirty = false;
 
         //local scale
         Math::Vector3 m_scale = {1,1,1};
 
         Math::Matrix4 m_localTransform;
         Math::Matrix4 m_worldTransform;
+
+        //computed from m_worldTransform on first use after it changes
+        mutable Math::Matrix4 m_inverseWorldTransform;
+        mutable Math::Matrix3 m_normalMatrix;
+        mutable bool m_inverseDirty = true;
     };
 }
 
@@ -52,6 +52,41 @@ public:
              CleanUpClientCallBack cleanupCallback, void* initUserData = nullptr,
              void* updateUserData = nullptr, void* cleanupUserData = nullptr);
 
+    // Creates the GL 4.3 context without a visible window, for render tests and
+    // frame time benchmarks on machines with no GPU. The context comes from EGL
+    // when HEADLESS_EGL is set, otherwise from a hidden FreeGLUT window. Only the
+    // EGL path works without a display: the hidden window still needs a desktop
+    // session (WGL) or an X server, and HEADLESS_EGL is 0 by default. Frames are
+    // drawn to an offscreen framebuffer of width x height in place of the
+    // window's back buffer.
+    void InitializeHeadless(int argc, char* argv[], std::string const& title, unsigned width,
+                            unsigned height);
+
+    struct FrameStats
+    {
+        unsigned Frames = 0;
+        unsigned WarmupFrames = 0;
+        float TotalMilliseconds = 0.0f;
+        float AverageMilliseconds = 0.0f;
+        float MedianMilliseconds = 0.0f;
+        float P95Milliseconds = 0.0f;
+        float P99Milliseconds = 0.0f;
+        float MinMilliseconds = 0.0f;
+        float MaxMilliseconds = 0.0f;
+    };
+    // The headless counterpart of Run: calls initCallback, then updateCallback
+    // for warmupFrames + frameCount frames with a fixed time step, then
+    // cleanupCallback, and returns. There is no buffer swap, no input and no
+    // AntTweakBar. Every frame ends with glFinish so its time includes the GPU;
+    // the warmup frames are not counted. Close ends the loop early.
+    FrameStats RunHeadless(InitClientCallBack initCallback, UpdateClientCallBack updateCallback,
+                           CleanUpClientCallBack cleanupCallback, unsigned frameCount,
+                           float fixedDeltaTime, unsigned warmupFrames = 0, void* userData = nullptr);
+
+    bool IsHeadless() const { return m_headless; }
+    // The framebuffer standing in for the screen: 0, or the offscreen one when headless.
+    unsigned GetScreenFramebuffer() const { return m_screenFramebuffer; }
+
 
     static Ray GetRayFromScreenCoords(int x, int y, Math::Vector3 const& cameraPos,
         Math::Matrix4 const& cameraViewMat, Math::Matrix4 const& cameraProjectMat);
@@ -77,6 +112,10 @@ private:
     unsigned m_windowWidth = 0;
     unsigned m_windowHeight = 0;
     unsigned m_windowHandle = 0;
+    bool m_headless = false;
+    bool m_closeRequested = false;
+    unsigned m_screenFramebuffer = 0;
+    unsigned m_screenRenderbuffers[2] = { 0, 0 };
     void* m_updateCallbackData = nullptr;
     void* m_cleanupCallbackData = nullptr;
     UpdateClientCallBack m_updateCallback = nullptr;
@@ -88,6 +127,11 @@ private:
     OnMouseButtonUpCallBack m_mouseButtonUpCallBack = nullptr;
     OnMouseDragCallBack m_mouseButtonDragCallBack = nullptr;
 
+    // Color and depth-stencil renderbuffers behind an FBO the size of the window.
+    void createScreenFramebuffer();
+    // Deletes that FBO, and the EGL context if there is one.
+    void destroyHeadlessContext();
+
 
 
 
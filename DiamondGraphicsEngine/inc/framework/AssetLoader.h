@@ -0,0 +1,163 @@
+#ifndef H_ASSET_LOADER
+#define H_ASSET_LOADER
+#include "framework/Utilities.h"
+
+#include <condition_variable>
+#include <future>
+
+//lower value is loaded first
+enum class AssetPriority : u8
+{
+    High,
+    Normal,
+    Low,
+};
+
+enum class AssetLoadStatus : u8
+{
+    Queued,     //waiting for a worker
+    Loading,    //a worker runs the load function
+    Loaded,     //loaded, waiting for the main thread to finalize it
+    Done,       //finalized (or loaded when there was nothing to finalize)
+    Cancelled,
+};
+
+/*******************************************************
+ * @brief
+ * Handle to one load submitted to an AssetLoader. Copies
+ * refer to the same load. A default constructed handle is
+ * empty and reports Done.
+ *******************************************************/
+class AssetLoadHandle
+{
+    friend class AssetLoader;
+public:
+    AssetLoadHandle() = default;
+
+    AssetLoadStatus GetStatus() const;
+    std::string const& GetName() const;
+    // Loaded, finalized or cancelled, nothing left to do on any thread.
+    bool IsFinished() const;
+    /*******************************************************
+     * @brief Cancel the load if it has not started yet, or skip
+     * its finalization if it is loaded but not finalized. A load
+     * already running on a worker completes but is thrown away:
+     * it stays Loading until Load returns, then the worker marks
+     * it Cancelled, so Wait and IsFinished wait for the worker.
+     * @return true if the load will not be finalized.
+     *******************************************************/
+    bool Cancel() const;
+    // Block until a worker is done with the load, or until it is cancelled before one picked it up.
+    void Wait() const;
+
+private:
+    struct State
+    {
+        std::string Name;
+        std::atomic<AssetLoadStatus> Status{ AssetLoadStatus::Queued };
+        std::promise<void> Loaded;
+        std::shared_future<void> LoadedFuture;
+        std::atomic<bool> Signaled{ false };
+        //Cancel was called, the worker cancels a running load once Load returns
+        std::atomic<bool> CancelRequested{ false };
+        //owner's count of unfinished loads, dropped by whoever finishes the load
+        std::atomic<u32>* Outstanding = nullptr;
+        //move from one status to a final one, false if someone else got there first
+        bool finish(AssetLoadStatus from, AssetLoadStatus to);
+        void signal();
+    };
+    explicit AssetLoadHandle(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+    std::shared_ptr<State> m_state;
+};
+
+/*******************************************************
+ * @brief
+ * Bounded pool of worker threads shared by all asset loading.
+ * Work is split in two: the load function runs on a worker and
+ * must not touch GL (file I/O, decoding, preprocessing); the
+ * optional finalize function runs later on the main thread and
+ * does the GL uploads. Finalization is done in FinalizeLoaded
+ * within a time budget so a frame never drains everything that
+ * finished loading at once.
+ *
+ * Queued loads are picked by priority, then in submission order.
+ *******************************************************/
+class AssetLoader
+{
+public:
+    /*******************************************************
+     * @param workerCount Number of worker threads, 0 uses one
+     * less than the number of hardware threads (at least one) to
+     * leave a core to the main thread.
+     *******************************************************/
+    explicit AssetLoader(u32 workerCount = 0);
+    // Cancels everything queued and joins the workers.
+    ~AssetLoader();
+
+    // The pool the managers share, created on first use.
+    static AssetLoader& GetShared();
+    /*******************************************************
+     * @brief True on the worker threads of any AssetLoader. Loads
+     * already run one per worker, so work inside them should not
+     * start threads of its own (ParallelFor maxThreads 1).
+     *******************************************************/
+    static bool IsWorkerThread();
+
+    AssetLoadHandle Submit(std::string const& name, std::function<void()> load,
+        std::function<void()> finalize = nullptr, AssetPriority priority = AssetPriority::Normal);
+
+    /*******************************************************
+     * @brief Run finalizers of loaded assets on the calling (main)
+     * thread until the budget is used up. At least one finalizer
+     * runs per call so loading always makes progress.
+     * @return Number of assets finalized.
+     *******************************************************/
+    u32 FinalizeLoaded(float budgetMilliseconds);
+    // Run every pending finalizer, for blocking loads.
+    u32 FinalizeAll();
+
+    // Cancel every load that has not been finalized yet.
+    void CancelAll();
+
+    u32 GetWorkerCount() const { return static_cast<u32>(m_workers.size()); }
+    // Loads queued, loading or waiting to be finalized.
+    u32 GetOutstandingCount() const { return m_outstanding.load(); }
+
+private:
+    struct Job
+    {
+        AssetPriority Priority;
+        u64 Sequence;
+        std::shared_ptr<AssetLoadHandle::State> State;
+        std::function<void()> Load;
+        std::function<void()> Finalize;
+        //std::priority_queue pops the largest
+        bool operator<(Job const& rhs) const
+        {
+            if (Priority != rhs.Priority)
+                return Priority > rhs.Priority;
+            return Sequence > rhs.Sequence;
+        }
+    };
+    struct PendingFinalize
+    {
+        std::shared_ptr<AssetLoadHandle::State> State;
+        std::function<void()> Finalize;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::priority_queue<Job> m_jobs;
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobAvailable;
+    bool m_stopping = false;
+    u64 m_nextSequence = 0;
+
+    std::deque<PendingFinalize> m_finalizeQueue;
+    std::mutex m_finalizeMutex;
+
+    std::atomic<u32> m_outstanding{ 0 };
+};
+
+#endif
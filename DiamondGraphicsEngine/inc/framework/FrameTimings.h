@@ -0,0 +1,85 @@
+#ifndef H_FRAME_TIMINGS
+#define H_FRAME_TIMINGS
+#include "framework/Utilities.h"
+
+/*******************************************************
+ * @brief
+ * CPU time the engine's subsystems take per frame, for the
+ * benchmark runner. A section is a category ("subsystem",
+ * "pass") and a name; its time is summed over the frame, as
+ * draw submission happens in several passes, and EndFrame
+ * closes the frame. Sections can nest, "Render" holds the
+ * culling, the draw submission and the passes. Nothing is
+ * recorded unless enabled, a disabled ScopedFrameTiming costs
+ * a branch. Main thread only.
+ *******************************************************/
+class FrameTimings
+{
+public:
+    static void SetEnabled(bool enabled) { s_enabled = enabled; }
+    static bool IsEnabled() { return s_enabled; }
+
+    static void Add(char const* category, char const* name, float milliseconds);
+    // Sections not reached this frame count 0 ms.
+    static void EndFrame();
+    // Drop every recorded frame, e.g. after warming up.
+    static void Reset();
+
+    struct Summary
+    {
+        std::string Category;
+        std::string Name;
+        u32 Frames = 0;
+        float MinMilliseconds = 0.0f;
+        float MedianMilliseconds = 0.0f;
+        float P99Milliseconds = 0.0f;
+        float AverageMilliseconds = 0.0f;
+    };
+    // Per section, in the order they were first reached.
+    static std::vector<Summary> Summarize();
+    // Min, median (nearest rank), p99 and average of a set of frame times, sorts them.
+    static Summary Summarize(std::vector<float>& milliseconds);
+    // { "category": { "name": { "min": .., "median": .., "p99": .., "average": .. } } }
+    static void WriteJson(std::ostream& os, std::vector<Summary> const& summaries, std::string const& indent);
+
+private:
+    struct Section
+    {
+        std::string Category;
+        std::string Name;
+        float FrameMilliseconds = 0.0f;
+        std::vector<float> Frames;
+    };
+    static bool s_enabled;
+    static u32 s_frameCount;
+    static std::vector<Section> s_sections;
+};
+
+// Adds the time from construction to destruction to a section, if timings are enabled.
+class ScopedFrameTiming
+{
+public:
+    ScopedFrameTiming(char const* category, char const* name)
+        : m_category(FrameTimings::IsEnabled() ? category : nullptr), m_name(name)
+    {
+        if (m_category)
+            m_start = std::chrono::high_resolution_clock::now();
+    }
+    ~ScopedFrameTiming()
+    {
+        if (m_category)
+        {
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - m_start;
+            FrameTimings::Add(m_category, m_name, elapsed.count());
+        }
+    }
+    ScopedFrameTiming(ScopedFrameTiming const&) = delete;
+    ScopedFrameTiming& operator=(ScopedFrameTiming const&) = delete;
+
+private:
+    char const* m_category;
+    char const* m_name;
+    std::chrono::high_resolution_clock::time_point m_start;
+};
+
+#endif
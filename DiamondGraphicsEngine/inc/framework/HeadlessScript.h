@@ -0,0 +1,60 @@
+#ifndef H_HEADLESS_SCRIPT
+#define H_HEADLESS_SCRIPT
+#include "math/Vector3.h"
+
+/*******************************************************
+ * @brief
+ * What a headless run renders, read from a text file with
+ * one command per line; # starts a comment.
+ *
+ *   size <width> <height>
+ *   frames <count>           frames that are measured
+ *   warmup <count>           frames rendered before measuring
+ *   step <seconds>           fixed time step of every frame
+ *   camera <frame> <x> <y> <z> <rx> <ry> <rz>
+ *                            camera position and local rotation
+ *                            in radians, linear between keys
+ *   capture <frame> <path>   screen of a frame to path.png
+ *   trace <frame> <path>     the RayTracer's image of a frame
+ *                            to path.png, on the CPU
+ *   raster <frame> <path>    the SoftwareRasterizer's image of
+ *                            a frame to path.png, on the CPU
+ *   sequence <path> <step>   screen every step frames as QOI
+ *
+ * Frames count from the first measured frame, the warmup
+ * frames use the camera of frame 0.
+ *******************************************************/
+class HeadlessScript
+{
+public:
+    struct CameraKey
+    {
+        unsigned Frame = 0;
+        Math::Vector3 Position;
+        Math::Vector3 Rotation;
+    };
+    struct Capture
+    {
+        unsigned Frame = 0;
+        std::string Path;
+    };
+
+    // False, with a warning, if the file can't be read or a line is malformed.
+    bool Load(std::string const& path);
+    // Camera of a frame between the keys around it, false without keys.
+    bool SampleCamera(unsigned frame, Math::Vector3& position, Math::Vector3& rotation) const;
+
+    unsigned Width = 1280;
+    unsigned Height = 720;
+    unsigned Frames = 300;
+    unsigned WarmupFrames = 30;
+    float TimeStep = 1.0f / 60.0f;
+    std::vector<CameraKey> CameraKeys;
+    std::vector<Capture> Captures;
+    std::vector<Capture> Traces;
+    std::vector<Capture> Rasters;
+    std::string SequencePath;
+    unsigned SequenceStep = 0;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef H_PARALLEL_FOR
+#define H_PARALLEL_FOR
+#include "framework/Utilities.h"
+
+/*******************************************************
+ * @brief
+ * Split [0, count) in chunks of chunkSize and run
+ * body(begin, end) for every chunk, on the calling thread and
+ * up to hardware_concurrency - 1 helper threads which take the
+ * next chunk as soon as they are done with one. Blocks until
+ * every chunk is done.
+ *
+ * Threads are started per call, so this is meant for work of
+ * a millisecond or more (texture filtering, encoding), not for
+ * per frame loops over a few objects. It does not use the
+ * AssetLoader pool on purpose: it is called from inside asset
+ * loads and waiting on the same pool could deadlock it.
+ *******************************************************/
+template <typename TBody>
+void ParallelFor(u32 count, u32 chunkSize, TBody&& body, u32 maxThreads = 0)
+{
+    if (count == 0)
+        return;
+    chunkSize = chunkSize ? chunkSize : 1;
+    u32 chunkCount = (count + chunkSize - 1) / chunkSize;
+    u32 threadCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+    threadCount = threadCount ? threadCount : 1;
+    threadCount = threadCount < chunkCount ? threadCount : chunkCount;
+
+    std::atomic<u32> nextChunk{ 0 };
+    auto work = [&]()
+    {
+        for (u32 chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+        {
+            u32 begin = chunk * chunkSize;
+            u32 end = count - begin < chunkSize ? count : begin + chunkSize;
+            body(begin, end);
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    helpers.reserve(threadCount - 1);
+    for (u32 i = 1; i < threadCount; ++i)
+    {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (std::thread& helper : helpers)
+    {
+        helper.join();
+    }
+}
+
+#endif
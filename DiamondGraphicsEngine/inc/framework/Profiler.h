@@ -0,0 +1,103 @@
+#ifndef H_PROFILER
+#define H_PROFILER
+#include "framework/Utilities.h"
+
+/*******************************************************
+ * @brief
+ * Hierarchical CPU/GPU profiler for a timeline of the frame.
+ *
+ * PROFILE_SCOPE markers record one event (name, begin, end,
+ * depth) when the scope is left, into a ring buffer of the
+ * thread they run on. The owning thread is the only writer and
+ * never locks; the exporter reads the rings from the main
+ * thread, so a ring keeps the most recent events and the oldest
+ * are overwritten. Names must outlive the profiler: string
+ * literals, or strings from Intern.
+ *
+ * PROFILE_GPU_SCOPE wraps GL work in a GL_TIME_ELAPSED query.
+ * Those can't nest, so they go around passes only. The results
+ * are read a few frames later in EndFrame, never waiting on the
+ * GPU unless every query set is still in flight.
+ *
+ * With PROFILING 0 every macro is empty and nothing of this is
+ * compiled into the markers' callers.
+ *******************************************************/
+class Profiler
+{
+public:
+    struct Event
+    {
+        char const* Name = nullptr;
+        //nanoseconds since the profiler started
+        u64 Begin = 0;
+        u64 End = 0;
+        u32 Depth = 0;
+    };
+
+    class ScopedMarker
+    {
+    public:
+        explicit ScopedMarker(char const* name);
+        ~ScopedMarker();
+        ScopedMarker(ScopedMarker const&) = delete;
+        ScopedMarker& operator=(ScopedMarker const&) = delete;
+
+    private:
+        char const* m_name;
+        u64 m_begin;
+    };
+
+    class ScopedGpuMarker
+    {
+    public:
+        explicit ScopedGpuMarker(char const* name) { BeginGpu(name); }
+        ~ScopedGpuMarker() { EndGpu(); }
+        ScopedGpuMarker(ScopedGpuMarker const&) = delete;
+        ScopedGpuMarker& operator=(ScopedGpuMarker const&) = delete;
+    };
+
+    // Stop or resume recording, markers cost a branch while stopped.
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+    // Name of the calling thread in the trace.
+    static void SetThreadName(std::string const& name);
+    // A copy of name that lives as long as the process, for names that are not literals.
+    static char const* Intern(std::string const& name);
+
+    // Main thread, with the GL context current.
+    static void BeginGpu(char const* name);
+    static void EndGpu();
+    // Once a frame on the main thread: reads back the GPU timers of earlier frames.
+    static void EndFrame();
+    // GPU time of the last read back pass with this name, 0 if there is none.
+    static float GetGpuMilliseconds(char const* name);
+
+    /*******************************************************
+     * @brief Write the recorded events in the Chrome trace event
+     * format (chrome://tracing, Perfetto); one track per thread
+     * and one for the GPU, where the passes of a frame are laid
+     * out back to back from the time the first was submitted.
+     *******************************************************/
+    static void WriteChromeTrace(std::ostream& os);
+    static bool SaveChromeTrace(std::string const& path);
+
+    static u64 Now();
+};
+
+#if PROFILING
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) Profiler::ScopedMarker PROFILE_CONCAT(profileMarker, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_GPU_SCOPE(name) Profiler::ScopedGpuMarker PROFILE_CONCAT(profileGpuMarker, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#define PROFILE_END_FRAME() Profiler::EndFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_END_FRAME()
+#endif // PROFILING
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef H_SELF_TEST
+#define H_SELF_TEST
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    class MeshManager;
+    class MaterialManager;
+}
+
+/*******************************************************
+ * @brief
+ * Checks of the engine's CPU code, run by --selftest instead
+ * of at startup. Each Measure and Simulate routine runs once
+ * and its result is held to the reference it compares against
+ * or to the error bound its header documents; a check that
+ * does not hold prints what it found. Needs the meshes and
+ * materials Initialize loads and the assets of a normal run.
+ * Main thread only.
+ *******************************************************/
+class SelfTest
+{
+public:
+    /*******************************************************
+     * @brief Runs every check, returns how many failed.
+     * @param exhaustive Check FastMath over every float of each
+     * domain, about 45 minutes of CPU time, instead of every
+     * 257th one, about ten seconds.
+     *******************************************************/
+    static u32 Run(Graphics::MeshManager& meshManager, Graphics::MaterialManager& materialManager,
+                   bool exhaustive = false);
+
+private:
+    // Counts a check, prints it with detail if it failed.
+    static void check(bool passed, std::string const& name, std::string const& detail);
+
+    static u32 s_checks;
+    static u32 s_failed;
+};
+
+#endif
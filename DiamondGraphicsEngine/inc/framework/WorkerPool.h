@@ -0,0 +1,60 @@
+#ifndef H_WORKER_POOL
+#define H_WORKER_POOL
+#include "framework/Utilities.h"
+
+#include <condition_variable>
+
+/*******************************************************
+ * @brief
+ * ParallelFor on threads that are started once and then
+ * sleep between calls, for loops that run every frame. The
+ * caller of ParallelFor works on the chunks too, so a pool of
+ * n threads starts n - 1.
+ *
+ * One ParallelFor at a time, and not from inside a body. Like
+ * ParallelFor it is separate from the AssetLoader pool, whose
+ * workers may be busy with loads for many frames.
+ *******************************************************/
+class WorkerPool
+{
+public:
+    // threadCount counts the caller, 0 uses the number of hardware threads.
+    explicit WorkerPool(u32 threadCount = 0);
+    // Joins the threads.
+    ~WorkerPool();
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    /*******************************************************
+     * @brief Split [0, count) in chunks of chunkSize and run
+     * body(begin, end) for every chunk on the caller and the
+     * pool's threads. Blocks until every chunk is done.
+     *******************************************************/
+    void ParallelFor(u32 count, u32 chunkSize, std::function<void(u32, u32)> const& body);
+
+    u32 GetThreadCount() const { return static_cast<u32>(m_threads.size()) + 1; }
+
+private:
+    void workerLoop();
+    //takes chunks of the current call until none are left
+    void work();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    //bumped by every ParallelFor, a thread works once per value
+    u64 m_generation = 0;
+    //threads still working on the current call
+    u32 m_busy = 0;
+    bool m_stopping = false;
+
+    //the current call, set under m_mutex before m_generation is bumped
+    std::function<void(u32, u32)> const* m_body = nullptr;
+    u32 m_count = 0;
+    u32 m_chunkSize = 1;
+    u32 m_chunkCount = 0;
+    std::atomic<u32> m_nextChunk{ 0 };
+};
+
+#endif
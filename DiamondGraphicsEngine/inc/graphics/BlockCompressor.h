@@ -0,0 +1,66 @@
+#ifndef H_BLOCK_COMPRESSOR
+#define H_BLOCK_COMPRESSOR
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    enum class BlockFormat : u8
+    {
+        None,   //uncompressed 8 bit
+        BC1,    //RGB, 4 bits per pixel
+        BC3,    //RGBA, BC1 color plus a BC4 alpha block, 8 bits per pixel
+        BC5,    //two BC4 channels (RG), for normal maps, 8 bits per pixel
+        BC7,    //RGBA, high quality, 8 bits per pixel
+    };
+
+    /*******************************************************
+     * @brief
+     * CPU encoder (and reference decoder) for the block compressed
+     * texture formats, so textures take a quarter to an eighth of
+     * the video memory of plain RGB8/RGBA8.
+     *
+     * Every 4x4 block is fitted along the principal axis of its
+     * colors, then refined once by least squares. Palette searches
+     * test four pixels (or four palette entries) per SSE
+     * instruction and the image is split in rows of blocks over
+     * all cores. BC7 only uses mode 6 (one subset, RGBA endpoints
+     * with p-bits, 16 levels), which is the best single mode for
+     * smooth color blocks and keeps the encoder fast.
+     *******************************************************/
+    class BlockCompressor
+    {
+    public:
+        // Bytes per 4x4 block, 0 for None.
+        static u32 GetBlockBytes(BlockFormat format);
+        // Size of one compressed image, partial blocks at the borders included.
+        static u32 GetCompressedSize(BlockFormat format, u32 width, u32 height);
+
+        /*******************************************************
+         * @brief Compress an 8 bit image.
+         * @param channels 3 (alpha is 255) or 4. BC5 takes the first two.
+         *******************************************************/
+        static std::vector<u8> Compress(u8 const* pixels, u32 width, u32 height, u8 channels, BlockFormat format);
+        // Decode back to RGBA8, BC5 leaves blue 0 and alpha 255.
+        static std::vector<u8> Decompress(u8 const* blocks, u32 width, u32 height, BlockFormat format);
+
+        /*******************************************************
+         * @brief Peak signal to noise ratio in dB over the first
+         * compareChannels channels of the source.
+         *******************************************************/
+        static float ComputePSNR(u8 const* pixels, u8 channels, u8 const* decodedRGBA, u32 width, u32 height, u8 compareChannels);
+
+        struct Benchmark
+        {
+            BlockFormat Format = BlockFormat::None;
+            u32 Width = 0;
+            u32 Height = 0;
+            float Milliseconds = 0.0f;
+            float MegaPixelsPerSecond = 0.0f;
+            float PSNR = 0.0f;
+        };
+        // Time compression of one image and measure its quality.
+        static Benchmark Measure(u8 const* pixels, u32 width, u32 height, u8 channels, BlockFormat format);
+    };
+}
+
+#endif
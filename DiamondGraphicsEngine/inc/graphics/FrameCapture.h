@@ -0,0 +1,109 @@
+#ifndef H_FRAME_CAPTURE
+#define H_FRAME_CAPTURE
+#include "framework/Utilities.h"
+#include "framework/AssetLoader.h"
+#include "graphics/ImageEncoder.h"
+
+namespace Graphics
+{
+    class Texture;
+
+    /*******************************************************
+     * @brief
+     * Captures textures and the screen to image files without
+     * stalling the frame. A capture only queues a copy into a
+     * pixel buffer object with a fence behind it; Update picks up
+     * the buffers the GPU is done with a few frames later, and
+     * the images are encoded and written on the AssetLoader
+     * workers. The buffers are used as a ring, a capture only
+     * waits for the GPU when every buffer is still in flight.
+     *
+     * WriteImage takes pixels that are already on the CPU, it
+     * makes no GL calls and works without a context (headless).
+     *******************************************************/
+    class FrameCapture
+    {
+    public:
+        // No GL calls, the buffers are made on the first capture.
+        explicit FrameCapture(u32 bufferCount = 3);
+        // Finishes every capture still in flight.
+        ~FrameCapture();
+
+        // Capture level 0 of a built texture, path gets the extension of the format.
+        void CaptureTexture(Texture const& texture, std::string const& path, ImageFormat format = ImageFormat::PNG);
+        // Capture the RGB back buffer of the screen (the offscreen one when headless) as it is now.
+        void CaptureScreen(u32 width, u32 height, std::string const& path, ImageFormat format = ImageFormat::PNG);
+        // Encode and write pixels on a worker, the first row is the top one unless bottomUp.
+        AssetLoadHandle WriteImage(std::vector<u8> pixels, u32 width, u32 height, u8 channels, std::string const& path,
+                                   ImageFormat format = ImageFormat::PNG, bool bottomUp = false);
+
+        /*******************************************************
+         * @brief Capture the screen every frameStep frames, to
+         * pathPrefix_00000.ext and on, from the next EndFrame on.
+         *******************************************************/
+        void StartSequence(std::string const& pathPrefix, ImageFormat format = ImageFormat::QOI, u32 frameStep = 1);
+        void StopSequence();
+        bool IsCapturingSequence() const { return m_sequenceStep > 0; }
+
+        // Once a frame on the main thread after drawing: captures the sequence frame, then Update.
+        void EndFrame(u32 width, u32 height);
+        // Hand the readbacks the GPU is done with to the workers, never waits for the GPU.
+        void Update();
+        // Wait until every capture is read back and written, e.g. before comparing the images.
+        void Flush();
+
+        // Readbacks queued on the GPU plus images not written yet.
+        u32 GetPendingCount() const;
+
+        struct Stats
+        {
+            u32 Captures = 0;
+            u32 Written = 0;
+            u32 Failed = 0;
+            //captures that found every buffer in flight and waited for the GPU
+            u32 Stalls = 0;
+            //main thread time spent mapping the buffers and copying the pixels out
+            float ReadbackMilliseconds = 0.0f;
+        };
+        Stats GetStats() const;
+
+    private:
+        struct Slot
+        {
+            GLuint Buffer = 0;
+            GLsync Fence = nullptr;
+            size_t Capacity = 0;
+            u32 Width = 0;
+            u32 Height = 0;
+            u8 Channels = 3;
+            ImageFormat Format = ImageFormat::PNG;
+            std::string Path;
+            //order the captures were queued in, the oldest is waited for first
+            u64 Sequence = 0;
+        };
+
+        // A free buffer of at least size bytes bound to GL_PIXEL_PACK_BUFFER, waits for the oldest if none is free.
+        Slot& acquireSlot(size_t size);
+        // Fence the copy just queued into slot.
+        void submitSlot(Slot& slot, u32 width, u32 height, u8 channels, std::string const& path, ImageFormat format);
+        // Copy the pixels out of a finished slot and hand them to a worker.
+        void readSlot(Slot& slot);
+
+        std::vector<Slot> m_slots;
+        u64 m_nextSequence = 0;
+        std::vector<AssetLoadHandle> m_writes;
+
+        std::string m_sequencePrefix;
+        ImageFormat m_sequenceFormat = ImageFormat::QOI;
+        u32 m_sequenceStep = 0;
+        u32 m_sequenceFrame = 0;
+        u32 m_sequenceIndex = 0;
+
+        Stats m_stats;
+        //written and failed are counted on the workers
+        std::shared_ptr<std::atomic<u32> > m_written;
+        std::shared_ptr<std::atomic<u32> > m_failed;
+    };
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef H_FRAME_GRAPH
+#define H_FRAME_GRAPH
+
+#include "graphics/FramebufferManager.h"
+#include "graphics/RenderTargetPool.h"
+#include "framework/Profiler.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief
+     * Declarative description of a frame. Passes say which framebuffers
+     * they read and which one they render to, Compile() works out the
+     * rest: passes nobody depends on are culled, the survivors are put in
+     * dependency order, every framebuffer gets a lifetime for the render
+     * target pool, and clears/barriers are placed only where needed.
+     * FramebufferType::Screen is the output of the frame; a pass writing
+     * it is always kept.
+     *
+     * Compile() is pure CPU work, only Execute() touches GL (through the
+     * FramebufferManager).
+     *******************************************************/
+    class FrameGraph
+    {
+    public:
+        class Pass
+        {
+        public:
+            Pass(std::string const& name, std::function<void()> const& execute)
+                : m_name(name), m_execute(execute)
+            {
+#if PROFILING
+                m_profileName = Profiler::Intern(name);
+#endif // PROFILING
+            }
+
+            // This pass samples the framebuffer.
+            Pass& Read(FramebufferType type);
+            // This pass renders to the framebuffer. clear=false is for passes that
+            // overwrite every pixel (or the screen, which is cleared by the engine).
+            Pass& Write(FramebufferType type, bool clear = true);
+
+            std::string const& GetName() const { return m_name; }
+            std::vector<FramebufferType> const& GetReads() const { return m_reads; }
+            FramebufferType GetTarget() const { return m_target; }
+            bool HasTarget() const { return m_hasTarget; }
+            bool ClearsTarget() const { return m_clearTarget; }
+
+        private:
+            friend class FrameGraph;
+            std::string m_name;
+            std::function<void()> m_execute;
+            std::vector<FramebufferType> m_reads;
+            FramebufferType m_target = FramebufferType::Screen;
+            bool m_hasTarget = false;
+            bool m_clearTarget = false;
+#if PROFILING
+            //outlives the graph, profiled events are kept after it is rebuilt
+            char const* m_profileName = nullptr;
+#endif // PROFILING
+        };
+
+        struct ScheduledPass
+        {
+            u32 PassIndex;
+            bool Clear;
+            //framebuffers that are sampled here for the first time after being written
+            std::vector<FramebufferType> Barriers;
+        };
+
+        // Declare a pooled framebuffer the passes can use.
+        void DeclareResource(FramebufferType type, RenderTargetDesc const& desc);
+        Pass& AddPass(std::string const& name, std::function<void()> const& execute);
+        // Forget every pass and resource.
+        void Reset();
+
+        /*******************************************************
+         * @brief Cull, sort and schedule the declared passes.
+         * @return false if the passes have a cycle or use undeclared resources.
+         *******************************************************/
+        bool Compile();
+
+        /*******************************************************
+         * @brief Run the compiled schedule: bind each pass target (only when
+         * it changes), clear where scheduled and call the pass.
+         *******************************************************/
+        void Execute(FramebufferManager& framebufferManager) const;
+
+        std::vector<ScheduledPass> const& GetSchedule() const { return m_schedule; }
+        std::vector<u32> const& GetCulledPasses() const { return m_culled; }
+        std::vector<Pass> const& GetPasses() const { return m_passes; }
+
+        // Lifetimes of every live resource, in schedule indices, ready for
+        // FramebufferManager::RegisterTransientFramebuffer.
+        std::vector<std::pair<FramebufferType, RenderTargetRequest>> const& GetResourceLifetimes() const { return m_lifetimes; }
+
+        void PrintSchedule(std::ostream& os) const;
+
+        static char const* GetResourceName(FramebufferType type);
+
+    private:
+        std::vector<Pass> m_passes;
+        std::unordered_map<FramebufferType, RenderTargetDesc> m_resources;
+
+        std::vector<ScheduledPass> m_schedule;
+        std::vector<u32> m_culled;
+        std::vector<std::pair<FramebufferType, RenderTargetRequest>> m_lifetimes;
+    };
+}
+
+#endif
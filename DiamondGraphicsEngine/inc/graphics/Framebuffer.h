@@ -38,7 +38,10 @@ namespace Graphics
     {
         FBO_USAGE_REGULAR,
         FBO_USAGE_FLOAT_BUFFER,
-        FBO_USAGE_DEPTH_BUFFER,        
+        FBO_USAGE_DEPTH_BUFFER,
+        //G-buffer without the world position target and with packed
+        //normal/spec power, see GBufferPacking.h for the layout
+        FBO_USAGE_COMPACT_GBUFFER,
     };
 
 
@@ -58,6 +61,8 @@ namespace Graphics
 
         void Resize(u32 width, u32 height, bool depthOnly);
         void Build(FBO_USAGE usage);
+        FBO_USAGE GetUsage() const { return m_usage; }
+        bool IsCompactGBuffer() const { return m_usage == FBO_USAGE_COMPACT_GBUFFER; }
         //void BuildSsaoBuffer();
         void Bind(); // bind for rendering
         void Clear();
@@ -78,6 +83,8 @@ namespace Graphics
         Framebuffer* BindSSAOTexture(const std::shared_ptr<ShaderProgram>& shaderProgram);
 
     private:
+        std::shared_ptr<Texture> createAttachmentTexture() const;
+        void buildGBufferDepth();
 
         u32 m_width, m_height;
         GLuint m_fbo = 0;
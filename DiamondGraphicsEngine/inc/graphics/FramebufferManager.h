@@ -2,6 +2,7 @@
 #define H_FRAMEBUFFER_MANAGER
 
 #include "graphics/Color.h"
+#include "graphics/RenderTargetPool.h"
 
 class Application;
 
@@ -63,6 +64,49 @@ namespace Graphics
         // Convenience method for clearing a specific framebuffer. Must be bound.
         void Clear(FramebufferType type) const;
 
+        /*******************************************************
+         * @brief Declare a pooled framebuffer. Nothing is allocated until
+         * BuildTransientFramebuffers, which may alias it with other
+         * transient framebuffers whose lifetimes do not overlap. After
+         * that it is retrieved with GetFramebuffer(type) as usual.
+         * @param type Key of the framebuffer.
+         * @param desc Format and (screen relative) size.
+         * @param firstUse Index of the first pass writing it.
+         * @param lastUse Index of the last pass reading it.
+         *******************************************************/
+        void RegisterTransientFramebuffer(FramebufferType type,
+            RenderTargetDesc const& desc, u32 firstUse, u32 lastUse);
+
+        /*******************************************************
+         * @brief Drop every transient declaration. Their framebuffers stay
+         * around for reuse by the next BuildTransientFramebuffers.
+         *******************************************************/
+        void ResetTransientFramebuffers();
+
+        /*******************************************************
+         * @brief Plan and allocate every transient framebuffer at the
+         * current screen size. Physical framebuffers that already
+         * match are kept as they are.
+         *******************************************************/
+        void BuildTransientFramebuffers();
+
+        /*******************************************************
+         * @brief Record a new screen size. Screen relative targets are
+         * not touched until the size has stopped changing, see BeginFrame.
+         *******************************************************/
+        void RequestResize(u32 width, u32 height);
+
+        /*******************************************************
+         * @brief Call once per frame before rendering. Rebuilds the
+         * transient framebuffers once no resize was requested for
+         * ResizeSettleFrames frames.
+         *******************************************************/
+        void BeginFrame();
+
+        RenderTargetPlan const& GetTransientPlan() const { return m_transientPlan; }
+
+        static const u32 ResizeSettleFrames = 2;
+
     private:
 
         // Disallow copying of this object.
@@ -72,6 +116,14 @@ namespace Graphics
         Application* m_application; // used to track screen's dimensions
         Color m_screenClearColor;
         std::unordered_map<FramebufferType, std::shared_ptr<Framebuffer>> m_framebuffers;
+
+        std::vector<std::pair<FramebufferType, RenderTargetRequest>> m_transientRequests;
+        std::vector<std::shared_ptr<Framebuffer>> m_transientTargets;
+        RenderTargetPlan m_transientPlan;
+        u32 m_transientWidth = 0, m_transientHeight = 0;
+        u32 m_pendingWidth = 0, m_pendingHeight = 0;
+        u32 m_framesSinceResize = 0;
+        bool m_resizePending = false;
     };
 }
 
@@ -0,0 +1,90 @@
+#ifndef H_FRUSTUM_CULLER
+#define H_FRUSTUM_CULLER
+
+#include "core/BoundingVolume.h"
+#include "framework/Utilities.h"
+#include "math/Matrix4.h"
+#include "math/Vector4.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief Six world space planes (xyz normal pointing
+     * inwards, w distance) extracted from a view projection
+     * matrix, in the order left, right, bottom, top, near, far.
+     *******************************************************/
+    struct Frustum
+    {
+        Frustum() = default;
+        explicit Frustum(Math::Matrix4 const& viewProj);
+
+        bool IntersectsSphere(Math::Vector3 const& center, float radius) const;
+
+        Math::Vector4 Planes[6];
+    };
+
+    struct CullStats
+    {
+        u32 Tested = 0;
+        u32 Visible = 0;
+        u32 Culled = 0;
+        float Milliseconds = 0.0f;
+    };
+
+    /*******************************************************
+     * @brief
+     * World space bounding spheres of every object, stored as
+     * structure of arrays and indexed by ObjectId, so one SSE
+     * instruction tests four spheres against a plane (eight with
+     * AVX when the build enables it). Scene keeps the spheres up
+     * to date whenever it writes a world transform.
+     *
+     * Objects without a mesh are registered as always visible,
+     * ids that were never registered are always culled.
+     *******************************************************/
+    class FrustumCuller
+    {
+    public:
+        void SetSphere(ObjectId id, BoundingSphere const& worldSphere);
+        void SetAlwaysVisible(ObjectId id);
+        void Clear();
+        u32 GetCount() const { return m_count; }
+        BoundingSphere GetSphere(ObjectId id) const;
+        bool IsAlwaysVisible(ObjectId id) const;
+
+        /*******************************************************
+         * @brief Test every sphere against the frustum.
+         * @param visible Ids of the visible objects, in id order.
+         * @param visibleMask Set to 1 for visible ids, 0 otherwise,
+         * indexed by ObjectId so the render stage can filter its
+         * per shader lists without a lookup.
+         *******************************************************/
+        CullStats Cull(Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const;
+        // Same test one sphere at a time, kept as reference for the SIMD path.
+        CullStats CullScalar(Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const;
+
+        struct Benchmark
+        {
+            u32 ObjectCount = 0;
+            u32 Visible = 0;
+            float ScalarMilliseconds = 0.0f;
+            float SimdMilliseconds = 0.0f;
+            //the SIMD and scalar paths found the same objects visible
+            bool ResultsMatch = true;
+        };
+        // Time culling of objectCount random spheres scattered around the frustum.
+        static Benchmark MeasureCullTime(Math::Matrix4 const& viewProj, u32 objectCount = 100000);
+
+    private:
+        void reserve(ObjectId id);
+
+        //padded to a multiple of the SIMD width, padding never passes the test
+        std::vector<float> m_centerX;
+        std::vector<float> m_centerY;
+        std::vector<float> m_centerZ;
+        std::vector<float> m_radius;
+        u32 m_count = 0;
+    };
+}
+
+#endif
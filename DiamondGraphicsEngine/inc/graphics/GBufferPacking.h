@@ -0,0 +1,87 @@
+#ifndef H_GBUFFER_PACKING
+#define H_GBUFFER_PACKING
+
+#include "framework/Utilities.h"
+#include "math/Vector2.h"
+#include "math/Vector3.h"
+#include "math/Matrix4.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief
+     * CPU mirror of assets/shaders/GBufferPacking.glsl. The compact
+     * G-buffer (FBO_USAGE_COMPACT_GBUFFER) stores:
+     *   DiffuseColor_TexU        RGBA8 : diffuse.rgb, receive light flag
+     *   WorldPosition_TexV       none  : rebuilt from depth
+     *   WorldNormal_ReceiveLight RG16  : octahedral encoded normal
+     *   SpecColor_SpecPow        RGBA8 : specular.rgb, encoded spec power
+     * Any change to the encodings here must be made in the shader
+     * include as well, the two are expected to match bit for bit.
+     *******************************************************/
+    namespace GBufferPacking
+    {
+        //spec power is stored as log2(pow)/SpecularPowerLog2Max in 8 bits,
+        //which covers exponents 1-2048 with ~3% relative step.
+        const float SpecularPowerLog2Max = 11.0f;
+
+        //unit normal -> [0,1]^2, what gets written to the RG16 target
+        Math::Vector2 EncodeOctahedral(Math::Vector3 const& normal);
+        //[0,1]^2 -> unit normal
+        Math::Vector3 DecodeOctahedral(Math::Vector2 const& encoded);
+
+        float EncodeSpecularPower(float specularPower);
+        float DecodeSpecularPower(float encoded);
+
+        //round trip through an unsigned normalized target of the given bit depth
+        float QuantizeUnorm(float value, u32 bits);
+
+        //how a depth attachment stores window space depth
+        enum class DepthStorage
+        {
+            Unorm24, //GL_DEPTH_COMPONENT24, GL_DEPTH24_STENCIL8
+            Float32, //GL_DEPTH_COMPONENT32F, what the compact G-buffer uses
+        };
+
+        //round trip of an exact window space depth through the attachment
+        float QuantizeDepth(double depth, DepthStorage storage);
+
+        /*******************************************************
+         * @brief Rebuild world position from a depth buffer sample.
+         * @param inverseViewProj Inverse of the camera view projection matrix.
+         * @param uv Screen uv in [0,1].
+         * @param depth Window space depth in [0,1].
+         *******************************************************/
+        Math::Vector3 ReconstructWorldPosition(Math::Matrix4 const& inverseViewProj,
+                                               Math::Vector2 const& uv, float depth);
+
+        struct PrecisionReport
+        {
+            float MaxNormalErrorDegrees = 0;
+            float MaxSpecularPowerRelativeError = 0;
+            float MaxPositionError = 0;
+            //largest position error over what the depth storage allows at that
+            //distance, above 1 means the reconstruction loses more than the format
+            float MaxPositionErrorRatio = 0;
+        };
+
+        /*******************************************************
+         * @brief Runs every encoding through the same quantization the
+         * GPU targets apply and reports the worst error found.
+         * Positions are points from nearPlane to farPlane along the pixel
+         * rays, stored in the depth attachment and rebuilt. Their bound is
+         * half a depth step of the storage at the point, carried through the
+         * perspective divide: dz = dd * (far - near) * z^2 / (far * near).
+         * @param viewProj Camera matrix used for the position round trip.
+         * @param nearPlane Near plane of viewProj.
+         * @param farPlane Far plane of viewProj.
+         * @param depthStorage How the depth attachment stores depth.
+         * @param samplesPerAxis Grid resolution of the sweep.
+         *******************************************************/
+        PrecisionReport MeasurePrecision(Math::Matrix4 const& viewProj, float nearPlane, float farPlane,
+                                         DepthStorage depthStorage = DepthStorage::Float32,
+                                         u32 samplesPerAxis = 64);
+    }
+}
+
+#endif
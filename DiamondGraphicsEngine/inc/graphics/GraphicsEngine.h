@@ -3,6 +3,10 @@
 #include "graphics/Shader.h"
 #include "core/Object.h"
 #include "math/Matrix4.h"
+#include "graphics/Framebuffer.h"
+#include "graphics/FrameGraph.h"
+#include "graphics/FrustumCuller.h"
+#include "graphics/OcclusionCuller.h"
 
 class ComponentInterface;
 class Scene;
@@ -16,11 +20,39 @@ namespace Graphics
     class ShaderManager;
     class TextureManager;
     class FramebufferManager;
+    class FrameCapture;
+    class RenderDevice;
+
     class GraphicsEngine
     {
     public:
         void Initialize();
         void RenderScene(Scene* scene);
+        /*******************************************************
+         * @brief Draw the scene with a device instead of GL, every
+         * mesh of every visible Renderer with the forward shading.
+         * Culls with the view camera as RenderScene does, the
+         * culling results are kept in CameraCulling.
+         * @param device Gets one whole frame at the window size.
+         *******************************************************/
+        void RenderScene(Scene* scene, RenderDevice& device);
+        /*******************************************************
+         * @brief Start rasterizing the occluders, the objects whose
+         * Renderer is marked with SetOccluder, on worker threads.
+         * The frame's culling waits for it. Called before the scene
+         * update the two overlap, but the buffer then has the last
+         * frame's camera and transforms, so what they uncover shows
+         * up one frame late. Otherwise culling starts it itself.
+         * Does nothing while occlusion or frustum culling is off.
+         *******************************************************/
+        void BeginOcclusionCulling(Scene* scene);
+        /*******************************************************
+         * @brief Build the deferred frame graph and the pooled
+         * framebuffers it renders to.
+         * @param gbufferUsage FBO_USAGE_REGULAR or FBO_USAGE_COMPACT_GBUFFER.
+         *******************************************************/
+        void RegisterDeferredFramebuffers(FBO_USAGE gbufferUsage);
+        FrameGraph const& GetDeferredFrameGraph() const { return m_deferredGraph; }
 
         CameraBase* GetViewCamera() const { return m_viewCamera; }
 
@@ -30,6 +62,8 @@ namespace Graphics
         std::shared_ptr<MaterialManager>    GetMaterialManager()    const { return m_materialManager; }
         std::shared_ptr<MeshManager>        GetMeshManager()        const { return m_meshManager; }
         std::shared_ptr<FramebufferManager> GetFrameBufferManager() const { return m_frameBufferManager; }
+        // Screenshots and render target dumps, read back and written without stalling the frame.
+        std::shared_ptr<FrameCapture>       GetFrameCapture()       const { return m_frameCapture; }
         Color GetBackgroundColor() const { return m_backgroundColor; }
         /*******************************************************
          * @brief This sets a camera to be a view camera. It can be derived from
@@ -52,8 +86,17 @@ namespace Graphics
             int EnableBlur = 0;
             int BlurStrength = 0;
             int EnableSSAO = 1;
+            int EnableFrustumCulling = 1;
+            //needs EnableFrustumCulling, only the camera's objects are tested
+            int EnableOcclusionCulling = 1;
         }DebugRenderUniform;
 
+        //objects drawn for the camera and objects rendered into the shadow map, last frame
+        CullStats CameraCulling;
+        CullStats ShadowCulling;
+        //of the objects left after CameraCulling, and its cost
+        OcclusionCuller::FrameStats OcclusionCulling;
+
         struct
         {
             Math::Vec2 ControlVariable = {5,5};
@@ -66,8 +109,23 @@ namespace Graphics
 
     private:
         void renderScene(Scene* scene);
-        void forwardRender(const std::shared_ptr<Shader>& shader, std::unordered_map<ObjectId, RenderObject*>& obj);
-        void deferredRender(const std::shared_ptr<Shader>& shader, std::unordered_map<ObjectId, RenderObject*>& obj);
+        //test the camera's visible objects against the occluders, after frustum culling
+        void cullOccluded(Scene* scene);
+        //the occluders are only rasterized when both are on
+        bool isOcclusionCullingEnabled() const;
+        void forwardRender(const std::shared_ptr<Shader>& shader, std::vector<RenderObject*> const& obj);
+        void deferredRender(const std::shared_ptr<Shader>& shader, std::vector<RenderObject*> const& obj,
+                            std::vector<RenderObject*> const& shadowCasters);
+        void buildDeferredGraph();
+        //set the shader parameters of every object and draw it
+        void drawObjects(std::shared_ptr<ShaderProgram> const& program, std::vector<RenderObject*> const& obj);
+        //deferred passes, run by m_deferredGraph with their target already bound
+        void passGBuffer();
+        void passGenSSAO();
+        void passGenShadowMap();
+        void passBlurSSAO(FramebufferType source, FramebufferType target, bool horizontal);
+        void passBlurShadowMap(FramebufferType source, FramebufferType target, bool horizontal);
+        void passFinal();
 
         Color m_backgroundColor;
         CameraBase* m_viewCamera = nullptr;
@@ -79,6 +137,26 @@ namespace Graphics
         std::shared_ptr<MaterialManager>        m_materialManager;
         std::shared_ptr<MeshManager>            m_meshManager;
         std::shared_ptr<FramebufferManager>     m_frameBufferManager;
+        std::shared_ptr<FrameCapture>           m_frameCapture;
+
+        //culling results, indexed by ObjectId
+        std::vector<ObjectId> m_visibleObjects;
+        std::vector<u8> m_cameraVisibleMask;
+        std::vector<u8> m_shadowVisibleMask;
+        OcclusionCuller m_occlusionCuller;
+        //visible objects of the shader being rendered
+        std::vector<RenderObject*> m_renderList;
+        std::vector<RenderObject*> m_shadowCasterList;
+
+        FrameGraph m_deferredGraph;
+        FBO_USAGE m_gbufferUsage = FBO_USAGE_REGULAR;
+        int m_deferredGraphSSAO = -1;//EnableSSAO the graph was compiled with
+        //state of the deferredRender call the passes are running for
+        std::shared_ptr<Shader> m_deferredShader;
+        std::vector<RenderObject*> const* m_deferredObjects = nullptr;
+        std::vector<RenderObject*> const* m_deferredShadowCasters = nullptr;
+        int m_deferredCompactGBuffer = 0;
+        Math::Matrix4 m_deferredInverseViewProj;
     };
 }
 
@@ -0,0 +1,64 @@
+#ifndef H_IMAGE_ENCODER
+#define H_IMAGE_ENCODER
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    enum class ImageFormat : u8
+    {
+        PNG,    //smallest files, slowest to encode
+        QOI,    //lossless, a few times faster to encode than PNG
+        Raw,    //binary PPM (RGB) or PAM (RGBA), nothing to encode
+    };
+
+    /*******************************************************
+     * @brief
+     * Encodes 8 bit RGB and RGBA images to files. Pure CPU code
+     * without GL calls, so it runs on worker threads and without
+     * a GL context. Images read back from GL are bottom up; they
+     * are flipped while encoding instead of in a separate pass.
+     *******************************************************/
+    class ImageEncoder
+    {
+    public:
+        // File extension of a format, without the dot.
+        static char const* GetExtension(ImageFormat format, u8 channels);
+
+        /*******************************************************
+         * @brief Encode an image to the bytes of a file.
+         * @param channels 3 or 4.
+         * @param bottomUp The first row of pixels is the bottom one.
+         *******************************************************/
+        static std::vector<u8> Encode(u8 const* pixels, u32 width, u32 height, u8 channels, ImageFormat format,
+                                      bool bottomUp = false);
+        // Encode and write, false if the file can't be written.
+        static bool WriteFile(std::string const& path, u8 const* pixels, u32 width, u32 height, u8 channels,
+                              ImageFormat format, bool bottomUp = false);
+        // Decode a QOI file, to check captures and the encoder.
+        static bool DecodeQOI(u8 const* bytes, size_t size, std::vector<u8>& pixels, u32& width, u32& height, u8& channels);
+
+        struct Benchmark
+        {
+            ImageFormat Format = ImageFormat::PNG;
+            u32 Width = 0;
+            u32 Height = 0;
+            u64 Bytes = 0;
+            float Milliseconds = 0.0f;
+            float MegaPixelsPerSecond = 0.0f;
+            //QOI only: decodes back to the same pixels
+            bool RoundTrip = true;
+        };
+        /*******************************************************
+         * @brief Encode a synthetic frame (smooth gradients, flat
+         * areas and noise, like a rendered G-buffer) in memory.
+         *******************************************************/
+        static Benchmark Measure(u32 width, u32 height, u8 channels, ImageFormat format, u32 seed = 1);
+
+    private:
+        static std::vector<u8> encodeQOI(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp);
+        static std::vector<u8> encodeRaw(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp);
+        static std::vector<u8> encodePNG(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp);
+    };
+}
+
+#endif
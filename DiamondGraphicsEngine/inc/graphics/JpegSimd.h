@@ -0,0 +1,33 @@
+#ifndef H_JPEG_SIMD
+#define H_JPEG_SIMD
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief
+     * SSE2 versions of the two hottest stages of the stb_image JPEG
+     * decoder, installed through its STBI_SIMD hooks (see
+     * Texture::LoadFromFile). Both follow the integer math of the
+     * scalar code step by step, so decoded images are the same bit
+     * for bit; they only do eight pixels per instruction.
+     *******************************************************/
+    class JpegSimd
+    {
+    public:
+        /*******************************************************
+         * @brief Dequantize and inverse DCT one 8x8 block to 8 bit.
+         * @param out Top left pixel of the block, rows outStride apart.
+         * @param data Quantized coefficients in natural order.
+         * @param dequantize Quantization table of the component.
+         *******************************************************/
+        static void Idct8x8(u8* out, int outStride, short data[64], unsigned short* dequantize);
+        /*******************************************************
+         * @brief Convert a row of YCbCr samples to RGB.
+         * @param step Bytes between output pixels, 3 or 4 (alpha is 255).
+         *******************************************************/
+        static void YCbCrToRgbRow(u8* out, u8 const* y, u8 const* cb, u8 const* cr, int count, int step);
+    };
+}
+
+#endif
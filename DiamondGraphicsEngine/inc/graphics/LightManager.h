@@ -105,6 +105,8 @@ namespace Graphics
     public:
         static LightAttributeHandle GetNewLightAttribute();
         static void DeleteLightAttribute(LightAttributeHandle attr);
+        // Every light in the scene, active or not, for CPU renderers.
+        static std::list<LightAttribute> const& GetLightAttributes() { return m_lightAttribtues; }
         void SetLightsUniform(std::shared_ptr<ShaderProgram> shader);
         void SetLightShadowUniforms(std::shared_ptr<ShaderProgram> shader);
         void SetShadowFilterUniforms(std::shared_ptr<ShaderProgram> shader);
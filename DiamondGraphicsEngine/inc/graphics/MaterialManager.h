@@ -1,10 +1,12 @@
 #pragma once
-
+#include "graphics/MaterialTable.h"
 
 namespace Graphics
 {
     class GraphicsEngine;
     class Material;
+    class ShaderProgram;
+    class TextureManager;
 
 	/*******************************************************************
      * @brief A simple manager to hold all the materials in the engine.
@@ -12,6 +14,9 @@ namespace Graphics
     class MaterialManager
     {
     public:
+        MaterialManager() = default;
+        ~MaterialManager();
+
 	    /*******************************************************************
          * @brief Load all materials in one file.
          * @param fileName Relative mtl file name in Asset/materials/.
@@ -32,6 +37,29 @@ namespace Graphics
          * @note Use vector to be editor friendly.
          *******************************************************/
         std::vector<std::shared_ptr<Material> > GetAllMaterials() const;
+
+        /*******************************************************
+         * @brief Draw materials through the material table: their
+         * parameters are read from a shader storage buffer and their
+         * textures from texture arrays, so a draw only sets the
+         * MaterialIndex uniform. Materials with a texture no array
+         * can hold keep setting uniforms and binding textures.
+         *******************************************************/
+        void SetMaterialTableEnabled(bool enabled, TextureManager& textureManager);
+        bool IsMaterialTableEnabled() const { return m_tableEnabled; }
+        /*******************************************************
+         * @brief Pack every material into the table and upload it, once
+         * per frame before drawing. Does nothing unless a material
+         * changed (see Material::GetVersion), one was added or a
+         * texture got or changed its array layer.
+         *******************************************************/
+        void UpdateMaterialTable(TextureManager& textureManager);
+        // Bind the table and the texture arrays for a program, once per pass.
+        void BindMaterialTable(std::shared_ptr<ShaderProgram> const& program, TextureManager const& textureManager) const;
+        MaterialTable const& GetMaterialTable() const { return m_table; }
+
+        //binding point of the table in MaterialTable.glsl
+        static u32 const MaterialTableBinding = 3;
     private:
         /*******************************************************
          * @brief This is the helper function to put the material in the container to avoid 
@@ -41,6 +69,18 @@ namespace Graphics
          *******************************************************/
         void emplaceMaterial(std::string const& matName, std::shared_ptr<Material> material);
         std::unordered_map<std::string/*name*/, std::shared_ptr<Material> > m_materials;
+
+        bool m_tableEnabled = false;
+        //a material was added or the table turned on
+        bool m_tableDirty = true;
+        //TextureManager::GetTextureArrayVersion when the table was filled
+        u32 m_tableArrayVersion = 0;
+        MaterialTable m_table;
+        //the table as last uploaded
+        std::vector<u8> m_tableBytes;
+        u32 m_tableBuffer = 0;
+        //size of the buffer's storage, updated in place while the table fits
+        size_t m_tableBufferBytes = 0;
     };
 
 
@@ -0,0 +1,172 @@
+#ifndef H_MATERIAL_TABLE
+#define H_MATERIAL_TABLE
+#include "framework/Utilities.h"
+#include "graphics/Color.h"
+
+namespace Graphics
+{
+    //textures share a texture array when all of these match, for streamed
+    //textures those of all their levels, so streaming never moves them
+    struct TextureArrayKey
+    {
+        u32 Width = 0;
+        u32 Height = 0;
+        u32 Levels = 1;
+        u32 Format = 0;     //sized GL internal format, see Texture::GetStorageFormat
+
+        bool operator==(TextureArrayKey const& rhs) const
+        {
+            return Width == rhs.Width && Height == rhs.Height && Levels == rhs.Levels && Format == rhs.Format;
+        }
+        bool operator!=(TextureArrayKey const& rhs) const { return !(*this == rhs); }
+    };
+
+    //where a texture lives in the texture arrays
+    struct TextureLayer
+    {
+        s32 Array = -1;     //-1 when the texture is in no array
+        u32 Layer = 0;
+        u32 MinLevel = 0;   //finest level with pixels, a streamed texture leaves the finer ones empty
+
+        bool IsValid() const { return Array >= 0; }
+    };
+
+    /*******************************************************
+     * @brief
+     * Hands out layers of a fixed number of texture arrays. Each
+     * array holds textures of one size, level count and format;
+     * an array that becomes empty can be given to another size.
+     * The lowest free layer is always used first, so the layers
+     * in use stay packed at the front and the GL arrays can start
+     * small and grow (see GetUsedLayers).
+     *
+     * Pure CPU bookkeeping without GL calls, TextureManager
+     * creates the arrays and copies the textures in.
+     *******************************************************/
+    class TextureLayerAllocator
+    {
+    public:
+        explicit TextureLayerAllocator(u32 layersPerArray = 16, u32 maxArrays = 8);
+
+        // An invalid layer when every array is full or taken by another size.
+        TextureLayer Allocate(TextureArrayKey const& key);
+        void Free(TextureLayer layer);
+        void Clear();
+
+        u32 GetMaxArrays() const { return m_maxArrays; }
+        u32 GetLayersPerArray() const { return m_layersPerArray; }
+        // Arrays handed out so far, used or empty.
+        u32 GetArrayCount() const { return static_cast<u32>(m_arrays.size()); }
+        TextureArrayKey const& GetKey(u32 array) const { return m_arrays[array].Key; }
+        // Layers in use.
+        u32 GetLayerCount(u32 array) const { return m_arrays[array].Count; }
+        // Highest layer in use plus one, the size the GL array needs.
+        u32 GetUsedLayers(u32 array) const;
+        // Changes whenever the array is given to another key, its GL array must be made again.
+        u32 GetGeneration(u32 array) const { return m_arrays[array].Generation; }
+
+    private:
+        struct Array
+        {
+            TextureArrayKey Key;
+            std::vector<bool> Used;
+            u32 Count = 0;
+            u32 Generation = 0;
+        };
+        std::vector<Array> m_arrays;
+        u32 m_layersPerArray;
+        u32 m_maxArrays;
+    };
+
+    //bits of MaterialRecord::Flags
+    enum MaterialTableFlags : u32
+    {
+        MaterialReceiveLight = 1,
+        MaterialDiffuseTexture = 2,
+        MaterialSpecularTexture = 4,
+        MaterialNormalMapTexture = 8,
+    };
+
+    /*******************************************************
+     * @brief
+     * One material as the shaders read it from the material table
+     * (MaterialTable.glsl), laid out like the std430 struct so the
+     * table is uploaded as it is. Texture references are the
+     * array of the texture, then its layer in the low 16 bits and
+     * its MinLevel above them (see TextureLayer).
+     *******************************************************/
+    struct MaterialRecord
+    {
+        Color AmbientColor;
+        Color DiffuseColor;
+        Color EmissiveColor;
+        Color SpecularColor;
+        f32 SpecularExponent = 1;
+        u32 Flags = 0;
+        u32 DiffuseTexture[2] = {};
+        u32 SpecularTexture[2] = {};
+        u32 NormalMapTexture[2] = {};
+
+        // Point a texture reference at a layer, an invalid layer clears it.
+        static void SetTexture(u32 reference[2], TextureLayer layer);
+    };
+    static_assert(sizeof(MaterialRecord) == 96, "MaterialRecord must match the std430 layout of the shaders.");
+
+    /*******************************************************
+     * @brief
+     * Parameters of every material drawn through the material
+     * table. Shaders index it with the MaterialIndex uniform, so a
+     * draw sets one integer instead of all material uniforms and
+     * texture bindings, and draws of different materials need no
+     * state changes in between.
+     *******************************************************/
+    class MaterialTable
+    {
+    public:
+        // Index of the record in the table, which is the MaterialIndex of the material.
+        u32 Add(MaterialRecord const& record);
+        void Set(u32 index, MaterialRecord const& record) { m_records[index] = record; }
+        MaterialRecord const& Get(u32 index) const { return m_records[index]; }
+        u32 GetCount() const { return static_cast<u32>(m_records.size()); }
+        void Clear() { m_records.clear(); }
+
+        /*******************************************************
+         * @brief The table as the shader storage buffer holds it.
+         * @return false if it is the same as bytes already held,
+         * so it does not have to be uploaded again.
+         *******************************************************/
+        bool Pack(std::vector<u8>& bytes) const;
+        // Read a record back from packed bytes.
+        static MaterialRecord Unpack(u8 const* bytes);
+
+        struct Benchmark
+        {
+            u32 Materials = 0;
+            u32 Textures = 0;
+            u32 Draws = 0;
+            u32 ArraysUsed = 0;
+            //textures that found no array, their materials keep binding them
+            u32 TexturesLeftOut = 0;
+            u32 TableBytes = 0;
+            //glBindTexture calls of one frame, per draw against per pass
+            u32 BindsWithoutTable = 0;
+            u32 BindsWithTable = 0;
+            //every texture sits on its own layer of an array of its size and
+            //every record reads back as it was packed
+            bool Consistent = true;
+            float PackMilliseconds = 0.0f;
+        };
+        /*******************************************************
+         * @brief Place random materials with textures of random sizes
+         * in texture arrays and pack their table, then count the
+         * texture binds of drawing random objects with and without
+         * the table.
+         *******************************************************/
+        static Benchmark MeasureBinding(u32 materialCount, u32 drawCount, u32 seed = 1);
+
+    private:
+        std::vector<MaterialRecord> m_records;
+    };
+}
+
+#endif
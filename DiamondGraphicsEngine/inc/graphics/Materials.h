@@ -9,6 +9,7 @@ namespace Graphics
     enum class ShaderType;
     class Texture;
     class GraphicsEngine;
+    struct MaterialRecord;
 
     class Material
     {
@@ -36,6 +37,26 @@ namespace Graphics
         
         virtual void Reflect(TwBar* editor, std::string const& groupName, Graphics::GraphicsEngine* g);
 
+        /*******************************************************
+        * @brief Tell the texture manager the enabled textures are
+        * drawn this frame, so streamed ones get the detail they need.
+        * @param uvPerPixel Texture coordinates one screen pixel covers.
+        ******************************************************/
+        virtual void RequestTextureDetail(TextureManager& textureManager, float uvPerPixel) const;
+
+        /*******************************************************
+        * @brief Fill the material table record of this material,
+        * with what SetShaderParameters would set for its
+        * illumination model.
+        * @return false if an enabled texture is in no texture array,
+        * the material is then drawn with uniforms.
+        ******************************************************/
+        virtual bool FillTableRecord(MaterialRecord& record, TextureManager& textureManager) const;
+        // Index in the material table, -1 when drawn with uniforms.
+        s32 GetTableIndex() const { return m_tableIndex; }
+        // Goes up with every change FillTableRecord would see, the material table repacks the material then.
+        u32 GetVersion() const { return m_version; }
+
         //=========================================================================
         //                  Getters and Setters
         //=========================================================================
@@ -74,25 +95,31 @@ namespace Graphics
         /// diffuse texture
         virtual std::shared_ptr<Texture> GetDiffuseTexture() const { return m_diffuseTexture.second; }
         virtual Material& AssignDiffuseTexture(TextureType type, std::shared_ptr<Texture> texture);
-        virtual void SetDiffuseTextureEnabled(bool enabled) { m_isDiffuseTextureEnabled = enabled; }
+        virtual void SetDiffuseTextureEnabled(bool enabled) { m_isDiffuseTextureEnabled = enabled; ++m_version; }
+        virtual bool IsDiffuseTextureEnabled() const { return m_isDiffuseTextureEnabled; }
 
         ////////////////////////////////////////////////////////////////////////////
         /// specular texture
         virtual std::shared_ptr<Texture> GetSpecularTexture() const { return m_specularTexture.second; }
         virtual Material& AssignSpecularTexture(TextureType type, std::shared_ptr<Texture> texture);
-        virtual void SetSpecularTextureEnabled(bool enabled) { m_isSpecularTextureEnabled = enabled; }
+        virtual void SetSpecularTextureEnabled(bool enabled) { m_isSpecularTextureEnabled = enabled; ++m_version; }
 
         ////////////////////////////////////////////////////////////////////////////
         /// normal map texture
         virtual std::shared_ptr<Texture> GetNormalMapTexture() const { return m_normalMapTexture.second; }
         virtual Material& AssignNormalMapTexture(TextureType type, std::shared_ptr<Texture> texture);
-        virtual void SetNormalMapTextureEnabled(bool enabled) { m_isNormalMapTextureEnabled = enabled; }
+        virtual void SetNormalMapTextureEnabled(bool enabled) { m_isNormalMapTextureEnabled = enabled; ++m_version; }
 
         ////////////////////////////////////////////////////////////////////////////
         /// object transparency
         virtual f32 GetOpacity() const { return m_opacity; }
         virtual Material& SetOpacity(f32 alpha);
 
+        ////////////////////////////////////////////////////////////////////////////
+        /// index of refraction (mtl Ni), only used by the RayTracer for illum 6 and 7
+        virtual f32 GetRefractiveIndex() const { return m_refractiveIndex; }
+        virtual Material& SetRefractiveIndex(f32 index);
+
         ////////////////////////////////////////////////////////////////////////////
         /// illumination model index
         virtual int GetIlluminationModel() const { return m_illumModel; }
@@ -126,8 +153,14 @@ namespace Graphics
 
         f32 m_specularExponent = 1;
         f32 m_opacity = 1;//not used but nice to have for the future.
+        f32 m_refractiveIndex = 1.5f;
         //mtl file illum index frmo 0 to 10, as in wavefront mtl
         int m_illumModel = 2;
+        //set by MaterialManager::UpdateMaterialTable
+        s32 m_tableIndex = -1;
+        u32 m_version = 0;
+        //m_version the table was last filled with, set by MaterialManager::UpdateMaterialTable
+        u32 m_tableVersion = ~0u;
 
         
 
@@ -146,6 +179,32 @@ namespace Graphics
             static void TW_CALL GetSpecularTextureCB(void* value, void* clientData);
             static void TW_CALL SetNormalmapTextureCB(const void* value, void* clientData);
             static void TW_CALL GetNormalmapTextureCB(void* value, void* clientData);
+            //fields the material table reads, set through here so the version goes up
+            template <typename T, T Material::*Field>
+            static void TW_CALL SetFieldCB(const void* value, void* clientData)
+            {
+                Material* mat = static_cast<Material*>(clientData);
+                mat->*Field = *static_cast<const T*>(value);
+                ++mat->m_version;
+            }
+            template <typename T, T Material::*Field>
+            static void TW_CALL GetFieldCB(void* value, void* clientData)
+            {
+                *static_cast<T*>(value) = static_cast<Material*>(clientData)->*Field;
+            }
+            //TW_TYPE_COLOR3F is r, g and b only
+            template <Color Material::*Field>
+            static void TW_CALL SetColorCB(const void* value, void* clientData)
+            {
+                Material* mat = static_cast<Material*>(clientData);
+                std::memcpy(&(mat->*Field), value, 3 * sizeof(f32));
+                ++mat->m_version;
+            }
+            template <Color Material::*Field>
+            static void TW_CALL GetColorCB(void* value, void* clientData)
+            {
+                std::memcpy(value, &(static_cast<Material*>(clientData)->*Field), 3 * sizeof(f32));
+            }
 
         };
 
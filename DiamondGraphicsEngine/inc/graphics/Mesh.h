@@ -118,6 +118,15 @@ namespace Graphics
          *******************************************************/
         virtual void CalculateBoundingSphere(){}
         BoundingSphere const& GetBoundingSphere() const { return m_boudingSphere; }
+        /*******************************************************
+         * @brief Ray cast for editor selection, with the ray in
+         * object space. Meshes without anything better test the
+         * bounding sphere.
+         * @param t Distance along the ray, in units of its direction.
+         *******************************************************/
+        virtual bool RayCast(Ray const& localRay, float* t);
+        // Texture coordinates per object space unit, used to pick streamed texture levels.
+        float GetUvDensity() const { return m_uvDensity; }
 
         std::string const& GetLabel() const { return m_label; }
         void SetLabel(std::string const& label) { m_label = label; }
@@ -129,5 +138,6 @@ namespace Graphics
 
         std::shared_ptr<VertexArrayObject> m_vertexArrayObject;
         BoundingSphere m_boudingSphere;//used only for ray casting selection for now.
+        float m_uvDensity = 1.0f;
     };
 }
@@ -0,0 +1,54 @@
+#ifndef H_MIP_GENERATOR
+#define H_MIP_GENERATOR
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    enum class MipFilter : u8
+    {
+        Box,    //2x2 average, fastest
+        Kaiser, //6 tap Kaiser windowed sinc, sharper and less aliasing
+    };
+
+    //one level of a mip chain, tightly packed rows
+    struct MipLevel
+    {
+        u32 Width = 0;
+        u32 Height = 0;
+        std::vector<u8> Pixels;
+    };
+
+    /*******************************************************
+     * @brief
+     * Builds mip chains on the CPU from 8 bit RGB/RGBA pixels.
+     *
+     * Filtering is done in linear space: color channels of sRGB
+     * images go through a lookup table to linear floats, get
+     * filtered with SSE and are encoded back to sRGB. Alpha and
+     * data textures (normal maps) are filtered as they are.
+     * Every level is split in bands of rows that are filtered on
+     * all cores; levels depend on each other, so they are made
+     * one after another. Borders wrap, matching GL_REPEAT.
+     *******************************************************/
+    class MipGenerator
+    {
+    public:
+        // Number of levels down to 1x1, level 0 included.
+        static u32 GetLevelCount(u32 width, u32 height);
+
+        /*******************************************************
+         * @brief Generate levels 1 to the 1x1 level from level 0.
+         * @param channels 3 for RGB, 4 for RGBA.
+         * @param srgb Treat color channels as sRGB encoded.
+         * @return Levels 1..n, level 0 is not copied.
+         *******************************************************/
+        static std::vector<MipLevel> Generate(u8 const* pixels, u32 width, u32 height, u8 channels,
+                                              MipFilter filter = MipFilter::Kaiser, bool srgb = true);
+
+        // Half the size of one level (rounded down, at least 1).
+        static MipLevel Downsample(u8 const* pixels, u32 width, u32 height, u8 channels,
+                                   MipFilter filter = MipFilter::Kaiser, bool srgb = true);
+    };
+}
+
+#endif
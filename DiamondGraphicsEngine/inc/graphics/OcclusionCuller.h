@@ -0,0 +1,208 @@
+#ifndef H_OCCLUSION_CULLER
+#define H_OCCLUSION_CULLER
+
+#include "framework/Utilities.h"
+#include "framework/WorkerPool.h"
+#include "graphics/FrustumCuller.h"
+#include "math/Matrix4.h"
+#include "math/Vector3.h"
+
+#include <condition_variable>
+
+namespace Graphics
+{
+    class Texture;
+    class TriangleMesh;
+
+    /*******************************************************
+     * @brief
+     * Masked software occlusion culling: the triangles of the
+     * occluders are rasterized on the CPU into a small depth
+     * buffer of 8x4 pixel tiles, and the bounding boxes of the
+     * other objects are tested against it before they are drawn.
+     *
+     * A tile does not keep a depth per pixel. It keeps a
+     * reference depth all of its pixels are covered at, and a
+     * working layer: the pixels covered since, as a 32 bit mask,
+     * with the farthest depth of the triangles that covered them.
+     * When the mask is full the working layer becomes the
+     * reference. Depths are 1 / w, larger is nearer, 0 is empty.
+     * A box is occluded when its nearest point is farther than
+     * the reference of every tile its rectangle touches, so the
+     * tests read one float per tile, four tiles per SSE2 compare.
+     *
+     * Pixels are covered by their center and triangles are
+     * given their farthest depth in the tile, so the buffer is
+     * never nearer than the occluders. Gaps thinner than a pixel
+     * of the buffer can still hide what is behind them.
+     *
+     * BeginFrame rasterizes on a thread of the culler's own
+     * (itself spread over MaxThreads by bands of tile rows) and
+     * returns at once, so it can run while the scene updates;
+     * Cull waits for it. The threads are started by the first
+     * BeginFrame and sleep between frames.
+     *******************************************************/
+    class OcclusionCuller
+    {
+    public:
+        struct Settings
+        {
+            //multiples of 8 and 4, up to 512
+            u32 Width = 256;
+            u32 Height = 128;
+            //threads rasterizing bands, 0 for one less than the cores, the main thread keeps one
+            u32 MaxThreads = 0;
+            //false covers one pixel at a time instead of four, for comparing
+            bool Simd = true;
+        };
+        struct Occluder
+        {
+            std::shared_ptr<TriangleMesh> Mesh;
+            Math::Matrix4 World;
+        };
+        struct FrameStats
+        {
+            u32 Occluders = 0;
+            u32 OccluderTriangles = 0;
+            //left after clipping and rejecting the ones that cover no pixel
+            u32 TrianglesRasterized = 0;
+            //objects Cull got, and how many of them it hid
+            u32 Tested = 0;
+            u32 Occluded = 0;
+            //on the worker, how long of it the main thread waited for, and the box tests
+            float RasterMilliseconds = 0.0f;
+            float WaitMilliseconds = 0.0f;
+            float TestMilliseconds = 0.0f;
+        };
+
+        OcclusionCuller() = default;
+        explicit OcclusionCuller(Settings const& settings);
+        ~OcclusionCuller();
+        OcclusionCuller(OcclusionCuller const&) = delete;
+        OcclusionCuller& operator=(OcclusionCuller const&) = delete;
+
+        /*******************************************************
+         * @brief Start rasterizing the occluders as seen through
+         * viewProj on a worker thread, waiting for the previous
+         * frame's first. The meshes must not change until Wait.
+         *******************************************************/
+        void BeginFrame(Math::Matrix4 const& viewProj, std::vector<Occluder> occluders);
+        // Block until the rasterization BeginFrame started is done.
+        void Wait();
+        // BeginFrame was called and no Cull used the buffer yet.
+        bool IsFramePending() const { return m_framePending; }
+
+        // Wait, then test one world space box.
+        bool IsOccluded(Math::Vector3 const& boxMin, Math::Vector3 const& boxMax);
+        /*******************************************************
+         * @brief Wait, then test the boxes around the spheres of
+         * the visible objects and take out the occluded ones.
+         * @param spheres The spheres the objects were frustum
+         * culled with, always visible ones are not tested.
+         * @param visible Visible ids, the occluded ones are removed.
+         * @param visibleMask Set to 0 for the occluded ids.
+         *******************************************************/
+        FrameStats const& Cull(FrustumCuller const& spheres, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask);
+        // Of the last BeginFrame and Cull.
+        FrameStats const& GetFrameStats() const { return m_stats; }
+
+        // Reference depth of every tile as gray, white is near, black empty. Waits.
+        std::shared_ptr<Texture> ReadDepth();
+
+        struct Benchmark
+        {
+            u32 Width = 0;
+            u32 Height = 0;
+            u32 Occluders = 0;
+            u32 OccluderTriangles = 0;
+            u32 Objects = 0;
+            u32 Occluded = 0;
+            //occluded when tested against a depth per pixel of the same resolution
+            u32 ReferenceOccluded = 0;
+            //occluded by the tiles but not per pixel, must be 0
+            u32 NotConservative = 0;
+            u32 Threads = 0;
+            float RasterMilliseconds = 0.0f;
+            float SingleThreadMilliseconds = 0.0f;
+            float ScalarMilliseconds = 0.0f;
+            float TestNanoseconds = 0.0f;
+            //the same tiles with every thread count and without SSE2
+            bool ResultsMatch = false;
+        };
+        /*******************************************************
+         * @brief Rows of walls made of the occluder mesh in front
+         * of a grid of boxes, seen from one end.
+         *******************************************************/
+        static Benchmark Measure(std::shared_ptr<TriangleMesh> const& occluder, u32 walls = 8, u32 objects = 4096);
+
+    private:
+        struct SetupTriangle
+        {
+            //edge i is opposite corner i, E(x, y) = A * x + B * y + C in 1/16 pixels, positive inside
+            s32 A[3];
+            s32 B[3];
+            s64 C[3];
+            s32 Bias[3];
+            //1 / w = InverseW0 + InverseWStepX * x + InverseWStepY * y over pixel centers
+            float InverseW0 = 0.0f;
+            float InverseWStepX = 0.0f;
+            float InverseWStepY = 0.0f;
+            float FarthestInverseW = 0.0f;
+            //covered tiles, inclusive
+            s32 MinTileX = 0;
+            s32 MinTileY = 0;
+            s32 MaxTileX = 0;
+            s32 MaxTileY = 0;
+        };
+        struct ScreenRect
+        {
+            s32 MinX = 0;
+            s32 MinY = 0;
+            s32 MaxX = 0;
+            s32 MaxY = 0;
+            float NearestInverseW = 0.0f;
+            //false when it crosses the near plane or misses the buffer
+            bool Testable = false;
+        };
+
+        //runs rasterizeFrame whenever BeginFrame asks for it
+        void frameLoop();
+        void rasterizeFrame();
+        void setupTriangles(u32 chunk, u32 begin, u32 end);
+        void addTriangle(u32 chunk, Math::Vector4 const* clip);
+        void rasterizeBand(u32 firstTileRow, u32 endTileRow);
+        u32 coverTile(SetupTriangle const& triangle, s32 tileX, s32 tileY) const;
+        void updateTile(u32 tile, u32 coverage, float inverseW);
+        ScreenRect projectBox(Math::Vector3 const& boxMin, Math::Vector3 const& boxMax) const;
+        bool isOccluded(ScreenRect const& rect) const;
+
+        Settings m_settings;
+        u32 m_tilesX = 0;
+        u32 m_tilesY = 0;
+        Math::Matrix4 m_viewProj;
+        std::vector<Occluder> m_occluders;
+        bool m_framePending = false;
+
+        //started by the first BeginFrame, the frame thread is one of MaxThreads
+        std::unique_ptr<WorkerPool> m_workers;
+        std::thread m_frameThread;
+        std::mutex m_frameMutex;
+        std::condition_variable m_frameStart;
+        std::condition_variable m_frameDone;
+        //set by BeginFrame, cleared by the frame thread when the frame is rasterized
+        bool m_frameRunning = false;
+        bool m_stopping = false;
+        FrameStats m_stats;
+
+        //per occluder, its first triangle in the frame
+        std::vector<u32> m_firstTriangles;
+        //per setup chunk, in submission order
+        std::vector<std::vector<SetupTriangle>> m_chunkTriangles;
+        //per tile
+        std::vector<float> m_reference;
+        std::vector<float> m_working;
+        std::vector<u32> m_masks;
+    };
+}
+
+#endif
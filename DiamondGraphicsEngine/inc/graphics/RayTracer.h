@@ -0,0 +1,168 @@
+#ifndef H_RAY_TRACER
+#define H_RAY_TRACER
+
+#include "core/BoundingVolumeHierarchy.h"
+#include "graphics/Color.h"
+#include "graphics/LightManager.h"
+#include "graphics/TriangleBvh.h"
+#include "math/Matrix4.h"
+
+class Scene;
+
+namespace Graphics
+{
+    class CameraBase;
+    class Material;
+    class Texture;
+    class TriangleMesh;
+
+    /*******************************************************
+     * @brief
+     * CPU reference renderer: Whitted style ray tracing of the
+     * triangle meshes of a scene with their materials and lights.
+     * It renders the mtl illumination models the rasterizer leaves
+     * out (3 to 9: reflection, glass, refraction and Fresnel), and
+     * gives ground truth frames for regression checks on machines
+     * without a GPU.
+     *
+     * The scene is a two level tree: a BoundingVolumeHierarchy over
+     * the world boxes of the instances, each pointing at the
+     * TriangleBvh of its mesh in object space, so a mesh drawn by
+     * many objects is stored once. The image is cut into tiles
+     * that the worker threads take with ParallelFor. The camera
+     * rays of a tile walk both levels as one packet, a node box
+     * tested against all of them at once with Batch::IntersectBox;
+     * reflection, refraction and shadow rays go one at a time.
+     *
+     * Shading follows shader.frag: Phong per light plus the
+     * emissive color, times the diffuse texture, with the spot cone
+     * and distance attenuation of FinalPass.frag. Lights with a
+     * shadow type cast hard shadows. Fog, normal maps and the
+     * skydome are left out, rays leaving the scene get the
+     * background color. No GL calls are made.
+     *******************************************************/
+    class RayTracer
+    {
+    public:
+        struct Settings
+        {
+            u32 Width = 640;
+            u32 Height = 360;
+            //reflection and refraction bounces after the camera ray
+            u32 MaxDepth = 4;
+            //0 for one thread per core
+            u32 MaxThreads = 0;
+            //tile edge in pixels, the camera rays of a tile are one packet
+            u32 TileSize = 8;
+            //false casts every camera ray on its own, for comparing
+            bool Packets = true;
+            Color Background = Color(0, 0, 0);
+        };
+
+        struct Instance
+        {
+            std::shared_ptr<Graphics::TriangleMesh> Mesh;
+            std::shared_ptr<Graphics::Material> Material;
+            Math::Matrix4 World;
+            //built over the mesh when null, through TriangleMesh::GetBvh
+            std::shared_ptr<TriangleBvh> Bvh;
+        };
+
+        RayTracer();
+
+        /*******************************************************
+         * @brief Take the instances and the active lights. Missing
+         * mesh trees are built here, on the calling thread; Render
+         * only reads what Build made, from any thread.
+         *******************************************************/
+        void Build(std::vector<Instance> const& instances, std::vector<LightAttribute> const& lights);
+        // Every mesh of the active objects with an enabled Renderer, and the lights of the LightManager.
+        void Build(Scene& scene);
+        void Clear();
+
+        u32 GetInstanceCount() const { return static_cast<u32>(m_instances.size()); }
+
+        // Render through an inverted view projection, row 0 of the texture is the top of the image.
+        std::shared_ptr<Texture> Render(Math::Matrix4 const& viewProj, Settings const& settings) const;
+        // Render what the camera sees, on its fog color.
+        std::shared_ptr<Texture> Render(CameraBase& camera, Settings settings) const;
+
+        struct Benchmark
+        {
+            u32 Width = 0;
+            u32 Height = 0;
+            u32 Instances = 0;
+            u32 Triangles = 0;
+            u32 Threads = 0;
+            float Milliseconds = 0.0f;
+            float SingleThreadMilliseconds = 0.0f;
+            //camera rays only, on one thread
+            u32 PrimaryRays = 0;
+            u32 PrimaryRaysHit = 0;
+            float PacketMegaRaysPerSecond = 0.0f;
+            float SingleRayMegaRaysPerSecond = 0.0f;
+            //camera rays hitting another triangle, or the same one further than 1e-4 relative, with packets
+            u32 MismatchedHits = 0;
+        };
+        /*******************************************************
+         * @brief Render the instances from eye towards target on
+         * every core and on one thread, and cast the camera rays in
+         * packets against one at a time.
+         * @param imagePath Where to save the image as PNG, nothing
+         * is saved when empty.
+         *******************************************************/
+        static Benchmark Measure(std::vector<Instance> const& instances, std::vector<LightAttribute> const& lights,
+                                 Math::Vector3 const& eye, Math::Vector3 const& target, Settings const& settings,
+                                 std::string const& imagePath = "");
+
+    private:
+        struct SceneInstance
+        {
+            std::shared_ptr<Graphics::TriangleMesh> Mesh;
+            std::shared_ptr<Graphics::Material> Material;
+            std::shared_ptr<TriangleBvh> Bvh;
+            //null unless the material enables it and its pixels are on the CPU
+            std::shared_ptr<Texture> DiffuseTexture;
+            Math::Matrix4 World;
+            Math::Matrix4 InverseWorld;
+            //transpose of the inverse, for normals
+            Math::Matrix4 NormalMatrix;
+        };
+
+        struct Hit
+        {
+            s32 InstanceIndex = -1;
+            TriangleBvh::Hit Triangle;
+        };
+
+        struct Tile
+        {
+            u32 X = 0;
+            u32 Y = 0;
+            u32 Width = 0;
+            u32 Height = 0;
+        };
+
+        struct Surface;
+
+        // Camera rays of a tile, row by row, and their nearest hits.
+        void castTile(Tile const& tile, Math::Matrix4 const& inverseViewProj, Settings const& settings,
+                      Math::RayArray& rays, std::vector<Hit>& hits) const;
+        void castPacket(Math::RayArray& rays, std::vector<Hit>& hits) const;
+        bool castRay(Math::Vector3 const& start, Math::Vector3 const& direction, float maxDistance, Hit& hit) const;
+
+        Math::Vector3 trace(Math::Vector3 const& start, Math::Vector3 const& direction, u32 depth,
+                            Settings const& settings) const;
+        Math::Vector3 shade(Math::Vector3 const& start, Math::Vector3 const& direction, Hit const& hit, u32 depth,
+                            Settings const& settings) const;
+        Surface surfaceAt(Math::Vector3 const& start, Math::Vector3 const& direction, Hit const& hit) const;
+        Math::Vector3 lightSurface(Surface const& surface, Material const& material, Math::Vector3 const& toEye,
+                                   bool specular) const;
+
+        std::vector<SceneInstance> m_instances;
+        std::vector<LightAttribute> m_lights;
+        BoundingVolumeHierarchy m_tree;
+    };
+}
+
+#endif
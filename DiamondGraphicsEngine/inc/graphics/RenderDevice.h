@@ -0,0 +1,64 @@
+#ifndef H_RENDER_DEVICE
+#define H_RENDER_DEVICE
+#include "framework/Utilities.h"
+#include "graphics/Color.h"
+#include "graphics/LightManager.h"
+#include "math/Matrix4.h"
+
+namespace Graphics
+{
+    class CameraBase;
+    class Material;
+    class Texture;
+    class TriangleMesh;
+
+    /*******************************************************
+     * @brief What the forward shader reads from the camera, the
+     * uniforms of CameraBase::SetCameraUniforms and the view
+     * projection.
+     *******************************************************/
+    struct RenderView
+    {
+        Math::Matrix4 ViewProj;
+        Math::Vector3 Position;
+        float NearPlane = 0.1f;
+        float FarPlane = 1000.0f;
+        Color FogColor = Color(0, 0, 0);
+
+        static RenderView FromCamera(CameraBase& camera);
+        // Right handed view from eye to target with a GL projection, fieldOfView vertical in radians.
+        static RenderView LookAt(Math::Vector3 const& eye, Math::Vector3 const& target, float fieldOfView, float aspect,
+                                 float nearPlane = 0.1f, float farPlane = 1000.0f);
+    };
+
+    /*******************************************************
+     * @brief
+     * Thin interface for drawing a frame of triangle meshes
+     * with the forward shading (shader.frag), for backends that
+     * are not the GL pipeline of GraphicsEngine::RenderScene.
+     * GraphicsEngine::RenderScene(Scene*, RenderDevice&) walks
+     * the scene the same way and submits to it.
+     *
+     * A frame is BeginFrame, the view and lights, any number of
+     * draws, then EndFrame; a device may do all the work in
+     * EndFrame. Draw keeps the mesh and material alive until then.
+     *******************************************************/
+    class RenderDevice
+    {
+    public:
+        virtual ~RenderDevice() = default;
+
+        // Start a frame cleared to clearColor, the depth cleared to the far plane.
+        virtual void BeginFrame(u32 width, u32 height, Color const& clearColor) = 0;
+        virtual void SetView(RenderView const& view) = 0;
+        // Every light of the LightManager, the inactive ones are skipped as the shader does.
+        virtual void SetLights(std::vector<LightAttribute> const& lights) = 0;
+        virtual void Draw(std::shared_ptr<TriangleMesh> const& mesh, std::shared_ptr<Material> const& material,
+                          Math::Matrix4 const& world) = 0;
+        virtual void EndFrame() = 0;
+        // Color of the last finished frame, row 0 is the top.
+        virtual std::shared_ptr<Texture> ReadColor() const = 0;
+    };
+}
+
+#endif
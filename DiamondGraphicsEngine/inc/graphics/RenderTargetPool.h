@@ -0,0 +1,86 @@
+#ifndef H_RENDER_TARGET_POOL
+#define H_RENDER_TARGET_POOL
+
+#include "graphics/Framebuffer.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief Describes a render target by format and size.
+     * The size is either a fraction of the screen or fixed,
+     * e.g. shadow maps live in light space and do not follow
+     * the window.
+     *******************************************************/
+    struct RenderTargetDesc
+    {
+        RenderTargetDesc() = default;
+        //screen relative target
+        RenderTargetDesc(FBO_USAGE usage, float screenScale)
+            : Usage(usage), ScreenScale(screenScale) {}
+        //fixed size target
+        RenderTargetDesc(FBO_USAGE usage, u32 width, u32 height)
+            : Usage(usage), ScreenScale(0), Width(width), Height(height) {}
+
+        u32 ResolveWidth(u32 screenWidth) const;
+        u32 ResolveHeight(u32 screenHeight) const;
+        bool IsScreenRelative() const { return ScreenScale > 0; }
+
+        FBO_USAGE Usage = FBO_USAGE_REGULAR;
+        float ScreenScale = 1.0f;
+        u32 Width = 0;
+        u32 Height = 0;
+    };
+
+    /*******************************************************
+     * @brief A transient target and the range of passes that
+     * use it, FirstUse is the first writer and LastUse is the
+     * last reader (both inclusive pass indices).
+     *******************************************************/
+    struct RenderTargetRequest
+    {
+        RenderTargetDesc Desc;
+        u32 FirstUse = 0;
+        u32 LastUse = 0;
+    };
+
+    struct RenderTargetPlan
+    {
+        struct Target
+        {
+            FBO_USAGE Usage;
+            u32 Width;
+            u32 Height;
+            u32 LastUse;
+        };
+        //physical targets that need to be allocated
+        std::vector<Target> Targets;
+        //index into Targets for every request, in request order
+        std::vector<u32> TargetOfRequest;
+        //memory if every request owned its own target
+        u64 BytesUnaliased = 0;
+        //memory of Targets
+        u64 BytesAliased = 0;
+    };
+
+    /*******************************************************
+     * @brief
+     * Assigns transient render target requests to as few physical
+     * targets as possible. Two requests share a target if they have
+     * the same format and resolved size and their lifetimes do not
+     * overlap. Pure CPU code, no GL calls are made here so it can be
+     * run without a context.
+     *******************************************************/
+    class RenderTargetPlanner
+    {
+    public:
+        static RenderTargetPlan Plan(std::vector<RenderTargetRequest> const& requests,
+                                     u32 screenWidth, u32 screenHeight);
+
+        // GPU memory per pixel of every attachment a usage allocates.
+        static u32 GetBytesPerPixel(FBO_USAGE usage);
+
+        static void PrintPlan(RenderTargetPlan const& plan, std::ostream& os);
+    };
+}
+
+#endif
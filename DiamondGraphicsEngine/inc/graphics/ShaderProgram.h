@@ -7,6 +7,7 @@ namespace Math
 {
     struct Vector2;
     struct Vector3;
+    struct Matrix3;
     struct Matrix4;
     struct Vector4;
 }
@@ -85,6 +86,10 @@ namespace Graphics
         // Matrix4 to the GPU.
         void SetUniform(std::string const& name, Math::Matrix4 const& matrix);
 
+        // Sets a uniform Matrix3, given a name. This will send all 9 floats of the
+        // Matrix3 to the GPU.
+        void SetUniform(std::string const& name, Math::Matrix3 const& matrix);
+
         // Sets a uniform Color, given a name. Colors are equivalent to vec4s in
         // GLSL, therefore this just sends all 4 floats of the RGBA color (in that
         // order), to the GPU.
@@ -0,0 +1,173 @@
+#ifndef H_SOFTWARE_RASTERIZER
+#define H_SOFTWARE_RASTERIZER
+
+#include "graphics/RenderDevice.h"
+#include "math/Vector4.h"
+
+namespace Graphics
+{
+    /*******************************************************
+     * @brief
+     * RenderDevice that draws on the CPU, so the scene can be
+     * rendered and image diffed on machines without a GPU. It
+     * rasterizes the vertices and triangles of TriangleMesh, the
+     * same ones its VAO is built from, and shades every pixel with
+     * the forward Phong of shader.frag: directional lights only,
+     * fog per light, and the diffuse texture sampled bilinear from
+     * level 0. Normal maps, the skydome and the deferred passes
+     * (SSAO, shadows) are left out.
+     *
+     * All the work is done in EndFrame, on every core:
+     * - vertices go to clip space and world space in chunks,
+     * - triangles are clipped (near and far plane, a guard band
+     *   of twice the viewport on the sides), snapped to 1/16 pixel
+     *   and binned to the 32x32 tiles they cover, in chunks that
+     *   keep the submission order,
+     * - each tile is rasterized by one thread with integer edge
+     *   functions, four pixels at a time with SSE2, into a tile
+     *   local depth buffer (GL_LESS) and triangle index buffer,
+     *   then every covered pixel is shaded once.
+     * The image only depends on the draws, not on the thread
+     * count or on SSE2. Faces are not culled, as in the GL state.
+     *******************************************************/
+    class SoftwareRasterizer : public RenderDevice
+    {
+    public:
+        struct Settings
+        {
+            //0 for one thread per core
+            u32 MaxThreads = 0;
+            //false tests one pixel at a time instead of four, for comparing
+            bool Simd = true;
+        };
+
+        SoftwareRasterizer() = default;
+        explicit SoftwareRasterizer(Settings const& settings);
+
+        void BeginFrame(u32 width, u32 height, Color const& clearColor) override;
+        void SetView(RenderView const& view) override;
+        void SetLights(std::vector<LightAttribute> const& lights) override;
+        void Draw(std::shared_ptr<TriangleMesh> const& mesh, std::shared_ptr<Material> const& material,
+                  Math::Matrix4 const& world) override;
+        void EndFrame() override;
+        std::shared_ptr<Texture> ReadColor() const override { return m_image; }
+
+        struct FrameStats
+        {
+            u32 Draws = 0;
+            u32 Triangles = 0;
+            //left after clipping, more than Triangles when clipping splits them
+            u32 TrianglesSetUp = 0;
+            u32 PixelsShaded = 0;
+            float VertexMilliseconds = 0.0f;
+            float SetupMilliseconds = 0.0f;
+            float RasterMilliseconds = 0.0f;
+        };
+        // Of the last EndFrame.
+        FrameStats const& GetFrameStats() const { return m_stats; }
+
+        struct Benchmark
+        {
+            u32 Width = 0;
+            u32 Height = 0;
+            u32 Draws = 0;
+            u32 Triangles = 0;
+            u32 TrianglesSetUp = 0;
+            u32 PixelsShaded = 0;
+            u32 Threads = 0;
+            //Draw calls only, the CPU side cost of submitting
+            float SubmitNanoseconds = 0.0f;
+            //EndFrame on every core, one core, and one core without SSE2
+            float Milliseconds = 0.0f;
+            float SingleThreadMilliseconds = 0.0f;
+            float ScalarMilliseconds = 0.0f;
+            //submitted triangles per second on every core
+            float MegaTrianglesPerSecond = 0.0f;
+            //the three images are the same
+            bool ImagesMatch = false;
+        };
+        /*******************************************************
+         * @brief Draw a grid of copies of the mesh with a
+         * directional light, on every core, on one, and without SSE2.
+         * @param imagePath Where to save the image as PNG, nothing
+         * is saved when empty.
+         *******************************************************/
+        static Benchmark Measure(std::shared_ptr<TriangleMesh> const& mesh, std::shared_ptr<Material> const& material,
+                                 u32 width = 1280, u32 height = 720, u32 copies = 16, std::string const& imagePath = "");
+
+    private:
+        struct DrawCall
+        {
+            std::shared_ptr<TriangleMesh> Mesh;
+            std::shared_ptr<Material> MaterialRef;
+            //null unless the material enables it and its pixels are on the CPU
+            std::shared_ptr<Texture> DiffuseTexture;
+            Math::Matrix4 World;
+            //inverse transpose of World, for normals
+            Math::Matrix4 NormalMatrix;
+            //set in EndFrame, the view may come after the draws
+            Math::Matrix4 WorldViewProj;
+            u32 FirstVertex = 0;
+            u32 VertexCount = 0;
+            u32 FirstTriangle = 0;
+            u32 TriangleCount = 0;
+        };
+
+        //a triangle after clipping, ready to rasterize
+        struct SetupTriangle
+        {
+            u32 Draw = 0;
+            u32 Face = 0;
+            //barycentric coordinates of the corners in the mesh triangle, not the identity when clipped
+            Math::Vector3 Corners[3];
+            //edge i is opposite corner i, E(x, y) = A * x + B * y + C in 1/16 pixels, positive inside
+            s32 A[3];
+            s32 B[3];
+            s64 C[3];
+            //-1 on edges that are not top or left, so pixels exactly on them go to one triangle only
+            s32 Bias[3];
+            s64 Area = 0;
+            float Depth[3];
+            float InverseW[3];
+            //window depth change per pixel
+            float DepthStepX = 0.0f;
+            float DepthStepY = 0.0f;
+            //covered pixels, inclusive and inside the viewport
+            s32 MinX = 0;
+            s32 MinY = 0;
+            s32 MaxX = 0;
+            s32 MaxY = 0;
+        };
+
+        void transformVertices(u32 begin, u32 end);
+        void setupTriangles(u32 chunk, u32 begin, u32 end);
+        void addTriangle(u32 chunk, u32 draw, u32 face, Math::Vector4 const* clip, Math::Vector3 const* corners);
+        //returns the pixels shaded
+        u32 renderTile(u32 tile, std::vector<float>& depth, std::vector<u32>& triangles) const;
+        void rasterize(SetupTriangle const& triangle, u32 index, s32 tileX, s32 tileY, float* depth,
+                       u32* triangles) const;
+        Math::Vector3 shade(SetupTriangle const& triangle, s32 x, s32 y) const;
+
+        Settings m_settings;
+        u32 m_width = 0;
+        u32 m_height = 0;
+        u32 m_tilesX = 0;
+        u32 m_tilesY = 0;
+        Color m_clearColor;
+        RenderView m_view;
+        std::vector<LightAttribute> m_lights;
+        std::vector<DrawCall> m_draws;
+        std::shared_ptr<Texture> m_image;
+        FrameStats m_stats;
+
+        //per vertex of every draw, in draw order
+        std::vector<Math::Vector4> m_clipPositions;
+        std::vector<Math::Vector3> m_worldPositions;
+        std::vector<Math::Vector3> m_worldNormals;
+        //per setup chunk, its triangles and their indices in it for every tile
+        std::vector<std::vector<SetupTriangle>> m_chunkTriangles;
+        std::vector<std::vector<std::vector<u32>>> m_chunkBins;
+    };
+}
+
+#endif
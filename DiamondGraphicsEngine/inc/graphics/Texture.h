@@ -3,6 +3,8 @@
 
 #include "framework/Utilities.h"
 #include "graphics/Color.h"
+#include "graphics/BlockCompressor.h"
+#include "graphics/MipGenerator.h"
 
 #pragma pack(push)
 #pragma pack(1)
@@ -26,6 +28,7 @@ namespace Graphics
     {
 		friend class TextureManager;
 		friend class Framebuffer;
+		friend class TextureCache;
         Texture() = default;
 	public:
         enum class Format
@@ -58,15 +61,44 @@ namespace Graphics
 
         // Create a new empty texture (default pixels are filled to black).
         Texture(u32 width, u32 height, Format format = Format::RGB);
-        // this Texture now owns pix
+        // this Texture now owns pix, which must come from AllocatePixels
         Texture(u8 *pix, u32 width, u32 height, Format format);
         ~Texture();
 
-        // builds the texture and uploads it to the graphics card
+        // builds the texture and uploads it to the graphics card, with its
+        // mip chain and trilinear filtering when it has one
         void Build();
         void ReplaceAndBuild(u8 *pix, u32 width, u32 height, u8 bpp);
         void ReplaceAndBuild(std::shared_ptr<Texture> rhs);
+        // Like ReplaceAndBuild, but takes the pixels of rhs instead of copying them; rhs is left empty.
+        void MoveAndBuild(Texture& rhs);
+        /*******************************************************
+         * @brief Pixel buffers textures own are allocated like the
+         * image decoder allocates its own, so a decoded image is
+         * handed to its texture without a copy (see LoadFromFile).
+         *******************************************************/
+        static u8* AllocatePixels(size_t size);
+        static void FreePixels(u8* pixels);
         bool IsBuilt() const { return m_isBuilt; }
+        // Goes up with every Build, copies of the GL texture are out of date when it changed.
+        u32 GetBuildCount() const { return m_buildCount; }
+        // Sized GL internal format the texture is stored in on the GPU.
+        u32 GetStorageFormat() const;
+        // Number of levels including level 0.
+        u32 GetLevelCount() const;
+        // Block compressed textures have no CPU pixels (see DownloadContents).
+        BlockFormat GetBlockFormat() const { return m_blockFormat; }
+        // Finest level on the GPU, above 0 while the finer ones are not streamed in.
+        u32 GetResidentLevel() const { return m_residentLevel; }
+        // Size of a level on the GPU, whether it is resident or not.
+        u64 GetLevelBytes(u32 level) const;
+        /*******************************************************
+         * @brief Streamed textures only: rebuild with level and all
+         * coarser ones, finer levels are freed. A finer level must
+         * have been set with SetLevelPixels first.
+         *******************************************************/
+        void SetResidentLevel(u32 level);
+        void SetLevelPixels(u32 level, std::vector<u8> pixels);
         void DownloadContents(); // downloads pixel data from GPU (bind first)
         bool IsBound() const;
         void Unbind();
@@ -82,12 +114,20 @@ namespace Graphics
         // Get the number of bytes per pixel. 3 means RGB, 4 means RGBA.
         u8 GetBPP() const;
 
+        // Level 0 is readable on the CPU, false for compressed or streamed textures
+        // and render targets that were never downloaded.
+        bool HasPixels() const;
+
         // Do NOT access a if HasAlpha() returns false.
         IntColor const* GetPixel(u32 x, u32 y) const;
 
         // Do NOT access or change a if HasAlpha() returns false.
         IntColor* GetPixel(u32 x, u32 y);
 
+        // Bilinear lookup of level 0 with repeat, like the default sampler, for CPU renderers.
+        // Needs HasPixels, alpha is 1.
+        Color SampleBilinear(f32 u, f32 v) const;
+
         // Color's alpha value ignored if this is a RGB texture.
         void SetPixel(u32 x, u32 y, IntColor const& color);
         void Bind(u8 slot);
@@ -99,8 +139,39 @@ namespace Graphics
         std::string const& GetTextureName() const { return m_textureName; }
         void SetTextureName(std::string const& name) { m_textureName = name; }
 
+        struct DecodeBenchmark
+        {
+            u32 Width = 0;
+            u32 Height = 0;
+            float DecodeMilliseconds = 0.0f;
+            //the JPEG stages on the same random blocks and rows, stb_image scalar against JpegSimd
+            float ScalarIdctMilliseconds = 0.0f;
+            float SimdIdctMilliseconds = 0.0f;
+            float ScalarColorMilliseconds = 0.0f;
+            float SimdColorMilliseconds = 0.0f;
+            bool KernelsMatch = true;
+            //time of the copies a load used to make between decode and upload
+            float CopyMilliseconds = 0.0f;
+        };
+        /*******************************************************
+         * @brief Decode an image, time the SIMD JPEG stages against
+         * the scalar ones, and time the pixel copies a load from the
+         * texture cache made before the stages moved them on.
+         *******************************************************/
+        static DecodeBenchmark MeasureDecode(std::string const& relativePath);
+
     private:
+        // Level 0 on the CPU, in m_pixels or as the first uncompressed level.
+        u8* pixelData() const;
+
+        //from AllocatePixels, nullptr when the levels are in m_levels
         u8 *m_pixels = nullptr;
+        //all levels, level 0 first, when the texture is loaded through the
+        //texture cache, levels finer than m_residentLevel have no pixels
+        std::vector<MipLevel> m_levels;
+        BlockFormat m_blockFormat = BlockFormat::None;
+        u32 m_residentLevel = 0;
+        u32 m_buildCount = 0;
         u32 m_width = 0;
         u32 m_height = 0;
         u32 m_textureHandle = 0;
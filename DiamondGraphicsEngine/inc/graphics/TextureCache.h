@@ -0,0 +1,126 @@
+#ifndef H_TEXTURE_CACHE
+#define H_TEXTURE_CACHE
+#include "framework/Utilities.h"
+#include "graphics/BlockCompressor.h"
+#include "graphics/MipGenerator.h"
+
+namespace Graphics
+{
+    class Texture;
+
+    //decides how a texture is filtered and compressed
+    enum class TextureUsage : u8
+    {
+        Color,      //sRGB color, filtered in linear space
+        NormalMap,  //data, filtered as it is, only x and y are kept when compressed
+    };
+
+    enum class TextureCompression : u8
+    {
+        None,       //8 bit RGB/RGBA
+        Fast,       //BC1 color (BC3 with alpha), BC5 normal maps
+        Quality,    //BC7 color, BC5 normal maps
+    };
+
+    //everything a cache file holds, level 0 first
+    struct TextureCacheData
+    {
+        u32 Width = 0;
+        u32 Height = 0;
+        u8 Channels = 3;
+        MipFilter Filter = MipFilter::Kaiser;
+        TextureUsage Usage = TextureUsage::Color;
+        //levels hold blocks of this format, or pixels if None
+        BlockFormat Format = BlockFormat::None;
+        //size and modification time of the source image, a
+        //cache file for a different source is out of date
+        u64 SourceSize = 0;
+        u64 SourceTime = 0;
+        std::vector<MipLevel> Levels;
+    };
+
+    /*******************************************************
+     * @brief
+     * On-disk cache of GPU ready textures. The first load of an
+     * image decodes it, builds its whole mip chain, block
+     * compresses it if asked to and writes it next to the source
+     * as "<file>.dgtx"; later loads read the chain back and go
+     * straight to upload, skipping decoding, filtering and
+     * encoding.
+     *
+     * The file is laid out like KTX2: a header, a table with the
+     * size and file offset of every level, then the level data,
+     * so levels can be read (or streamed) one by one.
+     *******************************************************/
+    class TextureCache
+    {
+    public:
+        // Cache file of a texture, relative to the textures folder like the source.
+        static std::string GetCachePath(std::string const& relativePath);
+        // Normal maps are recognized by name: *_n.* or containing "normal".
+        static TextureUsage GuessUsage(std::string const& relativePath);
+        static BlockFormat ChooseFormat(TextureCompression compression, TextureUsage usage, u8 channels);
+
+        static bool Write(std::string const& cacheFile, TextureCacheData const& data);
+        /*******************************************************
+         * @brief Read a cache file.
+         * @param maxLevelSize Levels wider or taller than this are left
+         * without pixels, 0 reads all of them.
+         * @return false if it is missing, broken or of another version.
+         *******************************************************/
+        static bool Read(std::string const& cacheFile, TextureCacheData& data, u32 maxLevelSize = 0);
+        // Read a single level, for streaming it in.
+        static bool ReadLevel(std::string const& cacheFile, u32 levelIndex, MipLevel& level);
+
+        /*******************************************************
+         * @brief Load a texture with its mip chain, from the cache when it
+         * is up to date, otherwise from the image, refreshing the cache.
+         * The levels read or made are moved into the texture, not copied.
+         * Does no GL calls, safe on loader threads.
+         * @param relativePath Image path relative to assets/textures.
+         * @return The texture, unbuilt, or nullptr if the image can't be read.
+         *******************************************************/
+        static std::shared_ptr<Texture> Load(std::string const& relativePath, MipFilter filter = MipFilter::Kaiser,
+                                             TextureCompression compression = TextureCompression::None);
+
+        /*******************************************************
+         * @brief Load only the coarse levels of a texture, for streaming
+         * the finer ones in later with ReadLevel. The cache is built
+         * first if it is out of date. Does no GL calls.
+         * @param maxLevelSize Largest level loaded along either side.
+         * @return The texture, unbuilt, with every level in its level
+         * table, or nullptr if the image can't be read.
+         *******************************************************/
+        static std::shared_ptr<Texture> LoadStreamed(std::string const& relativePath, u32 maxLevelSize,
+                                                     MipFilter filter = MipFilter::Kaiser,
+                                                     TextureCompression compression = TextureCompression::None);
+
+        struct Benchmark
+        {
+            u32 Width = 0;
+            u32 Height = 0;
+            u32 LevelCount = 0;
+            u64 CacheBytes = 0;
+            float DecodeMilliseconds = 0.0f;
+            float BoxMipMilliseconds = 0.0f;
+            float KaiserMipMilliseconds = 0.0f;
+            float WriteMilliseconds = 0.0f;
+            float ReadMilliseconds = 0.0f;
+            //the cache file read back to the levels written
+            bool RoundTrip = false;
+        };
+        // Decode and mip generation against reading the chain from a cache file.
+        static Benchmark MeasureLoadTime(std::string const& relativePath);
+        // Compression speed and quality of level 0 of an image.
+        static BlockCompressor::Benchmark MeasureCompression(std::string const& relativePath, BlockFormat format);
+
+    private:
+        //header and level table, levels get their size but no pixels
+        static bool readTable(std::ifstream& file, TextureCacheData& data, std::vector<u64>& offsets);
+        static bool isCurrent(TextureCacheData const& data, MipFilter filter, TextureCompression compression,
+                              bool hasSource, u64 sourceSize, u64 sourceTime);
+        static bool getSourceStamp(std::string const& relativePath, u64& size, u64& time);
+    };
+}
+
+#endif
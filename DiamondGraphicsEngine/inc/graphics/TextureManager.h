@@ -1,5 +1,9 @@
 #ifndef H_TEXTURE_MANAGER
 #define H_TEXTURE_MANAGER
+#include "framework/AssetLoader.h"
+#include "graphics/MaterialTable.h"
+#include "graphics/TextureCache.h"
+#include "graphics/TextureResidency.h"
 
 namespace Graphics
 {
@@ -25,6 +29,9 @@ namespace Graphics
      * usually 16 or 32.
      *******************************************************/
     static u8 const NumberAvailableTextureUnits = 16;
+    //texture arrays of the material table are bound to the last units
+    static u8 const MaxTextureArrays = 8;
+    static u8 const FirstTextureArrayUnit = NumberAvailableTextureUnits - MaxTextureArrays;
 
     /*******************************************************
      * @brief 
@@ -37,26 +44,32 @@ namespace Graphics
     public:
 
         TextureManager()= default;
-        ~TextureManager()=default; // delete all registered textures (and unbind them)
+        ~TextureManager(); // cancel pending loads, delete all registered textures (and unbind them)
 
         /*******************************************************
          * @brief Loads a texture and stores it.
          * @param textureFilePath File path of a texture, from Asset folder.
-         * @return Pointer to texture, or nullptr if placement failed.
+         * @return Pointer to texture, or nullptr if it could not be loaded, a texture
+         * already stored under the path is kept then.
          *******************************************************/
         std::shared_ptr<Texture> const& RegisterTexture(std::string const& textureFilePath);
         /*******************************************************
-         * @brief Load textures in parallel.(Multi-threads)
+         * @brief Load textures in parallel on the shared asset loader
+         * and block until all of them are built.
          * @param textureFilePaths A list of all texture file names that we are gonna load parallelly
          * @return A map of texture pointers loaded.
          *******************************************************/
         std::map<std::string /*textureName*/, std::shared_ptr<Texture> >& RegisterTextureMultiThread(std::vector<std::string> const& textureFilePaths);
         /*******************************************************
          * @brief Load textures while in other threads but main thread is not blocked.
+         * Every texture is registered right away with a placeholder image, which
+         * ProcessThreadLoadedTexture replaces once the file is decoded.
          * @param textureFilePaths A list of all texture file names that we are gonna load parallelly
+         * @param priority Loads with a higher priority are decoded first.
          * @return A list of texture pointers loaded.
          *******************************************************/
-        std::map<std::string /*textureName*/, std::shared_ptr<Texture> >& LoadTextureMultiThreadRealTime(std::vector<std::string> const& textureFilePaths);
+        std::map<std::string /*textureName*/, std::shared_ptr<Texture> >& LoadTextureMultiThreadRealTime(std::vector<std::string> const& textureFilePaths,
+                                                                                                        AssetPriority priority = AssetPriority::Normal);
 
         /*******************************************************
          * @brief Puts an existing texture in the manager's container.
@@ -95,12 +108,96 @@ namespace Graphics
                          std::string const& samplerUniformName, TextureType slot);
 
         /*******************************************************
-         * @brief Check if there's any thread finished loading texture.
-         * If it finishes, the function will pop the top one and return it.
-         * @return On success, a pointer to a loaded texture.
-         *         On failure, nullptr.
+         * @brief Upload textures the loader threads finished decoding, called
+         * by the main thread once per frame. Uploads stop once the budget is
+         * used up and continue next frame, so a burst of finished loads does
+         * not stall a single frame.
+         * @param budgetMilliseconds Time the main thread may spend uploading.
+         * @return Number of textures still loading or waiting for upload.
+         *******************************************************/
+        size_t ProcessThreadLoadedTexture(float budgetMilliseconds = 4.0f);
+
+        /*******************************************************
+         * @brief Fill the texture cache ahead of time (offline), with
+         * mips and block compression as currently set, without
+         * uploading anything. Later loads then only read the cache.
+         * @return Number of textures that could be cached.
+         *******************************************************/
+        size_t BakeTextureCache(std::vector<std::string> const& textureFilePaths);
+
+        // Block compression of textures loaded from now on.
+        void SetTextureCompression(TextureCompression compression) { m_compression = compression; }
+        TextureCompression GetTextureCompression() const { return m_compression; }
+
+        /*******************************************************
+         * @brief Stream textures loaded from now on: they are loaded
+         * with their levels up to 64x64 only, finer levels are loaded
+         * as objects using them need them (see RequestTextureDetail)
+         * and evicted least recently used first to stay in budget.
+         * @param budgetBytes Video memory of streamed textures, 0 loads
+         * textures whole again.
+         *******************************************************/
+        void SetStreamingBudget(u64 budgetBytes);
+        bool IsStreaming() const { return m_streamingBudget != 0; }
+        TextureResidency& GetResidency() { return m_residency; }
+        /*******************************************************
+         * @brief A texture is drawn this frame, does nothing if it is
+         * not streamed.
+         * @param uvPerPixel Texture coordinates one screen pixel covers,
+         * see TextureResidency::EstimateUvPerPixel.
+         *******************************************************/
+        void RequestTextureDetail(std::shared_ptr<Texture> const& texture, float uvPerPixel);
+        /*******************************************************
+         * @brief Called by the main thread once per frame, after the
+         * frame is drawn: drops evicted levels, starts loading the
+         * levels requested and uploads the ones that are read.
+         * @param budgetMilliseconds Time the main thread may spend uploading.
+         *******************************************************/
+        void UpdateStreaming(float budgetMilliseconds = 2.0f);
+        // Resident levels of a streamed texture, zeroed if it is not streamed.
+        TextureResidencyStats GetStreamingStats(std::string const& textureName) const;
+
+        /*******************************************************
+         * @brief Keep material textures in texture arrays, one array
+         * per size, level count and format, so materials refer to
+         * their textures by array and layer (see MaterialTable) and
+         * draws need no texture binds. A texture in an array is a
+         * view of its layer with no storage of its own, and the
+         * arrays count against the streaming budget. Turning them
+         * off rebuilds the textures.
          *******************************************************/
-        size_t ProcessThreadLoadedTexture();
+        void SetTextureArraysEnabled(bool enabled);
+        bool IsTextureArraysEnabled() const { return m_textureArrays; }
+        /*******************************************************
+         * @brief Array layer of a texture, it is copied to one the first
+         * time and again after every rebuild (loaded, streamed in),
+         * and made a view of it. A texture keeps its layer as long as
+         * its level 0 keeps its size, whatever levels are resident.
+         * @return An invalid layer if the texture is not built or every
+         * array is taken by other sizes.
+         *******************************************************/
+        TextureLayer GetTextureLayer(std::shared_ptr<Texture> const& texture);
+        /*******************************************************
+         * @brief Once per frame: free the layers of textures that are
+         * gone, copy rebuilt textures in again and place the ones
+         * that were not built or found no room before.
+         *******************************************************/
+        void UpdateTextureArrays();
+        // Goes up whenever a texture gets, loses or changes its layer; records that refer to layers are out of date.
+        u32 GetTextureArrayVersion() const { return m_arrayVersion; }
+        /*******************************************************
+         * @brief Bind every texture array to its unit and the
+         * MaterialTextureArrays samplers of a program to them, once
+         * per pass. Units of unused arrays get nothing bound.
+         *******************************************************/
+        void BindTextureArrays(std::shared_ptr<ShaderProgram> const& program) const;
+
+        /*******************************************************
+         * @brief Cancel every texture load not uploaded yet. The
+         * textures keep their placeholder image.
+         * @return Number of loads cancelled.
+         *******************************************************/
+        size_t CancelPendingLoads();
 
 
         /*******************************************************
@@ -136,22 +233,70 @@ namespace Graphics
         std::vector<std::shared_ptr<Texture> > GetAllTextures() const;
         std::map<std::string /*textureName*/, std::shared_ptr<Texture>>& GetTextureMap() { return m_textures; }
     private:
-        void loadTextureThreadFunc(std::string const& path);
-
         // Disallow copying of this object.
         TextureManager(TextureManager const&) = delete;
         TextureManager& operator=(TextureManager const&) = delete;
 
         //used a map so the textures will be sorted. Texture in the same folder will be placed closely.
         std::map<std::string /*textureName*/, std::shared_ptr<Texture>> m_textures;
-        
-        //when a thread finishes loading a texture, it will put the texture in the queue
-        //so that the main thread can pop and build it.
-        std::list<std::shared_ptr<Texture> > m_loadingTextureQueue;
 
-        std::shared_mutex m_mapMutex;
+        //realtime loads not uploaded yet, finished ones are dropped every frame
+        std::vector<AssetLoadHandle> m_pendingLoads;
+
+        void registerStreamed(std::shared_ptr<Texture> const& texture, std::string const& textureName);
+        void unregisterStreamed(Texture const* texture);
+
+        struct StreamedTexture
+        {
+            std::shared_ptr<Texture> Image;
+            std::string CacheFile;
+        };
+        struct StreamLoad
+        {
+            AssetLoadHandle Handle;
+            u32 Texture = 0;
+        };
+        u64 m_streamingBudget = 0;
+        TextureResidency m_residency;
+        //indexed by residency id
+        std::vector<StreamedTexture> m_streamed;
+        std::unordered_map<Texture const*, u32> m_streamIds;
+        std::vector<StreamLoad> m_streamLoads;
+
+        //copy texture to its layer of the arrays, placing it first if it has none
+        //or its size changed; false if no array can hold it
+        bool placeInArray(Texture& texture, TextureLayer& layer);
+        //swap the GL texture of texture for a view of its layer, freeing its own storage
+        void aliasLayer(Texture& texture, TextureLayer const& layer);
+        //make the GL array of the allocator's array hold at least layers layers,
+        //views of a replaced array move to the new one
+        void reserveArray(u32 array, u32 layers);
+        //charge the storage of the arrays to the streaming budget
+        void updateReservedBytes();
+        void destroyTextureArrays();
+
+        struct ArrayedTexture
+        {
+            std::weak_ptr<Texture> Image;
+            TextureLayer Layer;
+            u32 BuildCount = 0;
+        };
+        //place texture if it has no layer or was rebuilt since it was placed
+        void refreshLayer(Texture& texture, ArrayedTexture& arrayed);
+        struct TextureArray
+        {
+            u32 Handle = 0;
+            u32 Layers = 0;
+            u32 Generation = 0;
+            u64 Bytes = 0;
+        };
+        bool m_textureArrays = false;
+        TextureLayerAllocator m_layerAllocator = TextureLayerAllocator(16, MaxTextureArrays);
+        std::vector<TextureArray> m_arrays;
+        std::unordered_map<Texture const*, ArrayedTexture> m_arrayed;
+        u32 m_arrayVersion = 0;
 
-        size_t m_remainingTextureToLoad = 0;
+        TextureCompression m_compression = TextureCompression::Fast;
     };
 }
 
@@ -0,0 +1,181 @@
+#ifndef H_TEXTURE_RESIDENCY
+#define H_TEXTURE_RESIDENCY
+#include "framework/Utilities.h"
+
+namespace Graphics
+{
+    enum class ResidencyAction : u8
+    {
+        Load,   //read Level and upload it, then call FinishLoad
+        Evict,  //drop Level, the texture keeps Level + 1 and coarser
+    };
+
+    struct ResidencyChange
+    {
+        u32 Texture = 0;
+        u32 Level = 0;
+        ResidencyAction Action = ResidencyAction::Load;
+    };
+
+    struct TextureResidencyStats
+    {
+        u32 LevelCount = 0;
+        //finest level in memory, levels below it are not
+        u32 ResidentLevel = 0;
+        //finest level the last request asked for, bias included
+        u32 WantedLevel = 0;
+        bool Loading = false;
+        u64 ResidentBytes = 0;
+        u64 LastUsedFrame = 0;
+    };
+
+    /*******************************************************
+     * @brief
+     * Decides which mips of streamed textures are kept in video
+     * memory. A texture always keeps its small tail levels; finer
+     * levels are asked for by the renderer every frame (see
+     * EstimateLevel) and loaded one level at a time, finest last.
+     * When a load does not fit the budget, levels of the least
+     * recently used textures are evicted first, then levels finer
+     * than what their textures still need. If that is not enough
+     * the mip bias goes up, so every texture asks for a coarser
+     * level, and comes back down once memory frees up.
+     *
+     * Pure CPU bookkeeping without GL calls, the caller performs
+     * the loads and evictions it returns (see TextureManager).
+     *******************************************************/
+    class TextureResidency
+    {
+    public:
+        explicit TextureResidency(u64 budgetBytes = 256ull * 1024 * 1024);
+
+        /*******************************************************
+         * @brief Start tracking a texture.
+         * @param levelBytes Size of every level, level 0 first.
+         * @param tailLevel First level that is always resident. It and
+         * all coarser levels must already be in memory.
+         * @return Id of the texture.
+         *******************************************************/
+        u32 AddTexture(std::vector<u64> const& levelBytes, u32 tailLevel);
+        // Forget a texture, its memory is released.
+        void RemoveTexture(u32 id);
+        void Clear();
+
+        /*******************************************************
+         * @brief The texture is drawn this frame and needs mip level
+         * (fractional, from EstimateLevel). Several requests in one
+         * frame keep the finest.
+         *******************************************************/
+        void RequestLevel(u32 id, float level);
+        /*******************************************************
+         * @brief End the frame: pick the loads and evictions that
+         * bring the resident levels closer to the requested ones
+         * within the budget. Evictions take effect right away, loads
+         * count against the budget until FinishLoad or CancelLoad.
+         * @param maxLoads Loads started at most, one per texture.
+         *******************************************************/
+        std::vector<ResidencyChange> Update(u32 maxLoads = 4);
+        void FinishLoad(u32 id, u32 level);
+        void CancelLoad(u32 id);
+        /*******************************************************
+         * @brief The levels of a texture are held in memory counted
+         * with SetReservedBytes (a texture array layer, which has
+         * room for every level): loading them costs nothing and
+         * evicting them frees nothing, so they are never evicted.
+         *******************************************************/
+        void SetExternal(u32 id, bool external);
+
+        void SetBudget(u64 budgetBytes) { m_budget = budgetBytes; }
+        u64 GetBudget() const { return m_budget; }
+        // Memory of resident levels plus levels being loaded, external textures left out.
+        u64 GetCommittedBytes() const { return m_committed; }
+        // Memory outside the streamed levels that shares the budget, the texture arrays.
+        void SetReservedBytes(u64 bytes) { m_reserved = bytes; }
+        u64 GetReservedBytes() const { return m_reserved; }
+        // Added to every request, positive values ask for coarser levels.
+        void SetMipBias(float bias) { m_baseBias = bias; }
+        // Bias in use, the set one plus the one from memory pressure.
+        float GetMipBias() const { return m_baseBias + m_pressureBias; }
+        u64 GetFrame() const { return m_frame; }
+        TextureResidencyStats GetStats(u32 id) const;
+
+        /*******************************************************
+         * @brief Mip level a texture needs on an object.
+         * @param textureSize Width or height of level 0, the larger.
+         * @param uvPerPixel Texture coordinates covered by one screen pixel.
+         *******************************************************/
+        static float EstimateLevel(u32 textureSize, float uvPerPixel);
+        /*******************************************************
+         * @brief Texture coordinates one screen pixel covers on an
+         * object, from its size on screen and its UV density.
+         * @param uvDensity Texture coordinates per object space unit.
+         * @param objectRadius Bounding radius in object space.
+         * @param worldRadius Bounding radius in world space.
+         * @param distance From the camera to the bounding sphere.
+         * @param fovY Vertical field of view in radians.
+         * @param screenHeight In pixels.
+         * @return 0 when the camera is inside the sphere.
+         *******************************************************/
+        static float EstimateUvPerPixel(float uvDensity, float objectRadius, float worldRadius,
+                                        float distance, float fovY, float screenHeight);
+
+        struct SimulationResult
+        {
+            u32 Textures = 0;
+            u32 Frames = 0;
+            u64 BudgetBytes = 0;
+            //largest simulated video memory in use, loads in flight included
+            u64 PeakBytes = 0;
+            u32 FramesOverBudget = 0;
+            u32 Loads = 0;
+            u32 Evictions = 0;
+            //resident minus requested level, averaged over visible textures
+            float AverageLevelError = 0.0f;
+            float FinalMipBias = 0.0f;
+            //bookkeeping agreed with the simulated memory every frame
+            bool Consistent = true;
+            float Milliseconds = 0.0f;
+        };
+        /*******************************************************
+         * @brief Run the controller against simulated video memory: a
+         * camera sweeps over a row of objects with textures of random
+         * sizes, loads finish a few frames after they are started.
+         *******************************************************/
+        static SimulationResult Simulate(u32 textureCount, u32 frames, u64 budgetBytes, u32 seed = 1);
+
+    private:
+        struct Entry
+        {
+            std::vector<u64> LevelBytes;
+            u32 TailLevel = 0;
+            u32 ResidentLevel = 0;
+            u32 WantedLevel = 0;
+            float RequestedLevel = 0.0f;
+            u64 LastUsedFrame = 0;
+            bool Requested = false;
+            bool Loading = false;
+            bool Alive = false;
+            bool External = false;
+        };
+
+        //if the finest resident level of entry may be dropped, levels a request
+        //still needs are only dropped when forced
+        static bool canEvict(Entry const& entry, bool force);
+        //resident levels plus the one loading
+        static u64 committedBytes(Entry const& entry);
+        //evict levels until bytes more fit the budget, never from texture except
+        bool makeRoom(u64 bytes, u32 except, bool force, std::vector<ResidencyChange>& changes);
+
+        std::vector<Entry> m_entries;
+        std::vector<u32> m_freeIds;
+        u64 m_budget;
+        u64 m_committed = 0;
+        u64 m_reserved = 0;
+        u64 m_frame = 1;
+        float m_baseBias = 0.0f;
+        float m_pressureBias = 0.0f;
+        u32 m_calmFrames = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef H_TRIANGLE_BVH
+#define H_TRIANGLE_BVH
+
+#include "core/Ray.h"
+#include "framework/Utilities.h"
+#include "math/MathBatch.h"
+
+#include <cfloat>
+
+namespace Graphics
+{
+    class TriangleMesh;
+
+    /*******************************************************
+     * @brief
+     * Static bounding volume hierarchy over the triangles of one
+     * mesh, for picking the exact triangle under the cursor
+     * instead of stopping at the bounding sphere.
+     *
+     * The tree is built top down with binned SAH. The top levels
+     * are split on the calling thread until there are enough
+     * subtrees for every core, which are then built in parallel
+     * and appended to the node array. Nodes are 32 bytes, two to
+     * a cache line, and the children of a node sit next to each
+     * other so one index reaches both.
+     *
+     * Leaf triangles are stored as structure of arrays (a corner
+     * and the two edges from it) in leaf order, padded with
+     * degenerate triangles to a multiple of the Math::Batch width
+     * at build time, so Batch::IntersectTriangles tests a whole
+     * leaf in one or two instructions per step. The SAH costs a
+     * leaf by the number of those steps, not triangles.
+     *
+     * Everything is in the mesh's object space: transform the
+     * ray there with Ray::Transform first. No GL calls are made.
+     *******************************************************/
+    class TriangleBvh
+    {
+    public:
+        struct Hit
+        {
+            //index of the triangle in the mesh
+            u32 Triangle = 0;
+            //along the ray, in units of its direction
+            float Distance = FLT_MAX;
+            //the hit point is a * (1 - U - V) + b * U + c * V
+            float U = 0.0f;
+            float V = 0.0f;
+        };
+
+        // Build over the triangles of the mesh, maxThreads 0 for one thread per core.
+        void Build(TriangleMesh const& mesh, u32 maxThreads = 0);
+        void Clear();
+
+        /*******************************************************
+         * @brief Nearest triangle along the ray, both sides count.
+         * @param hit Only hits closer than its Distance are taken,
+         * set when true is returned.
+         *******************************************************/
+        bool RayCast(Ray const& ray, Hit& hit) const;
+        /*******************************************************
+         * @brief Nearest triangles along a packet of rays walking the
+         * tree together: every node is tested against the whole
+         * packet with Batch::IntersectBox and only skipped when all
+         * of them miss it. Pays off for coherent rays, such as the
+         * camera rays of one screen tile.
+         * @param rays Only hits closer than their distance are taken,
+         * which is lowered to the hit. Directions need not be unit
+         * length, distances are in units of them.
+         * @param hits Set for the rays hit.
+         * @return true if any ray hit a triangle.
+         *******************************************************/
+        bool RayCastPacket(Math::RayArray& rays, Hit* hits) const;
+
+        u32 GetTriangleCount() const { return m_triangleCount; }
+        u32 GetNodeCount() const { return static_cast<u32>(m_nodes.size()); }
+        //bounds of all the triangles, only valid when there are any
+        Math::Vector3 GetBoundsMin() const { return m_nodes.empty() ? Math::Vector3(0.0f) : m_nodes[0].BoundsMin; }
+        Math::Vector3 GetBoundsMax() const { return m_nodes.empty() ? Math::Vector3(0.0f) : m_nodes[0].BoundsMax; }
+        //SAH cost with a traversal step costing as much as a batch of triangle tests
+        float GetCost() const;
+
+        struct Benchmark
+        {
+            u32 Triangles = 0;
+            u32 Nodes = 0;
+            float Cost = 0.0f;
+            float BuildMilliseconds = 0.0f;
+            float SingleThreadBuildMilliseconds = 0.0f;
+            u32 Rays = 0;
+            u32 RaysHit = 0;
+            float MegaRaysPerSecond = 0.0f;
+            //every triangle tested one at a time, over the first BruteForceRays rays only
+            u32 BruteForceRays = 0;
+            float BruteForceMegaRaysPerSecond = 0.0f;
+            //the tree and brute force hit the same triangles at the same distances
+            bool ResultsMatch = true;
+        };
+        /*******************************************************
+         * @brief Build a tree over the mesh and cast rays at it from
+         * random points around its bounding sphere towards random
+         * points inside, on one thread. Only reads the mesh.
+         *******************************************************/
+        static Benchmark Measure(TriangleMesh const& mesh, u32 rays = 100000, u32 bruteForceRays = 200);
+
+    private:
+        struct Node
+        {
+            Math::Vector3 BoundsMin;
+            //inner nodes: the left child, the right one is next to it; leaves: the first triangle
+            u32 LeftOrFirst = 0;
+            Math::Vector3 BoundsMax;
+            //triangles in a leaf including the padding, 0 for inner nodes
+            u32 Count = 0;
+            bool IsLeaf() const { return Count != 0; }
+        };
+
+        struct BuildState;
+        static void buildNode(BuildState& state, std::vector<Node>& nodes, u32 node, u32 begin, u32 end, u32 depth);
+        static bool splitNode(BuildState& state, Node const& node, u32 begin, u32 end, u32 depth, u32& mid);
+        void pack(BuildState const& state);
+        Math::TriangleSpan leafTriangles(Node const& leaf) const;
+
+        std::vector<Node> m_nodes;
+        //leaf triangles: corner a, edge b - a and edge c - a
+        Math::Vector3Array m_corners;
+        Math::Vector3Array m_edges1;
+        Math::Vector3Array m_edges2;
+        //mesh triangle of every packed one, the padding repeats the last real one
+        std::vector<u32> m_triangleIds;
+        u32 m_triangleCount = 0;
+    };
+}
+
+#endif
@@ -3,8 +3,10 @@
 
 #include "framework/Utilities.h"
 #include "math/Vector3.h"
+#include "math/MathBatch.h"
 #include "graphics/Mesh.h"
 #include "graphics/MeshManager.h"
+#include "graphics/TriangleBvh.h"
 
 namespace Graphics
 {
@@ -29,6 +31,7 @@ namespace Graphics
         : public Mesh
     {
         friend class MeshManager::TriangleMeshHandler;
+        friend class TriangleBvh;
     public:
         /*******************************************************
          * @brief vertex object used in OpenGL, data in the struct
@@ -113,6 +116,11 @@ namespace Graphics
          * @param defaultUvType Default uv type on the mesh.
          ******************************************************************/
         void Preprocess(DefaultUvType defaultUvType = DefaultUvType::None) override;
+        /*******************************************************************
+         * @brief Preprocess with the spherical UVs' atan2 and acos taken from
+         * the given tier of math/FastMath.h.
+         ******************************************************************/
+        void Preprocess(DefaultUvType defaultUvType, Math::MathTier uvTier);
 
 	    /*******************************************************************
          * @brief Retrieves the number of vertices stored within the mesh.
@@ -199,6 +207,17 @@ namespace Graphics
 
         void CalculateBoundingSphere() override;
 
+        /*******************************************************************
+         * @brief Nearest triangle hit by a ray in object space, through a
+         * TriangleBvh built on the first call. Picking is done on the main
+         * thread only, so the tree is built without a lock; preparing the
+         * positions again drops it.
+         ******************************************************************/
+        bool RayCast(Ray const& localRay, TriangleBvh::Hit& hit);
+        bool RayCast(Ray const& localRay, float* t) override;
+        // The tree RayCast uses, built here on the first call; shared so a RayTracer can keep it.
+        std::shared_ptr<TriangleBvh> GetBvh();
+
         size_t GetVertexSize() override;
         std::vector<size_t> GetAttributeElementSizes()override;
         std::vector<size_t> GetAttributeElementCounts()override;
@@ -207,27 +226,64 @@ namespace Graphics
 		///////////////////////////////////////////////////////////////////////
 		//		Helper functions to generate UVs as per vertex data
 		///////////////////////////////////////////////////////////////////////
-        TriangleMesh* CalcUvSpherical();
+        TriangleMesh* CalcUvSpherical(Math::MathTier tier = Math::MathTier::Precise);
         TriangleMesh* CalcUvBox();
         TriangleMesh* CalcTanBitan();
 
+        struct PreprocessBenchmark
+        {
+            u32 Vertices = 0;
+            u32 Triangles = 0;
+            //medians over the runs
+            float PreprocessMilliseconds = 0.0f;
+            float TangentMilliseconds = 0.0f;
+            //Preprocess with MathTier::Fast spherical UVs, and how far its UVs are from the precise ones
+            float FastPreprocessMilliseconds = 0.0f;
+            float FastUvError = 0.0f;
+        };
+        /*******************************************************************
+         * @brief Time Preprocess (spherical UVs) and CalcTanBitan on their
+         * own on a UV sphere of resolution x resolution quads, in memory.
+         ******************************************************************/
+        static PreprocessBenchmark MeasurePreprocess(u32 resolution = 256, u32 runs = 5);
+
     private:
 	    /*******************************************************************
          * @brief 
-         * Centers the mesh's vertices about the origin. This method is adaptive as
-         * more vertices are added. Called by Preprocess().
+         * Centers and normalizes the vertices, then fits the bounding sphere
+         * around them. The positions are copied out as structure of arrays
+         * once and every step runs on them with the Math::Batch kernels.
+         * Called by Preprocess() and the OBJ loader.
          ******************************************************************/
-        void centerMesh();
+        void preparePositions();
+
+        // Positions of every vertex as structure of arrays, and back.
+        Math::Vector3Array loadPositions() const;
+        void storePositions(Math::Vector3Array& positions);
 
-        // Normalizes the vertices within the extents [-0.5, 0.5]. This method is
-        // adaptive as more vertices are added. Called by Preprocess().
+	    /*******************************************************************
+         * @brief 
+         * Centers the mesh's vertices about the origin. This method is adaptive as
+         * more vertices are added. Called by preparePositions().
+         ******************************************************************/
+        void centerMesh(Math::Vector3Span positions);
 
 		/*******************************************************************
 		* @brief
 		* Normalizes the vertices within the extents [-0.5, 0.5]. This method is
-		* adaptive as more vertices are added. Called by Preprocess().
+		* adaptive as more vertices are added. Called by preparePositions().
+		******************************************************************/
+        void normalizeVertices(Math::Vector3Span positions);
+
+        void calculateBoundingSphere(Math::Vector3Span positions);
+
+		/*******************************************************************
+		* @brief
+		* Square root of the UV area over the surface area of all faces, so
+		* the average length in texture space of one object space unit.
+		* Called by Build(), once the UVs are final.
 		******************************************************************/
-        void normalizeVertices();
+        void calculateUvDensity();
 
         Math::Vector3 m_center = { 0,0,0 };
         std::vector<Vertex> m_vertices;
@@ -235,6 +291,8 @@ namespace Graphics
         std::vector<Math::Vector3> m_triangleNormals;
         std::vector<Math::Vector3> m_tangent;
         std::vector<Math::Vector3> m_bitangent;
+        //shared by copies, which have the same positions
+        std::shared_ptr<TriangleBvh> m_bvh;
 
     };
 }
@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file FastMath.h
+/// Declaration of the math policies: libm, and polynomial approximations of
+/// it in two accuracy tiers.
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "Reals.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Math
+{
+    ///How closely the functions of a math policy follow libm.
+    enum class MathTier
+    {
+        Precise,        //libm, through Reals.h
+        Fast,           //close to float precision, at a fraction of the cost
+        Approximate,    //about 4 or 5 digits, for UVs, weights and the like
+    };
+
+    ///The constants of the approximations, shared by TieredMath and the Batch
+    ///kernels so both compute the same thing. The polynomials are the Cephes
+    ///single precision ones for the Fast tier, and minimax fits of lower degree
+    ///over the same reduced ranges for the Approximate tier.
+    namespace FastMathConstants
+    {
+        //adding and subtracting 1.5 * 2^23 rounds a float of magnitude below 2^22 to an integer,
+        //which ends up in the low bits of the sum
+        constexpr float c_RoundMagic = 12582912.0f;
+        constexpr uint32_t c_RoundMagicBits = 0x4B400000u;
+        constexpr uint32_t c_SignBit = 0x80000000u;
+
+        constexpr float c_PiOver2 = 1.57079632679489661923f;
+        constexpr float c_PiOver4 = 0.78539816339744830962f;
+        constexpr float c_TwoOverPi = 0.63661977236758134308f;
+        //pi / 2 in three parts, the first two with few enough bits that q * part is exact for |q| < 2^13
+        constexpr float c_PiOver2Hi = 1.5703125f;
+        constexpr float c_PiOver2Mid = 4.837512969970703125e-4f;
+        constexpr float c_PiOver2Lo = 7.54978995489188216e-8f;
+
+        //sin(r) = r + r^3 * P(r^2) and cos(r) = 1 - r^2 / 2 + r^4 * P(r^2) on [-pi / 4, pi / 4]
+        constexpr float c_SinFast[3] = { -1.6666654611e-1f, 8.3321608736e-3f, -1.9515295891e-4f };
+        constexpr float c_CosFast[3] = { 4.166664568298827e-2f, -1.388731625493765e-3f, 2.443315711809948e-5f };
+        //sin(r) = r + r^3 * P(r^2) and cos(r) = 1 + r^2 * P(r^2)
+        constexpr float c_SinApprox[2] = { -1.666283309e-1f, 8.152992465e-3f };
+        constexpr float c_CosApprox[2] = { -4.997763038e-1f, 4.048893601e-2f };
+
+        //atan(t) = t + t^3 * P(t^2) on [-tan(pi / 8), tan(pi / 8)]
+        constexpr float c_TanPiOver8 = 0.4142135623730950f;
+        constexpr float c_AtanFast[4] = { -3.33329491539e-1f, 1.99777106478e-1f, -1.38776856032e-1f, 8.05374449538e-2f };
+        //atan(t) = t * P(t^2) on [0, 1], Abramowitz and Stegun 4.4.47
+        constexpr float c_AtanApprox[5] = { 0.9998660f, -0.3302995f, 0.1801410f, -0.0851330f, 0.0208351f };
+
+        //asin(s) = s + s^3 * P(s^2) on [0, 0.5]
+        constexpr float c_AsinFast[5] = { 1.6666752422e-1f, 7.4953002686e-2f, 4.5470025998e-2f, 2.4181311049e-2f,
+                                          4.2163199048e-2f };
+        //acos(a) = sqrt(1 - a) * P(a) on [0, 1], Abramowitz and Stegun 4.4.45
+        constexpr float c_AcosApprox[4] = { 1.5707288f, -0.2121144f, 0.0742610f, -0.0187293f };
+
+        //the inputs Exp clamps to, so 2^n stays a normal float
+        constexpr float c_ExpMin = -87.3f;
+        constexpr float c_ExpMax = 88.3f;
+        constexpr float c_Log2e = 1.44269504088896341f;
+        //ln(2) in two parts, the first exact when multiplied by an exponent
+        constexpr float c_Ln2Hi = 0.693359375f;
+        constexpr float c_Ln2Lo = -2.12194440e-4f;
+        //exp(r) = 1 + r + r^2 * P(r) on [-ln(2) / 2, ln(2) / 2]
+        constexpr float c_ExpFast[6] = { 5.0000001201e-1f, 1.6666665459e-1f, 4.1665795894e-2f, 8.3334519073e-3f,
+                                         1.3981999507e-3f, 1.9875691500e-4f };
+        constexpr float c_ExpApprox[2] = { 5.039409995e-1f, 1.666281074e-1f };
+
+        constexpr uint32_t c_SqrtHalfBits = 0x3F3504F3u;
+        constexpr float c_DenormalScale = 8388608.0f;
+        //log(1 + m) = m - m^2 / 2 + m^3 * P(m) on [sqrt(0.5) - 1, sqrt(2) - 1]
+        constexpr float c_LogFast[9] = { 3.3333331174e-1f, -2.4999993993e-1f, 2.0000714765e-1f, -1.6668057665e-1f,
+                                         1.4249322787e-1f, -1.2420140846e-1f, 1.1676998740e-1f, -1.1514610310e-1f,
+                                         7.0376836292e-2f };
+        constexpr float c_LogApprox[2] = { 3.516128659e-1f, -2.389985472e-1f };
+
+        constexpr uint32_t c_RsqrtMagic = 0x5F375A86u;
+    }
+
+    ///coefficients[0] + x * coefficients[1] + ... + x^(Count - 1) * coefficients[Count - 1],
+    ///in Horner's order and unrolled, which loops over the coefficients are not always.
+    template <size_t Count>
+    struct Horner
+    {
+        static float Evaluate(float x, float const* coefficients)
+        {
+            return Horner<Count - 1>::Evaluate(x, coefficients + 1) * x + coefficients[0];
+        }
+    };
+
+    template <>
+    struct Horner<1>
+    {
+        static float Evaluate(float, float const* coefficients) { return coefficients[0]; }
+    };
+
+    ///The libm functions, what every caller that doesn't pick a policy gets.
+    struct PreciseMath
+    {
+        static const MathTier Tier = MathTier::Precise;
+
+        static float Sin(float x) { return Math::Sin(x); }
+        static float Cos(float x) { return Math::Cos(x); }
+        static float ArcTan2(float y, float x) { return Math::ArcTan2(y, x); }
+        static float ArcCos(float x) { return Math::ArcCos(x); }
+        static float Exp(float x) { return std::exp(x); }
+        static float Log(float x) { return Math::Log(x); }
+        static float Rsqrt(float x) { return Math::Rsqrt(x); }
+    };
+
+    /*******************************************************
+     * @brief
+     * Polynomial approximations of the libm functions, in the
+     * Fast or the Approximate tier. Every function reduces its
+     * argument to a small range with a few multiplies and bit
+     * tricks and evaluates a polynomial there, without tables
+     * or branches that depend on the data, so the same code runs
+     * on any lane width: Batch has SIMD versions of each that
+     * give these results bit for bit.
+     *
+     * Largest error over every float in the domain, measured
+     * exhaustively against double precision libm with
+     * FastMathBenchmark::Measure(1):
+     *
+     *   function  domain          error    Fast     Approximate
+     *   Sin, Cos  |x| <= 8192     abs      9.4e-8   1.3e-5
+     *   ArcTan2   finite          abs      1.4e-7   1.2e-5
+     *   ArcCos    [-1, 1]         abs      1.5e-7   4.6e-5
+     *   Exp       [-87.3, 88.3]   rel      8.2e-8   1.2e-4
+     *   Log       > 0             abs*     8.2e-8   1.9e-4
+     *   Rsqrt     normal, > 0     rel      4.7e-6   1.8e-3
+     *
+     *   * relative once |log(x)| > 1
+     *
+     * Outside the domain: Sin and Cos lose accuracy as |x|
+     * grows, Exp clamps x to the domain, ArcCos clamps x to
+     * [-1, 1] instead of returning NaN, and ArcTan2 follows
+     * libm for signed zeros. Log follows libm for 0, negatives,
+     * inf and NaN. Rsqrt has no special cases.
+     *******************************************************/
+    template <MathTier TierOf>
+    struct TieredMath
+    {
+        static_assert(TierOf != MathTier::Precise, "PreciseMath is the libm policy");
+        static const MathTier Tier = TierOf;
+
+        static float Sin(float x)
+        {
+            float sine, cosine;
+            uint32_t quadrant = reduceHalfPi(x, sine, cosine);
+            //x = quadrant * pi / 2 + r, sin(x) cycles through sin(r), cos(r), -sin(r), -cos(r)
+            float value = (quadrant & 1u) ? cosine : sine;
+            return fromBits(bitsOf(value) ^ ((quadrant & 2u) << 30));
+        }
+
+        static float Cos(float x)
+        {
+            float sine, cosine;
+            uint32_t quadrant = reduceHalfPi(x, sine, cosine);
+            float value = (quadrant & 1u) ? sine : cosine;
+            return fromBits(bitsOf(value) ^ (((quadrant + 1u) & 2u) << 30));
+        }
+
+        static float ArcTan2(float y, float x)
+        {
+            using namespace FastMathConstants;
+            float absX = Math::Abs(x), absY = Math::Abs(y);
+            float high = absX > absY ? absX : absY;
+            float low = absX < absY ? absX : absY;
+            float angle;
+            if (Tier == MathTier::Fast)
+            {
+                //above tan(pi / 8), atan(t) = pi / 4 + atan((t - 1) / (t + 1))
+                bool shifted = high * c_TanPiOver8 < low;
+                float denominator = shifted ? low + high : high;
+                float t = (shifted ? low - high : low) / denominator;
+                t = denominator == 0.0f ? 0.0f : t;
+                float z = t * t;
+                angle = t + t * z * polynomial(z, c_AtanFast);
+                angle = angle + (shifted ? c_PiOver4 : 0.0f);
+            }
+            else
+            {
+                float t = low / high;
+                t = high == 0.0f ? 0.0f : t;
+                float z = t * t;
+                angle = t * polynomial(z, c_AtanApprox);
+            }
+            angle = absX < absY ? c_PiOver2 - angle : angle;
+            //by the sign bit, so atan2(+-0, -0) is +-pi like libm
+            angle = (bitsOf(x) & c_SignBit) ? c_Pi - angle : angle;
+            return fromBits(bitsOf(angle) ^ (bitsOf(y) & c_SignBit));
+        }
+
+        static float ArcCos(float x)
+        {
+            using namespace FastMathConstants;
+            float absX = Math::Abs(x);
+            absX = absX < 1.0f ? absX : 1.0f;
+            if (Tier == MathTier::Fast)
+            {
+                //above 0.5, asin(a) = pi / 2 - 2 * asin(sqrt((1 - a) / 2))
+                bool reflected = 0.5f < absX;
+                float z = reflected ? 0.5f * (1.0f - absX) : absX * absX;
+                float s = reflected ? Math::Sqrt(z) : absX;
+                float arcSin = polynomial(z, c_AsinFast) * z * s + s;
+                float signedAngle = fromBits(bitsOf(reflected ? arcSin + arcSin : arcSin) ^ (bitsOf(x) & c_SignBit));
+                return reflected ? (x < 0.0f ? c_Pi : 0.0f) + signedAngle : c_PiOver2 - signedAngle;
+            }
+            float angle = Math::Sqrt(1.0f - absX) * polynomial(absX, c_AcosApprox);
+            return x < 0.0f ? c_Pi - angle : angle;
+        }
+
+        static float Exp(float x)
+        {
+            using namespace FastMathConstants;
+            x = x > c_ExpMin ? x : c_ExpMin;
+            x = x < c_ExpMax ? x : c_ExpMax;
+            //x = n * ln(2) + r, exp(x) = 2^n * exp(r)
+            float rounded = x * c_Log2e + c_RoundMagic;
+            float n = rounded - c_RoundMagic;
+            float r = x - n * c_Ln2Hi;
+            r = r - n * c_Ln2Lo;
+            float z = r * r;
+            float poly = Tier == MathTier::Fast ? polynomial(r, c_ExpFast) : polynomial(r, c_ExpApprox);
+            float value = poly * z + r + 1.0f;
+            return value * fromBits((bitsOf(rounded) + (127u - c_RoundMagicBits)) << 23);
+        }
+
+        static float Log(float x)
+        {
+            using namespace FastMathConstants;
+            //x = 2^e * m with m in [sqrt(0.5), sqrt(2)), log(x) = e * ln(2) + log(m); taking the bits of
+            //sqrt(0.5) off first leaves e in the (signed) exponent bits and m - sqrt(0.5) in the mantissa
+            bool denormal = x < FLT_MIN;
+            uint32_t bits = bitsOf(denormal ? x * c_DenormalScale : x) - c_SqrtHalfBits;
+            float exponent = static_cast<float>(static_cast<int32_t>(bits) >> 23) - (denormal ? 23.0f : 0.0f);
+            float m = fromBits((bits & 0x007FFFFFu) + c_SqrtHalfBits) - 1.0f;
+            float z = m * m;
+            float poly = Tier == MathTier::Fast ? polynomial(m, c_LogFast) : polynomial(m, c_LogApprox);
+            float y = poly * m * z;
+            y = y + exponent * c_Ln2Lo;
+            y = y - 0.5f * z;
+            float value = m + y;
+            value = value + exponent * c_Ln2Hi;
+            value = x < std::numeric_limits<float>::infinity() ? value : x;
+            value = x < 0.0f ? std::numeric_limits<float>::quiet_NaN() : value;
+            return x == 0.0f ? -std::numeric_limits<float>::infinity() : value;
+        }
+
+        static float Rsqrt(float x)
+        {
+            using namespace FastMathConstants;
+            //the bit pattern of x, halved and negated, is close to the one of 1 / sqrt(x); Newton steps refine it
+            float half = x * 0.5f;
+            float y = fromBits(c_RsqrtMagic - static_cast<uint32_t>(static_cast<int32_t>(bitsOf(x)) >> 1));
+            y = y * (1.5f - half * y * y);
+            if (Tier == MathTier::Fast)
+                y = y * (1.5f - half * y * y);
+            return y;
+        }
+
+    private:
+        static uint32_t bitsOf(float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        static float fromBits(uint32_t bits)
+        {
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        template <size_t Count>
+        static float polynomial(float x, float const (&coefficients)[Count])
+        {
+            return Horner<Count>::Evaluate(x, coefficients);
+        }
+
+        //sin and cos of r = x - quadrant * pi / 2, returns the quadrant (mod 4)
+        static uint32_t reduceHalfPi(float x, float& sine, float& cosine)
+        {
+            using namespace FastMathConstants;
+            float rounded = x * c_TwoOverPi + c_RoundMagic;
+            float q = rounded - c_RoundMagic;
+            float r = x - q * c_PiOver2Hi;
+            r = r - q * c_PiOver2Mid;
+            r = r - q * c_PiOver2Lo;
+            float z = r * r;
+            if (Tier == MathTier::Fast)
+            {
+                sine = r + r * z * polynomial(z, c_SinFast);
+                cosine = (1.0f - 0.5f * z) + z * z * polynomial(z, c_CosFast);
+            }
+            else
+            {
+                sine = r + r * z * polynomial(z, c_SinApprox);
+                cosine = 1.0f + z * polynomial(z, c_CosApprox);
+            }
+            return bitsOf(rounded);
+        }
+    };
+
+    typedef TieredMath<MathTier::Fast> FastMath;
+    typedef TieredMath<MathTier::Approximate> ApproxMath;
+
+    ///Accuracy and cost of one function of FastMath or ApproxMath.
+    struct FastMathBenchmark
+    {
+        char const* Function = "";
+        MathTier Tier = MathTier::Fast;
+        //floats checked, and the largest error over them: relative for Exp and Rsqrt, absolute otherwise
+        unsigned long long Inputs = 0;
+        double MaxError = 0.0;
+        //what TieredMath documents
+        double ErrorBound = 0.0;
+        //per call, of the scalar function and of PreciseMath's
+        float Nanoseconds = 0.0f;
+        float PreciseNanoseconds = 0.0f;
+        bool Passed = true;
+
+        /*******************************************************
+         * @brief Compare every function of both tiers with double
+         * precision libm over the floats of its domain, and time
+         * each against PreciseMath. Every stride-th float is
+         * checked; the default of 1 checks all of them, some 35
+         * billion inputs over both tiers spread over every core,
+         * about 45 minutes of CPU time. --selftest samples every
+         * 257th float, --selftest --exhaustive runs all of them.
+         *******************************************************/
+        static std::vector<FastMathBenchmark> Measure(unsigned stride = 1);
+    };
+}
@@ -19,4 +19,6 @@
 #include "Quaternion.h"
 #include "EulerAngles.h"
 #include "MathFunctions.h"
+#include "MathSimd.h"
+#include "MathBatch.h"
 
@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatch.h
+/// Declaration of the batched math kernels over structure of arrays spans.
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "Reals.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4.h"
+#include "FastMath.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+///The SIMD backends load the rows of a matrix, so like MathSimd.h they need the
+///ColumnBasis layout of MatrixStorage.h, and they only exist on x86. Everything
+///else, and builds with MATH_FORCE_SCALAR, runs the scalar kernels.
+#if defined(ColumnBasis) && !defined(MATH_FORCE_SCALAR) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+  #define MATH_BATCH_X86 1
+#else
+  #define MATH_BATCH_X86 0
+#endif
+
+namespace Math
+{
+    ///count Vector3s stored as structure of arrays, the i-th one is (x[i], y[i], z[i]).
+    struct Vector3Span
+    {
+        float* x = nullptr;
+        float* y = nullptr;
+        float* z = nullptr;
+        size_t count = 0;
+    };
+
+    ///count spheres stored as structure of arrays, centered at (x[i], y[i], z[i]).
+    struct SphereSpan
+    {
+        float* x = nullptr;
+        float* y = nullptr;
+        float* z = nullptr;
+        float* radius = nullptr;
+        size_t count = 0;
+    };
+
+    ///Storage for a Vector3Span.
+    struct Vector3Array
+    {
+        Vector3Array() = default;
+        explicit Vector3Array(size_t count) { Resize(count); }
+
+        void Resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); }
+        size_t Size() const { return x.size(); }
+        Vector3Span GetSpan()
+        {
+            Vector3Span span;
+            span.x = x.data();
+            span.y = y.data();
+            span.z = z.data();
+            span.count = x.size();
+            return span;
+        }
+        Vector3 Get(size_t index) const { return Vector3(x[index], y[index], z[index]); }
+        void Set(size_t index, Vec3Param vector) { x[index] = vector.x; y[index] = vector.y; z[index] = vector.z; }
+
+        std::vector<float> x, y, z;
+    };
+
+    ///Storage for a SphereSpan.
+    struct SphereArray
+    {
+        SphereArray() = default;
+        explicit SphereArray(size_t count) { Resize(count); }
+
+        void Resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); radius.resize(count); }
+        size_t Size() const { return x.size(); }
+        SphereSpan GetSpan()
+        {
+            SphereSpan span;
+            span.x = x.data();
+            span.y = y.data();
+            span.z = z.data();
+            span.radius = radius.data();
+            span.count = x.size();
+            return span;
+        }
+
+        std::vector<float> x, y, z, radius;
+    };
+
+    ///count triangles as structure of arrays: the first corner (x[i], y[i], z[i])
+    ///and the edges from it to the second and third corners.
+    struct TriangleSpan
+    {
+        float const* x = nullptr;
+        float const* y = nullptr;
+        float const* z = nullptr;
+        float const* edge1X = nullptr;
+        float const* edge1Y = nullptr;
+        float const* edge1Z = nullptr;
+        float const* edge2X = nullptr;
+        float const* edge2Y = nullptr;
+        float const* edge2Z = nullptr;
+        size_t count = 0;
+    };
+
+    ///Nearest hit of Batch::IntersectTriangles.
+    struct TriangleHit
+    {
+        size_t index = 0;
+        //along the ray, in units of its direction
+        float distance = FLT_MAX;
+        //the hit point is corner + u * edge1 + v * edge2
+        float u = 0.0f;
+        float v = 0.0f;
+    };
+
+    ///count rays as structure of arrays: ray i starts at (x[i], y[i], z[i]), 1 / its direction
+    ///is (inverseX[i], inverseY[i], inverseZ[i]) and it ends at distance[i] along the direction.
+    struct RaySpan
+    {
+        float const* x = nullptr;
+        float const* y = nullptr;
+        float const* z = nullptr;
+        float const* inverseX = nullptr;
+        float const* inverseY = nullptr;
+        float const* inverseZ = nullptr;
+        float const* distance = nullptr;
+        size_t count = 0;
+    };
+
+    ///Storage for a RaySpan, with the directions themselves for the triangle tests.
+    struct RayArray
+    {
+        RayArray() = default;
+        explicit RayArray(size_t count) { Resize(count); }
+
+        void Resize(size_t count)
+        {
+            start.Resize(count);
+            direction.Resize(count);
+            inverse.Resize(count);
+            distance.resize(count);
+        }
+        size_t Size() const { return distance.size(); }
+        void Set(size_t index, Vec3Param rayStart, Vec3Param rayDirection, float rayDistance = FLT_MAX)
+        {
+            start.Set(index, rayStart);
+            direction.Set(index, rayDirection);
+            distance[index] = rayDistance;
+            UpdateInverse(index);
+        }
+        ///Recompute inverse[index] after direction[index] changed. Components too small to
+        ///invert become a large finite value instead of an infinity, so the slab test of
+        ///Batch::IntersectBox never multiplies an infinity by 0.
+        void UpdateInverse(size_t index)
+        {
+            inverse.x[index] = safeInverse(direction.x[index]);
+            inverse.y[index] = safeInverse(direction.y[index]);
+            inverse.z[index] = safeInverse(direction.z[index]);
+        }
+        void UpdateInverses()
+        {
+            for (size_t i = 0; i < Size(); ++i)
+                UpdateInverse(i);
+        }
+        RaySpan GetSpan() const
+        {
+            RaySpan span;
+            span.x = start.x.data();
+            span.y = start.y.data();
+            span.z = start.z.data();
+            span.inverseX = inverse.x.data();
+            span.inverseY = inverse.y.data();
+            span.inverseZ = inverse.z.data();
+            span.distance = distance.data();
+            span.count = distance.size();
+            return span;
+        }
+
+        Vector3Array start, direction, inverse;
+        std::vector<float> distance;
+
+    private:
+        static float safeInverse(float value)
+        {
+            const float c_limit = 1e-30f;
+            if (value > c_limit || value < -c_limit)
+                return 1.0f / value;
+            return value < 0.0f ? -1.0f / c_limit : 1.0f / c_limit;
+        }
+    };
+
+    ///Instruction sets the batch kernels are built for, from narrowest to widest.
+    enum class BatchBackend
+    {
+        Scalar,     //1 element at a time, the reference the others are checked against
+        SSE2,       //4 wide
+        AVX2,       //8 wide
+        AVX512,     //16 wide, AVX-512F
+    };
+
+    /*******************************************************
+     * @brief
+     * Math over whole arrays of elements at once, for the bulk
+     * work (mesh preprocessing, world bounding spheres) that used
+     * to loop one Vector3 at a time. The kernels run 4, 8 or 16
+     * elements per instruction; the widest backend the CPU and OS
+     * support is picked with cpuid the first time a kernel runs,
+     * so one build uses AVX-512 where it is there and still runs
+     * on SSE2-only machines. The last count % width elements go
+     * through the scalar kernel.
+     *
+     * Apart from Sum, every backend gives the same results, bit
+     * for bit, as the scalar kernel and the Vector3 / Matrix4 /
+     * BoundingSphere code it replaces. Output spans may be the
+     * input spans, but must not partially overlap them.
+     *******************************************************/
+    class Batch
+    {
+    public:
+        // Backend the kernels run on now.
+        static BatchBackend GetBackend();
+        // Widest backend this CPU supports.
+        static BatchBackend GetBestBackend();
+        // Run on backend, or the best one if the CPU doesn't support it. Meant for benchmarks.
+        static void SetBackend(BatchBackend backend);
+        static char const* GetBackendName(BatchBackend backend);
+        // Elements per instruction, 1 for Scalar.
+        static unsigned GetWidth(BatchBackend backend);
+
+        // Copy out.count Vector3s that are strideBytes apart, e.g. the positions in a vertex buffer.
+        static void Load(Vector3 const* first, size_t strideBytes, Vector3Span out);
+        // Copy in.count Vector3s back to memory strideBytes apart.
+        static void Store(Vector3Span in, Vector3* first, size_t strideBytes);
+
+        // out[i] = matrix * (in[i], 1), like TransformPoint.
+        static void TransformPoints(Mat4Param matrix, Vector3Span in, Vector3Span out);
+        // out[i] = matrix * (in[i], 0), like TransformNormal.
+        static void TransformNormals(Mat4Param matrix, Vector3Span in, Vector3Span out);
+        // out[i] = in[i] + offset.
+        static void Translate(Vector3Span in, Vec3Param offset, Vector3Span out);
+        // out[i] = in[i] * scale.
+        static void Scale(Vector3Span in, float scale, Vector3Span out);
+        // out[i] = in[i].Normalized(), zero vectors give NaNs like Normalized does.
+        static void Normalize(Vector3Span in, Vector3Span out);
+        // out[i] = Dot(lhs[i], rhs[i]).
+        static void Dot(Vector3Span lhs, Vector3Span rhs, float* out);
+
+        // Sum of every element, summed in another order than a plain loop.
+        static Vector3 Sum(Vector3Span in);
+        // Per axis minimum and maximum, in.count must not be 0.
+        static void MinMax(Vector3Span in, Vector3& minimum, Vector3& maximum);
+        // Largest LengthSq, 0 for no elements.
+        static float MaxLengthSq(Vector3Span in);
+
+        /*******************************************************
+         * @brief out[i] = in[i] transformed by transforms[i], the
+         * same sphere BoundingSphere::Transformed gives: the center
+         * is transformed and the radius scaled by the largest axis.
+         *******************************************************/
+        static void TransformSpheres(Matrix4 const* transforms, SphereSpan in, SphereSpan out);
+        /*******************************************************
+         * @brief Test spheres against planes (xyz normal pointing
+         * inwards, w distance, like Frustum::Planes).
+         * @param inside Set to 1 for the spheres that are not fully
+         * behind any plane, 0 for the others.
+         * @return The number of spheres inside.
+         *******************************************************/
+        static size_t TestSpheres(Vector4 const* planes, unsigned planeCount, SphereSpan spheres, unsigned char* inside);
+
+        /*******************************************************
+         * @brief out[i] = f(in[i]) for the functions of the math
+         * policies in FastMath.h, at the given tier. Precise calls
+         * libm one element at a time; Fast and Approximate give the
+         * results of FastMath and ApproxMath bit for bit, with the
+         * domain and error TieredMath documents. out may be in.
+         *******************************************************/
+        static void Sin(MathTier tier, float const* in, float* out, size_t count);
+        static void Cos(MathTier tier, float const* in, float* out, size_t count);
+        static void ArcTan2(MathTier tier, float const* y, float const* x, float* out, size_t count);
+        static void ArcCos(MathTier tier, float const* in, float* out, size_t count);
+        static void Exp(MathTier tier, float const* in, float* out, size_t count);
+        static void Log(MathTier tier, float const* in, float* out, size_t count);
+        static void Rsqrt(MathTier tier, float const* in, float* out, size_t count);
+
+        /*******************************************************
+         * @brief Möller-Trumbore test of one ray against every
+         * triangle, both sides count. Triangles without area (zero
+         * edges) never hit, so they can pad a span to the width.
+         * @param hit Only hits closer than hit.distance and further
+         * than 0 are taken; on a tie the lowest index wins.
+         * @return true if hit was changed.
+         *******************************************************/
+        static bool IntersectTriangles(Vec3Param start, Vec3Param direction, TriangleSpan triangles, TriangleHit& hit);
+        /*******************************************************
+         * @brief Slab test of every ray against one box, for
+         * walking a tree with a packet of rays at once.
+         * @param entries Set to the distance each ray enters the box
+         * at, 0 when it starts inside, FLT_MAX when it misses it or
+         * gets there only after its distance.
+         * @return The smallest entry, FLT_MAX when no ray hits.
+         *******************************************************/
+        static float IntersectBox(Vec3Param minimum, Vec3Param maximum, RaySpan rays, float* entries);
+
+        struct Benchmark
+        {
+            char const* Operation = "";
+            BatchBackend Backend = BatchBackend::Scalar;
+            float ElementsPerNanosecond = 0.0f;
+            //largest difference to the scalar backend, in ULPs of the largest element of its result
+            //(Sum is compared to a double precision sum instead)
+            float MaxUlps = 0.0f;
+            float UlpTolerance = 0.0f;
+            bool Passed = true;
+        };
+        /*******************************************************
+         * @brief Run every kernel on every backend the CPU supports
+         * over count random elements, one Benchmark per kernel and
+         * backend. Leaves the backend as it was.
+         *******************************************************/
+        static std::vector<Benchmark> Measure(unsigned count = 1 << 16, unsigned seed = 1);
+    };
+}
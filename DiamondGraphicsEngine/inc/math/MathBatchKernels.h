@@ -0,0 +1,836 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatchKernels.h
+/// Kernels behind Batch, written once for any lane width. Only the
+/// MathBatch*.cpp files include this.
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "MathBatch.h"
+
+namespace Math
+{
+    ///One function per Batch kernel, for one backend.
+    struct BatchKernels
+    {
+        void (*TransformPoints)(Mat4Param matrix, Vector3Span in, Vector3Span out);
+        void (*TransformNormals)(Mat4Param matrix, Vector3Span in, Vector3Span out);
+        void (*Translate)(Vector3Span in, Vec3Param offset, Vector3Span out);
+        void (*Scale)(Vector3Span in, float scale, Vector3Span out);
+        void (*Normalize)(Vector3Span in, Vector3Span out);
+        void (*Dot)(Vector3Span lhs, Vector3Span rhs, float* out);
+        Vector3 (*Sum)(Vector3Span in);
+        void (*MinMax)(Vector3Span in, Vector3& minimum, Vector3& maximum);
+        float (*MaxLengthSq)(Vector3Span in);
+        void (*TransformSpheres)(Matrix4 const* transforms, SphereSpan in, SphereSpan out);
+        size_t (*TestSpheres)(Vector4 const* planes, unsigned planeCount, SphereSpan spheres, unsigned char* inside);
+        bool (*IntersectTriangles)(Vec3Param start, Vec3Param direction, TriangleSpan triangles, TriangleHit& hit);
+        float (*IntersectBox)(Vec3Param minimum, Vec3Param maximum, RaySpan rays, float* entries);
+        //the FastMath.h functions, only ever called with MathTier::Fast or MathTier::Approximate
+        void (*Sin)(MathTier tier, float const* in, float* out, size_t count);
+        void (*Cos)(MathTier tier, float const* in, float* out, size_t count);
+        void (*ArcTan2)(MathTier tier, float const* y, float const* x, float* out, size_t count);
+        void (*ArcCos)(MathTier tier, float const* in, float* out, size_t count);
+        void (*Exp)(MathTier tier, float const* in, float* out, size_t count);
+        void (*Log)(MathTier tier, float const* in, float* out, size_t count);
+        void (*Rsqrt)(MathTier tier, float const* in, float* out, size_t count);
+    };
+
+    ///Defined by MathBatch.cpp and MathBatch<Backend>.cpp, each built for its instruction set.
+    BatchKernels const& GetBatchKernelsScalar();
+#if MATH_BATCH_X86
+    BatchKernels const& GetBatchKernelsSse2();
+    BatchKernels const& GetBatchKernelsAvx2();
+    BatchKernels const& GetBatchKernelsAvx512();
+#endif
+
+    ///Everything below is compiled once per backend, with that backend's
+    ///instruction set enabled, so it has internal linkage: the linker must not
+    ///pick the AVX-512 copy of a kernel for the SSE2 table.
+    namespace
+    {
+        ///One lane, also what every backend runs the last count % Width elements on.
+        ///A backend's lane type has the same members over its SIMD register.
+        struct ScalarLanes
+        {
+            typedef float Float;
+            typedef int32_t Int;
+            typedef bool Mask;
+            static const unsigned Width = 1;
+
+            static Float Load(float const* source) { return *source; }
+            static void Store(float* destination, Float value) { *destination = value; }
+            static Float Set(float value) { return value; }
+            static Float Add(Float lhs, Float rhs) { return lhs + rhs; }
+            static Float Sub(Float lhs, Float rhs) { return lhs - rhs; }
+            static Float Mul(Float lhs, Float rhs) { return lhs * rhs; }
+            static Float Div(Float lhs, Float rhs) { return lhs / rhs; }
+            //lhs when it is not larger/smaller, like minps/maxps and Math::Min/Max
+            static Float Min(Float lhs, Float rhs) { return lhs < rhs ? lhs : rhs; }
+            static Float Max(Float lhs, Float rhs) { return lhs > rhs ? lhs : rhs; }
+            static Float Sqrt(Float value) { return Math::Sqrt(value); }
+            static Mask Less(Float lhs, Float rhs) { return lhs < rhs; }
+            static Mask LessEqual(Float lhs, Float rhs) { return lhs <= rhs; }
+            static Mask Equal(Float lhs, Float rhs) { return lhs == rhs; }
+            static Mask And(Mask lhs, Mask rhs) { return lhs && rhs; }
+            static Mask Or(Mask lhs, Mask rhs) { return lhs || rhs; }
+            static Mask NoLanes() { return false; }
+            //bit i set for lane i
+            static unsigned Bits(Mask mask) { return mask ? 1u : 0u; }
+            static Float Select(Mask mask, Float ifTrue, Float ifFalse) { return mask ? ifTrue : ifFalse; }
+
+            //the bits of the floats as 32 bit integers, which wrap around like paddd and psubd
+            static Int AsInt(Float value)
+            {
+                Int bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                return bits;
+            }
+            static Float AsFloat(Int bits)
+            {
+                Float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+            static Int IntSet(uint32_t value) { return static_cast<Int>(value); }
+            static Int IntAdd(Int lhs, Int rhs) { return static_cast<Int>(static_cast<uint32_t>(lhs) + static_cast<uint32_t>(rhs)); }
+            static Int IntSub(Int lhs, Int rhs) { return static_cast<Int>(static_cast<uint32_t>(lhs) - static_cast<uint32_t>(rhs)); }
+            static Int IntAnd(Int lhs, Int rhs) { return lhs & rhs; }
+            static Int IntXor(Int lhs, Int rhs) { return lhs ^ rhs; }
+            static Mask IntEqual(Int lhs, Int rhs) { return lhs == rhs; }
+            static Int ShiftLeft(Int value, int count) { return static_cast<Int>(static_cast<uint32_t>(value) << count); }
+            //arithmetic, like psrad
+            static Int ShiftRight(Int value, int count) { return value >> count; }
+            static Float IntToFloat(Int value) { return static_cast<Float>(value); }
+            //rows[r][c] holds element (r, c) of transforms[0] to transforms[Width - 1]
+            static void LoadRows(Matrix4 const* transforms, Float rows[3][4])
+            {
+                for (unsigned r = 0; r < 3; ++r)
+                {
+                    for (unsigned c = 0; c < 4; ++c)
+                        rows[r][c] = transforms[0](r, c);
+                }
+            }
+        };
+
+        template <typename Lanes>
+        float reduceAdd(typename Lanes::Float value)
+        {
+            float lanes[Lanes::Width];
+            Lanes::Store(lanes, value);
+            float sum = lanes[0];
+            for (unsigned i = 1; i < Lanes::Width; ++i)
+                sum += lanes[i];
+            return sum;
+        }
+
+        template <typename Lanes>
+        float reduceMin(typename Lanes::Float value)
+        {
+            float lanes[Lanes::Width];
+            Lanes::Store(lanes, value);
+            float minimum = lanes[0];
+            for (unsigned i = 1; i < Lanes::Width; ++i)
+                minimum = lanes[i] < minimum ? lanes[i] : minimum;
+            return minimum;
+        }
+
+        template <typename Lanes>
+        float reduceMax(typename Lanes::Float value)
+        {
+            float lanes[Lanes::Width];
+            Lanes::Store(lanes, value);
+            float maximum = lanes[0];
+            for (unsigned i = 1; i < Lanes::Width; ++i)
+                maximum = lanes[i] > maximum ? lanes[i] : maximum;
+            return maximum;
+        }
+
+        //every kernel runs from element first in steps of Width, and returns where it stopped
+
+        template <typename L>
+        size_t transformPoints(Mat4Param matrix, Vector3Span in, Vector3Span out, size_t first)
+        {
+            typename L::Float m[3][4];
+            for (unsigned r = 0; r < 3; ++r)
+            {
+                for (unsigned c = 0; c < 4; ++c)
+                    m[r][c] = L::Set(matrix(r, c));
+            }
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                //summed in the order of TransformPoint
+                typename L::Float outX = L::Add(L::Add(L::Add(L::Mul(m[0][0], x), L::Mul(m[0][1], y)), L::Mul(m[0][2], z)), m[0][3]);
+                typename L::Float outY = L::Add(L::Add(L::Add(L::Mul(m[1][0], x), L::Mul(m[1][1], y)), L::Mul(m[1][2], z)), m[1][3]);
+                typename L::Float outZ = L::Add(L::Add(L::Add(L::Mul(m[2][0], x), L::Mul(m[2][1], y)), L::Mul(m[2][2], z)), m[2][3]);
+                L::Store(out.x + i, outX);
+                L::Store(out.y + i, outY);
+                L::Store(out.z + i, outZ);
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t transformNormals(Mat4Param matrix, Vector3Span in, Vector3Span out, size_t first)
+        {
+            typename L::Float m[3][3];
+            for (unsigned r = 0; r < 3; ++r)
+            {
+                for (unsigned c = 0; c < 3; ++c)
+                    m[r][c] = L::Set(matrix(r, c));
+            }
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                typename L::Float outX = L::Add(L::Add(L::Mul(m[0][0], x), L::Mul(m[0][1], y)), L::Mul(m[0][2], z));
+                typename L::Float outY = L::Add(L::Add(L::Mul(m[1][0], x), L::Mul(m[1][1], y)), L::Mul(m[1][2], z));
+                typename L::Float outZ = L::Add(L::Add(L::Mul(m[2][0], x), L::Mul(m[2][1], y)), L::Mul(m[2][2], z));
+                L::Store(out.x + i, outX);
+                L::Store(out.y + i, outY);
+                L::Store(out.z + i, outZ);
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t translate(Vector3Span in, Vec3Param offset, Vector3Span out, size_t first)
+        {
+            typename L::Float offsetX = L::Set(offset.x), offsetY = L::Set(offset.y), offsetZ = L::Set(offset.z);
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                L::Store(out.x + i, L::Add(L::Load(in.x + i), offsetX));
+                L::Store(out.y + i, L::Add(L::Load(in.y + i), offsetY));
+                L::Store(out.z + i, L::Add(L::Load(in.z + i), offsetZ));
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t scale(Vector3Span in, float factor, Vector3Span out, size_t first)
+        {
+            typename L::Float scalar = L::Set(factor);
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                L::Store(out.x + i, L::Mul(L::Load(in.x + i), scalar));
+                L::Store(out.y + i, L::Mul(L::Load(in.y + i), scalar));
+                L::Store(out.z + i, L::Mul(L::Load(in.z + i), scalar));
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t normalize(Vector3Span in, Vector3Span out, size_t first)
+        {
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                //divided by the length like Vector3::Normalized, not multiplied by its reciprocal
+                typename L::Float length = L::Sqrt(L::Add(L::Add(L::Mul(x, x), L::Mul(y, y)), L::Mul(z, z)));
+                L::Store(out.x + i, L::Div(x, length));
+                L::Store(out.y + i, L::Div(y, length));
+                L::Store(out.z + i, L::Div(z, length));
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t dot(Vector3Span lhs, Vector3Span rhs, float* out, size_t first)
+        {
+            size_t i = first;
+            for (; i + L::Width <= lhs.count; i += L::Width)
+            {
+                typename L::Float sum = L::Add(L::Mul(L::Load(lhs.x + i), L::Load(rhs.x + i)),
+                                               L::Mul(L::Load(lhs.y + i), L::Load(rhs.y + i)));
+                L::Store(out + i, L::Add(sum, L::Mul(L::Load(lhs.z + i), L::Load(rhs.z + i))));
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t sum(Vector3Span in, Vector3& result, size_t first)
+        {
+            typename L::Float sumX = L::Set(0.0f), sumY = L::Set(0.0f), sumZ = L::Set(0.0f);
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                sumX = L::Add(sumX, L::Load(in.x + i));
+                sumY = L::Add(sumY, L::Load(in.y + i));
+                sumZ = L::Add(sumZ, L::Load(in.z + i));
+            }
+            result.x += reduceAdd<L>(sumX);
+            result.y += reduceAdd<L>(sumY);
+            result.z += reduceAdd<L>(sumZ);
+            return i;
+        }
+
+        template <typename L>
+        size_t minMax(Vector3Span in, Vector3& minimum, Vector3& maximum, size_t first)
+        {
+            typename L::Float minX = L::Set(minimum.x), minY = L::Set(minimum.y), minZ = L::Set(minimum.z);
+            typename L::Float maxX = L::Set(maximum.x), maxY = L::Set(maximum.y), maxZ = L::Set(maximum.z);
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                minX = L::Min(x, minX);
+                minY = L::Min(y, minY);
+                minZ = L::Min(z, minZ);
+                maxX = L::Max(x, maxX);
+                maxY = L::Max(y, maxY);
+                maxZ = L::Max(z, maxZ);
+            }
+            minimum = Vector3(reduceMin<L>(minX), reduceMin<L>(minY), reduceMin<L>(minZ));
+            maximum = Vector3(reduceMax<L>(maxX), reduceMax<L>(maxY), reduceMax<L>(maxZ));
+            return i;
+        }
+
+        template <typename L>
+        size_t maxLengthSq(Vector3Span in, float& result, size_t first)
+        {
+            typename L::Float maximum = L::Set(result);
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                maximum = L::Max(L::Add(L::Add(L::Mul(x, x), L::Mul(y, y)), L::Mul(z, z)), maximum);
+            }
+            result = reduceMax<L>(maximum);
+            return i;
+        }
+
+        template <typename L>
+        size_t transformSpheres(Matrix4 const* transforms, SphereSpan in, SphereSpan out, size_t first)
+        {
+            size_t i = first;
+            for (; i + L::Width <= in.count; i += L::Width)
+            {
+                typename L::Float m[3][4];
+                L::LoadRows(transforms + i, m);
+                typename L::Float x = L::Load(in.x + i), y = L::Load(in.y + i), z = L::Load(in.z + i);
+                typename L::Float outX = L::Add(L::Add(L::Add(L::Mul(m[0][0], x), L::Mul(m[0][1], y)), L::Mul(m[0][2], z)), m[0][3]);
+                typename L::Float outY = L::Add(L::Add(L::Add(L::Mul(m[1][0], x), L::Mul(m[1][1], y)), L::Mul(m[1][2], z)), m[1][3]);
+                typename L::Float outZ = L::Add(L::Add(L::Add(L::Mul(m[2][0], x), L::Mul(m[2][1], y)), L::Mul(m[2][2], z)), m[2][3]);
+
+                //length of the basis vectors, the columns
+                typename L::Float axis[3];
+                for (unsigned c = 0; c < 3; ++c)
+                    axis[c] = L::Sqrt(L::Add(L::Add(L::Mul(m[0][c], m[0][c]), L::Mul(m[1][c], m[1][c])), L::Mul(m[2][c], m[2][c])));
+                typename L::Float scale = L::Max(axis[0], L::Max(axis[1], axis[2]));
+
+                L::Store(out.radius + i, L::Mul(L::Load(in.radius + i), scale));
+                L::Store(out.x + i, outX);
+                L::Store(out.y + i, outY);
+                L::Store(out.z + i, outZ);
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t testSpheres(Vector4 const* planes, unsigned planeCount, SphereSpan spheres, unsigned char* inside,
+                           size_t& insideCount, size_t first)
+        {
+            const typename L::Float zero = L::Set(0.0f);
+            size_t i = first;
+            for (; i + L::Width <= spheres.count; i += L::Width)
+            {
+                typename L::Float x = L::Load(spheres.x + i), y = L::Load(spheres.y + i), z = L::Load(spheres.z + i);
+                typename L::Float radius = L::Load(spheres.radius + i);
+                typename L::Mask outside = L::NoLanes();
+                for (unsigned p = 0; p < planeCount; ++p)
+                {
+                    //summed in the order of Frustum::IntersectsSphere, NaNs count as inside like there
+                    typename L::Float distance = L::Add(L::Add(L::Mul(L::Set(planes[p].x), x), L::Mul(L::Set(planes[p].y), y)),
+                                                        L::Mul(L::Set(planes[p].z), z));
+                    distance = L::Add(L::Add(distance, L::Set(planes[p].w)), radius);
+                    outside = L::Or(outside, L::Less(distance, zero));
+                }
+                unsigned bits = L::Bits(outside);
+                for (unsigned lane = 0; lane < L::Width; ++lane)
+                {
+                    unsigned char laneInside = (bits >> lane) & 1u ? 0 : 1;
+                    inside[i + lane] = laneInside;
+                    insideCount += laneInside;
+                }
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t intersectTriangles(Vec3Param start, Vec3Param direction, TriangleSpan triangles, TriangleHit& hit,
+                                  bool& found, size_t first)
+        {
+            typedef typename L::Float F;
+            const F zero = L::Set(0.0f), one = L::Set(1.0f);
+            const F startX = L::Set(start.x), startY = L::Set(start.y), startZ = L::Set(start.z);
+            const F directionX = L::Set(direction.x), directionY = L::Set(direction.y), directionZ = L::Set(direction.z);
+            size_t i = first;
+            for (; i + L::Width <= triangles.count; i += L::Width)
+            {
+                F edge1X = L::Load(triangles.edge1X + i), edge1Y = L::Load(triangles.edge1Y + i), edge1Z = L::Load(triangles.edge1Z + i);
+                F edge2X = L::Load(triangles.edge2X + i), edge2Y = L::Load(triangles.edge2Y + i), edge2Z = L::Load(triangles.edge2Z + i);
+                //p = direction x edge2, and its dot product with edge1 the determinant; no area gives 0 and NaNs below
+                F pX = L::Sub(L::Mul(directionY, edge2Z), L::Mul(directionZ, edge2Y));
+                F pY = L::Sub(L::Mul(directionZ, edge2X), L::Mul(directionX, edge2Z));
+                F pZ = L::Sub(L::Mul(directionX, edge2Y), L::Mul(directionY, edge2X));
+                F inverse = L::Div(one, L::Add(L::Add(L::Mul(edge1X, pX), L::Mul(edge1Y, pY)), L::Mul(edge1Z, pZ)));
+                F sX = L::Sub(startX, L::Load(triangles.x + i));
+                F sY = L::Sub(startY, L::Load(triangles.y + i));
+                F sZ = L::Sub(startZ, L::Load(triangles.z + i));
+                F qX = L::Sub(L::Mul(sY, edge1Z), L::Mul(sZ, edge1Y));
+                F qY = L::Sub(L::Mul(sZ, edge1X), L::Mul(sX, edge1Z));
+                F qZ = L::Sub(L::Mul(sX, edge1Y), L::Mul(sY, edge1X));
+                F u = L::Mul(L::Add(L::Add(L::Mul(sX, pX), L::Mul(sY, pY)), L::Mul(sZ, pZ)), inverse);
+                F v = L::Mul(L::Add(L::Add(L::Mul(directionX, qX), L::Mul(directionY, qY)), L::Mul(directionZ, qZ)), inverse);
+                F t = L::Mul(L::Add(L::Add(L::Mul(edge2X, qX), L::Mul(edge2Y, qY)), L::Mul(edge2Z, qZ)), inverse);
+                //written so NaNs fail every comparison
+                typename L::Mask inside = L::And(L::And(L::LessEqual(zero, u), L::LessEqual(zero, v)),
+                                                 L::And(L::LessEqual(L::Add(u, v), one),
+                                                        L::And(L::Less(zero, t), L::Less(t, L::Set(hit.distance)))));
+                unsigned bits = L::Bits(inside);
+                if (bits == 0)
+                    continue;
+                float distances[L::Width], us[L::Width], vs[L::Width];
+                L::Store(distances, t);
+                L::Store(us, u);
+                L::Store(vs, v);
+                for (unsigned lane = 0; lane < L::Width; ++lane)
+                {
+                    if ((bits >> lane) & 1u && distances[lane] < hit.distance)
+                    {
+                        hit.index = i + lane;
+                        hit.distance = distances[lane];
+                        hit.u = us[lane];
+                        hit.v = vs[lane];
+                        found = true;
+                    }
+                }
+            }
+            return i;
+        }
+
+        template <typename L>
+        size_t intersectBox(Vec3Param minimum, Vec3Param maximum, RaySpan rays, float* entries, float& nearest,
+                            size_t first)
+        {
+            typedef typename L::Float F;
+            const F minX = L::Set(minimum.x), minY = L::Set(minimum.y), minZ = L::Set(minimum.z);
+            const F maxX = L::Set(maximum.x), maxY = L::Set(maximum.y), maxZ = L::Set(maximum.z);
+            const F zero = L::Set(0.0f), miss = L::Set(FLT_MAX);
+            F closest = L::Set(nearest);
+            size_t i = first;
+            for (; i + L::Width <= rays.count; i += L::Width)
+            {
+                F startX = L::Load(rays.x + i), startY = L::Load(rays.y + i), startZ = L::Load(rays.z + i);
+                F inverseX = L::Load(rays.inverseX + i), inverseY = L::Load(rays.inverseY + i), inverseZ = L::Load(rays.inverseZ + i);
+                F nearX = L::Mul(L::Sub(minX, startX), inverseX), farX = L::Mul(L::Sub(maxX, startX), inverseX);
+                F nearY = L::Mul(L::Sub(minY, startY), inverseY), farY = L::Mul(L::Sub(maxY, startY), inverseY);
+                F nearZ = L::Mul(L::Sub(minZ, startZ), inverseZ), farZ = L::Mul(L::Sub(maxZ, startZ), inverseZ);
+                F enter = L::Max(L::Max(L::Min(nearX, farX), L::Min(nearY, farY)), L::Max(L::Min(nearZ, farZ), zero));
+                F exit = L::Min(L::Min(L::Max(nearX, farX), L::Max(nearY, farY)),
+                                L::Min(L::Max(nearZ, farZ), L::Load(rays.distance + i)));
+                F entry = L::Select(L::LessEqual(enter, exit), enter, miss);
+                L::Store(entries + i, entry);
+                closest = L::Min(entry, closest);
+            }
+            nearest = reduceMin<L>(closest);
+            return i;
+        }
+
+        //The FastMath.h functions, each a step for step copy of its TieredMath function so every backend
+        //gives the same bits. Apply runs one Tier on a Float of lanes.
+
+        template <typename L, size_t Count>
+        struct LanesHorner
+        {
+            static typename L::Float Evaluate(typename L::Float x, float const* coefficients)
+            {
+                return L::Add(L::Mul(LanesHorner<L, Count - 1>::Evaluate(x, coefficients + 1), x), L::Set(coefficients[0]));
+            }
+        };
+
+        template <typename L>
+        struct LanesHorner<L, 1>
+        {
+            static typename L::Float Evaluate(typename L::Float, float const* coefficients) { return L::Set(coefficients[0]); }
+        };
+
+        template <typename L, size_t Count>
+        typename L::Float polynomial(typename L::Float x, float const (&coefficients)[Count])
+        {
+            return LanesHorner<L, Count>::Evaluate(x, coefficients);
+        }
+
+        template <typename L>
+        typename L::Float absOf(typename L::Float x)
+        {
+            return L::AsFloat(L::IntAnd(L::AsInt(x), L::IntSet(~FastMathConstants::c_SignBit)));
+        }
+
+        template <typename L>
+        typename L::Int signOf(typename L::Float x)
+        {
+            return L::IntAnd(L::AsInt(x), L::IntSet(FastMathConstants::c_SignBit));
+        }
+
+        //x with its sign flipped in the lanes where sign has the sign bit set
+        template <typename L>
+        typename L::Float flipSign(typename L::Float x, typename L::Int sign)
+        {
+            return L::AsFloat(L::IntXor(L::AsInt(x), sign));
+        }
+
+        template <MathTier Tier, typename L>
+        typename L::Int reduceHalfPi(typename L::Float x, typename L::Float& sine, typename L::Float& cosine)
+        {
+            using namespace FastMathConstants;
+            typedef typename L::Float F;
+            F rounded = L::Add(L::Mul(x, L::Set(c_TwoOverPi)), L::Set(c_RoundMagic));
+            F q = L::Sub(rounded, L::Set(c_RoundMagic));
+            F r = L::Sub(x, L::Mul(q, L::Set(c_PiOver2Hi)));
+            r = L::Sub(r, L::Mul(q, L::Set(c_PiOver2Mid)));
+            r = L::Sub(r, L::Mul(q, L::Set(c_PiOver2Lo)));
+            F z = L::Mul(r, r);
+            if (Tier == MathTier::Fast)
+            {
+                sine = L::Add(r, L::Mul(L::Mul(r, z), polynomial<L>(z, c_SinFast)));
+                cosine = L::Add(L::Sub(L::Set(1.0f), L::Mul(L::Set(0.5f), z)), L::Mul(L::Mul(z, z), polynomial<L>(z, c_CosFast)));
+            }
+            else
+            {
+                sine = L::Add(r, L::Mul(L::Mul(r, z), polynomial<L>(z, c_SinApprox)));
+                cosine = L::Add(L::Set(1.0f), L::Mul(z, polynomial<L>(z, c_CosApprox)));
+            }
+            return L::AsInt(rounded);
+        }
+
+        template <MathTier Tier>
+        struct SinKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                typename L::Float sine, cosine;
+                typename L::Int quadrant = reduceHalfPi<Tier, L>(x, sine, cosine);
+                typename L::Mask odd = L::IntEqual(L::IntAnd(quadrant, L::IntSet(1)), L::IntSet(1));
+                return flipSign<L>(L::Select(odd, cosine, sine), L::ShiftLeft(L::IntAnd(quadrant, L::IntSet(2)), 30));
+            }
+        };
+
+        template <MathTier Tier>
+        struct CosKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                typename L::Float sine, cosine;
+                typename L::Int quadrant = reduceHalfPi<Tier, L>(x, sine, cosine);
+                typename L::Mask odd = L::IntEqual(L::IntAnd(quadrant, L::IntSet(1)), L::IntSet(1));
+                typename L::Int sign = L::ShiftLeft(L::IntAnd(L::IntAdd(quadrant, L::IntSet(1)), L::IntSet(2)), 30);
+                return flipSign<L>(L::Select(odd, sine, cosine), sign);
+            }
+        };
+
+        template <MathTier Tier>
+        struct ArcTan2Kernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float y, typename L::Float x)
+            {
+                using namespace FastMathConstants;
+                typedef typename L::Float F;
+                const F zero = L::Set(0.0f);
+                F absX = absOf<L>(x), absY = absOf<L>(y);
+                F high = L::Max(absX, absY), low = L::Min(absX, absY);
+                F angle;
+                if (Tier == MathTier::Fast)
+                {
+                    typename L::Mask shifted = L::Less(L::Mul(high, L::Set(c_TanPiOver8)), low);
+                    F denominator = L::Select(shifted, L::Add(low, high), high);
+                    F t = L::Div(L::Select(shifted, L::Sub(low, high), low), denominator);
+                    t = L::Select(L::Equal(denominator, zero), zero, t);
+                    F z = L::Mul(t, t);
+                    angle = L::Add(t, L::Mul(L::Mul(t, z), polynomial<L>(z, c_AtanFast)));
+                    angle = L::Add(angle, L::Select(shifted, L::Set(c_PiOver4), zero));
+                }
+                else
+                {
+                    F t = L::Div(low, high);
+                    t = L::Select(L::Equal(high, zero), zero, t);
+                    angle = L::Mul(t, polynomial<L>(L::Mul(t, t), c_AtanApprox));
+                }
+                angle = L::Select(L::Less(absX, absY), L::Sub(L::Set(c_PiOver2), angle), angle);
+                typename L::Int signX = signOf<L>(x);
+                angle = L::Select(L::IntEqual(signX, L::IntSet(c_SignBit)), L::Sub(L::Set(c_Pi), angle), angle);
+                return flipSign<L>(angle, signOf<L>(y));
+            }
+        };
+
+        template <MathTier Tier>
+        struct ArcCosKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                using namespace FastMathConstants;
+                typedef typename L::Float F;
+                const F zero = L::Set(0.0f), one = L::Set(1.0f);
+                F absX = L::Min(absOf<L>(x), one);
+                if (Tier == MathTier::Fast)
+                {
+                    typename L::Mask reflected = L::Less(L::Set(0.5f), absX);
+                    F z = L::Select(reflected, L::Mul(L::Set(0.5f), L::Sub(one, absX)), L::Mul(absX, absX));
+                    F s = L::Select(reflected, L::Sqrt(z), absX);
+                    F arcSin = L::Add(L::Mul(L::Mul(polynomial<L>(z, c_AsinFast), z), s), s);
+                    F signedAngle = flipSign<L>(L::Select(reflected, L::Add(arcSin, arcSin), arcSin), signOf<L>(x));
+                    F offset = L::Select(L::Less(x, zero), L::Set(c_Pi), zero);
+                    return L::Select(reflected, L::Add(offset, signedAngle), L::Sub(L::Set(c_PiOver2), signedAngle));
+                }
+                F angle = L::Mul(L::Sqrt(L::Sub(one, absX)), polynomial<L>(absX, c_AcosApprox));
+                return L::Select(L::Less(x, zero), L::Sub(L::Set(c_Pi), angle), angle);
+            }
+        };
+
+        template <MathTier Tier>
+        struct ExpKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                using namespace FastMathConstants;
+                typedef typename L::Float F;
+                x = L::Min(L::Max(x, L::Set(c_ExpMin)), L::Set(c_ExpMax));
+                F rounded = L::Add(L::Mul(x, L::Set(c_Log2e)), L::Set(c_RoundMagic));
+                F n = L::Sub(rounded, L::Set(c_RoundMagic));
+                F r = L::Sub(x, L::Mul(n, L::Set(c_Ln2Hi)));
+                r = L::Sub(r, L::Mul(n, L::Set(c_Ln2Lo)));
+                F z = L::Mul(r, r);
+                F poly = Tier == MathTier::Fast ? polynomial<L>(r, c_ExpFast) : polynomial<L>(r, c_ExpApprox);
+                F value = L::Add(L::Add(L::Mul(poly, z), r), L::Set(1.0f));
+                typename L::Int scale = L::ShiftLeft(L::IntAdd(L::AsInt(rounded), L::IntSet(127u - c_RoundMagicBits)), 23);
+                return L::Mul(value, L::AsFloat(scale));
+            }
+        };
+
+        template <MathTier Tier>
+        struct LogKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                using namespace FastMathConstants;
+                typedef typename L::Float F;
+                const F zero = L::Set(0.0f);
+                typename L::Mask denormal = L::Less(x, L::Set(FLT_MIN));
+                typename L::Int bits = L::IntSub(L::AsInt(L::Select(denormal, L::Mul(x, L::Set(c_DenormalScale)), x)),
+                                                 L::IntSet(c_SqrtHalfBits));
+                F exponent = L::Sub(L::IntToFloat(L::ShiftRight(bits, 23)), L::Select(denormal, L::Set(23.0f), zero));
+                F m = L::Sub(L::AsFloat(L::IntAdd(L::IntAnd(bits, L::IntSet(0x007FFFFFu)), L::IntSet(c_SqrtHalfBits))),
+                             L::Set(1.0f));
+                F z = L::Mul(m, m);
+                F poly = Tier == MathTier::Fast ? polynomial<L>(m, c_LogFast) : polynomial<L>(m, c_LogApprox);
+                F y = L::Mul(L::Mul(poly, m), z);
+                y = L::Add(y, L::Mul(exponent, L::Set(c_Ln2Lo)));
+                y = L::Sub(y, L::Mul(L::Set(0.5f), z));
+                F value = L::Add(m, y);
+                value = L::Add(value, L::Mul(exponent, L::Set(c_Ln2Hi)));
+                value = L::Select(L::Less(x, L::Set(std::numeric_limits<float>::infinity())), value, x);
+                value = L::Select(L::Less(x, zero), L::Set(std::numeric_limits<float>::quiet_NaN()), value);
+                return L::Select(L::Equal(x, zero), L::Set(-std::numeric_limits<float>::infinity()), value);
+            }
+        };
+
+        template <MathTier Tier>
+        struct RsqrtKernel
+        {
+            template <typename L>
+            static typename L::Float Apply(typename L::Float x)
+            {
+                using namespace FastMathConstants;
+                typedef typename L::Float F;
+                F half = L::Mul(x, L::Set(0.5f));
+                F y = L::AsFloat(L::IntSub(L::IntSet(c_RsqrtMagic), L::ShiftRight(L::AsInt(x), 1)));
+                y = L::Mul(y, L::Sub(L::Set(1.5f), L::Mul(L::Mul(half, y), y)));
+                if (Tier == MathTier::Fast)
+                    y = L::Mul(y, L::Sub(L::Set(1.5f), L::Mul(L::Mul(half, y), y)));
+                return y;
+            }
+        };
+
+        template <typename L, typename Kernel>
+        size_t mapKernel(float const* in, float* out, size_t count, size_t first)
+        {
+            size_t i = first;
+            for (; i + L::Width <= count; i += L::Width)
+                L::Store(out + i, Kernel::template Apply<L>(L::Load(in + i)));
+            return i;
+        }
+
+        template <typename L, typename Kernel>
+        size_t mapKernel(float const* lhs, float const* rhs, float* out, size_t count, size_t first)
+        {
+            size_t i = first;
+            for (; i + L::Width <= count; i += L::Width)
+                L::Store(out + i, Kernel::template Apply<L>(L::Load(lhs + i), L::Load(rhs + i)));
+            return i;
+        }
+
+        ///The table of a backend: the Lanes kernels, then the scalar ones for the last elements.
+        template <typename L>
+        struct BatchKernelTable
+        {
+            static void TransformPoints(Mat4Param matrix, Vector3Span in, Vector3Span out)
+            {
+                transformPoints<ScalarLanes>(matrix, in, out, transformPoints<L>(matrix, in, out, 0));
+            }
+
+            static void TransformNormals(Mat4Param matrix, Vector3Span in, Vector3Span out)
+            {
+                transformNormals<ScalarLanes>(matrix, in, out, transformNormals<L>(matrix, in, out, 0));
+            }
+
+            static void Translate(Vector3Span in, Vec3Param offset, Vector3Span out)
+            {
+                translate<ScalarLanes>(in, offset, out, translate<L>(in, offset, out, 0));
+            }
+
+            static void Scale(Vector3Span in, float factor, Vector3Span out)
+            {
+                scale<ScalarLanes>(in, factor, out, scale<L>(in, factor, out, 0));
+            }
+
+            static void Normalize(Vector3Span in, Vector3Span out)
+            {
+                normalize<ScalarLanes>(in, out, normalize<L>(in, out, 0));
+            }
+
+            static void Dot(Vector3Span lhs, Vector3Span rhs, float* out)
+            {
+                dot<ScalarLanes>(lhs, rhs, out, dot<L>(lhs, rhs, out, 0));
+            }
+
+            static Vector3 Sum(Vector3Span in)
+            {
+                Vector3 result(0.0f, 0.0f, 0.0f);
+                sum<ScalarLanes>(in, result, sum<L>(in, result, 0));
+                return result;
+            }
+
+            static void MinMax(Vector3Span in, Vector3& minimum, Vector3& maximum)
+            {
+                minimum = maximum = Vector3(in.x[0], in.y[0], in.z[0]);
+                minMax<ScalarLanes>(in, minimum, maximum, minMax<L>(in, minimum, maximum, 0));
+            }
+
+            static float MaxLengthSq(Vector3Span in)
+            {
+                float result = 0.0f;
+                maxLengthSq<ScalarLanes>(in, result, maxLengthSq<L>(in, result, 0));
+                return result;
+            }
+
+            static void TransformSpheres(Matrix4 const* transforms, SphereSpan in, SphereSpan out)
+            {
+                transformSpheres<ScalarLanes>(transforms, in, out, transformSpheres<L>(transforms, in, out, 0));
+            }
+
+            static size_t TestSpheres(Vector4 const* planes, unsigned planeCount, SphereSpan spheres, unsigned char* inside)
+            {
+                size_t insideCount = 0;
+                testSpheres<ScalarLanes>(planes, planeCount, spheres, inside, insideCount,
+                    testSpheres<L>(planes, planeCount, spheres, inside, insideCount, 0));
+                return insideCount;
+            }
+
+            static bool IntersectTriangles(Vec3Param start, Vec3Param direction, TriangleSpan triangles, TriangleHit& hit)
+            {
+                bool found = false;
+                intersectTriangles<ScalarLanes>(start, direction, triangles, hit, found,
+                    intersectTriangles<L>(start, direction, triangles, hit, found, 0));
+                return found;
+            }
+
+            static float IntersectBox(Vec3Param minimum, Vec3Param maximum, RaySpan rays, float* entries)
+            {
+                float nearest = FLT_MAX;
+                intersectBox<ScalarLanes>(minimum, maximum, rays, entries, nearest,
+                    intersectBox<L>(minimum, maximum, rays, entries, nearest, 0));
+                return nearest;
+            }
+
+            template <template <MathTier> class Kernel>
+            static void mapTier(MathTier tier, float const* in, float* out, size_t count)
+            {
+                if (tier == MathTier::Fast)
+                {
+                    typedef Kernel<MathTier::Fast> Fast;
+                    mapKernel<ScalarLanes, Fast>(in, out, count, mapKernel<L, Fast>(in, out, count, 0));
+                }
+                else
+                {
+                    typedef Kernel<MathTier::Approximate> Approximate;
+                    mapKernel<ScalarLanes, Approximate>(in, out, count, mapKernel<L, Approximate>(in, out, count, 0));
+                }
+            }
+
+            static void Sin(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<SinKernel>(tier, in, out, count);
+            }
+
+            static void Cos(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<CosKernel>(tier, in, out, count);
+            }
+
+            static void ArcTan2(MathTier tier, float const* y, float const* x, float* out, size_t count)
+            {
+                if (tier == MathTier::Fast)
+                {
+                    typedef ArcTan2Kernel<MathTier::Fast> Fast;
+                    mapKernel<ScalarLanes, Fast>(y, x, out, count, mapKernel<L, Fast>(y, x, out, count, 0));
+                }
+                else
+                {
+                    typedef ArcTan2Kernel<MathTier::Approximate> Approximate;
+                    mapKernel<ScalarLanes, Approximate>(y, x, out, count, mapKernel<L, Approximate>(y, x, out, count, 0));
+                }
+            }
+
+            static void ArcCos(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<ArcCosKernel>(tier, in, out, count);
+            }
+
+            static void Exp(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<ExpKernel>(tier, in, out, count);
+            }
+
+            static void Log(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<LogKernel>(tier, in, out, count);
+            }
+
+            static void Rsqrt(MathTier tier, float const* in, float* out, size_t count)
+            {
+                mapTier<RsqrtKernel>(tier, in, out, count);
+            }
+
+            static BatchKernels const& Get()
+            {
+                static const BatchKernels kernels = { &TransformPoints, &TransformNormals, &Translate, &Scale, &Normalize,
+                    &Dot, &Sum, &MinMax, &MaxLengthSq, &TransformSpheres, &TestSpheres, &IntersectTriangles,
+                    &IntersectBox,
+                    &Sin, &Cos, &ArcTan2, &ArcCos, &Exp, &Log, &Rsqrt };
+                return kernels;
+            }
+        };
+    }
+}
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathSimd.h
+/// Declaration of the SIMD kernels behind Vector4, Matrix4 and Quaternion.
+///
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "Reals.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4.h"
+#include "Quaternion.h"
+
+///The backend is picked at compile time from the instruction sets the compiler
+///targets. AVX2 (/arch:AVX2, -mavx2) concatenates two rows at a time, SSE4.1
+///(/arch:AVX, -msse4.1) adds dot product and blend instructions on top of the
+///SSE2 kernels, and SSE2 is always there on x64 and with /arch:SSE2. Any other
+///target (ARM and NEON included) gets the scalar code, which is also the
+///reference the SIMD kernels are checked against. Define MATH_FORCE_SCALAR to
+///build the scalar code on x86 too. The kernels load the rows of a matrix, so
+///they need the ColumnBasis layout of MatrixStorage.h.
+#if defined(ColumnBasis) && !defined(MATH_FORCE_SCALAR) && defined(__AVX2__)
+  #define MATH_SIMD_AVX2 1
+#else
+  #define MATH_SIMD_AVX2 0
+#endif
+
+#if defined(ColumnBasis) && !defined(MATH_FORCE_SCALAR) && (defined(__SSE4_1__) || defined(__AVX__))
+  #define MATH_SIMD_SSE41 1
+#else
+  #define MATH_SIMD_SSE41 0
+#endif
+
+#if defined(ColumnBasis) && !defined(MATH_FORCE_SCALAR) && (MATH_SIMD_SSE41 || defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define MATH_SIMD_SSE2 1
+#else
+  #define MATH_SIMD_SSE2 0
+#endif
+
+#if MATH_SIMD_AVX2
+  #include <immintrin.h>
+#elif MATH_SIMD_SSE41
+  #include <smmintrin.h>
+#elif MATH_SIMD_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace Math
+{
+#if MATH_SIMD_SSE2
+    //_MM_SHUFFLE with the lanes in the order they end up in
+    #define MATH_SHUFFLE(x, y, z, w) _MM_SHUFFLE(w, z, y, x)
+
+    inline __m128 SimdLoad(Vec4Param vector) { return _mm_loadu_ps(vector.array); }
+    inline __m128 SimdLoad(QuatParam quat) { return _mm_loadu_ps(&quat.x); }
+    //w is 0, the float after a Vector3 is never read
+    inline __m128 SimdLoad(Vec3Param vector) { return _mm_setr_ps(vector.x, vector.y, vector.z, 0.0f); }
+
+    inline Vector4 SimdStoreVector4(__m128 value)
+    {
+        Vector4 ret;
+        _mm_storeu_ps(ret.array, value);
+        return ret;
+    }
+
+    inline Vector3 SimdStoreVector3(__m128 value)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, value);
+        return Vector3(lanes[0], lanes[1], lanes[2]);
+    }
+
+    //sum of the four lanes in every lane
+    inline __m128 SimdDot(__m128 lhs, __m128 rhs)
+    {
+#if MATH_SIMD_SSE41
+        return _mm_dp_ps(lhs, rhs, 0xFF);
+#else
+        __m128 product = _mm_mul_ps(lhs, rhs);
+        product = _mm_add_ps(product, _mm_shuffle_ps(product, product, MATH_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(product, _mm_shuffle_ps(product, product, MATH_SHUFFLE(1, 0, 3, 2)));
+#endif
+    }
+
+    //cross product of the xyz lanes, w is lhs.w * rhs.w - lhs.w * rhs.w (0 for finite input)
+    inline __m128 SimdCross(__m128 lhs, __m128 rhs)
+    {
+        __m128 lhsYzx = _mm_shuffle_ps(lhs, lhs, MATH_SHUFFLE(1, 2, 0, 3));
+        __m128 rhsYzx = _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(1, 2, 0, 3));
+        __m128 crossZxy = _mm_sub_ps(_mm_mul_ps(lhs, rhsYzx), _mm_mul_ps(lhsYzx, rhs));
+        return _mm_shuffle_ps(crossZxy, crossZxy, MATH_SHUFFLE(1, 2, 0, 3));
+    }
+#endif
+
+    /*******************************************************
+     * @brief
+     * The kernels Matrix4, Quaternion and Vector4 forward their
+     * hot operations to, in the backend picked above. Simd::Scalar
+     * keeps the plain code they replaced: it is what scalar builds
+     * run, and what Measure checks every kernel against.
+     *******************************************************/
+    class Simd
+    {
+    public:
+        // "AVX2", "SSE4.1", "SSE2" or "Scalar".
+        static char const* GetBackendName();
+
+        static Matrix4 Concat(Mat4Param lhs, Mat4Param rhs);
+        static Matrix4 Transposed(Mat4Param matrix);
+        static Matrix4 Inverted(Mat4Param matrix);
+        // Inverse of a matrix whose last row is (0, 0, 0, 1), the last row is not read.
+        static Matrix4 AffineInverted(Mat4Param matrix);
+        // Inverse of a translate * rotate * scale matrix, the upper 3x3 columns must be orthogonal.
+        static Matrix4 TrsInverted(Mat4Param matrix);
+        static Vector4 Transform(Mat4Param matrix, Vec4Param vector);
+        static Vector3 TransformPoint(Mat4Param matrix, Vec3Param point);
+        static Vector3 TransformNormal(Mat4Param matrix, Vec3Param normal);
+
+        // Dot products stay scalar, a single one is no faster in SIMD and would sum in another order.
+        static Vector4 Normalized(Vec4Param vector);
+
+        static Quaternion Multiply(QuatParam lhs, QuatParam rhs);
+        // Rotate by a unit quaternion, v + w * t + q x t with t = 2 * (q x v).
+        static Vector3 Rotated(QuatParam quat, Vec3Param vector);
+        static Quaternion Slerp(QuatParam start, QuatParam end, float tValue);
+
+        class Scalar
+        {
+        public:
+            static Matrix4 Concat(Mat4Param lhs, Mat4Param rhs);
+            static Matrix4 Transposed(Mat4Param matrix);
+            static Matrix4 Inverted(Mat4Param matrix);
+            static Matrix4 AffineInverted(Mat4Param matrix);
+            static Matrix4 TrsInverted(Mat4Param matrix);
+            static Vector4 Transform(Mat4Param matrix, Vec4Param vector);
+            static Vector3 TransformPoint(Mat4Param matrix, Vec3Param point);
+            static Vector3 TransformNormal(Mat4Param matrix, Vec3Param normal);
+
+            static Vector4 Normalized(Vec4Param vector);
+
+            static Quaternion Multiply(QuatParam lhs, QuatParam rhs);
+            // q * v * q^-1 with two full quaternion products.
+            static Vector3 Rotated(QuatParam quat, Vec3Param vector);
+            static Quaternion Slerp(QuatParam start, QuatParam end, float tValue);
+        };
+
+        struct Benchmark
+        {
+            char const* Operation = "";
+            float ScalarNanoseconds = 0.0f;
+            float SimdNanoseconds = 0.0f;
+            //largest difference to the scalar result, in ULPs of the largest element of that result
+            float MaxUlps = 0.0f;
+            float UlpTolerance = 0.0f;
+            //every sample matched the scalar result bit for bit
+            bool BitExact = true;
+            bool Passed = true;
+        };
+        /*******************************************************
+         * @brief Run every kernel and its scalar version over the
+         * same random, well conditioned inputs: compare the results
+         * and time each operation, one Benchmark per operation.
+         *******************************************************/
+        static std::vector<Benchmark> Measure(unsigned iterations = 1 << 16, unsigned seed = 1);
+        /*******************************************************
+         * @brief The comparison of Measure without the timing, over
+         * seeds sets of random inputs and a set of edge cases (identity
+         * and half turn rotations, large and small scales, zero, slerps
+         * between equal and opposite quaternions). MaxUlps, BitExact and
+         * Passed cover all of them; --selftest fails on !Passed.
+         *******************************************************/
+        static std::vector<Benchmark> Compare(unsigned seeds = 64, unsigned firstSeed = 1);
+    };
+}
@@ -91,6 +91,15 @@ typedef Vector4   CrossVector;
         ///Inverts this matrix in place.
         Mat4Ref Invert();
 
+        ///Returns the inverse of this matrix, which must be affine (last row
+        ///0, 0, 0, 1); cheaper than Inverted, the last row is not read.
+        Matrix4 AffineInverted() const;
+
+        ///Returns the inverse of a translate * rotate * scale matrix, one whose
+        ///upper 3x3 columns are orthogonal: the transposed rotation times the
+        ///reciprocal scale. Cheaper than AffineInverted, wrong for shears.
+        Matrix4 TrsInverted() const;
+
         ///Multiplies this matrix with the given matrix on its right-hand side.
         Matrix4 Concat(Mat4Param rhs) const;
 
@@ -247,4 +256,32 @@ typedef Vector4   CrossVector;
     Vector3 TransformPointProjectedCol(Mat4Param matrix, Vec3Param point, float* w);
 
     float Trace(Mat4Param matrix);
+
+    //--------------------------------------------------------- Inline Functions
+    inline float Matrix4::operator()(unsigned r, unsigned c) const
+    {
+#ifdef ColumnBasis
+        return array[c + r * 4];
+#else
+        return array[r + c * 4];
+#endif
+    }
+
+    inline float& Matrix4::operator()(unsigned r, unsigned c)
+    {
+#ifdef ColumnBasis
+        return array[c + r * 4];
+#else
+        return array[r + c * 4];
+#endif
+    }
+
+    inline Matrix4::CrossVector Matrix4::Cross(unsigned index) const
+    {
+#ifdef ColumnBasis
+        return (*this)[index];
+#else
+        return Vector4(array[index], array[4 + index], array[8 + index], array[12 + index]);
+#endif
+    }
 }// namespace Math
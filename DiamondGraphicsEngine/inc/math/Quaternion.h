@@ -82,6 +82,7 @@ struct Quaternion
   Quaternion Logarithm() const;
   //Quaternion Lerp(QuatParam end, float tValue);
   //Quaternion Slerp(QuatParam end, float tValue);
+  //Rotations by unit quaternions, the length is not divided out.
   void RotateVector(Vec3Ptr vector);
   Vector3 RotatedVector(Vec3Param vector) const;
   void ZeroOut();
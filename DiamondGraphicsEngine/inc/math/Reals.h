@@ -10,6 +10,10 @@
 
 #pragma once
 
+#include <cmath>
+#include <cstdlib>
+#include <cfloat>
+
 namespace Math
 {
 //a pointer of the given type
@@ -29,45 +33,149 @@ const unsigned cW = 3;
 //these cannot be constants
 extern const float& c_Infinite;
 
-const float c_Pi = 3.1415926535897932384626433832795f;
-const float c_TwoPi = 2.0f * c_Pi;
+constexpr float c_Pi = 3.1415926535897932384626433832795f;
+constexpr float c_TwoPi = 2.0f * c_Pi;
 
 //Golden ratio!
 const float c_GoldenRatio = 1.6180339887498948482045868343656f;
 
-float Epsilon();
-float PositiveMax();
-float PositiveMin();
-bool Equal(float lhs, float rhs);
-bool NotEqual(float lhs, float rhs);
-bool IsZero(float val);
-bool IsNegative(float number);
-bool IsPositive(float number);
-bool LessThan(float lhs, float rhs);
-bool LessThanOrEqual(float lhs, float rhs);
-bool GreaterThan(float lhs, float rhs);
-bool GreaterThanOrEqual(float lhs, float rhs);
-float Sqrt(float val);
-float Rsqrt(float val);
-float Sq(float sqrt);
+//The hot helpers are defined here so they inline (and fold constants) in every
+//translation unit without link time code generation; the heavier ones below
+//are defined in Reals.cpp.
+constexpr float Epsilon()
+{
+  return 0.000001f;
+}
+
+constexpr float PositiveMax()
+{
+  return FLT_MAX;
+}
+
+constexpr float PositiveMin()
+{
+  return FLT_MIN;
+}
+
+inline float Abs(float val)
+{
+  return std::abs(val);
+}
+
+inline int Abs(int val)
+{
+  return std::abs(val);
+}
+
+inline bool Equal(float lhs, float rhs)
+{
+  return Abs(lhs - rhs) <= Epsilon() * (Abs(lhs) + Abs(rhs) + 1.0f);
+}
+
+inline bool NotEqual(float lhs, float rhs)
+{
+  return !Equal(lhs, rhs);
+}
+
+inline bool IsZero(float val)
+{
+  return Abs(val) <= Epsilon();
+}
+
+//-1 when the sign bit is set (-0 included), 1 otherwise
+inline float GetSign(float val)
+{
+  return std::signbit(val) ? -1.0f : 1.0f;
+}
+
+inline bool IsNegative(float number)
+{
+  return std::signbit(number);
+}
+
+inline bool IsPositive(float number)
+{
+  return !std::signbit(number);
+}
+
+constexpr bool LessThan(float lhs, float rhs)
+{
+  return lhs < rhs;
+}
+
+constexpr bool LessThanOrEqual(float lhs, float rhs)
+{
+  return lhs <= rhs;
+}
+
+constexpr bool GreaterThan(float lhs, float rhs)
+{
+  return lhs > rhs;
+}
+
+constexpr bool GreaterThanOrEqual(float lhs, float rhs)
+{
+  return lhs >= rhs;
+}
+
+inline float Sqrt(float val)
+{
+  return std::sqrt(val);
+}
+
+inline float Rsqrt(float val)
+{
+  return 1.0f / std::sqrt(val);
+}
+
+constexpr float Sq(float sqrt)
+{
+  return sqrt * sqrt;
+}
+
+inline float Cos(float val)
+{
+  return std::cos(val);
+}
+
+inline float Sin(float val)
+{
+  return std::sin(val);
+}
+
+constexpr float RadToDeg(float radians)
+{
+  return (180.0f / c_Pi) * radians;
+}
+
+constexpr float DegToRad(float degrees)
+{
+  return (c_Pi / 180.0f) * degrees;
+}
+
+inline float Round(float val)
+{
+  return std::floor(val + 0.5f);
+}
+
+inline float Ceil(float val)
+{
+  return std::ceil(val);
+}
+
+inline float Floor(float val)
+{
+  return std::floor(val);
+}
+
 float Pow(float base, float exp);
 float Log(float val);
-float Abs(float val);
-int Abs(int val);
 float FMod(float dividend, float divisor);
-float GetSign(float val);
-float Cos(float val);
-float Sin(float val);
 float Tan(float angle);
 float ArcCos(float angle);
 float ArcSin(float angle);
 float ArcTan(float angle);
 float ArcTan2(float y, float x);
-float RadToDeg(float radians);
-float DegToRad(float degrees);
-float Round(float val);
-float Ceil(float val);
-float Floor(float val);
 bool IsValid(float val);
 
 template <typename T>
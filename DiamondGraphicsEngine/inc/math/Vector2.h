@@ -179,4 +179,105 @@ Vector2 GetBisector(Vec2Param v0, Vec2Param v1);
 ///Get the perpendicular vector to the given vector
 Vector2 GetPerpendicular(Vec2Param vec);
 
+//------------------------------------------------------------- Inline Functions
+inline Vector2::Vector2(float x_, float y_)
+{
+  x = x_;
+  y = y_;
+}
+
+inline Vector2 Vector2::operator-() const
+{
+  return Vector2(-x, -y);
+}
+
+inline void Vector2::operator*=(float rhs)
+{
+  x *= rhs;
+  y *= rhs;
+}
+
+inline void Vector2::operator/=(float rhs)
+{
+  x /= rhs;
+  y /= rhs;
+}
+
+inline Vector2 Vector2::operator*(float rhs) const
+{
+  return Vector2(x * rhs, y * rhs);
+}
+
+inline Vector2 Vector2::operator/(float rhs) const
+{
+  return Vector2(x / rhs, y / rhs);
+}
+
+inline void Vector2::operator+=(Vec2Param rhs)
+{
+  x += rhs.x;
+  y += rhs.y;
+}
+
+inline void Vector2::operator-=(Vec2Param rhs)
+{
+  x -= rhs.x;
+  y -= rhs.y;
+}
+
+inline Vector2 Vector2::operator+(Vec2Param rhs) const
+{
+  return Vector2(x + rhs.x, y + rhs.y);
+}
+
+inline Vector2 Vector2::operator-(Vec2Param rhs) const
+{
+  return Vector2(x - rhs.x, y - rhs.y);
+}
+
+inline Vector2 Vector2::operator*(Vec2Param rhs) const
+{
+  return Vector2(x * rhs.x, y * rhs.y);
+}
+
+inline Vector2 Vector2::operator/(Vec2Param rhs) const
+{
+  return Vector2(x / rhs.x, y / rhs.y);
+}
+
+inline float Vector2::Dot(Vec2Param rhs) const
+{
+  return x * rhs.x + y * rhs.y;
+}
+
+inline float Vector2::Length() const
+{
+  return Sqrt(LengthSq());
+}
+
+inline float Vector2::LengthSq() const
+{
+  return Dot(*this);
+}
+
+inline Vector2 operator*(float lhs, Vec2Param rhs)
+{
+  return rhs * lhs;
+}
+
+inline float Dot(Vec2Param lhs, Vec2Param rhs)
+{
+  return lhs.Dot(rhs);
+}
+
+inline float Length(Vec2Param vec)
+{
+  return vec.Length();
+}
+
+inline float LengthSq(Vec2Param vec)
+{
+  return vec.LengthSq();
+}
+
 }// namespace Math
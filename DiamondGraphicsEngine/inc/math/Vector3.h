@@ -25,10 +25,10 @@ typedef Vector3* Vec3Ptr;
 ///3 dimensional vector.
 struct Vector3
 {
-  Vector3(): x(0), y(0), z(0){}
-  Vector3(float x, float y, float z);
+  constexpr Vector3(): x(0), y(0), z(0){}
+  constexpr Vector3(float x, float y, float z);
   //Splat all elements
-  explicit Vector3(float xyz);
+  explicit constexpr Vector3(float xyz);
   explicit Vector3(Vec2Param vec2, float z = 0.0f);
   explicit Vector3(ConstRealPointer data);
 
@@ -233,4 +233,244 @@ bool AllGreater(Vec3Param lhs, Vec3Param rhs);
 ///Returns if any value in lhs is greater than any value in rhs
 bool AnyGreater(Vec3Param lhs, Vec3Param rhs);
 
+//------------------------------------------------------------- Inline Functions
+//The operations used in per vertex and per object loops are defined here so
+//they inline without link time code generation.
+constexpr Vector3::Vector3(float xx, float yy, float zz)
+  : x(xx), y(yy), z(zz)
+{
+}
+
+constexpr Vector3::Vector3(float xyz)
+  : x(xyz), y(xyz), z(xyz)
+{
+}
+
+inline Vector3 Vector3::operator-() const
+{
+  return Vector3(-x, -y, -z);
+}
+
+inline void Vector3::operator*=(float rhs)
+{
+  x *= rhs;
+  y *= rhs;
+  z *= rhs;
+}
+
+inline void Vector3::operator/=(float rhs)
+{
+  x /= rhs;
+  y /= rhs;
+  z /= rhs;
+}
+
+inline Vector3 Vector3::operator*(float rhs) const
+{
+  return Vector3(x * rhs, y * rhs, z * rhs);
+}
+
+inline Vector3 Vector3::operator/(float rhs) const
+{
+  return Vector3(x / rhs, y / rhs, z / rhs);
+}
+
+inline void Vector3::operator+=(Vec3Param rhs)
+{
+  x += rhs.x;
+  y += rhs.y;
+  z += rhs.z;
+}
+
+inline void Vector3::operator-=(Vec3Param rhs)
+{
+  x -= rhs.x;
+  y -= rhs.y;
+  z -= rhs.z;
+}
+
+inline Vector3 Vector3::operator+(Vec3Param rhs) const
+{
+  return Vector3(x + rhs.x, y + rhs.y, z + rhs.z);
+}
+
+inline Vector3 Vector3::operator-(Vec3Param rhs) const
+{
+  return Vector3(x - rhs.x, y - rhs.y, z - rhs.z);
+}
+
+inline bool Vector3::operator==(Vec3Param rhs) const
+{
+  return Math::Equal(x, rhs.x) &&
+    Math::Equal(y, rhs.y) &&
+    Math::Equal(z, rhs.z);
+}
+
+inline bool Vector3::operator!=(Vec3Param rhs) const
+{
+  return !(*this == rhs);
+}
+
+inline Vector3 Vector3::operator*(Vec3Param rhs) const
+{
+  return Vector3(x * rhs.x, y * rhs.y, z * rhs.z);
+}
+
+inline Vector3 Vector3::operator/(Vec3Param rhs) const
+{
+  return Vector3(x / rhs.x, y / rhs.y, z / rhs.z);
+}
+
+inline void Vector3::operator*=(Vec3Param rhs)
+{
+  x *= rhs.x;
+  y *= rhs.y;
+  z *= rhs.z;
+}
+
+inline void Vector3::operator/=(Vec3Param rhs)
+{
+  x /= rhs.x;
+  y /= rhs.y;
+  z /= rhs.z;
+}
+
+inline void Vector3::Set(float x_, float y_, float z_)
+{
+  x = x_;
+  y = y_;
+  z = z_;
+}
+
+inline void Vector3::Splat(float xyz)
+{
+  x = y = z = xyz;
+}
+
+inline void Vector3::ZeroOut()
+{
+  x = 0.0f;
+  y = 0.0f;
+  z = 0.0f;
+}
+
+inline void Vector3::AddScaledVector(Vec3Param vector, float scalar)
+{
+  x += vector.x * scalar;
+  y += vector.y * scalar;
+  z += vector.z * scalar;
+}
+
+inline float Vector3::Dot(Vec3Param v) const
+{
+  return x * v.x + y * v.y + z * v.z;
+}
+
+inline float Vector3::Length() const
+{
+  return Sqrt(LengthSq());
+}
+
+inline float Vector3::LengthSq() const
+{
+  return Dot(*this);
+}
+
+inline Vector3 Vector3::Normalized() const
+{
+  Vector3 ret = *this;
+  ret /= Length();
+  return ret;
+}
+
+inline float Vector3::Normalize()
+{
+  float length = Length();
+  *this /= length;
+  return length;
+}
+
+inline float Vector3::AttemptNormalize()
+{
+  float lengthSq = LengthSq();
+
+  //Although the squared length may not be zero, the sqrt of a small number
+  //may be truncated to zero, causing a divide by zero crash.  This is why
+  //we check to make sure that it is larger than our epsilon squared.
+  if (lengthSq >= Epsilon() * Epsilon())
+  {
+    lengthSq = Sqrt(lengthSq);
+    *this /= lengthSq;
+  }
+  return lengthSq;
+}
+
+inline Vector3 Vector3::Cross(Vec3Param v) const
+{
+  return Vector3(y * v.z - z * v.y,
+                 z * v.x - x * v.z,
+                 x * v.y - y * v.x);
+}
+
+inline Vector3 operator*(float lhs, Vec3Param rhs)
+{
+  return rhs * lhs;
+}
+
+inline float Dot(Vec3Param lhs, Vec3Param rhs)
+{
+  return lhs.Dot(rhs);
+}
+
+inline float Length(Vec3Param vec)
+{
+  return vec.Length();
+}
+
+inline float LengthSq(Vec3Param vec)
+{
+  return vec.LengthSq();
+}
+
+inline float Distance(Vec3Param lhs, Vec3Param rhs)
+{
+  return Length(rhs - lhs);
+}
+
+inline Vector3 Normalized(Vec3Param vec)
+{
+  return vec.Normalized();
+}
+
+inline Vector3 Cross(Vec3Param lhs, Vec3Param rhs)
+{
+  return lhs.Cross(rhs);
+}
+
+inline Vector3 Abs(Vec3Param vec)
+{
+  return Vector3(Math::Abs(vec.x), Math::Abs(vec.y), Math::Abs(vec.z));
+}
+
+inline Vector3 Min(Vec3Param lhs, Vec3Param rhs)
+{
+  return Vector3(Math::Min(lhs.x, rhs.x),
+                 Math::Min(lhs.y, rhs.y),
+                 Math::Min(lhs.z, rhs.z));
+}
+
+inline Vector3 Max(Vec3Param lhs, Vec3Param rhs)
+{
+  return Vector3(Math::Max(lhs.x, rhs.x),
+                 Math::Max(lhs.y, rhs.y),
+                 Math::Max(lhs.z, rhs.z));
+}
+
+inline Vector3 Lerp(Vec3Param start, Vec3Param end, float tValue)
+{
+  return Vector3(start.x + tValue * (end.x - start.x),
+                 start.y + tValue * (end.y - start.y),
+                 start.z + tValue * (end.z - start.z));
+}
+
 }// namespace Math
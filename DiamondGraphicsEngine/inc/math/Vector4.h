@@ -124,4 +124,105 @@ namespace Math
     Vector4 Min(Vec4Param lhs, Vec4Param rhs);
     Vector4 Max(Vec4Param lhs, Vec4Param rhs);
     Vector4 Lerp(Vec4Param start, Vec4Param end, float tValue);
+
+    //--------------------------------------------------------- Inline Functions
+    inline Vector4::Vector4(float x_, float y_, float z_, float w_)
+    {
+        x = x_;
+        y = y_;
+        z = z_;
+        w = w_;
+    }
+
+    inline float& Vector4::operator[](unsigned index)
+    {
+        return array[index];
+    }
+
+    inline float Vector4::operator[](unsigned index) const
+    {
+        return array[index];
+    }
+
+    inline Vector4 Vector4::operator-() const
+    {
+        return Vector4(-x, -y, -z, -w);
+    }
+
+    inline void Vector4::operator*=(float rhs)
+    {
+        x *= rhs;
+        y *= rhs;
+        z *= rhs;
+        w *= rhs;
+    }
+
+    inline Vector4 Vector4::operator*(float rhs) const
+    {
+        return Vector4(x * rhs, y * rhs, z * rhs, w * rhs);
+    }
+
+    inline void Vector4::operator+=(Vec4Param rhs)
+    {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        w += rhs.w;
+    }
+
+    inline void Vector4::operator-=(Vec4Param rhs)
+    {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        w -= rhs.w;
+    }
+
+    inline void Vector4::operator*=(Vec4Param rhs)
+    {
+        x *= rhs.x;
+        y *= rhs.y;
+        z *= rhs.z;
+        w *= rhs.w;
+    }
+
+    inline Vector4 Vector4::operator+(Vec4Param rhs) const
+    {
+        return Vector4(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
+    }
+
+    inline Vector4 Vector4::operator-(Vec4Param rhs) const
+    {
+        return Vector4(x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w);
+    }
+
+    inline Vector4 Vector4::operator*(Vec4Param rhs) const
+    {
+        return Vector4(x * rhs.x, y * rhs.y, z * rhs.z, w * rhs.w);
+    }
+
+    inline float Vector4::Dot(Vec4Param rhs) const
+    {
+        return (x * rhs.x) + (y * rhs.y) + (z * rhs.z) + (w * rhs.w);
+    }
+
+    inline float Vector4::Length() const
+    {
+        return Sqrt(LengthSq());
+    }
+
+    inline float Vector4::LengthSq() const
+    {
+        return Dot(*this);
+    }
+
+    inline Vector4 operator*(float lhs, Vec4Param rhs)
+    {
+        return rhs * lhs;
+    }
+
+    inline float Dot(Vec4Param lhs, Vec4Param rhs)
+    {
+        return lhs.Dot(rhs);
+    }
 } // namespace Math
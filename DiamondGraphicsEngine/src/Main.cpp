@@ -28,12 +28,24 @@
 #include "graphics/FramebufferManager.h"
 #include "graphics/Framebuffer.h"
 #include "graphics/ShaderProgram.h"
+#include "graphics/ImageEncoder.h"
+#include "graphics/FrameCapture.h"
+#include "graphics/RayTracer.h"
+#include "graphics/SoftwareRasterizer.h"
+#include "framework/HeadlessScript.h"
+#include "framework/FrameTimings.h"
+#include "framework/Profiler.h"
+#include "framework/SelfTest.h"
 #ifdef _WIN32
 #include <Windows.h>//for raw input so we can have a better camera control
 #endif // _WIN32
 
 static const unsigned c_DefaultWindowWidth = 1280;
 static const unsigned c_DefaultWindowHeight = 760;
+//video memory for the finer levels of streamed textures
+static const u64 c_TextureStreamingBudget = 256ull * 1024 * 1024;
+//materials read from a shader storage buffer, their textures from texture arrays
+static const bool c_MaterialTable = true;
 using namespace Graphics;
 using namespace Math;
 
@@ -41,6 +53,30 @@ Scene g_MainScene;
 std::shared_ptr<GraphicsEngine>g_Graphics;
 ObjectHandle g_Obj0;
 ObjectHandle g_Cam;
+//what --headless renders
+HeadlessScript g_Script;
+
+//scene the benchmark runner renders on top of the regular one, empty when not benchmarking
+struct
+{
+    std::string Name;
+    //prop copies for "stress" and "occlusion", extra point lights for "lights"
+    u32 Count = 0;
+    std::string Renderer;
+    //summed over the measured frames
+    u64 OcclusionTested = 0;
+    u64 Occluded = 0;
+}g_Benchmark;
+static const char* c_BenchmarkPresets[] = { "default", "stress:2000", "lights:63", "occlusion:2000" };
+static const unsigned c_BenchmarkFrames = 600;
+static const unsigned c_BenchmarkWarmupFrames = 60;
+static const float c_BenchmarkTimeStep = 1.0f / 60.0f;
+//the final pass has room for 64 lights, one is the scene's shadowing light
+static const u32 c_BenchmarkMaxExtraLights = 63;
+//checks --selftest found failing, -1 until they ran
+int g_SelfTestFailed = -1;
+//--selftest --exhaustive: FastMath over every float instead of a sample
+bool g_SelfTestExhaustive = false;
 struct
 {
     Vec2 mouseDragStartPoint;
@@ -56,25 +92,73 @@ struct
     }
 }g_MouseDragEventData;
 
+//**************************************************************************
+void AddBenchmarkObjects(ShaderType shaderType, std::shared_ptr<MaterialManager> const& materialManager,
+                         std::vector<std::pair<const char*, std::shared_ptr<Mesh> > > const& props,
+                         std::shared_ptr<Mesh> const& wallMesh)
+{
+    using namespace Component;
+    if (g_Benchmark.Name == "stress" || g_Benchmark.Name == "occlusion")
+    {
+        //a square grid of props around the scene, the benchmark camera turns over all of them
+        const float spacing = 2.5f;
+        u32 side = static_cast<u32>(std::ceil(std::sqrt(static_cast<float>(g_Benchmark.Count))));
+        for (u32 i = 0; i < g_Benchmark.Count; ++i)
+        {
+            auto const& prop = props[i % props.size()];
+            float x = (static_cast<float>(i % side) - side * 0.5f) * spacing;
+            float z = (static_cast<float>(i / side) - side * 0.5f) * spacing;
+            Object& obj = g_MainScene.CreateObject(shaderType);
+            obj.AddComponent<Renderer>(materialManager->GetMaterial(prop.first), prop.second);
+            obj.GetComponentRef<Component::Transform>().SetPosition({ x, 0, z }).SetScale(0.5f).SetRotation({ 0, 0.37f * i, 0 });
+            obj.SetName("Stress " + std::to_string(i));
+        }
+        //walls across the grid every four rows, taller than the camera, each hides the rows behind it
+        int walls = static_cast<int>(side * spacing / 10.0f);
+        for (int i = -walls / 2; i <= walls / 2 && g_Benchmark.Name == "occlusion"; ++i)
+        {
+            Object& wall = g_MainScene.CreateObject(shaderType);
+            wall.AddComponent<Renderer>(materialManager->GetMaterial("Plane"), wallMesh).SetOccluder(true);
+            wall.GetComponentRef<Component::Transform>().SetPosition({ 0, 1.5f, -2.5f + 10.0f * i }).SetScale({ side * spacing, 3, 0.2f });
+            wall.SetName("Wall " + std::to_string(i));
+        }
+    }
+    else if (g_Benchmark.Name == "lights")
+    {
+        //point lights on a ring over the scene, colors spread over the hues
+        for (u32 i = 0; i < g_Benchmark.Count; ++i)
+        {
+            float angle = c_TwoPi * i / g_Benchmark.Count;
+            float radius = 3.0f + 4.0f * (i % 3);
+            Object& lightObj = g_MainScene.CreateObject(shaderType);
+            lightObj.GetComponentRef<Component::Transform>().SetPosition({ 2 + radius * std::cos(angle), 1.5f, -3 + radius * std::sin(angle) });
+            lightObj.AddComponent<Light>()
+                .SetLightType(LightType::Point)
+                ->SetDiffuseColor(Color(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::cos(angle + 2.1f), 0.5f + 0.5f * std::cos(angle + 4.2f)))
+                ->SetAmbientColor(Color(0, 0, 0))
+                ->SetSpecularColor(Color(0.2f, 0.2f, 0.2f))
+                ->SetDistanceAttenuation(1.0f, 0.3f, 0.1f)
+                ->SetShadowType(ShadowType::NoShadow);
+            lightObj.SetName("Benchmark Light " + std::to_string(i));
+        }
+    }
+}
+
 //**************************************************************************
 void Initialize(Application* app, void* /*userdata*/)
 {
-	TwInit(TW_OPENGL, nullptr);
+    if (!app->IsHeadless())
+        TwInit(TW_OPENGL, nullptr);
 	
     using namespace Component;
     g_Graphics = std::make_shared<GraphicsEngine>();
     g_Graphics->Initialize();
 
-    std::shared_ptr<FramebufferManager> fboManager = g_Graphics->GetFrameBufferManager();
-    fboManager->RegisterFramebuffer(FramebufferType::DeferredGBuffer, app->GetWindowWidth(), app->GetWindowHeight())->Build(FBO_USAGE_REGULAR);
-
-    fboManager->RegisterFramebuffer(FramebufferType::GenShadowMap,512, 512)->Build(FBO_USAGE_FLOAT_BUFFER);
-    fboManager->RegisterFramebuffer(FramebufferType::ShadowBlurH, 512, 512)->Build(FBO_USAGE_FLOAT_BUFFER);
-    fboManager->RegisterFramebuffer(FramebufferType::ShadowBlurV, 512, 512)->Build(FBO_USAGE_FLOAT_BUFFER);
-
-    fboManager->RegisterFramebuffer(FramebufferType::SSAO,      512,512)->Build(FBO_USAGE_DEPTH_BUFFER);
-    fboManager->RegisterFramebuffer(FramebufferType::SSAOBlurH, 512,512)->Build(FBO_USAGE_DEPTH_BUFFER);
-    fboManager->RegisterFramebuffer(FramebufferType::SSAOBlurV, 512,512)->Build(FBO_USAGE_DEPTH_BUFFER);
+#if COMPACT_GBUFFER
+    g_Graphics->RegisterDeferredFramebuffers(FBO_USAGE_COMPACT_GBUFFER);
+#else
+    g_Graphics->RegisterDeferredFramebuffers(FBO_USAGE_REGULAR);
+#endif // COMPACT_GBUFFER
 
     
     ////////////////////////////////////////////////////////////////////////////
@@ -147,8 +231,10 @@ void Initialize(Application* app, void* /*userdata*/)
 #endif // DEFERRED_SHADING_TEST
 
 
-    //add materials to manager
+    //add materials to manager, their textures start with the coarse levels and stream in
+    g_Graphics->GetTextureManager()->SetStreamingBudget(c_TextureStreamingBudget);
     std::shared_ptr<MaterialManager> materialManager = g_Graphics->GetMaterialManager();
+    materialManager->SetMaterialTableEnabled(c_MaterialTable, *g_Graphics->GetTextureManager());
     materialManager->LoadMaterials("basic.mtl", g_Graphics);
 
     ////////////////////////////////////////////////////////////////////////////
@@ -157,7 +243,7 @@ void Initialize(Application* app, void* /*userdata*/)
         //objects
 
         Object& BTR80A = g_MainScene.CreateObject(usingShader);
-        BTR80A.AddComponent<Renderer>(materialManager->GetMaterial("BTR80A"), bTR80AMesh);
+        BTR80A.AddComponent<Renderer>(materialManager->GetMaterial("BTR80A"), bTR80AMesh).SetOccluder(true);
         BTR80A.GetComponentRef<Component::Transform>().SetPosition({ 0,0,-2 }).SetScale({ 1,1,1 }).SetRotation({ 0,0,0 });
         g_Obj0 = BTR80A.GetHandle();
         BTR80A.SetName("BTR80A");
@@ -233,17 +319,31 @@ void Initialize(Application* app, void* /*userdata*/)
 	        ->SetSpotlightFalloff(8.0f);
         lightObj.SetName("Light");
 
+        AddBenchmarkObjects(usingShader, materialManager,
+            { { "Teapot", teapotMesh }, { "Golf", golfMesh }, { "Sphere", sphereMesh }, { "Sponge", cube } }, cube);
+    }
+    if (!app->IsHeadless())
+    {
+        TwEditor::CreateComponentEditor("Object & Component", g_MainScene.GetEditorObjectRef(), g_Graphics);
+        TwEditor::CreateResourceEditor("Resource Manager", g_Graphics->GetTextureManager()->GetAllTextures(), materialManager->GetAllMaterials(), g_Graphics);
     }
-    TwEditor::CreateComponentEditor("Object & Component", g_MainScene.GetEditorObjectRef(), g_Graphics);
-    TwEditor::CreateResourceEditor("Resource Manager", g_Graphics->GetTextureManager()->GetAllTextures(), materialManager->GetAllMaterials(), g_Graphics);
     
 
     g_MainScene.StartScene();
+
+    if (app->IsHeadless())
+    {
+        //the frames are measured on the finished scene, not while textures come in
+        while (g_Graphics->GetTextureManager()->ProcessThreadLoadedTexture() > 0)
+            std::this_thread::yield();
+    }
 }
 
 //**************************************************************************
 void Update(Application* /*application*/, float dt, void* /*userdata*/)
 {
+    //the occluders rasterize on the workers while the scene updates
+    g_Graphics->BeginOcclusionCulling(&g_MainScene);
     g_MainScene.UpdateScene(dt);
     g_Graphics->RenderScene(&g_MainScene);
 #ifdef _WIN32//for a better keyboard input
@@ -303,6 +403,104 @@ void Update(Application* /*application*/, float dt, void* /*userdata*/)
 	TwDraw();
 }
 
+//**************************************************************************
+void HeadlessUpdate(Application* application, float dt, void* /*userdata*/)
+{
+    static unsigned s_RenderedFrames = 0;
+    bool measured = s_RenderedFrames >= g_Script.WarmupFrames;
+    unsigned frame = measured ? s_RenderedFrames - g_Script.WarmupFrames : 0;
+    ++s_RenderedFrames;
+
+    Vec3 position, rotation;
+    if (g_Script.SampleCamera(frame, position, rotation))
+    {
+        Object& camObj = g_MainScene.GetObjectRef(g_Cam);
+        Component::Camera& cam = camObj.GetComponentRef<Component::Camera>();
+        camObj.GetComponentRef<Component::Transform>().SetPosition(position);
+        cam.RotateCameraLocal(rotation - cam.GetCameraLocalRotationEuler());
+    }
+    std::shared_ptr<FrameCapture> capture = g_Graphics->GetFrameCapture();
+    if (measured && frame == 0 && g_Script.SequenceStep > 0)
+        capture->StartSequence(g_Script.SequencePath, ImageFormat::QOI, g_Script.SequenceStep);
+
+    g_Graphics->BeginOcclusionCulling(&g_MainScene);
+    g_MainScene.UpdateScene(dt);
+    g_Graphics->RenderScene(&g_MainScene);
+
+    for (HeadlessScript::Capture const& screenshot : g_Script.Captures)
+    {
+        if (measured && screenshot.Frame == frame)
+            capture->CaptureScreen(application->GetWindowWidth(), application->GetWindowHeight(), screenshot.Path);
+    }
+    for (HeadlessScript::Capture const& trace : g_Script.Traces)
+    {
+        if (!measured || trace.Frame != frame)
+            continue;
+        //runs on the CPU inside the frame, so a traced frame shows up as the slowest one
+        auto start = std::chrono::steady_clock::now();
+        RayTracer tracer;
+        tracer.Build(g_MainScene);
+        RayTracer::Settings settings;
+        settings.Width = application->GetWindowWidth();
+        settings.Height = application->GetWindowHeight();
+        Component::Camera& cam = g_MainScene.GetObjectRef(g_Cam).GetComponentRef<Component::Camera>();
+        Texture::SavePNG(tracer.Render(cam, settings), trace.Path + ".png");
+        std::cout << "Ray traced frame " << frame << " (" << tracer.GetInstanceCount() << " instances) to " << trace.Path
+            << ".png in " << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count()
+            << " ms\n";
+    }
+    for (HeadlessScript::Capture const& raster : g_Script.Rasters)
+    {
+        if (!measured || raster.Frame != frame)
+            continue;
+        //the same frame without the GPU, to diff against its capture
+        SoftwareRasterizer rasterizer;
+        g_Graphics->RenderScene(&g_MainScene, rasterizer);
+        Texture::SavePNG(rasterizer.ReadColor(), raster.Path + ".png");
+        SoftwareRasterizer::FrameStats const& stats = rasterizer.GetFrameStats();
+        std::cout << "Software rasterized frame " << frame << " (" << stats.Draws << " draws, " << stats.Triangles
+            << " triangles) to " << raster.Path << ".png in " << stats.VertexMilliseconds + stats.SetupMilliseconds
+            + stats.RasterMilliseconds << " ms\n";
+    }
+}
+
+//**************************************************************************
+void BenchmarkUpdate(Application* /*application*/, float dt, void* /*userdata*/)
+{
+    static unsigned s_RenderedFrames = 0;
+    if (s_RenderedFrames == 0)
+        g_Benchmark.Renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    if (s_RenderedFrames == c_BenchmarkWarmupFrames)
+    {
+        FrameTimings::Reset();
+        FrameTimings::SetEnabled(true);
+    }
+    //the camera turns around once over the run, the same way every time
+    float turn = c_TwoPi * s_RenderedFrames / (c_BenchmarkWarmupFrames + c_BenchmarkFrames);
+    ++s_RenderedFrames;
+    Component::Camera& cam = g_MainScene.GetObjectRef(g_Cam).GetComponentRef<Component::Camera>();
+    cam.RotateCameraLocal(Vec3(0, turn - cam.GetCameraLocalRotationEuler().y, 0));
+
+    g_Graphics->BeginOcclusionCulling(&g_MainScene);
+    g_MainScene.UpdateScene(dt);
+    g_Graphics->RenderScene(&g_MainScene);
+    if (FrameTimings::IsEnabled())
+    {
+        g_Benchmark.OcclusionTested += g_Graphics->OcclusionCulling.Tested;
+        g_Benchmark.Occluded += g_Graphics->OcclusionCulling.Occluded;
+    }
+    FrameTimings::EndFrame();
+}
+
+//**************************************************************************
+void SelfTestUpdate(Application* /*application*/, float /*dt*/, void* /*userdata*/)
+{
+    //once, on the loaded scene
+    if (g_SelfTestFailed < 0)
+        g_SelfTestFailed = static_cast<int>(SelfTest::Run(*g_Graphics->GetMeshManager(), *g_Graphics->GetMaterialManager(),
+                                                          g_SelfTestExhaustive));
+}
+
 //**************************************************************************
 void Loading(Application* application, float dt, void* userdata)
 {
@@ -315,8 +513,14 @@ void Loading(Application* application, float dt, void* userdata)
     }
 }
 //**************************************************************************
-void Cleanup(Application* /*application*/, void* /*udata*/)
+void Cleanup(Application* application, void* /*udata*/)
 {
+    if (application->IsHeadless())
+    {
+        //the captures need the context to read back, it goes away after this
+        g_Graphics->GetFrameCapture()->Flush();
+        return;
+    }
     TwDeleteAllBars();
 	TwTerminate();
 }
@@ -327,17 +531,9 @@ void OnViewportChanged(Application* application)
     g_Graphics->GetViewCamera()->SetDimension(
         static_cast<float>(application->GetWindowWidth()),
         static_cast<float>(application->GetWindowHeight()));
+    //screen sized framebuffers are rebuilt once the window stops resizing
     auto fboManager = g_Graphics->GetFrameBufferManager();
-    fboManager->GetFramebuffer(FramebufferType::DeferredGBuffer)->Resize(
-        application->GetWindowWidth(), application->GetWindowHeight(),false);
-    
-    //fboManager->GetFramebuffer(FramebufferType::SSAO)->Resize(
-    //    application->GetWindowWidth(), application->GetWindowHeight(), false);
-    //fboManager->GetFramebuffer(FramebufferType::SSAOBlurH)->Resize(
-    //    application->GetWindowWidth(), application->GetWindowHeight(), true);
-    //fboManager->GetFramebuffer(FramebufferType::SSAOBlurV)->Resize(
-    //    application->GetWindowWidth(), application->GetWindowHeight(), true);
-
+    fboManager->RequestResize(application->GetWindowWidth(), application->GetWindowHeight());
 }
 
 //**************************************************************************
@@ -370,22 +566,7 @@ void OnMouseButtonDown(Application* application, int button, int x, int y)
             g_Graphics->GetViewCamera()->GetProjMatrix()
         );
 
-        std::vector<Object*> const& editorObjects = g_MainScene.GetEditorObjectRef();
-
-        bool hit = false;
-        float t = -1;
-        float nearestT = FLT_MAX;
-        Object* obj = nullptr;
-        for (auto& i : editorObjects)
-        {
-            BoundingSphere sphere = i->GetBoundingSphere();
-            hit = selectionRay.CheckCollisionSphere(sphere.center, sphere.radius, &t);
-            if (hit && (t < nearestT))
-            {
-                nearestT = t;
-                obj = i;
-            }
-        }
+        Object* obj = g_MainScene.PickObject(selectionRay);
         if (obj)
         {
             TwEditor::SetSelection(obj);
@@ -476,13 +657,126 @@ void SimpleKeyDonwCB(Application* , unsigned char key, int x, int y)
 
 #endif // !_WIN32
 
+#if PROFILING
+    //timeline of the last few seconds, open it in chrome://tracing
+    if (key == 'p')
+    {
+        Profiler::SaveChromeTrace("profile_trace.json");
+    }
+#endif // PROFILING
+}
+
+//**************************************************************************
+int RunHeadless(Application* app, int argc, char* argv[])
+{
+    if (!g_Script.Load(argv[2]))
+        return 1;
+    app->InitializeHeadless(argc, argv, "Diamond Graphics", g_Script.Width, g_Script.Height);
+    Application::FrameStats frames = app->RunHeadless(Initialize, HeadlessUpdate, Cleanup,
+        g_Script.Frames, g_Script.TimeStep, g_Script.WarmupFrames);
+    FrameCapture::Stats captures = g_Graphics->GetFrameCapture()->GetStats();
+
+    std::cout << "Headless " << argv[2] << ", " << frames.Frames << " frames (" << frames.WarmupFrames << " warmup) at "
+        << app->GetWindowWidth() << "x" << app->GetWindowHeight() << ": total " << frames.TotalMilliseconds
+        << " ms, average " << frames.AverageMilliseconds << " ms, median " << frames.MedianMilliseconds << " ms, p95 "
+        << frames.P95Milliseconds << " ms, p99 " << frames.P99Milliseconds << " ms, min " << frames.MinMilliseconds
+        << " ms, max " << frames.MaxMilliseconds << " ms; " << captures.Written << " captures written, "
+        << captures.Failed << " failed\n";
+    return frames.Frames == g_Script.Frames && captures.Failed == 0 ? 0 : 1;
+}
 
+//**************************************************************************
+int RunBenchmark(Application* app, int argc, char* argv[])
+{
+    std::string preset = argv[2];
+    std::string output = argc >= 4 ? argv[3] : "";
+    if (preset == "all")
+    {
+        //every preset in a process of its own, the scene and the lights are global
+        int failed = 0;
+        for (const char* each : c_BenchmarkPresets)
+        {
+            std::string name = std::string(each).substr(0, std::string(each).find(':'));
+            std::string command = "\"" + std::string(argv[0]) + "\" --benchmark " + each;
+            if (!output.empty())
+                command += " \"" + output + "/benchmark_" + name + ".json\"";
+#ifdef _WIN32
+            //cmd /c strips the outermost quotes
+            command = "\"" + command + "\"";
+#endif // _WIN32
+            failed += std::system(command.c_str()) != 0 ? 1 : 0;
+        }
+        return failed > 0 ? 1 : 0;
+    }
+
+    size_t colon = preset.find(':');
+    g_Benchmark.Name = preset.substr(0, colon);
+    g_Benchmark.Count = colon == std::string::npos ? 0 : static_cast<u32>(std::strtoul(preset.c_str() + colon + 1, nullptr, 10));
+    if ((g_Benchmark.Name == "stress" || g_Benchmark.Name == "occlusion") && g_Benchmark.Count == 0)
+        g_Benchmark.Count = 2000;
+    if (g_Benchmark.Name == "lights")
+        g_Benchmark.Count = std::min(g_Benchmark.Count == 0 ? c_BenchmarkMaxExtraLights : g_Benchmark.Count, c_BenchmarkMaxExtraLights);
+    if (g_Benchmark.Name != "default" && g_Benchmark.Name != "stress" && g_Benchmark.Name != "lights"
+        && g_Benchmark.Name != "occlusion")
+    {
+        std::cout << "Unknown benchmark preset \"" << preset
+            << "\", use default, stress[:objects], lights[:count], occlusion[:objects] or all.\n";
+        return 1;
+    }
+
+    app->InitializeHeadless(argc, argv, "Diamond Graphics", c_DefaultWindowWidth, c_DefaultWindowHeight);
+    Application::FrameStats frames = app->RunHeadless(Initialize, BenchmarkUpdate, Cleanup,
+        c_BenchmarkFrames, c_BenchmarkTimeStep, c_BenchmarkWarmupFrames);
+    FrameTimings::SetEnabled(false);
+
+    std::ofstream file;
+    if (!output.empty())
+    {
+        file.open(output);
+        WarnIf(!file.is_open(), "Could not write benchmark results to %s.", output.c_str());
+    }
+    std::ostream& os = file.is_open() ? file : std::cout;
+    os << "{\n  \"preset\": \"" << g_Benchmark.Name << "\",\n  \"count\": " << g_Benchmark.Count
+        << ",\n  \"renderer\": \"" << g_Benchmark.Renderer << "\",\n  \"width\": " << app->GetWindowWidth()
+        << ",\n  \"height\": " << app->GetWindowHeight() << ",\n  \"frames\": " << frames.Frames
+        << ",\n  \"warmup\": " << frames.WarmupFrames << ",\n  \"dt\": " << c_BenchmarkTimeStep
+        << ",\n  \"frame\": { \"min\": " << frames.MinMilliseconds << ", \"median\": " << frames.MedianMilliseconds
+        << ", \"p99\": " << frames.P99Milliseconds << ", \"average\": " << frames.AverageMilliseconds
+        << " },\n  \"occlusion\": { \"tested\": " << g_Benchmark.OcclusionTested / double(std::max(frames.Frames, 1u))
+        << ", \"occluded\": " << g_Benchmark.Occluded / double(std::max(frames.Frames, 1u)) << " },\n  \"cpu\": ";
+    FrameTimings::WriteJson(os, FrameTimings::Summarize(), "  ");
+    os << "\n}\n";
+#if PROFILING
+    //timeline of the last frames next to the numbers
+    if (!output.empty())
+        Profiler::SaveChromeTrace(output + ".trace.json");
+#endif // PROFILING
+    return frames.Frames == c_BenchmarkFrames ? 0 : 1;
+}
+
+//**************************************************************************
+int RunSelfTest(Application* app, int argc, char* argv[])
+{
+    g_SelfTestExhaustive = argc >= 3 && std::string(argv[2]) == "--exhaustive";
+    app->InitializeHeadless(argc, argv, "Diamond Graphics", c_DefaultWindowWidth, c_DefaultWindowHeight);
+    app->RunHeadless(Initialize, SelfTestUpdate, Cleanup, 1, c_BenchmarkTimeStep);
+    return g_SelfTestFailed == 0 ? 0 : 1;
 }
 
 //**************************************************************************
 int main(int argc, char* argv[])
 {
+    PROFILE_THREAD("Main");
     Application* app = &Application::GetInstance();
+    //--headless <script>: render the frames of a script offscreen, print the frame times and exit
+    if (argc >= 3 && std::string(argv[1]) == "--headless")
+        return RunHeadless(app, argc, argv);
+    //--benchmark <preset> [output.json]: fixed frames of a preset scene, CPU time per subsystem and pass as JSON
+    if (argc >= 3 && std::string(argv[1]) == "--benchmark")
+        return RunBenchmark(app, argc, argv);
+    //--selftest [--exhaustive]: check the CPU code against its references and documented error bounds, exit 1 if any check fails
+    if (argc >= 2 && std::string(argv[1]) == "--selftest")
+        return RunSelfTest(app, argc, argv);
     app->Initialize(argc, argv, "Diamond Graphics", c_DefaultWindowWidth, c_DefaultWindowHeight);
     app->SetOnViewportChanged(OnViewportChanged);
     app->SetMouseWheelCallback(OnMouseWheel);
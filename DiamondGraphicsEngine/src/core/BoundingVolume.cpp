@@ -1,6 +1,9 @@
 #include "Precompiled.h"
 #include "core/BoundingVolume.h"
 #include "core/Ray.h"
+#include "math/Matrix4.h"
+
+#include <cfloat>
 
 
 BoundingSphere::BoundingSphere(Math::Vector3 const& c, float r)
@@ -44,47 +47,86 @@ bool BoundingSphere::CheckRayCollision(Ray const& ray, float* t) const
     return true;
 }
 
-BoundingAABB::BoundingAABB(Math::Vector3 const& _min, Math::Vector3 const& _max)
+BoundingSphere BoundingSphere::Transformed(Math::Matrix4 const& transform) const
 {
+    using namespace Math;
+    float scale = Max(transform.Basis3X().Length(), Max(transform.Basis3Y().Length(), transform.Basis3Z().Length()));
+    return BoundingSphere(TransformPoint(transform, center), radius * scale);
 }
 
-bool BoundingAABB::CheckRayCollision(Ray const& ray, float* t) const
+BoundingAABB::BoundingAABB(Math::Vector3 const& _min, Math::Vector3 const& _max)
+    :aabbMin(_min), aabbMax(_max)
 {
-    using namespace Math;
-    bool pointAABB = false;
-
-    Vector3 start = ray.GetStartPosition();
-    Vector3 direction = ray.GetRayDirection();
+}
 
-    Vector3 cliped_pt = start;
-    if (cliped_pt.x == Clamp(cliped_pt, aabbMin, aabbMax).x)
-        if (cliped_pt.y == Clamp(cliped_pt, aabbMin, aabbMax).y)
-            if (cliped_pt.z == Clamp(cliped_pt, aabbMin, aabbMax).z)
-                pointAABB =  true;
-    pointAABB =  false;
+BoundingAABB BoundingAABB::FromSphere(BoundingSphere const& sphere)
+{
+    Math::Vector3 extent(sphere.radius, sphere.radius, sphere.radius);
+    return BoundingAABB(sphere.center - extent, sphere.center + extent);
+}
 
+bool BoundingAABB::CheckRayCollision(Ray const& ray, float* t) const
+{
+    Math::Vector3 start = ray.GetStartPosition();
+    Math::Vector3 direction = ray.GetRayDirection();
 
-    if (pointAABB)
-    {
-        *t = 0;
-        return true;
-    }
-    Vector3 pmin(aabbMin), pmax(aabbMax);
+    //slab test, t is the distance along the ray to the entry point (0 when starting inside)
+    float tmin = 0.0f;
+    float tmax = FLT_MAX;
     for (int i = 0; i < 3; i++)//3 because of x,y,z
-        (start[i] > aabbMax[i]) ? std::swap(pmin[i], pmax[i]) : 1;
-    //-------------------------------------------------------------------
-    // possible float division by 0, +-INF will be handled by std::max/min
-    //-------------------------------------------------------------------
-    float tmin = (pmin.x - start.x) / direction.x;
-    tmin = std::max(tmin, (pmin.y - start.y) / direction.y);
-    tmin = std::max(tmin, (pmin.z - start.z) / direction.z);
-    float tmax = (pmax.x - start.x) / direction.x;
-    tmax = std::min(tmax, (pmax.y - start.y) / direction.y);
-    tmax = std::min(tmax, (pmax.z - start.z) / direction.z);
-    if (tmin <= tmax)
     {
-        *t = tmin;
-        return true;
+        if (direction[i] == 0.0f)
+        {
+            if (start[i] < aabbMin[i] || start[i] > aabbMax[i])
+            {
+                return false;
+            }
+            continue;
+        }
+        float invDir = 1.0f / direction[i];
+        float tNear = (aabbMin[i] - start[i]) * invDir;
+        float tFar = (aabbMax[i] - start[i]) * invDir;
+        if (tNear > tFar)
+        {
+            std::swap(tNear, tFar);
+        }
+        tmin = std::max(tmin, tNear);
+        tmax = std::min(tmax, tFar);
+        if (tmin > tmax)
+        {
+            return false;
+        }
     }
-    return false;
+    *t = tmin;
+    return true;
+}
+
+BoundingAABB BoundingAABB::Merged(BoundingAABB const& lhs, BoundingAABB const& rhs)
+{
+    return BoundingAABB(Math::Min(lhs.aabbMin, rhs.aabbMin), Math::Max(lhs.aabbMax, rhs.aabbMax));
+}
+
+BoundingAABB BoundingAABB::Expanded(float margin) const
+{
+    Math::Vector3 extent(margin, margin, margin);
+    return BoundingAABB(aabbMin - extent, aabbMax + extent);
+}
+
+bool BoundingAABB::Contains(BoundingAABB const& other) const
+{
+    return aabbMin.x <= other.aabbMin.x && aabbMin.y <= other.aabbMin.y && aabbMin.z <= other.aabbMin.z
+        && aabbMax.x >= other.aabbMax.x && aabbMax.y >= other.aabbMax.y && aabbMax.z >= other.aabbMax.z;
+}
+
+bool BoundingAABB::Overlaps(BoundingAABB const& other) const
+{
+    return aabbMin.x <= other.aabbMax.x && aabbMax.x >= other.aabbMin.x
+        && aabbMin.y <= other.aabbMax.y && aabbMax.y >= other.aabbMin.y
+        && aabbMin.z <= other.aabbMax.z && aabbMax.z >= other.aabbMin.z;
+}
+
+float BoundingAABB::SurfaceArea() const
+{
+    Math::Vector3 extent = aabbMax - aabbMin;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
 }
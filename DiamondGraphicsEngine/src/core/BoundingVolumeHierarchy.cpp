@@ -0,0 +1,536 @@
+#include "Precompiled.h"
+#include "core/BoundingVolumeHierarchy.h"
+#include "framework/Debug.h"
+#include "math/Matrix3.h"
+
+#include <cmath>
+
+namespace
+{
+    //binned SAH: split candidates per axis and cost of a traversal step relative to a leaf test
+    const u32 c_sahBins = 16;
+    const float c_traversalCost = 1.0f;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float fatMargin, float rebuildCostRatio)
+    : m_fatMargin(fatMargin), m_rebuildCostRatio(rebuildCostRatio)
+{
+}
+
+s32 BoundingVolumeHierarchy::Insert(ObjectId id, BoundingAABB const& aabb)
+{
+    s32 leaf = allocateNode();
+    m_nodes[leaf].Box = aabb.Expanded(m_fatMargin);
+    m_nodes[leaf].Object = id;
+    insertLeaf(leaf);
+    ++m_leafCount;
+    m_changed = true;
+    return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(s32 leaf)
+{
+    Assert(leaf >= 0 && leaf < static_cast<s32>(m_nodes.size()) && m_nodes[leaf].IsLeaf(), "Invalid BVH leaf.");
+    removeLeaf(leaf);
+    freeNode(leaf);
+    --m_leafCount;
+    m_changed = true;
+}
+
+bool BoundingVolumeHierarchy::Update(s32 leaf, BoundingAABB const& aabb)
+{
+    Assert(leaf >= 0 && leaf < static_cast<s32>(m_nodes.size()) && m_nodes[leaf].IsLeaf(), "Invalid BVH leaf.");
+    if (m_nodes[leaf].Box.Contains(aabb))
+        return false;
+    m_nodes[leaf].Box = aabb.Expanded(m_fatMargin);
+    refitAncestors(m_nodes[leaf].Parent);
+    m_changed = true;
+    return true;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_root = NullNode;
+    m_freeList = NullNode;
+    m_leafCount = 0;
+    m_rebuiltCost = 0.0f;
+    m_changed = false;
+}
+
+void BoundingVolumeHierarchy::Rebuild()
+{
+    std::vector<s32> leaves;
+    leaves.reserve(m_leafCount);
+    std::vector<s32> internals;
+    for (s32 i = 0; i < static_cast<s32>(m_nodes.size()); ++i)
+    {
+        Node const& node = m_nodes[i];
+        //free nodes are marked by an empty object id and no children
+        if (node.IsLeaf() && node.Object >= 0)
+            leaves.push_back(i);
+        else if (!node.IsLeaf())
+            internals.push_back(i);
+    }
+    for (s32 node : internals)
+        freeNode(node);
+
+    m_root = NullNode;
+    if (!leaves.empty())
+    {
+        //index by leaf node so the partitioning below can shuffle leaves freely
+        std::vector<Math::Vector3> centers(m_nodes.size());
+        for (s32 leaf : leaves)
+            centers[leaf] = m_nodes[leaf].Box.GetCenter();
+        m_root = buildSAH(leaves, centers, 0, static_cast<u32>(leaves.size()));
+        m_nodes[m_root].Parent = NullNode;
+    }
+    m_rebuiltCost = GetCost();
+    m_changed = false;
+}
+
+bool BoundingVolumeHierarchy::RebuildIfDegraded()
+{
+    if (!m_changed)
+        return false;
+    m_changed = false;
+    float cost = GetCost();
+    //an incrementally built tree has no reference cost yet, take the first one
+    if (m_rebuiltCost <= 0.0f)
+    {
+        m_rebuiltCost = cost;
+        return false;
+    }
+    if (cost <= m_rebuiltCost * m_rebuildCostRatio)
+        return false;
+    Rebuild();
+    return true;
+}
+
+float BoundingVolumeHierarchy::GetCost() const
+{
+    if (m_root == NullNode)
+        return 0.0f;
+    float rootArea = m_nodes[m_root].Box.SurfaceArea();
+    if (rootArea <= 0.0f)
+        return 0.0f;
+    float internalArea = 0.0f;
+    float leafArea = 0.0f;
+    std::vector<s32> stack;
+    stack.push_back(m_root);
+    while (!stack.empty())
+    {
+        Node const& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (node.IsLeaf())
+        {
+            leafArea += node.Box.SurfaceArea();
+            continue;
+        }
+        internalArea += node.Box.SurfaceArea();
+        stack.push_back(node.Left);
+        stack.push_back(node.Right);
+    }
+    return (c_traversalCost * internalArea + leafArea) / rootArea;
+}
+
+s32 BoundingVolumeHierarchy::GetHeight() const
+{
+    if (m_root == NullNode)
+        return 0;
+    s32 height = 0;
+    std::vector<std::pair<s32, s32>> stack;
+    stack.emplace_back(m_root, 1);
+    while (!stack.empty())
+    {
+        std::pair<s32, s32> entry = stack.back();
+        stack.pop_back();
+        height = std::max(height, entry.second);
+        Node const& node = m_nodes[entry.first];
+        if (!node.IsLeaf())
+        {
+            stack.emplace_back(node.Left, entry.second + 1);
+            stack.emplace_back(node.Right, entry.second + 1);
+        }
+    }
+    return height;
+}
+
+bool BoundingVolumeHierarchy::Validate() const
+{
+    if (m_root == NullNode)
+        return m_leafCount == 0;
+    bool valid = m_nodes[m_root].Parent == NullNode;
+    s32 leaves = validate(m_root, valid);
+    return valid && leaves == static_cast<s32>(m_leafCount);
+}
+
+s32 BoundingVolumeHierarchy::validate(s32 index, bool& valid) const
+{
+    Node const& node = m_nodes[index];
+    if (node.IsLeaf())
+        return 1;
+    Node const& left = m_nodes[node.Left];
+    Node const& right = m_nodes[node.Right];
+    if (left.Parent != index || right.Parent != index
+        || !node.Box.Contains(left.Box) || !node.Box.Contains(right.Box))
+    {
+        valid = false;
+    }
+    return validate(node.Left, valid) + validate(node.Right, valid);
+}
+
+s32 BoundingVolumeHierarchy::allocateNode()
+{
+    if (m_freeList == NullNode)
+    {
+        m_nodes.emplace_back();
+        return static_cast<s32>(m_nodes.size()) - 1;
+    }
+    s32 node = m_freeList;
+    m_freeList = m_nodes[node].Parent;
+    m_nodes[node] = Node();
+    return node;
+}
+
+void BoundingVolumeHierarchy::freeNode(s32 node)
+{
+    m_nodes[node] = Node();
+    m_nodes[node].Parent = m_freeList;
+    m_freeList = node;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(s32 leaf)
+{
+    if (m_root == NullNode)
+    {
+        m_root = leaf;
+        m_nodes[leaf].Parent = NullNode;
+        return;
+    }
+
+    //walk down to the sibling that grows the tree surface the least
+    BoundingAABB const box = m_nodes[leaf].Box;
+    s32 index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        Node const& node = m_nodes[index];
+        float area = node.Box.SurfaceArea();
+        float combinedArea = BoundingAABB::Merged(node.Box, box).SurfaceArea();
+        //cost of pairing with this node, and the growth every deeper choice inherits
+        float cost = 2.0f * combinedArea;
+        float inheritedCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [this, &box, inheritedCost](s32 child)
+        {
+            Node const& childNode = m_nodes[child];
+            float grownArea = BoundingAABB::Merged(childNode.Box, box).SurfaceArea();
+            if (childNode.IsLeaf())
+                return grownArea + inheritedCost;
+            return grownArea - childNode.Box.SurfaceArea() + inheritedCost;
+        };
+        float leftCost = descendCost(node.Left);
+        float rightCost = descendCost(node.Right);
+        if (cost < leftCost && cost < rightCost)
+            break;
+        index = leftCost < rightCost ? node.Left : node.Right;
+    }
+
+    s32 sibling = index;
+    s32 oldParent = m_nodes[sibling].Parent;
+    s32 newParent = allocateNode();
+    m_nodes[newParent].Parent = oldParent;
+    m_nodes[newParent].Box = BoundingAABB::Merged(box, m_nodes[sibling].Box);
+    m_nodes[newParent].Left = sibling;
+    m_nodes[newParent].Right = leaf;
+    m_nodes[sibling].Parent = newParent;
+    m_nodes[leaf].Parent = newParent;
+
+    if (oldParent == NullNode)
+    {
+        m_root = newParent;
+        return;
+    }
+    if (m_nodes[oldParent].Left == sibling)
+        m_nodes[oldParent].Left = newParent;
+    else
+        m_nodes[oldParent].Right = newParent;
+    refitAncestors(oldParent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(s32 leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NullNode;
+        return;
+    }
+    s32 parent = m_nodes[leaf].Parent;
+    s32 grandParent = m_nodes[parent].Parent;
+    s32 sibling = m_nodes[parent].Left == leaf ? m_nodes[parent].Right : m_nodes[parent].Left;
+
+    if (grandParent == NullNode)
+    {
+        m_root = sibling;
+        m_nodes[sibling].Parent = NullNode;
+    }
+    else
+    {
+        if (m_nodes[grandParent].Left == parent)
+            m_nodes[grandParent].Left = sibling;
+        else
+            m_nodes[grandParent].Right = sibling;
+        m_nodes[sibling].Parent = grandParent;
+        refitAncestors(grandParent);
+    }
+    freeNode(parent);
+}
+
+void BoundingVolumeHierarchy::refitAncestors(s32 index)
+{
+    while (index != NullNode)
+    {
+        Node& node = m_nodes[index];
+        node.Box = BoundingAABB::Merged(m_nodes[node.Left].Box, m_nodes[node.Right].Box);
+        index = node.Parent;
+    }
+}
+
+s32 BoundingVolumeHierarchy::buildSAH(std::vector<s32>& leaves, std::vector<Math::Vector3> const& centers, u32 begin, u32 end)
+{
+    u32 count = end - begin;
+    if (count == 1)
+        return leaves[begin];
+
+    BoundingAABB bounds = m_nodes[leaves[begin]].Box;
+    BoundingAABB centerBounds(centers[leaves[begin]], centers[leaves[begin]]);
+    for (u32 i = begin + 1; i < end; ++i)
+    {
+        bounds = BoundingAABB::Merged(bounds, m_nodes[leaves[i]].Box);
+        centerBounds = BoundingAABB::Merged(centerBounds, BoundingAABB(centers[leaves[i]], centers[leaves[i]]));
+    }
+
+    //bin along the axis the centers spread the most
+    Math::Vector3 spread = centerBounds.aabbMax - centerBounds.aabbMin;
+    unsigned axis = 0;
+    if (spread.y > spread[axis]) axis = 1;
+    if (spread.z > spread[axis]) axis = 2;
+
+    u32 mid = begin + count / 2;
+    if (spread[axis] > 0.0f)
+    {
+        struct Bin
+        {
+            BoundingAABB Box;
+            u32 Count = 0;
+        };
+        Bin bins[c_sahBins];
+        float binScale = c_sahBins / spread[axis];
+        auto binOf = [&](s32 leaf)
+        {
+            u32 bin = static_cast<u32>((centers[leaf][axis] - centerBounds.aabbMin[axis]) * binScale);
+            return std::min(bin, c_sahBins - 1);
+        };
+        for (u32 i = begin; i < end; ++i)
+        {
+            Bin& bin = bins[binOf(leaves[i])];
+            bin.Box = bin.Count ? BoundingAABB::Merged(bin.Box, m_nodes[leaves[i]].Box) : m_nodes[leaves[i]].Box;
+            ++bin.Count;
+        }
+
+        //sweep from the right to get the area of everything right of each split
+        float rightArea[c_sahBins];
+        u32 rightCount[c_sahBins];
+        BoundingAABB sweep;
+        u32 sweepCount = 0;
+        for (u32 b = c_sahBins - 1; b > 0; --b)
+        {
+            if (bins[b].Count)
+            {
+                sweep = sweepCount ? BoundingAABB::Merged(sweep, bins[b].Box) : bins[b].Box;
+                sweepCount += bins[b].Count;
+            }
+            rightArea[b] = sweepCount ? sweep.SurfaceArea() : 0.0f;
+            rightCount[b] = sweepCount;
+        }
+
+        //split after bin b: left is [0, b], right is [b + 1, bins)
+        float bestCost = FLT_MAX;
+        u32 bestSplit = c_sahBins;
+        sweepCount = 0;
+        for (u32 b = 0; b + 1 < c_sahBins; ++b)
+        {
+            if (bins[b].Count)
+            {
+                sweep = sweepCount ? BoundingAABB::Merged(sweep, bins[b].Box) : bins[b].Box;
+                sweepCount += bins[b].Count;
+            }
+            if (sweepCount == 0 || rightCount[b + 1] == 0)
+                continue;
+            float cost = sweep.SurfaceArea() * sweepCount + rightArea[b + 1] * rightCount[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        if (bestSplit != c_sahBins)
+        {
+            auto split = std::partition(leaves.begin() + begin, leaves.begin() + end,
+                [&](s32 leaf) { return binOf(leaf) <= bestSplit; });
+            mid = static_cast<u32>(split - leaves.begin());
+        }
+    }
+    //all centers in one spot (or one bin), any split is as good as another
+    if (mid == begin || mid == end)
+        mid = begin + count / 2;
+
+    s32 node = allocateNode();
+    s32 left = buildSAH(leaves, centers, begin, mid);
+    s32 right = buildSAH(leaves, centers, mid, end);
+    m_nodes[node].Box = bounds;
+    m_nodes[node].Left = left;
+    m_nodes[node].Right = right;
+    m_nodes[left].Parent = node;
+    m_nodes[right].Parent = node;
+    return node;
+}
+
+BoundingVolumeHierarchy::Benchmark BoundingVolumeHierarchy::MeasureQueries(u32 objectCount, u32 queryCount)
+{
+    using namespace Math;
+    Benchmark result;
+    result.ObjectCount = objectCount;
+    result.QueryCount = queryCount;
+
+    //constant density: about one object per 8 cubic units whatever the count
+    float halfExtent = std::cbrt(static_cast<float>(objectCount)) * 1.0f;
+    std::mt19937 random(4321);
+    std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+    std::uniform_real_distribution<float> radius(0.1f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, c_TwoPi);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<BoundingSphere> spheres(objectCount);
+    for (BoundingSphere& sphere : spheres)
+        sphere = BoundingSphere(Vector3(position(random), position(random), position(random)), radius(random));
+
+    BoundingVolumeHierarchy tree(0.0f);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (u32 i = 0; i < objectCount; ++i)
+        tree.Insert(i, BoundingAABB::FromSphere(spheres[i]));
+    result.InsertMilliseconds = elapsedMilliseconds(start);
+    result.CostInserted = tree.GetCost();
+    start = std::chrono::high_resolution_clock::now();
+    tree.Rebuild();
+    result.RebuildMilliseconds = elapsedMilliseconds(start);
+    result.CostRebuilt = tree.GetCost();
+
+    //frusta: cameras inside the volume looking in random directions
+    std::vector<Graphics::Frustum> frusta(queryCount);
+    Matrix4 projection = Matrix4::CreateProjection(1.0f, 16.0f, 9.0f, 0.1f, halfExtent);
+    for (Graphics::Frustum& frustum : frusta)
+    {
+        Matrix3 rotation;
+        rotation.SetIdentity();
+        rotation.Rotate(Vector3(unit(random), unit(random), unit(random)).Normalized(), angle(random));
+        Matrix4 camera = BuildTransform(Vector3(position(random), position(random), position(random)) * 0.5f, rotation, Vector3(1, 1, 1));
+        frustum = Graphics::Frustum(projection * camera.Inverted());
+    }
+    start = std::chrono::high_resolution_clock::now();
+    u32 frustumHits = 0;
+    for (Graphics::Frustum const& frustum : frusta)
+    {
+        tree.QueryFrustum(frustum, [&](ObjectId id, bool inside)
+        {
+            if (inside || frustum.IntersectsSphere(spheres[id].center, spheres[id].radius))
+                ++frustumHits;
+        });
+    }
+    result.FrustumMilliseconds = elapsedMilliseconds(start);
+    start = std::chrono::high_resolution_clock::now();
+    u32 bruteFrustumHits = 0;
+    for (Graphics::Frustum const& frustum : frusta)
+    {
+        for (BoundingSphere const& sphere : spheres)
+        {
+            if (frustum.IntersectsSphere(sphere.center, sphere.radius))
+                ++bruteFrustumHits;
+        }
+    }
+    result.FrustumBruteForceMilliseconds = elapsedMilliseconds(start);
+    result.ResultsMatch &= frustumHits == bruteFrustumHits;
+
+    //rays: picking from random points in random directions
+    std::vector<Ray> rays(queryCount);
+    for (Ray& ray : rays)
+        ray = Ray(Vector3(position(random), position(random), position(random)), Vector3(unit(random), unit(random), unit(random)).Normalized());
+    std::vector<float> nearest(queryCount, -1.0f);
+    start = std::chrono::high_resolution_clock::now();
+    for (u32 q = 0; q < queryCount; ++q)
+    {
+        float distance = 0.0f;
+        bool hit = tree.RayCast(rays[q], &distance, [&](ObjectId id, float& t)
+        {
+            return rays[q].CheckCollisionSphere(spheres[id].center, spheres[id].radius, &t);
+        });
+        nearest[q] = hit ? distance : -1.0f;
+    }
+    result.RayMilliseconds = elapsedMilliseconds(start);
+    start = std::chrono::high_resolution_clock::now();
+    for (u32 q = 0; q < queryCount; ++q)
+    {
+        float bestT = FLT_MAX;
+        for (BoundingSphere const& sphere : spheres)
+        {
+            float t;
+            if (rays[q].CheckCollisionSphere(sphere.center, sphere.radius, &t) && t < bestT)
+                bestT = t;
+        }
+        result.ResultsMatch &= (bestT == FLT_MAX ? -1.0f : bestT) == nearest[q];
+    }
+    result.RayBruteForceMilliseconds = elapsedMilliseconds(start);
+
+    //boxes: a few units wide, like a proximity or selection query
+    std::vector<BoundingAABB> boxes(queryCount);
+    for (BoundingAABB& box : boxes)
+    {
+        Vector3 center(position(random), position(random), position(random));
+        box = BoundingAABB(center - Vector3(2, 2, 2), center + Vector3(2, 2, 2));
+    }
+    std::vector<std::vector<ObjectId>> overlaps(queryCount);
+    start = std::chrono::high_resolution_clock::now();
+    for (u32 q = 0; q < queryCount; ++q)
+    {
+        tree.QueryOverlap(boxes[q], [&](ObjectId id)
+        {
+            if (BoundingAABB::FromSphere(spheres[id]).Overlaps(boxes[q]))
+                overlaps[q].push_back(id);
+        });
+    }
+    result.OverlapMilliseconds = elapsedMilliseconds(start);
+    std::vector<std::vector<ObjectId>> bruteOverlaps(queryCount);
+    start = std::chrono::high_resolution_clock::now();
+    for (u32 q = 0; q < queryCount; ++q)
+    {
+        for (u32 i = 0; i < objectCount; ++i)
+        {
+            if (BoundingAABB::FromSphere(spheres[i]).Overlaps(boxes[q]))
+                bruteOverlaps[q].push_back(i);
+        }
+    }
+    result.OverlapBruteForceMilliseconds = elapsedMilliseconds(start);
+    for (u32 q = 0; q < queryCount; ++q)
+    {
+        std::sort(overlaps[q].begin(), overlaps[q].end());
+        result.ResultsMatch &= overlaps[q] == bruteOverlaps[q];
+    }
+    return result;
+}
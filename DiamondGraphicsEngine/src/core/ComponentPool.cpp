@@ -1,5 +1,6 @@
 #include "Precompiled.h"
 #include "core/ComponentPool.h"
+#include "framework/Profiler.h"
 
 std::unordered_map<std::type_index, ComponentPoolManager*> ComponentPoolManager::m_pools = std::unordered_map<std::type_index, ComponentPoolManager*>();
 std::map<UpdateOrder, std::vector<TypeIndex> > ComponentPoolManager::m_updateOrder;
@@ -7,6 +8,7 @@ std::map<UpdateOrder, std::vector<TypeIndex> > ComponentPoolManager::m_updateOrd
 
 void ComponentPoolManager::UpdateAllComponentPools(Scene* scene, float dt)
 {
+    PROFILE_SCOPE("ComponentPoolManager::UpdateAllComponentPools");
     for (auto& i : m_updateOrder)
     {
         for (auto& j : i.second)
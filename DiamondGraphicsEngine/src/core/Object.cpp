@@ -67,7 +67,6 @@ void Object::Reflect(TwBar* editor, std::string const& barName, Graphics::Graphi
 
 BoundingSphere Object::GetBoundingSphere()
 {
-    using namespace Math;
     BoundingSphere sphere;
     if (HasComponent<Component::Renderer>())
     {
@@ -75,15 +74,8 @@ BoundingSphere Object::GetBoundingSphere()
         size_t meshId = 0;
         if (renderer.HasMesh(meshId))
         {            
-            sphere = renderer.GetMesh(meshId)->GetBoundingSphere();
             Component::Transform& trans = GetComponentRef<Component::Transform>();
-            Matrix4 worldTrans = trans.GetWorldTransform();
-
-            Vector3 aPointOnSphere = sphere.radius*Vector3(1, 0, 0) + sphere.center;
-            sphere.center = TransformPoint(worldTrans, sphere.center);
-            Vector3 transformedPointOnSphere = TransformPoint(worldTrans, aPointOnSphere);
-
-            sphere.radius = (sphere.center - transformedPointOnSphere).Length();
+            sphere = renderer.GetMesh(meshId)->GetBoundingSphere().Transformed(trans.GetWorldTransform());
         }
     }
     return sphere;
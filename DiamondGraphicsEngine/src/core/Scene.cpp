@@ -1,7 +1,16 @@
 #include "Precompiled.h"
 #include "core/Scene.h"
+#include "framework/FrameTimings.h"
+#include "framework/Profiler.h"
 #include "core/components/Transform.h"
 #include "core/components/Renderer.h"
+#include "math/MathBatch.h"
+
+namespace
+{
+    //below this many objects one SIMD sweep over all spheres beats walking the tree
+    const u32 c_treeCullingThreshold = 4096;
+}
 
 Scene::Scene()
 {
@@ -93,13 +102,18 @@ void Scene::StartScene()
     DEBUG_PRINT_DATA_FLOW
     initializeHierarchicalTransform();
     initializeRenderObjectList();
+    //objects were inserted one by one while the scene was set up
+    m_objectTree.Rebuild();
 
     ComponentPoolManager::StartAllComponentPools(this);
 }
 
 void Scene::UpdateScene(float dt)
 {
+    PROFILE_SCOPE("Scene::UpdateScene");
+    ScopedFrameTiming timing("subsystem", "Scene update");
     ComponentPoolManager::UpdateAllComponentPools(this, dt);
+    m_objectTree.RebuildIfDegraded();
 }
 
 
@@ -108,11 +122,13 @@ void Scene::initializeHierarchicalTransform()
     DEBUG_PRINT_DATA_FLOW
     using namespace Component;
     auto roots = m_hierarchicalObjectHandler.GetRootsRef();
+    std::vector<ObjectId> updated;
     for (auto& i : roots)
     {
         //set all children's world matrices
-        InitTransformTree(&i.second);
+        initTransformTree(&i.second, updated);
     }
+    UpdateCullingSpheres(updated);
 }
 
 void Scene::initializeRenderObjectList()
@@ -129,8 +145,22 @@ void Scene::initializeRenderObjectList()
     }
 }
 
-//DFS traverse to set all children's transform
 void Scene::InitTransformTree(HierarchicalObjectHandlerNode* node)
+{
+    std::vector<ObjectId> updated;
+    initTransformTree(node, updated);
+    UpdateCullingSpheres(updated);
+}
+
+void Scene::UpdateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matrix4 const& parentWorldMatrix)
+{
+    std::vector<ObjectId> updated;
+    updateTransformTree(node, parentWorldMatrix, updated);
+    UpdateCullingSpheres(updated);
+}
+
+//DFS traverse to set all children's transform
+void Scene::initTransformTree(HierarchicalObjectHandlerNode* node, std::vector<ObjectId>& updated)
 {
     using namespace Component;
 
@@ -150,15 +180,16 @@ void Scene::InitTransformTree(HierarchicalObjectHandlerNode* node)
         Transform& currTransToSet = curToSetRef.GetComponentRef<Transform>();
         currTransToSet.SetWorldTransform(currTransToSet.CalcLocalTransform());
     }
+    updated.push_back(hCurrentToSet.GetId());
 
     ///dfs traverse all children
     for (auto& i : node->m_children)
     {
-        InitTransformTree(&i.second);
+        initTransformTree(&i.second, updated);
     }
 }
 
-void Scene::UpdateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matrix4 const& parentWorldMatrix)
+void Scene::updateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matrix4 const& parentWorldMatrix, std::vector<ObjectId>& updated)
 {//BUG function transform rotation does not perform correctly
     using namespace Component;
 
@@ -169,11 +200,217 @@ void Scene::UpdateTransformTree(HierarchicalObjectHandlerNode* node, Math::Matri
     Transform& currTransToSet = curToSetRef.GetComponentRef<Transform>();
     Math::Matrix4 newWorldMatrix = parentWorldMatrix * currTransToSet.GetLocalTransform();
     currTransToSet.SetWorldTransform(newWorldMatrix);
+    updated.push_back(hCurrentToSet.GetId());
 
     for (auto& i : node->m_children)
     {
-        UpdateTransformTree(&i.second, newWorldMatrix);
+        updateTransformTree(&i.second, newWorldMatrix, updated);
+    }
+}
+
+void Scene::UpdateCullingSphere(Object& obj)
+{
+    UpdateCullingSpheres(std::vector<ObjectId>(1, obj.GetHandle().GetId()));
+}
+
+void Scene::UpdateCullingSpheres(std::vector<ObjectId> const& ids)
+{
+    using namespace Component;
+    //the local sphere of every mesh with the world transform of its object, meshCounts[i] of them for ids[i]
+    std::vector<u32> meshCounts(ids.size(), 0);
+    std::vector<Math::Matrix4> transforms;
+    Math::SphereArray spheres;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        Object& obj = GetObjectRef(ObjectHandle(ids[i]));
+        Renderer* renderer = obj.HasComponent<Renderer>() ? &obj.GetComponentRef<Renderer>() : nullptr;
+        Math::Matrix4 const& worldTrans = obj.GetComponentRef<Transform>().GetWorldTransform();
+        for (size_t slot = 0; renderer && slot < renderer->GetMeshSlotCount(); ++slot)
+        {
+            std::shared_ptr<Graphics::Mesh> mesh = renderer->GetMesh(slot);
+            if (mesh == nullptr)
+            {
+                continue;
+            }
+            BoundingSphere const& local = mesh->GetBoundingSphere();
+            spheres.x.push_back(local.center.x);
+            spheres.y.push_back(local.center.y);
+            spheres.z.push_back(local.center.z);
+            spheres.radius.push_back(local.radius);
+            transforms.push_back(worldTrans);
+            ++meshCounts[i];
+        }
+    }
+    //same spheres as BoundingSphere::Transformed, in place
+    Math::Batch::TransformSpheres(transforms.data(), spheres.GetSpan(), spheres.GetSpan());
+
+    //one sphere enclosing every mesh of the renderer
+    size_t next = 0;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        bool hasBounds = false;
+        BoundingSphere bounds;
+        for (u32 mesh = 0; mesh < meshCounts[i]; ++mesh, ++next)
+        {
+            BoundingSphere sphere(Math::Vector3(spheres.x[next], spheres.y[next], spheres.z[next]), spheres.radius[next]);
+            if (hasBounds == false)
+            {
+                bounds = sphere;
+                hasBounds = true;
+                continue;
+            }
+            float dist = (sphere.center - bounds.center).Length();
+            if (dist + sphere.radius <= bounds.radius)
+            {
+                continue;
+            }
+            if (dist + bounds.radius <= sphere.radius)
+            {
+                bounds = sphere;
+                continue;
+            }
+            float radius = (dist + bounds.radius + sphere.radius) * 0.5f;
+            bounds.center += (sphere.center - bounds.center) * ((radius - bounds.radius) / dist);
+            bounds.radius = radius;
+        }
+        setCullingSphere(ids[i], hasBounds, bounds);
+    }
+}
+
+void Scene::setCullingSphere(ObjectId id, bool hasBounds, BoundingSphere const& bounds)
+{
+    if (static_cast<size_t>(id) >= m_objectTreeLeaves.size())
+    {
+        m_objectTreeLeaves.resize(id + 1, BoundingVolumeHierarchy::NullNode);
+    }
+    s32& leaf = m_objectTreeLeaves[id];
+
+    if (hasBounds == false)
+    {
+        m_frustumCuller.SetAlwaysVisible(id);
+        if (leaf != BoundingVolumeHierarchy::NullNode)
+        {
+            m_objectTree.Remove(leaf);
+            leaf = BoundingVolumeHierarchy::NullNode;
+        }
+        return;
+    }
+
+    m_frustumCuller.SetSphere(id, bounds);
+    if (leaf == BoundingVolumeHierarchy::NullNode)
+    {
+        leaf = m_objectTree.Insert(id, BoundingAABB::FromSphere(bounds));
+    }
+    else
+    {
+        m_objectTree.Update(leaf, BoundingAABB::FromSphere(bounds));
+    }
+}
+
+Graphics::CullStats Scene::CullObjects(Graphics::Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const
+{
+    if (m_objectTree.GetObjectCount() < c_treeCullingThreshold)
+    {
+        return m_frustumCuller.Cull(frustum, visible, visibleMask);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    u32 count = m_frustumCuller.GetCount();
+    visibleMask.assign(count, 0);
+    m_objectTree.QueryFrustum(frustum, [&](ObjectId id, bool inside)
+    {
+        if (inside)
+        {
+            visibleMask[id] = 1;
+            return;
+        }
+        BoundingSphere sphere = m_frustumCuller.GetSphere(id);
+        visibleMask[id] = frustum.IntersectsSphere(sphere.center, sphere.radius) ? 1 : 0;
+    });
+    //objects without bounds are not in the tree and always drawn
+    visible.clear();
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (visibleMask[i] == 0 && m_frustumCuller.IsAlwaysVisible(i))
+        {
+            visibleMask[i] = 1;
+        }
+        if (visibleMask[i])
+        {
+            visible.push_back(i);
+        }
+    }
+
+    Graphics::CullStats stats;
+    stats.Tested = count;
+    stats.Visible = static_cast<u32>(visible.size());
+    stats.Culled = stats.Tested - stats.Visible;
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    stats.Milliseconds = elapsed.count();
+    return stats;
+}
+
+bool Scene::rayCastMeshes(Object& obj, Ray const& ray, float* distance)
+{
+    using namespace Component;
+    if (obj.HasComponent<Renderer>() == false)
+    {
+        return false;
+    }
+    //the meshes test in object space, the cached inverse takes the ray there
+    Ray local = ray.Transform(obj.GetComponentRef<Transform>().GetInverseWorldTransform());
+    float localLength = local.GetRayDirection().Length();
+    local.SetRayDirection(local.GetRayDirection() / localLength);
+
+    Renderer& renderer = obj.GetComponentRef<Renderer>();
+    float nearestT = FLT_MAX;
+    for (size_t slot = 0; slot < renderer.GetMeshSlotCount(); ++slot)
+    {
+        std::shared_ptr<Graphics::Mesh> mesh = renderer.GetMesh(slot);
+        float t;
+        if (mesh && mesh->RayCast(local, &t) && t < nearestT)
+        {
+            nearestT = t;
+        }
+    }
+    if (nearestT == FLT_MAX)
+    {
+        return false;
+    }
+    //a unit along the world ray is localLength units along the local one
+    *distance = nearestT / localLength;
+    return true;
+}
+
+Object* Scene::PickObject(Ray const& ray, float* distance)
+{
+    float nearestT = FLT_MAX;
+    ObjectId nearest = -1;
+    bool hit = m_objectTree.RayCast(ray, &nearestT, [&](ObjectId id, float& t)
+    {
+        BoundingSphere sphere = m_frustumCuller.GetSphere(id);
+        if (ray.CheckCollisionSphere(sphere.center, sphere.radius, &t) == false || t >= nearestT)
+        {
+            return false;
+        }
+        //the world sphere is loose around non-uniformly scaled or multi mesh objects
+        if (rayCastMeshes(GetObjectRef(ObjectHandle(id)), ray, &t) == false || t >= nearestT)
+        {
+            return false;
+        }
+        nearestT = t;
+        nearest = id;
+        return true;
+    });
+    if (hit == false)
+    {
+        return nullptr;
+    }
+    if (distance)
+    {
+        *distance = nearestT;
     }
+    return &m_objects[nearest];
 }
 
 void Scene::OnObjectShaderTypeChanged(Object* obj, Graphics::ShaderType oldType, Graphics::ShaderType newType)
@@ -10,6 +10,7 @@
 #include "framework/Application.h"
 #include "graphics/FramebufferManager.h"
 #include "graphics/Framebuffer.h"
+#include "graphics/FrameCapture.h"
 
 namespace
 {
@@ -117,10 +118,10 @@ namespace
         for (u8 i = 0; i < 4; i++)
         {
             std::shared_ptr<Graphics::Texture> renderedTexture = fboManager->GetFramebuffer(Graphics::FramebufferType::DeferredGBuffer)->GetFboColorAttachment(i);
-            renderedTexture->Bind(0);
-            renderedTexture->DownloadContents();
-            renderedTexture->Unbind();
-            renderedTexture->SavePNG(renderedTexture, std::string("Buffer") + std::to_string(i) + ".png");
+            if (renderedTexture == nullptr)//compact G-buffer has no position target
+                continue;
+            //read back and written over the next frames, see FrameCapture
+            graphics->GetFrameCapture()->CaptureTexture(*renderedTexture, std::string("Buffer") + std::to_string(i));
         }
 #endif //DEFERRED_SHADING_TEST
     }
@@ -133,6 +134,16 @@ namespace
         TwType deferredRenderType = TwDefineEnumFromString(nullptr, "Combined, Diffuse Color, World Position, World Normal, Specular Color, Depth, Shadow Map, SSAO");
         TwAddVarRW(resourceBar, nullptr, deferredRenderType, &graphics->DebugRenderUniform.OutputIndex, "label='Debug Render Target'");
         TwAddSeparator(resourceBar, nullptr, nullptr);
+        TwAddVarRW(resourceBar, nullptr, TW_TYPE_BOOL32, &graphics->DebugRenderUniform.EnableFrustumCulling, "label='Enable Frustum Culling'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_UINT32, &graphics->CameraCulling.Visible, "label='Visible Objects'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_UINT32, &graphics->CameraCulling.Culled, "label='Culled Objects'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_UINT32, &graphics->ShadowCulling.Visible, "label='Shadow Casters'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_FLOAT, &graphics->CameraCulling.Milliseconds, "label='Culling Time (ms)'");
+        TwAddVarRW(resourceBar, nullptr, TW_TYPE_BOOL32, &graphics->DebugRenderUniform.EnableOcclusionCulling, "label='Enable Occlusion Culling'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_UINT32, &graphics->OcclusionCulling.Occluded, "label='Occluded Objects'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_FLOAT, &graphics->OcclusionCulling.RasterMilliseconds, "label='Occluder Raster Time (ms)'");
+        TwAddVarRO(resourceBar, nullptr, TW_TYPE_FLOAT, &graphics->OcclusionCulling.TestMilliseconds, "label='Occlusion Test Time (ms)'");
+        TwAddSeparator(resourceBar, nullptr, nullptr);
         TwAddVarRW(resourceBar, nullptr, TW_TYPE_BOOL32, &graphics->DebugRenderUniform.EnableSSAO, "label='Enable SSAO'");
         TwAddVarRW(resourceBar, nullptr, TW_TYPE_POINT(2, 0.05f, "Linear", "Exponent"), &graphics->SSAO.ControlVariable, "label='SSAO Darkness Variables'");
         TwAddVarRW(resourceBar, nullptr, TW_TYPE_BOOL32, &graphics->SSAO.UseSpiralAlgorithm, "label='SSAO Use Spiral Algorithm' ");
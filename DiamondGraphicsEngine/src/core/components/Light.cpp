@@ -140,7 +140,7 @@ namespace Component
             }
             if (m_attribute->shadowType != Graphics::ShadowType::NoShadow)
             {
-                m_attribute->viewproj = projection*worldTrans.Inverted();
+                m_attribute->viewproj = projection * trans.GetInverseWorldTransform();
             }
         }
     }
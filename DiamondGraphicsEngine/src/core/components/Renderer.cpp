@@ -7,6 +7,9 @@
 #include "graphics/MaterialManager.h"
 #include "graphics/MeshManager.h"
 #include "graphics/ShaderProgram.h"
+#include "graphics/TextureManager.h"
+#include "graphics/CameraBase.h"
+#include "framework/Application.h"
 
 ////////////////////////////////////////////
 //  used for editor
@@ -64,6 +67,37 @@ Component::Renderer::Renderer(
     }
 }
 
+void Component::Renderer::requestTextureDetail(Graphics::GraphicsEngine* g)
+{
+    Graphics::TextureManager& textureManager = *g->GetTextureManager();
+    if (!textureManager.IsStreaming())
+    {
+        return;
+    }
+    //the densest mapped mesh decides
+    float uvDensity = 0.0f;
+    float objectRadius = 0.0f;
+    for (auto& i : m_meshes)
+    {
+        if (i.second != nullptr && i.first == true && i.second->GetUvDensity() * i.second->GetBoundingSphere().radius > uvDensity * objectRadius)
+        {
+            uvDensity = i.second->GetUvDensity();
+            objectRadius = i.second->GetBoundingSphere().radius;
+        }
+    }
+    if (objectRadius <= 0.0f)
+    {
+        return;
+    }
+    Graphics::CameraBase* camera = g->GetViewCamera();
+    BoundingSphere sphere = m_owner->GetBoundingSphere();
+    float distance = (sphere.center - camera->GetCameraWorldPosition()).Length();
+    float screenHeight = static_cast<float>(Application::GetInstance().GetWindowHeight());
+    float uvPerPixel = Graphics::TextureResidency::EstimateUvPerPixel(uvDensity, objectRadius, sphere.radius,
+        distance, camera->GetFieldOfViewRadians(), screenHeight);
+    m_material->RequestTextureDetail(textureManager, uvPerPixel);
+}
+
 void Component::Renderer::Start()
 {
     DEBUG_PRINT_DATA_FLOW
@@ -116,6 +150,7 @@ void Component::Renderer::SetShaderParams(std::shared_ptr<Graphics::ShaderProgra
         if (shaderUsage == Graphics::ShaderUsage::RegularVSPS)
         {
             m_material->SetShaderParameters(shader, g);
+            requestTextureDetail(g);
         }
 #ifdef _DEBUG
         m_hasMaterial = true;
@@ -192,6 +227,13 @@ Component::Renderer& Component::Renderer::AssignMaterial(std::shared_ptr<Graphic
     return *this;
 }
 
+Component::Renderer& Component::Renderer::SetOccluder(bool isOccluder, std::shared_ptr<Graphics::TriangleMesh> occluder)
+{
+    m_isOccluder = isOccluder;
+    m_occluderMesh = std::move(occluder);
+    return *this;
+}
+
 Component::Renderer& Component::Renderer::AttachMesh(std::shared_ptr<Graphics::Mesh> mesh)
 {
     if (mesh)
@@ -208,6 +250,7 @@ Component::Renderer& Component::Renderer::ReplaceMesh(size_t meshId, std::shared
 {
     Assert(meshId < m_meshes.size(), "Invalid index to get mesh.");
     m_meshes[meshId].second = (mesh);
+    OnMeshChanged();
     return *this;
 }
 
@@ -315,6 +358,10 @@ void Component::Renderer::OnMaterialChanged()
 
 void Component::Renderer::OnMeshChanged()
 {
+    if (m_owner && m_owner->GetScene())
+    {
+        m_owner->GetScene()->UpdateCullingSphere(*m_owner);
+    }
 }
 
 void Component::Renderer::resetMeshEditor(std::string const& oldMatGroupName, size_t meshId)
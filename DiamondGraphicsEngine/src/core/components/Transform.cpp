@@ -1,13 +1,50 @@
 #include "Precompiled.h"
 #include "core/components/Transform.h"
 #include "core/Scene.h"
+#include "framework/FrameTimings.h"
 #include "graphics/GraphicsEngine.h"
 #include "graphics/CameraBase.h"
 #include "core/components/Renderer.h"
 #include "core/TwImpl.h"
 #include "graphics/ShaderProgram.h"
+#include "math/MathFunctions.h"
 
 
+namespace
+{
+    //true when the upper 3x3 is a rotation times a scale, which it stops being
+    //once a non-uniformly scaled parent shears a rotated child
+    bool hasOrthogonalAxes(Math::Matrix4 const& matrix)
+    {
+        const float tolerance = 1e-5f;
+        Math::Vector3 column0(matrix.m00, matrix.m10, matrix.m20);
+        Math::Vector3 column1(matrix.m01, matrix.m11, matrix.m21);
+        Math::Vector3 column2(matrix.m02, matrix.m12, matrix.m22);
+        auto orthogonal = [tolerance](Math::Vector3 const& lhs, Math::Vector3 const& rhs)
+        {
+            float dot = Math::Dot(lhs, rhs);
+            return dot * dot <= tolerance * tolerance * lhs.LengthSq() * rhs.LengthSq();
+        };
+        return orthogonal(column0, column1) && orthogonal(column1, column2) && orthogonal(column2, column0);
+    }
+
+    template <typename Element, typename Function>
+    float nanosecondsPerElement(std::vector<Element> const& elements, Function function)
+    {
+        //summed so the inverses can't be optimized away
+        volatile float sink = 0.0f;
+        float sum = 0.0f;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (Element const& element : elements)
+        {
+            sum += function(element).m03;
+        }
+        std::chrono::duration<float, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+        sink = sum;
+        return elapsed.count() / elements.size();
+    }
+}
+
 namespace TwCallBack
 {
     void TW_CALL GetPosition(void *value, void *clientData)
@@ -62,6 +99,7 @@ void Component::Transform::SetShaderParams(std::shared_ptr<Graphics::ShaderProgr
         Math::Matrix4 const& modelMatrix = GetWorldTransform();
         Math::Matrix4 mvp = graphics->GetViewCamera()->GetViewProjMatrix() * modelMatrix;
         shader->SetUniform("ModelMatrix", modelMatrix);
+        shader->SetUniform("NormalMatrix", GetNormalMatrix());
         shader->SetUniform("ModelViewProjectionMatrix", mvp);
     }
     else if (shaderUsage == Graphics::ShaderUsage::LightShadowMap)
@@ -105,31 +143,14 @@ Component::Transform& Component::Transform::Scale(float uniformScale)
 
 Component::Transform& Component::Transform::Rotate(Math::Vector3 const& angleRadianXYZ)
 {
-    m_rotationEuler += angleRadianXYZ;
-    if (m_rotationEuler.x > Math::c_TwoPi)
-    {
-        m_rotationEuler.x -= Math::c_TwoPi;
-    }
-    else if (m_rotationEuler.x < -Math::c_TwoPi)
-    {
-        m_rotationEuler.x += Math::c_TwoPi;
-    }
-    if (m_rotationEuler.y > Math::c_TwoPi)
-    {
-        m_rotationEuler.y -= Math::c_TwoPi;
-    }
-    else if (m_rotationEuler.x < -Math::c_TwoPi)
-    {
-        m_rotationEuler.y += Math::c_TwoPi;
-    }
-    if (m_rotationEuler.z > Math::c_TwoPi)
-    {
-        m_rotationEuler.z -= Math::c_TwoPi;
-    }
-    else if (m_rotationEuler.z < -Math::c_TwoPi)
-    {
-        m_rotationEuler.z += Math::c_TwoPi;
-    }
+    return Rotate(Math::ToQuaternion(Math::EulerAngles(angleRadianXYZ, Math::EulerOrders::XYZs)));
+}
+
+Component::Transform& Component::Transform::Rotate(Math::Quaternion const& rotation)
+{
+    //renormalized so rounding doesn't build up over many small rotations
+    m_rotation = (rotation * m_rotation).Normalized();
+    m_eulerDirty = true;
     OnTransformChanged();
     return *this;
 }
@@ -154,6 +175,18 @@ Math::Matrix4 const& Component::Transform::GetWorldTransform() const
     return m_worldTransform;
 }
 
+Math::Matrix4 const& Component::Transform::GetInverseWorldTransform() const
+{
+    updateInverse();
+    return m_inverseWorldTransform;
+}
+
+Math::Matrix3 const& Component::Transform::GetNormalMatrix() const
+{
+    updateInverse();
+    return m_normalMatrix;
+}
+
 Component::Transform& Component::Transform::SetPosition(Math::Vector3 const& pos)
 {
     m_position = pos;
@@ -163,11 +196,37 @@ Component::Transform& Component::Transform::SetPosition(Math::Vector3 const& pos
 
 Component::Transform& Component::Transform::SetRotation(Math::Vector3 const& rotEuler)
 {
+    //same rotation as Rz * Ry * Rx
+    return setRotation(Math::ToQuaternion(Math::EulerAngles(rotEuler, Math::EulerOrders::XYZs)), rotEuler);
+}
+
+Component::Transform& Component::Transform::SetRotation(Math::Quaternion const& rotation)
+{
+    m_rotation = rotation;
+    m_eulerDirty = true;
+    OnTransformChanged();
+    return *this;
+}
+
+Component::Transform& Component::Transform::setRotation(Math::Quaternion const& rotation, Math::Vector3 const& rotEuler)
+{
+    m_rotation = rotation;
     m_rotationEuler = rotEuler;
+    m_eulerDirty = false;
     OnTransformChanged();
     return *this;
 }
 
+Math::Vector3 const& Component::Transform::GetRotationEuler() const
+{
+    if (m_eulerDirty)
+    {
+        m_rotationEuler = Math::ToEulerAngles(m_rotation, Math::EulerOrders::XYZs).Angles;
+        m_eulerDirty = false;
+    }
+    return m_rotationEuler;
+}
+
 Component::Transform& Component::Transform::SetScale(Math::Vector3 const& scale)
 {
     m_scale = scale;
@@ -201,24 +260,83 @@ void Component::Transform::SetLocalTransform(Math::Matrix4 const& localTrans)
 
 void Component::Transform::SetWorldTransform(Math::Matrix4 const& worldTrans)
 {
+    //the whole subtree is rewritten on any change, most of it with the same matrix
+    if (worldTrans == m_worldTransform)
+    {
+        return;
+    }
     m_worldTransform = worldTrans;
+    m_inverseDirty = true;
 }
 
-Math::Matrix4 Component::Transform::CalcLocalTransform()
+void Component::Transform::updateInverse() const
 {
+    if (m_inverseDirty == false)
+    {
+        return;
+    }
+    m_inverseWorldTransform = hasOrthogonalAxes(m_worldTransform)
+        ? m_worldTransform.TrsInverted()
+        : m_worldTransform.AffineInverted();
+
+    //transpose of the inverse's upper 3x3
+    Math::Matrix4 const& inverse = m_inverseWorldTransform;
+    m_normalMatrix = Math::Matrix3(inverse.m00, inverse.m10, inverse.m20,
+                                   inverse.m01, inverse.m11, inverse.m21,
+                                   inverse.m02, inverse.m12, inverse.m22);
+    m_inverseDirty = false;
+}
+
+Component::Transform::InverseBenchmark Component::Transform::MeasureInverse(unsigned count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
 
-    Math::Matrix3 rotMatX;
-    Math::Matrix3 rotMatY;
-    Math::Matrix3 rotMatZ;
-    rotMatX.Rotate(Math::Vector3::cXAxis, m_rotationEuler.x);
-    rotMatY.Rotate(Math::Vector3::cYAxis, m_rotationEuler.y);
-    rotMatZ.Rotate(Math::Vector3::cZAxis, m_rotationEuler.z);
+    std::vector<Math::Matrix4> matrices(count);
+    for (Math::Matrix4& matrix : matrices)
+    {
+        Math::Quaternion rotation(unit(random), unit(random), unit(random), unit(random));
+        matrix = Math::BuildTransform(Math::Vector3(position(random), position(random), position(random)),
+            rotation.Normalized(), Math::Vector3(scale(random), scale(random), scale(random)));
+    }
+
+    InverseBenchmark benchmark;
+    benchmark.GeneralNanoseconds = nanosecondsPerElement(matrices, [](Math::Matrix4 const& m) { return m.Inverted(); });
+    benchmark.AffineNanoseconds = nanosecondsPerElement(matrices, [](Math::Matrix4 const& m) { return m.AffineInverted(); });
+    benchmark.TrsNanoseconds = nanosecondsPerElement(matrices, [](Math::Matrix4 const& m) { return m.TrsInverted(); });
+
+    //the first call after a change pays for the inverse and the normal matrix, later ones read the cache
+    std::vector<Transform> transforms(count, Transform(Graphics::ShaderType::Null));
+    for (unsigned i = 0; i < count; ++i)
+    {
+        transforms[i].SetWorldTransform(matrices[i]);
+    }
+    auto inverse = [](Transform const& transform) { return transform.GetInverseWorldTransform(); };
+    benchmark.UpdateNanoseconds = nanosecondsPerElement(transforms, inverse);
+    benchmark.CachedNanoseconds = nanosecondsPerElement(transforms, inverse);
 
-    Math::Matrix3 rotMat = rotMatZ* rotMatY*rotMatX;    
-    
+    for (Math::Matrix4 const& matrix : matrices)
+    {
+        Math::Matrix4 product = matrix.TrsInverted() * matrix;
+        for (unsigned r = 0; r < 4; ++r)
+        {
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                float expected = r == c ? 1.0f : 0.0f;
+                benchmark.MaxError = std::max(benchmark.MaxError, std::abs(product(r, c) - expected));
+            }
+        }
+    }
+    return benchmark;
+}
+
+Math::Matrix4 Component::Transform::CalcLocalTransform()
+{
     m_localTransform.BuildTransform(
         m_position,
-        rotMat,
+        m_rotation,
         m_scale
     );
     return m_localTransform;
@@ -226,6 +344,7 @@ Math::Matrix4 Component::Transform::CalcLocalTransform()
 
 void Component::Transform::OnTransformChanged()
 {
+    ScopedFrameTiming timing("subsystem", "Transform propagation");
     CalcLocalTransform();
     if (m_owner)
     {
@@ -250,3 +369,81 @@ void Component::Transform::OnTransformChanged()
         SetWorldTransform(m_localTransform);
     }
 }
+
+Component::Transform::RotationBenchmark Component::Transform::MeasureRotation(unsigned count, unsigned frames, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> angle(-Math::c_Pi, Math::c_Pi);
+    std::uniform_real_distribution<float> speed(-0.05f, 0.05f);
+
+    //objects spinning around Y, where adding Euler angles and composing rotations agree
+    std::vector<Transform> eulerTransforms(count, Transform(Graphics::ShaderType::Null));
+    std::vector<Math::Vector3> angles(count), spins(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        angles[i] = Math::Vector3(0.0f, angle(random), 0.0f);
+        spins[i] = Math::Vector3(0.0f, speed(random), 0.0f);
+        eulerTransforms[i].SetRotation(angles[i]);
+    }
+    std::vector<Transform> quaternionTransforms = eulerTransforms;
+    std::vector<Transform> fastTransforms = eulerTransforms;
+    std::vector<Math::Vector3> fastAngles = angles;
+    std::vector<Math::Quaternion> spinQuaternions(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        spinQuaternions[i] = Math::ToQuaternion(Math::EulerAngles(spins[i], Math::EulerOrders::XYZs));
+    }
+
+    RotationBenchmark benchmark;
+    benchmark.Objects = count;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned frame = 0; frame < frames; ++frame)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            angles[i] += spins[i];
+            eulerTransforms[i].SetRotation(angles[i]);
+        }
+    }
+    std::chrono::duration<float, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+    benchmark.EulerNanoseconds = elapsed.count() / (float(count) * frames);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned frame = 0; frame < frames; ++frame)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            fastAngles[i] += spins[i];
+            fastTransforms[i].SetRotation<Math::FastMath>(fastAngles[i]);
+        }
+    }
+    elapsed = std::chrono::high_resolution_clock::now() - start;
+    benchmark.FastEulerNanoseconds = elapsed.count() / (float(count) * frames);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned frame = 0; frame < frames; ++frame)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            quaternionTransforms[i].Rotate(spinQuaternions[i]);
+        }
+    }
+    elapsed = std::chrono::high_resolution_clock::now() - start;
+    benchmark.QuaternionNanoseconds = elapsed.count() / (float(count) * frames);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        Math::Matrix4 const& euler = eulerTransforms[i].GetLocalTransform();
+        Math::Matrix4 const& quaternion = quaternionTransforms[i].GetLocalTransform();
+        Math::Matrix4 const& fast = fastTransforms[i].GetLocalTransform();
+        for (unsigned r = 0; r < 3; ++r)
+        {
+            for (unsigned c = 0; c < 3; ++c)
+            {
+                benchmark.MaxError = std::max(benchmark.MaxError, std::abs(euler(r, c) - quaternion(r, c)));
+                benchmark.FastEulerError = std::max(benchmark.FastEulerError, std::abs(euler(r, c) - fast(r, c)));
+            }
+        }
+    }
+    return benchmark;
+}
@@ -2,6 +2,17 @@
 #include "framework/Application.h"
 #include "framework/Debug.h"
 #include "math/Matrix4.h"
+#if HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace
+{
+    EGLDisplay s_eglDisplay = EGL_NO_DISPLAY;
+    EGLContext s_eglContext = EGL_NO_CONTEXT;
+    EGLSurface s_eglSurface = EGL_NO_SURFACE;
+}
+#endif // HEADLESS_EGL
 
 // These callbacks are wrapped in this struct so they may have private scope
 // access to an instance of Application.
@@ -60,6 +71,77 @@ void Application::Initialize(int argc, char* argv[], std::string const& title, u
     Assert(GLEW_VERSION_4_3, "OpenGL 4.3 not supported.");
 }
 
+void Application::InitializeHeadless(int argc, char* argv[], std::string const& title, unsigned width,
+                                     unsigned height)
+{
+    m_windowTitle = title;
+    m_windowWidth = width;
+    m_windowHeight = height;
+    m_headless = true;
+
+#if HEADLESS_EGL
+    UNUSED_VAR(argc)
+    UNUSED_VAR(argv)
+    // no window system at all: a desktop GL 4.3 core context on the default
+    // display, which is Mesa's surfaceless platform on a machine without X
+    s_eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0, minor = 0;
+    EGLBoolean initialized = s_eglDisplay != EGL_NO_DISPLAY ? eglInitialize(s_eglDisplay, &major, &minor) : EGL_FALSE;
+    Assert(initialized, "Could not initialize EGL.");
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+        EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(s_eglDisplay, configAttributes, &config, 1, &configCount);
+    Assert(configCount > 0, "No EGL config for a headless GL context.");
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE };
+    s_eglContext = eglCreateContext(s_eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    Assert(s_eglContext != EGL_NO_CONTEXT, "Could not create a headless GL 4.3 context.");
+
+    // everything is drawn to our own framebuffer, a surface is only made if
+    // the driver can't make a context current without one
+    char const* extensions = eglQueryString(s_eglDisplay, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        s_eglSurface = eglCreatePbufferSurface(s_eglDisplay, config, surfaceAttributes);
+    }
+    EGLBoolean current = eglMakeCurrent(s_eglDisplay, s_eglSurface, s_eglSurface, s_eglContext);
+    Assert(current, "Could not make the headless GL context current.");
+#else
+    // a window is needed for the context but it is never shown; with Mesa's
+    // opengl32.dll next to the executable this renders on llvmpipe, no GPU needed
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_STENCIL);
+    glutInitContextFlags(GLUT_CORE_PROFILE);
+    glutInitContextProfile(GLUT_FORWARD_COMPATIBLE);
+    glutInitWindowSize(1, 1);
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
+    m_windowHandle = glutCreateWindow(m_windowTitle.c_str());
+    glutHideWindow();
+    glutMainLoopEvent();
+#endif // HEADLESS_EGL
+
+    glewExperimental = GL_TRUE;
+    CheckGlew(glewInit());
+    // glewInit can leave GL_INVAL_ENUM behind on core contexts
+    glGetError();
+    Assert(GLEW_VERSION_4_3, "OpenGL 4.3 not supported.");
+
+    createScreenFramebuffer();
+}
+
 void Application::Run(InitClientCallBack initCallback,
                       UpdateClientCallBack updateCallback, CleanUpClientCallBack cleanupCallback,
                       void* initUserData/* = NULL*/, void* updateUserData/* = NULL*/,
@@ -99,8 +181,71 @@ void Application::Run(InitClientCallBack initCallback,
     // finished; return execution to the caller
 }
 
+Application::FrameStats Application::RunHeadless(InitClientCallBack initCallback,
+                                                 UpdateClientCallBack updateCallback, CleanUpClientCallBack cleanupCallback,
+                                                 unsigned frameCount, float fixedDeltaTime, unsigned warmupFrames/* = 0*/,
+                                                 void* userData/* = NULL*/)
+{
+    Assert(m_headless, "RunHeadless needs InitializeHeadless.");
+    m_updateCallback = updateCallback;
+    m_updateCallbackData = userData;
+    m_cleanupCallback = cleanupCallback;
+    m_cleanupCallbackData = userData;
+    m_closeRequested = false;
+    ApplicationWrapper::OnInitialize();
+    if (initCallback)
+        initCallback(this, userData);
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(frameCount);
+    for (unsigned frame = 0; frame < warmupFrames + frameCount && !m_closeRequested; ++frame)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        glBindFramebuffer(GL_FRAMEBUFFER, m_screenFramebuffer);
+        glViewport(0, 0, m_windowWidth, m_windowHeight);
+        // the update callback may swap itself (e.g. loading -> update), so it is read every frame
+        m_updateCallback(this, fixedDeltaTime, m_updateCallbackData);
+        // nothing to swap; wait for the GPU instead so the frame is really done
+        glFinish();
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (frame >= warmupFrames)
+            frameTimes.push_back(elapsed.count());
+    }
+
+    ApplicationWrapper::OnClose();
+    destroyHeadlessContext();
+
+    FrameStats stats;
+    stats.WarmupFrames = warmupFrames;
+    stats.Frames = static_cast<unsigned>(frameTimes.size());
+    if (frameTimes.empty())
+        return stats;
+    for (float time : frameTimes)
+        stats.TotalMilliseconds += time;
+    stats.AverageMilliseconds = stats.TotalMilliseconds / frameTimes.size();
+    std::sort(frameTimes.begin(), frameTimes.end());
+    // nearest rank percentiles
+    auto percentile = [&frameTimes](float p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p * frameTimes.size()));
+        return frameTimes[std::min(std::max(rank, size_t(1)), frameTimes.size()) - 1];
+    };
+    stats.MedianMilliseconds = percentile(0.5f);
+    stats.P95Milliseconds = percentile(0.95f);
+    stats.P99Milliseconds = percentile(0.99f);
+    stats.MinMilliseconds = frameTimes.front();
+    stats.MaxMilliseconds = frameTimes.back();
+    return stats;
+}
+
 void Application::Close()
 {
+    if (m_headless)
+    {
+        // RunHeadless stops after this frame and calls the cleanup itself
+        m_closeRequested = true;
+        return;
+    }
     // cleanup the application and ImGui
     ApplicationWrapper::OnClose();
     glutLeaveMainLoop();
@@ -142,6 +287,47 @@ Ray Application::GetRayFromScreenCoords(int x, int y, Math::Vector3 const& camer
     return ray;
 }
 
+void Application::createScreenFramebuffer()
+{
+    glGenRenderbuffers(2, m_screenRenderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_screenRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_windowWidth, m_windowHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_screenRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_windowWidth, m_windowHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_screenFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_screenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_screenRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_screenRenderbuffers[1]);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    Assert(status == GL_FRAMEBUFFER_COMPLETE, "Offscreen screen framebuffer is incomplete: 0x%x.", status);
+    glViewport(0, 0, m_windowWidth, m_windowHeight);
+}
+
+void Application::destroyHeadlessContext()
+{
+    if (m_screenFramebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_screenFramebuffer);
+        glDeleteRenderbuffers(2, m_screenRenderbuffers);
+        m_screenFramebuffer = 0;
+        m_screenRenderbuffers[0] = m_screenRenderbuffers[1] = 0;
+    }
+#if HEADLESS_EGL
+    if (s_eglDisplay != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(s_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (s_eglSurface != EGL_NO_SURFACE)
+            eglDestroySurface(s_eglDisplay, s_eglSurface);
+        eglDestroyContext(s_eglDisplay, s_eglContext);
+        eglTerminate(s_eglDisplay);
+        s_eglDisplay = EGL_NO_DISPLAY;
+    }
+#endif // HEADLESS_EGL
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////  Application Interface  ///////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
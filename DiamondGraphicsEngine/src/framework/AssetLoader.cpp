@@ -0,0 +1,222 @@
+#include "Precompiled.h"
+#include "framework/AssetLoader.h"
+#include "framework/Profiler.h"
+
+#include <limits>
+
+namespace
+{
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    thread_local bool s_isWorkerThread = false;
+}
+
+bool AssetLoadHandle::State::finish(AssetLoadStatus from, AssetLoadStatus to)
+{
+    if (!Status.compare_exchange_strong(from, to))
+        return false;
+    --*Outstanding;
+    signal();
+    return true;
+}
+
+void AssetLoadHandle::State::signal()
+{
+    if (!Signaled.exchange(true))
+        Loaded.set_value();
+}
+
+AssetLoadStatus AssetLoadHandle::GetStatus() const
+{
+    return m_state ? m_state->Status.load() : AssetLoadStatus::Done;
+}
+
+std::string const& AssetLoadHandle::GetName() const
+{
+    static std::string const emptyName;
+    return m_state ? m_state->Name : emptyName;
+}
+
+bool AssetLoadHandle::IsFinished() const
+{
+    AssetLoadStatus status = GetStatus();
+    return status == AssetLoadStatus::Done || status == AssetLoadStatus::Cancelled;
+}
+
+bool AssetLoadHandle::Cancel() const
+{
+    if (!m_state)
+        return false;
+    //a running load is left to its worker, which sees the request once Load returns
+    m_state->CancelRequested = true;
+    for (;;)
+    {
+        AssetLoadStatus status = m_state->Status.load();
+        if (status == AssetLoadStatus::Done)
+            return false;
+        if (status == AssetLoadStatus::Loading || status == AssetLoadStatus::Cancelled)
+            return true;
+        //queued or loaded, tried again if the status moved on in between
+        if (m_state->finish(status, AssetLoadStatus::Cancelled))
+            return true;
+    }
+}
+
+void AssetLoadHandle::Wait() const
+{
+    if (m_state)
+        m_state->LoadedFuture.wait();
+}
+
+AssetLoader::AssetLoader(u32 workerCount)
+{
+    if (workerCount == 0)
+    {
+        u32 hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+    m_workers.reserve(workerCount);
+    for (u32 i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(&AssetLoader::workerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    CancelAll();
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+AssetLoader& AssetLoader::GetShared()
+{
+    static AssetLoader shared;
+    return shared;
+}
+
+bool AssetLoader::IsWorkerThread()
+{
+    return s_isWorkerThread;
+}
+
+AssetLoadHandle AssetLoader::Submit(std::string const& name, std::function<void()> load,
+    std::function<void()> finalize, AssetPriority priority)
+{
+    std::shared_ptr<AssetLoadHandle::State> state = std::make_shared<AssetLoadHandle::State>();
+    state->Name = name;
+    state->LoadedFuture = state->Loaded.get_future().share();
+    state->Outstanding = &m_outstanding;
+    ++m_outstanding;
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobs.push(Job{ priority, m_nextSequence++, state, std::move(load), std::move(finalize) });
+    }
+    m_jobAvailable.notify_one();
+    return AssetLoadHandle(state);
+}
+
+u32 AssetLoader::FinalizeLoaded(float budgetMilliseconds)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    u32 finalized = 0;
+    while (finalized == 0 || elapsedMilliseconds(start) < budgetMilliseconds)
+    {
+        PendingFinalize pending;
+        {
+            std::lock_guard<std::mutex> lock(m_finalizeMutex);
+            if (m_finalizeQueue.empty())
+                break;
+            pending = std::move(m_finalizeQueue.front());
+            m_finalizeQueue.pop_front();
+        }
+        //cancelled after it was loaded, drop it
+        if (pending.State->Status.load() != AssetLoadStatus::Loaded)
+            continue;
+        pending.Finalize();
+        if (pending.State->finish(AssetLoadStatus::Loaded, AssetLoadStatus::Done))
+            ++finalized;
+    }
+    return finalized;
+}
+
+u32 AssetLoader::FinalizeAll()
+{
+    return FinalizeLoaded(std::numeric_limits<float>::max());
+}
+
+void AssetLoader::CancelAll()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        while (!m_jobs.empty())
+        {
+            AssetLoadHandle(m_jobs.top().State).Cancel();
+            m_jobs.pop();
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_finalizeMutex);
+    for (PendingFinalize& pending : m_finalizeQueue)
+    {
+        AssetLoadHandle(pending.State).Cancel();
+    }
+    m_finalizeQueue.clear();
+}
+
+void AssetLoader::workerLoop()
+{
+    PROFILE_THREAD("Asset loader");
+    s_isWorkerThread = true;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping && m_jobs.empty())
+                return;
+            job = m_jobs.top();
+            m_jobs.pop();
+        }
+
+        AssetLoadStatus queued = AssetLoadStatus::Queued;
+        if (!job.State->Status.compare_exchange_strong(queued, AssetLoadStatus::Loading))
+            continue;//cancelled while queued
+
+        {
+            PROFILE_SCOPE("AssetLoader job");
+            job.Load();
+        }
+
+        //only the worker moves a load on from Loading, a Cancel meanwhile left it the request
+        if (!job.Finalize)
+        {
+            job.State->finish(AssetLoadStatus::Loading,
+                job.State->CancelRequested ? AssetLoadStatus::Cancelled : AssetLoadStatus::Done);
+            continue;
+        }
+        job.State->Status = AssetLoadStatus::Loaded;
+        //checked after the status is Loaded, so a Cancel either sees Loaded or set it before this
+        if (job.State->CancelRequested)
+        {
+            job.State->finish(AssetLoadStatus::Loaded, AssetLoadStatus::Cancelled);
+            continue;//the result is thrown away
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_finalizeMutex);
+            m_finalizeQueue.push_back(PendingFinalize{ job.State, std::move(job.Finalize) });
+        }
+        job.State->signal();
+    }
+}
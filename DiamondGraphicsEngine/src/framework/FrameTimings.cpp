@@ -0,0 +1,104 @@
+#include "Precompiled.h"
+#include "framework/FrameTimings.h"
+
+bool FrameTimings::s_enabled = false;
+u32 FrameTimings::s_frameCount = 0;
+std::vector<FrameTimings::Section> FrameTimings::s_sections;
+
+void FrameTimings::Add(char const* category, char const* name, float milliseconds)
+{
+    //a frame reaches a dozen sections, a linear search is cheaper than hashing the names
+    for (Section& section : s_sections)
+    {
+        if (section.Name == name && section.Category == category)
+        {
+            section.FrameMilliseconds += milliseconds;
+            return;
+        }
+    }
+    Section section;
+    section.Category = category;
+    section.Name = name;
+    section.FrameMilliseconds = milliseconds;
+    //not reached in the frames before
+    section.Frames.assign(s_frameCount, 0.0f);
+    s_sections.push_back(std::move(section));
+}
+
+void FrameTimings::EndFrame()
+{
+    for (Section& section : s_sections)
+    {
+        section.Frames.push_back(section.FrameMilliseconds);
+        section.FrameMilliseconds = 0.0f;
+    }
+    ++s_frameCount;
+}
+
+void FrameTimings::Reset()
+{
+    s_sections.clear();
+    s_frameCount = 0;
+}
+
+std::vector<FrameTimings::Summary> FrameTimings::Summarize()
+{
+    std::vector<Summary> summaries;
+    for (Section const& section : s_sections)
+    {
+        std::vector<float> frames = section.Frames;
+        Summary summary = Summarize(frames);
+        summary.Category = section.Category;
+        summary.Name = section.Name;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+FrameTimings::Summary FrameTimings::Summarize(std::vector<float>& milliseconds)
+{
+    Summary summary;
+    summary.Frames = static_cast<u32>(milliseconds.size());
+    if (milliseconds.empty())
+        return summary;
+    std::sort(milliseconds.begin(), milliseconds.end());
+    auto percentile = [&milliseconds](float p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p * milliseconds.size()));
+        return milliseconds[std::min(std::max(rank, size_t(1)), milliseconds.size()) - 1];
+    };
+    summary.MinMilliseconds = milliseconds.front();
+    summary.MedianMilliseconds = percentile(0.5f);
+    summary.P99Milliseconds = percentile(0.99f);
+    summary.AverageMilliseconds = std::accumulate(milliseconds.begin(), milliseconds.end(), 0.0f) / milliseconds.size();
+    return summary;
+}
+
+void FrameTimings::WriteJson(std::ostream& os, std::vector<Summary> const& summaries, std::string const& indent)
+{
+    std::vector<std::string> categories;
+    for (Summary const& summary : summaries)
+    {
+        if (std::find(categories.begin(), categories.end(), summary.Category) == categories.end())
+            categories.push_back(summary.Category);
+    }
+
+    os << "{";
+    for (size_t c = 0; c < categories.size(); ++c)
+    {
+        os << (c ? "," : "") << "\n" << indent << "  \"" << categories[c] << "\": {";
+        bool first = true;
+        for (Summary const& summary : summaries)
+        {
+            if (summary.Category != categories[c])
+                continue;
+            //section names are engine literals and pass names, nothing to escape
+            os << (first ? "" : ",") << "\n" << indent << "    \"" << summary.Name << "\": { \"min\": "
+                << summary.MinMilliseconds << ", \"median\": " << summary.MedianMilliseconds << ", \"p99\": "
+                << summary.P99Milliseconds << ", \"average\": " << summary.AverageMilliseconds << " }";
+            first = false;
+        }
+        os << "\n" << indent << "  }";
+    }
+    os << "\n" << indent << "}";
+}
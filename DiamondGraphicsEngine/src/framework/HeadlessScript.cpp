@@ -0,0 +1,81 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "framework/HeadlessScript.h"
+
+bool HeadlessScript::Load(std::string const& path)
+{
+    std::ifstream file(path);
+    WarnIf(!file.is_open(), "Could not open headless script %s.", path.c_str());
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    unsigned lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command))
+            continue;
+
+        bool valid = true;
+        if (command == "size")
+            valid = static_cast<bool>(words >> Width >> Height) && Width > 0 && Height > 0;
+        else if (command == "frames")
+            valid = static_cast<bool>(words >> Frames);
+        else if (command == "warmup")
+            valid = static_cast<bool>(words >> WarmupFrames);
+        else if (command == "step")
+            valid = static_cast<bool>(words >> TimeStep) && TimeStep > 0.0f;
+        else if (command == "camera")
+        {
+            CameraKey key;
+            valid = static_cast<bool>(words >> key.Frame >> key.Position.x >> key.Position.y >> key.Position.z
+                >> key.Rotation.x >> key.Rotation.y >> key.Rotation.z);
+            if (valid)
+                CameraKeys.push_back(key);
+        }
+        else if (command == "capture" || command == "trace" || command == "raster")
+        {
+            Capture capture;
+            valid = static_cast<bool>(words >> capture.Frame >> capture.Path);
+            if (valid)
+                (command == "trace" ? Traces : command == "raster" ? Rasters : Captures).push_back(capture);
+        }
+        else if (command == "sequence")
+            valid = static_cast<bool>(words >> SequencePath >> SequenceStep) && SequenceStep > 0;
+        else
+            valid = false;
+
+        WarnIf(!valid, "%s(%u): cannot read \"%s\".", path.c_str(), lineNumber, line.c_str());
+        if (!valid)
+            return false;
+    }
+
+    std::stable_sort(CameraKeys.begin(), CameraKeys.end(),
+        [](CameraKey const& a, CameraKey const& b) { return a.Frame < b.Frame; });
+    return true;
+}
+
+bool HeadlessScript::SampleCamera(unsigned frame, Math::Vector3& position, Math::Vector3& rotation) const
+{
+    if (CameraKeys.empty())
+        return false;
+    //first key after the frame, the camera holds still before the first and after the last key
+    auto next = std::upper_bound(CameraKeys.begin(), CameraKeys.end(), frame,
+        [](unsigned f, CameraKey const& key) { return f < key.Frame; });
+    if (next == CameraKeys.begin() || next == CameraKeys.end())
+    {
+        CameraKey const& key = next == CameraKeys.end() ? CameraKeys.back() : CameraKeys.front();
+        position = key.Position;
+        rotation = key.Rotation;
+        return true;
+    }
+    CameraKey const& previous = *(next - 1);
+    float t = static_cast<float>(frame - previous.Frame) / static_cast<float>(next->Frame - previous.Frame);
+    position = previous.Position + (next->Position - previous.Position) * t;
+    rotation = previous.Rotation + (next->Rotation - previous.Rotation) * t;
+    return true;
+}
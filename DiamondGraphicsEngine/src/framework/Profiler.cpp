@@ -0,0 +1,307 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "framework/Profiler.h"
+
+#include <iomanip>
+#include <unordered_set>
+
+namespace
+{
+    const u32 c_ringSize = 1 << 14;
+    //GPU timers are read this many frames after they were queued
+    const u32 c_gpuFrameLatency = 4;
+
+    struct ThreadRing
+    {
+        std::array<Profiler::Event, c_ringSize> Events;
+        //events ever written, only the owning thread stores it
+        std::atomic<u64> Head{ 0 };
+        u32 Id = 0;
+        u32 Depth = 0;
+        std::string Name;
+    };
+
+    struct GpuFrame
+    {
+        std::vector<GLuint> Queries;
+        std::vector<char const*> Names;
+        u32 Used = 0;
+        u64 Submitted = 0;
+        bool Pending = false;
+    };
+
+    struct ProfilerState
+    {
+        std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+        std::atomic<bool> Enabled{ true };
+
+        //only taken when a thread records for the first time, when exporting and interning
+        std::mutex Mutex;
+        std::vector<std::shared_ptr<ThreadRing> > Rings;
+        std::unordered_set<std::string> Names;
+
+        //main thread only
+        std::array<GpuFrame, c_gpuFrameLatency> GpuFrames;
+        u32 CurrentGpuFrame = 0;
+        bool GpuActive = false;
+        std::shared_ptr<ThreadRing> GpuRing;
+        std::unordered_map<char const*, float> GpuMilliseconds;
+    };
+
+    ProfilerState& state()
+    {
+        static ProfilerState s_state;
+        return s_state;
+    }
+
+    ThreadRing& threadRing()
+    {
+        //rings are owned by the profiler, so the events of finished threads can still be exported
+        thread_local ThreadRing* s_ring = nullptr;
+        if (!s_ring)
+        {
+            ProfilerState& profiler = state();
+            std::lock_guard<std::mutex> lock(profiler.Mutex);
+            std::shared_ptr<ThreadRing> ring = std::make_shared<ThreadRing>();
+            ring->Id = static_cast<u32>(profiler.Rings.size()) + 1;
+            ring->Name = "Thread " + std::to_string(ring->Id);
+            profiler.Rings.push_back(ring);
+            s_ring = ring.get();
+        }
+        return *s_ring;
+    }
+
+    void record(ThreadRing& ring, Profiler::Event const& event)
+    {
+        u64 head = ring.Head.load(std::memory_order_relaxed);
+        //the slot is not written before the store of Head that made it the next one (see snapshot)
+        std::atomic_thread_fence(std::memory_order_release);
+        ring.Events[head & (c_ringSize - 1)] = event;
+        ring.Head.store(head + 1, std::memory_order_release);
+    }
+
+    // The events of a ring still there after the copy; older ones may have been overwritten while copying.
+    // Read like a seqlock: the owning thread keeps recording, so a slot can be rewritten while it is
+    // copied. Head is read again after the copy, behind an acquire fence that pairs with the release
+    // fence in record, so a copy that saw any part of a newer write also sees that write's Head, and
+    // the events up to the one that slot held are dropped. The copy is a plain read racing the
+    // writer; Event is trivially copyable and a torn copy never survives the check.
+    std::vector<Profiler::Event> snapshot(ThreadRing const& ring)
+    {
+        u64 end = ring.Head.load(std::memory_order_acquire);
+        u64 begin = end > c_ringSize ? end - c_ringSize : 0;
+        std::vector<Profiler::Event> events;
+        events.reserve(static_cast<size_t>(end - begin));
+        for (u64 i = begin; i < end; ++i)
+            events.push_back(ring.Events[i & (c_ringSize - 1)]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        u64 after = ring.Head.load(std::memory_order_relaxed);
+        //the slot of event `after` may be half written, so the event it replaces goes too
+        u64 valid = after + 1 > c_ringSize ? after + 1 - c_ringSize : 0;
+        if (valid > begin)
+            events.erase(events.begin(), events.begin() + static_cast<size_t>(std::min(valid, end) - begin));
+        return events;
+    }
+
+    void readGpuFrame(ProfilerState& profiler, GpuFrame& frame)
+    {
+        //back to back from the first submission, GL_TIME_ELAPSED has no start time
+        u64 begin = frame.Submitted;
+        for (u32 i = 0; i < frame.Used; ++i)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame.Queries[i], GL_QUERY_RESULT, &elapsed);
+            Profiler::Event event;
+            event.Name = frame.Names[i];
+            event.Begin = begin;
+            event.End = begin + elapsed;
+            record(*profiler.GpuRing, event);
+            profiler.GpuMilliseconds[frame.Names[i]] = static_cast<float>(elapsed) / 1000000.0f;
+            begin = event.End;
+        }
+        frame.Used = 0;
+        frame.Pending = false;
+    }
+
+    void writeString(std::ostream& os, std::string const& text)
+    {
+        os << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                os << '\\';
+            os << c;
+        }
+        os << '"';
+    }
+}
+
+Profiler::ScopedMarker::ScopedMarker(char const* name)
+    : m_name(IsEnabled() ? name : nullptr), m_begin(0)
+{
+    if (m_name)
+    {
+        ++threadRing().Depth;
+        m_begin = Now();
+    }
+}
+
+Profiler::ScopedMarker::~ScopedMarker()
+{
+    if (m_name)
+    {
+        Event event;
+        event.Name = m_name;
+        event.Begin = m_begin;
+        event.End = Now();
+        ThreadRing& ring = threadRing();
+        event.Depth = --ring.Depth;
+        record(ring, event);
+    }
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    state().Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+    return state().Enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(std::string const& name)
+{
+    ThreadRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(state().Mutex);
+    ring.Name = name;
+}
+
+char const* Profiler::Intern(std::string const& name)
+{
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.Mutex);
+    //elements of an unordered_set don't move when it rehashes
+    return profiler.Names.insert(name).first->c_str();
+}
+
+void Profiler::BeginGpu(char const* name)
+{
+    ProfilerState& profiler = state();
+    Assert(!profiler.GpuActive, "GPU timers can't nest, %s is inside another.", name);
+    if (!IsEnabled() || profiler.GpuActive)
+        return;
+    GpuFrame& frame = profiler.GpuFrames[profiler.CurrentGpuFrame];
+    if (frame.Used == frame.Queries.size())
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.Queries.push_back(query);
+        frame.Names.push_back(nullptr);
+    }
+    if (frame.Used == 0)
+        frame.Submitted = Now();
+    frame.Names[frame.Used] = name;
+    glBeginQuery(GL_TIME_ELAPSED, frame.Queries[frame.Used++]);
+    profiler.GpuActive = true;
+}
+
+void Profiler::EndGpu()
+{
+    ProfilerState& profiler = state();
+    if (!profiler.GpuActive)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    profiler.GpuActive = false;
+}
+
+void Profiler::EndFrame()
+{
+    ProfilerState& profiler = state();
+    if (!profiler.GpuRing)
+    {
+        std::lock_guard<std::mutex> lock(profiler.Mutex);
+        profiler.GpuRing = std::make_shared<ThreadRing>();
+        profiler.GpuRing->Id = 0;
+        profiler.GpuRing->Name = "GPU";
+        profiler.Rings.push_back(profiler.GpuRing);
+    }
+
+    GpuFrame& current = profiler.GpuFrames[profiler.CurrentGpuFrame];
+    current.Pending = current.Used > 0;
+    profiler.CurrentGpuFrame = (profiler.CurrentGpuFrame + 1) % c_gpuFrameLatency;
+
+    //oldest first, so the GPU track stays in order; the oldest set is reused
+    //next frame and has to be read now, the GPU is normally long done with it
+    for (u32 i = 0; i < c_gpuFrameLatency; ++i)
+    {
+        GpuFrame& frame = profiler.GpuFrames[(profiler.CurrentGpuFrame + i) % c_gpuFrameLatency];
+        if (!frame.Pending)
+            continue;
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(frame.Queries[frame.Used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && i > 0)
+            break;
+        readGpuFrame(profiler, frame);
+    }
+}
+
+float Profiler::GetGpuMilliseconds(char const* name)
+{
+    ProfilerState& profiler = state();
+    auto found = profiler.GpuMilliseconds.find(name);
+    return found == profiler.GpuMilliseconds.end() ? 0.0f : found->second;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& os)
+{
+    std::vector<std::shared_ptr<ThreadRing> > rings;
+    {
+        std::lock_guard<std::mutex> lock(state().Mutex);
+        rings = state().Rings;
+    }
+
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (std::shared_ptr<ThreadRing> const& ring : rings)
+    {
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(state().Mutex);
+            threadName = ring->Name;
+        }
+        os << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->Id
+            << ",\"args\":{\"name\":";
+        writeString(os, threadName);
+        os << "}}";
+        first = false;
+
+        //complete events, in microseconds
+        for (Event const& event : snapshot(*ring))
+        {
+            os << ",\n{\"ph\":\"X\",\"name\":";
+            writeString(os, event.Name);
+            os << ",\"pid\":1,\"tid\":" << ring->Id << ",\"ts\":" << event.Begin / 1000 << "." << std::setw(3)
+                << std::setfill('0') << event.Begin % 1000 << std::setfill(' ') << ",\"dur\":" << (event.End - event.Begin) / 1000
+                << "." << std::setw(3) << std::setfill('0') << (event.End - event.Begin) % 1000 << std::setfill(' ')
+                << ",\"args\":{\"depth\":" << event.Depth << "}}";
+        }
+    }
+    os << "\n]}\n";
+}
+
+bool Profiler::SaveChromeTrace(std::string const& path)
+{
+    std::ofstream file(path);
+    WarnIf(!file.is_open(), "Could not write the profile to %s.", path.c_str());
+    if (!file.is_open())
+        return false;
+    WriteChromeTrace(file);
+    return static_cast<bool>(file);
+}
+
+u64 Profiler::Now()
+{
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - state().Epoch).count());
+}
@@ -0,0 +1,242 @@
+#include "Precompiled.h"
+#include "framework/SelfTest.h"
+#include "core/BoundingVolumeHierarchy.h"
+#include "core/components/Transform.h"
+#include "graphics/FrustumCuller.h"
+#include "graphics/GBufferPacking.h"
+#include "graphics/ImageEncoder.h"
+#include "graphics/MaterialManager.h"
+#include "graphics/MaterialTable.h"
+#include "graphics/Materials.h"
+#include "graphics/MeshManager.h"
+#include "graphics/OcclusionCuller.h"
+#include "graphics/RayTracer.h"
+#include "graphics/RenderDevice.h"
+#include "graphics/SoftwareRasterizer.h"
+#include "graphics/Texture.h"
+#include "graphics/TextureCache.h"
+#include "graphics/TextureResidency.h"
+#include "graphics/TriangleBvh.h"
+#include "graphics/TriangleMesh.h"
+#include "math/FastMath.h"
+#include "math/MathBatch.h"
+#include "math/MathSimd.h"
+
+u32 SelfTest::s_checks = 0;
+u32 SelfTest::s_failed = 0;
+
+namespace
+{
+    //what the compressors reach on the tank textures, a few dB under what they measure
+    const float c_MinBc1Psnr = 35.0f;
+    const float c_MinBc5Psnr = 40.0f;
+    const float c_MinBc7Psnr = 45.0f;
+    //matrix elements of the transforms, all of unit scale
+    const float c_MaxTransformError = 1e-5f;
+    //the fast spherical UVs against the precise ones
+    const float c_MaxFastUvError = 1e-4f;
+    //compact G-buffer round trips, about twice what the 16 and 8 bit targets lose,
+    //positions are held to what the 32F depth allows between the near and far planes
+    const float c_MaxNormalErrorDegrees = 0.05f;
+    const float c_MaxSpecularPowerError = 0.03f;
+    //FastMath sample without --exhaustive, odd so it still hits every pattern of the low mantissa bits
+    const unsigned c_FastMathStride = 257;
+
+    //std::to_string prints the small errors as 0.000000
+    std::string number(double value)
+    {
+        std::ostringstream stream;
+        stream << value;
+        return stream.str();
+    }
+}
+
+u32 SelfTest::Run(Graphics::MeshManager& meshManager, Graphics::MaterialManager& materialManager, bool exhaustive)
+{
+    using namespace Graphics;
+    using Math::Vec3;
+    s_checks = 0;
+    s_failed = 0;
+
+    //textures
+    TextureCache::Benchmark cache = TextureCache::MeasureLoadTime("BTR80A/DF_4k_btr80a02.jpg");
+    check(cache.RoundTrip && cache.LevelCount > 1, "texture cache",
+          std::to_string(cache.LevelCount) + " levels, read back " + (cache.RoundTrip ? "the same" : "different"));
+
+    Texture::DecodeBenchmark decode = Texture::MeasureDecode("BTR80A/DF_4k_btr80a02.jpg");
+    check(decode.Width > 0 && decode.KernelsMatch, "JPEG SIMD kernels", "the SSE2 IDCT or color conversion differs from stb_image");
+
+    const struct
+    {
+        char const* Image;
+        BlockFormat Format;
+        char const* Name;
+        float MinPsnr;
+    } compressed[] = {
+        { "BTR80A/DF_4k_btr80a02.jpg", BlockFormat::BC1, "BC1", c_MinBc1Psnr },
+        { "BTR80A/DF_4k_btr80a02.jpg", BlockFormat::BC7, "BC7", c_MinBc7Psnr },
+        { "BTR80A/btr_base_n.jpg", BlockFormat::BC5, "BC5", c_MinBc5Psnr },
+    };
+    for (auto const& image : compressed)
+    {
+        BlockCompressor::Benchmark encode = TextureCache::MeasureCompression(image.Image, image.Format);
+        check(encode.PSNR >= image.MinPsnr, std::string(image.Name) + " compression",
+              "PSNR " + number(encode.PSNR) + " dB, at least " + number(image.MinPsnr) + " expected");
+    }
+
+    TextureResidency::SimulationResult streaming = TextureResidency::Simulate(500, 3000, 64ull * 1024 * 1024);
+    check(streaming.Consistent && streaming.FramesOverBudget == 0, "texture streaming",
+          std::to_string(streaming.FramesOverBudget) + " frames over budget, bookkeeping "
+          + (streaming.Consistent ? "consistent" : "inconsistent"));
+
+    MaterialTable::Benchmark binding = MaterialTable::MeasureBinding(64, 5000);
+    check(binding.Consistent, "material table", "a texture is off its array layer or a record does not read back");
+
+    const std::pair<ImageFormat, char const*> captureFormats[] = {
+        { ImageFormat::PNG, "PNG" }, { ImageFormat::QOI, "QOI" }, { ImageFormat::Raw, "raw" }
+    };
+    for (auto const& format : captureFormats)
+    {
+        ImageEncoder::Benchmark capture = ImageEncoder::Measure(1280, 720, 3, format.first);
+        check(capture.Bytes > 0 && capture.RoundTrip, std::string("frame capture ") + format.second,
+              std::to_string(capture.Bytes) + " bytes, " + (capture.RoundTrip ? "decodes back" : "does not decode back"));
+    }
+
+    //math
+    for (Math::Simd::Benchmark const& math : Math::Simd::Compare())
+    {
+        check(math.Passed, std::string("SIMD ") + math.Operation,
+              number(math.MaxUlps) + " ULPs from scalar, " + number(math.UlpTolerance) + " allowed");
+    }
+    for (Math::Batch::Benchmark const& batch : Math::Batch::Measure())
+    {
+        check(batch.Passed, std::string("batch ") + batch.Operation + " (" + Math::Batch::GetBackendName(batch.Backend) + ")",
+              number(batch.MaxUlps) + " ULPs from scalar, " + number(batch.UlpTolerance) + " allowed");
+    }
+    //a sample lower bounds the largest error, so it can only miss a failure, never report a wrong one
+    for (Math::FastMathBenchmark const& fastMath : Math::FastMathBenchmark::Measure(exhaustive ? 1 : c_FastMathStride))
+    {
+        check(fastMath.Passed,
+              std::string(fastMath.Tier == Math::MathTier::Fast ? "FastMath::" : "ApproxMath::") + fastMath.Function,
+              "error " + number(fastMath.MaxError) + ", documented " + number(fastMath.ErrorBound));
+    }
+
+    TriangleMesh::PreprocessBenchmark preprocess = TriangleMesh::MeasurePreprocess();
+    check(preprocess.FastUvError <= c_MaxFastUvError, "fast spherical UVs",
+          "UVs " + number(preprocess.FastUvError) + " from the precise ones");
+    Component::Transform::InverseBenchmark inverse = Component::Transform::MeasureInverse();
+    check(inverse.MaxError <= c_MaxTransformError, "TRS inverse",
+          "inverse * matrix is " + number(inverse.MaxError) + " from identity");
+    Component::Transform::RotationBenchmark rotation = Component::Transform::MeasureRotation();
+    check(rotation.MaxError <= c_MaxTransformError && rotation.FastEulerError <= c_MaxTransformError,
+          "quaternion and fast Euler rotation", "Euler against quaternion " + number(rotation.MaxError)
+          + ", against fast Euler " + number(rotation.FastEulerError));
+
+    //scene, seen from where the demo camera starts
+    RenderView view = RenderView::LookAt(Vec3(0, 2.5f, 5), Vec3(0, 0, 0), Math::c_Pi / 4.0f, 1280.0f / 760.0f);
+    GBufferPacking::PrecisionReport gbuffer = GBufferPacking::MeasurePrecision(view.ViewProj, view.NearPlane, view.FarPlane,
+                                                                               GBufferPacking::DepthStorage::Float32);
+    check(gbuffer.MaxNormalErrorDegrees <= c_MaxNormalErrorDegrees
+          && gbuffer.MaxSpecularPowerRelativeError <= c_MaxSpecularPowerError
+          && gbuffer.MaxPositionErrorRatio <= 1.0f, "compact G-buffer",
+          "normal " + number(gbuffer.MaxNormalErrorDegrees) + " deg, spec power "
+          + number(gbuffer.MaxSpecularPowerRelativeError * 100.0f) + "%, position "
+          + number(gbuffer.MaxPositionError) + " (" + number(gbuffer.MaxPositionErrorRatio)
+          + " of what 32F depth allows)");
+    FrustumCuller::Benchmark culling = FrustumCuller::MeasureCullTime(view.ViewProj);
+    check(culling.Visible > 0 && culling.ResultsMatch, "SIMD frustum culling",
+          "the SIMD and scalar paths found different objects visible");
+    BoundingVolumeHierarchy::Benchmark tree = BoundingVolumeHierarchy::MeasureQueries(10000);
+    check(tree.ResultsMatch, "object tree", "frustum, ray or overlap queries differ from brute force");
+
+    //meshes, the trees are built here and the meshes only read
+    std::vector<std::shared_ptr<TriangleMesh>> meshes;
+    for (char const* name : { "teapot", "sponge", "bunny", "horse" })
+    {
+        std::shared_ptr<TriangleMesh> mesh = std::dynamic_pointer_cast<TriangleMesh>(meshManager.GetMesh(name));
+        check(mesh != nullptr, std::string("mesh ") + name, "not loaded");
+        if (mesh)
+            meshes.push_back(mesh);
+    }
+    for (std::shared_ptr<TriangleMesh> const& mesh : meshes)
+    {
+        TriangleBvh::Benchmark picking = TriangleBvh::Measure(*mesh);
+        check(picking.ResultsMatch, "triangle BVH " + mesh->GetLabel(), "the tree and brute force hit different triangles");
+    }
+
+    //the ray tracer and rasterizer shade with copies of the materials, the scene keeps its own
+    std::vector<RayTracer::Instance> traceScene;
+    std::map<TriangleMesh const*, std::shared_ptr<TriangleBvh>> traceTrees;
+    auto addTraced = [&](char const* mesh, char const* material, int illumModel, Vec3 const& position, Vec3 const& scale,
+                         f32 opacity)
+    {
+        RayTracer::Instance instance;
+        instance.Mesh = std::dynamic_pointer_cast<TriangleMesh>(meshManager.GetMesh(mesh));
+        std::shared_ptr<Material> source = materialManager.GetMaterial(material);
+        if (!instance.Mesh || !source)
+            return;
+        instance.Material = std::make_shared<Material>(*source);
+        instance.Material->SetIlluminationModel(illumModel).SetOpacity(opacity);
+        instance.Material->SetDiffuseTextureEnabled(false);
+        instance.World = Math::BuildTransform(position, Math::Quaternion::c_Identity, scale);
+        std::shared_ptr<TriangleBvh>& tree = traceTrees[instance.Mesh.get()];
+        if (!tree)
+        {
+            tree = std::make_shared<TriangleBvh>();
+            tree->Build(*instance.Mesh);
+        }
+        instance.Bvh = tree;
+        traceScene.push_back(instance);
+    };
+    addTraced("cube", "Plane", 2, Vec3(0, -0.55f, 0), Vec3(10, 0.1f, 10), 1.0f);
+    addTraced("teapot", "Teapot", 2, Vec3(-1.5f, 0, 0), Vec3(1, 1, 1), 1.0f);
+    addTraced("sphere", "Sphere", 3, Vec3(0, 0, -1), Vec3(1, 1, 1), 1.0f);
+    addTraced("sphere", "Sphere", 7, Vec3(1.2f, 0, 0.8f), Vec3(1, 1, 1), 0.1f);
+    addTraced("bunny", "Golf", 5, Vec3(1.5f, 0, -1.5f), Vec3(1, 1, 1), 1.0f);
+    std::vector<LightAttribute> traceLights(1);
+    traceLights[0].direction = Math::Vector4(-0.5f, -1.0f, -0.3f, 0.0f);
+    traceLights[0].shadowType = ShadowType::HardShadow;
+    RayTracer::Benchmark trace = RayTracer::Measure(traceScene, traceLights, Vec3(0, 2.5f, 5), Vec3(0, 0, 0),
+                                                    RayTracer::Settings());
+    check(trace.PrimaryRaysHit > 0 && trace.MismatchedHits == 0, "ray tracer packets",
+          std::to_string(trace.MismatchedHits) + " of " + std::to_string(trace.PrimaryRaysHit)
+          + " camera ray hits differ from single rays");
+
+    std::shared_ptr<Material> rasterMaterial;
+    if (std::shared_ptr<Material> source = materialManager.GetMaterial("Teapot"))
+    {
+        rasterMaterial = std::make_shared<Material>(*source);
+        rasterMaterial->SetDiffuseTextureEnabled(false);
+    }
+    check(rasterMaterial != nullptr, "material Teapot", "not loaded");
+    for (std::shared_ptr<TriangleMesh> const& mesh : meshes)
+    {
+        if (!rasterMaterial)
+            break;
+        SoftwareRasterizer::Benchmark raster = SoftwareRasterizer::Measure(mesh, rasterMaterial);
+        check(raster.ImagesMatch, "software rasterizer " + mesh->GetLabel(),
+              "the images on every core, one core and without SSE2 differ");
+    }
+
+    std::shared_ptr<TriangleMesh> occluderMesh = std::dynamic_pointer_cast<TriangleMesh>(meshManager.GetMesh("cube"));
+    check(occluderMesh != nullptr, "mesh cube", "not loaded");
+    if (occluderMesh)
+    {
+        OcclusionCuller::Benchmark occlusion = OcclusionCuller::Measure(occluderMesh);
+        check(occlusion.NotConservative == 0 && occlusion.ResultsMatch, "occlusion culling",
+              std::to_string(occlusion.NotConservative) + " boxes occluded that a depth per pixel sees, thread counts and SSE2 "
+              + (occlusion.ResultsMatch ? "agree" : "disagree"));
+    }
+
+    std::cout << "Self test: " << s_checks - s_failed << "/" << s_checks << " checks passed\n";
+    return s_failed;
+}
+
+void SelfTest::check(bool passed, std::string const& name, std::string const& detail)
+{
+    ++s_checks;
+    if (passed)
+        return;
+    ++s_failed;
+    std::cout << "FAILED " << name << ": " << detail << "\n";
+}
@@ -0,0 +1,93 @@
+#include "Precompiled.h"
+#include "framework/WorkerPool.h"
+
+WorkerPool::WorkerPool(u32 threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    threadCount = threadCount ? threadCount : 1;
+    m_threads.reserve(threadCount - 1);
+    for (u32 i = 1; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::ParallelFor(u32 count, u32 chunkSize, std::function<void(u32, u32)> const& body)
+{
+    if (count == 0)
+        return;
+    chunkSize = chunkSize ? chunkSize : 1;
+    u32 chunkCount = (count + chunkSize - 1) / chunkSize;
+    //one chunk is not worth waking anyone
+    if (m_threads.empty() || chunkCount == 1)
+    {
+        for (u32 begin = 0; begin < count; begin += chunkSize)
+            body(begin, count - begin < chunkSize ? count : begin + chunkSize);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_body = &body;
+        m_count = count;
+        m_chunkSize = chunkSize;
+        m_chunkCount = chunkCount;
+        m_nextChunk = 0;
+        m_busy = static_cast<u32>(m_threads.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    work();
+
+    //the body may only go out of scope once no thread can still be in it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    m_body = nullptr;
+}
+
+void WorkerPool::workerLoop()
+{
+    u64 seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen]() { return m_stopping || m_generation != seen; });
+            if (m_stopping)
+                return;
+            seen = m_generation;
+        }
+        work();
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            last = --m_busy == 0;
+        }
+        if (last)
+            m_done.notify_one();
+    }
+}
+
+void WorkerPool::work()
+{
+    for (u32 chunk = m_nextChunk++; chunk < m_chunkCount; chunk = m_nextChunk++)
+    {
+        u32 begin = chunk * m_chunkSize;
+        u32 end = m_count - begin < m_chunkSize ? m_count : begin + m_chunkSize;
+        (*m_body)(begin, end);
+    }
+}
@@ -0,0 +1,696 @@
+#include "Precompiled.h"
+#include "framework/AssetLoader.h"
+#include "framework/Debug.h"
+#include "framework/ParallelFor.h"
+#include "graphics/BlockCompressor.h"
+
+#include <cfloat>
+#include <cmath>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+namespace
+{
+    using Graphics::BlockFormat;
+
+    //rows of blocks encoded by one task
+    const u32 c_blockRowsPerTask = 4;
+    //BC7 4 bit index weights, out of 64
+    const u32 c_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    //one 4x4 block as floats in [0, 255], channel by channel
+    struct Block
+    {
+        alignas(16) float Channel[4][16];
+    };
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    inline float clampf(float v, float lo, float hi)
+    {
+        return v < lo ? lo : (v > hi ? hi : v);
+    }
+
+    //gather a block, pixels past the border repeat the last row/column
+    void fetchBlock(u8 const* pixels, u32 width, u32 height, u8 channels, u32 bx, u32 by, Block& block)
+    {
+        for (u32 y = 0; y < 4; ++y)
+        {
+            u32 sy = by * 4 + y < height ? by * 4 + y : height - 1;
+            for (u32 x = 0; x < 4; ++x)
+            {
+                u32 sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                u8 const* p = pixels + (size_t(sy) * width + sx) * channels;
+                u32 i = y * 4 + x;
+                block.Channel[0][i] = p[0];
+                block.Channel[1][i] = channels > 1 ? p[1] : 0.0f;
+                block.Channel[2][i] = channels > 2 ? p[2] : 0.0f;
+                block.Channel[3][i] = channels > 3 ? p[3] : 255.0f;
+            }
+        }
+    }
+
+    /*******************************************************
+     * Mean and principal axis (power iteration on the
+     * covariance) of the first N channels. The axis is zero
+     * for a block of one color.
+     *******************************************************/
+    template <u32 N>
+    void principalAxis(Block const& block, float* mean, float* axis)
+    {
+        for (u32 c = 0; c < N; ++c)
+        {
+            float sum = 0.0f;
+            for (u32 i = 0; i < 16; ++i)
+                sum += block.Channel[c][i];
+            mean[c] = sum / 16.0f;
+        }
+        float cov[N][N] = {};
+        for (u32 i = 0; i < 16; ++i)
+        {
+            float d[N];
+            for (u32 c = 0; c < N; ++c)
+                d[c] = block.Channel[c][i] - mean[c];
+            for (u32 a = 0; a < N; ++a)
+                for (u32 b = a; b < N; ++b)
+                    cov[a][b] += d[a] * d[b];
+        }
+        for (u32 a = 0; a < N; ++a)
+            for (u32 b = 0; b < a; ++b)
+                cov[a][b] = cov[b][a];
+
+        //start from the row of the largest variance, it is never orthogonal to the axis
+        u32 start = 0;
+        for (u32 c = 1; c < N; ++c)
+            if (cov[c][c] > cov[start][start])
+                start = c;
+        for (u32 c = 0; c < N; ++c)
+            axis[c] = cov[start][c];
+        for (u32 iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[N] = {};
+            float largest = 0.0f;
+            for (u32 a = 0; a < N; ++a)
+            {
+                for (u32 b = 0; b < N; ++b)
+                    next[a] += cov[a][b] * axis[b];
+                largest = std::fabs(next[a]) > largest ? std::fabs(next[a]) : largest;
+            }
+            if (largest < 1e-6f)
+            {
+                for (u32 c = 0; c < N; ++c)
+                    axis[c] = 0.0f;
+                return;
+            }
+            for (u32 c = 0; c < N; ++c)
+                axis[c] = next[c] / largest;
+        }
+        float length = 0.0f;
+        for (u32 c = 0; c < N; ++c)
+            length += axis[c] * axis[c];
+        length = std::sqrt(length);
+        for (u32 c = 0; c < N; ++c)
+            axis[c] /= length;
+    }
+
+    //endpoints at the ends of the block's projection on its axis, pulled in by inset of the range
+    template <u32 N>
+    void fitEndpoints(Block const& block, float* low, float* high, float inset)
+    {
+        float mean[N], axis[N];
+        principalAxis<N>(block, mean, axis);
+        float tmin = FLT_MAX, tmax = -FLT_MAX;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (u32 c = 0; c < N; ++c)
+                t += (block.Channel[c][i] - mean[c]) * axis[c];
+            tmin = t < tmin ? t : tmin;
+            tmax = t > tmax ? t : tmax;
+        }
+        float range = tmax - tmin;
+        tmin += range * inset;
+        tmax -= range * inset;
+        for (u32 c = 0; c < N; ++c)
+        {
+            low[c] = mean[c] + axis[c] * tmin;
+            high[c] = mean[c] + axis[c] * tmax;
+        }
+    }
+
+    //------------------------------------------------------------ BC1
+
+    u16 quantize565(float const* color)
+    {
+        u32 r = static_cast<u32>(clampf(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        u32 g = static_cast<u32>(clampf(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+        u32 b = static_cast<u32>(clampf(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        return static_cast<u16>((r << 11) | (g << 5) | b);
+    }
+
+    void expand565(u16 color, s32* rgb)
+    {
+        s32 r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    void bc1Palette(u16 c0, u16 c1, s32 palette[4][3])
+    {
+        expand565(c0, palette[0]);
+        expand565(c1, palette[1]);
+        for (u32 c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    /*******************************************************
+     * Pick the nearest of the four colors for every pixel, four
+     * pixels at a time. Swaps the endpoints into 4 color order
+     * (c0 > c1), returns the squared error.
+     *******************************************************/
+    float bc1Indices(Block const& block, u16& c0, u16& c1, u32& indices)
+    {
+        if (c0 < c1)
+            std::swap(c0, c1);
+        s32 palette[4][3];
+        bc1Palette(c0, c1, palette);
+        //equal endpoints would decode in 3 color mode, index 0 is right either way
+        u32 entries = c0 == c1 ? 1 : 4;
+
+        float error = 0.0f;
+        indices = 0;
+        alignas(16) s32 lane[4];
+        alignas(16) float laneError[4];
+        for (u32 i = 0; i < 16; i += 4)
+        {
+            const __m128 r = _mm_load_ps(&block.Channel[0][i]);
+            const __m128 g = _mm_load_ps(&block.Channel[1][i]);
+            const __m128 b = _mm_load_ps(&block.Channel[2][i]);
+            __m128 best = _mm_set1_ps(FLT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (u32 k = 0; k < entries; ++k)
+            {
+                __m128 dr = _mm_sub_ps(r, _mm_set1_ps(float(palette[k][0])));
+                __m128 dg = _mm_sub_ps(g, _mm_set1_ps(float(palette[k][1])));
+                __m128 db = _mm_sub_ps(b, _mm_set1_ps(float(palette[k][2])));
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+                __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+                best = _mm_min_ps(d, best);
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+            }
+            _mm_store_si128(reinterpret_cast<__m128i*>(lane), bestIndex);
+            _mm_store_ps(laneError, best);
+            for (u32 j = 0; j < 4; ++j)
+            {
+                indices |= static_cast<u32>(lane[j]) << (2 * (i + j));
+                error += laneError[j];
+            }
+        }
+        return error;
+    }
+
+    void encodeBC1(Block const& block, u8* out)
+    {
+        float low[3], high[3];
+        fitEndpoints<3>(block, low, high, 1.0f / 16.0f);
+        u16 c0 = quantize565(high), c1 = quantize565(low);
+        u32 indices;
+        float error = bc1Indices(block, c0, c1, indices);
+
+        //least squares endpoints for the chosen indices, kept if they do better
+        const float weight0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {}, bx[3] = {};
+        for (u32 i = 0; i < 16; ++i)
+        {
+            float a = weight0[(indices >> (2 * i)) & 3], b = 1.0f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (u32 c = 0; c < 3; ++c)
+            {
+                ax[c] += a * block.Channel[c][i];
+                bx[c] += b * block.Channel[c][i];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) > 1e-6f)
+        {
+            float e0[3], e1[3];
+            for (u32 c = 0; c < 3; ++c)
+            {
+                e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+                e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+            }
+            u16 r0 = quantize565(e0), r1 = quantize565(e1);
+            u32 refinedIndices;
+            float refinedError = bc1Indices(block, r0, r1, refinedIndices);
+            if (refinedError < error)
+            {
+                c0 = r0; c1 = r1; indices = refinedIndices;
+            }
+        }
+
+        out[0] = static_cast<u8>(c0); out[1] = static_cast<u8>(c0 >> 8);
+        out[2] = static_cast<u8>(c1); out[3] = static_cast<u8>(c1 >> 8);
+        for (u32 i = 0; i < 4; ++i)
+            out[4 + i] = static_cast<u8>(indices >> (8 * i));
+    }
+
+    void decodeBC1(u8 const* in, u8* rgba, u32 stride)
+    {
+        u16 c0 = static_cast<u16>(in[0] | (in[1] << 8));
+        u16 c1 = static_cast<u16>(in[2] | (in[3] << 8));
+        s32 palette[4][3];
+        bc1Palette(c0, c1, palette);
+        bool opaque = c0 > c1;
+        if (!opaque)
+        {
+            //3 color mode, index 3 is transparent black
+            s32 p0[3], p1[3];
+            expand565(c0, p0);
+            expand565(c1, p1);
+            for (u32 c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (p0[c] + p1[c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        u32 indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<u32>(in[7]) << 24);
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 k = (indices >> (2 * i)) & 3;
+            u8* p = rgba + (i / 4) * stride + (i % 4) * 4;
+            p[0] = static_cast<u8>(palette[k][0]);
+            p[1] = static_cast<u8>(palette[k][1]);
+            p[2] = static_cast<u8>(palette[k][2]);
+            p[3] = (opaque || k != 3) ? 255 : 0;
+        }
+    }
+
+    //------------------------------------------------------------ BC4
+
+    void bc4Palette(u8 a0, u8 a1, s32 palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1)
+        {
+            for (s32 i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+        else
+        {
+            for (s32 i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    void encodeBC4(float const* values, u8* out)
+    {
+        float lo = 255.0f, hi = 0.0f;
+        for (u32 i = 0; i < 16; ++i)
+        {
+            lo = values[i] < lo ? values[i] : lo;
+            hi = values[i] > hi ? values[i] : hi;
+        }
+        u8 a0 = static_cast<u8>(hi + 0.5f), a1 = static_cast<u8>(lo + 0.5f);
+        out[0] = a0;
+        out[1] = a1;
+        u64 bits = 0;
+        if (a0 != a1)
+        {
+            s32 palette[8];
+            bc4Palette(a0, a1, palette);
+            for (u32 i = 0; i < 16; ++i)
+            {
+                u32 best = 0;
+                float bestError = FLT_MAX;
+                for (u32 k = 0; k < 8; ++k)
+                {
+                    float d = std::fabs(values[i] - palette[k]);
+                    if (d < bestError)
+                    {
+                        bestError = d;
+                        best = k;
+                    }
+                }
+                bits |= static_cast<u64>(best) << (3 * i);
+            }
+        }
+        for (u32 i = 0; i < 6; ++i)
+            out[2 + i] = static_cast<u8>(bits >> (8 * i));
+    }
+
+    void decodeBC4(u8 const* in, u8* dst, u32 stride, u32 channel)
+    {
+        s32 palette[8];
+        bc4Palette(in[0], in[1], palette);
+        u64 bits = 0;
+        for (u32 i = 0; i < 6; ++i)
+            bits |= static_cast<u64>(in[2 + i]) << (8 * i);
+        for (u32 i = 0; i < 16; ++i)
+            dst[(i / 4) * stride + (i % 4) * 4 + channel] = static_cast<u8>(palette[(bits >> (3 * i)) & 7]);
+    }
+
+    //------------------------------------------------------------ BC7 mode 6
+
+    //7 bit endpoint and p-bit closest to a color, returns the 8 bit value
+    void quantizeBC7(float const* color, u8* q7, u8& pbit, u8* expanded)
+    {
+        float bestError = FLT_MAX;
+        for (u8 p = 0; p < 2; ++p)
+        {
+            u8 q[4];
+            float error = 0.0f;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                float v = (clampf(color[c], 0.0f, 255.0f) - p) * 0.5f;
+                s32 n = static_cast<s32>(v + 0.5f);
+                n = n < 0 ? 0 : (n > 127 ? 127 : n);
+                q[c] = static_cast<u8>(n);
+                float d = float((n << 1) | p) - color[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbit = p;
+                for (u32 c = 0; c < 4; ++c)
+                {
+                    q7[c] = q[c];
+                    expanded[c] = static_cast<u8>((q[c] << 1) | p);
+                }
+            }
+        }
+    }
+
+    //nearest of the 16 interpolated colors, four palette entries per instruction
+    float bc7Indices(Block const& block, u8 const* e0, u8 const* e1, u8* indices)
+    {
+        alignas(16) float palette[4][16];
+        for (u32 k = 0; k < 16; ++k)
+            for (u32 c = 0; c < 4; ++c)
+                palette[c][k] = float(((64 - c_bc7Weights[k]) * e0[c] + c_bc7Weights[k] * e1[c] + 32) >> 6);
+
+        float error = 0.0f;
+        alignas(16) float distance[16];
+        for (u32 i = 0; i < 16; ++i)
+        {
+            const __m128 r = _mm_set1_ps(block.Channel[0][i]);
+            const __m128 g = _mm_set1_ps(block.Channel[1][i]);
+            const __m128 b = _mm_set1_ps(block.Channel[2][i]);
+            const __m128 a = _mm_set1_ps(block.Channel[3][i]);
+            for (u32 k = 0; k < 16; k += 4)
+            {
+                __m128 dr = _mm_sub_ps(r, _mm_load_ps(&palette[0][k]));
+                __m128 dg = _mm_sub_ps(g, _mm_load_ps(&palette[1][k]));
+                __m128 db = _mm_sub_ps(b, _mm_load_ps(&palette[2][k]));
+                __m128 da = _mm_sub_ps(a, _mm_load_ps(&palette[3][k]));
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                                      _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+                _mm_store_ps(&distance[k], d);
+            }
+            u8 best = 0;
+            for (u8 k = 1; k < 16; ++k)
+                if (distance[k] < distance[best])
+                    best = k;
+            indices[i] = best;
+            error += distance[best];
+        }
+        return error;
+    }
+
+    struct BitWriter
+    {
+        u8* Out;
+        u32 Position = 0;
+        void Put(u32 value, u32 bits)
+        {
+            for (u32 i = 0; i < bits; ++i, ++Position)
+                Out[Position >> 3] |= static_cast<u8>(((value >> i) & 1) << (Position & 7));
+        }
+    };
+
+    struct BitReader
+    {
+        u8 const* In;
+        u32 Position = 0;
+        u32 Get(u32 bits)
+        {
+            u32 value = 0;
+            for (u32 i = 0; i < bits; ++i, ++Position)
+                value |= ((In[Position >> 3] >> (Position & 7)) & 1u) << i;
+            return value;
+        }
+    };
+
+    void encodeBC7(Block const& block, u8* out)
+    {
+        float low[4], high[4];
+        fitEndpoints<4>(block, low, high, 0.0f);
+        u8 q0[4], q1[4], e0[4], e1[4], p0, p1;
+        quantizeBC7(low, q0, p0, e0);
+        quantizeBC7(high, q1, p1, e1);
+        u8 indices[16];
+        float error = bc7Indices(block, e0, e1, indices);
+
+        //least squares endpoints for the chosen indices, kept if they do better
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+        for (u32 i = 0; i < 16; ++i)
+        {
+            float b = c_bc7Weights[indices[i]] / 64.0f, a = 1.0f - b;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                ax[c] += a * block.Channel[c][i];
+                bx[c] += b * block.Channel[c][i];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) > 1e-6f)
+        {
+            float l[4], h[4];
+            for (u32 c = 0; c < 4; ++c)
+            {
+                l[c] = (ax[c] * bb - bx[c] * ab) / det;
+                h[c] = (bx[c] * aa - ax[c] * ab) / det;
+            }
+            u8 rq0[4], rq1[4], re0[4], re1[4], rp0, rp1, refined[16];
+            quantizeBC7(l, rq0, rp0, re0);
+            quantizeBC7(h, rq1, rp1, re1);
+            if (bc7Indices(block, re0, re1, refined) < error)
+            {
+                std::memcpy(q0, rq0, 4); std::memcpy(q1, rq1, 4);
+                p0 = rp0; p1 = rp1;
+                std::memcpy(indices, refined, 16);
+            }
+        }
+
+        //the first index is stored with 3 bits, so it must be below 8
+        if (indices[0] >= 8)
+        {
+            std::swap(p0, p1);
+            for (u32 c = 0; c < 4; ++c)
+                std::swap(q0[c], q1[c]);
+            for (u8& index : indices)
+                index = 15 - index;
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter writer{ out };
+        writer.Put(1 << 6, 7);
+        for (u32 c = 0; c < 4; ++c)
+        {
+            writer.Put(q0[c], 7);
+            writer.Put(q1[c], 7);
+        }
+        writer.Put(p0, 1);
+        writer.Put(p1, 1);
+        for (u32 i = 0; i < 16; ++i)
+            writer.Put(indices[i], i == 0 ? 3 : 4);
+    }
+
+    void decodeBC7(u8 const* in, u8* rgba, u32 stride)
+    {
+        if ((in[0] & 0x7f) != (1 << 6))
+        {
+            //other modes are never written by the encoder, show them as magenta
+            for (u32 i = 0; i < 16; ++i)
+            {
+                u8* p = rgba + (i / 4) * stride + (i % 4) * 4;
+                p[0] = 255; p[1] = 0; p[2] = 255; p[3] = 255;
+            }
+            return;
+        }
+        BitReader reader{ in };
+        reader.Get(7);
+        u32 e0[4], e1[4];
+        for (u32 c = 0; c < 4; ++c)
+        {
+            e0[c] = reader.Get(7) << 1;
+            e1[c] = reader.Get(7) << 1;
+        }
+        u32 p0 = reader.Get(1), p1 = reader.Get(1);
+        for (u32 c = 0; c < 4; ++c)
+        {
+            e0[c] |= p0;
+            e1[c] |= p1;
+        }
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 w = c_bc7Weights[reader.Get(i == 0 ? 3 : 4)];
+            u8* p = rgba + (i / 4) * stride + (i % 4) * 4;
+            for (u32 c = 0; c < 4; ++c)
+                p[c] = static_cast<u8>(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+        }
+    }
+}
+
+namespace Graphics
+{
+    u32 BlockCompressor::GetBlockBytes(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return 8;
+        case BlockFormat::BC3:
+        case BlockFormat::BC5:
+        case BlockFormat::BC7: return 16;
+        default:               return 0;
+        }
+    }
+
+    u32 BlockCompressor::GetCompressedSize(BlockFormat format, u32 width, u32 height)
+    {
+        return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+    }
+
+    std::vector<u8> BlockCompressor::Compress(u8 const* pixels, u32 width, u32 height, u8 channels, BlockFormat format)
+    {
+        Assert(format != BlockFormat::None, "Nothing to compress to.");
+        const u32 blockBytes = GetBlockBytes(format);
+        const u32 blocksX = (width + 3) / 4;
+        const u32 blocksY = (height + 3) / 4;
+        std::vector<u8> blocks(size_t(blocksX) * blocksY * blockBytes);
+
+        //a loader worker already compresses a texture per core
+        bool singleThread = blocksX * blocksY < 1024 || AssetLoader::IsWorkerThread();
+        ParallelFor(blocksY, c_blockRowsPerTask, [&](u32 begin, u32 end)
+        {
+            Block block;
+            for (u32 by = begin; by < end; ++by)
+            {
+                for (u32 bx = 0; bx < blocksX; ++bx)
+                {
+                    fetchBlock(pixels, width, height, channels, bx, by, block);
+                    u8* out = &blocks[(size_t(by) * blocksX + bx) * blockBytes];
+                    switch (format)
+                    {
+                    case BlockFormat::BC1:
+                        encodeBC1(block, out);
+                        break;
+                    case BlockFormat::BC3:
+                        encodeBC4(block.Channel[3], out);
+                        encodeBC1(block, out + 8);
+                        break;
+                    case BlockFormat::BC5:
+                        encodeBC4(block.Channel[0], out);
+                        encodeBC4(block.Channel[1], out + 8);
+                        break;
+                    case BlockFormat::BC7:
+                        encodeBC7(block, out);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            }
+        }, singleThread ? 1 : 0);
+        return blocks;
+    }
+
+    std::vector<u8> BlockCompressor::Decompress(u8 const* blocks, u32 width, u32 height, BlockFormat format)
+    {
+        const u32 blockBytes = GetBlockBytes(format);
+        const u32 blocksX = (width + 3) / 4;
+        const u32 blocksY = (height + 3) / 4;
+        std::vector<u8> rgba(size_t(width) * height * 4);
+        u8 decoded[4 * 4 * 4];
+        for (u32 by = 0; by < blocksY; ++by)
+        {
+            for (u32 bx = 0; bx < blocksX; ++bx)
+            {
+                u8 const* in = blocks + (size_t(by) * blocksX + bx) * blockBytes;
+                switch (format)
+                {
+                case BlockFormat::BC1:
+                    decodeBC1(in, decoded, 16);
+                    break;
+                case BlockFormat::BC3:
+                    decodeBC1(in + 8, decoded, 16);
+                    decodeBC4(in, decoded, 16, 3);
+                    break;
+                case BlockFormat::BC5:
+                    std::memset(decoded, 0, sizeof(decoded));
+                    decodeBC4(in, decoded, 16, 0);
+                    decodeBC4(in + 8, decoded, 16, 1);
+                    for (u32 i = 0; i < 16; ++i)
+                        decoded[i * 4 + 3] = 255;
+                    break;
+                case BlockFormat::BC7:
+                    decodeBC7(in, decoded, 16);
+                    break;
+                default:
+                    break;
+                }
+                for (u32 y = 0; y < 4 && by * 4 + y < height; ++y)
+                {
+                    u32 columns = width - bx * 4 < 4 ? width - bx * 4 : 4;
+                    std::memcpy(&rgba[(size_t(by * 4 + y) * width + bx * 4) * 4], &decoded[y * 16], columns * 4);
+                }
+            }
+        }
+        return rgba;
+    }
+
+    float BlockCompressor::ComputePSNR(u8 const* pixels, u8 channels, u8 const* decodedRGBA, u32 width, u32 height, u8 compareChannels)
+    {
+        double squaredError = 0.0;
+        size_t count = size_t(width) * height;
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (u8 c = 0; c < compareChannels; ++c)
+            {
+                double d = double(pixels[i * channels + c]) - double(decodedRGBA[i * 4 + c]);
+                squaredError += d * d;
+            }
+        }
+        double mse = squaredError / (double(count) * compareChannels);
+        return mse > 0.0 ? static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mse)) : 99.0f;
+    }
+
+    BlockCompressor::Benchmark BlockCompressor::Measure(u8 const* pixels, u32 width, u32 height, u8 channels, BlockFormat format)
+    {
+        Benchmark result;
+        result.Format = format;
+        result.Width = width;
+        result.Height = height;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<u8> blocks = Compress(pixels, width, height, channels, format);
+        result.Milliseconds = elapsedMilliseconds(start);
+        result.MegaPixelsPerSecond = float(width) * height / (result.Milliseconds * 1000.0f);
+
+        std::vector<u8> decoded = Decompress(blocks.data(), width, height, format);
+        u8 compared = format == BlockFormat::BC5 ? 2 : (format == BlockFormat::BC1 ? 3 : channels);
+        result.PSNR = ComputePSNR(pixels, channels, decoded.data(), width, height, compared < channels ? compared : channels);
+        return result;
+    }
+}
@@ -0,0 +1,246 @@
+#include "Precompiled.h"
+#include "framework/Application.h"
+#include "framework/Debug.h"
+#include "graphics/FrameCapture.h"
+#include "graphics/Texture.h"
+
+#include <iomanip>
+
+namespace
+{
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    bool isSignaled(GLsync fence)
+    {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+
+    void waitFor(GLsync fence)
+    {
+        //a second at a time, flushing first so the fence is sure to be reached
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        WarnIf(status == GL_WAIT_FAILED, "Waiting for a frame capture failed.");
+    }
+}
+
+namespace Graphics
+{
+    FrameCapture::FrameCapture(u32 bufferCount)
+        : m_slots(std::max(bufferCount, 1u)),
+        m_written(std::make_shared<std::atomic<u32> >(0)), m_failed(std::make_shared<std::atomic<u32> >(0))
+    {
+    }
+
+    FrameCapture::~FrameCapture()
+    {
+        Flush();
+        for (Slot& slot : m_slots)
+        {
+            if (slot.Buffer)
+                glDeleteBuffers(1, &slot.Buffer);
+        }
+    }
+
+    void FrameCapture::CaptureTexture(Texture const& texture, std::string const& path, ImageFormat format)
+    {
+        WarnIf(!texture.IsBuilt(), "Cannot capture unbuilt texture %s.", path.c_str());
+        if (!texture.IsBuilt())
+            return;
+        u8 channels = texture.GetBPP();
+        Slot& slot = acquireSlot(size_t(texture.GetWidth()) * texture.GetHeight() * channels);
+
+        //keep whatever texture the active unit has bound
+        GLint boundTexture = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+        glBindTexture(GL_TEXTURE_2D, texture.GetTextureHandle());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, texture.HasAlpha() ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, boundTexture);
+        submitSlot(slot, texture.GetWidth(), texture.GetHeight(), channels, path, format);
+    }
+
+    void FrameCapture::CaptureScreen(u32 width, u32 height, std::string const& path, ImageFormat format)
+    {
+        Slot& slot = acquireSlot(size_t(width) * height * 3);
+        GLint readFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, Application::GetInstance().GetScreenFramebuffer());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+        submitSlot(slot, width, height, 3, path, format);
+    }
+
+    AssetLoadHandle FrameCapture::WriteImage(std::vector<u8> pixels, u32 width, u32 height, u8 channels,
+                                             std::string const& path, ImageFormat format, bool bottomUp)
+    {
+        std::string file = path + "." + ImageEncoder::GetExtension(format, channels);
+        std::shared_ptr<std::atomic<u32> > written = m_written;
+        std::shared_ptr<std::atomic<u32> > failed = m_failed;
+        std::shared_ptr<std::vector<u8> > image = std::make_shared<std::vector<u8> >(std::move(pixels));
+        AssetLoadHandle handle = AssetLoader::GetShared().Submit(file, [=]()
+        {
+            if (ImageEncoder::WriteFile(file, image->data(), width, height, channels, format, bottomUp))
+                ++*written;
+            else
+                ++*failed;
+        }, nullptr, AssetPriority::Low);
+        m_writes.push_back(handle);
+        return handle;
+    }
+
+    void FrameCapture::StartSequence(std::string const& pathPrefix, ImageFormat format, u32 frameStep)
+    {
+        m_sequencePrefix = pathPrefix;
+        m_sequenceFormat = format;
+        m_sequenceStep = std::max(frameStep, 1u);
+        m_sequenceFrame = 0;
+        m_sequenceIndex = 0;
+    }
+
+    void FrameCapture::StopSequence()
+    {
+        m_sequenceStep = 0;
+    }
+
+    void FrameCapture::EndFrame(u32 width, u32 height)
+    {
+        if (IsCapturingSequence() && m_sequenceFrame++ % m_sequenceStep == 0)
+        {
+            std::stringstream path;
+            path << m_sequencePrefix << "_" << std::setw(5) << std::setfill('0') << m_sequenceIndex++;
+            CaptureScreen(width, height, path.str(), m_sequenceFormat);
+        }
+        Update();
+    }
+
+    void FrameCapture::Update()
+    {
+        for (Slot& slot : m_slots)
+        {
+            if (slot.Fence && isSignaled(slot.Fence))
+                readSlot(slot);
+        }
+        m_writes.erase(std::remove_if(m_writes.begin(), m_writes.end(),
+            [](AssetLoadHandle const& write) { return write.IsFinished(); }), m_writes.end());
+    }
+
+    void FrameCapture::Flush()
+    {
+        //oldest first, so the images are handed out in the order they were captured
+        std::vector<Slot*> inFlight;
+        for (Slot& slot : m_slots)
+        {
+            if (slot.Fence)
+                inFlight.push_back(&slot);
+        }
+        std::sort(inFlight.begin(), inFlight.end(), [](Slot const* a, Slot const* b) { return a->Sequence < b->Sequence; });
+        for (Slot* slot : inFlight)
+        {
+            waitFor(slot->Fence);
+            readSlot(*slot);
+        }
+        for (AssetLoadHandle const& write : m_writes)
+            write.Wait();
+        m_writes.clear();
+    }
+
+    u32 FrameCapture::GetPendingCount() const
+    {
+        u32 pending = 0;
+        for (Slot const& slot : m_slots)
+            pending += slot.Fence ? 1 : 0;
+        for (AssetLoadHandle const& write : m_writes)
+            pending += write.IsFinished() ? 0 : 1;
+        return pending;
+    }
+
+    FrameCapture::Stats FrameCapture::GetStats() const
+    {
+        Stats stats = m_stats;
+        stats.Written = m_written->load();
+        stats.Failed = m_failed->load();
+        return stats;
+    }
+
+    FrameCapture::Slot& FrameCapture::acquireSlot(size_t size)
+    {
+        Slot* available = nullptr;
+        Slot* oldest = nullptr;
+        for (Slot& slot : m_slots)
+        {
+            if (!slot.Fence && !available)
+                available = &slot;
+            if (slot.Fence && (!oldest || slot.Sequence < oldest->Sequence))
+                oldest = &slot;
+        }
+        if (!available)
+        {
+            //every buffer is in flight, the oldest is the first the GPU finishes
+            ++m_stats.Stalls;
+            waitFor(oldest->Fence);
+            readSlot(*oldest);
+            available = oldest;
+        }
+
+        if (!available->Buffer)
+            glGenBuffers(1, &available->Buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, available->Buffer);
+        if (available->Capacity < size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            available->Capacity = size;
+        }
+        return *available;
+    }
+
+    void FrameCapture::submitSlot(Slot& slot, u32 width, u32 height, u8 channels, std::string const& path, ImageFormat format)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.Width = width;
+        slot.Height = height;
+        slot.Channels = channels;
+        slot.Format = format;
+        slot.Path = path;
+        slot.Sequence = m_nextSequence++;
+        ++m_stats.Captures;
+    }
+
+    void FrameCapture::readSlot(Slot& slot)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t size = size_t(slot.Width) * slot.Height * slot.Channels;
+        std::vector<u8> pixels;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+        void const* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            //the buffer goes back into the ring right away, so the pixels are copied out
+            pixels.assign(static_cast<u8 const*>(mapped), static_cast<u8 const*>(mapped) + size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glDeleteSync(slot.Fence);
+        slot.Fence = nullptr;
+        m_stats.ReadbackMilliseconds += elapsedMilliseconds(start);
+
+        WarnIf(!mapped, "Could not map the frame capture of %s.", slot.Path.c_str());
+        if (!mapped)
+        {
+            ++*m_failed;
+            return;
+        }
+        //GL rows start at the bottom, they are flipped while encoding
+        WriteImage(std::move(pixels), slot.Width, slot.Height, slot.Channels, slot.Path, slot.Format, true);
+    }
+}
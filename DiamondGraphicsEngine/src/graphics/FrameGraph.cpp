@@ -0,0 +1,284 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/FrameGraph.h"
+#include "graphics/Framebuffer.h"
+#include "framework/FrameTimings.h"
+#include "framework/Profiler.h"
+
+namespace Graphics
+{
+    FrameGraph::Pass& FrameGraph::Pass::Read(FramebufferType type)
+    {
+        m_reads.push_back(type);
+        return *this;
+    }
+
+    FrameGraph::Pass& FrameGraph::Pass::Write(FramebufferType type, bool clear)
+    {
+        Assert(!m_hasTarget, "Pass \"%s\" can only render to one framebuffer.", m_name.c_str());
+        m_target = type;
+        m_hasTarget = true;
+        m_clearTarget = clear;
+        return *this;
+    }
+
+    void FrameGraph::DeclareResource(FramebufferType type, RenderTargetDesc const& desc)
+    {
+        Assert(type != FramebufferType::Screen, "Screen is not a pooled resource.");
+        m_resources[type] = desc;
+    }
+
+    FrameGraph::Pass& FrameGraph::AddPass(std::string const& name, std::function<void()> const& execute)
+    {
+        m_passes.emplace_back(name, execute);
+        return m_passes.back();
+    }
+
+    void FrameGraph::Reset()
+    {
+        m_passes.clear();
+        m_resources.clear();
+        m_schedule.clear();
+        m_culled.clear();
+        m_lifetimes.clear();
+    }
+
+    bool FrameGraph::Compile()
+    {
+        m_schedule.clear();
+        m_culled.clear();
+        m_lifetimes.clear();
+        const u32 passCount = static_cast<u32>(m_passes.size());
+
+        //who renders to what
+        std::unordered_map<FramebufferType, std::vector<u32>> writers;
+        for (u32 p = 0; p < passCount; ++p)
+        {
+            Pass const& pass = m_passes[p];
+            if (pass.m_hasTarget)
+            {
+                if (pass.m_target != FramebufferType::Screen && m_resources.find(pass.m_target) == m_resources.end())
+                {
+                    Warning("Pass \"%s\" writes undeclared framebuffer %s.", pass.m_name.c_str(), GetResourceName(pass.m_target));
+                    return false;
+                }
+                writers[pass.m_target].push_back(p);
+            }
+            for (FramebufferType read : pass.m_reads)
+            {
+                if (read == FramebufferType::Screen || m_resources.find(read) == m_resources.end())
+                {
+                    Warning("Pass \"%s\" reads undeclared framebuffer %s.", pass.m_name.c_str(), GetResourceName(read));
+                    return false;
+                }
+                if (pass.m_hasTarget && read == pass.m_target)
+                {
+                    Warning("Pass \"%s\" samples its own render target.", pass.m_name.c_str());
+                    return false;
+                }
+            }
+        }
+
+        //culling: only passes the screen (transitively) depends on survive
+        std::vector<bool> live(passCount, false);
+        std::vector<u32> open;
+        for (u32 p : writers[FramebufferType::Screen])
+        {
+            live[p] = true;
+            open.push_back(p);
+        }
+        while (!open.empty())
+        {
+            u32 p = open.back();
+            open.pop_back();
+            for (FramebufferType read : m_passes[p].m_reads)
+            {
+                for (u32 w : writers[read])
+                {
+                    if (!live[w])
+                    {
+                        live[w] = true;
+                        open.push_back(w);
+                    }
+                }
+            }
+        }
+
+        //topological order, ties broken by declaration order so the schedule
+        //stays as close as possible to how the passes were written
+        std::vector<u32> inDegree(passCount, 0);
+        std::vector<std::vector<u32>> dependents(passCount);
+        u32 liveCount = 0;
+        for (u32 p = 0; p < passCount; ++p)
+        {
+            if (!live[p])
+            {
+                m_culled.push_back(p);
+                continue;
+            }
+            ++liveCount;
+            for (FramebufferType read : m_passes[p].m_reads)
+            {
+                for (u32 w : writers[read])
+                {
+                    if (live[w] && w != p)
+                    {
+                        dependents[w].push_back(p);
+                        ++inDegree[p];
+                    }
+                }
+            }
+        }
+
+        std::vector<bool> scheduled(passCount, false);
+        std::vector<u32> order;
+        while (order.size() < liveCount)
+        {
+            u32 next = passCount;
+            for (u32 p = 0; p < passCount; ++p)
+            {
+                if (live[p] && !scheduled[p] && inDegree[p] == 0)
+                {
+                    next = p;
+                    break;
+                }
+            }
+            if (next == passCount)
+            {
+                Warning("Frame graph has a cycle, %d passes could not be scheduled.", static_cast<int>(liveCount - order.size()));
+                return false;
+            }
+            scheduled[next] = true;
+            order.push_back(next);
+            for (u32 d : dependents[next])
+                --inDegree[d];
+        }
+
+        //lifetimes, clears and barriers in one walk over the schedule
+        std::unordered_map<FramebufferType, RenderTargetRequest> lifetimes;
+        std::unordered_map<FramebufferType, bool> pendingWrite;
+        std::vector<FramebufferType> firstSeen;
+        auto touch = [&](FramebufferType type, u32 index)
+        {
+            auto find = lifetimes.find(type);
+            if (find == lifetimes.end())
+            {
+                RenderTargetRequest request;
+                request.Desc = m_resources[type];
+                request.FirstUse = index;
+                request.LastUse = index;
+                lifetimes.emplace(type, request);
+                firstSeen.push_back(type);
+                return true;
+            }
+            find->second.LastUse = index;
+            return false;
+        };
+
+        for (u32 i = 0; i < order.size(); ++i)
+        {
+            Pass const& pass = m_passes[order[i]];
+            ScheduledPass scheduledPass;
+            scheduledPass.PassIndex = order[i];
+            scheduledPass.Clear = false;
+
+            for (FramebufferType read : pass.m_reads)
+            {
+                if (touch(read, i))
+                    Warning("Pass \"%s\" reads %s before anything writes it.", pass.m_name.c_str(), GetResourceName(read));
+                if (pendingWrite[read])
+                {
+                    scheduledPass.Barriers.push_back(read);
+                    pendingWrite[read] = false;
+                }
+            }
+            if (pass.m_hasTarget)
+            {
+                bool firstWrite = (pass.m_target == FramebufferType::Screen) ? true : touch(pass.m_target, i);
+                //a framebuffer only needs clearing before the first pass rendering to it
+                scheduledPass.Clear = pass.m_clearTarget && firstWrite;
+                pendingWrite[pass.m_target] = true;
+            }
+            m_schedule.push_back(scheduledPass);
+        }
+
+        for (FramebufferType type : firstSeen)
+            m_lifetimes.emplace_back(type, lifetimes[type]);
+        return true;
+    }
+
+    void FrameGraph::Execute(FramebufferManager& framebufferManager) const
+    {
+        //GL orders rendering into a texture before sampling it on its own once
+        //the framebuffer is switched, so barriers need no call here; they are
+        //kept in the schedule to document the dependency.
+        Framebuffer const* bound = nullptr;
+        bool anyBound = false;
+        for (ScheduledPass const& scheduledPass : m_schedule)
+        {
+            Pass const& pass = m_passes[scheduledPass.PassIndex];
+            ScopedFrameTiming timing("pass", pass.m_name.c_str());
+            PROFILE_SCOPE(pass.m_profileName);
+            PROFILE_GPU_SCOPE(pass.m_profileName);
+            if (pass.m_hasTarget)
+            {
+                Framebuffer const* target = framebufferManager.GetFramebuffer(pass.m_target).get();
+                if (!anyBound || target != bound)
+                {
+                    framebufferManager.Bind(pass.m_target);
+                    bound = target;
+                    anyBound = true;
+                }
+                if (scheduledPass.Clear)
+                    framebufferManager.Clear(pass.m_target);
+            }
+            pass.m_execute();
+        }
+    }
+
+    void FrameGraph::PrintSchedule(std::ostream& os) const
+    {
+        os << "Frame graph: " << m_schedule.size() << " passes scheduled, " << m_culled.size() << " culled.\n";
+        for (u32 i = 0; i < m_schedule.size(); ++i)
+        {
+            ScheduledPass const& scheduledPass = m_schedule[i];
+            Pass const& pass = m_passes[scheduledPass.PassIndex];
+            os << "  " << i << ": " << pass.m_name;
+            if (!scheduledPass.Barriers.empty())
+            {
+                os << " | barrier";
+                for (FramebufferType type : scheduledPass.Barriers)
+                    os << " " << GetResourceName(type);
+            }
+            if (!pass.m_reads.empty())
+            {
+                os << " | read";
+                for (FramebufferType type : pass.m_reads)
+                    os << " " << GetResourceName(type);
+            }
+            if (pass.m_hasTarget)
+                os << " | " << (scheduledPass.Clear ? "clear+write " : "write ") << GetResourceName(pass.m_target);
+            os << "\n";
+        }
+        for (u32 p : m_culled)
+            os << "  culled: " << m_passes[p].m_name << "\n";
+        for (auto const& i : m_lifetimes)
+            os << "  " << GetResourceName(i.first) << " lives [" << i.second.FirstUse << ", " << i.second.LastUse << "]\n";
+    }
+
+    char const* FrameGraph::GetResourceName(FramebufferType type)
+    {
+        switch (type)
+        {
+        case FramebufferType::Screen:          return "Screen";
+        case FramebufferType::DeferredGBuffer: return "DeferredGBuffer";
+        case FramebufferType::SSAO:            return "SSAO";
+        case FramebufferType::GenShadowMap:    return "GenShadowMap";
+        case FramebufferType::ShadowBlurH:     return "ShadowBlurH";
+        case FramebufferType::ShadowBlurV:     return "ShadowBlurV";
+        case FramebufferType::SSAOBlurH:       return "SSAOBlurH";
+        case FramebufferType::SSAOBlurV:       return "SSAOBlurV";
+        default:                               return "Unknown";
+        }
+    }
+}
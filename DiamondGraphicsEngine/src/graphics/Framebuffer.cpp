@@ -1,4 +1,5 @@
 #include "Precompiled.h"
+#include "framework/Application.h"
 #include "framework/Debug.h"
 #include "graphics/Color.h"
 #include "graphics/Framebuffer.h"
@@ -33,11 +34,7 @@ namespace Graphics
             int counter = 0;
             for (auto & i : m_colorTexture)
             {
-                size_t textureDataSize = sizeof(u8) * m_width * m_height * 4;
-                u8* data = new u8[textureDataSize];
-                std::memset(data, 0, textureDataSize);
-                i = std::make_shared<Texture>(data, m_width, m_height, Texture::Format::RGBA);
-                i->Build();
+                i = createAttachmentTexture();
 
                 // create a new texture
                 glGenTextures(1, &(*i).m_textureHandle);
@@ -59,18 +56,8 @@ namespace Graphics
                 i->m_isBuilt = true;
                 ++counter;
             }
-            
-            {//generate depth buffer
-                glGenTextures(1, &m_depthTextureHandle);
-                glBindTexture(GL_TEXTURE_2D, m_depthTextureHandle);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, m_width, m_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-                glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTextureHandle, 0);
-            }
+            buildGBufferDepth();
 
             for (u8 i = 0; i < static_cast<u8>(GBufferAttachmentType::Count); i++)
             {
@@ -86,6 +73,48 @@ namespace Graphics
             glDrawBuffers(4, DrawBuffers); // size of DrawBuffers
 
         }
+        else if (usage == FBO_USAGE_COMPACT_GBUFFER)
+        {
+            //Same attachment slots as the regular G-buffer so GBufferAttachmentType
+            //still indexes them. Position is rebuilt from depth, so slot 1 stays
+            //empty, and no CPU pixel storage is allocated up front; the textures
+            //only get a CPU copy if DownloadContents is called on them.
+            const u8 attachmentCount = static_cast<u8>(GBufferAttachmentType::Count);
+            const GLenum internalFormats[attachmentCount] = { GL_RGBA8, GL_NONE, GL_RG16, GL_RGBA8 };
+            const GLenum pixelFormats[attachmentCount]    = { GL_RGBA,  GL_NONE, GL_RG,   GL_RGBA  };
+            const GLenum pixelTypes[attachmentCount]      = { GL_UNSIGNED_BYTE, GL_NONE, GL_UNSIGNED_SHORT, GL_UNSIGNED_BYTE };
+            GLenum DrawBuffers[attachmentCount];
+
+            for (u8 i = 0; i < attachmentCount; ++i)
+            {
+                if (internalFormats[i] == GL_NONE)
+                {
+                    m_colorTexture[i] = nullptr;
+                    DrawBuffers[i] = GL_NONE;
+                    continue;
+                }
+
+                std::shared_ptr<Texture> texture = createAttachmentTexture();
+
+                //octahedral normals must not be filtered across the fold
+                GLint filter = (i == static_cast<u8>(GBufferAttachmentType::WorldNormal_ReceiveLight)) ? GL_NEAREST : GL_LINEAR;
+                glGenTextures(1, &texture->m_textureHandle);
+                glBindTexture(GL_TEXTURE_2D, texture->m_textureHandle);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], m_width, m_height, 0, pixelFormats[i], pixelTypes[i], nullptr);
+                texture->m_isBuilt = true;
+
+                glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, texture->m_textureHandle, 0);
+                DrawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+                m_colorTexture[i] = texture;
+            }
+
+            buildGBufferDepth();
+            glDrawBuffers(attachmentCount, DrawBuffers);
+        }
         else if (usage == FBO_USAGE_FLOAT_BUFFER)//float buffer
         {
             glGenTextures(1, &m_depthTextureHandle);
@@ -141,6 +170,30 @@ namespace Graphics
     }
 
 
+    std::shared_ptr<Texture> Framebuffer::createAttachmentTexture() const
+    {
+        //no CPU side pixels, DownloadContents allocates them if ever needed
+        std::shared_ptr<Texture> texture(new Texture());
+        texture->m_width = m_width;
+        texture->m_height = m_height;
+        texture->m_format = Texture::Format::RGBA;
+        texture->m_bpp = 4;
+        return texture;
+    }
+
+    void Framebuffer::buildGBufferDepth()
+    {
+        glGenTextures(1, &m_depthTextureHandle);
+        glBindTexture(GL_TEXTURE_2D, m_depthTextureHandle);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, m_width, m_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTextureHandle, 0);
+    }
+
     void Framebuffer::Bind()
     {
         glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
@@ -167,7 +220,7 @@ namespace Graphics
 
     void Framebuffer::Unbind()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0); // bind screen framebuffer
+        glBindFramebuffer(GL_FRAMEBUFFER, Application::GetInstance().GetScreenFramebuffer()); // bind screen framebuffer
     }
 
     void Framebuffer::Destroy()
@@ -193,7 +246,7 @@ namespace Graphics
     Framebuffer* Framebuffer::BindGBufferTextures(const std::shared_ptr<ShaderProgram>& shaderProgram) 
     {
         Assert(m_colorTexture[0]->GetTextureHandle() != 0, "Invalid FBO Binding");
-        Assert(m_colorTexture[1]->GetTextureHandle() != 0, "Invalid FBO Binding");
+        Assert(IsCompactGBuffer() || m_colorTexture[1]->GetTextureHandle() != 0, "Invalid FBO Binding");
         Assert(m_colorTexture[2]->GetTextureHandle() != 0, "Invalid FBO Binding");
         Assert(m_colorTexture[3]->GetTextureHandle() != 0, "Invalid FBO Binding");
 
@@ -201,9 +254,12 @@ namespace Graphics
         glBindTexture(GL_TEXTURE_2D, m_colorTexture[0]->GetTextureHandle());
         shaderProgram->SetUniform("DiffuseColor_Empty_Texture", static_cast<u8>(GBufferAttachmentType::DiffuseColor_TexU));
 
-        glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
-        glBindTexture(GL_TEXTURE_2D, m_colorTexture[1]->GetTextureHandle());
-        shaderProgram->SetUniform("WorldPosition_SpecPow_Texture", static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+        if (!IsCompactGBuffer())//compact G-buffer rebuilds position from depth
+        {
+            glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+            glBindTexture(GL_TEXTURE_2D, m_colorTexture[1]->GetTextureHandle());
+            shaderProgram->SetUniform("WorldPosition_SpecPow_Texture", static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+        }
 
         glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldNormal_ReceiveLight));
         glBindTexture(GL_TEXTURE_2D, m_colorTexture[2]->GetTextureHandle());
@@ -218,10 +274,13 @@ namespace Graphics
 
     Framebuffer* Framebuffer::BindGBufferPositionNormal(const std::shared_ptr<ShaderProgram>& shaderProgram)
     {
-        Assert(m_colorTexture[1]->GetTextureHandle() != 0, "Invalid FBO Binding");
-        glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
-        glBindTexture(GL_TEXTURE_2D, m_colorTexture[1]->GetTextureHandle());
-        shaderProgram->SetUniform("WorldPosition_TexV_Texture", static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+        if (!IsCompactGBuffer())//compact G-buffer rebuilds position from depth
+        {
+            Assert(m_colorTexture[1]->GetTextureHandle() != 0, "Invalid FBO Binding");
+            glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+            glBindTexture(GL_TEXTURE_2D, m_colorTexture[1]->GetTextureHandle());
+            shaderProgram->SetUniform("WorldPosition_TexV_Texture", static_cast<u8>(GBufferAttachmentType::WorldPosition_TexV));
+        }
 
         Assert(m_colorTexture[2]->GetTextureHandle() != 0, "Invalid FBO Binding");
         glActiveTexture(GL_TEXTURE0 + static_cast<u8>(GBufferAttachmentType::WorldNormal_ReceiveLight));
@@ -1,5 +1,6 @@
 #include "Precompiled.h"
 #include "framework/Application.h"
+#include "framework/Debug.h"
 #include "graphics/Framebuffer.h"
 #include "graphics/FramebufferManager.h"
 
@@ -53,14 +54,16 @@ namespace Graphics
   void FramebufferManager::ClearFramebuffers()
   {
     m_framebuffers.clear();
+    m_transientTargets.clear();
   }
 
   void FramebufferManager::Bind(FramebufferType type) const
   {
     if (type == FramebufferType::Screen)
     {
-      // binding 0 framebuffer unbinds previous, thereby binding the screen
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      // binding 0 framebuffer unbinds previous, thereby binding the screen;
+      // headless, the screen is the application's offscreen framebuffer
+      glBindFramebuffer(GL_FRAMEBUFFER, m_application->GetScreenFramebuffer());
       glViewport(0, 0, m_application->GetWindowWidth(),
         m_application->GetWindowHeight());
     }
@@ -101,4 +104,89 @@ namespace Graphics
         framebuffer->Clear();
     }
   }
+
+  void FramebufferManager::RegisterTransientFramebuffer(FramebufferType type,
+    RenderTargetDesc const& desc, u32 firstUse, u32 lastUse)
+  {
+    Assert(type != FramebufferType::Screen, "Screen cannot be a transient framebuffer.");
+    RenderTargetRequest request;
+    request.Desc = desc;
+    request.FirstUse = firstUse;
+    request.LastUse = lastUse;
+    for (auto& i : m_transientRequests)
+    {
+      if (i.first == type)
+      {
+        i.second = request; // replace declaration
+        return;
+      }
+    }
+    m_transientRequests.emplace_back(type, request);
+  }
+
+  void FramebufferManager::ResetTransientFramebuffers()
+  {
+    for (auto const& i : m_transientRequests)
+      m_framebuffers.erase(i.first);
+    m_transientRequests.clear();
+  }
+
+  void FramebufferManager::BuildTransientFramebuffers()
+  {
+    m_transientWidth = m_application->GetWindowWidth();
+    m_transientHeight = m_application->GetWindowHeight();
+
+    std::vector<RenderTargetRequest> requests;
+    requests.reserve(m_transientRequests.size());
+    for (auto const& i : m_transientRequests)
+      requests.push_back(i.second);
+    m_transientPlan = RenderTargetPlanner::Plan(requests, m_transientWidth, m_transientHeight);
+
+    // reuse what we already have where the format still matches, only
+    // resizing or rebuilding the framebuffers that actually changed
+    std::vector<std::shared_ptr<Framebuffer>> targets(m_transientPlan.Targets.size());
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+      RenderTargetPlan::Target const& target = m_transientPlan.Targets[i];
+      std::shared_ptr<Framebuffer> fb = (i < m_transientTargets.size()) ? m_transientTargets[i] : nullptr;
+      if (fb && fb->GetUsage() == target.Usage)
+      {
+        if (fb->GetWidth() != target.Width || fb->GetHeight() != target.Height)
+          fb->Resize(target.Width, target.Height, false);
+      }
+      else
+      {
+        fb = std::make_shared<Framebuffer>(target.Width, target.Height);
+        fb->Build(target.Usage);
+      }
+      targets[i] = fb;
+    }
+    m_transientTargets = std::move(targets);
+
+    for (size_t i = 0; i < m_transientRequests.size(); ++i)
+      m_framebuffers[m_transientRequests[i].first] =
+        m_transientTargets[m_transientPlan.TargetOfRequest[i]];
+
+#if VERBOSE
+    RenderTargetPlanner::PrintPlan(m_transientPlan, std::cout);
+#endif // VERBOSE
+  }
+
+  void FramebufferManager::RequestResize(u32 width, u32 height)
+  {
+    m_pendingWidth = width;
+    m_pendingHeight = height;
+    m_framesSinceResize = 0;
+    m_resizePending = true;
+  }
+
+  void FramebufferManager::BeginFrame()
+  {
+    if (!m_resizePending || ++m_framesSinceResize < ResizeSettleFrames)
+      return;
+    m_resizePending = false;
+    if (m_pendingWidth == m_transientWidth && m_pendingHeight == m_transientHeight)
+      return; // resized back to where we started
+    BuildTransientFramebuffers();
+  }
 }
@@ -0,0 +1,261 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/FrustumCuller.h"
+#include "math/Reals.h"
+
+#include <cfloat>
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+#if defined(__AVX__)
+    const u32 c_simdWidth = 8;
+#else
+    const u32 c_simdWidth = 4;
+#endif
+    //radius of a padding/unregistered slot, fails every plane
+    const float c_neverVisible = -FLT_MAX;
+    //radius of an object without bounds, passes every plane
+    const float c_alwaysVisible = FLT_MAX;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+namespace Graphics
+{
+    Frustum::Frustum(Math::Matrix4 const& viewProj)
+    {
+        //Gribb/Hartmann: a clip space point is inside when -w <= x,y,z <= w,
+        //every inequality is a plane built from the rows of viewProj
+        const Math::Vector4 row0(viewProj.m[0][0], viewProj.m[0][1], viewProj.m[0][2], viewProj.m[0][3]);
+        const Math::Vector4 row1(viewProj.m[1][0], viewProj.m[1][1], viewProj.m[1][2], viewProj.m[1][3]);
+        const Math::Vector4 row2(viewProj.m[2][0], viewProj.m[2][1], viewProj.m[2][2], viewProj.m[2][3]);
+        const Math::Vector4 row3(viewProj.m[3][0], viewProj.m[3][1], viewProj.m[3][2], viewProj.m[3][3]);
+        Planes[0] = row3 + row0;
+        Planes[1] = row3 - row0;
+        Planes[2] = row3 + row1;
+        Planes[3] = row3 - row1;
+        Planes[4] = row3 + row2;
+        Planes[5] = row3 - row2;
+
+        //normalize so plane distances are in world units and can be compared to radii
+        for (Math::Vector4& plane : Planes)
+        {
+            float length = Math::Sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if (length > 0.0f)
+                plane /= length;
+        }
+    }
+
+    bool Frustum::IntersectsSphere(Math::Vector3 const& center, float radius) const
+    {
+        for (Math::Vector4 const& plane : Planes)
+        {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w + radius < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    void FrustumCuller::SetSphere(ObjectId id, BoundingSphere const& worldSphere)
+    {
+        reserve(id);
+        m_centerX[id] = worldSphere.center.x;
+        m_centerY[id] = worldSphere.center.y;
+        m_centerZ[id] = worldSphere.center.z;
+        m_radius[id] = worldSphere.radius;
+    }
+
+    void FrustumCuller::SetAlwaysVisible(ObjectId id)
+    {
+        reserve(id);
+        m_centerX[id] = 0.0f;
+        m_centerY[id] = 0.0f;
+        m_centerZ[id] = 0.0f;
+        m_radius[id] = c_alwaysVisible;
+    }
+
+    BoundingSphere FrustumCuller::GetSphere(ObjectId id) const
+    {
+        Assert(id >= 0 && static_cast<u32>(id) < m_count, "Object has no bounding sphere.");
+        return BoundingSphere(Math::Vector3(m_centerX[id], m_centerY[id], m_centerZ[id]), m_radius[id]);
+    }
+
+    bool FrustumCuller::IsAlwaysVisible(ObjectId id) const
+    {
+        return id >= 0 && static_cast<u32>(id) < m_count && m_radius[id] == c_alwaysVisible;
+    }
+
+    void FrustumCuller::Clear()
+    {
+        m_centerX.clear();
+        m_centerY.clear();
+        m_centerZ.clear();
+        m_radius.clear();
+        m_count = 0;
+    }
+
+    CullStats FrustumCuller::Cull(Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        visible.clear();
+        visibleMask.assign(m_count, 0);
+
+#if defined(__AVX__)
+        __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (u32 p = 0; p < 6; ++p)
+        {
+            planeX[p] = _mm256_set1_ps(frustum.Planes[p].x);
+            planeY[p] = _mm256_set1_ps(frustum.Planes[p].y);
+            planeZ[p] = _mm256_set1_ps(frustum.Planes[p].z);
+            planeW[p] = _mm256_set1_ps(frustum.Planes[p].w);
+        }
+        const __m256 zero = _mm256_setzero_ps();
+        for (u32 i = 0; i < m_count; i += c_simdWidth)
+        {
+            const __m256 cx = _mm256_loadu_ps(&m_centerX[i]);
+            const __m256 cy = _mm256_loadu_ps(&m_centerY[i]);
+            const __m256 cz = _mm256_loadu_ps(&m_centerZ[i]);
+            const __m256 r = _mm256_loadu_ps(&m_radius[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (u32 p = 0; p < 6; ++p)
+            {
+                __m256 dist = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(planeZ[p], cz));
+                dist = _mm256_add_ps(dist, _mm256_add_ps(planeW[p], r));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+            }
+            int bits = _mm256_movemask_ps(inside);
+#else
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (u32 p = 0; p < 6; ++p)
+        {
+            planeX[p] = _mm_set1_ps(frustum.Planes[p].x);
+            planeY[p] = _mm_set1_ps(frustum.Planes[p].y);
+            planeZ[p] = _mm_set1_ps(frustum.Planes[p].z);
+            planeW[p] = _mm_set1_ps(frustum.Planes[p].w);
+        }
+        const __m128 zero = _mm_setzero_ps();
+        for (u32 i = 0; i < m_count; i += c_simdWidth)
+        {
+            const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+            const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+            const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+            const __m128 r = _mm_loadu_ps(&m_radius[i]);
+            __m128 inside = _mm_cmpge_ps(r, r);//all ones, the radius is never NaN
+            for (u32 p = 0; p < 6; ++p)
+            {
+                __m128 dist = _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy));
+                dist = _mm_add_ps(dist, _mm_mul_ps(planeZ[p], cz));
+                dist = _mm_add_ps(dist, _mm_add_ps(planeW[p], r));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+            }
+            int bits = _mm_movemask_ps(inside);
+#endif
+            //padding lanes past m_count always fail, so no bound check is needed on bits
+            while (bits)
+            {
+                u32 lane = 0;
+                while (!(bits & (1 << lane)))
+                    ++lane;
+                bits &= ~(1 << lane);
+                visibleMask[i + lane] = 1;
+                visible.push_back(static_cast<ObjectId>(i + lane));
+            }
+        }
+
+        CullStats stats;
+        stats.Tested = m_count;
+        stats.Visible = static_cast<u32>(visible.size());
+        stats.Culled = stats.Tested - stats.Visible;
+        stats.Milliseconds = elapsedMilliseconds(start);
+        return stats;
+    }
+
+    CullStats FrustumCuller::CullScalar(Frustum const& frustum, std::vector<ObjectId>& visible, std::vector<u8>& visibleMask) const
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        visible.clear();
+        visibleMask.assign(m_count, 0);
+        for (u32 i = 0; i < m_count; ++i)
+        {
+            if (frustum.IntersectsSphere(Math::Vector3(m_centerX[i], m_centerY[i], m_centerZ[i]), m_radius[i]))
+            {
+                visibleMask[i] = 1;
+                visible.push_back(static_cast<ObjectId>(i));
+            }
+        }
+
+        CullStats stats;
+        stats.Tested = m_count;
+        stats.Visible = static_cast<u32>(visible.size());
+        stats.Culled = stats.Tested - stats.Visible;
+        stats.Milliseconds = elapsedMilliseconds(start);
+        return stats;
+    }
+
+    FrustumCuller::Benchmark FrustumCuller::MeasureCullTime(Math::Matrix4 const& viewProj, u32 objectCount)
+    {
+        //scatter spheres over twice the screen extent, evenly in depth between
+        //the near and the far plane, so a good part of them is outside
+        Math::Matrix4 inverseViewProj = viewProj.Inverted();
+        auto unproject = [&inverseViewProj](float x, float y, float z)
+        {
+            Math::Vector4 world = Math::Transform(inverseViewProj, Math::Vector4(x, y, z, 1.0f));
+            return Math::Vector3(world.x, world.y, world.z) / world.w;
+        };
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> ndc(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+        std::uniform_real_distribution<float> radius(0.1f, 1.0f);
+        FrustumCuller culler;
+        for (u32 i = 0; i < objectCount; ++i)
+        {
+            float x = ndc(random);
+            float y = ndc(random);
+            Math::Vector3 nearPoint = unproject(x, y, -1.0f);
+            Math::Vector3 farPoint = unproject(x, y, 1.0f);
+            culler.SetSphere(i, BoundingSphere(nearPoint + (farPoint - nearPoint) * depth(random), radius(random)));
+        }
+
+        const Frustum frustum(viewProj);
+        std::vector<ObjectId> scalarVisible, simdVisible;
+        std::vector<u8> visibleMask;
+        Benchmark result;
+        result.ObjectCount = objectCount;
+        result.ScalarMilliseconds = FLT_MAX;
+        result.SimdMilliseconds = FLT_MAX;
+        //best of a few runs, the first one also warms up the caches
+        for (u32 run = 0; run < 5; ++run)
+        {
+            CullStats scalar = culler.CullScalar(frustum, scalarVisible, visibleMask);
+            CullStats simd = culler.Cull(frustum, simdVisible, visibleMask);
+            result.ResultsMatch = result.ResultsMatch && scalarVisible == simdVisible;
+            result.ScalarMilliseconds = Math::Min(result.ScalarMilliseconds, scalar.Milliseconds);
+            result.SimdMilliseconds = Math::Min(result.SimdMilliseconds, simd.Milliseconds);
+            result.Visible = simd.Visible;
+        }
+        return result;
+    }
+
+    void FrustumCuller::reserve(ObjectId id)
+    {
+        Assert(id >= 0, "Invalid object id.");
+        u32 count = static_cast<u32>(id) + 1;
+        if (count <= m_count)
+            return;
+        m_count = count;
+        u32 padded = (count + c_simdWidth - 1) / c_simdWidth * c_simdWidth;
+        m_centerX.resize(padded, 0.0f);
+        m_centerY.resize(padded, 0.0f);
+        m_centerZ.resize(padded, 0.0f);
+        m_radius.resize(padded, c_neverVisible);
+    }
+}
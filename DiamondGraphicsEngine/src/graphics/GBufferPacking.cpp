@@ -0,0 +1,171 @@
+#include "Precompiled.h"
+#include "graphics/GBufferPacking.h"
+#include "math/Reals.h"
+#include "math/Vector4.h"
+
+#include <cfloat>
+#include <cmath>
+
+namespace Graphics
+{
+    namespace
+    {
+        //the float math of the rebuild itself: the divide by w near the far plane
+        //costs about this many ulps of depth, the rest this many ulps of the position
+        const double c_RebuildDepthUlps = 4.0;
+        const double c_RebuildPositionUlps = 16.0;
+
+        //gap between depth values the storage can hold around stored
+        double depthStep(float stored, GBufferPacking::DepthStorage storage)
+        {
+            if (storage == GBufferPacking::DepthStorage::Unorm24)
+                return 1.0 / static_cast<double>((1u << 24) - 1u);
+            return static_cast<double>(std::nextafter(stored, 2.0f)) - stored;
+        }
+    }
+
+    namespace GBufferPacking
+    {
+        Math::Vector2 EncodeOctahedral(Math::Vector3 const& normal)
+        {
+            float l1 = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+            if (l1 <= 0.0f)
+                return Math::Vector2(0.5f, 0.5f);
+
+            //project onto the octahedron, then fold the lower half over the diagonals
+            float x = normal.x / l1;
+            float y = normal.y / l1;
+            if (normal.z < 0.0f)
+            {
+                float foldedX = (1.0f - Math::Abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float foldedY = (1.0f - Math::Abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = foldedX;
+                y = foldedY;
+            }
+            return Math::Vector2(x * 0.5f + 0.5f, y * 0.5f + 0.5f);
+        }
+
+        Math::Vector3 DecodeOctahedral(Math::Vector2 const& encoded)
+        {
+            float x = encoded.x * 2.0f - 1.0f;
+            float y = encoded.y * 2.0f - 1.0f;
+            float z = 1.0f - Math::Abs(x) - Math::Abs(y);
+            float t = Math::Clamp(-z, 0.0f, 1.0f);
+            x += x >= 0.0f ? -t : t;
+            y += y >= 0.0f ? -t : t;
+            return Math::Vector3(x, y, z).Normalized();
+        }
+
+        float EncodeSpecularPower(float specularPower)
+        {
+            return Math::Clamp(std::log2(Math::Max(specularPower, 1.0f)) / SpecularPowerLog2Max, 0.0f, 1.0f);
+        }
+
+        float DecodeSpecularPower(float encoded)
+        {
+            return std::exp2(encoded * SpecularPowerLog2Max);
+        }
+
+        float QuantizeUnorm(float value, u32 bits)
+        {
+            float maxValue = static_cast<float>((1u << bits) - 1u);
+            return std::round(Math::Clamp(value, 0.0f, 1.0f) * maxValue) / maxValue;
+        }
+
+        float QuantizeDepth(double depth, DepthStorage storage)
+        {
+            depth = depth < 0.0 ? 0.0 : (depth > 1.0 ? 1.0 : depth);
+            if (storage == DepthStorage::Unorm24)
+            {
+                double maxValue = static_cast<double>((1u << 24) - 1u);
+                return static_cast<float>(std::round(depth * maxValue) / maxValue);
+            }
+            return static_cast<float>(depth);
+        }
+
+        Math::Vector3 ReconstructWorldPosition(Math::Matrix4 const& inverseViewProj,
+                                               Math::Vector2 const& uv, float depth)
+        {
+            Math::Vector4 ndc(uv.x * 2.0f - 1.0f, uv.y * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+            Math::Vector4 world = Math::Transform(inverseViewProj, ndc);
+            return Math::Vector3(world.x, world.y, world.z) / world.w;
+        }
+
+        PrecisionReport MeasurePrecision(Math::Matrix4 const& viewProj, float nearPlane, float farPlane,
+                                         DepthStorage depthStorage, u32 samplesPerAxis)
+        {
+            PrecisionReport report;
+            float step = 1.0f / static_cast<float>(samplesPerAxis);
+
+            //normals, swept over the whole sphere
+            for (u32 i = 0; i <= samplesPerAxis; ++i)
+            {
+                float theta = Math::c_Pi * i * step;
+                for (u32 j = 0; j < samplesPerAxis; ++j)
+                {
+                    float phi = Math::c_TwoPi * j * step;
+                    Math::Vector3 n(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+                    Math::Vector2 e = EncodeOctahedral(n);
+                    e.x = QuantizeUnorm(e.x, 16);
+                    e.y = QuantizeUnorm(e.y, 16);
+                    float cosAngle = Math::Clamp(Math::Dot(n, DecodeOctahedral(e)), -1.0f, 1.0f);
+                    report.MaxNormalErrorDegrees = Math::Max(report.MaxNormalErrorDegrees, Math::RadToDeg(std::acos(cosAngle)));
+                }
+            }
+
+            //spec power over the representable range
+            for (float p = 1.0f; p <= 2048.0f; p *= 1.0f + step)
+            {
+                float decoded = DecodeSpecularPower(QuantizeUnorm(EncodeSpecularPower(p), 8));
+                report.MaxSpecularPowerRelativeError = Math::Max(report.MaxSpecularPowerRelativeError, Math::Abs(decoded - p) / p);
+            }
+
+            //position: points along the pixel rays from near to far, stored the way
+            //the depth attachment stores them and rebuilt
+            Math::Matrix4 inverseViewProj = viewProj.Inverted();
+            double n = nearPlane;
+            double f = farPlane;
+            Math::Vector3 axis = (ReconstructWorldPosition(inverseViewProj, Math::Vector2(0.5f, 0.5f), 1.0f)
+                                  - ReconstructWorldPosition(inverseViewProj, Math::Vector2(0.5f, 0.5f), 0.0f)).Normalized();
+            for (u32 i = 0; i < samplesPerAxis; ++i)
+            {
+                for (u32 j = 0; j < samplesPerAxis; ++j)
+                {
+                    Math::Vector2 uv((i + 0.5f) * step, (j + 0.5f) * step);
+                    Math::Vector3 ray = (ReconstructWorldPosition(inverseViewProj, uv, 1.0f)
+                                         - ReconstructWorldPosition(inverseViewProj, uv, 0.0f)).Normalized();
+                    double cosAngle = Math::Dot(ray, axis);
+                    for (u32 k = 0; k <= samplesPerAxis; ++k)
+                    {
+                        //geometric in view depth, so every distance band gets samples
+                        double z = n * std::pow(f / n, k * static_cast<double>(step));
+                        float depth = static_cast<float>(f / (f - n) * (1.0 - n / z));
+                        Math::Vector3 world = ReconstructWorldPosition(inverseViewProj, uv, depth);
+
+                        //the depth the rasterizer computes for the point, before it is stored
+                        double clipZ = 0.0;
+                        double clipW = 0.0;
+                        for (unsigned c = 0; c < 4; ++c)
+                        {
+                            double coordinate = c < 3 ? static_cast<double>(world[c]) : 1.0;
+                            clipZ += viewProj(2, c) * coordinate;
+                            clipW += viewProj(3, c) * coordinate;
+                        }
+                        float stored = QuantizeDepth(clipZ / clipW * 0.5 + 0.5, depthStorage);
+                        Math::Vector3 rebuilt = ReconstructWorldPosition(inverseViewProj, uv, stored);
+
+                        //half a storage step plus the rebuild's own depth ulps, through the divide
+                        double ulp = static_cast<double>(std::nextafter(stored, 2.0f)) - stored;
+                        double depthError = 0.5 * depthStep(stored, depthStorage) + c_RebuildDepthUlps * ulp;
+                        double bound = depthError * (f - n) * clipW * clipW / (f * n) / cosAngle
+                                       + c_RebuildPositionUlps * FLT_EPSILON * Math::Length(world);
+                        float error = Math::Length(rebuilt - world);
+                        report.MaxPositionError = Math::Max(report.MaxPositionError, error);
+                        report.MaxPositionErrorRatio = Math::Max(report.MaxPositionErrorRatio, static_cast<float>(error / bound));
+                    }
+                }
+            }
+            return report;
+        }
+    }
+}
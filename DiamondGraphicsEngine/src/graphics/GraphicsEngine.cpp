@@ -10,8 +10,15 @@
 #include "graphics/MaterialManager.h"
 #include "graphics/MeshManager.h"
 #include "graphics/FramebufferManager.h"
+#include "graphics/FrameCapture.h"
 #include "framework/Application.h"
+#include "framework/FrameTimings.h"
+#include "framework/Profiler.h"
 #include "graphics/Framebuffer.h"
+#include "graphics/RenderDevice.h"
+#include "graphics/TriangleMesh.h"
+#include "core/components/Renderer.h"
+#include "core/components/Transform.h"
 
 namespace Graphics
 {
@@ -27,16 +34,31 @@ namespace Graphics
         m_materialManager = std::make_shared<MaterialManager>();
         m_meshManager = std::make_shared<MeshManager>();
         m_frameBufferManager = std::make_shared<FramebufferManager>(&Application::GetInstance());
+        m_frameCapture = std::make_shared<FrameCapture>();
 
         SetBackgroundColor(Color(0.1f,0.1f,0.1f));
         EnableDepthTest();
         glCullFace(GL_BACK);
     }
 
+    void GraphicsEngine::RegisterDeferredFramebuffers(FBO_USAGE gbufferUsage)
+    {
+        m_gbufferUsage = gbufferUsage;
+        buildDeferredGraph();
+    }
+
     void GraphicsEngine::RenderScene(Scene* scene)
     {
+        ScopedFrameTiming timing("subsystem", "Render");
+        m_frameBufferManager->BeginFrame();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        m_materialManager->UpdateMaterialTable(*m_textureManager);
         renderScene(scene);
+        //objects asked for texture levels while drawing
+        m_textureManager->UpdateStreaming();
+        //the frame is finished, capture it and pick up earlier captures the GPU is done with
+        m_frameCapture->EndFrame(Application::GetInstance().GetWindowWidth(), Application::GetInstance().GetWindowHeight());
+        PROFILE_END_FRAME();
     }
 
     void GraphicsEngine::SetViewCamera(CameraBase* viewCam, ComponentInterface* camComp)
@@ -78,21 +100,160 @@ namespace Graphics
     }
     
 
+    bool GraphicsEngine::isOcclusionCullingEnabled() const
+    {
+        return DebugRenderUniform.EnableFrustumCulling != 0 && DebugRenderUniform.EnableOcclusionCulling != 0;
+    }
+
+    void GraphicsEngine::BeginOcclusionCulling(Scene* scene)
+    {
+        using namespace Component;
+        if (!isOcclusionCullingEnabled())
+            return;
+        std::vector<OcclusionCuller::Occluder> occluders;
+        for (auto& i : scene->GetRenderObjectListRef())//per shader
+        {
+            for (auto& j : i.second)//per object
+            {
+                Object& object = scene->GetObjectRef(ObjectHandle(j.first));
+                if (!object.IsActive() || !object.HasComponent<Renderer>())
+                    continue;
+                Renderer& renderer = object.GetComponentRef<Renderer>();
+                if (!renderer.IsEnabled() || !renderer.IsOccluder())
+                    continue;
+                Math::Matrix4 const& world = object.GetComponentRef<Component::Transform>().GetWorldTransform();
+                if (renderer.GetOccluderMesh())
+                {
+                    occluders.push_back({ renderer.GetOccluderMesh(), world });
+                    continue;
+                }
+                for (size_t slot = 0; slot < renderer.GetMeshSlotCount(); ++slot)
+                {
+                    std::shared_ptr<TriangleMesh> mesh = std::dynamic_pointer_cast<TriangleMesh>(renderer.GetMesh(slot));
+                    if (mesh)
+                        occluders.push_back({ mesh, world });
+                }
+            }
+        }
+        m_occlusionCuller.BeginFrame(m_viewCamera->GetViewProjMatrix(), std::move(occluders));
+    }
+
+    void GraphicsEngine::cullOccluded(Scene* scene)
+    {
+        if (!isOcclusionCullingEnabled())
+        {
+            OcclusionCulling = OcclusionCuller::FrameStats();
+            return;
+        }
+        ScopedFrameTiming timing("subsystem", "Occlusion culling");
+        if (!m_occlusionCuller.IsFramePending())
+        {
+            BeginOcclusionCulling(scene);
+        }
+        OcclusionCulling = m_occlusionCuller.Cull(scene->GetFrustumCullerRef(), m_visibleObjects, m_cameraVisibleMask);
+        if (FrameTimings::IsEnabled())
+        {
+            //on the workers, mostly hidden behind the scene update
+            FrameTimings::Add("worker", "Occlusion rasterization", OcclusionCulling.RasterMilliseconds);
+        }
+    }
+
+    void GraphicsEngine::RenderScene(Scene* scene, RenderDevice& device)
+    {
+        using namespace Component;
+        const bool cull = DebugRenderUniform.EnableFrustumCulling != 0;
+        CameraCulling = cull ? scene->CullObjects(Frustum(m_viewCamera->GetViewProjMatrix()), m_visibleObjects, m_cameraVisibleMask)
+                             : CullStats();
+        if (cull)
+        {
+            cullOccluded(scene);
+        }
+        else
+        {
+            OcclusionCulling = OcclusionCuller::FrameStats();
+        }
+
+        device.BeginFrame(Application::GetInstance().GetWindowWidth(), Application::GetInstance().GetWindowHeight(),
+                          m_backgroundColor);
+        device.SetView(RenderView::FromCamera(*m_viewCamera));
+        std::list<LightAttribute> const& lights = LightManager::GetLightAttributes();
+        device.SetLights(std::vector<LightAttribute>(lights.begin(), lights.end()));
+        for (auto& i : scene->GetRenderObjectListRef())//per shader
+        {
+            for (auto& j : i.second)//per object
+            {
+                if (cull && (static_cast<size_t>(j.first) >= m_cameraVisibleMask.size() || !m_cameraVisibleMask[j.first]))
+                    continue;
+                Object& object = scene->GetObjectRef(ObjectHandle(j.first));
+                if (!object.IsActive() || !object.HasComponent<Renderer>())
+                    continue;
+                Renderer& renderer = object.GetComponentRef<Renderer>();
+                if (!renderer.IsEnabled())
+                    continue;
+                Math::Matrix4 const& world = object.GetComponentRef<Component::Transform>().GetWorldTransform();
+                for (size_t slot = 0; slot < renderer.GetMeshSlotCount(); ++slot)
+                {
+                    device.Draw(std::dynamic_pointer_cast<TriangleMesh>(renderer.GetMesh(slot)), renderer.GetMaterial(), world);
+                }
+            }
+        }
+        device.EndFrame();
+    }
+
     void GraphicsEngine::renderScene(Scene* scene)
     {
+        PROFILE_SCOPE("GraphicsEngine::renderScene");
+        //the camera decides what is drawn, the shadowing light what is rendered to the shadow map
+        const bool cull = DebugRenderUniform.EnableFrustumCulling != 0;
+        if (cull)
+        {
+            {
+                ScopedFrameTiming timing("subsystem", "Culling");
+                CameraCulling = scene->CullObjects(Frustum(m_viewCamera->GetViewProjMatrix()), m_visibleObjects, m_cameraVisibleMask);
+            }
+            //timed on its own as "Occlusion culling", outside the Culling section
+            cullOccluded(scene);
+            ScopedFrameTiming timing("subsystem", "Culling");
+            ShadowCulling = scene->CullObjects(Frustum(GetLightViewProj()), m_visibleObjects, m_shadowVisibleMask);
+        }
+        else
+        {
+            CameraCulling = CullStats();
+            ShadowCulling = CullStats();
+            OcclusionCulling = OcclusionCuller::FrameStats();
+        }
+        auto isVisible = [cull](std::vector<u8> const& mask, ObjectId id)
+        {
+            return !cull || (static_cast<size_t>(id) < mask.size() && mask[id]);
+        };
+
         auto& renderList = scene->GetRenderObjectListRef();
         for (auto& i : renderList)//per shader
         {
+            m_renderList.clear();
+            m_shadowCasterList.clear();
+            for (auto& j : i.second)//per object
+            {
+                if (isVisible(m_cameraVisibleMask, j.first))
+                {
+                    m_renderList.push_back(j.second);
+                }
+                if (isVisible(m_shadowVisibleMask, j.first))
+                {
+                    m_shadowCasterList.push_back(j.second);
+                }
+            }
+
             //bind this shader to render all object with this shader type
             std::shared_ptr<Shader> shader = m_shaderManager->GetShader(i.first);
             
             if (shader->IsDeferred())
             {
-                deferredRender(shader, i.second);
+                deferredRender(shader, m_renderList, m_shadowCasterList);
             }
             else
             {
-                forwardRender(shader, i.second);
+                forwardRender(shader, m_renderList);
             }
         }
 
@@ -100,147 +261,226 @@ namespace Graphics
         m_shaderManager->UnbindAllShader();
     }
 
-    void GraphicsEngine::forwardRender(const std::shared_ptr<Shader>& shader, std::unordered_map<ObjectId, RenderObject*>& obj)
+    void GraphicsEngine::forwardRender(const std::shared_ptr<Shader>& shader, std::vector<RenderObject*> const& obj)
     {
         std::shared_ptr<ShaderProgram> program = shader->GetShaderProgram(ShaderStage::ForwardRendering);
         program->Bind();
         m_viewCamera->SetCameraUniforms(program);
 
         m_lightManager->SetLightsUniform(program);
-        for (auto& j : obj)//per object
+        drawObjects(program, obj);
+    }
+
+    void GraphicsEngine::deferredRender(const std::shared_ptr<Shader>& shader, std::vector<RenderObject*> const& obj,
+                                        std::vector<RenderObject*> const& shadowCasters)
+    {
+        //the SSAO toggle changes which passes are alive, recompile when it flips
+        if (m_deferredGraphSSAO != (DebugRenderUniform.EnableSSAO != 0))
         {
-            for (auto& k : *j.second)//per shaded component
-            {
-                k->SetShaderParams(program, this);
-            }
-            m_textureManager->UnbindAll();
+            buildDeferredGraph();
         }
+
+        m_deferredShader = shader;
+        m_deferredObjects = &obj;
+        m_deferredShadowCasters = &shadowCasters;
+        //compact G-buffer rebuilds world position from depth in every pass reading it
+        m_deferredCompactGBuffer = m_frameBufferManager->GetFramebuffer(FramebufferType::DeferredGBuffer)->IsCompactGBuffer();
+        m_deferredInverseViewProj = m_viewCamera->GetViewProjMatrix().Inverted();
+
+        m_deferredGraph.Execute(*m_frameBufferManager);
+
+        m_deferredShader = nullptr;
+        m_deferredObjects = nullptr;
+        m_deferredShadowCasters = nullptr;
+    }
+
+    void GraphicsEngine::buildDeferredGraph()
+    {
+        //SSAO runs at half resolution, shadow maps are in light space and keep a fixed size
+        const RenderTargetDesc gbuffer(m_gbufferUsage, 1.0f);
+        const RenderTargetDesc ssao(FBO_USAGE_DEPTH_BUFFER, 0.5f);
+        const RenderTargetDesc shadow(FBO_USAGE_FLOAT_BUFFER, 512u, 512u);
+        const bool enableSSAO = DebugRenderUniform.EnableSSAO != 0;
+
+        m_deferredGraph.Reset();
+        m_deferredGraph.DeclareResource(FramebufferType::DeferredGBuffer, gbuffer);
+        m_deferredGraph.DeclareResource(FramebufferType::SSAO, ssao);
+        m_deferredGraph.DeclareResource(FramebufferType::SSAOBlurH, ssao);
+        m_deferredGraph.DeclareResource(FramebufferType::SSAOBlurV, ssao);
+        m_deferredGraph.DeclareResource(FramebufferType::GenShadowMap, shadow);
+        m_deferredGraph.DeclareResource(FramebufferType::ShadowBlurH, shadow);
+        m_deferredGraph.DeclareResource(FramebufferType::ShadowBlurV, shadow);
+
+        //Deferred Shading Step 1 : fill framebuffer with multiple attachments(GBuffer)
+        m_deferredGraph.AddPass("GBuffer", [this]() { passGBuffer(); })
+            .Write(FramebufferType::DeferredGBuffer);
+        //Deferred Shading Step 2 : Generate SSAO factor
+        m_deferredGraph.AddPass("GenSSAO", [this]() { passGenSSAO(); })
+            .Read(FramebufferType::DeferredGBuffer)
+            .Write(FramebufferType::SSAO);
+        //Deferred Shading Step 3 : Generate Shadow Map
+        m_deferredGraph.AddPass("GenShadowMap", [this]() { passGenShadowMap(); })
+            .Write(FramebufferType::GenShadowMap);
+        //Deferred Shading Step 4 : Blur SSAO map
+        m_deferredGraph.AddPass("BlurSSAOH", [this]() { passBlurSSAO(FramebufferType::SSAO, FramebufferType::SSAOBlurH, true); })
+            .Read(FramebufferType::SSAO)
+            .Read(FramebufferType::DeferredGBuffer)
+            .Write(FramebufferType::SSAOBlurH);
+        m_deferredGraph.AddPass("BlurSSAOV", [this]() { passBlurSSAO(FramebufferType::SSAOBlurH, FramebufferType::SSAOBlurV, false); })
+            .Read(FramebufferType::SSAOBlurH)
+            .Read(FramebufferType::DeferredGBuffer)
+            .Write(FramebufferType::SSAOBlurV);
+        //Deferred Shading Step 5 : Blur ShadowMap
+        m_deferredGraph.AddPass("BlurShadowMapH", [this]() { passBlurShadowMap(FramebufferType::GenShadowMap, FramebufferType::ShadowBlurH, true); })
+            .Read(FramebufferType::GenShadowMap)
+            .Write(FramebufferType::ShadowBlurH);
+        m_deferredGraph.AddPass("BlurShadowMapV", [this]() { passBlurShadowMap(FramebufferType::ShadowBlurH, FramebufferType::ShadowBlurV, false); })
+            .Read(FramebufferType::ShadowBlurH)
+            .Write(FramebufferType::ShadowBlurV);
+        //Deferred Shading Step 6 : Combine everything, the screen is cleared by RenderScene
+        FrameGraph::Pass& finalPass = m_deferredGraph.AddPass("Final", [this]() { passFinal(); })
+            .Read(FramebufferType::DeferredGBuffer)
+            .Read(FramebufferType::ShadowBlurV)
+            .Write(FramebufferType::Screen, false);
+        if (enableSSAO)
+        {
+            finalPass.Read(FramebufferType::SSAOBlurV);
+        }
+
+        bool compiled = m_deferredGraph.Compile();
+        Assert(compiled, "Failed to compile the deferred frame graph.");
+        m_deferredGraphSSAO = enableSSAO;
+
+        m_frameBufferManager->ResetTransientFramebuffers();
+        for (auto const& i : m_deferredGraph.GetResourceLifetimes())
+        {
+            m_frameBufferManager->RegisterTransientFramebuffer(i.first, i.second.Desc, i.second.FirstUse, i.second.LastUse);
+        }
+        m_frameBufferManager->BuildTransientFramebuffers();
+#if VERBOSE
+        m_deferredGraph.PrintSchedule(std::cout);
+#endif // VERBOSE
     }
 
-    void GraphicsEngine::deferredRender(const std::shared_ptr<Shader>& shader, std::unordered_map<ObjectId, RenderObject*>& obj)
+    void GraphicsEngine::passGBuffer()
     {
-        float screenWidth = 0;
-        float screenHeight = 0;
-        float fboWidth = 0;
-        float fboHeight = 0;
-        std::shared_ptr<Framebuffer> fbo;
-        //TODO Deferred Shading Step 1 : fill framebuffer with multiple attachments(GBuffer)
-        std::shared_ptr<ShaderProgram> program = shader->GetShaderProgram(ShaderStage::DiffuseMaterial);
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::DiffuseMaterial);
         program->Bind();
+        program->SetUniform("CompactGBuffer", m_deferredCompactGBuffer);
         EnableDepthTest();
-        m_frameBufferManager->Bind(FramebufferType::DeferredGBuffer);
-        m_frameBufferManager->Clear(FramebufferType::DeferredGBuffer);
+        drawObjects(program, *m_deferredObjects);
+    }
 
-        for (auto& j : obj)//per object
+    void GraphicsEngine::drawObjects(std::shared_ptr<ShaderProgram> const& program, std::vector<RenderObject*> const& obj)
+    {
+        //with the material table every texture is bound once for the whole pass,
+        //objects only set their material index
+        ScopedFrameTiming timing("subsystem", "Draw submission");
+        const bool materialTable = m_materialManager->IsMaterialTableEnabled();
+        if (materialTable)
         {
-            for (auto& k : *j.second)//per shaded component
+            m_materialManager->BindMaterialTable(program, *m_textureManager);
+        }
+        for (RenderObject* j : obj)//per object
+        {
+            for (auto& k : *j)//per shaded component
             {
                 k->SetShaderParams(program, this);
             }
+            if (!materialTable)
+            {
+                m_textureManager->UnbindAll();
+            }
+        }
+        if (materialTable)
+        {
             m_textureManager->UnbindAll();
         }
+    }
 
-        if (DebugRenderUniform.EnableSSAO)
-        {
-            //TODO Deferred Shading Step 2 : Generate SSAO factor
-            program = shader->GetShaderProgram(ShaderStage::GenSSAO);
-            program->Bind();
-            m_frameBufferManager->Bind(FramebufferType::SSAO);
-            m_frameBufferManager->Clear(FramebufferType::SSAO);
-            fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::DeferredGBuffer);
-            fbo->BindGBufferPositionNormal(program);
-            fbo->BindDepthTexture(program);
-
-            fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::SSAO);
-            fboWidth = static_cast<float>(fbo->GetWidth());
-            fboHeight = static_cast<float>(fbo->GetHeight());
-            program->SetUniform("UseSpiralAlgorithm", SSAO.UseSpiralAlgorithm);
-            program->SetUniform("ScreenDimension", Math::Vec2(fboWidth, fboHeight));
-            program->SetUniform("ControlVariable", SSAO.ControlVariable);
-            program->SetUniform("SamplePointNum", SSAO.SamplePointNum);
-            program->SetUniform("RangeOfInfluence", SSAO.RangeOfInfluence);
-            m_meshManager->GetMesh("FSQ")->Render();
+    void GraphicsEngine::passGenSSAO()
+    {
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::GenSSAO);
+        program->Bind();
+        std::shared_ptr<Framebuffer> fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::DeferredGBuffer);
+        fbo->BindGBufferPositionNormal(program);
+        fbo->BindDepthTexture(program);
 
-        }
-        //TODO Deferred Shading Step 3 : Generate Shadow Map
+        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::SSAO);
+        float fboWidth = static_cast<float>(fbo->GetWidth());
+        float fboHeight = static_cast<float>(fbo->GetHeight());
+        program->SetUniform("CompactGBuffer", m_deferredCompactGBuffer);
+        program->SetUniform("InverseViewProj", m_deferredInverseViewProj);
+        program->SetUniform("UseSpiralAlgorithm", SSAO.UseSpiralAlgorithm);
+        program->SetUniform("ScreenDimension", Math::Vec2(fboWidth, fboHeight));
+        program->SetUniform("ControlVariable", SSAO.ControlVariable);
+        program->SetUniform("SamplePointNum", SSAO.SamplePointNum);
+        program->SetUniform("RangeOfInfluence", SSAO.RangeOfInfluence);
+        m_meshManager->GetMesh("FSQ")->Render();
+    }
+
+    void GraphicsEngine::passGenShadowMap()
+    {
         //glEnable(GL_CULL_FACE);
         //glCullFace(GL_FRONT);
-        program = shader->GetShaderProgram(ShaderStage::DeferredLighting);
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::DeferredLighting);
         program->Bind();
-        m_frameBufferManager->Bind(FramebufferType::GenShadowMap);
-        m_frameBufferManager->Clear(FramebufferType::GenShadowMap);
         m_lightManager->SetLightShadowUniforms(program);
         //m_viewCamera->SetCameraUniforms(program);
-        for (auto& i : obj)//per object
+        //objects outside the view can still cast shadows into it, these are culled by the light
+        ScopedFrameTiming timing("subsystem", "Draw submission");
+        for (RenderObject* i : *m_deferredShadowCasters)//per object
         {
-            for (auto& j : *i.second)//per shaded component
+            for (auto& j : *i)//per shaded component
             {
                 j->SetShaderParams(program, this);
             }
         }
+    }
 
-        //TODO Deferred Shading Step 4 : Blur SSAO map Horinzontally
-        program = shader->GetShaderProgram(ShaderStage::BlurSSAO);
+    void GraphicsEngine::passBlurSSAO(FramebufferType source, FramebufferType target, bool horizontal)
+    {
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::BlurSSAO);
         program->Bind();
+        m_frameBufferManager->GetFramebuffer(source)->BindSSAOTexture(program);
 
-        m_frameBufferManager->Bind(FramebufferType::SSAOBlurH);
-        m_frameBufferManager->Clear(FramebufferType::SSAOBlurH);
-        m_frameBufferManager->GetFramebuffer(FramebufferType::SSAO)->BindSSAOTexture(program);
-
-        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::DeferredGBuffer);
+        std::shared_ptr<Framebuffer> fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::DeferredGBuffer);
         fbo->BindGBufferNormal(program);
         fbo->BindDepthTexture(program);
 
-        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::SSAO);
-        fboWidth = static_cast<float>(fbo->GetWidth());
-        fboHeight = static_cast<float>(fbo->GetHeight());
+        fbo = m_frameBufferManager->GetFramebuffer(target);
+        float fboWidth = static_cast<float>(fbo->GetWidth());
+        float fboHeight = static_cast<float>(fbo->GetHeight());
+        program->SetUniform("CompactGBuffer", m_deferredCompactGBuffer);
         program->SetUniform("BlurWidth", SSAO.BlurWidth);
         program->SetUniform("EdgeStrength", SSAO.EdgeStrength);
         program->SetUniform("ScreenDimension", Math::Vec2(fboWidth, fboHeight));
-        program->SetUniform("HorizontalBlur", true);
+        program->SetUniform("HorizontalBlur", horizontal);
         m_meshManager->GetMesh("FSQ")->Render();
+    }
 
-        //TODO Deferred Shading Step 4.5 : Blur SSAO map Vertically
-        m_frameBufferManager->Bind(FramebufferType::SSAOBlurV);
-        m_frameBufferManager->Clear(FramebufferType::SSAOBlurV);
-        m_frameBufferManager->GetFramebuffer(FramebufferType::SSAOBlurH)->BindSSAOTexture(program);
-        program->SetUniform("HorizontalBlur", false);
-        m_meshManager->GetMesh("FSQ")->Render();
-
-
-        //TODO Deferred Shading Step 5 : Blur ShadowMap Horinzontally
-        program = shader->GetShaderProgram(ShaderStage::BlurShadowMap);
+    void GraphicsEngine::passBlurShadowMap(FramebufferType source, FramebufferType target, bool horizontal)
+    {
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::BlurShadowMap);
         program->Bind();
+        m_frameBufferManager->GetFramebuffer(source)->BindShadowMapTexture(program);
 
-        m_frameBufferManager->Bind(FramebufferType::ShadowBlurH);
-        m_frameBufferManager->Clear(FramebufferType::ShadowBlurH);
-        m_frameBufferManager->GetFramebuffer(FramebufferType::GenShadowMap)->BindShadowMapTexture(program);
-
-        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::ShadowBlurH);
-        fboWidth = static_cast<float>(fbo->GetWidth());
-        fboHeight = static_cast<float>(fbo->GetHeight());
+        std::shared_ptr<Framebuffer> fbo = m_frameBufferManager->GetFramebuffer(target);
+        float fboWidth = static_cast<float>(fbo->GetWidth());
+        float fboHeight = static_cast<float>(fbo->GetHeight());
         program->SetUniform("ScreenDimension", Math::Vec2(fboWidth, fboHeight));
-        program->SetUniform("HorizontalBlur", true);
+        program->SetUniform("HorizontalBlur", horizontal);
         m_lightManager->SetShadowFilterUniforms(program);
         m_meshManager->GetMesh("FSQ")->Render();
+    }
 
-        //TODO Deferred Shading Step 5.5 : Blur ShadowMap map Vertically
-        m_frameBufferManager->Bind(FramebufferType::ShadowBlurV);
-        m_frameBufferManager->Clear(FramebufferType::ShadowBlurV);
-        m_frameBufferManager->GetFramebuffer(FramebufferType::ShadowBlurH)->BindShadowMapTexture(program);
-        program->SetUniform("HorizontalBlur", false);
-        m_meshManager->GetMesh("FSQ")->Render();
-
-
-
-    
-        //TODO Deferred Shading Step 6 : Combine everything
-        program = shader->GetShaderProgram(ShaderStage::RenderFullScreenQuad);
+    void GraphicsEngine::passFinal()
+    {
+        std::shared_ptr<ShaderProgram> program = m_deferredShader->GetShaderProgram(ShaderStage::RenderFullScreenQuad);
         program->Bind();
 
-        m_frameBufferManager->Bind(FramebufferType::Screen);
         //shadow map
-        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::ShadowBlurV);
+        std::shared_ptr<Framebuffer> fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::ShadowBlurV);
         fbo->BindShadowMapTexture(program);
         program->SetUniform("LightViewProj", m_lightManager->GetLightViewProj());
 
@@ -252,16 +492,21 @@ namespace Graphics
         fbo->BindGBufferTextures(program);
         fbo->BindDepthTexture(program);
 
-        //ssao
-        fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::SSAOBlurV);
-        fbo->BindSSAOTexture(program);
+        //ssao, culled from the graph when disabled
+        if (DebugRenderUniform.EnableSSAO)
+        {
+            fbo = m_frameBufferManager->GetFramebuffer(FramebufferType::SSAOBlurV);
+            fbo->BindSSAOTexture(program);
+        }
 
+        program->SetUniform("CompactGBuffer", m_deferredCompactGBuffer);
+        program->SetUniform("InverseViewProj", m_deferredInverseViewProj);
         program->SetUniform("DebugOutputIndex", DebugRenderUniform.OutputIndex);
         program->SetUniform("EnableBlur", DebugRenderUniform.EnableBlur);
         program->SetUniform("BlurStrength", DebugRenderUniform.BlurStrength);
         program->SetUniform("EnableSSAO", DebugRenderUniform.EnableSSAO);
-        screenWidth = static_cast<float>(Application::GetInstance().GetWindowWidth());
-        screenHeight = static_cast<float>(Application::GetInstance().GetWindowHeight());
+        float screenWidth = static_cast<float>(Application::GetInstance().GetWindowWidth());
+        float screenHeight = static_cast<float>(Application::GetInstance().GetWindowHeight());
         program->SetUniform("ScreenDimension", Math::Vec2(screenWidth, screenHeight));
 
         m_meshManager->GetMesh("FSQ")->Render();
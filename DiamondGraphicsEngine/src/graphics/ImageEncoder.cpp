@@ -0,0 +1,348 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/ImageEncoder.h"
+
+#include <STB/stb_image_write.h>
+
+namespace
+{
+    //https://qoiformat.org/qoi-specification.pdf
+    const u8 c_qoiIndex = 0x00;
+    const u8 c_qoiDiff = 0x40;
+    const u8 c_qoiLuma = 0x80;
+    const u8 c_qoiRun = 0xc0;
+    const u8 c_qoiRGB = 0xfe;
+    const u8 c_qoiRGBA = 0xff;
+    const u8 c_qoiMask = 0xc0;
+    const u8 c_qoiEnd[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    const size_t c_qoiHeaderSize = 14;
+
+    struct Rgba
+    {
+        u8 r = 0, g = 0, b = 0, a = 255;
+
+        bool operator==(Rgba const& rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b && a == rhs.a; }
+        u32 Hash() const { return (r * 3u + g * 5u + b * 7u + a * 11u) % 64u; }
+    };
+
+    void pushBigEndian(std::vector<u8>& bytes, u32 value)
+    {
+        bytes.push_back(static_cast<u8>(value >> 24));
+        bytes.push_back(static_cast<u8>(value >> 16));
+        bytes.push_back(static_cast<u8>(value >> 8));
+        bytes.push_back(static_cast<u8>(value));
+    }
+
+    u32 readBigEndian(u8 const* bytes)
+    {
+        return (u32(bytes[0]) << 24) | (u32(bytes[1]) << 16) | (u32(bytes[2]) << 8) | u32(bytes[3]);
+    }
+
+    //row y of the image as it is stored, top row first
+    u8 const* imageRow(u8 const* pixels, u32 width, u32 height, u8 channels, u32 y, bool bottomUp)
+    {
+        return pixels + size_t(bottomUp ? height - 1 - y : y) * width * channels;
+    }
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+namespace Graphics
+{
+    char const* ImageEncoder::GetExtension(ImageFormat format, u8 channels)
+    {
+        switch (format)
+        {
+        case ImageFormat::QOI:
+            return "qoi";
+        case ImageFormat::Raw:
+            return channels == 4 ? "pam" : "ppm";
+        default:
+            return "png";
+        }
+    }
+
+    std::vector<u8> ImageEncoder::Encode(u8 const* pixels, u32 width, u32 height, u8 channels, ImageFormat format, bool bottomUp)
+    {
+        Assert(channels == 3 || channels == 4, "Can only encode RGB and RGBA images, not %d channels.", channels);
+        switch (format)
+        {
+        case ImageFormat::QOI:
+            return encodeQOI(pixels, width, height, channels, bottomUp);
+        case ImageFormat::Raw:
+            return encodeRaw(pixels, width, height, channels, bottomUp);
+        default:
+            return encodePNG(pixels, width, height, channels, bottomUp);
+        }
+    }
+
+    bool ImageEncoder::WriteFile(std::string const& path, u8 const* pixels, u32 width, u32 height, u8 channels,
+                                 ImageFormat format, bool bottomUp)
+    {
+        std::vector<u8> bytes = Encode(pixels, width, height, channels, format, bottomUp);
+        if (bytes.empty())
+            return false;
+        std::ofstream file(path, std::ios::binary);
+        if (!file.write(reinterpret_cast<char const*>(bytes.data()), bytes.size()))
+            return false;
+        return true;
+    }
+
+    std::vector<u8> ImageEncoder::encodePNG(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp)
+    {
+        //stb filters rows relative to the stride, so a negative one flips for free
+        int stride = static_cast<int>(width * channels);
+        u8* first = const_cast<u8*>(imageRow(pixels, width, height, channels, 0, bottomUp));
+        int length = 0;
+        u8* png = stbi_write_png_to_mem(first, bottomUp ? -stride : stride, width, height, channels, &length);
+        if (!png)
+            return std::vector<u8>();
+        std::vector<u8> bytes(png, png + length);
+        free(png);
+        return bytes;
+    }
+
+    std::vector<u8> ImageEncoder::encodeRaw(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp)
+    {
+        std::stringstream header;
+        if (channels == 4)
+            header << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+        else
+            header << "P6\n" << width << " " << height << "\n255\n";
+        std::string text = header.str();
+        size_t rowBytes = size_t(width) * channels;
+        std::vector<u8> bytes(text.size() + rowBytes * height);
+        std::memcpy(bytes.data(), text.data(), text.size());
+        for (u32 y = 0; y < height; ++y)
+            std::memcpy(&bytes[text.size() + y * rowBytes], imageRow(pixels, width, height, channels, y, bottomUp), rowBytes);
+        return bytes;
+    }
+
+    std::vector<u8> ImageEncoder::encodeQOI(u8 const* pixels, u32 width, u32 height, u8 channels, bool bottomUp)
+    {
+        std::vector<u8> bytes;
+        //worst case is every pixel as QOI_OP_RGBA
+        bytes.reserve(c_qoiHeaderSize + size_t(width) * height * (channels + 1) + sizeof(c_qoiEnd));
+        bytes.insert(bytes.end(), { 'q', 'o', 'i', 'f' });
+        pushBigEndian(bytes, width);
+        pushBigEndian(bytes, height);
+        bytes.push_back(channels);
+        bytes.push_back(0); //sRGB with linear alpha
+
+        //the index starts all zero, alpha included
+        Rgba index[64];
+        for (Rgba& entry : index)
+            entry.a = 0;
+        Rgba previous;
+        u32 run = 0;
+        u64 pixelCount = u64(width) * height;
+        u64 pixelIndex = 0;
+        for (u32 y = 0; y < height; ++y)
+        {
+            u8 const* row = imageRow(pixels, width, height, channels, y, bottomUp);
+            for (u32 x = 0; x < width; ++x, ++pixelIndex)
+            {
+                u8 const* channel = row + x * channels;
+                Rgba pixel;
+                pixel.r = channel[0];
+                pixel.g = channel[1];
+                pixel.b = channel[2];
+                if (channels == 4)
+                    pixel.a = channel[3];
+
+                if (pixel == previous)
+                {
+                    ++run;
+                    if (run == 62 || pixelIndex + 1 == pixelCount)
+                    {
+                        bytes.push_back(static_cast<u8>(c_qoiRun | (run - 1)));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0)
+                {
+                    bytes.push_back(static_cast<u8>(c_qoiRun | (run - 1)));
+                    run = 0;
+                }
+
+                u32 hash = pixel.Hash();
+                if (index[hash] == pixel)
+                {
+                    bytes.push_back(static_cast<u8>(c_qoiIndex | hash));
+                }
+                else
+                {
+                    index[hash] = pixel;
+                    if (pixel.a == previous.a)
+                    {
+                        s32 dr = static_cast<signed char>(pixel.r - previous.r);
+                        s32 dg = static_cast<signed char>(pixel.g - previous.g);
+                        s32 db = static_cast<signed char>(pixel.b - previous.b);
+                        s32 drg = dr - dg;
+                        s32 dbg = db - dg;
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                        {
+                            bytes.push_back(static_cast<u8>(c_qoiDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                        }
+                        else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+                        {
+                            bytes.push_back(static_cast<u8>(c_qoiLuma | (dg + 32)));
+                            bytes.push_back(static_cast<u8>(((drg + 8) << 4) | (dbg + 8)));
+                        }
+                        else
+                        {
+                            bytes.insert(bytes.end(), { c_qoiRGB, pixel.r, pixel.g, pixel.b });
+                        }
+                    }
+                    else
+                    {
+                        bytes.insert(bytes.end(), { c_qoiRGBA, pixel.r, pixel.g, pixel.b, pixel.a });
+                    }
+                }
+                previous = pixel;
+            }
+        }
+        bytes.insert(bytes.end(), std::begin(c_qoiEnd), std::end(c_qoiEnd));
+        return bytes;
+    }
+
+    bool ImageEncoder::DecodeQOI(u8 const* bytes, size_t size, std::vector<u8>& pixels, u32& width, u32& height, u8& channels)
+    {
+        if (size < c_qoiHeaderSize + sizeof(c_qoiEnd) || std::memcmp(bytes, "qoif", 4) != 0)
+            return false;
+        width = readBigEndian(bytes + 4);
+        height = readBigEndian(bytes + 8);
+        channels = bytes[12];
+        if (channels != 3 && channels != 4)
+            return false;
+
+        u64 pixelCount = u64(width) * height;
+        pixels.resize(size_t(pixelCount) * channels);
+        Rgba index[64];
+        for (Rgba& entry : index)
+            entry.a = 0;
+        Rgba pixel;
+        u32 run = 0;
+        size_t position = c_qoiHeaderSize;
+        size_t end = size - sizeof(c_qoiEnd);
+        for (u64 i = 0; i < pixelCount; ++i)
+        {
+            if (run > 0)
+            {
+                --run;
+            }
+            else if (position < end)
+            {
+                u8 op = bytes[position++];
+                if (op == c_qoiRGB && position + 3 <= end)
+                {
+                    pixel.r = bytes[position++];
+                    pixel.g = bytes[position++];
+                    pixel.b = bytes[position++];
+                }
+                else if (op == c_qoiRGBA && position + 4 <= end)
+                {
+                    pixel.r = bytes[position++];
+                    pixel.g = bytes[position++];
+                    pixel.b = bytes[position++];
+                    pixel.a = bytes[position++];
+                }
+                else if ((op & c_qoiMask) == c_qoiIndex)
+                {
+                    pixel = index[op];
+                }
+                else if ((op & c_qoiMask) == c_qoiDiff)
+                {
+                    pixel.r += ((op >> 4) & 3) - 2;
+                    pixel.g += ((op >> 2) & 3) - 2;
+                    pixel.b += (op & 3) - 2;
+                }
+                else if ((op & c_qoiMask) == c_qoiLuma && position < end)
+                {
+                    u8 second = bytes[position++];
+                    s32 dg = (op & 0x3f) - 32;
+                    pixel.r += dg - 8 + ((second >> 4) & 0x0f);
+                    pixel.g += dg;
+                    pixel.b += dg - 8 + (second & 0x0f);
+                }
+                else if ((op & c_qoiMask) == c_qoiRun)
+                {
+                    run = op & 0x3f;
+                }
+                else
+                {
+                    return false;
+                }
+                index[pixel.Hash()] = pixel;
+            }
+            else
+            {
+                return false;
+            }
+
+            u8* out = &pixels[size_t(i) * channels];
+            out[0] = pixel.r;
+            out[1] = pixel.g;
+            out[2] = pixel.b;
+            if (channels == 4)
+                out[3] = pixel.a;
+        }
+        return true;
+    }
+
+    ImageEncoder::Benchmark ImageEncoder::Measure(u32 width, u32 height, u8 channels, ImageFormat format, u32 seed)
+    {
+        Benchmark result;
+        result.Format = format;
+        result.Width = width;
+        result.Height = height;
+
+        //gradients like lit surfaces, flat bands like the background, a noisy corner like SSAO
+        std::mt19937 random(seed);
+        std::vector<u8> pixels(size_t(width) * height * channels);
+        for (u32 y = 0; y < height; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                u8* pixel = &pixels[(size_t(y) * width + x) * channels];
+                bool background = (y / 64) % 4 == 3;
+                bool noisy = x < width / 4 && y < height / 4;
+                for (u8 c = 0; c < channels; ++c)
+                {
+                    u32 value = background ? 25 : (x * (c + 1) + y * (3 - c % 3)) / 8 % 256;
+                    if (noisy)
+                        value = (value + random() % 16) % 256;
+                    pixel[c] = static_cast<u8>(c == 3 ? 255 : value);
+                }
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<u8> bytes = Encode(pixels.data(), width, height, channels, format, true);
+        result.Milliseconds = elapsedMilliseconds(start);
+        result.Bytes = bytes.size();
+        result.MegaPixelsPerSecond = result.Milliseconds > 0.0f ? width * height / (result.Milliseconds * 1000.0f) : 0.0f;
+
+        if (format == ImageFormat::QOI)
+        {
+            std::vector<u8> decoded;
+            u32 decodedWidth = 0, decodedHeight = 0;
+            u8 decodedChannels = 0;
+            result.RoundTrip = DecodeQOI(bytes.data(), bytes.size(), decoded, decodedWidth, decodedHeight, decodedChannels)
+                && decodedWidth == width && decodedHeight == height && decodedChannels == channels;
+            //encoded bottom up, so compare row by row flipped
+            size_t rowBytes = size_t(width) * channels;
+            for (u32 y = 0; y < height && result.RoundTrip; ++y)
+            {
+                if (std::memcmp(&decoded[y * rowBytes], &pixels[(height - 1 - y) * rowBytes], rowBytes) != 0)
+                    result.RoundTrip = false;
+            }
+        }
+        return result;
+    }
+}
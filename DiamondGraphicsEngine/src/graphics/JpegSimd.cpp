@@ -0,0 +1,258 @@
+#include "Precompiled.h"
+#include "graphics/JpegSimd.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+    //fixed point constants of the stb_image IDCT, 12 fraction bits, rounded as stbi__f2f does
+    constexpr int f2f(float x) { return static_cast<int>(x * 4096 + 0.5); }
+    //fixed point constants of the stb_image color conversion, 16 fraction bits
+    constexpr int float2fixed(float x) { return static_cast<int>(x * 65536 + 0.5); }
+
+    const int c_crToR = float2fixed(1.40200f);
+    const int c_crToG = float2fixed(0.71414f);
+    const int c_cbToG = float2fixed(0.34414f);
+    const int c_cbToB = float2fixed(1.77200f);
+
+    //_mm_madd_epi16 multiplies 16 bit pairs, constants too large for 16 bits are
+    //split as hi * 2^shift + lo with the input shifted by the same amount
+    __m128i multiplyPair(__m128i lo, __m128i hi, int constantLo, int constantHi)
+    {
+        return _mm_madd_epi16(_mm_unpacklo_epi16(lo, hi), _mm_setr_epi16(
+            static_cast<short>(constantLo), static_cast<short>(constantHi), static_cast<short>(constantLo), static_cast<short>(constantHi),
+            static_cast<short>(constantLo), static_cast<short>(constantHi), static_cast<short>(constantLo), static_cast<short>(constantHi)));
+    }
+
+    //y + (k + 32768) >> 16 for four pixels, as the scalar code rounds
+    __m128i finishChannel(__m128i y, __m128i k)
+    {
+        return _mm_add_epi32(y, _mm_srai_epi32(_mm_add_epi32(k, _mm_set1_epi32(32768)), 16));
+    }
+
+    __m128i dctConstant(int x, int y)
+    {
+        return _mm_setr_epi16(static_cast<short>(x), static_cast<short>(y), static_cast<short>(x), static_cast<short>(y),
+                              static_cast<short>(x), static_cast<short>(y), static_cast<short>(x), static_cast<short>(y));
+    }
+
+    //32 bit results of a 16 bit rotation, low and high four lanes
+    struct Wide
+    {
+        __m128i Lo;
+        __m128i Hi;
+    };
+
+    Wide add(Wide a, Wide b) { return { _mm_add_epi32(a.Lo, b.Lo), _mm_add_epi32(a.Hi, b.Hi) }; }
+    Wide sub(Wide a, Wide b) { return { _mm_sub_epi32(a.Lo, b.Lo), _mm_sub_epi32(a.Hi, b.Hi) }; }
+
+    // x * c[even] + y * c[odd] for all eight lanes
+    Wide rotate(__m128i x, __m128i y, __m128i c)
+    {
+        return { _mm_madd_epi16(_mm_unpacklo_epi16(x, y), c), _mm_madd_epi16(_mm_unpackhi_epi16(x, y), c) };
+    }
+
+    // x << 12, widened to 32 bits
+    Wide widen(__m128i x)
+    {
+        return { _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x), 4),
+                 _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x), 4) };
+    }
+
+    void butterfly(__m128i& out0, __m128i& out1, Wide a, Wide b, __m128i bias, int shift)
+    {
+        Wide biased = { _mm_add_epi32(a.Lo, bias), _mm_add_epi32(a.Hi, bias) };
+        Wide sum = add(biased, b);
+        Wide difference = sub(biased, b);
+        out0 = _mm_packs_epi32(_mm_srai_epi32(sum.Lo, shift), _mm_srai_epi32(sum.Hi, shift));
+        out1 = _mm_packs_epi32(_mm_srai_epi32(difference.Lo, shift), _mm_srai_epi32(difference.Hi, shift));
+    }
+
+    //one 1D IDCT over all eight rows at once, the rotations fold the
+    //multiplies of STBI__IDCT_1D into pairs so they fit _mm_madd_epi16
+    void idctPass(__m128i row[8], __m128i bias, int shift)
+    {
+        const __m128i rot0_0 = dctConstant(f2f(0.5411961f), f2f(0.5411961f) + f2f(-1.847759065f));
+        const __m128i rot0_1 = dctConstant(f2f(0.5411961f) + f2f(0.765366865f), f2f(0.5411961f));
+        const __m128i rot1_0 = dctConstant(f2f(1.175875602f) + f2f(-0.899976223f), f2f(1.175875602f));
+        const __m128i rot1_1 = dctConstant(f2f(1.175875602f), f2f(1.175875602f) + f2f(-2.562915447f));
+        const __m128i rot2_0 = dctConstant(f2f(-1.961570560f) + f2f(0.298631336f), f2f(-1.961570560f));
+        const __m128i rot2_1 = dctConstant(f2f(-1.961570560f), f2f(-1.961570560f) + f2f(3.072711026f));
+        const __m128i rot3_0 = dctConstant(f2f(-0.390180644f) + f2f(2.053119869f), f2f(-0.390180644f));
+        const __m128i rot3_1 = dctConstant(f2f(-0.390180644f), f2f(-0.390180644f) + f2f(1.501321110f));
+
+        //even part
+        Wide t2e = rotate(row[2], row[6], rot0_0);
+        Wide t3e = rotate(row[2], row[6], rot0_1);
+        Wide t0e = widen(_mm_add_epi16(row[0], row[4]));
+        Wide t1e = widen(_mm_sub_epi16(row[0], row[4]));
+        Wide x0 = add(t0e, t3e);
+        Wide x3 = sub(t0e, t3e);
+        Wide x1 = add(t1e, t2e);
+        Wide x2 = sub(t1e, t2e);
+        //odd part
+        Wide y0o = rotate(row[7], row[3], rot2_0);
+        Wide y2o = rotate(row[7], row[3], rot2_1);
+        Wide y1o = rotate(row[5], row[1], rot3_0);
+        Wide y3o = rotate(row[5], row[1], rot3_1);
+        __m128i sum17 = _mm_add_epi16(row[1], row[7]);
+        __m128i sum35 = _mm_add_epi16(row[3], row[5]);
+        Wide y4o = rotate(sum17, sum35, rot1_0);
+        Wide y5o = rotate(sum17, sum35, rot1_1);
+        Wide x4 = add(y0o, y4o);
+        Wide x5 = add(y1o, y5o);
+        Wide x6 = add(y2o, y5o);
+        Wide x7 = add(y3o, y4o);
+
+        butterfly(row[0], row[7], x0, x7, bias, shift);
+        butterfly(row[1], row[6], x1, x6, bias, shift);
+        butterfly(row[2], row[5], x2, x5, bias, shift);
+        butterfly(row[3], row[4], x3, x4, bias, shift);
+    }
+
+    void interleave16(__m128i& a, __m128i& b)
+    {
+        __m128i t = a;
+        a = _mm_unpacklo_epi16(a, b);
+        b = _mm_unpackhi_epi16(t, b);
+    }
+
+    void interleave8(__m128i& a, __m128i& b)
+    {
+        __m128i t = a;
+        a = _mm_unpacklo_epi8(a, b);
+        b = _mm_unpackhi_epi8(t, b);
+    }
+}
+
+namespace Graphics
+{
+    void JpegSimd::Idct8x8(u8* out, int outStride, short data[64], unsigned short* dequantize)
+    {
+        __m128i row[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            __m128i coefficients = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 8));
+            __m128i quantizer = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dequantize + i * 8));
+            row[i] = _mm_mullo_epi16(coefficients, quantizer);
+        }
+
+        //columns, keeping 2 extra bits like the scalar code
+        idctPass(row, _mm_set1_epi32(512), 10);
+
+        //8x8 transpose of 16 bit values
+        interleave16(row[0], row[4]);
+        interleave16(row[1], row[5]);
+        interleave16(row[2], row[6]);
+        interleave16(row[3], row[7]);
+        interleave16(row[0], row[2]);
+        interleave16(row[1], row[3]);
+        interleave16(row[4], row[6]);
+        interleave16(row[5], row[7]);
+        interleave16(row[0], row[1]);
+        interleave16(row[2], row[3]);
+        interleave16(row[4], row[5]);
+        interleave16(row[6], row[7]);
+
+        //rows, rounding and moving -128..127 to 0..255
+        idctPass(row, _mm_set1_epi32(65536 + (128 << 17)), 17);
+
+        //saturate to 8 bits and transpose back
+        __m128i p0 = _mm_packus_epi16(row[0], row[1]);
+        __m128i p1 = _mm_packus_epi16(row[2], row[3]);
+        __m128i p2 = _mm_packus_epi16(row[4], row[5]);
+        __m128i p3 = _mm_packus_epi16(row[6], row[7]);
+        interleave8(p0, p2);
+        interleave8(p1, p3);
+        interleave8(p0, p1);
+        interleave8(p2, p3);
+        interleave8(p0, p2);
+        interleave8(p1, p3);
+
+        __m128i const rows[4] = { p0, p2, p1, p3 };
+        for (int i = 0; i < 4; ++i)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), rows[i]);
+            out += outStride;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi32(rows[i], 0x4e));
+            out += outStride;
+        }
+    }
+
+    void JpegSimd::YCbCrToRgbRow(u8* out, u8 const* y, u8 const* cb, u8 const* cr, int count, int step)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi16(128);
+        //cr * 1.402 = (2 * cr) * 32767 + cr * rest
+        const int crToRHi = 32767;
+        const int crToRLo = c_crToR - 2 * crToRHi;
+        //cb * 1.772 = (4 * cb) * (c >> 2) + cb * rest
+        const int cbToBHi = c_cbToB >> 2;
+        const int cbToBLo = c_cbToB - 4 * cbToBHi;
+        alignas(16) u8 rgb[3][16];
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(y + i)), zero);
+            __m128i cb16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(cb + i)), zero), bias);
+            __m128i cr16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(cr + i)), zero), bias);
+            __m128i cr2 = _mm_slli_epi16(cr16, 1);
+            __m128i cb4 = _mm_slli_epi16(cb16, 2);
+            __m128i yLo = _mm_unpacklo_epi16(y16, zero);
+            __m128i yHi = _mm_unpackhi_epi16(y16, zero);
+
+            __m128i channels[3];
+            for (int half = 0; half < 2; ++half)
+            {
+                //pairs of the low or high four pixels
+                auto pick = [half](__m128i v) { return half ? _mm_unpackhi_epi64(v, v) : v; };
+                __m128i yHalf = half ? yHi : yLo;
+                __m128i r = finishChannel(yHalf, multiplyPair(pick(cr2), pick(cr16), crToRHi, crToRLo));
+                __m128i g = finishChannel(yHalf, multiplyPair(pick(cr2), pick(cb16), -c_crToG / 2, -c_cbToG));
+                __m128i b = finishChannel(yHalf, multiplyPair(pick(cb4), pick(cb16), cbToBHi, cbToBLo));
+                if (half == 0)
+                {
+                    channels[0] = r;
+                    channels[1] = g;
+                    channels[2] = b;
+                }
+                else
+                {
+                    channels[0] = _mm_packs_epi32(channels[0], r);
+                    channels[1] = _mm_packs_epi32(channels[1], g);
+                    channels[2] = _mm_packs_epi32(channels[2], b);
+                }
+            }
+            for (int c = 0; c < 3; ++c)
+                _mm_store_si128(reinterpret_cast<__m128i*>(rgb[c]), _mm_packus_epi16(channels[c], zero));
+
+            for (int p = 0; p < 8; ++p)
+            {
+                out[0] = rgb[0][p];
+                out[1] = rgb[1][p];
+                out[2] = rgb[2][p];
+                if (step == 4)
+                    out[3] = 255;
+                out += step;
+            }
+        }
+
+        //the rest of the row as the scalar code does it
+        for (; i < count; ++i)
+        {
+            int yFixed = (y[i] << 16) + 32768;
+            int crValue = cr[i] - 128;
+            int cbValue = cb[i] - 128;
+            int r = (yFixed + crValue * c_crToR) >> 16;
+            int g = (yFixed - crValue * c_crToG - cbValue * c_cbToG) >> 16;
+            int b = (yFixed + cbValue * c_cbToB) >> 16;
+            out[0] = static_cast<u8>(std::min(std::max(r, 0), 255));
+            out[1] = static_cast<u8>(std::min(std::max(g, 0), 255));
+            out[2] = static_cast<u8>(std::min(std::max(b, 0), 255));
+            if (step == 4)
+                out[3] = 255;
+            out += step;
+        }
+    }
+}
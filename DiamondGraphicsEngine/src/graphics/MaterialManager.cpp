@@ -5,9 +5,16 @@
 #include "graphics/GraphicsEngine.h"
 #include "graphics/TextureManager.h"
 #include "graphics/Texture.h"
+#include "graphics/ShaderProgram.h"
 
 namespace Graphics
 {
+    MaterialManager::~MaterialManager()
+    {
+        if (m_tableBuffer != 0)
+            glDeleteBuffers(1, &m_tableBuffer);
+    }
+
     void MaterialManager::LoadMaterials(std::string const& fileName, std::shared_ptr<GraphicsEngine> g)
     {
         std::stringstream strstr;
@@ -111,6 +118,7 @@ namespace Graphics
     std::shared_ptr<Material> MaterialManager::AddMaterial(std::shared_ptr<Material> material)
     {
         m_materials[material->GetMaterialName()] = material;
+        m_tableDirty = true;
         return material;
     }
 
@@ -137,9 +145,79 @@ namespace Graphics
         return materials;
     }
 
+    void MaterialManager::SetMaterialTableEnabled(bool enabled, TextureManager& textureManager)
+    {
+        m_tableEnabled = enabled;
+        m_tableDirty = true;
+        textureManager.SetTextureArraysEnabled(enabled);
+        if (!enabled)
+        {
+            for (auto& i : m_materials)
+            {
+                i.second->m_tableIndex = -1;
+            }
+            m_table.Clear();
+            m_tableBytes.clear();
+        }
+    }
+
+    void MaterialManager::UpdateMaterialTable(TextureManager& textureManager)
+    {
+        if (!m_tableEnabled)
+            return;
+        textureManager.UpdateTextureArrays();
+
+        //colors change in the editor, textures get layers as they load and stream
+        bool dirty = m_tableDirty || textureManager.GetTextureArrayVersion() != m_tableArrayVersion;
+        for (auto const& i : m_materials)
+        {
+            dirty = dirty || i.second->GetVersion() != i.second->m_tableVersion;
+        }
+        if (!dirty)
+            return;
+
+        m_table.Clear();
+        for (auto& i : m_materials)
+        {
+            MaterialRecord record;
+            if (i.second->FillTableRecord(record, textureManager))
+                i.second->m_tableIndex = static_cast<s32>(m_table.Add(record));
+            else
+                i.second->m_tableIndex = -1;
+            i.second->m_tableVersion = i.second->GetVersion();
+        }
+        //read after filling, textures placed for these records are in them
+        m_tableArrayVersion = textureManager.GetTextureArrayVersion();
+        m_tableDirty = false;
+        if (!m_table.Pack(m_tableBytes) || m_tableBytes.empty())
+            return;
+
+        if (m_tableBuffer == 0)
+            glGenBuffers(1, &m_tableBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tableBuffer);
+        if (m_tableBytes.size() > m_tableBufferBytes)
+        {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, m_tableBytes.size(), m_tableBytes.data(), GL_DYNAMIC_DRAW);
+            m_tableBufferBytes = m_tableBytes.size();
+        }
+        else
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_tableBytes.size(), m_tableBytes.data());
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void MaterialManager::BindMaterialTable(std::shared_ptr<ShaderProgram> const& program, TextureManager const& textureManager) const
+    {
+        if (m_tableBuffer != 0)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MaterialTableBinding, m_tableBuffer);
+        textureManager.BindTextureArrays(program);
+    }
+
     void MaterialManager::emplaceMaterial(std::string const& matName, std::shared_ptr<Material> material)
     {
         material->SetMaterialName(matName);
         m_materials.emplace(matName, material);
+        m_tableDirty = true;
     }
 }
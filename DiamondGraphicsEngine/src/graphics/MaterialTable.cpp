@@ -0,0 +1,271 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/MaterialTable.h"
+
+namespace
+{
+    //std430 offsets of the MaterialRecord fields, see MaterialTable.glsl
+    const size_t c_ambientOffset = 0;
+    const size_t c_diffuseOffset = 16;
+    const size_t c_emissiveOffset = 32;
+    const size_t c_specularOffset = 48;
+    const size_t c_exponentOffset = 64;
+    const size_t c_flagsOffset = 68;
+    const size_t c_diffuseTextureOffset = 72;
+    const size_t c_specularTextureOffset = 80;
+    const size_t c_normalMapTextureOffset = 88;
+    const size_t c_recordSize = 96;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    void write(u8* bytes, size_t offset, void const* value, size_t size)
+    {
+        std::memcpy(bytes + offset, value, size);
+    }
+
+    void read(u8 const* bytes, size_t offset, void* value, size_t size)
+    {
+        std::memcpy(value, bytes + offset, size);
+    }
+}
+
+namespace Graphics
+{
+    TextureLayerAllocator::TextureLayerAllocator(u32 layersPerArray, u32 maxArrays)
+        : m_layersPerArray(layersPerArray), m_maxArrays(maxArrays)
+    {
+        Assert(layersPerArray <= 0x10000, "Material records hold layers in 16 bits.");
+    }
+
+    TextureLayer TextureLayerAllocator::Allocate(TextureArrayKey const& key)
+    {
+        //an array of this size with room, else an empty one, else a new one
+        s32 found = -1;
+        for (u32 i = 0; i < m_arrays.size() && found < 0; ++i)
+        {
+            if (m_arrays[i].Key == key && m_arrays[i].Count > 0 && m_arrays[i].Count < m_layersPerArray)
+                found = static_cast<s32>(i);
+        }
+        for (u32 i = 0; i < m_arrays.size() && found < 0; ++i)
+        {
+            if (m_arrays[i].Count == 0)
+            {
+                if (m_arrays[i].Key != key)
+                {
+                    m_arrays[i].Key = key;
+                    ++m_arrays[i].Generation;
+                }
+                found = static_cast<s32>(i);
+            }
+        }
+        if (found < 0 && m_arrays.size() < m_maxArrays)
+        {
+            Array array;
+            array.Key = key;
+            array.Used.assign(m_layersPerArray, false);
+            m_arrays.push_back(array);
+            found = static_cast<s32>(m_arrays.size() - 1);
+        }
+        if (found < 0)
+            return TextureLayer();
+
+        Array& array = m_arrays[found];
+        TextureLayer layer;
+        layer.Array = found;
+        while (array.Used[layer.Layer])
+            ++layer.Layer;
+        array.Used[layer.Layer] = true;
+        ++array.Count;
+        return layer;
+    }
+
+    void TextureLayerAllocator::Free(TextureLayer layer)
+    {
+        if (!layer.IsValid() || static_cast<u32>(layer.Array) >= m_arrays.size())
+            return;
+        Array& array = m_arrays[layer.Array];
+        Assert(array.Used[layer.Layer], "Freeing layer %u of texture array %d twice.", layer.Layer, layer.Array);
+        array.Used[layer.Layer] = false;
+        --array.Count;
+    }
+
+    void TextureLayerAllocator::Clear()
+    {
+        m_arrays.clear();
+    }
+
+    u32 TextureLayerAllocator::GetUsedLayers(u32 array) const
+    {
+        std::vector<bool> const& used = m_arrays[array].Used;
+        u32 count = static_cast<u32>(used.size());
+        while (count > 0 && !used[count - 1])
+            --count;
+        return count;
+    }
+
+    void MaterialRecord::SetTexture(u32 reference[2], TextureLayer layer)
+    {
+        reference[0] = layer.IsValid() ? static_cast<u32>(layer.Array) : 0;
+        reference[1] = layer.IsValid() ? layer.Layer | layer.MinLevel << 16 : 0;
+    }
+
+    u32 MaterialTable::Add(MaterialRecord const& record)
+    {
+        m_records.push_back(record);
+        return static_cast<u32>(m_records.size() - 1);
+    }
+
+    bool MaterialTable::Pack(std::vector<u8>& bytes) const
+    {
+        std::vector<u8> packed(m_records.size() * c_recordSize, 0);
+        for (size_t i = 0; i < m_records.size(); ++i)
+        {
+            MaterialRecord const& record = m_records[i];
+            u8* out = packed.data() + i * c_recordSize;
+            write(out, c_ambientOffset, record.AmbientColor.ToFloats(), 16);
+            write(out, c_diffuseOffset, record.DiffuseColor.ToFloats(), 16);
+            write(out, c_emissiveOffset, record.EmissiveColor.ToFloats(), 16);
+            write(out, c_specularOffset, record.SpecularColor.ToFloats(), 16);
+            write(out, c_exponentOffset, &record.SpecularExponent, 4);
+            write(out, c_flagsOffset, &record.Flags, 4);
+            write(out, c_diffuseTextureOffset, record.DiffuseTexture, 8);
+            write(out, c_specularTextureOffset, record.SpecularTexture, 8);
+            write(out, c_normalMapTextureOffset, record.NormalMapTexture, 8);
+        }
+        if (packed == bytes)
+            return false;
+        bytes.swap(packed);
+        return true;
+    }
+
+    MaterialRecord MaterialTable::Unpack(u8 const* bytes)
+    {
+        MaterialRecord record;
+        read(bytes, c_ambientOffset, record.AmbientColor.ToFloats(), 16);
+        read(bytes, c_diffuseOffset, record.DiffuseColor.ToFloats(), 16);
+        read(bytes, c_emissiveOffset, record.EmissiveColor.ToFloats(), 16);
+        read(bytes, c_specularOffset, record.SpecularColor.ToFloats(), 16);
+        read(bytes, c_exponentOffset, &record.SpecularExponent, 4);
+        read(bytes, c_flagsOffset, &record.Flags, 4);
+        read(bytes, c_diffuseTextureOffset, record.DiffuseTexture, 8);
+        read(bytes, c_specularTextureOffset, record.SpecularTexture, 8);
+        read(bytes, c_normalMapTextureOffset, record.NormalMapTexture, 8);
+        return record;
+    }
+
+    MaterialTable::Benchmark MaterialTable::MeasureBinding(u32 materialCount, u32 drawCount, u32 seed)
+    {
+        struct SimulatedMaterial
+        {
+            //texture index per slot, -1 if the slot is off
+            s32 Textures[3] = { -1, -1, -1 };
+            s32 TableIndex = -1;
+        };
+        //texture units TextureManager::UnbindAll clears after every draw
+        const u32 unboundSlots = 3;
+
+        Benchmark result;
+        result.Materials = materialCount;
+        result.Draws = drawCount;
+        std::mt19937 random(seed);
+
+        //two textures per material on average, of five sizes and two formats
+        result.Textures = materialCount * 2;
+        std::vector<TextureArrayKey> keys(result.Textures);
+        for (TextureArrayKey& key : keys)
+        {
+            u32 size = 128u << (random() % 5);
+            key.Width = size;
+            key.Height = size;
+            key.Levels = 0;
+            for (u32 s = size; s > 0; s /= 2)
+                ++key.Levels;
+            key.Format = random() % 2;
+        }
+
+        TextureLayerAllocator allocator;
+        std::vector<TextureLayer> layers(result.Textures);
+        for (u32 t = 0; t < result.Textures; ++t)
+        {
+            layers[t] = allocator.Allocate(keys[t]);
+            if (!layers[t].IsValid())
+                ++result.TexturesLeftOut;
+        }
+        for (u32 a = 0; a < allocator.GetArrayCount(); ++a)
+        {
+            if (allocator.GetLayerCount(a) > 0)
+                ++result.ArraysUsed;
+        }
+        //no two textures on one layer, and every texture in an array of its size
+        std::set<std::pair<s32, u32> > taken;
+        for (u32 t = 0; t < result.Textures; ++t)
+        {
+            if (!layers[t].IsValid())
+                continue;
+            if (!taken.insert(std::make_pair(layers[t].Array, layers[t].Layer)).second
+                || allocator.GetKey(layers[t].Array) != keys[t]
+                || layers[t].Layer >= allocator.GetUsedLayers(layers[t].Array))
+                result.Consistent = false;
+        }
+
+        std::vector<SimulatedMaterial> materials(materialCount);
+        MaterialTable table;
+        for (SimulatedMaterial& material : materials)
+        {
+            MaterialRecord record;
+            record.DiffuseColor = Color(random() % 256 / 255.0f, random() % 256 / 255.0f, random() % 256 / 255.0f);
+            record.SpecularExponent = static_cast<f32>(1 + random() % 100);
+            record.Flags = MaterialReceiveLight;
+            bool inArrays = true;
+            for (u32 slot = 0; slot < 3; ++slot)
+            {
+                //diffuse nearly always, specular and normal maps half the time
+                if (random() % 4 < (slot == 0 ? 3u : 2u))
+                {
+                    s32 texture = static_cast<s32>(random() % result.Textures);
+                    material.Textures[slot] = texture;
+                    inArrays = inArrays && layers[texture].IsValid();
+                    record.Flags |= MaterialDiffuseTexture << slot;
+                }
+            }
+            MaterialRecord::SetTexture(record.DiffuseTexture, material.Textures[0] < 0 ? TextureLayer() : layers[material.Textures[0]]);
+            MaterialRecord::SetTexture(record.SpecularTexture, material.Textures[1] < 0 ? TextureLayer() : layers[material.Textures[1]]);
+            MaterialRecord::SetTexture(record.NormalMapTexture, material.Textures[2] < 0 ? TextureLayer() : layers[material.Textures[2]]);
+            if (inArrays)
+                material.TableIndex = static_cast<s32>(table.Add(record));
+        }
+        result.TableBytes = table.GetCount() * static_cast<u32>(c_recordSize);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<u8> bytes;
+        table.Pack(bytes);
+        result.PackMilliseconds = elapsedMilliseconds(start);
+        for (u32 i = 0; i < table.GetCount(); ++i)
+        {
+            MaterialRecord const& record = table.Get(i);
+            MaterialRecord unpacked = Unpack(bytes.data() + i * c_recordSize);
+            if (std::memcmp(&record, &unpacked, sizeof(MaterialRecord)) != 0)
+                result.Consistent = false;
+        }
+        if (table.Pack(bytes))
+            result.Consistent = false; //nothing changed, nothing to upload
+
+        //the table binds every array once, materials left out still bind per draw
+        result.BindsWithTable = result.ArraysUsed;
+        for (u32 d = 0; d < drawCount; ++d)
+        {
+            SimulatedMaterial const& material = materials[random() % materialCount];
+            u32 binds = unboundSlots;
+            for (s32 texture : material.Textures)
+                binds += texture >= 0 ? 1 : 0;
+            result.BindsWithoutTable += binds;
+            if (material.TableIndex < 0)
+                result.BindsWithTable += binds - unboundSlots;
+        }
+        return result;
+    }
+}
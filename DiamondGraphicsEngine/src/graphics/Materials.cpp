@@ -6,6 +6,7 @@
 #include "graphics/ShaderManager.h"
 #include "graphics/TextureManager.h"
 #include "graphics/Texture.h"
+#include "graphics/MaterialManager.h"
 
 std::vector<std::shared_ptr<Graphics::Texture> > Graphics::Material::EditorWrapper::textures;
 
@@ -23,6 +24,14 @@ namespace Graphics
     void Material::SetShaderParameters(std::shared_ptr<ShaderProgram> shader, Graphics::GraphicsEngine* g)
     {
         std::shared_ptr<ShaderManager> shaderManager = g->GetShaderManager();
+
+        if (g->GetMaterialManager()->IsMaterialTableEnabled())
+        {
+            //parameters and textures are in the material table, bound once per pass
+            shader->SetUniform("MaterialIndex", m_tableIndex);
+            if (m_tableIndex >= 0)
+                return;
+        }
         
         shader->SetUniform("Material.ReceiveLight", m_ifReceiveLight);
 
@@ -138,17 +147,65 @@ namespace Graphics
 
     }
 
+    void Material::RequestTextureDetail(TextureManager& textureManager, float uvPerPixel) const
+    {
+        if (m_isDiffuseTextureEnabled)
+            textureManager.RequestTextureDetail(m_diffuseTexture.second, uvPerPixel);
+        if (m_isSpecularTextureEnabled)
+            textureManager.RequestTextureDetail(m_specularTexture.second, uvPerPixel);
+        if (m_isNormalMapTextureEnabled)
+            textureManager.RequestTextureDetail(m_normalMapTexture.second, uvPerPixel);
+    }
+
+    bool Material::FillTableRecord(MaterialRecord& record, TextureManager& textureManager) const
+    {
+        record = MaterialRecord();
+        record.Flags = m_ifReceiveLight ? MaterialReceiveLight : 0;
+        //parameters the illumination model does not use stay black
+        switch (m_illumModel)
+        {
+        case 2://Specular Highlight on
+            record.SpecularColor = m_specularColor;
+            record.SpecularExponent = m_specularExponent;
+            // fall through
+        case 1://Color on and Ambient on
+            record.AmbientColor = m_ambientColor;
+            // fall through
+        case 0://Color on and Ambient off
+            record.DiffuseColor = m_diffuseColor;
+            record.EmissiveColor = m_emissiveColor;
+            break;
+        default:
+            break;
+        }
+
+        std::pair<TextureType, std::shared_ptr<Texture> > const* textures[] = { &m_diffuseTexture, &m_specularTexture, &m_normalMapTexture };
+        bool const enabled[] = { m_isDiffuseTextureEnabled, m_isSpecularTextureEnabled, m_isNormalMapTextureEnabled };
+        u32* references[] = { record.DiffuseTexture, record.SpecularTexture, record.NormalMapTexture };
+        for (u32 i = 0; i < 3; ++i)
+        {
+            if (!enabled[i] || textures[i]->second == nullptr)
+                continue;
+            TextureLayer layer = textureManager.GetTextureLayer(textures[i]->second);
+            if (!layer.IsValid())
+                return false;
+            MaterialRecord::SetTexture(references[i], layer);
+            record.Flags |= MaterialDiffuseTexture << i;
+        }
+        return true;
+    }
+
     void Material::Reflect(TwBar* editor, std::string const& groupName, GraphicsEngine* g)
     {
         std::string defStr = "group='" + groupName + "'";
         TwAddVarRO(editor, nullptr, TW_TYPE_STDSTRING, &m_materialName, (defStr+ " label='Material Name'").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_BOOLCPP, &m_ifReceiveLight, (defStr + " label='Receive Light'").c_str());
+        TwAddVarCB(editor, nullptr, TW_TYPE_BOOLCPP, EditorWrapper::SetFieldCB<bool, &Material::m_ifReceiveLight>, EditorWrapper::GetFieldCB<bool, &Material::m_ifReceiveLight>, this, (defStr + " label='Receive Light'").c_str());
         TwAddVarRW(editor, nullptr, TW_TYPE_FLOAT, &m_opacity, (defStr + " label='Opacity' step=0.01 min=0 max=1").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_COLOR3F, &m_ambientColor, (defStr+ " label='Ambient Color'").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_COLOR3F, &m_diffuseColor, (defStr+ " label='Diffuse Color'").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_COLOR3F, &m_specularColor, (defStr+ " label='Specular Color'").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_COLOR3F, &m_emissiveColor, (defStr+ " label='Emissive Color'").c_str());
-        TwAddVarRW(editor, nullptr, TW_TYPE_FLOAT, &m_specularExponent, (defStr+ " label='Speuclar Exponent' step=0.01").c_str());        
+        TwAddVarCB(editor, nullptr, TW_TYPE_COLOR3F, EditorWrapper::SetColorCB<&Material::m_ambientColor>, EditorWrapper::GetColorCB<&Material::m_ambientColor>, this, (defStr+ " label='Ambient Color'").c_str());
+        TwAddVarCB(editor, nullptr, TW_TYPE_COLOR3F, EditorWrapper::SetColorCB<&Material::m_diffuseColor>, EditorWrapper::GetColorCB<&Material::m_diffuseColor>, this, (defStr+ " label='Diffuse Color'").c_str());
+        TwAddVarCB(editor, nullptr, TW_TYPE_COLOR3F, EditorWrapper::SetColorCB<&Material::m_specularColor>, EditorWrapper::GetColorCB<&Material::m_specularColor>, this, (defStr+ " label='Specular Color'").c_str());
+        TwAddVarCB(editor, nullptr, TW_TYPE_COLOR3F, EditorWrapper::SetColorCB<&Material::m_emissiveColor>, EditorWrapper::GetColorCB<&Material::m_emissiveColor>, this, (defStr+ " label='Emissive Color'").c_str());
+        TwAddVarCB(editor, nullptr, TW_TYPE_FLOAT, EditorWrapper::SetFieldCB<f32, &Material::m_specularExponent>, EditorWrapper::GetFieldCB<f32, &Material::m_specularExponent>, this, (defStr+ " label='Speuclar Exponent' step=0.01").c_str());        
         {//Illumination model enum
             std::string enumStr;
             enumStr = enumStr + "[0] " + "Color on and Ambient off,";
@@ -163,7 +220,7 @@ namespace Graphics
             enumStr = enumStr + "[9] " + "Transparency: Glass on; Reflection: Ray trace off,";
             enumStr = enumStr + "[10] " + "Casts shadows onto invisible surfaces,";
             TwType illumModelType = TwDefineEnumFromString(nullptr, enumStr.c_str());
-            TwAddVarRW(editor, nullptr, illumModelType, &m_illumModel, (defStr + " label='Illumination Model' ").c_str());
+            TwAddVarCB(editor, nullptr, illumModelType, EditorWrapper::SetFieldCB<int, &Material::m_illumModel>, EditorWrapper::GetFieldCB<int, &Material::m_illumModel>, this, (defStr + " label='Illumination Model' ").c_str());
         }
 
         {//Texture enum
@@ -193,15 +250,15 @@ namespace Graphics
             }
             TwAddSeparator(editor, nullptr, defStr.c_str());
             TwType textureNameTypes = TwDefineEnumFromString(nullptr, textureNames.c_str());
-            TwAddVarRW(editor, nullptr, TW_TYPE_BOOLCPP, &m_isDiffuseTextureEnabled, (defStr + " label='Diffuse Texture Enabled'").c_str());
+            TwAddVarCB(editor, nullptr, TW_TYPE_BOOLCPP, EditorWrapper::SetFieldCB<bool, &Material::m_isDiffuseTextureEnabled>, EditorWrapper::GetFieldCB<bool, &Material::m_isDiffuseTextureEnabled>, this, (defStr + " label='Diffuse Texture Enabled'").c_str());
             TwAddVarCB(editor, nullptr, textureNameTypes, EditorWrapper::SetDiffuseTextureCB, EditorWrapper::GetDiffuseTextureCB, this, (defStr + " label='Diffuse Texture'").c_str());
 
             TwAddSeparator(editor, nullptr, defStr.c_str());
-            TwAddVarRW(editor, nullptr, TW_TYPE_BOOLCPP, &m_isSpecularTextureEnabled, (defStr + " label='Specular Texture Enabled'").c_str());
+            TwAddVarCB(editor, nullptr, TW_TYPE_BOOLCPP, EditorWrapper::SetFieldCB<bool, &Material::m_isSpecularTextureEnabled>, EditorWrapper::GetFieldCB<bool, &Material::m_isSpecularTextureEnabled>, this, (defStr + " label='Specular Texture Enabled'").c_str());
             TwAddVarCB(editor, nullptr, textureNameTypes, EditorWrapper::SetSpecularTextureCB, EditorWrapper::GetSpecularTextureCB, this, (defStr + " label='Specular Texture'").c_str());
 
             TwAddSeparator(editor, nullptr, defStr.c_str());
-            TwAddVarRW(editor, nullptr, TW_TYPE_BOOLCPP, &m_isNormalMapTextureEnabled, (defStr + " label='Normal Map Enabled'").c_str());
+            TwAddVarCB(editor, nullptr, TW_TYPE_BOOLCPP, EditorWrapper::SetFieldCB<bool, &Material::m_isNormalMapTextureEnabled>, EditorWrapper::GetFieldCB<bool, &Material::m_isNormalMapTextureEnabled>, this, (defStr + " label='Normal Map Enabled'").c_str());
             TwAddVarCB(editor, nullptr, textureNameTypes, EditorWrapper::SetNormalmapTextureCB, EditorWrapper::GetNormalmapTextureCB, this, (defStr + " label='Normal Map Texture'").c_str());
         }
 
@@ -212,6 +269,7 @@ namespace Graphics
         m_diffuseTexture.first = type;
         m_diffuseTexture.second = texture;
         m_isDiffuseTextureEnabled = true;
+        ++m_version;
         return *this;
     }
 
@@ -220,6 +278,7 @@ namespace Graphics
         m_normalMapTexture.first = type;
         m_normalMapTexture.second = texture;
         m_isNormalMapTextureEnabled = true;
+        ++m_version;
         return *this;
     }
 
@@ -229,15 +288,23 @@ namespace Graphics
         return *this;
     }
 
+    Material& Material::SetRefractiveIndex(f32 index)
+    {
+        m_refractiveIndex = index;
+        return *this;
+    }
+
     Material& Material::SetIlluminationModel(int index)
     {
         m_illumModel = index;
+        ++m_version;
         return *this;
     }
 
     Material& Material::SetIfReceiveLight(bool receive)
     {
         m_ifReceiveLight = receive;
+        ++m_version;
         return *this;
     }
 
@@ -246,6 +313,7 @@ namespace Graphics
         m_normalMapTexture.first = type;
         m_specularTexture.second = texture;
         m_isSpecularTextureEnabled = true;
+        ++m_version;
         return *this;
     }
 
@@ -258,30 +326,35 @@ namespace Graphics
     Material& Material::SetAmbientColor(Color const& color)
     {
         m_ambientColor = color;
+        ++m_version;
         return *this;
     }
 
     Material& Material::SetDiffuseColor(Color const& color)
     {
         m_diffuseColor = color;
+        ++m_version;
         return *this;
     }
 
     Material& Material::SetSpecularColor(Color const& color)
     {
         m_specularColor = color;
+        ++m_version;
         return *this;
     }
 
     Material& Material::SetEmissiverColor(Color const& color)
     {
         m_emissiveColor = color;
+        ++m_version;
         return *this;
     }
 
     Material& Material::SetSpecularExponent(f32 pow)
     {
         m_specularExponent = pow;
+        ++m_version;
         return *this;
     }
 
@@ -301,6 +374,7 @@ namespace Graphics
         {
             mat->m_diffuseTexture.second.reset();
         }
+        ++mat->m_version;
     }
 
     void Material::EditorWrapper::GetDiffuseTextureCB(void* value, void* clientData)
@@ -323,6 +397,7 @@ namespace Graphics
         {
             mat->m_specularTexture.second.reset();
         }
+        ++mat->m_version;
     }
 
     void Material::EditorWrapper::GetSpecularTextureCB(void* value, void* clientData)
@@ -345,6 +420,7 @@ namespace Graphics
         {
             mat->m_normalMapTexture.second.reset();
         }
+        ++mat->m_version;
     }
 
     void Material::EditorWrapper::GetNormalmapTextureCB(void* value, void* clientData)
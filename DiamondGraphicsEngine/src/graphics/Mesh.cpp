@@ -1,5 +1,6 @@
 #include "Precompiled.h"
 #include "graphics/Mesh.h"
+#include "core/Ray.h"
 
 namespace Graphics
 {
@@ -15,6 +16,11 @@ namespace Graphics
         }
     }
 
+    bool Mesh::RayCast(Ray const& localRay, float* t)
+    {
+        return m_boudingSphere.CheckRayCollision(localRay, t);
+    }
+
     void Mesh::Reflect(TwBar* editor, std::string const& groupName, GraphicsEngine* )
     {
         std::string defStr = "group='" + groupName + "'";
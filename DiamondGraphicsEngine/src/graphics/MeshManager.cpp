@@ -1,5 +1,6 @@
 #include "Precompiled.h"
 #include "framework/Utilities.h"
+#include "framework/AssetLoader.h"
 #include "graphics/MeshManager.h"
 #include "graphics/TriangleMesh.h"
 #include "framework/Debug.h"
@@ -226,9 +227,7 @@ namespace Graphics
         mesh->m_vertices = vertices;
 
 
-        mesh->centerMesh();
-        mesh->normalizeVertices();
-        mesh->CalculateBoundingSphere();
+        mesh->preparePositions();
         mesh->CalcTanBitan();
         mesh->SetLabel(meshLabel);
         Assert(m_meshes.find(meshLabel) == m_meshes.end(), "Mesh with label \"%s\" already exists.", meshLabel.c_str());
@@ -241,20 +240,24 @@ namespace Graphics
     void MeshManager::TriangleMeshHandler::LoadAndBuildObjMeshMultiThread(
         const std::vector<std::tuple<std::string/*meshLabel*/, std::string/*objFile*/, DefaultUvType> >& meshList)
     {
-        size_t threadNum = meshList.size();
-        std::vector<std::thread> threads(threadNum);
-
-
-        for (size_t i = 0; i < threadNum; ++i)
+        //parse and preprocess on the loader threads, build on this thread once all are in
+        AssetLoader& loader = AssetLoader::GetShared();
+        std::vector<AssetLoadHandle> handles;
+        handles.reserve(meshList.size());
+        for (auto& i : meshList)
         {
-            threads[i] = std::thread(&TriangleMeshHandler::LoadObjMesh,this,
-                std::get<0>(meshList[i]), std::get<1>(meshList[i]), std::get<2>(meshList[i]));
-            
+            std::string meshLabel = std::get<0>(i);
+            std::string objFileName = std::get<1>(i);
+            DefaultUvType defaultUvType = std::get<2>(i);
+            handles.push_back(loader.Submit(meshLabel, [this, meshLabel, objFileName, defaultUvType]()
+            {
+                LoadObjMesh(meshLabel, objFileName, defaultUvType);
+            }, nullptr, AssetPriority::High));
         }
 
-        for (size_t i = 0; i < threadNum; ++i)
+        for (AssetLoadHandle const& handle : handles)
         {
-            threads[i].join();
+            handle.Wait();
         }
 
         for (auto& i : meshList)
@@ -0,0 +1,237 @@
+#include "Precompiled.h"
+#include "framework/AssetLoader.h"
+#include "framework/Debug.h"
+#include "framework/ParallelFor.h"
+#include "graphics/MipGenerator.h"
+
+#include <cmath>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+namespace
+{
+    //resolution of the linear to 8 bit tables, fine enough for the dark end of sRGB
+    const u32 c_encodeSteps = 8192;
+    //output rows filtered by one task
+    const u32 c_bandRows = 16;
+    //levels smaller than this are not worth starting threads for
+    const u32 c_parallelPixels = 128 * 128;
+    const u32 c_kaiserTaps = 6;
+
+    struct FilterTables
+    {
+        float SrgbToLinear[256];
+        float UnormToFloat[256];
+        u8 LinearToSrgb[c_encodeSteps];
+        u8 FloatToUnorm[c_encodeSteps];
+        float Kaiser[c_kaiserTaps];
+
+        FilterTables()
+        {
+            for (u32 i = 0; i < 256; ++i)
+            {
+                float c = i / 255.0f;
+                SrgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                UnormToFloat[i] = c;
+            }
+            for (u32 i = 0; i < c_encodeSteps; ++i)
+            {
+                float l = i / float(c_encodeSteps - 1);
+                float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                LinearToSrgb[i] = static_cast<u8>(s * 255.0f + 0.5f);
+                FloatToUnorm[i] = static_cast<u8>(l * 255.0f + 0.5f);
+            }
+
+            //sinc windowed by a Kaiser window (alpha 4, radius 1.5 destination pixels),
+            //sampled at the source pixel centers around a destination pixel
+            const float pi = 3.14159265358979f;
+            const float alpha = 4.0f;
+            const float radius = 1.5f;
+            auto besselI0 = [](float x)
+            {
+                float sum = 1.0f, term = 1.0f;
+                for (u32 k = 1; k < 20; ++k)
+                {
+                    term *= (x * 0.5f / k) * (x * 0.5f / k);
+                    sum += term;
+                }
+                return sum;
+            };
+            float total = 0.0f;
+            for (u32 k = 0; k < c_kaiserTaps; ++k)
+            {
+                float t = (k - 2.5f) * 0.5f;
+                float sinc = std::sin(pi * t) / (pi * t);
+                float window = besselI0(alpha * std::sqrt(1.0f - (t / radius) * (t / radius))) / besselI0(alpha);
+                Kaiser[k] = sinc * window;
+                total += Kaiser[k];
+            }
+            for (float& weight : Kaiser)
+                weight /= total;
+        }
+    };
+
+    FilterTables const& tables()
+    {
+        static FilterTables const filterTables;
+        return filterTables;
+    }
+
+    inline s32 wrap(s32 i, s32 n)
+    {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    //convert one row to linear floats
+    void decodeRow(u8 const* src, float* dst, u32 count, u8 channels, float const* const* decode)
+    {
+        for (u32 i = 0; i < count; i += channels)
+        {
+            for (u8 c = 0; c < channels; ++c)
+                dst[i + c] = decode[c][src[i + c]];
+        }
+    }
+
+    //clamp linear floats to [0, 1] and encode them to 8 bit
+    void encodeRow(float const* src, u8* dst, u32 count, u8 channels, u8 const* const* encode)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(float(c_encodeSteps - 1));
+        const __m128 half = _mm_set1_ps(0.5f);
+        alignas(16) s32 index[4];
+        u8 channel = 0;
+        u32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+            _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+            for (u32 lane = 0; lane < 4; ++lane)
+            {
+                dst[i + lane] = encode[channel][index[lane]];
+                channel = channel + 1 == channels ? 0 : channel + 1;
+            }
+        }
+        for (; i < count; ++i)
+        {
+            float v = src[i] < 0.0f ? 0.0f : (src[i] > 1.0f ? 1.0f : src[i]);
+            dst[i] = encode[channel][static_cast<s32>(v * (c_encodeSteps - 1) + 0.5f)];
+            channel = channel + 1 == channels ? 0 : channel + 1;
+        }
+    }
+}
+
+namespace Graphics
+{
+    u32 MipGenerator::GetLevelCount(u32 width, u32 height)
+    {
+        u32 levels = 1;
+        while (width > 1 || height > 1)
+        {
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+            ++levels;
+        }
+        return levels;
+    }
+
+    std::vector<MipLevel> MipGenerator::Generate(u8 const* pixels, u32 width, u32 height, u8 channels,
+                                                 MipFilter filter, bool srgb)
+    {
+        std::vector<MipLevel> levels;
+        levels.reserve(GetLevelCount(width, height) - 1);
+        while (width > 1 || height > 1)
+        {
+            levels.push_back(Downsample(pixels, width, height, channels, filter, srgb));
+            pixels = levels.back().Pixels.data();
+            width = levels.back().Width;
+            height = levels.back().Height;
+        }
+        return levels;
+    }
+
+    MipLevel MipGenerator::Downsample(u8 const* pixels, u32 width, u32 height, u8 channels,
+                                      MipFilter filter, bool srgb)
+    {
+        Assert(channels == 3 || channels == 4, "Mip generation needs RGB or RGBA pixels, got %d channels.", channels);
+        FilterTables const& table = tables();
+        float const* decode[4];
+        u8 const* encode[4];
+        for (u8 c = 0; c < 4; ++c)
+        {
+            bool color = srgb && c < 3;
+            decode[c] = color ? table.SrgbToLinear : table.UnormToFloat;
+            encode[c] = color ? table.LinearToSrgb : table.FloatToUnorm;
+        }
+
+        MipLevel level;
+        level.Width = width > 1 ? width / 2 : 1;
+        level.Height = height > 1 ? height / 2 : 1;
+        level.Pixels.resize(size_t(level.Width) * level.Height * channels);
+
+        //a box filter of 1 along an axis that is already 1 pixel wide
+        //averages the same pixel twice, which leaves it unchanged
+        const bool box = filter == MipFilter::Box;
+        const u32 taps = box ? 2 : c_kaiserTaps;
+        const s32 before = box ? 0 : 2;
+        const float boxWeights[2] = { 0.5f, 0.5f };
+        float const* weights = box ? boxWeights : table.Kaiser;
+
+        //one float of padding so a 4 wide load at the last RGB pixel stays inside
+        const u32 rowFloats = width * channels;
+        const u32 rowStride = (rowFloats + 1 + 3) & ~3u;
+        const u32 outFloats = level.Width * channels;
+        const u32 srcStride = width * channels;
+
+        auto filterBand = [&](u32 y0, u32 y1)
+        {
+            const u32 bandRows = 2 * (y1 - y0) + taps - 2;
+            std::vector<float> band(size_t(bandRows) * rowStride, 0.0f);
+            std::vector<float> vertical(rowStride, 0.0f);
+            std::vector<float> out(outFloats + 4, 0.0f);
+
+            const s32 firstRow = 2 * static_cast<s32>(y0) - before;
+            for (u32 r = 0; r < bandRows; ++r)
+            {
+                u32 srcRow = wrap(firstRow + static_cast<s32>(r), static_cast<s32>(height));
+                decodeRow(pixels + size_t(srcRow) * srcStride, &band[size_t(r) * rowStride], rowFloats, channels, decode);
+            }
+
+            for (u32 y = y0; y < y1; ++y)
+            {
+                //vertical pass over whole rows, four floats at a time
+                float const* base = &band[size_t(2 * (y - y0)) * rowStride];
+                for (u32 i = 0; i < rowStride; i += 4)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for (u32 k = 0; k < taps; ++k)
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(base + size_t(k) * rowStride + i)));
+                    _mm_storeu_ps(&vertical[i], sum);
+                }
+
+                //horizontal pass, one pixel (all channels) per register
+                for (u32 x = 0; x < level.Width; ++x)
+                {
+                    const s32 first = 2 * static_cast<s32>(x) - before;
+                    const bool inside = first >= 0 && first + static_cast<s32>(taps) <= static_cast<s32>(width);
+                    __m128 sum = _mm_setzero_ps();
+                    for (u32 k = 0; k < taps; ++k)
+                    {
+                        s32 sx = inside ? first + static_cast<s32>(k) : wrap(first + static_cast<s32>(k), static_cast<s32>(width));
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(&vertical[size_t(sx) * channels])));
+                    }
+                    //an RGB store spills one float into the next pixel, which overwrites it
+                    _mm_storeu_ps(&out[size_t(x) * channels], sum);
+                }
+                encodeRow(out.data(), &level.Pixels[size_t(y) * outFloats], outFloats, channels, encode);
+            }
+        };
+
+        //inside a load every loader worker is already busy with a texture of its own
+        bool singleThread = level.Width * level.Height < c_parallelPixels || AssetLoader::IsWorkerThread();
+        u32 maxThreads = singleThread ? 1 : 0;
+        ParallelFor(level.Height, c_bandRows, filterBand, maxThreads);
+        return level;
+    }
+}
@@ -0,0 +1,704 @@
+#include "Precompiled.h"
+#include "graphics/OcclusionCuller.h"
+#include "framework/Debug.h"
+#include "graphics/RenderDevice.h"
+#include "graphics/Texture.h"
+#include "graphics/TriangleMesh.h"
+#include "math/Quaternion.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+    using namespace Math;
+
+    const s32 c_tileWidth = 8;
+    const s32 c_tileHeight = 4;
+    const u32 c_fullCoverage = 0xffffffffu;
+    const s32 c_subpixelBits = 4;
+    const s32 c_subpixels = 1 << c_subpixelBits;
+    //x and y are clipped at this many times w, the edge functions stay in 32 bits up to c_maxSize
+    const float c_guardBand = 2.0f;
+    const u32 c_maxSize = 512;
+    const u32 c_setupChunk = 1024;
+    //the tile depth is pushed this much farther, so rounding never puts it in front of the triangle
+    const float c_depthSlack = 1.0f - 1e-5f;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    u32 workerThreads(u32 maxThreads)
+    {
+        if (maxThreads)
+            return maxThreads;
+        u32 cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+    //rounds towards negative infinity, unlike /
+    s32 floorDivide(s32 value, s32 divisor)
+    {
+        s32 quotient = value / divisor;
+        return quotient * divisor > value ? quotient - 1 : quotient;
+    }
+
+    //near and the four guard band planes, inside when >= 0; an occluder needs no far plane
+    const int c_clipPlaneCount = 5;
+    float clipDistance(Vector4 const& p, int plane)
+    {
+        switch (plane)
+        {
+        case 0: return p.z + p.w;
+        case 1: return p.x + c_guardBand * p.w;
+        case 2: return c_guardBand * p.w - p.x;
+        case 3: return p.y + c_guardBand * p.w;
+        default: return c_guardBand * p.w - p.y;
+        }
+    }
+
+    //Sutherland-Hodgman against every clip plane, count is the vertices left
+    u32 clipPolygon(Vector4* polygon, u32 count)
+    {
+        Vector4 clipped[3 + c_clipPlaneCount];
+        for (int plane = 0; plane < c_clipPlaneCount && count > 0; ++plane)
+        {
+            u32 kept = 0;
+            for (u32 i = 0; i < count; ++i)
+            {
+                Vector4 const& current = polygon[i];
+                Vector4 const& next = polygon[(i + 1) % count];
+                float currentDistance = clipDistance(current, plane);
+                float nextDistance = clipDistance(next, plane);
+                if (currentDistance >= 0.0f)
+                    clipped[kept++] = current;
+                if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+                    clipped[kept++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+            }
+            std::copy(clipped, clipped + kept, polygon);
+            count = kept;
+        }
+        return count;
+    }
+}
+
+namespace Graphics
+{
+    OcclusionCuller::OcclusionCuller(Settings const& settings)
+        : m_settings(settings)
+    {
+    }
+
+    OcclusionCuller::~OcclusionCuller()
+    {
+        Wait();
+        if (!m_frameThread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            m_stopping = true;
+        }
+        m_frameStart.notify_one();
+        m_frameThread.join();
+    }
+
+    void OcclusionCuller::BeginFrame(Math::Matrix4 const& viewProj, std::vector<Occluder> occluders)
+    {
+        Wait();
+        Assert(m_settings.Width % c_tileWidth == 0 && m_settings.Height % c_tileHeight == 0
+               && m_settings.Width <= c_maxSize && m_settings.Height <= c_maxSize,
+               "The occlusion buffer is made of 8x4 tiles, up to %ux%u, not %ux%u.", c_maxSize, c_maxSize,
+               m_settings.Width, m_settings.Height);
+        m_tilesX = m_settings.Width / c_tileWidth;
+        m_tilesY = m_settings.Height / c_tileHeight;
+        m_viewProj = viewProj;
+        m_occluders = std::move(occluders);
+        m_stats = FrameStats();
+        m_stats.Occluders = static_cast<u32>(m_occluders.size());
+        m_framePending = true;
+        if (!m_workers)
+        {
+            m_workers = std::make_unique<WorkerPool>(workerThreads(m_settings.MaxThreads));
+            m_frameThread = std::thread(&OcclusionCuller::frameLoop, this);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            m_frameRunning = true;
+        }
+        m_frameStart.notify_one();
+    }
+
+    void OcclusionCuller::Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_frameMutex);
+        if (!m_frameRunning)
+            return;
+        auto start = std::chrono::high_resolution_clock::now();
+        m_frameDone.wait(lock, [this]() { return !m_frameRunning; });
+        m_stats.WaitMilliseconds += elapsedMilliseconds(start);
+    }
+
+    void OcclusionCuller::frameLoop()
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_frameMutex);
+                m_frameStart.wait(lock, [this]() { return m_frameRunning || m_stopping; });
+                if (m_stopping)
+                    return;
+            }
+            rasterizeFrame();
+            {
+                std::lock_guard<std::mutex> lock(m_frameMutex);
+                m_frameRunning = false;
+            }
+            m_frameDone.notify_all();
+        }
+    }
+
+    void OcclusionCuller::rasterizeFrame()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        m_firstTriangles.resize(m_occluders.size());
+        u32 triangleCount = 0;
+        for (size_t i = 0; i < m_occluders.size(); ++i)
+        {
+            m_firstTriangles[i] = triangleCount;
+            triangleCount += m_occluders[i].Mesh ? static_cast<u32>(m_occluders[i].Mesh->GetPrimitiveCount()) : 0;
+        }
+        m_stats.OccluderTriangles = triangleCount;
+
+        u32 threads = m_workers->GetThreadCount();
+        m_chunkTriangles.resize((triangleCount + c_setupChunk - 1) / c_setupChunk);
+        m_workers->ParallelFor(triangleCount, c_setupChunk, [this](u32 begin, u32 end)
+        {
+            setupTriangles(begin / c_setupChunk, begin, end);
+        });
+        for (std::vector<SetupTriangle> const& triangles : m_chunkTriangles)
+        {
+            m_stats.TrianglesRasterized += static_cast<u32>(triangles.size());
+        }
+
+        u32 tileCount = m_tilesX * m_tilesY;
+        m_reference.assign(tileCount, 0.0f);
+        m_working.assign(tileCount, 0.0f);
+        m_masks.assign(tileCount, 0);
+        //a band of tile rows per thread, every band sees the triangles in the same order
+        u32 bandRows = (m_tilesY + threads - 1) / threads;
+        m_workers->ParallelFor(m_tilesY, bandRows, [this](u32 begin, u32 end)
+        {
+            rasterizeBand(begin, end);
+        });
+        m_stats.RasterMilliseconds = elapsedMilliseconds(start);
+    }
+
+    void OcclusionCuller::setupTriangles(u32 chunk, u32 begin, u32 end)
+    {
+        m_chunkTriangles[chunk].clear();
+        auto occluder = std::upper_bound(m_firstTriangles.begin(), m_firstTriangles.end(), begin) - 1;
+        Matrix4 worldViewProj;
+        size_t worldViewProjOf = m_occluders.size();
+        for (u32 i = begin; i < end; ++i)
+        {
+            while (occluder + 1 != m_firstTriangles.end() && i >= *(occluder + 1))
+                ++occluder;
+            size_t index = occluder - m_firstTriangles.begin();
+            TriangleMesh const& mesh = *m_occluders[index].Mesh;
+            if (worldViewProjOf != index)
+            {
+                worldViewProj = m_viewProj * m_occluders[index].World;
+                worldViewProjOf = index;
+            }
+            TriangleMesh::TriangleFace const& face = mesh.GetTriangle(i - *occluder);
+            Vector4 clip[3];
+            bool needsClipping = false;
+            bool outside[c_clipPlaneCount] = { true, true, true, true, true };
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                Vector3 const& position = mesh.GetVertex(face.indices[corner]).position;
+                clip[corner] = Math::Transform(worldViewProj, Vector4(position.x, position.y, position.z, 1.0f));
+                for (int plane = 0; plane < c_clipPlaneCount; ++plane)
+                {
+                    //also catches NaN
+                    bool inside = clipDistance(clip[corner], plane) >= 0.0f;
+                    needsClipping |= !inside;
+                    outside[plane] &= !inside;
+                }
+            }
+            if (outside[0] || outside[1] || outside[2] || outside[3] || outside[4])
+                continue;
+            if (!needsClipping)
+            {
+                addTriangle(chunk, clip);
+                continue;
+            }
+            Vector4 polygon[3 + c_clipPlaneCount] = { clip[0], clip[1], clip[2] };
+            u32 count = clipPolygon(polygon, 3);
+            for (u32 fan = 1; fan + 1 < count; ++fan)
+            {
+                Vector4 fanClip[3] = { polygon[0], polygon[fan], polygon[fan + 1] };
+                addTriangle(chunk, fanClip);
+            }
+        }
+    }
+
+    void OcclusionCuller::addTriangle(u32 chunk, Vector4 const* clip)
+    {
+        SetupTriangle triangle;
+        s32 x[3];
+        s32 y[3];
+        float inverseW[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            //the near plane leaves w positive, unless the matrices were degenerate
+            if (!(clip[i].w > 0.0f))
+                return;
+            inverseW[i] = 1.0f / clip[i].w;
+            //row 0 is the top, as in the rasterizers
+            float screenX = (clip[i].x * inverseW[i] * 0.5f + 0.5f) * m_settings.Width;
+            float screenY = (0.5f - clip[i].y * inverseW[i] * 0.5f) * m_settings.Height;
+            x[i] = static_cast<s32>(Floor(screenX * c_subpixels + 0.5f));
+            y[i] = static_cast<s32>(Floor(screenY * c_subpixels + 0.5f));
+        }
+        //pixels whose centers are in the bounding box
+        const s32 half = c_subpixels / 2;
+        s32 minX = Max(floorDivide(Min(Min(x[0], x[1]), x[2]) - half + c_subpixels - 1, c_subpixels), 0);
+        s32 minY = Max(floorDivide(Min(Min(y[0], y[1]), y[2]) - half + c_subpixels - 1, c_subpixels), 0);
+        s32 maxX = Min(floorDivide(Max(Max(x[0], x[1]), x[2]) - half, c_subpixels), static_cast<s32>(m_settings.Width) - 1);
+        s32 maxY = Min(floorDivide(Max(Max(y[0], y[1]), y[2]) - half, c_subpixels), static_cast<s32>(m_settings.Height) - 1);
+        if (minX > maxX || minY > maxY)
+            return;
+        s64 area = static_cast<s64>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<s64>(y[1] - y[0]) * (x[2] - x[0]);
+        if (area == 0)
+            return;
+        //faces are not culled, an occluder hides what is behind it from both sides
+        if (area < 0)
+        {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(inverseW[1], inverseW[2]);
+            area = -area;
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            int a = (i + 1) % 3;
+            int b = (i + 2) % 3;
+            triangle.A[i] = y[a] - y[b];
+            triangle.B[i] = x[b] - x[a];
+            triangle.C[i] = static_cast<s64>(x[a]) * y[b] - static_cast<s64>(x[b]) * y[a];
+            bool topLeft = triangle.A[i] > 0 || (triangle.A[i] == 0 && triangle.B[i] > 0);
+            triangle.Bias[i] = topLeft ? 0 : -1;
+        }
+
+        //the plane of 1 / w in pixels, from the snapped corners like the coverage
+        double toPixels = 1.0 / c_subpixels;
+        double x0 = x[0] * toPixels, y0 = y[0] * toPixels;
+        double dx1 = (x[1] - x[0]) * toPixels, dy1 = (y[1] - y[0]) * toPixels;
+        double dx2 = (x[2] - x[0]) * toPixels, dy2 = (y[2] - y[0]) * toPixels;
+        double determinant = dx1 * dy2 - dx2 * dy1;
+        double stepX = ((inverseW[1] - inverseW[0]) * dy2 - (inverseW[2] - inverseW[0]) * dy1) / determinant;
+        double stepY = ((inverseW[2] - inverseW[0]) * dx1 - (inverseW[1] - inverseW[0]) * dx2) / determinant;
+        triangle.InverseW0 = static_cast<float>(inverseW[0] - stepX * x0 - stepY * y0);
+        triangle.InverseWStepX = static_cast<float>(stepX);
+        triangle.InverseWStepY = static_cast<float>(stepY);
+        triangle.FarthestInverseW = Min(Min(inverseW[0], inverseW[1]), inverseW[2]);
+        triangle.MinTileX = minX / c_tileWidth;
+        triangle.MinTileY = minY / c_tileHeight;
+        triangle.MaxTileX = maxX / c_tileWidth;
+        triangle.MaxTileY = maxY / c_tileHeight;
+        m_chunkTriangles[chunk].push_back(triangle);
+    }
+
+    void OcclusionCuller::rasterizeBand(u32 firstTileRow, u32 endTileRow)
+    {
+        for (std::vector<SetupTriangle> const& triangles : m_chunkTriangles)
+        {
+            for (SetupTriangle const& triangle : triangles)
+            {
+                s32 firstY = Max(triangle.MinTileY, static_cast<s32>(firstTileRow));
+                s32 lastY = Min(triangle.MaxTileY, static_cast<s32>(endTileRow) - 1);
+                for (s32 tileY = firstY; tileY <= lastY; ++tileY)
+                {
+                    for (s32 tileX = triangle.MinTileX; tileX <= triangle.MaxTileX; ++tileX)
+                    {
+                        u32 coverage = coverTile(triangle, tileX, tileY);
+                        if (coverage == 0)
+                            continue;
+                        //farthest the triangle gets over the tile's pixel centers
+                        float cornerX = tileX * c_tileWidth + 0.5f;
+                        float cornerY = tileY * c_tileHeight + 0.5f;
+                        float farthest = triangle.InverseW0 + triangle.InverseWStepX * cornerX + triangle.InverseWStepY * cornerY
+                            + Min(triangle.InverseWStepX * (c_tileWidth - 1), 0.0f)
+                            + Min(triangle.InverseWStepY * (c_tileHeight - 1), 0.0f);
+                        farthest = Max(farthest, triangle.FarthestInverseW) * c_depthSlack;
+                        updateTile(tileY * m_tilesX + tileX, coverage, farthest);
+                    }
+                }
+            }
+        }
+    }
+
+    u32 OcclusionCuller::coverTile(SetupTriangle const& triangle, s32 tileX, s32 tileY) const
+    {
+        //edge values at the first pixel center; an edge the whole tile is inside of is left out
+        s64 firstX = static_cast<s64>(tileX * c_tileWidth) * c_subpixels + c_subpixels / 2;
+        s64 firstY = static_cast<s64>(tileY * c_tileHeight) * c_subpixels + c_subpixels / 2;
+        s32 edge[3];
+        s32 stepX[3];
+        s32 stepY[3];
+        bool allInside = true;
+        for (int i = 0; i < 3; ++i)
+        {
+            s64 value = triangle.A[i] * firstX + triangle.B[i] * firstY + triangle.C[i] + triangle.Bias[i];
+            s64 acrossX = static_cast<s64>(triangle.A[i]) * c_subpixels * (c_tileWidth - 1);
+            s64 acrossY = static_cast<s64>(triangle.B[i]) * c_subpixels * (c_tileHeight - 1);
+            if (value + Max(acrossX, s64(0)) + Max(acrossY, s64(0)) < 0)
+                return 0;
+            bool inside = value + Min(acrossX, s64(0)) + Min(acrossY, s64(0)) >= 0;
+            allInside &= inside;
+            edge[i] = inside ? 0 : static_cast<s32>(value);
+            stepX[i] = inside ? 0 : triangle.A[i] * c_subpixels;
+            stepY[i] = inside ? 0 : triangle.B[i] * c_subpixels;
+        }
+        if (allInside)
+            return c_fullCoverage;
+
+        //bit x + 8 * y for the pixel at x, y of the tile
+        u32 coverage = 0;
+        if (m_settings.Simd)
+        {
+            for (s32 row = 0; row < c_tileHeight; ++row)
+            {
+                __m128i left[3];
+                __m128i right[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    s32 rowEdge = edge[i] + stepY[i] * row;
+                    left[i] = _mm_setr_epi32(rowEdge, rowEdge + stepX[i], rowEdge + 2 * stepX[i], rowEdge + 3 * stepX[i]);
+                    right[i] = _mm_add_epi32(left[i], _mm_set1_epi32(4 * stepX[i]));
+                }
+                //a pixel is outside when any of its edge values has the sign bit set
+                __m128i leftOutside = _mm_or_si128(_mm_or_si128(left[0], left[1]), left[2]);
+                __m128i rightOutside = _mm_or_si128(_mm_or_si128(right[0], right[1]), right[2]);
+                u32 outside = static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(leftOutside)))
+                    | static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(rightOutside))) << 4;
+                coverage |= (~outside & 0xffu) << (row * c_tileWidth);
+            }
+            return coverage;
+        }
+        for (s32 row = 0; row < c_tileHeight; ++row)
+        {
+            for (s32 column = 0; column < c_tileWidth; ++column)
+            {
+                s32 e0 = edge[0] + stepY[0] * row + stepX[0] * column;
+                s32 e1 = edge[1] + stepY[1] * row + stepX[1] * column;
+                s32 e2 = edge[2] + stepY[2] * row + stepX[2] * column;
+                if ((e0 | e1 | e2) >= 0)
+                    coverage |= 1u << (row * c_tileWidth + column);
+            }
+        }
+        return coverage;
+    }
+
+    void OcclusionCuller::updateTile(u32 tile, u32 coverage, float inverseW)
+    {
+        float& reference = m_reference[tile];
+        float& working = m_working[tile];
+        u32& mask = m_masks[tile];
+        //behind what already covers the whole tile
+        if (inverseW <= reference)
+            return;
+        //nearer the reference than the working layer: merging would push the working layer back
+        //towards the reference, start it over with this triangle instead
+        if (mask != 0 && working - inverseW > inverseW - reference)
+            mask = 0;
+        working = mask != 0 ? Min(working, inverseW) : inverseW;
+        mask |= coverage;
+        if (mask == c_fullCoverage)
+        {
+            reference = working;
+            working = 0.0f;
+            mask = 0;
+        }
+    }
+
+    OcclusionCuller::ScreenRect OcclusionCuller::projectBox(Vector3 const& boxMin, Vector3 const& boxMax) const
+    {
+        //the eight corners, four at a time
+        ScreenRect rect;
+        Matrix4 const& m = m_viewProj;
+        const float rows[4][4] = {
+            { m.m00, m.m01, m.m02, m.m03 },
+            { m.m10, m.m11, m.m12, m.m13 },
+            { m.m20, m.m21, m.m22, m.m23 },
+            { m.m30, m.m31, m.m32, m.m33 },
+        };
+        const __m128 cornerX = _mm_setr_ps(boxMin.x, boxMax.x, boxMin.x, boxMax.x);
+        const __m128 cornerY = _mm_setr_ps(boxMin.y, boxMin.y, boxMax.y, boxMax.y);
+        __m128 screenMinX = _mm_set1_ps(FLT_MAX);
+        __m128 screenMinY = _mm_set1_ps(FLT_MAX);
+        __m128 screenMaxX = _mm_set1_ps(-FLT_MAX);
+        __m128 screenMaxY = _mm_set1_ps(-FLT_MAX);
+        __m128 nearest = _mm_setzero_ps();
+        __m128 behind = _mm_setzero_ps();
+        for (float z : { boxMin.z, boxMax.z })
+        {
+            __m128 clip[4];
+            for (int row = 0; row < 4; ++row)
+            {
+                clip[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(rows[row][0]), cornerX),
+                                                  _mm_mul_ps(_mm_set1_ps(rows[row][1]), cornerY)),
+                                       _mm_set1_ps(rows[row][2] * z + rows[row][3]));
+            }
+            //in front of the near plane or not at all
+            behind = _mm_or_ps(behind, _mm_cmplt_ps(_mm_add_ps(clip[2], clip[3]), _mm_setzero_ps()));
+            behind = _mm_or_ps(behind, _mm_cmple_ps(clip[3], _mm_setzero_ps()));
+            __m128 inverseW = _mm_div_ps(_mm_set1_ps(1.0f), clip[3]);
+            __m128 x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip[0], inverseW), _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f)),
+                                  _mm_set1_ps(static_cast<float>(m_settings.Width)));
+            __m128 y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_mul_ps(clip[1], inverseW), _mm_set1_ps(0.5f))),
+                                  _mm_set1_ps(static_cast<float>(m_settings.Height)));
+            screenMinX = _mm_min_ps(screenMinX, x);
+            screenMinY = _mm_min_ps(screenMinY, y);
+            screenMaxX = _mm_max_ps(screenMaxX, x);
+            screenMaxY = _mm_max_ps(screenMaxY, y);
+            nearest = _mm_max_ps(nearest, inverseW);
+        }
+        if (_mm_movemask_ps(behind) != 0)
+            return rect;
+        float lanes[4][5];
+        _mm_storeu_ps(lanes[0], screenMinX);
+        _mm_storeu_ps(lanes[1], screenMinY);
+        _mm_storeu_ps(lanes[2], screenMaxX);
+        _mm_storeu_ps(lanes[3], screenMaxY);
+        float minX = Min(Min(lanes[0][0], lanes[0][1]), Min(lanes[0][2], lanes[0][3]));
+        float minY = Min(Min(lanes[1][0], lanes[1][1]), Min(lanes[1][2], lanes[1][3]));
+        float maxX = Max(Max(lanes[2][0], lanes[2][1]), Max(lanes[2][2], lanes[2][3]));
+        float maxY = Max(Max(lanes[3][0], lanes[3][1]), Max(lanes[3][2], lanes[3][3]));
+        _mm_storeu_ps(lanes[0], nearest);
+        rect.NearestInverseW = Max(Max(lanes[0][0], lanes[0][1]), Max(lanes[0][2], lanes[0][3]));
+        //every pixel the rectangle touches
+        rect.MinX = static_cast<s32>(Max(Floor(minX), 0.0f));
+        rect.MinY = static_cast<s32>(Max(Floor(minY), 0.0f));
+        rect.MaxX = static_cast<s32>(Min(Floor(maxX), m_settings.Width - 1.0f));
+        rect.MaxY = static_cast<s32>(Min(Floor(maxY), m_settings.Height - 1.0f));
+        rect.Testable = rect.MinX <= rect.MaxX && rect.MinY <= rect.MaxY;
+        return rect;
+    }
+
+    bool OcclusionCuller::isOccluded(ScreenRect const& rect) const
+    {
+        if (!rect.Testable)
+            return false;
+        s32 firstX = rect.MinX / c_tileWidth;
+        s32 lastX = rect.MaxX / c_tileWidth;
+        const __m128 nearest = _mm_set1_ps(rect.NearestInverseW);
+        for (s32 tileY = rect.MinY / c_tileHeight; tileY <= rect.MaxY / c_tileHeight; ++tileY)
+        {
+            float const* row = m_reference.data() + tileY * m_tilesX;
+            s32 tileX = firstX;
+            if (m_settings.Simd)
+            {
+                for (; tileX + 3 <= lastX; tileX += 4)
+                {
+                    if (_mm_movemask_ps(_mm_cmplt_ps(nearest, _mm_loadu_ps(row + tileX))) != 0xf)
+                        return false;
+                }
+            }
+            for (; tileX <= lastX; ++tileX)
+            {
+                if (!(rect.NearestInverseW < row[tileX]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool OcclusionCuller::IsOccluded(Math::Vector3 const& boxMin, Math::Vector3 const& boxMax)
+    {
+        Wait();
+        if (m_reference.empty())
+            return false;
+        return isOccluded(projectBox(boxMin, boxMax));
+    }
+
+    OcclusionCuller::FrameStats const& OcclusionCuller::Cull(FrustumCuller const& spheres, std::vector<ObjectId>& visible,
+                                                             std::vector<u8>& visibleMask)
+    {
+        Wait();
+        m_framePending = false;
+        auto start = std::chrono::high_resolution_clock::now();
+        m_stats.Tested = static_cast<u32>(visible.size());
+        m_stats.Occluded = 0;
+        if (!m_reference.empty())
+        {
+            size_t kept = 0;
+            for (ObjectId id : visible)
+            {
+                if (!spheres.IsAlwaysVisible(id))
+                {
+                    BoundingSphere sphere = spheres.GetSphere(id);
+                    Vector3 extent(sphere.radius);
+                    if (isOccluded(projectBox(sphere.center - extent, sphere.center + extent)))
+                    {
+                        visibleMask[id] = 0;
+                        ++m_stats.Occluded;
+                        continue;
+                    }
+                }
+                visible[kept++] = id;
+            }
+            visible.resize(kept);
+        }
+        m_stats.TestMilliseconds = elapsedMilliseconds(start);
+        return m_stats;
+    }
+
+    std::shared_ptr<Texture> OcclusionCuller::ReadDepth()
+    {
+        Wait();
+        auto image = std::make_shared<Texture>(m_settings.Width, m_settings.Height, Texture::Format::RGB);
+        float nearest = 0.0f;
+        for (float depth : m_reference)
+        {
+            nearest = Max(nearest, depth);
+        }
+        for (u32 y = 0; y < m_settings.Height && !m_reference.empty(); ++y)
+        {
+            for (u32 x = 0; x < m_settings.Width; ++x)
+            {
+                float depth = m_reference[(y / c_tileHeight) * m_tilesX + x / c_tileWidth];
+                float gray = nearest > 0.0f ? depth / nearest : 0.0f;
+                image->SetPixel(x, y, Color(gray, gray, gray));
+            }
+        }
+        return image;
+    }
+
+    OcclusionCuller::Benchmark OcclusionCuller::Measure(std::shared_ptr<TriangleMesh> const& occluder, u32 walls, u32 objects)
+    {
+        Benchmark result;
+        Settings settings;
+        result.Width = settings.Width;
+        result.Height = settings.Height;
+        result.Objects = objects;
+        result.Threads = workerThreads(settings.MaxThreads);
+
+        //walls across the view every few units, each with a door at a different place
+        const float wallSpacing = 4.0f;
+        const float wallWidth = 40.0f;
+        const float doorWidth = 2.0f;
+        std::vector<Occluder> occluders;
+        for (u32 i = 0; i < walls; ++i)
+        {
+            float z = -wallSpacing * (i + 1);
+            float door = ((i * 7) % 9 - 4.0f) * 2.0f;
+            float leftWidth = door - doorWidth * 0.5f + wallWidth * 0.5f;
+            float rightWidth = wallWidth * 0.5f - door - doorWidth * 0.5f;
+            Occluder left = { occluder, BuildTransform(Vector3(-wallWidth * 0.5f + leftWidth * 0.5f, 1.5f, z),
+                                                       Quaternion::c_Identity, Vector3(leftWidth, 3.0f, 0.2f)) };
+            Occluder right = { occluder, BuildTransform(Vector3(wallWidth * 0.5f - rightWidth * 0.5f, 1.5f, z),
+                                                        Quaternion::c_Identity, Vector3(rightWidth, 3.0f, 0.2f)) };
+            occluders.push_back(left);
+            occluders.push_back(right);
+        }
+        result.Occluders = static_cast<u32>(occluders.size());
+        //boxes scattered between the walls, the same every run
+        std::vector<Vector3> boxes;
+        u32 seed = 12345;
+        auto random = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) / 16777216.0f;
+        };
+        for (u32 i = 0; i < objects; ++i)
+        {
+            boxes.push_back(Vector3((random() - 0.5f) * wallWidth, random() * 2.5f,
+                                    -1.0f - random() * wallSpacing * (walls + 1)));
+        }
+        const Vector3 boxExtent(0.25f);
+        Matrix4 viewProj = RenderView::LookAt(Vector3(0.0f, 1.7f, 2.0f), Vector3(0.0f, 1.2f, -10.0f), c_Pi / 2.0f,
+                                              float(settings.Width) / float(settings.Height)).ViewProj;
+
+        auto render = [&](OcclusionCuller& culler, float& milliseconds)
+        {
+            //the first frame warms up the buffers, the second is timed
+            for (int frame = 0; frame < 2; ++frame)
+            {
+                culler.BeginFrame(viewProj, occluders);
+                culler.Wait();
+                milliseconds = culler.GetFrameStats().RasterMilliseconds;
+            }
+        };
+        OcclusionCuller culler(settings);
+        render(culler, result.RasterMilliseconds);
+        result.OccluderTriangles = culler.GetFrameStats().OccluderTriangles;
+        Settings oneThread = settings;
+        oneThread.MaxThreads = 1;
+        OcclusionCuller single(oneThread);
+        render(single, result.SingleThreadMilliseconds);
+        Settings scalarSettings = oneThread;
+        scalarSettings.Simd = false;
+        OcclusionCuller scalar(scalarSettings);
+        render(scalar, result.ScalarMilliseconds);
+        result.ResultsMatch = culler.m_reference == single.m_reference && culler.m_reference == scalar.m_reference
+            && culler.m_masks == single.m_masks && culler.m_masks == scalar.m_masks;
+
+        std::vector<u8> occluded(objects, 0);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (u32 i = 0; i < objects; ++i)
+        {
+            occluded[i] = culler.IsOccluded(boxes[i] - boxExtent, boxes[i] + boxExtent) ? 1 : 0;
+        }
+        result.TestNanoseconds = elapsedMilliseconds(start) * 1e6f / Max(objects, 1u);
+        for (u32 i = 0; i < objects; ++i)
+        {
+            result.Occluded += occluded[i];
+        }
+
+        //the same triangles into a depth per pixel, nearest wins
+        std::vector<float> pixels(settings.Width * settings.Height, 0.0f);
+        for (std::vector<SetupTriangle> const& triangles : culler.m_chunkTriangles)
+        {
+            for (SetupTriangle const& triangle : triangles)
+            {
+                for (s32 tileY = triangle.MinTileY; tileY <= triangle.MaxTileY; ++tileY)
+                {
+                    for (s32 tileX = triangle.MinTileX; tileX <= triangle.MaxTileX; ++tileX)
+                    {
+                        u32 coverage = culler.coverTile(triangle, tileX, tileY);
+                        for (u32 bit = 0; bit < 32; ++bit)
+                        {
+                            if ((coverage & (1u << bit)) == 0)
+                                continue;
+                            s32 x = tileX * c_tileWidth + bit % c_tileWidth;
+                            s32 y = tileY * c_tileHeight + bit / c_tileWidth;
+                            float depth = triangle.InverseW0 + triangle.InverseWStepX * (x + 0.5f)
+                                + triangle.InverseWStepY * (y + 0.5f);
+                            float& pixel = pixels[y * settings.Width + x];
+                            pixel = Max(pixel, Max(depth, triangle.FarthestInverseW));
+                        }
+                    }
+                }
+            }
+        }
+        for (u32 i = 0; i < objects; ++i)
+        {
+            ScreenRect rect = culler.projectBox(boxes[i] - boxExtent, boxes[i] + boxExtent);
+            bool hidden = rect.Testable;
+            for (s32 y = rect.MinY; y <= rect.MaxY && hidden; ++y)
+            {
+                for (s32 x = rect.MinX; x <= rect.MaxX && hidden; ++x)
+                {
+                    hidden = rect.NearestInverseW < pixels[y * settings.Width + x];
+                }
+            }
+            result.ReferenceOccluded += hidden ? 1 : 0;
+            result.NotConservative += occluded[i] && !hidden ? 1 : 0;
+        }
+        return result;
+    }
+}
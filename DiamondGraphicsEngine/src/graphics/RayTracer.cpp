@@ -0,0 +1,519 @@
+#include "Precompiled.h"
+#include "graphics/RayTracer.h"
+#include "core/Scene.h"
+#include "core/components/Renderer.h"
+#include "core/components/Transform.h"
+#include "framework/ParallelFor.h"
+#include "graphics/CameraBase.h"
+#include "graphics/Materials.h"
+#include "graphics/RenderDevice.h"
+#include "graphics/Texture.h"
+#include "graphics/TriangleMesh.h"
+
+namespace
+{
+    using namespace Math;
+
+    //secondary rays start this far off the surface, relative to its distance from the origin,
+    //so they do not hit the triangle they leave from
+    const float c_surfaceOffset = 1e-4f;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    Vector3 rgb(Graphics::Color const& color)
+    {
+        return Vector3(color.r, color.g, color.b);
+    }
+
+    Vector3 offsetAlong(Vector3 const& position, Vector3 const& normal)
+    {
+        float scale = Max(Max(Abs(position.x), Abs(position.y)), Max(Abs(position.z), 1.0f));
+        return position + normal * (c_surfaceOffset * scale);
+    }
+
+    //world position of a point in normalized device coordinates
+    Vector3 unproject(Matrix4 const& inverseViewProj, float x, float y, float z)
+    {
+        Vector4 point = Math::Transform(inverseViewProj, Vector4(x, y, z, 1.0f));
+        return Vector3(point.x, point.y, point.z) * (1.0f / point.w);
+    }
+
+    Vector3 reflect(Vector3 const& direction, Vector3 const& normal)
+    {
+        return direction - normal * (2.0f * Dot(direction, normal));
+    }
+
+    //direction through a surface whose normal faces the ray, eta the ratio of the indices of
+    //refraction before and after it; false on total internal reflection
+    bool refract(Vector3 const& direction, Vector3 const& normal, float eta, Vector3& refracted)
+    {
+        float cosine = -Dot(direction, normal);
+        float k = 1.0f - eta * eta * (1.0f - cosine * cosine);
+        if (k < 0.0f)
+            return false;
+        refracted = (direction * eta + normal * (eta * cosine - Sqrt(k))).Normalized();
+        return true;
+    }
+
+    //Schlick's approximation of the Fresnel reflectance, reflectance the one head on
+    Vector3 fresnel(Vector3 const& reflectance, float cosine)
+    {
+        float m = Clamp(1.0f - cosine, 0.0f, 1.0f);
+        float m5 = m * m * m * m * m;
+        return reflectance + (Vector3(1.0f) - reflectance) * m5;
+    }
+}
+
+namespace Graphics
+{
+    struct RayTracer::Surface
+    {
+        Vector3 Position;
+        //unit length, turned to face the ray
+        Vector3 Normal;
+        Vector2 Uv;
+        //the ray comes from the side the mesh normals point to, so it goes into the object
+        bool Entering = true;
+    };
+
+    RayTracer::RayTracer()
+        : m_tree(0.0f)
+    {
+    }
+
+    void RayTracer::Build(std::vector<Instance> const& instances, std::vector<LightAttribute> const& lights)
+    {
+        Clear();
+        for (Instance const& instance : instances)
+        {
+            if (!instance.Mesh || !instance.Material || instance.Mesh->GetPrimitiveCount() == 0)
+                continue;
+            SceneInstance added;
+            added.Mesh = instance.Mesh;
+            added.Material = instance.Material;
+            added.Bvh = instance.Bvh ? instance.Bvh : instance.Mesh->GetBvh();
+            std::shared_ptr<Texture> texture = instance.Material->GetDiffuseTexture();
+            if (instance.Material->IsDiffuseTextureEnabled() && texture && texture->HasPixels())
+                added.DiffuseTexture = texture;
+            added.World = instance.World;
+            added.InverseWorld = instance.World.Inverted();
+            added.NormalMatrix = added.InverseWorld.Transposed();
+
+            //world box around the corners of the object space one
+            Vector3 localMin = added.Bvh->GetBoundsMin();
+            Vector3 localMax = added.Bvh->GetBoundsMax();
+            BoundingAABB box(Vector3(FLT_MAX), Vector3(-FLT_MAX));
+            for (u32 corner = 0; corner < 8; ++corner)
+            {
+                Vector3 point(corner & 1 ? localMax.x : localMin.x, corner & 2 ? localMax.y : localMin.y,
+                              corner & 4 ? localMax.z : localMin.z);
+                point = TransformPoint(added.World, point);
+                box.aabbMin = Vector3(Min(box.aabbMin.x, point.x), Min(box.aabbMin.y, point.y), Min(box.aabbMin.z, point.z));
+                box.aabbMax = Vector3(Max(box.aabbMax.x, point.x), Max(box.aabbMax.y, point.y), Max(box.aabbMax.z, point.z));
+            }
+            m_tree.Insert(static_cast<ObjectId>(m_instances.size()), box);
+            m_instances.push_back(added);
+        }
+        m_tree.Rebuild();
+
+        for (LightAttribute const& light : lights)
+        {
+            if (light.isActive)
+                m_lights.push_back(light);
+        }
+    }
+
+    void RayTracer::Build(Scene& scene)
+    {
+        using namespace Component;
+        std::vector<Instance> instances;
+        for (auto const& shaderObjects : scene.GetRenderObjectListRef())
+        {
+            for (auto const& renderObject : shaderObjects.second)
+            {
+                Object& object = scene.GetObjectRef(ObjectHandle(renderObject.first));
+                if (!object.IsActive() || !object.HasComponent<Renderer>())
+                    continue;
+                Renderer& renderer = object.GetComponentRef<Renderer>();
+                if (!renderer.IsEnabled())
+                    continue;
+                for (size_t slot = 0; slot < renderer.GetMeshSlotCount(); ++slot)
+                {
+                    Instance instance;
+                    instance.Mesh = std::dynamic_pointer_cast<TriangleMesh>(renderer.GetMesh(slot));
+                    instance.Material = renderer.GetMaterial();
+                    instance.World = object.GetComponentRef<Component::Transform>().GetWorldTransform();
+                    instances.push_back(instance);
+                }
+            }
+        }
+        std::list<LightAttribute> const& lights = LightManager::GetLightAttributes();
+        Build(instances, std::vector<LightAttribute>(lights.begin(), lights.end()));
+    }
+
+    void RayTracer::Clear()
+    {
+        m_instances.clear();
+        m_lights.clear();
+        m_tree.Clear();
+    }
+
+    std::shared_ptr<Texture> RayTracer::Render(Matrix4 const& viewProj, Settings const& settings) const
+    {
+        std::shared_ptr<Texture> image = std::make_shared<Texture>(settings.Width, settings.Height, Texture::Format::RGB);
+        Matrix4 inverseViewProj = viewProj.Inverted();
+        u32 tileSize = Max(settings.TileSize, 1u);
+        u32 tilesX = (settings.Width + tileSize - 1) / tileSize;
+        u32 tilesY = (settings.Height + tileSize - 1) / tileSize;
+        Vector3 background = rgb(settings.Background);
+        ParallelFor(tilesX * tilesY, 1, [&](u32 begin, u32 end)
+        {
+            RayArray rays;
+            std::vector<Hit> hits;
+            for (u32 index = begin; index < end; ++index)
+            {
+                Tile tile;
+                tile.X = (index % tilesX) * tileSize;
+                tile.Y = (index / tilesX) * tileSize;
+                tile.Width = Min(tileSize, settings.Width - tile.X);
+                tile.Height = Min(tileSize, settings.Height - tile.Y);
+                castTile(tile, inverseViewProj, settings, rays, hits);
+                for (u32 i = 0; i < rays.Size(); ++i)
+                {
+                    Vector3 color = background;
+                    if (hits[i].InstanceIndex >= 0)
+                        color = shade(rays.start.Get(i), rays.direction.Get(i), hits[i], 0, settings);
+                    //IntColor does not clamp
+                    Color clamped(Clamp(color.x, 0.0f, 1.0f), Clamp(color.y, 0.0f, 1.0f), Clamp(color.z, 0.0f, 1.0f));
+                    image->SetPixel(tile.X + i % tile.Width, tile.Y + i / tile.Width, clamped);
+                }
+            }
+        }, settings.MaxThreads);
+        return image;
+    }
+
+    std::shared_ptr<Texture> RayTracer::Render(CameraBase& camera, Settings settings) const
+    {
+        settings.Background = camera.GetFogColor();
+        return Render(camera.GetViewProjMatrix(), settings);
+    }
+
+    void RayTracer::castTile(Tile const& tile, Matrix4 const& inverseViewProj, Settings const& settings,
+                             RayArray& rays, std::vector<Hit>& hits) const
+    {
+        rays.Resize(tile.Width * tile.Height);
+        hits.assign(rays.Size(), Hit());
+        for (u32 y = 0; y < tile.Height; ++y)
+        {
+            //row 0 is the top of the image, at +1 in device coordinates
+            float deviceY = 1.0f - 2.0f * (tile.Y + y + 0.5f) / settings.Height;
+            for (u32 x = 0; x < tile.Width; ++x)
+            {
+                float deviceX = 2.0f * (tile.X + x + 0.5f) / settings.Width - 1.0f;
+                Vector3 nearPoint = unproject(inverseViewProj, deviceX, deviceY, -1.0f);
+                Vector3 farPoint = unproject(inverseViewProj, deviceX, deviceY, 1.0f);
+                rays.Set(y * tile.Width + x, nearPoint, (farPoint - nearPoint).Normalized());
+            }
+        }
+        if (settings.Packets)
+        {
+            castPacket(rays, hits);
+            return;
+        }
+        for (u32 i = 0; i < rays.Size(); ++i)
+            castRay(rays.start.Get(i), rays.direction.Get(i), FLT_MAX, hits[i]);
+    }
+
+    void RayTracer::castPacket(RayArray& rays, std::vector<Hit>& hits) const
+    {
+        RayArray local(rays.Size());
+        std::vector<TriangleBvh::Hit> localHits(rays.Size());
+        m_tree.RayCastPacket(rays.GetSpan(), [&](ObjectId id)
+        {
+            //the directions keep the scale of the object, so distances stay in world units
+            SceneInstance const& instance = m_instances[static_cast<size_t>(id)];
+            Batch::TransformPoints(instance.InverseWorld, rays.start.GetSpan(), local.start.GetSpan());
+            Batch::TransformNormals(instance.InverseWorld, rays.direction.GetSpan(), local.direction.GetSpan());
+            local.distance = rays.distance;
+            local.UpdateInverses();
+            if (!instance.Bvh->RayCastPacket(local, localHits.data()))
+                return;
+            for (size_t i = 0; i < rays.Size(); ++i)
+            {
+                if (local.distance[i] < rays.distance[i])
+                {
+                    rays.distance[i] = local.distance[i];
+                    hits[i].InstanceIndex = static_cast<s32>(id);
+                    hits[i].Triangle = localHits[i];
+                }
+            }
+        });
+    }
+
+    bool RayTracer::castRay(Vector3 const& start, Vector3 const& direction, float maxDistance, Hit& hit) const
+    {
+        Ray ray(start, direction);
+        float nearest = maxDistance;
+        return m_tree.RayCast(ray, nullptr, [&](ObjectId id, float& t)
+        {
+            SceneInstance const& instance = m_instances[static_cast<size_t>(id)];
+            TriangleBvh::Hit triangle;
+            triangle.Distance = nearest;
+            if (!instance.Bvh->RayCast(ray.Transform(instance.InverseWorld), triangle))
+                return false;
+            nearest = t = triangle.Distance;
+            hit.InstanceIndex = static_cast<s32>(id);
+            hit.Triangle = triangle;
+            return true;
+        }, maxDistance);
+    }
+
+    Vector3 RayTracer::trace(Vector3 const& start, Vector3 const& direction, u32 depth, Settings const& settings) const
+    {
+        Hit hit;
+        if (!castRay(start, direction, FLT_MAX, hit))
+            return rgb(settings.Background);
+        return shade(start, direction, hit, depth, settings);
+    }
+
+    RayTracer::Surface RayTracer::surfaceAt(Vector3 const& start, Vector3 const& direction, Hit const& hit) const
+    {
+        SceneInstance const& instance = m_instances[hit.InstanceIndex];
+        TriangleMesh const& mesh = *instance.Mesh;
+        TriangleMesh::TriangleFace const& face = mesh.GetTriangle(hit.Triangle.Triangle);
+        TriangleMesh::Vertex const& a = mesh.GetVertex(face.a);
+        TriangleMesh::Vertex const& b = mesh.GetVertex(face.b);
+        TriangleMesh::Vertex const& c = mesh.GetVertex(face.c);
+        float u = hit.Triangle.U;
+        float v = hit.Triangle.V;
+        float w = 1.0f - u - v;
+
+        Surface surface;
+        surface.Position = start + direction * hit.Triangle.Distance;
+        surface.Uv = a.uv * w + b.uv * u + c.uv * v;
+        Vector3 normal = a.normal * w + b.normal * u + c.normal * v;
+        //meshes without normals get the flat one from the winding
+        if (normal.LengthSq() == 0.0f)
+            normal = Cross(b.position - a.position, c.position - a.position);
+        normal = TransformNormal(instance.NormalMatrix, normal).Normalized();
+        surface.Entering = Dot(normal, direction) < 0.0f;
+        surface.Normal = surface.Entering ? normal : -normal;
+        return surface;
+    }
+
+    Vector3 RayTracer::lightSurface(Surface const& surface, Material const& material, Vector3 const& toEye,
+                                    bool specular) const
+    {
+        Vector3 ambientColor = rgb(material.GetAmbientColor());
+        Vector3 diffuseColor = rgb(material.GetDiffuseColor());
+        Vector3 specularColor = rgb(material.GetSpecularColor());
+        Vector3 shadowStart = offsetAlong(surface.Position, surface.Normal);
+        Vector3 color(0.0f);
+        for (LightAttribute const& light : m_lights)
+        {
+            Vector3 lightDirection = Vector3(light.direction.x, light.direction.y, light.direction.z).Normalized();
+            Vector3 toLight = -lightDirection;
+            float distance = FLT_MAX;
+            float attenuation = 1.0f;
+            if (light.lightType != LightType::Directional)
+            {
+                Vector3 offset = Vector3(light.position.x, light.position.y, light.position.z) - surface.Position;
+                distance = offset.Length();
+                toLight = offset * (1.0f / distance);
+                if (light.ifDecay)
+                {
+                    Vector3 const& k = light.disAtten;
+                    attenuation = Min(1.0f / (k.x + k.y * distance + k.z * distance * distance), 1.0f);
+                }
+                //full inside the inner cone, falling off to nothing at the outer one, as FinalPass.frag
+                if (light.lightType == LightType::Spot)
+                {
+                    float cosInner = Cos(light.innerAngle);
+                    float cosOuter = Cos(light.outerAngle);
+                    float cosAlpha = -Dot(lightDirection, toLight);
+                    if (cosAlpha <= cosOuter)
+                        continue;
+                    if (cosAlpha < cosInner)
+                        attenuation *= Pow(Abs(cosAlpha - cosOuter) / Abs(cosInner - cosOuter), light.spotFalloff);
+                }
+            }
+
+            Vector3 term = rgb(light.ambientColor) * ambientColor;
+            float lambert = Dot(surface.Normal, toLight);
+            if (lambert > 0.0f)
+            {
+                Vector3 lit = rgb(light.diffuseColor) * diffuseColor * lambert;
+                if (specular)
+                {
+                    float highlight = Max(Dot(reflect(-toLight, surface.Normal), toEye), 0.0f);
+                    lit += rgb(light.specularColor) * specularColor * Pow(highlight, material.GetSpecularExponent());
+                }
+                Hit blocker;
+                if (light.shadowType != ShadowType::NoShadow && castRay(shadowStart, toLight, distance, blocker))
+                    lit *= 1.0f - light.shadowStrength;
+                term += lit;
+            }
+            color += term * (light.intensity * attenuation);
+        }
+        return color;
+    }
+
+    Vector3 RayTracer::shade(Vector3 const& start, Vector3 const& direction, Hit const& hit, u32 depth,
+                             Settings const& settings) const
+    {
+        SceneInstance const& instance = m_instances[hit.InstanceIndex];
+        Material const& material = *instance.Material;
+        Surface surface = surfaceAt(start, direction, hit);
+        Vector3 texture(1.0f);
+        if (instance.DiffuseTexture)
+            texture = rgb(instance.DiffuseTexture->SampleBilinear(surface.Uv.x, surface.Uv.y));
+        if (!material.IfReceiveLight())
+            return texture;
+
+        int model = material.GetIlluminationModel();
+        Vector3 emissive = rgb(material.GetEmissiveColor());
+        //0 is the color alone, 1 leaves out the highlights, 10 is drawn as 2
+        if (model == 0)
+            return (rgb(material.GetDiffuseColor()) + emissive) * texture;
+        Vector3 local = (lightSurface(surface, material, -direction, model != 1) + emissive) * texture;
+        if (depth >= settings.MaxDepth)
+            return local;
+
+        Vector3 specularColor = rgb(material.GetSpecularColor());
+        float cosine = -Dot(direction, surface.Normal);
+        Vector3 reflected = reflect(direction, surface.Normal);
+        auto traceReflection = [&]()
+        {
+            return trace(offsetAlong(surface.Position, surface.Normal), reflected, depth + 1, settings);
+        };
+        //behind the surface, from where the transmitted ray starts
+        Vector3 behind = offsetAlong(surface.Position, -surface.Normal);
+        float transparency = 1.0f - Clamp(material.GetOpacity(), 0.0f, 1.0f);
+
+        switch (model)
+        {
+        case 3://Reflection on and Ray trace on
+        case 8://Reflection on and Ray trace off, a ray tracer has nothing cheaper to fall back to
+            return local + specularColor * traceReflection();
+        case 5://Reflection: Fresnel on and Ray trace on
+            return local + fresnel(specularColor, cosine) * traceReflection();
+        case 4://Transparency: Glass on, Reflection: Ray trace on
+        case 9://Transparency: Glass on, Reflection: Ray trace off
+        {
+            //thin glass lets the light straight through
+            Vector3 color = local * (1.0f - transparency);
+            if (transparency > 0.0f)
+                color += trace(behind, direction, depth + 1, settings) * transparency;
+            if (model == 4)
+                color += specularColor * traceReflection();
+            return color;
+        }
+        case 6://Transparency: Refraction on, Reflection: Fresnel off and Ray trace on
+        case 7://Transparency: Refraction on, Reflection: Fresnel on and Ray trace on
+        {
+            float index = Max(material.GetRefractiveIndex(), 1e-3f);
+            float eta = surface.Entering ? 1.0f / index : index;
+            float f0 = (index - 1.0f) / (index + 1.0f);
+            Vector3 reflectance = model == 7 ? fresnel(Vector3(f0 * f0), cosine) : specularColor;
+            Vector3 refracted;
+            Vector3 color = local * (1.0f - transparency);
+            if (transparency > 0.0f)
+            {
+                //total internal reflection sends everything the other way
+                if (refract(direction, surface.Normal, eta, refracted))
+                    color += trace(behind, refracted, depth + 1, settings) * (Vector3(1.0f) - reflectance) * transparency;
+                else
+                    reflectance = Vector3(1.0f);
+            }
+            return color + reflectance * traceReflection();
+        }
+        default:
+            return local;
+        }
+    }
+
+    RayTracer::Benchmark RayTracer::Measure(std::vector<Instance> const& instances, std::vector<LightAttribute> const& lights,
+                                            Vector3 const& eye, Vector3 const& target, Settings const& settings,
+                                            std::string const& imagePath)
+    {
+        Benchmark result;
+        RayTracer tracer;
+        tracer.Build(instances, lights);
+        result.Width = settings.Width;
+        result.Height = settings.Height;
+        result.Instances = tracer.GetInstanceCount();
+        for (SceneInstance const& instance : tracer.m_instances)
+            result.Triangles += instance.Bvh->GetTriangleCount();
+        Matrix4 viewProj = RenderView::LookAt(eye, target, c_Pi / 2.0f, float(settings.Width) / float(settings.Height)).ViewProj;
+
+        result.Threads = settings.MaxThreads ? settings.MaxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<Texture> image = tracer.Render(viewProj, settings);
+        result.Milliseconds = elapsedMilliseconds(start);
+        if (!imagePath.empty())
+            Texture::SavePNG(image, imagePath);
+        Settings oneThread = settings;
+        oneThread.MaxThreads = 1;
+        start = std::chrono::high_resolution_clock::now();
+        tracer.Render(viewProj, oneThread);
+        result.SingleThreadMilliseconds = elapsedMilliseconds(start);
+
+        //the camera rays of every tile both ways, keeping the hits to compare
+        Matrix4 inverseViewProj = viewProj.Inverted();
+        u32 tileSize = Max(settings.TileSize, 1u);
+        std::vector<Tile> tiles;
+        for (u32 y = 0; y < settings.Height; y += tileSize)
+        {
+            for (u32 x = 0; x < settings.Width; x += tileSize)
+            {
+                Tile tile;
+                tile.X = x;
+                tile.Y = y;
+                tile.Width = Min(tileSize, settings.Width - x);
+                tile.Height = Min(tileSize, settings.Height - y);
+                tiles.push_back(tile);
+            }
+        }
+        auto castAll = [&](bool packets, std::vector<Hit>& allHits)
+        {
+            Settings cast = settings;
+            cast.Packets = packets;
+            RayArray rays;
+            std::vector<Hit> hits;
+            allHits.clear();
+            auto castStart = std::chrono::high_resolution_clock::now();
+            for (Tile const& tile : tiles)
+            {
+                tracer.castTile(tile, inverseViewProj, cast, rays, hits);
+                allHits.insert(allHits.end(), hits.begin(), hits.end());
+            }
+            return elapsedMilliseconds(castStart);
+        };
+        std::vector<Hit> packetHits, singleHits;
+        float packetMilliseconds = castAll(true, packetHits);
+        float singleMilliseconds = castAll(false, singleHits);
+        result.PrimaryRays = static_cast<u32>(packetHits.size());
+        result.PacketMegaRaysPerSecond = result.PrimaryRays / (1000.0f * Max(packetMilliseconds, 1e-3f));
+        result.SingleRayMegaRaysPerSecond = result.PrimaryRays / (1000.0f * Max(singleMilliseconds, 1e-3f));
+        for (size_t i = 0; i < packetHits.size(); ++i)
+        {
+            Hit const& packet = packetHits[i];
+            Hit const& single = singleHits[i];
+            if (single.InstanceIndex >= 0)
+                ++result.PrimaryRaysHit;
+            bool same = packet.InstanceIndex == single.InstanceIndex;
+            if (same && single.InstanceIndex >= 0)
+            {
+                same = packet.Triangle.Triangle == single.Triangle.Triangle
+                    && Abs(packet.Triangle.Distance - single.Triangle.Distance) <= 1e-4f * single.Triangle.Distance;
+            }
+            if (!same)
+                ++result.MismatchedHits;
+        }
+        return result;
+    }
+}
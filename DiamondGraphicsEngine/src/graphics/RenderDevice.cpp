@@ -0,0 +1,42 @@
+#include "Precompiled.h"
+#include "graphics/RenderDevice.h"
+#include "graphics/CameraBase.h"
+
+namespace Graphics
+{
+    RenderView RenderView::FromCamera(CameraBase& camera)
+    {
+        RenderView view;
+        view.ViewProj = camera.GetViewProjMatrix();
+        view.Position = camera.GetCameraWorldPosition();
+        view.NearPlane = camera.GetNearPlaneDistance();
+        view.FarPlane = camera.GetFarPlaneDistance();
+        view.FogColor = camera.GetFogColor();
+        return view;
+    }
+
+    RenderView RenderView::LookAt(Math::Vector3 const& eye, Math::Vector3 const& target, float fieldOfView, float aspect,
+                                  float nearPlane, float farPlane)
+    {
+        using namespace Math;
+        Vector3 forward = (target - eye).Normalized();
+        Vector3 right = Cross(forward, Vector3(0.0f, 1.0f, 0.0f)).Normalized();
+        Vector3 up = Cross(right, forward);
+        Matrix4 viewMatrix(right.x, right.y, right.z, -Dot(right, eye),
+                           up.x, up.y, up.z, -Dot(up, eye),
+                           -forward.x, -forward.y, -forward.z, Dot(forward, eye),
+                           0.0f, 0.0f, 0.0f, 1.0f);
+        float f = 1.0f / Tan(fieldOfView * 0.5f);
+        Matrix4 projection(f / aspect, 0.0f, 0.0f, 0.0f,
+                           0.0f, f, 0.0f, 0.0f,
+                           0.0f, 0.0f, (farPlane + nearPlane) / (nearPlane - farPlane),
+                           2.0f * farPlane * nearPlane / (nearPlane - farPlane),
+                           0.0f, 0.0f, -1.0f, 0.0f);
+        RenderView view;
+        view.ViewProj = projection * viewMatrix;
+        view.Position = eye;
+        view.NearPlane = nearPlane;
+        view.FarPlane = farPlane;
+        return view;
+    }
+}
@@ -0,0 +1,98 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/RenderTargetPool.h"
+
+namespace Graphics
+{
+    u32 RenderTargetDesc::ResolveWidth(u32 screenWidth) const
+    {
+        if (!IsScreenRelative())
+            return Width;
+        return std::max(1u, static_cast<u32>(screenWidth * ScreenScale));
+    }
+
+    u32 RenderTargetDesc::ResolveHeight(u32 screenHeight) const
+    {
+        if (!IsScreenRelative())
+            return Height;
+        return std::max(1u, static_cast<u32>(screenHeight * ScreenScale));
+    }
+
+    u32 RenderTargetPlanner::GetBytesPerPixel(FBO_USAGE usage)
+    {
+        switch (usage)
+        {
+        case FBO_USAGE_REGULAR:         return 4 + 16 + 4 + 4 + 4; //3x RGBA8, RGBA32F, depth32F
+        case FBO_USAGE_COMPACT_GBUFFER: return 4 + 4 + 4 + 4;      //2x RGBA8, RG16, depth32F
+        case FBO_USAGE_FLOAT_BUFFER:    return 4 + 4;              //R32F, depth24
+        case FBO_USAGE_DEPTH_BUFFER:    return 2;                  //depth16
+        default:
+            Warning("Unknown framebuffer usage %d.", usage);
+            return 0;
+        }
+    }
+
+    RenderTargetPlan RenderTargetPlanner::Plan(std::vector<RenderTargetRequest> const& requests,
+                                               u32 screenWidth, u32 screenHeight)
+    {
+        RenderTargetPlan plan;
+        plan.TargetOfRequest.resize(requests.size());
+
+        //visit requests by first use, so a target freed by an earlier pass can
+        //be picked up by any later one (interval scheduling)
+        std::vector<u32> order(requests.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&requests](u32 lhs, u32 rhs)
+        {
+            return requests[lhs].FirstUse < requests[rhs].FirstUse;
+        });
+
+        for (u32 i : order)
+        {
+            RenderTargetRequest const& request = requests[i];
+            Assert(request.FirstUse <= request.LastUse, "Render target lifetime ends before it starts.");
+            u32 width = request.Desc.ResolveWidth(screenWidth);
+            u32 height = request.Desc.ResolveHeight(screenHeight);
+            u64 bytes = static_cast<u64>(width) * height * GetBytesPerPixel(request.Desc.Usage);
+            plan.BytesUnaliased += bytes;
+
+            u32 chosen = static_cast<u32>(plan.Targets.size());
+            for (u32 t = 0; t < plan.Targets.size(); ++t)
+            {
+                RenderTargetPlan::Target const& target = plan.Targets[t];
+                if (target.Usage == request.Desc.Usage && target.Width == width
+                    && target.Height == height && target.LastUse < request.FirstUse)
+                {
+                    chosen = t;
+                    break;
+                }
+            }
+
+            if (chosen == plan.Targets.size())
+            {
+                plan.Targets.push_back({ request.Desc.Usage, width, height, request.LastUse });
+                plan.BytesAliased += bytes;
+            }
+            else
+            {
+                plan.Targets[chosen].LastUse = request.LastUse;
+            }
+            plan.TargetOfRequest[i] = chosen;
+        }
+        return plan;
+    }
+
+    void RenderTargetPlanner::PrintPlan(RenderTargetPlan const& plan, std::ostream& os)
+    {
+        os << "Render targets: " << plan.TargetOfRequest.size() << " requested, "
+            << plan.Targets.size() << " allocated. "
+            << plan.BytesUnaliased / 1024 << " KB unaliased, "
+            << plan.BytesAliased / 1024 << " KB aliased.\n";
+        for (u32 i = 0; i < plan.TargetOfRequest.size(); ++i)
+        {
+            RenderTargetPlan::Target const& target = plan.Targets[plan.TargetOfRequest[i]];
+            os << "  request " << i << " -> target " << plan.TargetOfRequest[i]
+                << " (" << target.Width << "x" << target.Height << ", usage " << target.Usage << ")\n";
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include "framework/Utilities.h"
 #include "graphics/Color.h"
 #include "graphics/ShaderProgram.h"
+#include "math/Matrix3.h"
 #include "math/Matrix4.h"
 #include "math/Vector4.h"
 
@@ -17,6 +18,9 @@ namespace
     return strstr.str();
   }
 
+  static std::string ResolveIncludes(std::string const &source,
+    std::set<std::string> &included);
+
   // Performs a very inefficient (but conveniently small) way of reading the
   // entire shader text file as a string.
   static std::string ReadFile(std::string const &relativePath)
@@ -40,6 +44,7 @@ namespace
           out vec2 Uv1;//fixed border line                                                              \n\
                                                                                                         \n\
           uniform mat4 ModelMatrix; // local->world matrix                                              \n\
+          uniform mat3 NormalMatrix; // local->world matrix for normals                                 \n\
           uniform mat4 ModelViewProjectionMatrix; // local->NDC matrix [no camera support]              \n\
                                                                                                         \n\
                                                                                                         \n\
@@ -55,9 +60,8 @@ namespace
               // deal with position and normal in world space                                           \n\
               vec4 worldPos = ModelMatrix * vec4(vPosition, 1);                                         \n\
                                                                                                         \n\
-              // vec4(vNormal, 0) because we don't want to translate a normal;                          \n\
-              // NOTE: this code is wrong if we support non-uniform scaling                             \n\
-              worldNormal = normalize(ModelMatrix * vec4(vNormal, 0));                                  \n\
+              // the normal matrix keeps normals perpendicular under non-uniform scaling                \n\
+              worldNormal = vec4(normalize(NormalMatrix * vNormal), 0);                                 \n\
                                                                                                         \n\
               // compute the final result of passing this vertex through the transformation             \n\
               // pipeline and yielding a coordinate in NDC space                                        \n\
@@ -229,11 +233,49 @@ namespace
     Assert(fstream.good(), "Failed to read file: %s", file.c_str());
 
     // convenient (but slow) way of reading an entire file into a string
-    return std::string(std::istreambuf_iterator<char>(fstream),
+    std::string source = std::string(std::istreambuf_iterator<char>(fstream),
       std::istreambuf_iterator<char>());
+    std::set<std::string> included{ relativePath };
+    return ResolveIncludes(source, included);
 #endif
   }
 
+  // GLSL has no include directive, so lines of the form #include "file" are
+  // replaced here with the contents of that file (relative to shaders/). Each
+  // file is pasted at most once per shader, which doubles as an include guard.
+  static std::string ResolveIncludes(std::string const &source,
+    std::set<std::string> &included)
+  {
+    std::stringstream input(source);
+    std::stringstream output;
+    std::string line;
+    while (std::getline(input, line))
+    {
+      size_t directive = line.find("#include");
+      size_t open = line.find('"', directive);
+      size_t close = line.find('"', open + 1);
+      if (directive == std::string::npos
+        || directive != line.find_first_not_of(" \t")
+        || open == std::string::npos
+        || close == std::string::npos)
+      {
+        output << line << '\n';
+        continue;
+      }
+
+      std::string includePath = line.substr(open + 1, close - open - 1);
+      if (included.insert(includePath).second)
+      {
+        std::string file = GetFilePath(includePath);
+        std::ifstream fstream = std::ifstream(file);
+        Assert(fstream.good(), "Failed to read included file: %s", file.c_str());
+        output << ResolveIncludes(std::string(std::istreambuf_iterator<char>(fstream),
+          std::istreambuf_iterator<char>()), included) << '\n';
+      }
+    }
+    return output.str();
+  }
+
   // Verifies that the shader has compiled successfully. If anything went wrong,
   // it will warn with the message provided by the graphics driver. Each
   // shader object (and including the program object) contains an info log based
@@ -641,6 +683,14 @@ namespace Graphics
         glUniformMatrix4fv(location, 1, GL_TRUE, matrix.array);
     }
 
+    void ShaderProgram::SetUniform(std::string const &name,
+        Math::Matrix3 const &matrix)
+    {
+        // same row major layout as Matrix4, transposed on upload
+        u32 location = GetUniform(name);
+        glUniformMatrix3fv(location, 1, GL_TRUE, matrix.array);
+    }
+
     void ShaderProgram::SetUniform(std::string const &name, Color const &color)
     {
         // uploads the color to a vec4 using an array of floatss
@@ -0,0 +1,708 @@
+#include "Precompiled.h"
+#include "graphics/SoftwareRasterizer.h"
+#include "framework/Debug.h"
+#include "framework/ParallelFor.h"
+#include "graphics/Materials.h"
+#include "graphics/Texture.h"
+#include "graphics/TriangleMesh.h"
+#include "math/Quaternion.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+    using namespace Math;
+
+    //tile edge in pixels, a multiple of 4 for the SSE2 loop
+    const s32 c_tileSize = 32;
+    //screen positions are snapped to 1/16 pixel
+    const s32 c_subpixelBits = 4;
+    const s32 c_subpixels = 1 << c_subpixelBits;
+    //x and y are clipped at this many times w, far enough out that few triangles need it, close
+    //enough that the edge functions inside a tile stay in 32 bits for viewports up to c_maxViewport
+    const float c_guardBand = 2.0f;
+    const u32 c_maxViewport = 8192;
+    const u32 c_vertexChunk = 4096;
+    const u32 c_setupChunk = 4096;
+    const u32 c_noTriangle = 0xffffffffu;
+    //a pixel keeps its triangle as the setup chunk and the index in it; clipping makes at most
+    //seven triangles of one, so a chunk holds fewer than 1 << c_chunkShift
+    const u32 c_chunkShift = 15;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    Vector3 rgb(Graphics::Color const& color)
+    {
+        return Vector3(color.r, color.g, color.b);
+    }
+
+    //rounds towards negative infinity, unlike /
+    s32 floorDivide(s32 value, s32 divisor)
+    {
+        s32 quotient = value / divisor;
+        return quotient * divisor > value ? quotient - 1 : quotient;
+    }
+
+    //a vertex of a triangle being clipped, with its barycentric coordinates in the mesh triangle
+    struct ClipVertex
+    {
+        Vector4 Position;
+        Vector3 Corner;
+    };
+
+    //near, far and the four guard band planes, inside when >= 0
+    const int c_clipPlaneCount = 6;
+    float clipDistance(Vector4 const& p, int plane)
+    {
+        switch (plane)
+        {
+        case 0: return p.z + p.w;
+        case 1: return p.w - p.z;
+        case 2: return p.x + c_guardBand * p.w;
+        case 3: return c_guardBand * p.w - p.x;
+        case 4: return p.y + c_guardBand * p.w;
+        default: return c_guardBand * p.w - p.y;
+        }
+    }
+
+    //the planes of the view frustum a vertex is outside of, one bit each
+    u32 outcode(Vector4 const& p)
+    {
+        return (p.z < -p.w ? 1u : 0u) | (p.z > p.w ? 2u : 0u) | (p.x < -p.w ? 4u : 0u) | (p.x > p.w ? 8u : 0u)
+            | (p.y < -p.w ? 16u : 0u) | (p.y > p.w ? 32u : 0u);
+    }
+
+    //Sutherland-Hodgman against every clip plane, count is the vertices left
+    u32 clipPolygon(ClipVertex* polygon, u32 count)
+    {
+        ClipVertex clipped[3 + c_clipPlaneCount];
+        for (int plane = 0; plane < c_clipPlaneCount && count > 0; ++plane)
+        {
+            u32 kept = 0;
+            for (u32 i = 0; i < count; ++i)
+            {
+                ClipVertex const& current = polygon[i];
+                ClipVertex const& next = polygon[(i + 1) % count];
+                float currentDistance = clipDistance(current.Position, plane);
+                float nextDistance = clipDistance(next.Position, plane);
+                if (currentDistance >= 0.0f)
+                    clipped[kept++] = current;
+                if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+                {
+                    float t = currentDistance / (currentDistance - nextDistance);
+                    clipped[kept].Position = current.Position + (next.Position - current.Position) * t;
+                    clipped[kept].Corner = current.Corner + (next.Corner - current.Corner) * t;
+                    ++kept;
+                }
+            }
+            std::copy(clipped, clipped + kept, polygon);
+            count = kept;
+        }
+        return count;
+    }
+
+    float fraction(float value)
+    {
+        return value - Floor(value);
+    }
+
+    //shader.vert passes both fract(uv) and fract(uv + 0.5) - 0.5, and shader.frag takes the
+    //one that changes slower on screen so the wrap of the other is not smeared across a
+    //triangle; on a triangle that is the one with the smaller range
+    void pickUvs(float const* in, float* out)
+    {
+        float regular[3];
+        float shifted[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            regular[i] = fraction(in[i]);
+            shifted[i] = fraction(in[i] + 0.5f) - 0.5f;
+        }
+        float regularRange = Max(Max(regular[0], regular[1]), regular[2]) - Min(Min(regular[0], regular[1]), regular[2]);
+        float shiftedRange = Max(Max(shifted[0], shifted[1]), shifted[2]) - Min(Min(shifted[0], shifted[1]), shifted[2]);
+        float const* picked = regularRange < shiftedRange ? regular : shifted;
+        std::copy(picked, picked + 3, out);
+    }
+}
+
+namespace Graphics
+{
+    SoftwareRasterizer::SoftwareRasterizer(Settings const& settings)
+        : m_settings(settings)
+    {
+    }
+
+    void SoftwareRasterizer::BeginFrame(u32 width, u32 height, Color const& clearColor)
+    {
+        Assert(width <= c_maxViewport && height <= c_maxViewport, "SoftwareRasterizer renders up to %ux%u, not %ux%u.",
+               c_maxViewport, c_maxViewport, width, height);
+        m_width = Max(width, 1u);
+        m_height = Max(height, 1u);
+        m_tilesX = (m_width + c_tileSize - 1) / c_tileSize;
+        m_tilesY = (m_height + c_tileSize - 1) / c_tileSize;
+        m_clearColor = clearColor;
+        m_draws.clear();
+        m_stats = FrameStats();
+    }
+
+    void SoftwareRasterizer::SetView(RenderView const& view)
+    {
+        m_view = view;
+    }
+
+    void SoftwareRasterizer::SetLights(std::vector<LightAttribute> const& lights)
+    {
+        m_lights = lights;
+    }
+
+    void SoftwareRasterizer::Draw(std::shared_ptr<TriangleMesh> const& mesh, std::shared_ptr<Material> const& material,
+                                  Math::Matrix4 const& world)
+    {
+        if (!mesh || !material || mesh->GetPrimitiveCount() == 0)
+            return;
+        DrawCall draw;
+        draw.Mesh = mesh;
+        draw.MaterialRef = material;
+        std::shared_ptr<Texture> texture = material->GetDiffuseTexture();
+        if (material->IsDiffuseTextureEnabled() && texture && texture->HasPixels())
+            draw.DiffuseTexture = texture;
+        draw.World = world;
+        draw.NormalMatrix = world.Inverted().Transposed();
+        if (!m_draws.empty())
+        {
+            draw.FirstVertex = m_draws.back().FirstVertex + m_draws.back().VertexCount;
+            draw.FirstTriangle = m_draws.back().FirstTriangle + m_draws.back().TriangleCount;
+        }
+        draw.VertexCount = static_cast<u32>(mesh->GetVertexCount());
+        draw.TriangleCount = static_cast<u32>(mesh->GetPrimitiveCount());
+        m_draws.push_back(draw);
+    }
+
+    void SoftwareRasterizer::EndFrame()
+    {
+        m_image = std::make_shared<Texture>(m_width, m_height, Texture::Format::RGB);
+        u32 vertexCount = m_draws.empty() ? 0 : m_draws.back().FirstVertex + m_draws.back().VertexCount;
+        u32 triangleCount = m_draws.empty() ? 0 : m_draws.back().FirstTriangle + m_draws.back().TriangleCount;
+        m_stats.Draws = static_cast<u32>(m_draws.size());
+        m_stats.Triangles = triangleCount;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (DrawCall& draw : m_draws)
+        {
+            draw.WorldViewProj = m_view.ViewProj * draw.World;
+        }
+        m_clipPositions.resize(vertexCount);
+        m_worldPositions.resize(vertexCount);
+        m_worldNormals.resize(vertexCount);
+        ParallelFor(vertexCount, c_vertexChunk, [this](u32 begin, u32 end)
+        {
+            transformVertices(begin, end);
+        }, m_settings.MaxThreads);
+        m_stats.VertexMilliseconds = elapsedMilliseconds(start);
+
+        //every chunk bins its own triangles, the tiles read the chunks in order so the
+        //triangles are drawn in the order they were submitted
+        start = std::chrono::high_resolution_clock::now();
+        u32 chunkCount = (triangleCount + c_setupChunk - 1) / c_setupChunk;
+        u32 tileCount = m_tilesX * m_tilesY;
+        Assert(chunkCount <= (c_noTriangle >> c_chunkShift), "SoftwareRasterizer draws up to %u triangles a frame, not %u.",
+               (c_noTriangle >> c_chunkShift) * c_setupChunk, triangleCount);
+        m_chunkTriangles.resize(chunkCount);
+        m_chunkBins.resize(chunkCount);
+        for (std::vector<std::vector<u32>>& bins : m_chunkBins)
+        {
+            bins.resize(tileCount);
+        }
+        ParallelFor(triangleCount, c_setupChunk, [this](u32 begin, u32 end)
+        {
+            setupTriangles(begin / c_setupChunk, begin, end);
+        }, m_settings.MaxThreads);
+        for (std::vector<SetupTriangle> const& triangles : m_chunkTriangles)
+        {
+            m_stats.TrianglesSetUp += static_cast<u32>(triangles.size());
+        }
+        m_stats.SetupMilliseconds = elapsedMilliseconds(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        std::atomic<u32> pixelsShaded{ 0 };
+        ParallelFor(tileCount, 1, [this, &pixelsShaded](u32 begin, u32 end)
+        {
+            std::vector<float> depth(c_tileSize * c_tileSize);
+            std::vector<u32> triangles(c_tileSize * c_tileSize);
+            u32 shaded = 0;
+            for (u32 tile = begin; tile < end; ++tile)
+            {
+                shaded += renderTile(tile, depth, triangles);
+            }
+            pixelsShaded += shaded;
+        }, m_settings.MaxThreads);
+        m_stats.PixelsShaded = pixelsShaded;
+        m_stats.RasterMilliseconds = elapsedMilliseconds(start);
+    }
+
+    void SoftwareRasterizer::transformVertices(u32 begin, u32 end)
+    {
+        //the draw the first vertex belongs to, then the ones after it
+        auto draw = std::upper_bound(m_draws.begin(), m_draws.end(), begin,
+            [](u32 vertex, DrawCall const& call) { return vertex < call.FirstVertex; }) - 1;
+        for (u32 i = begin; i < end; ++i)
+        {
+            while (i >= draw->FirstVertex + draw->VertexCount)
+                ++draw;
+            TriangleMesh::Vertex const& vertex = draw->Mesh->GetVertex(i - draw->FirstVertex);
+            m_clipPositions[i] = Math::Transform(draw->WorldViewProj,
+                                                 Vector4(vertex.position.x, vertex.position.y, vertex.position.z, 1.0f));
+            m_worldPositions[i] = TransformPoint(draw->World, vertex.position);
+            //shader.vert normalizes the normal per vertex, shader.frag uses it interpolated as it is
+            Vector3 normal = TransformNormal(draw->NormalMatrix, vertex.normal);
+            float length = normal.Length();
+            m_worldNormals[i] = length > 0.0f ? normal * (1.0f / length) : normal;
+        }
+    }
+
+    void SoftwareRasterizer::setupTriangles(u32 chunk, u32 begin, u32 end)
+    {
+        m_chunkTriangles[chunk].clear();
+        for (std::vector<u32>& bin : m_chunkBins[chunk])
+        {
+            bin.clear();
+        }
+        const Vector3 identity[3] = { Vector3(1.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f) };
+        auto draw = std::upper_bound(m_draws.begin(), m_draws.end(), begin,
+            [](u32 triangle, DrawCall const& call) { return triangle < call.FirstTriangle; }) - 1;
+        for (u32 i = begin; i < end; ++i)
+        {
+            while (i >= draw->FirstTriangle + draw->TriangleCount)
+                ++draw;
+            u32 face = i - draw->FirstTriangle;
+            TriangleMesh::TriangleFace const& indices = draw->Mesh->GetTriangle(face);
+            Vector4 clip[3];
+            u32 outside = ~0u;
+            bool needsClipping = false;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                clip[corner] = m_clipPositions[draw->FirstVertex + indices.indices[corner]];
+                outside &= outcode(clip[corner]);
+                for (int plane = 0; plane < c_clipPlaneCount; ++plane)
+                {
+                    //also catches NaN
+                    needsClipping |= !(clipDistance(clip[corner], plane) >= 0.0f);
+                }
+            }
+            //all three corners outside the same plane of the frustum
+            if (outside != 0)
+                continue;
+            u32 drawIndex = static_cast<u32>(draw - m_draws.begin());
+            if (!needsClipping)
+            {
+                addTriangle(chunk, drawIndex, face, clip, identity);
+                continue;
+            }
+            ClipVertex polygon[3 + c_clipPlaneCount];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                polygon[corner].Position = clip[corner];
+                polygon[corner].Corner = identity[corner];
+            }
+            u32 count = clipPolygon(polygon, 3);
+            //a fan over the clipped polygon
+            for (u32 fan = 1; fan + 1 < count; ++fan)
+            {
+                Vector4 fanClip[3] = { polygon[0].Position, polygon[fan].Position, polygon[fan + 1].Position };
+                Vector3 fanCorners[3] = { polygon[0].Corner, polygon[fan].Corner, polygon[fan + 1].Corner };
+                addTriangle(chunk, drawIndex, face, fanClip, fanCorners);
+            }
+        }
+    }
+
+    void SoftwareRasterizer::addTriangle(u32 chunk, u32 draw, u32 face, Vector4 const* clip, Vector3 const* corners)
+    {
+        SetupTriangle triangle;
+        triangle.Draw = draw;
+        triangle.Face = face;
+        s32 x[3];
+        s32 y[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            //clipping leaves w positive, unless the matrices were degenerate
+            if (!(clip[i].w > 0.0f))
+                return;
+            float inverseW = 1.0f / clip[i].w;
+            //row 0 is the top of the image, at +1 in device coordinates
+            float screenX = (clip[i].x * inverseW * 0.5f + 0.5f) * m_width;
+            float screenY = (0.5f - clip[i].y * inverseW * 0.5f) * m_height;
+            x[i] = static_cast<s32>(Floor(screenX * c_subpixels + 0.5f));
+            y[i] = static_cast<s32>(Floor(screenY * c_subpixels + 0.5f));
+            triangle.Depth[i] = clip[i].z * inverseW * 0.5f + 0.5f;
+            triangle.InverseW[i] = inverseW;
+            triangle.Corners[i] = corners[i];
+        }
+        //pixels whose centers are in the bounding box, often none for triangles smaller than a pixel
+        const s32 half = c_subpixels / 2;
+        s32 minX = Min(Min(x[0], x[1]), x[2]) - half;
+        s32 minY = Min(Min(y[0], y[1]), y[2]) - half;
+        s32 maxX = Max(Max(x[0], x[1]), x[2]) - half;
+        s32 maxY = Max(Max(y[0], y[1]), y[2]) - half;
+        triangle.MinX = Max(floorDivide(minX + c_subpixels - 1, c_subpixels), 0);
+        triangle.MinY = Max(floorDivide(minY + c_subpixels - 1, c_subpixels), 0);
+        triangle.MaxX = Min(floorDivide(maxX, c_subpixels), static_cast<s32>(m_width) - 1);
+        triangle.MaxY = Min(floorDivide(maxY, c_subpixels), static_cast<s32>(m_height) - 1);
+        if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+            return;
+
+        s64 area = static_cast<s64>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<s64>(y[1] - y[0]) * (x[2] - x[0]);
+        if (area == 0)
+            return;
+        //both windings are drawn, the edge functions want one of them
+        if (area < 0)
+        {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(triangle.Depth[1], triangle.Depth[2]);
+            std::swap(triangle.InverseW[1], triangle.InverseW[2]);
+            std::swap(triangle.Corners[1], triangle.Corners[2]);
+            area = -area;
+        }
+        triangle.Area = area;
+
+        double depthStepX = 0.0;
+        double depthStepY = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            int a = (i + 1) % 3;
+            int b = (i + 2) % 3;
+            triangle.A[i] = y[a] - y[b];
+            triangle.B[i] = x[b] - x[a];
+            triangle.C[i] = static_cast<s64>(x[a]) * y[b] - static_cast<s64>(x[b]) * y[a];
+            //the gradient points inside: left edges have it to the right, top edges down
+            bool topLeft = triangle.A[i] > 0 || (triangle.A[i] == 0 && triangle.B[i] > 0);
+            triangle.Bias[i] = topLeft ? 0 : -1;
+            depthStepX += static_cast<double>(triangle.A[i]) * triangle.Depth[i];
+            depthStepY += static_cast<double>(triangle.B[i]) * triangle.Depth[i];
+        }
+        double inverseArea = 1.0 / area;
+        triangle.DepthStepX = static_cast<float>(depthStepX * c_subpixels * inverseArea);
+        triangle.DepthStepY = static_cast<float>(depthStepY * c_subpixels * inverseArea);
+
+        std::vector<SetupTriangle>& triangles = m_chunkTriangles[chunk];
+        u32 index = static_cast<u32>(triangles.size());
+        triangles.push_back(triangle);
+        std::vector<std::vector<u32>>& bins = m_chunkBins[chunk];
+        for (s32 tileY = triangle.MinY / c_tileSize; tileY <= triangle.MaxY / c_tileSize; ++tileY)
+        {
+            for (s32 tileX = triangle.MinX / c_tileSize; tileX <= triangle.MaxX / c_tileSize; ++tileX)
+            {
+                bins[tileY * m_tilesX + tileX].push_back(index);
+            }
+        }
+    }
+
+    u32 SoftwareRasterizer::renderTile(u32 tile, std::vector<float>& depth, std::vector<u32>& triangles) const
+    {
+        s32 tileX = static_cast<s32>(tile % m_tilesX) * c_tileSize;
+        s32 tileY = static_cast<s32>(tile / m_tilesX) * c_tileSize;
+        std::fill(depth.begin(), depth.end(), 1.0f);
+        std::fill(triangles.begin(), triangles.end(), c_noTriangle);
+        for (u32 chunk = 0; chunk < m_chunkBins.size(); ++chunk)
+        {
+            for (u32 local : m_chunkBins[chunk][tile])
+            {
+                rasterize(m_chunkTriangles[chunk][local], (chunk << c_chunkShift) | local, tileX, tileY,
+                          depth.data(), triangles.data());
+            }
+        }
+
+        //every covered pixel is shaded once, after the depth test picked its triangle
+        u32 shaded = 0;
+        s32 width = Min(c_tileSize, static_cast<s32>(m_width) - tileX);
+        s32 height = Min(c_tileSize, static_cast<s32>(m_height) - tileY);
+        Vector3 clearColor = rgb(m_clearColor);
+        for (s32 y = 0; y < height; ++y)
+        {
+            for (s32 x = 0; x < width; ++x)
+            {
+                u32 index = triangles[y * c_tileSize + x];
+                Vector3 color = clearColor;
+                if (index != c_noTriangle)
+                {
+                    SetupTriangle const& triangle = m_chunkTriangles[index >> c_chunkShift][index & ((1u << c_chunkShift) - 1)];
+                    color = shade(triangle, tileX + x, tileY + y);
+                    ++shaded;
+                }
+                //IntColor does not clamp, the GL framebuffer does
+                Color clamped(Clamp(color.x, 0.0f, 1.0f), Clamp(color.y, 0.0f, 1.0f), Clamp(color.z, 0.0f, 1.0f));
+                m_image->SetPixel(tileX + x, tileY + y, clamped);
+            }
+        }
+        return shaded;
+    }
+
+    void SoftwareRasterizer::rasterize(SetupTriangle const& triangle, u32 index, s32 tileX, s32 tileY, float* depth,
+                                       u32* triangles) const
+    {
+        s32 x0 = Max(triangle.MinX, tileX);
+        s32 y0 = Max(triangle.MinY, tileY);
+        s32 x1 = Min(triangle.MaxX, tileX + c_tileSize - 1);
+        s32 y1 = Min(triangle.MaxY, tileY + c_tileSize - 1);
+        if (x0 > x1 || y0 > y1)
+            return;
+        //whole groups of four pixels, still inside the tile
+        x0 = tileX + ((x0 - tileX) & ~3);
+        x1 = tileX + ((x1 - tileX) | 3);
+
+        //edge values at the first pixel center and their steps; an edge the whole rectangle is
+        //inside of is left out, the others cross it and stay in 32 bits over it
+        s32 edge[3];
+        s32 stepX[3];
+        s32 stepY[3];
+        s64 firstX = static_cast<s64>(x0) * c_subpixels + c_subpixels / 2;
+        s64 firstY = static_cast<s64>(y0) * c_subpixels + c_subpixels / 2;
+        double depthAtFirst = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            s64 value = triangle.A[i] * firstX + triangle.B[i] * firstY + triangle.C[i];
+            depthAtFirst += static_cast<double>(value) * triangle.Depth[i];
+            value += triangle.Bias[i];
+            s64 acrossX = static_cast<s64>(triangle.A[i]) * c_subpixels * (x1 - x0);
+            s64 acrossY = static_cast<s64>(triangle.B[i]) * c_subpixels * (y1 - y0);
+            s64 lowest = value + Min(acrossX, s64(0)) + Min(acrossY, s64(0));
+            s64 highest = value + Max(acrossX, s64(0)) + Max(acrossY, s64(0));
+            if (highest < 0)
+                return;
+            bool inside = lowest >= 0;
+            edge[i] = inside ? 0 : static_cast<s32>(value);
+            stepX[i] = inside ? 0 : triangle.A[i] * c_subpixels;
+            stepY[i] = inside ? 0 : triangle.B[i] * c_subpixels;
+        }
+        float firstDepth = static_cast<float>(depthAtFirst / triangle.Area);
+
+        //the same arithmetic in both loops, so they give the same image
+        if (m_settings.Simd)
+        {
+            const __m128i none = _mm_set1_epi32(-1);
+            const __m128i triangleIndex = _mm_set1_epi32(static_cast<int>(index));
+            const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 depthStepX = _mm_set1_ps(triangle.DepthStepX);
+            __m128i laneSteps[3];
+            __m128i groupSteps[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                laneSteps[i] = _mm_setr_epi32(0, stepX[i], 2 * stepX[i], 3 * stepX[i]);
+                groupSteps[i] = _mm_set1_epi32(4 * stepX[i]);
+            }
+            for (s32 y = y0; y <= y1; ++y)
+            {
+                s32 row = y - y0;
+                __m128i e0 = _mm_add_epi32(_mm_set1_epi32(edge[0] + stepY[0] * row), laneSteps[0]);
+                __m128i e1 = _mm_add_epi32(_mm_set1_epi32(edge[1] + stepY[1] * row), laneSteps[1]);
+                __m128i e2 = _mm_add_epi32(_mm_set1_epi32(edge[2] + stepY[2] * row), laneSteps[2]);
+                __m128 rowDepth = _mm_set1_ps(firstDepth + triangle.DepthStepY * static_cast<float>(row));
+                float* depthRow = depth + (y - tileY) * c_tileSize;
+                u32* triangleRow = triangles + (y - tileY) * c_tileSize;
+                for (s32 x = x0; x <= x1; x += 4)
+                {
+                    //inside when no edge value has its sign bit set
+                    __m128i covered = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), none);
+                    if (_mm_movemask_epi8(covered))
+                    {
+                        __m128 offsets = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - x0)), laneOffsets);
+                        __m128 z = _mm_add_ps(rowDepth, _mm_mul_ps(depthStepX, offsets));
+                        __m128 stored = _mm_loadu_ps(depthRow + (x - tileX));
+                        __m128i pass = _mm_and_si128(covered, _mm_castps_si128(_mm_cmplt_ps(z, stored)));
+                        __m128 passDepth = _mm_castsi128_ps(pass);
+                        _mm_storeu_ps(depthRow + (x - tileX), _mm_or_ps(_mm_and_ps(passDepth, z), _mm_andnot_ps(passDepth, stored)));
+                        __m128i* indices = reinterpret_cast<__m128i*>(triangleRow + (x - tileX));
+                        _mm_storeu_si128(indices, _mm_or_si128(_mm_and_si128(pass, triangleIndex),
+                                                               _mm_andnot_si128(pass, _mm_loadu_si128(indices))));
+                    }
+                    e0 = _mm_add_epi32(e0, groupSteps[0]);
+                    e1 = _mm_add_epi32(e1, groupSteps[1]);
+                    e2 = _mm_add_epi32(e2, groupSteps[2]);
+                }
+            }
+            return;
+        }
+
+        for (s32 y = y0; y <= y1; ++y)
+        {
+            s32 row = y - y0;
+            float rowDepth = firstDepth + triangle.DepthStepY * static_cast<float>(row);
+            float* depthRow = depth + (y - tileY) * c_tileSize;
+            u32* triangleRow = triangles + (y - tileY) * c_tileSize;
+            for (s32 x = x0; x <= x1; ++x)
+            {
+                s32 column = x - x0;
+                s32 e0 = edge[0] + stepY[0] * row + stepX[0] * column;
+                s32 e1 = edge[1] + stepY[1] * row + stepX[1] * column;
+                s32 e2 = edge[2] + stepY[2] * row + stepX[2] * column;
+                if ((e0 | e1 | e2) < 0)
+                    continue;
+                float z = rowDepth + triangle.DepthStepX * static_cast<float>(column);
+                if (z < depthRow[x - tileX])
+                {
+                    depthRow[x - tileX] = z;
+                    triangleRow[x - tileX] = index;
+                }
+            }
+        }
+    }
+
+    Math::Vector3 SoftwareRasterizer::shade(SetupTriangle const& triangle, s32 x, s32 y) const
+    {
+        //perspective correct barycentric coordinates of the pixel center in the mesh triangle
+        s64 centerX = static_cast<s64>(x) * c_subpixels + c_subpixels / 2;
+        s64 centerY = static_cast<s64>(y) * c_subpixels + c_subpixels / 2;
+        double weights[3];
+        double weightSum = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            s64 value = triangle.A[i] * centerX + triangle.B[i] * centerY + triangle.C[i];
+            weights[i] = static_cast<double>(value) / triangle.Area * triangle.InverseW[i];
+            weightSum += weights[i];
+        }
+        Vector3 barycentric(0.0f);
+        for (int i = 0; i < 3; ++i)
+        {
+            barycentric += triangle.Corners[i] * static_cast<float>(weights[i] / weightSum);
+        }
+
+        DrawCall const& draw = m_draws[triangle.Draw];
+        TriangleMesh::TriangleFace const& face = draw.Mesh->GetTriangle(triangle.Face);
+        Vector3 position(0.0f);
+        Vector3 normal(0.0f);
+        float u[3];
+        float v[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            u32 vertex = draw.FirstVertex + face.indices[i];
+            position += m_worldPositions[vertex] * barycentric[i];
+            normal += m_worldNormals[vertex] * barycentric[i];
+            Vector2 const& uv = draw.Mesh->GetVertex(face.indices[i]).uv;
+            u[i] = uv.x;
+            v[i] = uv.y;
+        }
+        pickUvs(u, u);
+        pickUvs(v, v);
+        Vector2 uv(u[0] * barycentric.x + u[1] * barycentric.y + u[2] * barycentric.z,
+                   v[0] * barycentric.x + v[1] * barycentric.y + v[2] * barycentric.z);
+
+        //shader.frag, including its fog per light and its specular term
+        Material const& material = *draw.MaterialRef;
+        Vector3 light(1.0f);
+        if (material.IfReceiveLight())
+        {
+            Vector3 toPixel = position - m_view.Position;
+            float fog = (m_view.FarPlane - toPixel.Length()) / (m_view.FarPlane - m_view.NearPlane);
+            Vector3 fogColor = rgb(m_view.FogColor);
+            light = Vector3(0.0f);
+            for (LightAttribute const& attribute : m_lights)
+            {
+                if (!attribute.isActive)
+                    continue;
+                //point and spot lights are still black in the forward shader
+                Vector3 lit(0.0f);
+                if (attribute.lightType == LightType::Directional)
+                {
+                    Vector3 toLight = -Vector3(attribute.direction.x, attribute.direction.y, attribute.direction.z).Normalized();
+                    Vector3 ambient = rgb(attribute.ambientColor) * rgb(material.GetAmbientColor());
+                    Vector3 diffuse = rgb(attribute.diffuseColor) * rgb(material.GetDiffuseColor()) * Max(Dot(normal, toLight), 0.0f);
+                    Vector3 reflected = toLight - normal * (2.0f * Dot(normal, toLight));
+                    Vector3 specular = rgb(attribute.specularColor) * rgb(material.GetSpecularColor())
+                        * Pow(Max(Dot(reflected, toPixel), 0.0f), material.GetSpecularExponent());
+                    lit = (ambient + diffuse + specular) * attribute.intensity;
+                }
+                light += lit * fog + fogColor * (1.0f - fog);
+            }
+            light += rgb(material.GetEmissiveColor());
+        }
+        Vector3 texture(1.0f);
+        if (draw.DiffuseTexture)
+            texture = rgb(draw.DiffuseTexture->SampleBilinear(uv.x, uv.y));
+        return light * texture;
+    }
+
+    SoftwareRasterizer::Benchmark SoftwareRasterizer::Measure(std::shared_ptr<TriangleMesh> const& mesh,
+                                                              std::shared_ptr<Material> const& material,
+                                                              u32 width, u32 height, u32 copies,
+                                                              std::string const& imagePath)
+    {
+        Benchmark result;
+        result.Width = width;
+        result.Height = height;
+        //the copies in a square grid on the ground, seen from above at an angle
+        u32 columns = Max(static_cast<u32>(Ceil(Sqrt(static_cast<float>(copies)))), 1u);
+        const float spacing = 1.25f;
+        float extent = spacing * columns;
+        RenderView view = RenderView::LookAt(Vector3(0.0f, extent * 0.6f, extent * 0.9f), Vector3(0.0f),
+                                             c_Pi / 3.0f, float(width) / float(height));
+        std::vector<LightAttribute> lights(1);
+        lights[0].direction = Vector4(-0.5f, -1.0f, -0.3f, 0.0f);
+        lights[0].ambientColor = Color(0.1f, 0.1f, 0.1f);
+        lights[0].specularColor = Color(0.5f, 0.5f, 0.5f);
+        std::vector<Matrix4> worlds;
+        for (u32 i = 0; i < copies; ++i)
+        {
+            Vector3 position((i % columns + 0.5f - columns * 0.5f) * spacing, 0.0f,
+                             (i / columns + 0.5f - columns * 0.5f) * spacing);
+            worlds.push_back(BuildTransform(position, Quaternion::c_Identity, Vector3(1.0f)));
+        }
+
+        auto render = [&](Settings const& settings, float& milliseconds, float* submitNanoseconds)
+        {
+            SoftwareRasterizer rasterizer(settings);
+            //the first frame warms up the buffers and the caches, the second is timed
+            for (int frame = 0; frame < 2; ++frame)
+            {
+                rasterizer.BeginFrame(width, height, Color(0.1f, 0.1f, 0.1f));
+                rasterizer.SetView(view);
+                rasterizer.SetLights(lights);
+                auto start = std::chrono::high_resolution_clock::now();
+                for (Matrix4 const& world : worlds)
+                {
+                    rasterizer.Draw(mesh, material, world);
+                }
+                if (submitNanoseconds)
+                    *submitNanoseconds = elapsedMilliseconds(start) * 1e6f / Max(copies, 1u);
+                start = std::chrono::high_resolution_clock::now();
+                rasterizer.EndFrame();
+                milliseconds = elapsedMilliseconds(start);
+            }
+            result.Draws = rasterizer.GetFrameStats().Draws;
+            result.Triangles = rasterizer.GetFrameStats().Triangles;
+            result.TrianglesSetUp = rasterizer.GetFrameStats().TrianglesSetUp;
+            result.PixelsShaded = rasterizer.GetFrameStats().PixelsShaded;
+            return rasterizer.ReadColor();
+        };
+        Settings settings;
+        result.Threads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::shared_ptr<Texture> image = render(settings, result.Milliseconds, &result.SubmitNanoseconds);
+        if (!imagePath.empty())
+            Texture::SavePNG(image, imagePath);
+        settings.MaxThreads = 1;
+        std::shared_ptr<Texture> oneThread = render(settings, result.SingleThreadMilliseconds, nullptr);
+        settings.Simd = false;
+        std::shared_ptr<Texture> scalar = render(settings, result.ScalarMilliseconds, nullptr);
+        result.MegaTrianglesPerSecond = result.Triangles / (1000.0f * Max(result.Milliseconds, 1e-3f));
+
+        result.ImagesMatch = true;
+        for (u32 y = 0; y < height && result.ImagesMatch; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                Texture::IntColor const* a = image->GetPixel(x, y);
+                Texture::IntColor const* b = oneThread->GetPixel(x, y);
+                Texture::IntColor const* c = scalar->GetPixel(x, y);
+                if (std::memcmp(a, b, 3) != 0 || std::memcmp(a, c, 3) != 0)
+                {
+                    result.ImagesMatch = false;
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+}
@@ -2,13 +2,22 @@
 #include "framework/Debug.h"
 #include "graphics/ShaderProgram.h"
 #include "graphics/Texture.h"
+#include "graphics/ImageEncoder.h"
+#include "graphics/JpegSimd.h"
 
+//the JPEG decoder takes its IDCT and color conversion from JpegSimd
+#define STBI_SIMD
 #include <STB/stb_image.h>
-#include <STB/stb_image_write.h>
 
 static u8 const UnbuiltTexture = 0;
 static u8 const UnboundTexture = -1;
 
+static float ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+  std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+  return elapsed.count();
+}
+
 // Converts the relativePath path to a useful relativePath path (based on the local
 // directory of the executable). This assumes ASSET_PATH is correct.
 static std::string GetFilePath(std::string const &relativePath)
@@ -18,10 +27,28 @@ static std::string GetFilePath(std::string const &relativePath)
   return strstr.str();
 }
 
+// GL format of a block compressed texture, 0 if the context cannot sample it.
+static GLenum GetCompressedFormat(Graphics::BlockFormat format)
+{
+  switch (format)
+  {
+  case Graphics::BlockFormat::BC1:
+    return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+  case Graphics::BlockFormat::BC3:
+    return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+  case Graphics::BlockFormat::BC5:
+    return (GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc) ? GL_COMPRESSED_RG_RGTC2 : 0;
+  case Graphics::BlockFormat::BC7:
+    return (GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc) ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+  default:
+    return 0;
+  }
+}
+
 namespace Graphics
 {
     Texture::Texture(u32 width, u32 height, Format format/* = Format::RGB*/)
-        : m_pixels(new u8[width * height * sizeof(IntColor)]), m_width(width),
+        : m_pixels(AllocatePixels(width * height * sizeof(IntColor))), m_width(width),
         m_height(height), m_textureHandle(UnbuiltTexture), m_boundSlot(UnboundTexture),
         m_bpp(format == Format::RGB ? 3 : 4), m_format(format)
     {
@@ -39,7 +66,7 @@ namespace Graphics
     Texture::~Texture()
     {
         Destroy();
-        delete[] m_pixels;
+        FreePixels(m_pixels);
     }
 
     void Texture::Build()
@@ -48,30 +75,69 @@ namespace Graphics
             "Cannot build already built texture.");
 
         GLenum format = (m_format == Format::RGB) ? GL_RGB : GL_RGBA;
+        // sized, so texture arrays can be made with the same storage (see TextureManager)
+        GLenum internalFormat = (m_format == Format::RGB) ? GL_RGB8 : GL_RGBA8;
 
         // create a new texture
         glGenTextures(1, &m_textureHandle);
         // bind the generated texture and upload its image contents to OpenGL
         glBindTexture(GL_TEXTURE_2D, m_textureHandle);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        GLint levelCount = static_cast<GLint>(GetLevelCount() - m_residentLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, m_pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        // RGB rows of small mips are not 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (!m_levels.empty())
+        {
+            // streamed textures start at their finest resident level, which
+            // becomes level 0 of a smaller GL texture
+            GLenum compressedFormat = GetCompressedFormat(m_blockFormat);
+            for (GLint i = 0; i < levelCount; ++i)
+            {
+                MipLevel const& level = m_levels[m_residentLevel + i];
+                if (m_blockFormat == BlockFormat::None)
+                {
+                    glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.Width, level.Height, 0, format, GL_UNSIGNED_BYTE, level.Pixels.data());
+                }
+                else if (compressedFormat)
+                {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, i, compressedFormat, level.Width, level.Height, 0,
+                        static_cast<GLsizei>(level.Pixels.size()), level.Pixels.data());
+                }
+                else
+                {
+                    // the driver can't sample this format, upload it decoded on the CPU
+                    std::vector<u8> decoded = BlockCompressor::Decompress(level.Pixels.data(), level.Width, level.Height, m_blockFormat);
+                    glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.Width, level.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+                }
+            }
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, m_pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
         // unbind the texture
         glBindTexture(GL_TEXTURE_2D, 0);
         m_isBuilt = true;
+        ++m_buildCount;
     }
 
     void Texture::ReplaceAndBuild(u8* pix, u32 width, u32 height, u8 bpp)
     {
         Destroy();
-        delete[] m_pixels;
+        FreePixels(m_pixels);
 
-        m_pixels = new u8[width * height * bpp * sizeof u8];
-        std::memcpy(m_pixels, pix, width * height * bpp * sizeof u8);
+        m_pixels = AllocatePixels(width * height * bpp * sizeof(u8));
+        std::memcpy(m_pixels, pix, width * height * bpp * sizeof(u8));
+        m_levels.clear();
+        m_blockFormat = BlockFormat::None;
+        m_residentLevel = 0;
         m_bpp = bpp;
         m_width = width;
         m_height = height;
@@ -81,10 +147,17 @@ namespace Graphics
     void Texture::ReplaceAndBuild(std::shared_ptr<Texture> rhs)
     {
         Destroy();
-        delete[] m_pixels;
+        FreePixels(m_pixels);
 
-        m_pixels = new u8[rhs->m_width * rhs->m_height *  rhs->m_bpp * sizeof u8]();
-        std::memcpy(m_pixels, rhs->m_pixels, rhs->m_width * rhs->m_height * rhs->m_bpp * sizeof u8);
+        m_pixels = nullptr;
+        if (rhs->m_pixels) // textures from the cache have none
+        {
+            m_pixels = AllocatePixels(rhs->m_width * rhs->m_height *  rhs->m_bpp * sizeof(u8));
+            std::memcpy(m_pixels, rhs->m_pixels, rhs->m_width * rhs->m_height * rhs->m_bpp * sizeof(u8));
+        }
+        m_levels = rhs->m_levels;
+        m_blockFormat = rhs->m_blockFormat;
+        m_residentLevel = rhs->m_residentLevel;
         m_bpp = rhs->m_bpp;
         m_format = rhs->m_format;
         m_width = rhs->m_width;
@@ -94,12 +167,95 @@ namespace Graphics
 
     }
 
+    void Texture::MoveAndBuild(Texture& rhs)
+    {
+        Destroy();
+        FreePixels(m_pixels);
+
+        m_pixels = rhs.m_pixels;
+        rhs.m_pixels = nullptr;
+        m_levels = std::move(rhs.m_levels);
+        rhs.m_levels.clear();
+        m_blockFormat = rhs.m_blockFormat;
+        m_residentLevel = rhs.m_residentLevel;
+        m_bpp = rhs.m_bpp;
+        m_format = rhs.m_format;
+        m_width = rhs.m_width;
+        m_height = rhs.m_height;
+        m_textureName = rhs.m_textureName;
+        Build();
+    }
+
+    u8* Texture::AllocatePixels(size_t size)
+    {
+        // stbi_image_free is free, so decoded images are malloc'd
+        return static_cast<u8*>(std::malloc(size));
+    }
+
+    void Texture::FreePixels(u8* pixels)
+    {
+        std::free(pixels);
+    }
+
+    u8* Texture::pixelData() const
+    {
+        if (m_pixels || m_levels.empty() || m_blockFormat != BlockFormat::None || m_residentLevel > 0)
+            return m_pixels;
+        return const_cast<u8*>(m_levels.front().Pixels.data());
+    }
+
     void Texture::DownloadContents()
     {
         GLenum format = (m_format == Format::RGB) ? GL_RGB : GL_RGBA;
+        if (m_pixels == nullptr)//render targets have no CPU copy until asked for one
+            m_pixels = AllocatePixels(m_width * m_height * m_bpp);
         glGetTexImage(GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, m_pixels);
     }
 
+    u32 Texture::GetLevelCount() const
+    {
+        return m_levels.empty() ? 1 : static_cast<u32>(m_levels.size());
+    }
+
+    u32 Texture::GetStorageFormat() const
+    {
+        if (m_blockFormat == BlockFormat::None)
+            return (m_format == Format::RGB) ? GL_RGB8 : GL_RGBA8;
+        GLenum compressedFormat = GetCompressedFormat(m_blockFormat);
+        // formats the context can't sample are uploaded decoded
+        return compressedFormat ? compressedFormat : GL_RGBA8;
+    }
+
+    u64 Texture::GetLevelBytes(u32 level) const
+    {
+        u32 width = std::max(m_width >> level, 1u);
+        u32 height = std::max(m_height >> level, 1u);
+        if (m_blockFormat != BlockFormat::None)
+            return BlockCompressor::GetCompressedSize(m_blockFormat, width, height);
+        return u64(width) * height * m_bpp;
+    }
+
+    void Texture::SetResidentLevel(u32 level)
+    {
+        Assert(!m_levels.empty() && level < m_levels.size(), "Only streamed textures can change their resident level.");
+        for (u32 i = level; i < m_residentLevel; ++i)
+        {
+            Assert(!m_levels[i].Pixels.empty(), "Level %d of texture \"%s\" is not loaded.", i, m_textureName.c_str());
+        }
+        for (u32 i = m_residentLevel; i < level; ++i)
+        {
+            std::vector<u8>().swap(m_levels[i].Pixels);
+        }
+        m_residentLevel = level;
+        Destroy();
+        Build();
+    }
+
+    void Texture::SetLevelPixels(u32 level, std::vector<u8> pixels)
+    {
+        m_levels[level].Pixels = std::move(pixels);
+    }
+
     bool Texture::IsBound() const
     {
         return m_boundSlot != UnboundTexture;
@@ -155,14 +311,54 @@ namespace Graphics
         return m_bpp;
     }
 
+    bool Texture::HasPixels() const
+    {
+        return pixelData() != nullptr;
+    }
+
     Texture::IntColor const* Texture::GetPixel(u32 x, u32 y) const
     {
-        return &reinterpret_cast<IntColor const *>(m_pixels)[(y * m_width) + x];
+        size_t offset = ((y * m_width) + x) * m_bpp;
+        return reinterpret_cast<IntColor const *>(pixelData() + offset);
+    }
+
+    Color Texture::SampleBilinear(f32 u, f32 v) const
+    {
+        auto wrap = [](s64 coordinate, u32 size)
+        {
+            s64 wrapped = coordinate % static_cast<s64>(size);
+            return static_cast<u32>(wrapped < 0 ? wrapped + size : wrapped);
+        };
+        float x = u * m_width - 0.5f;
+        float y = v * m_height - 0.5f;
+        float x0 = std::floor(x);
+        float y0 = std::floor(y);
+        float fx = x - x0;
+        float fy = y - y0;
+        float texels[2][2][3];
+        for (int j = 0; j < 2; ++j)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                IntColor const* texel = GetPixel(wrap(static_cast<s64>(x0) + i, m_width), wrap(static_cast<s64>(y0) + j, m_height));
+                texels[j][i][0] = texel->r / 255.0f;
+                texels[j][i][1] = texel->g / 255.0f;
+                texels[j][i][2] = texel->b / 255.0f;
+            }
+        }
+        float channels[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            float top = texels[0][0][c] * (1.0f - fx) + texels[0][1][c] * fx;
+            float bottom = texels[1][0][c] * (1.0f - fx) + texels[1][1][c] * fx;
+            channels[c] = top * (1.0f - fy) + bottom * fy;
+        }
+        return Color(channels[0], channels[1], channels[2]);
     }
 
     void Texture::SetPixel(u32 x, u32 y, IntColor const& color)
     {
-        u8* channels = m_pixels + (((y * m_width) + x) * m_bpp);
+        u8* channels = pixelData() + (((y * m_width) + x) * m_bpp);
         *(channels + 0) = color.r;
         *(channels + 1) = color.g;
         *(channels + 2) = color.b;
@@ -187,7 +383,7 @@ namespace Graphics
     Texture::IntColor* Texture::GetPixel(u32 x, u32 y)
     {
         size_t offset = ((y * m_width) + x) * m_bpp;
-        return reinterpret_cast<IntColor *>(m_pixels + offset);
+        return reinterpret_cast<IntColor *>(pixelData() + offset);
     }
     
     std::shared_ptr<Texture> Texture::LoadFromFile(std::string const &relativePath)
@@ -196,6 +392,14 @@ namespace Graphics
         // (relativePath to the executable itself)
         std::string path = GetFilePath(relativePath);
 
+        static bool const jpegSimd = []()
+        {
+            stbi_install_idct(&JpegSimd::Idct8x8);
+            stbi_install_YCbCr_to_RGB(&JpegSimd::YCbCrToRgbRow);
+            return true;
+        }();
+        (void)jpegSimd;
+
         // attempt to load a PNG/TGA file using STB Image
         int width = 0, height = 0, bpp = 0;
         void *data = stbi_load(path.c_str(), &width, &height, &bpp, STBI_rgb);
@@ -208,17 +412,14 @@ namespace Graphics
         Assert(bpp == 3, "Error: Can only handle RGB images in the CS300 framework."
             " No alpha channels supported. Read file with bpp=%d", bpp);
 
-        Texture *texture = nullptr;
-        if (bpp == 3) // successfully read an image with 3 channels of data
+        if (bpp != 3)
         {
-            // copy data from loaded STB image buffer to local pixel buffer
-            u8 *pixelData = new u8[width * height * bpp];
-            std::memcpy(pixelData, data, width * height * bpp);
-            texture = new Texture(pixelData, u32(width), u32(height), Format::RGB);
+            stbi_image_free(data);
+            return nullptr;
         }
-
-        stbi_image_free(data);
-        return std::shared_ptr<Texture>(texture);
+        // successfully read an image with 3 channels of data, the texture
+        // takes over the STB image buffer (see AllocatePixels)
+        return std::make_shared<Texture>(static_cast<u8*>(data), u32(width), u32(height), Format::RGB);
     }
 
     void Texture::SavePNG(std::shared_ptr<Texture> const &texture,
@@ -229,9 +430,87 @@ namespace Graphics
 
     void Texture::SavePNG(Texture const *texture, std::string const &path)
     {
-        u32 width = texture->m_width;
-        u32 compCount = (texture->m_format == Format::RGB) ? 3 : 4;
-        stbi_write_png(path.c_str(), width, texture->m_height,
-            compCount, texture->m_pixels, width * compCount * sizeof(u8));
+        u8 compCount = (texture->m_format == Format::RGB) ? 3 : 4;
+        ImageEncoder::WriteFile(path, texture->pixelData(), texture->m_width, texture->m_height,
+            compCount, ImageFormat::PNG);
+    }
+
+    Texture::DecodeBenchmark Texture::MeasureDecode(std::string const& relativePath)
+    {
+        DecodeBenchmark result;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<Texture> texture = LoadFromFile(relativePath);
+        result.DecodeMilliseconds = ElapsedMilliseconds(start);
+        if (!texture)
+            return result;
+        result.Width = texture->m_width;
+        result.Height = texture->m_height;
+
+        //the JPEG stages on random blocks with the value ranges of real images
+        const int blockCount = 4096;
+        const int rowLength = 1024;
+        const int rowCount = 256;
+        std::mt19937 random(1);
+        std::vector<short> coefficients(blockCount * 64);
+        std::vector<unsigned short> quantizers(blockCount * 64);
+        for (int i = 0; i < blockCount * 64; ++i)
+        {
+            int frequency = i % 64;
+            int range = frequency == 0 ? 2047 : (frequency < 10 ? 200 : (random() % 3 ? 0 : 60));
+            quantizers[i] = static_cast<unsigned short>(1 + random() % 40);
+            coefficients[i] = static_cast<short>((static_cast<int>(random() % (2 * range + 1)) - range) / quantizers[i]);
+        }
+        std::vector<u8> scalarOut(blockCount * 64), simdOut(blockCount * 64);
+        std::vector<short> work(coefficients);
+        start = std::chrono::high_resolution_clock::now();
+        for (int b = 0; b < blockCount; ++b)
+            stbi__idct_block(&scalarOut[b * 64], 8, &work[b * 64], &quantizers[b * 64]);
+        result.ScalarIdctMilliseconds = ElapsedMilliseconds(start);
+        work = coefficients;
+        start = std::chrono::high_resolution_clock::now();
+        for (int b = 0; b < blockCount; ++b)
+            JpegSimd::Idct8x8(&simdOut[b * 64], 8, &work[b * 64], &quantizers[b * 64]);
+        result.SimdIdctMilliseconds = ElapsedMilliseconds(start);
+        result.KernelsMatch = scalarOut == simdOut;
+
+        std::vector<u8> planes(rowLength * rowCount * 3);
+        for (u8& sample : planes)
+            sample = static_cast<u8>(random());
+        //the scalar conversion always writes a 4th byte, even with a step of 3
+        scalarOut.assign(rowLength * rowCount * 3 + 1, 0);
+        simdOut.assign(rowLength * rowCount * 3 + 1, 0);
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < rowCount; ++r)
+        {
+            u8 const* row = &planes[r * rowLength * 3];
+            stbi__YCbCr_to_RGB_row(&scalarOut[r * rowLength * 3], row, row + rowLength, row + 2 * rowLength, rowLength, 3);
+        }
+        result.ScalarColorMilliseconds = ElapsedMilliseconds(start);
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < rowCount; ++r)
+        {
+            u8 const* row = &planes[r * rowLength * 3];
+            JpegSimd::YCbCrToRgbRow(&simdOut[r * rowLength * 3], row, row + rowLength, row + 2 * rowLength, rowLength, 3);
+        }
+        result.SimdColorMilliseconds = ElapsedMilliseconds(start);
+        result.KernelsMatch = result.KernelsMatch && std::equal(scalarOut.begin(), scalarOut.end() - 1, simdOut.begin());
+
+        //the copies a cache load made before textures took over their buffers:
+        //level 0 out of the level table, then everything again on upload
+        u64 baseBytes = u64(result.Width) * result.Height * texture->m_bpp;
+        std::vector<MipLevel> levels = MipGenerator::Generate(texture->m_pixels, result.Width, result.Height, texture->m_bpp,
+            MipFilter::Box, true);
+        start = std::chrono::high_resolution_clock::now();
+        {
+            u8* base = AllocatePixels(baseBytes);
+            std::memcpy(base, texture->m_pixels, baseBytes);
+            u8* uploaded = AllocatePixels(baseBytes);
+            std::memcpy(uploaded, base, baseBytes);
+            std::vector<MipLevel> uploadedLevels = levels;
+            FreePixels(base);
+            FreePixels(uploaded);
+        }
+        result.CopyMilliseconds = ElapsedMilliseconds(start);
+        return result;
     }
 }
@@ -0,0 +1,359 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/Texture.h"
+#include "graphics/TextureCache.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace
+{
+    const char c_magic[4] = { 'D', 'G', 'T', 'X' };
+    const u32 c_version = 2;
+    const char* const c_cacheExtension = ".dgtx";
+
+    std::string getFilePath(std::string const& relativePath)
+    {
+        std::stringstream strstr;
+        strstr << ASSET_PATH << "textures/" << relativePath;
+        return strstr.str();
+    }
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream& file, T value)
+    {
+        file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::ifstream& file, T& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    //header: magic, version, width, height, channels/filter/usage/format, level count, source size, source time
+    const u64 c_headerBytes = 4 + 4 + 4 + 4 + 4 + 4 + 8 + 8;
+    //per level: width, height, offset, size
+    const u64 c_levelEntryBytes = 4 + 4 + 8 + 8;
+}
+
+namespace Graphics
+{
+    std::string TextureCache::GetCachePath(std::string const& relativePath)
+    {
+        return relativePath + c_cacheExtension;
+    }
+
+    TextureUsage TextureCache::GuessUsage(std::string const& relativePath)
+    {
+        std::string name = relativePath.substr(relativePath.find_last_of("/\\") + 1);
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+        std::string stem = name.substr(0, name.find_last_of('.'));
+        bool suffix = stem.size() > 2 && stem.compare(stem.size() - 2, 2, "_n") == 0;
+        return suffix || name.find("normal") != std::string::npos ? TextureUsage::NormalMap : TextureUsage::Color;
+    }
+
+    BlockFormat TextureCache::ChooseFormat(TextureCompression compression, TextureUsage usage, u8 channels)
+    {
+        if (compression == TextureCompression::None)
+            return BlockFormat::None;
+        if (usage == TextureUsage::NormalMap)
+            return BlockFormat::BC5;
+        if (compression == TextureCompression::Quality)
+            return BlockFormat::BC7;
+        return channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+    }
+
+    bool TextureCache::Write(std::string const& cacheFile, TextureCacheData const& data)
+    {
+        //write next to the final file and swap it in, so a crash never leaves half a cache
+        std::string fullPath = getFilePath(cacheFile);
+        std::string tempPath = fullPath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+            file.write(c_magic, sizeof(c_magic));
+            writeValue(file, c_version);
+            writeValue(file, data.Width);
+            writeValue(file, data.Height);
+            writeValue(file, data.Channels);
+            writeValue(file, static_cast<u8>(data.Filter));
+            writeValue(file, static_cast<u8>(data.Usage));
+            writeValue(file, static_cast<u8>(data.Format));
+            writeValue(file, static_cast<u32>(data.Levels.size()));
+            writeValue(file, data.SourceSize);
+            writeValue(file, data.SourceTime);
+
+            u64 offset = c_headerBytes + c_levelEntryBytes * data.Levels.size();
+            for (MipLevel const& level : data.Levels)
+            {
+                writeValue(file, level.Width);
+                writeValue(file, level.Height);
+                writeValue(file, offset);
+                writeValue(file, static_cast<u64>(level.Pixels.size()));
+                offset += level.Pixels.size();
+            }
+            for (MipLevel const& level : data.Levels)
+            {
+                file.write(reinterpret_cast<char const*>(level.Pixels.data()), level.Pixels.size());
+            }
+            if (!file)
+                return false;
+        }
+        std::remove(fullPath.c_str());
+        return std::rename(tempPath.c_str(), fullPath.c_str()) == 0;
+    }
+
+    bool TextureCache::Read(std::string const& cacheFile, TextureCacheData& data, u32 maxLevelSize)
+    {
+        std::ifstream file(getFilePath(cacheFile), std::ios::binary);
+        std::vector<u64> offsets;
+        if (!readTable(file, data, offsets))
+            return false;
+        for (u32 i = 0; i < data.Levels.size(); ++i)
+        {
+            MipLevel& level = data.Levels[i];
+            if (maxLevelSize != 0 && std::max(level.Width, level.Height) > maxLevelSize)
+            {
+                std::vector<u8>().swap(level.Pixels);
+                continue;
+            }
+            file.seekg(static_cast<std::streamoff>(offsets[i]));
+            if (!file.read(reinterpret_cast<char*>(level.Pixels.data()), level.Pixels.size()))
+                return false;
+        }
+        return true;
+    }
+
+    bool TextureCache::ReadLevel(std::string const& cacheFile, u32 levelIndex, MipLevel& level)
+    {
+        std::ifstream file(getFilePath(cacheFile), std::ios::binary);
+        TextureCacheData data;
+        std::vector<u64> offsets;
+        if (!readTable(file, data, offsets) || levelIndex >= data.Levels.size())
+            return false;
+        level = std::move(data.Levels[levelIndex]);
+        file.seekg(static_cast<std::streamoff>(offsets[levelIndex]));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(level.Pixels.data()), level.Pixels.size()));
+    }
+
+    std::shared_ptr<Texture> TextureCache::Load(std::string const& relativePath, MipFilter filter, TextureCompression compression)
+    {
+        u64 sourceSize = 0, sourceTime = 0;
+        bool hasSource = getSourceStamp(relativePath, sourceSize, sourceTime);
+        std::string cacheFile = GetCachePath(relativePath);
+        TextureUsage usage = GuessUsage(relativePath);
+
+        TextureCacheData data;
+        if (Read(cacheFile, data) && isCurrent(data, filter, compression, hasSource, sourceSize, sourceTime))
+        {
+            std::shared_ptr<Texture> texture(new Texture());
+            texture->m_width = data.Width;
+            texture->m_height = data.Height;
+            texture->m_bpp = data.Channels;
+            texture->m_format = data.Channels == 4 ? Texture::Format::RGBA : Texture::Format::RGB;
+            //the levels as read, pixels are never copied on the way to the GPU
+            texture->m_blockFormat = data.Format;
+            texture->m_levels = std::move(data.Levels);
+            return texture;
+        }
+
+        std::shared_ptr<Texture> texture = Texture::LoadFromFile(relativePath);
+        if (!texture)
+            return nullptr;
+        data = TextureCacheData();
+        data.Width = texture->m_width;
+        data.Height = texture->m_height;
+        data.Channels = texture->m_bpp;
+        data.Filter = filter;
+        data.Usage = usage;
+        data.Format = ChooseFormat(compression, usage, data.Channels);
+        data.SourceSize = sourceSize;
+        data.SourceTime = sourceTime;
+        std::vector<MipLevel> mips = MipGenerator::Generate(texture->m_pixels, data.Width, data.Height, data.Channels,
+            filter, data.Usage == TextureUsage::Color);
+
+        //level 0 is copied once out of the decoder buffer, every other level is moved
+        MipLevel base;
+        base.Width = data.Width;
+        base.Height = data.Height;
+        base.Pixels.assign(texture->m_pixels, texture->m_pixels + size_t(data.Width) * data.Height * data.Channels);
+        Texture::FreePixels(texture->m_pixels);
+        texture->m_pixels = nullptr;
+        data.Levels.reserve(mips.size() + 1);
+        data.Levels.push_back(std::move(base));
+        std::move(mips.begin(), mips.end(), std::back_inserter(data.Levels));
+
+        if (data.Format != BlockFormat::None)
+        {
+            for (MipLevel& level : data.Levels)
+                level.Pixels = BlockCompressor::Compress(level.Pixels.data(), level.Width, level.Height, data.Channels, data.Format);
+        }
+        bool written = Write(cacheFile, data);
+        WarnIf(!written, "Could not write texture cache %s.", cacheFile.c_str());
+        texture->m_blockFormat = data.Format;
+        texture->m_levels = std::move(data.Levels);
+        return texture;
+    }
+
+    std::shared_ptr<Texture> TextureCache::LoadStreamed(std::string const& relativePath, u32 maxLevelSize, MipFilter filter,
+                                                        TextureCompression compression)
+    {
+        u64 sourceSize = 0, sourceTime = 0;
+        bool hasSource = getSourceStamp(relativePath, sourceSize, sourceTime);
+        std::string cacheFile = GetCachePath(relativePath);
+        TextureCacheData data;
+        std::shared_ptr<Texture> texture;
+        if (Read(cacheFile, data, maxLevelSize) && isCurrent(data, filter, compression, hasSource, sourceSize, sourceTime))
+        {
+            texture.reset(new Texture());
+            texture->m_width = data.Width;
+            texture->m_height = data.Height;
+            texture->m_bpp = data.Channels;
+            texture->m_format = data.Channels == 4 ? Texture::Format::RGBA : Texture::Format::RGB;
+            texture->m_blockFormat = data.Format;
+            texture->m_levels = std::move(data.Levels);
+        }
+        else
+        {
+            //first load of this image, builds the cache the finer levels are streamed from later
+            texture = Load(relativePath, filter, compression);
+            if (!texture)
+                return nullptr;
+            for (MipLevel& level : texture->m_levels)
+            {
+                if (std::max(level.Width, level.Height) > maxLevelSize)
+                    std::vector<u8>().swap(level.Pixels);
+            }
+        }
+        while (texture->m_levels[texture->m_residentLevel].Pixels.empty())
+            ++texture->m_residentLevel;
+        return texture;
+    }
+
+    TextureCache::Benchmark TextureCache::MeasureLoadTime(std::string const& relativePath)
+    {
+        Benchmark result;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<Texture> texture = Texture::LoadFromFile(relativePath);
+        result.DecodeMilliseconds = elapsedMilliseconds(start);
+        if (!texture)
+            return result;
+
+        TextureCacheData data;
+        data.Width = result.Width = texture->m_width;
+        data.Height = result.Height = texture->m_height;
+        data.Channels = texture->m_bpp;
+        data.Usage = GuessUsage(relativePath);
+        bool srgb = data.Usage == TextureUsage::Color;
+
+        start = std::chrono::high_resolution_clock::now();
+        MipGenerator::Generate(texture->m_pixels, data.Width, data.Height, data.Channels, MipFilter::Box, srgb);
+        result.BoxMipMilliseconds = elapsedMilliseconds(start);
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<MipLevel> mips = MipGenerator::Generate(texture->m_pixels, data.Width, data.Height, data.Channels, MipFilter::Kaiser, srgb);
+        result.KaiserMipMilliseconds = elapsedMilliseconds(start);
+
+        MipLevel base;
+        base.Width = data.Width;
+        base.Height = data.Height;
+        base.Pixels.assign(texture->m_pixels, texture->m_pixels + size_t(data.Width) * data.Height * data.Channels);
+        data.Levels.push_back(std::move(base));
+        data.Levels.insert(data.Levels.end(), mips.begin(), mips.end());
+        result.LevelCount = static_cast<u32>(data.Levels.size());
+        for (MipLevel const& level : data.Levels)
+            result.CacheBytes += level.Pixels.size();
+
+        //a separate file, so the benchmark never races a real load of the same texture
+        std::string benchFile = GetCachePath(relativePath) + ".bench";
+        start = std::chrono::high_resolution_clock::now();
+        bool written = Write(benchFile, data);
+        result.WriteMilliseconds = elapsedMilliseconds(start);
+        if (written)
+        {
+            TextureCacheData readBack;
+            start = std::chrono::high_resolution_clock::now();
+            bool read = Read(benchFile, readBack);
+            result.ReadMilliseconds = elapsedMilliseconds(start);
+            result.RoundTrip = read && readBack.Levels.size() == data.Levels.size();
+            for (size_t i = 0; result.RoundTrip && i < data.Levels.size(); ++i)
+            {
+                result.RoundTrip = readBack.Levels[i].Width == data.Levels[i].Width
+                    && readBack.Levels[i].Height == data.Levels[i].Height
+                    && readBack.Levels[i].Pixels == data.Levels[i].Pixels;
+            }
+            std::remove(getFilePath(benchFile).c_str());
+        }
+        return result;
+    }
+
+    BlockCompressor::Benchmark TextureCache::MeasureCompression(std::string const& relativePath, BlockFormat format)
+    {
+        std::shared_ptr<Texture> texture = Texture::LoadFromFile(relativePath);
+        if (!texture)
+            return BlockCompressor::Benchmark();
+        return BlockCompressor::Measure(texture->m_pixels, texture->m_width, texture->m_height, texture->m_bpp, format);
+    }
+
+    bool TextureCache::readTable(std::ifstream& file, TextureCacheData& data, std::vector<u64>& offsets)
+    {
+        if (!file)
+            return false;
+        char magic[4];
+        u32 version = 0, levelCount = 0;
+        u8 filter = 0, usage = 0, format = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, c_magic, sizeof(magic)) != 0)
+            return false;
+        if (!readValue(file, version) || version != c_version)
+            return false;
+        bool valid = readValue(file, data.Width) && readValue(file, data.Height) && readValue(file, data.Channels)
+            && readValue(file, filter) && readValue(file, usage) && readValue(file, format) && readValue(file, levelCount)
+            && readValue(file, data.SourceSize) && readValue(file, data.SourceTime);
+        if (!valid || levelCount == 0 || levelCount > 32 || (data.Channels != 3 && data.Channels != 4))
+            return false;
+        data.Filter = static_cast<MipFilter>(filter);
+        data.Usage = static_cast<TextureUsage>(usage);
+        data.Format = static_cast<BlockFormat>(format);
+
+        data.Levels.resize(levelCount);
+        offsets.resize(levelCount);
+        for (u32 i = 0; i < levelCount; ++i)
+        {
+            MipLevel& level = data.Levels[i];
+            u64 size = 0;
+            if (!readValue(file, level.Width) || !readValue(file, level.Height) || !readValue(file, offsets[i]) || !readValue(file, size))
+                return false;
+            u64 expected = data.Format == BlockFormat::None ? u64(level.Width) * level.Height * data.Channels
+                : BlockCompressor::GetCompressedSize(data.Format, level.Width, level.Height);
+            if (size != expected)
+                return false;
+            level.Pixels.resize(static_cast<size_t>(size));
+        }
+        return true;
+    }
+
+    bool TextureCache::isCurrent(TextureCacheData const& data, MipFilter filter, TextureCompression compression,
+                                 bool hasSource, u64 sourceSize, u64 sourceTime)
+    {
+        return data.Filter == filter && data.Format == ChooseFormat(compression, data.Usage, data.Channels)
+            && (!hasSource || (data.SourceSize == sourceSize && data.SourceTime == sourceTime));
+    }
+
+    bool TextureCache::getSourceStamp(std::string const& relativePath, u64& size, u64& time)
+    {
+        struct stat info;
+        if (stat(getFilePath(relativePath).c_str(), &info) != 0)
+            return false;
+        size = static_cast<u64>(info.st_size);
+        time = static_cast<u64>(info.st_mtime);
+        return true;
+    }
+}
@@ -2,6 +2,7 @@
 #include "framework/Debug.h"
 #include "graphics/ShaderProgram.h"
 #include "graphics/Texture.h"
+#include "graphics/TextureCache.h"
 #include "graphics/TextureManager.h"
 #define TEXTURE_TYPE_ENUM_CHECK static_assert(static_cast<int>(Graphics::TextureType::Count) < Graphics::NumberAvailableTextureUnits, "Too many texture types!");
 #define LOADING_TEXTURE_FILE "Loading.jpg"
@@ -11,6 +12,40 @@ namespace
     // Kept as a file-scope global so that it can be returned as a const ref.
     std::shared_ptr<Graphics::Texture> const NullTexture = nullptr;
     TEXTURE_TYPE_ENUM_CHECK
+    static_assert(static_cast<int>(Graphics::TextureType::Count) <= Graphics::FirstTextureArrayUnit, "Texture types overlap the texture array units!");
+
+    //streamed textures always keep the levels this size and smaller
+    const u32 c_streamTailSize = 64;
+    //levels started loading per frame, at most one per texture
+    const u32 c_streamLoadsPerFrame = 4;
+
+    struct StreamedLevel
+    {
+        Graphics::MipLevel Level;
+        bool Read = false;
+    };
+
+    //video memory of one layer of a texture array, all levels
+    u64 layerBytes(Graphics::TextureArrayKey const& key)
+    {
+        u64 bytes = 0;
+        for (u32 level = 0; level < key.Levels; ++level)
+        {
+            u64 width = std::max(key.Width >> level, 1u);
+            u64 height = std::max(key.Height >> level, 1u);
+            u64 blocks = ((width + 3) / 4) * ((height + 3) / 4);
+            switch (key.Format)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: bytes += blocks * 8; break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_RG_RGTC2:
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:   bytes += blocks * 16; break;
+            case GL_RGB8:                         bytes += width * height * 3; break;
+            default:                              bytes += width * height * 4; break;
+            }
+        }
+        return bytes;
+    }
 }
 
 namespace Graphics
@@ -22,77 +57,105 @@ namespace Graphics
         // load the texture given the specified image file; save the texture given
         // the specified textureName or, if one is already associated with that textureName,
         // replace it with the newly loaded texture
+        auto texture = TextureCache::Load(textureFilePath, MipFilter::Kaiser, m_compression);
+        WarnIf(!texture, "Could not load texture %s.", textureFilePath.c_str());
+        if (!texture)
+            return NullTexture; // a texture already registered under the name is kept
+        texture->SetTextureName(textureName);
+        texture->Build();
         auto find = m_textures.find(textureName);
-        auto texture = Texture::LoadFromFile(textureFilePath);
         if (find != m_textures.end())
         {
             find->second = texture; // replace texture
-            texture->SetTextureName(textureName);
-            find->second->Build();
             return find->second; // and return it
         }
         else // new texture: insert(std::pair<textureName, ...>(textureName, texture))
         {
-            texture->SetTextureName(textureName);
-            find->second->Build();
             return m_textures.emplace(textureName, texture).first->second; // and return it
         }
     }
 
+    TextureManager::~TextureManager()
+    {
+        //finalizers hold this manager, none may run after it is gone
+        CancelPendingLoads();
+        destroyTextureArrays();
+    }
+
     std::map<std::string /*textureName*/, std::shared_ptr<Texture> > & TextureManager::RegisterTextureMultiThread(
         std::vector<std::string> const& textureFilePaths)
     {
-        std::vector<std::thread > threads;
-        size_t threadNum = textureFilePaths.size();
-        threads.resize(threadNum);
-        m_remainingTextureToLoad = threadNum;
+        size_t textureNum = textureFilePaths.size();
+        std::vector<std::shared_ptr<Texture> > loaded(textureNum);
+        std::vector<AssetLoadHandle> handles;
+        handles.reserve(textureNum);
 
-        //load textures in parallel
-        for (size_t i = 0; i < threadNum; ++i)
-        {
-            threads[i] = std::thread(&TextureManager::loadTextureThreadFunc, this, textureFilePaths[i]);
-        }
-        //join all threads and build all textures
-        for (size_t i = 0; i < threadNum; ++i)
+        //decode (or read from the cache) in parallel on the loader threads, every load writes its own slot
+        AssetLoader& loader = AssetLoader::GetShared();
+        for (size_t i = 0; i < textureNum; ++i)
         {
-            threads[i].join();
+            std::string const& path = textureFilePaths[i];
+            std::shared_ptr<Texture>* slot = &loaded[i];
+            TextureCompression compression = m_compression;
+            handles.push_back(loader.Submit(path, [path, slot, compression]()
+            {
+                *slot = TextureCache::Load(path, MipFilter::Kaiser, compression);
+            }, nullptr, AssetPriority::High));
         }
-        for (auto& i : m_loadingTextureQueue)
+        //wait for all of them and build on this thread
+        for (size_t i = 0; i < textureNum; ++i)
         {
-            i->Build();
-            m_textures[i->GetTextureName()] = i;
+            handles[i].Wait();
+            if (!loaded[i])
+                continue;
+            loaded[i]->SetTextureName(textureFilePaths[i]);
+            loaded[i]->Build();
+            m_textures[textureFilePaths[i]] = loaded[i];
         }
-        //clear the queue since we manually built the textures above;
-        m_loadingTextureQueue.clear();
-        //std::cout << glutGet(GLUT_ELAPSED_TIME)*0.001f << std::endl;
         return m_textures;
     }
 
-    std::map<std::string /*textureName*/, std::shared_ptr<Texture> >& TextureManager::LoadTextureMultiThreadRealTime(std::vector<std::string> const& textureFilePaths)
+    std::map<std::string /*textureName*/, std::shared_ptr<Texture> >& TextureManager::LoadTextureMultiThreadRealTime(
+        std::vector<std::string> const& textureFilePaths, AssetPriority priority)
     {
-        size_t threadNum = textureFilePaths.size();
-        m_remainingTextureToLoad = threadNum;
+        //decode the placeholder once and give every texture its own copy
+        std::shared_ptr<Texture> placeholder = Texture::LoadFromFile(ERROR_TEXTURE_FILE);
+        Assert(placeholder, "Placeholder texture %s is missing.", ERROR_TEXTURE_FILE);
+        u32 placeholderSize = placeholder->m_width * placeholder->m_height * placeholder->m_bpp;
 
-        //create all textures
-        for (size_t i = 0; i < threadNum; ++i)
+        AssetLoader& loader = AssetLoader::GetShared();
+        for (std::string const& path : textureFilePaths)
         {
-            std::shared_ptr<Texture> ptex = Texture::LoadFromFile("error.jpg");
+            u8* pixels = Texture::AllocatePixels(placeholderSize);
+            std::memcpy(pixels, placeholder->m_pixels, placeholderSize);
+            std::shared_ptr<Texture> ptex = std::make_shared<Texture>(pixels, placeholder->m_width, placeholder->m_height, placeholder->m_format);
             ptex->Build();
-            ptex->SetTextureName(textureFilePaths[i]);
-            m_textures[textureFilePaths[i]] = ptex;
-        }
+            ptex->SetTextureName(path);
+            m_textures[path] = ptex;
 
-        std::vector<std::thread > threads;
-        threads.resize(threadNum);
-        //load textures in parallel
-        for (size_t i = 0; i < threadNum; ++i)
-        {
-            //std::thread t(&TextureManager::loadTextureThreadFunc, this, textureFilePaths[i]);
-            threads[i] = std::thread(&TextureManager::loadTextureThreadFunc, this, textureFilePaths[i]);
-        }
-        for (size_t i = 0; i < threadNum; ++i)
-        {
-            threads[i].detach();
+            //the worker only decodes and builds mips, the upload is left to ProcessThreadLoadedTexture
+            std::shared_ptr<std::shared_ptr<Texture> > loaded = std::make_shared<std::shared_ptr<Texture> >();
+            TextureCompression compression = m_compression;
+            bool streamed = IsStreaming();
+            m_pendingLoads.push_back(loader.Submit(path, [path, loaded, compression, streamed]()
+            {
+                *loaded = streamed ? TextureCache::LoadStreamed(path, c_streamTailSize, MipFilter::Kaiser, compression)
+                    : TextureCache::Load(path, MipFilter::Kaiser, compression);
+            }, [this, path, loaded, streamed]()
+            {
+                if (!*loaded)
+                    return;
+                (*loaded)->SetTextureName(path);
+                std::shared_ptr<Texture> const& texture = m_textures.at(path);
+                unregisterStreamed(texture.get());
+                //the loaded texture is dropped after this, so its pixels are taken instead of copied
+                texture->MoveAndBuild(**loaded);
+                if (streamed)
+                    registerStreamed(texture, path);
+#if VERBOSE
+                std::cout << "Finished loading texture with name: \"" + path + "\".\n";
+#endif // VERBOSE
+            }, priority));
         }
         return m_textures;
     }
@@ -147,6 +210,11 @@ namespace Graphics
     void TextureManager::ClearTextures()
     {
         // free up resources consumed by registered textures
+        CancelPendingLoads();
+        m_residency.Clear();
+        m_streamed.clear();
+        m_streamIds.clear();
+        destroyTextureArrays();
         m_textures.clear();
     }
 
@@ -160,28 +228,400 @@ namespace Graphics
         return textures;
     }
 
-    //thread loading
-    void TextureManager::loadTextureThreadFunc(std::string const& path)
+    //called only by main thread
+    size_t TextureManager::ProcessThreadLoadedTexture(float budgetMilliseconds)
     {
-        std::shared_ptr<Texture> loadedTexture = Texture::LoadFromFile(path);
-        loadedTexture->SetTextureName(path);
-        std::lock_guard<std::shared_mutex> lockguard(m_mapMutex);
-        m_loadingTextureQueue.push_back(loadedTexture);
-#if VERBOSE
-        std::cout << "A thread finished loading texture with name: \"" + path + "\".  -- " + std::to_string(--m_remainingTextureToLoad) + " Remain.\n";
-#endif // VERBOSE
+        if (m_pendingLoads.empty())
+            return 0;
+        AssetLoader::GetShared().FinalizeLoaded(budgetMilliseconds);
+        m_pendingLoads.erase(std::remove_if(m_pendingLoads.begin(), m_pendingLoads.end(),
+            [](AssetLoadHandle const& handle) { return handle.IsFinished(); }), m_pendingLoads.end());
+        return m_pendingLoads.size();
+    }
+
+    size_t TextureManager::BakeTextureCache(std::vector<std::string> const& textureFilePaths)
+    {
+        //shared with the loads, a cancelled one may still be running after the wait
+        std::shared_ptr<std::atomic<size_t> > cached = std::make_shared<std::atomic<size_t> >(0);
+        std::vector<AssetLoadHandle> handles;
+        AssetLoader& loader = AssetLoader::GetShared();
+        TextureCompression compression = m_compression;
+        for (std::string const& path : textureFilePaths)
+        {
+            handles.push_back(loader.Submit(path, [path, compression, cached]()
+            {
+                if (TextureCache::Load(path, MipFilter::Kaiser, compression))
+                    ++*cached;
+            }, nullptr, AssetPriority::Low));
+        }
+        for (AssetLoadHandle const& handle : handles)
+        {
+            handle.Wait();
+        }
+        return cached->load();
+    }
+
+    size_t TextureManager::CancelPendingLoads()
+    {
+        size_t cancelled = 0;
+        for (AssetLoadHandle const& handle : m_pendingLoads)
+        {
+            if (handle.Cancel())
+                ++cancelled;
+        }
+        m_pendingLoads.clear();
+        for (StreamLoad const& load : m_streamLoads)
+        {
+            if (load.Handle.Cancel())
+            {
+                m_residency.CancelLoad(load.Texture);
+                ++cancelled;
+            }
+        }
+        m_streamLoads.clear();
+        return cancelled;
+    }
+
+    void TextureManager::SetStreamingBudget(u64 budgetBytes)
+    {
+        m_streamingBudget = budgetBytes;
+        m_residency.SetBudget(budgetBytes);
+    }
+
+    void TextureManager::RequestTextureDetail(std::shared_ptr<Texture> const& texture, float uvPerPixel)
+    {
+        if (!texture)
+            return;
+        auto find = m_streamIds.find(texture.get());
+        if (find == m_streamIds.end())
+            return;
+        u32 size = std::max(texture->GetWidth(), texture->GetHeight());
+        m_residency.RequestLevel(find->second, TextureResidency::EstimateLevel(size, uvPerPixel));
     }
 
     //called only by main thread
-    size_t TextureManager::ProcessThreadLoadedTexture()
+    void TextureManager::UpdateStreaming(float budgetMilliseconds)
+    {
+        if (m_streamIds.empty())
+            return;
+        AssetLoader& loader = AssetLoader::GetShared();
+        loader.FinalizeLoaded(budgetMilliseconds);
+        m_streamLoads.erase(std::remove_if(m_streamLoads.begin(), m_streamLoads.end(),
+            [](StreamLoad const& load) { return load.Handle.IsFinished(); }), m_streamLoads.end());
+
+        std::vector<ResidencyChange> changes = m_residency.Update(c_streamLoadsPerFrame);
+        //several levels evicted from one texture rebuild it once
+        std::map<u32, u32> evicted;
+        for (ResidencyChange const& change : changes)
+        {
+            if (change.Action == ResidencyAction::Evict)
+            {
+                u32& level = evicted[change.Texture];
+                level = std::max(level, change.Level + 1);
+            }
+        }
+        for (auto const& i : evicted)
+        {
+            m_streamed[i.first].Image->SetResidentLevel(i.second);
+        }
+
+        //levels are read on the loader threads and uploaded here by FinalizeLoaded
+        for (ResidencyChange const& change : changes)
+        {
+            if (change.Action != ResidencyAction::Load)
+                continue;
+            u32 id = change.Texture;
+            u32 levelIndex = change.Level;
+            std::string const& cacheFile = m_streamed[id].CacheFile;
+            std::shared_ptr<Texture> texture = m_streamed[id].Image;
+            std::shared_ptr<StreamedLevel> streamed = std::make_shared<StreamedLevel>();
+            StreamLoad load;
+            load.Texture = id;
+            load.Handle = loader.Submit(cacheFile, [cacheFile, levelIndex, streamed]()
+            {
+                streamed->Read = TextureCache::ReadLevel(cacheFile, levelIndex, streamed->Level);
+            }, [this, id, levelIndex, streamed, texture]()
+            {
+                if (!streamed->Read)
+                {
+                    Warning("Could not stream level %d of texture \"%s\".", levelIndex, texture->GetTextureName().c_str());
+                    m_residency.CancelLoad(id);
+                    return;
+                }
+                texture->SetLevelPixels(levelIndex, std::move(streamed->Level.Pixels));
+                texture->SetResidentLevel(levelIndex);
+                m_residency.FinishLoad(id, levelIndex);
+            }, AssetPriority::Normal);
+            m_streamLoads.push_back(load);
+        }
+    }
+
+    TextureResidencyStats TextureManager::GetStreamingStats(std::string const& textureName) const
+    {
+        auto texture = m_textures.find(textureName);
+        if (texture == m_textures.end())
+            return TextureResidencyStats();
+        auto find = m_streamIds.find(texture->second.get());
+        return find == m_streamIds.end() ? TextureResidencyStats() : m_residency.GetStats(find->second);
+    }
+
+    void TextureManager::registerStreamed(std::shared_ptr<Texture> const& texture, std::string const& textureName)
+    {
+        std::vector<u64> levelBytes(texture->GetLevelCount());
+        for (u32 i = 0; i < levelBytes.size(); ++i)
+        {
+            levelBytes[i] = texture->GetLevelBytes(i);
+        }
+        u32 id = m_residency.AddTexture(levelBytes, texture->GetResidentLevel());
+        if (m_streamed.size() <= id)
+        {
+            m_streamed.resize(id + 1);
+        }
+        m_streamed[id].Image = texture;
+        m_streamed[id].CacheFile = TextureCache::GetCachePath(textureName);
+        m_streamIds[texture.get()] = id;
+    }
+
+    void TextureManager::unregisterStreamed(Texture const* texture)
+    {
+        auto find = m_streamIds.find(texture);
+        if (find == m_streamIds.end())
+            return;
+        u32 id = find->second;
+        for (StreamLoad const& load : m_streamLoads)
+        {
+            if (load.Texture == id)
+                load.Handle.Cancel();
+        }
+        m_residency.RemoveTexture(id);
+        m_streamed[id] = StreamedTexture();
+        m_streamIds.erase(find);
+    }
+
+    void TextureManager::SetTextureArraysEnabled(bool enabled)
+    {
+        if (!enabled)
+        {
+            //views would keep the arrays' storage alive, the textures get their own back
+            for (auto& i : m_arrayed)
+            {
+                std::shared_ptr<Texture> texture = i.second.Image.lock();
+                if (!texture || !i.second.Layer.IsValid())
+                    continue;
+                auto stream = m_streamIds.find(texture.get());
+                if (stream != m_streamIds.end())
+                    m_residency.SetExternal(stream->second, false);
+                if (texture->GetBuildCount() == i.second.BuildCount)
+                {
+                    texture->Destroy();
+                    texture->Build();
+                }
+            }
+            destroyTextureArrays();
+        }
+        m_textureArrays = enabled;
+    }
+
+    TextureLayer TextureManager::GetTextureLayer(std::shared_ptr<Texture> const& texture)
+    {
+        if (!m_textureArrays || texture == nullptr)
+            return TextureLayer();
+        //kept while the texture is not built yet, UpdateTextureArrays places it once it is
+        ArrayedTexture& arrayed = m_arrayed[texture.get()];
+        if (arrayed.Image.lock() != texture)
+        {
+            //a texture freed at the same address, its layer is stale
+            if (arrayed.Layer.IsValid())
+                ++m_arrayVersion;
+            m_layerAllocator.Free(arrayed.Layer);
+            arrayed = ArrayedTexture();
+            arrayed.Image = texture;
+        }
+        refreshLayer(*texture, arrayed);
+        return arrayed.Layer;
+    }
+
+    void TextureManager::UpdateTextureArrays()
+    {
+        for (auto i = m_arrayed.begin(); i != m_arrayed.end();)
+        {
+            std::shared_ptr<Texture> texture = i->second.Image.lock();
+            if (!texture)
+            {
+                if (i->second.Layer.IsValid())
+                    ++m_arrayVersion;
+                m_layerAllocator.Free(i->second.Layer);
+                i = m_arrayed.erase(i);
+                continue;
+            }
+            //loaded and streamed textures are copied in again, ones no array had room for try again
+            refreshLayer(*texture, i->second);
+            ++i;
+        }
+        updateReservedBytes();
+    }
+
+    void TextureManager::refreshLayer(Texture& texture, ArrayedTexture& arrayed)
+    {
+        if (!texture.IsBuilt() || (arrayed.Layer.IsValid() && arrayed.BuildCount == texture.GetBuildCount()))
+            return;
+        bool hadLayer = arrayed.Layer.IsValid();
+        bool placed = placeInArray(texture, arrayed.Layer);
+        //the levels of a streamed texture in an array are paid for by its layer
+        auto stream = m_streamIds.find(&texture);
+        if (stream != m_streamIds.end())
+            m_residency.SetExternal(stream->second, placed);
+        if (placed)
+            arrayed.BuildCount = texture.GetBuildCount();
+        if (placed || hadLayer)
+            ++m_arrayVersion;
+    }
+
+    void TextureManager::BindTextureArrays(std::shared_ptr<ShaderProgram> const& program) const
+    {
+        for (u32 i = 0; i < MaxTextureArrays; ++i)
+        {
+            u32 unit = FirstTextureArrayUnit + i;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, i < m_arrays.size() ? m_arrays[i].Handle : 0);
+            //every sampler needs its own unit, even unused ones, or they would
+            //share unit 0 with the 2D samplers of the material
+            program->SetUniform("MaterialTextureArrays[" + std::to_string(i) + "]", static_cast<int>(unit));
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    bool TextureManager::placeInArray(Texture& texture, TextureLayer& layer)
+    {
+        //keyed on all levels, streamed textures are built from their resident
+        //level on and fill that level and the coarser ones of their layer
+        TextureArrayKey key;
+        key.Width = texture.m_width;
+        key.Height = texture.m_height;
+        key.Levels = texture.GetLevelCount();
+        key.Format = texture.GetStorageFormat();
+        if (!layer.IsValid() || m_layerAllocator.GetKey(layer.Array) != key)
+        {
+            m_layerAllocator.Free(layer);
+            layer = m_layerAllocator.Allocate(key);
+            if (!layer.IsValid())
+                return false;
+        }
+        reserveArray(layer.Array, m_layerAllocator.GetUsedLayers(layer.Array));
+        layer.MinLevel = texture.m_residentLevel;
+
+        u32 handle = m_arrays[layer.Array].Handle;
+        for (u32 level = layer.MinLevel; level < key.Levels; ++level)
+        {
+            GLsizei width = std::max(key.Width >> level, 1u);
+            GLsizei height = std::max(key.Height >> level, 1u);
+            glCopyImageSubData(texture.m_textureHandle, GL_TEXTURE_2D, level - layer.MinLevel, 0, 0, 0,
+                               handle, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer.Layer, width, height, 1);
+        }
+        aliasLayer(texture, layer);
+        return true;
+    }
+
+    void TextureManager::aliasLayer(Texture& texture, TextureLayer const& layer)
+    {
+        TextureArrayKey const& key = m_layerAllocator.GetKey(layer.Array);
+        u32 levels = key.Levels - layer.MinLevel;
+        u32 view = 0;
+        glGenTextures(1, &view);
+        //the same levels Build gives the texture, so it samples as before
+        glTextureView(view, GL_TEXTURE_2D, m_arrays[layer.Array].Handle, key.Format,
+                      layer.MinLevel, levels, layer.Layer, 1);
+        glBindTexture(GL_TEXTURE_2D, view);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        texture.Destroy();
+        texture.m_textureHandle = view;
+    }
+
+    void TextureManager::reserveArray(u32 array, u32 layers)
+    {
+        if (m_arrays.size() <= array)
+        {
+            m_arrays.resize(array + 1);
+        }
+        TextureArray& textureArray = m_arrays[array];
+        if (textureArray.Handle != 0 && textureArray.Generation != m_layerAllocator.GetGeneration(array))
+        {
+            //the array was handed to another size, its layers are all free
+            glDeleteTextures(1, &textureArray.Handle);
+            textureArray = TextureArray();
+            updateReservedBytes();
+        }
+        if (layers <= textureArray.Layers)
+            return;
+
+        //storage can't grow, make a larger array and copy the layers over;
+        //doubling keeps that rare while small arrays stay small
+        TextureArrayKey const& key = m_layerAllocator.GetKey(array);
+        u32 capacity = std::max(std::max(textureArray.Layers * 2, 4u), layers);
+        capacity = std::min(capacity, m_layerAllocator.GetLayersPerArray());
+        u32 handle = 0;
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, handle);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, key.Levels, key.Format, key.Width, key.Height, capacity);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, key.Levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        if (textureArray.Handle != 0)
+        {
+            for (u32 level = 0; level < key.Levels; ++level)
+            {
+                GLsizei width = std::max(key.Width >> level, 1u);
+                GLsizei height = std::max(key.Height >> level, 1u);
+                glCopyImageSubData(textureArray.Handle, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                                   handle, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, textureArray.Layers);
+            }
+        }
+        u32 replaced = textureArray.Handle;
+        textureArray.Handle = handle;
+        textureArray.Layers = capacity;
+        textureArray.Generation = m_layerAllocator.GetGeneration(array);
+        textureArray.Bytes = capacity * layerBytes(key);
+        if (replaced != 0)
+        {
+            //the old storage lives on as long as a view of it does
+            for (auto const& i : m_arrayed)
+            {
+                std::shared_ptr<Texture> texture = i.second.Image.lock();
+                if (texture && i.second.Layer.Array == static_cast<s32>(array) && texture->GetBuildCount() == i.second.BuildCount)
+                    aliasLayer(*texture, i.second.Layer);
+            }
+            glDeleteTextures(1, &replaced);
+        }
+        updateReservedBytes();
+    }
+
+    void TextureManager::updateReservedBytes()
+    {
+        u64 bytes = 0;
+        for (TextureArray const& textureArray : m_arrays)
+        {
+            bytes += textureArray.Bytes;
+        }
+        m_residency.SetReservedBytes(bytes);
+    }
+
+    void TextureManager::destroyTextureArrays()
     {
-        std::lock_guard<std::shared_mutex> guard(m_mapMutex);
-        while (!m_loadingTextureQueue.empty())
+        for (TextureArray& textureArray : m_arrays)
         {
-            std::shared_ptr<Texture> texture = m_loadingTextureQueue.front();
-            m_loadingTextureQueue.pop_front();
-            m_textures.at(texture->GetTextureName())->ReplaceAndBuild(texture);
+            if (textureArray.Handle != 0)
+                glDeleteTextures(1, &textureArray.Handle);
         }
-        return m_remainingTextureToLoad;
+        m_arrays.clear();
+        m_arrayed.clear();
+        m_layerAllocator.Clear();
+        updateReservedBytes();
+        ++m_arrayVersion;
     }
 }
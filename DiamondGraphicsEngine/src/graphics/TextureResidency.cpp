@@ -0,0 +1,418 @@
+#include "Precompiled.h"
+#include "framework/Debug.h"
+#include "graphics/TextureResidency.h"
+
+#include <cmath>
+
+namespace
+{
+    const u32 c_noTexture = ~0u;
+    //the bias rises this much per frame a load does not fit
+    const float c_biasStep = 0.5f;
+    const float c_maxPressureBias = 4.0f;
+    //frames without pressure before the bias comes back down a step
+    const u32 c_calmFrames = 120;
+    //a request made no finer than this keeps the slot empty until the first request
+    const float c_noRequest = 1e9f;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+namespace Graphics
+{
+    TextureResidency::TextureResidency(u64 budgetBytes)
+        : m_budget(budgetBytes)
+    {
+    }
+
+    u32 TextureResidency::AddTexture(std::vector<u64> const& levelBytes, u32 tailLevel)
+    {
+        Assert(tailLevel < levelBytes.size(), "Tail level %d is outside of a %d level texture.", tailLevel, static_cast<int>(levelBytes.size()));
+        u32 id;
+        if (m_freeIds.empty())
+        {
+            id = static_cast<u32>(m_entries.size());
+            m_entries.emplace_back();
+        }
+        else
+        {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        Entry& entry = m_entries[id];
+        entry = Entry();
+        entry.LevelBytes = levelBytes;
+        entry.TailLevel = tailLevel;
+        entry.ResidentLevel = tailLevel;
+        entry.WantedLevel = tailLevel;
+        entry.RequestedLevel = c_noRequest;
+        entry.Alive = true;
+        for (u32 i = tailLevel; i < levelBytes.size(); ++i)
+            m_committed += levelBytes[i];
+        return id;
+    }
+
+    void TextureResidency::RemoveTexture(u32 id)
+    {
+        Entry& entry = m_entries[id];
+        if (!entry.Alive)
+            return;
+        if (!entry.External)
+            m_committed -= committedBytes(entry);
+        entry = Entry();
+        m_freeIds.push_back(id);
+    }
+
+    void TextureResidency::Clear()
+    {
+        m_entries.clear();
+        m_freeIds.clear();
+        m_committed = 0;
+        m_pressureBias = 0.0f;
+        m_calmFrames = 0;
+    }
+
+    void TextureResidency::RequestLevel(u32 id, float level)
+    {
+        Entry& entry = m_entries[id];
+        entry.Requested = true;
+        entry.RequestedLevel = std::min(entry.RequestedLevel, level);
+        entry.LastUsedFrame = m_frame;
+    }
+
+    std::vector<ResidencyChange> TextureResidency::Update(u32 maxLoads)
+    {
+        std::vector<ResidencyChange> changes;
+        const float bias = GetMipBias();
+        std::vector<u32> candidates;
+        for (u32 id = 0; id < m_entries.size(); ++id)
+        {
+            Entry& entry = m_entries[id];
+            if (!entry.Alive || !entry.Requested)
+                continue;
+            float wanted = std::floor(entry.RequestedLevel + bias);
+            entry.WantedLevel = wanted <= 0.0f ? 0 : std::min(static_cast<u32>(wanted), entry.TailLevel);
+            if (!entry.Loading && entry.ResidentLevel > entry.WantedLevel)
+                candidates.push_back(id);
+        }
+
+        //a lowered budget drops whatever it has to
+        if (m_committed + m_reserved > m_budget)
+            makeRoom(0, c_noTexture, true, changes);
+
+        //textures furthest from what they need load first
+        std::sort(candidates.begin(), candidates.end(), [this](u32 a, u32 b)
+        {
+            u32 missingA = m_entries[a].ResidentLevel - m_entries[a].WantedLevel;
+            u32 missingB = m_entries[b].ResidentLevel - m_entries[b].WantedLevel;
+            return missingA != missingB ? missingA > missingB : a < b;
+        });
+        bool pressure = false;
+        for (u32 i = 0; i < candidates.size() && i < maxLoads; ++i)
+        {
+            Entry& entry = m_entries[candidates[i]];
+            u32 level = entry.ResidentLevel - 1;
+            u64 bytes = entry.External ? 0 : entry.LevelBytes[level];
+            if (!entry.External && !makeRoom(bytes, candidates[i], false, changes))
+            {
+                pressure = true;
+                break;
+            }
+            entry.Loading = true;
+            m_committed += bytes;
+            ResidencyChange change;
+            change.Texture = candidates[i];
+            change.Level = level;
+            change.Action = ResidencyAction::Load;
+            changes.push_back(change);
+        }
+
+        //the bias rises quickly and falls slowly, so the same levels are not loaded and evicted every frame
+        if (pressure)
+        {
+            m_pressureBias = std::min(m_pressureBias + c_biasStep, c_maxPressureBias);
+            m_calmFrames = 0;
+        }
+        else if (m_pressureBias > 0.0f && ++m_calmFrames >= c_calmFrames)
+        {
+            m_pressureBias = std::max(m_pressureBias - c_biasStep, 0.0f);
+            m_calmFrames = 0;
+        }
+
+        for (Entry& entry : m_entries)
+        {
+            entry.Requested = false;
+            entry.RequestedLevel = c_noRequest;
+        }
+        ++m_frame;
+        return changes;
+    }
+
+    void TextureResidency::FinishLoad(u32 id, u32 level)
+    {
+        Entry& entry = m_entries[id];
+        Assert(entry.Loading && level + 1 == entry.ResidentLevel, "Texture %d finished loading level %d it did not ask for.", id, level);
+        entry.Loading = false;
+        entry.ResidentLevel = level;
+    }
+
+    void TextureResidency::CancelLoad(u32 id)
+    {
+        Entry& entry = m_entries[id];
+        if (!entry.Loading)
+            return;
+        entry.Loading = false;
+        if (!entry.External)
+            m_committed -= entry.LevelBytes[entry.ResidentLevel - 1];
+    }
+
+    void TextureResidency::SetExternal(u32 id, bool external)
+    {
+        Entry& entry = m_entries[id];
+        if (!entry.Alive || entry.External == external)
+            return;
+        entry.External = external;
+        if (external)
+            m_committed -= committedBytes(entry);
+        else
+            m_committed += committedBytes(entry);
+    }
+
+    TextureResidencyStats TextureResidency::GetStats(u32 id) const
+    {
+        TextureResidencyStats stats;
+        Entry const& entry = m_entries[id];
+        if (!entry.Alive)
+            return stats;
+        stats.LevelCount = static_cast<u32>(entry.LevelBytes.size());
+        stats.ResidentLevel = entry.ResidentLevel;
+        stats.WantedLevel = entry.WantedLevel;
+        stats.Loading = entry.Loading;
+        stats.LastUsedFrame = entry.LastUsedFrame;
+        for (u32 i = entry.ResidentLevel; i < entry.LevelBytes.size(); ++i)
+            stats.ResidentBytes += entry.LevelBytes[i];
+        return stats;
+    }
+
+    float TextureResidency::EstimateLevel(u32 textureSize, float uvPerPixel)
+    {
+        //level n has one texel per screen pixel when 2^n texels of level 0 fall on it
+        float texelsPerPixel = textureSize * uvPerPixel;
+        return texelsPerPixel <= 1.0f ? 0.0f : std::log2(texelsPerPixel);
+    }
+
+    float TextureResidency::EstimateUvPerPixel(float uvDensity, float objectRadius, float worldRadius,
+                                               float distance, float fovY, float screenHeight)
+    {
+        if (distance <= worldRadius)
+            return 0.0f;
+        float screenRadius = worldRadius / (distance * std::tan(fovY * 0.5f)) * (screenHeight * 0.5f);
+        return uvDensity * objectRadius / screenRadius;
+    }
+
+    TextureResidency::SimulationResult TextureResidency::Simulate(u32 textureCount, u32 frames, u64 budgetBytes, u32 seed)
+    {
+        struct SimulatedTexture
+        {
+            u32 Id = 0;
+            u32 Size = 0;
+            float Position = 0.0f;
+            //level the simulated memory holds, and its size
+            u32 Level = 0;
+            u64 Bytes = 0;
+        };
+        struct SimulatedLoad
+        {
+            u32 Texture = 0;
+            u32 Level = 0;
+            u32 ReadyFrame = 0;
+        };
+        //objects of radius 4 wrapping their texture once, seen at 1080p with a 60 degree lens
+        const float objectRadius = 4.0f;
+        const float uvDensity = 1.0f / objectRadius;
+        const float fovY = 3.14159265f / 3.0f;
+        const float screenHeight = 1080.0f;
+        const float rowLength = 1000.0f;
+        const float viewDistance = 150.0f;
+        const u32 tailSize = 64;
+
+        SimulationResult result;
+        result.Textures = textureCount;
+        result.Frames = frames;
+        result.BudgetBytes = budgetBytes;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> position(0.0f, rowLength);
+        TextureResidency residency(budgetBytes);
+        std::vector<SimulatedTexture> textures(textureCount);
+        std::vector<std::vector<u64> > levelBytes(textureCount);
+        u64 memory = 0;
+        for (u32 t = 0; t < textureCount; ++t)
+        {
+            SimulatedTexture& texture = textures[t];
+            texture.Size = 256u << (random() % 5);
+            texture.Position = position(random);
+            //8 bits per pixel, like BC3, BC5 and BC7
+            u32 tail = 0;
+            for (u32 size = texture.Size; ; size /= 2)
+            {
+                u32 blocks = (size + 3) / 4;
+                levelBytes[t].push_back(u64(blocks) * blocks * 16);
+                if (size > tailSize)
+                    ++tail;
+                if (size == 1)
+                    break;
+            }
+            texture.Id = residency.AddTexture(levelBytes[t], tail);
+            texture.Level = tail;
+            for (u32 i = tail; i < levelBytes[t].size(); ++i)
+                texture.Bytes += levelBytes[t][i];
+            memory += texture.Bytes;
+        }
+
+        std::vector<SimulatedLoad> inFlight;
+        u64 inFlightBytes = 0;
+        double errorSum = 0.0;
+        u64 errorCount = 0;
+        std::vector<float> requested(textureCount);
+        for (u32 frame = 0; frame < frames; ++frame)
+        {
+            //the camera sweeps back and forth along the row
+            float camera = rowLength * 0.5f + rowLength * 0.45f * std::sin(frame * 0.01f);
+            for (u32 t = 0; t < textureCount; ++t)
+            {
+                float distance = std::abs(textures[t].Position - camera) + objectRadius * 1.25f;
+                requested[t] = -1.0f;
+                if (distance > viewDistance)
+                    continue;
+                float uvPerPixel = EstimateUvPerPixel(uvDensity, objectRadius, objectRadius, distance, fovY, screenHeight);
+                requested[t] = EstimateLevel(textures[t].Size, uvPerPixel);
+                residency.RequestLevel(textures[t].Id, requested[t]);
+            }
+
+            //uploads land in memory a few frames after they were asked for
+            for (size_t i = 0; i < inFlight.size();)
+            {
+                SimulatedLoad load = inFlight[i];
+                if (load.ReadyFrame > frame)
+                {
+                    ++i;
+                    continue;
+                }
+                SimulatedTexture& texture = textures[load.Texture];
+                u64 bytes = levelBytes[load.Texture][load.Level];
+                result.Consistent = result.Consistent && load.Level + 1 == texture.Level;
+                texture.Level = load.Level;
+                texture.Bytes += bytes;
+                memory += bytes;
+                inFlightBytes -= bytes;
+                residency.FinishLoad(texture.Id, load.Level);
+                inFlight[i] = inFlight.back();
+                inFlight.pop_back();
+            }
+
+            for (ResidencyChange const& change : residency.Update())
+            {
+                u64 bytes = levelBytes[change.Texture][change.Level];
+                SimulatedTexture& texture = textures[change.Texture];
+                if (change.Action == ResidencyAction::Evict)
+                {
+                    result.Consistent = result.Consistent && change.Level == texture.Level;
+                    texture.Level = change.Level + 1;
+                    texture.Bytes -= bytes;
+                    memory -= bytes;
+                    ++result.Evictions;
+                }
+                else
+                {
+                    SimulatedLoad load;
+                    load.Texture = change.Texture;
+                    load.Level = change.Level;
+                    load.ReadyFrame = frame + 1 + random() % 3;
+                    inFlight.push_back(load);
+                    inFlightBytes += bytes;
+                    ++result.Loads;
+                }
+            }
+
+            result.PeakBytes = std::max(result.PeakBytes, memory + inFlightBytes);
+            if (memory + inFlightBytes > budgetBytes)
+                ++result.FramesOverBudget;
+            result.Consistent = result.Consistent && residency.GetCommittedBytes() == memory + inFlightBytes;
+            for (u32 t = 0; t < textureCount; ++t)
+            {
+                TextureResidencyStats stats = residency.GetStats(textures[t].Id);
+                result.Consistent = result.Consistent && stats.ResidentLevel == textures[t].Level && stats.ResidentBytes == textures[t].Bytes;
+                if (requested[t] < 0.0f)
+                    continue;
+                float needed = std::floor(requested[t]);
+                errorSum += std::max(0.0f, stats.ResidentLevel - needed);
+                ++errorCount;
+            }
+        }
+
+        result.AverageLevelError = errorCount ? static_cast<float>(errorSum / errorCount) : 0.0f;
+        result.FinalMipBias = residency.GetMipBias();
+        result.Milliseconds = elapsedMilliseconds(start);
+        return result;
+    }
+
+    bool TextureResidency::canEvict(Entry const& entry, bool force)
+    {
+        if (!entry.Alive || entry.External || entry.Loading || entry.ResidentLevel >= entry.TailLevel)
+            return false;
+        //levels finer than the last request asked for are spare, so are all of an unused texture
+        return force || !entry.Requested || entry.ResidentLevel < entry.WantedLevel;
+    }
+
+    u64 TextureResidency::committedBytes(Entry const& entry)
+    {
+        u64 bytes = entry.Loading ? entry.LevelBytes[entry.ResidentLevel - 1] : 0;
+        for (u32 i = entry.ResidentLevel; i < entry.LevelBytes.size(); ++i)
+            bytes += entry.LevelBytes[i];
+        return bytes;
+    }
+
+    bool TextureResidency::makeRoom(u64 bytes, u32 except, bool force, std::vector<ResidencyChange>& changes)
+    {
+        if (m_committed + m_reserved + bytes <= m_budget)
+            return true;
+        std::vector<u32> victims;
+        for (u32 id = 0; id < m_entries.size(); ++id)
+        {
+            if (id != except && canEvict(m_entries[id], force))
+                victims.push_back(id);
+        }
+        //least recently used first, the biggest levels first among equals
+        std::sort(victims.begin(), victims.end(), [this](u32 a, u32 b)
+        {
+            Entry const& entryA = m_entries[a];
+            Entry const& entryB = m_entries[b];
+            if (entryA.LastUsedFrame != entryB.LastUsedFrame)
+                return entryA.LastUsedFrame < entryB.LastUsedFrame;
+            return entryA.LevelBytes[entryA.ResidentLevel] > entryB.LevelBytes[entryB.ResidentLevel];
+        });
+        for (u32 id : victims)
+        {
+            Entry& entry = m_entries[id];
+            while (canEvict(entry, force) && m_committed + m_reserved + bytes > m_budget)
+            {
+                ResidencyChange change;
+                change.Texture = id;
+                change.Level = entry.ResidentLevel;
+                change.Action = ResidencyAction::Evict;
+                changes.push_back(change);
+                m_committed -= entry.LevelBytes[entry.ResidentLevel];
+                ++entry.ResidentLevel;
+            }
+            if (m_committed + m_reserved + bytes <= m_budget)
+                return true;
+        }
+        return false;
+    }
+}
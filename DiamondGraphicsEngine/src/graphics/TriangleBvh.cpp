@@ -0,0 +1,609 @@
+#include "Precompiled.h"
+#include "graphics/TriangleBvh.h"
+#include "graphics/TriangleMesh.h"
+#include "framework/ParallelFor.h"
+
+namespace
+{
+    using namespace Math;
+
+    //binned SAH: split candidates per axis and cost of a traversal step relative to a batch of triangle tests
+    const u32 c_sahBins = 16;
+    const float c_traversalCost = 1.0f;
+    //leaves never get deeper than this, so the traversal stack has a fixed size
+    const u32 c_maxDepth = 60;
+    //the top levels are split on the calling thread until subtrees are smaller than both of these
+    const u32 c_minTaskTriangles = 1024;
+    const u32 c_tasksPerThread = 4;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    float surfaceArea(Vector3 const& minimum, Vector3 const& maximum)
+    {
+        Vector3 extent = maximum - minimum;
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    void slabAxis(float minimum, float maximum, float start, float invDirection, float& tmin, float& tmax)
+    {
+        float tNear = (minimum - start) * invDirection;
+        float tFar = (maximum - start) * invDirection;
+        //NaN (0 * inf on a slab border) must not shrink the interval
+        if (tNear > tFar)
+            std::swap(tNear, tFar);
+        tmin = tNear > tmin ? tNear : tmin;
+        tmax = tFar < tmax ? tFar : tmax;
+    }
+
+    //entry distance of the box, FLT_MAX when it is missed or beyond maxT, like BoundingVolumeHierarchy::RayCast
+    //by component, Vector3::operator[] is an out of line checked call and this runs twice per visited node
+    float slab(Vector3 const& minimum, Vector3 const& maximum, Vector3 const& start, Vector3 const& invDirection, float maxT)
+    {
+        float tmin = 0.0f;
+        float tmax = maxT;
+        slabAxis(minimum.x, maximum.x, start.x, invDirection.x, tmin, tmax);
+        slabAxis(minimum.y, maximum.y, start.y, invDirection.y, tmin, tmax);
+        slabAxis(minimum.z, maximum.z, start.z, invDirection.z, tmin, tmax);
+        return tmin <= tmax ? tmin : FLT_MAX;
+    }
+
+    //Möller-Trumbore one triangle at a time, in the order of the Batch kernel, for the brute force reference
+    bool intersectTriangle(Vector3 const& start, Vector3 const& direction, Vector3 const& a, Vector3 const& b,
+                           Vector3 const& c, float& t)
+    {
+        Vector3 edge1 = b - a;
+        Vector3 edge2 = c - a;
+        Vector3 p(direction.y * edge2.z - direction.z * edge2.y, direction.z * edge2.x - direction.x * edge2.z,
+                  direction.x * edge2.y - direction.y * edge2.x);
+        float inverse = 1.0f / (edge1.x * p.x + edge1.y * p.y + edge1.z * p.z);
+        Vector3 s = start - a;
+        Vector3 q(s.y * edge1.z - s.z * edge1.y, s.z * edge1.x - s.x * edge1.z, s.x * edge1.y - s.y * edge1.x);
+        float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inverse;
+        float v = (direction.x * q.x + direction.y * q.y + direction.z * q.z) * inverse;
+        float distance = (edge2.x * q.x + edge2.y * q.y + edge2.z * q.z) * inverse;
+        if (0.0f <= u && 0.0f <= v && u + v <= 1.0f && 0.0f < distance && distance < t)
+        {
+            t = distance;
+            return true;
+        }
+        return false;
+    }
+}
+
+namespace Graphics
+{
+    static_assert(sizeof(Math::Vector3) == 12, "TriangleBvh nodes are two Vector3s and two u32s in 32 bytes");
+
+    struct TriangleBvh::BuildState
+    {
+        //per mesh triangle, Vertices holds its a, b and c
+        std::vector<Vector3> Vertices;
+        std::vector<Vector3> BoundsMin;
+        std::vector<Vector3> BoundsMax;
+        std::vector<Vector3> Centers;
+        //mesh triangles, partitioned in place so every node owns a range
+        std::vector<u32> Order;
+        //triangles tested per step at run time, and the largest leaf the SAH may keep
+        u32 Width = 1;
+        u32 MaxLeaf = 4;
+
+        //leaf cost in Batch steps
+        float StepsOf(u32 count) const { return static_cast<float>((count + Width - 1) / Width); }
+    };
+
+    void TriangleBvh::Build(TriangleMesh const& mesh, u32 maxThreads)
+    {
+        Clear();
+        u32 triangleCount = static_cast<u32>(mesh.m_triangles.size());
+        if (triangleCount == 0)
+            return;
+        m_triangleCount = triangleCount;
+
+        BuildState state;
+        state.Width = Batch::GetWidth(Batch::GetBackend());
+        state.MaxLeaf = std::max(state.Width, 4u);
+        state.Vertices.resize(3 * triangleCount);
+        state.BoundsMin.resize(triangleCount);
+        state.BoundsMax.resize(triangleCount);
+        state.Centers.resize(triangleCount);
+        state.Order.resize(triangleCount);
+        std::iota(state.Order.begin(), state.Order.end(), 0u);
+        ParallelFor(triangleCount, 4096, [&](u32 begin, u32 end)
+        {
+            for (u32 i = begin; i < end; ++i)
+            {
+                TriangleMesh::TriangleFace const& face = mesh.m_triangles[i];
+                Vector3 const& a = state.Vertices[3 * i] = mesh.m_vertices[face.a].position;
+                Vector3 const& b = state.Vertices[3 * i + 1] = mesh.m_vertices[face.b].position;
+                Vector3 const& c = state.Vertices[3 * i + 2] = mesh.m_vertices[face.c].position;
+                state.BoundsMin[i] = Min(a, Min(b, c));
+                state.BoundsMax[i] = Max(a, Max(b, c));
+                state.Centers[i] = (state.BoundsMin[i] + state.BoundsMax[i]) * 0.5f;
+            }
+        }, maxThreads);
+
+        //top levels here, each subtree below the grain becomes a task
+        struct Task
+        {
+            u32 Node, Begin, End, Depth;
+        };
+        u32 threadCount = maxThreads ? maxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+        u32 grain = std::max(c_minTaskTriangles, triangleCount / (threadCount * c_tasksPerThread));
+        std::vector<Task> pending = { { 0, 0, triangleCount, 0 } };
+        std::vector<Task> tasks;
+        m_nodes.resize(1);
+        while (!pending.empty())
+        {
+            Task task = pending.back();
+            pending.pop_back();
+            if (task.End - task.Begin <= grain || threadCount == 1)
+            {
+                tasks.push_back(task);
+                continue;
+            }
+            Node& node = m_nodes[task.Node];
+            node.BoundsMin = state.BoundsMin[state.Order[task.Begin]];
+            node.BoundsMax = state.BoundsMax[state.Order[task.Begin]];
+            for (u32 i = task.Begin + 1; i < task.End; ++i)
+            {
+                node.BoundsMin = Min(node.BoundsMin, state.BoundsMin[state.Order[i]]);
+                node.BoundsMax = Max(node.BoundsMax, state.BoundsMax[state.Order[i]]);
+            }
+            u32 mid;
+            if (!splitNode(state, node, task.Begin, task.End, task.Depth, mid))
+            {
+                tasks.push_back(task);
+                continue;
+            }
+            u32 left = static_cast<u32>(m_nodes.size());
+            m_nodes[task.Node].LeftOrFirst = left;
+            m_nodes.resize(left + 2);
+            pending.push_back({ left, task.Begin, mid, task.Depth + 1 });
+            pending.push_back({ left + 1, mid, task.End, task.Depth + 1 });
+        }
+
+        //every task builds into its own array with its root at 0, which is then appended here
+        std::vector<std::vector<Node>> subtrees(tasks.size());
+        ParallelFor(static_cast<u32>(tasks.size()), 1, [&](u32 begin, u32 end)
+        {
+            for (u32 t = begin; t < end; ++t)
+            {
+                subtrees[t].reserve(2 * (tasks[t].End - tasks[t].Begin) / state.Width + 1);
+                subtrees[t].resize(1);
+                buildNode(state, subtrees[t], 0, tasks[t].Begin, tasks[t].End, tasks[t].Depth);
+            }
+        }, maxThreads);
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            //local child k lands at base + k - 1
+            u32 offset = static_cast<u32>(m_nodes.size()) - 1;
+            for (Node& node : subtrees[t])
+            {
+                if (!node.IsLeaf())
+                    node.LeftOrFirst += offset;
+            }
+            m_nodes[tasks[t].Node] = subtrees[t][0];
+            m_nodes.insert(m_nodes.end(), subtrees[t].begin() + 1, subtrees[t].end());
+        }
+        pack(state);
+    }
+
+    void TriangleBvh::Clear()
+    {
+        m_nodes.clear();
+        m_corners.Resize(0);
+        m_edges1.Resize(0);
+        m_edges2.Resize(0);
+        m_triangleIds.clear();
+        m_triangleCount = 0;
+    }
+
+    bool TriangleBvh::RayCast(Ray const& ray, Hit& hit) const
+    {
+        if (m_nodes.empty())
+            return false;
+        Vector3 start = ray.GetStartPosition();
+        Vector3 direction = ray.GetRayDirection();
+        Vector3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+        TriangleHit nearest;
+        nearest.distance = hit.Distance;
+        size_t nearestSlot = 0;
+        bool found = false;
+        //a node and the distance its box was entered at, at most one entry per level is pending
+        u32 stackNodes[c_maxDepth + 2];
+        float stackDistances[c_maxDepth + 2];
+        u32 stackSize = 0;
+        float rootT = slab(m_nodes[0].BoundsMin, m_nodes[0].BoundsMax, start, invDirection, nearest.distance);
+        if (rootT != FLT_MAX)
+        {
+            stackNodes[0] = 0;
+            stackDistances[0] = rootT;
+            stackSize = 1;
+        }
+        while (stackSize)
+        {
+            --stackSize;
+            if (stackDistances[stackSize] > nearest.distance)
+                continue;
+            Node const& node = m_nodes[stackNodes[stackSize]];
+            if (node.IsLeaf())
+            {
+                if (Batch::IntersectTriangles(start, direction, leafTriangles(node), nearest))
+                {
+                    nearestSlot = node.LeftOrFirst + nearest.index;
+                    found = true;
+                }
+                continue;
+            }
+            Node const& left = m_nodes[node.LeftOrFirst];
+            Node const& right = m_nodes[node.LeftOrFirst + 1];
+            float leftT = slab(left.BoundsMin, left.BoundsMax, start, invDirection, nearest.distance);
+            float rightT = slab(right.BoundsMin, right.BoundsMax, start, invDirection, nearest.distance);
+            //push the far child first so the near one is visited first
+            bool leftNear = leftT < rightT;
+            u32 nearChild = leftNear ? node.LeftOrFirst : node.LeftOrFirst + 1;
+            float nearT = leftNear ? leftT : rightT;
+            float farT = leftNear ? rightT : leftT;
+            if (farT != FLT_MAX)
+            {
+                stackNodes[stackSize] = leftNear ? node.LeftOrFirst + 1 : node.LeftOrFirst;
+                stackDistances[stackSize++] = farT;
+            }
+            if (nearT != FLT_MAX)
+            {
+                stackNodes[stackSize] = nearChild;
+                stackDistances[stackSize++] = nearT;
+            }
+        }
+        if (!found)
+            return false;
+        hit.Triangle = m_triangleIds[nearestSlot];
+        hit.Distance = nearest.distance;
+        hit.U = nearest.u;
+        hit.V = nearest.v;
+        return true;
+    }
+
+    bool TriangleBvh::RayCastPacket(Math::RayArray& rays, Hit* hits) const
+    {
+        if (m_nodes.empty() || rays.Size() == 0)
+            return false;
+        RaySpan span = rays.GetSpan();
+        std::vector<float> entries(span.count);
+        bool found = false;
+        //nodes are tested when popped, so the distances lowered by the leaves before prune them
+        u32 stack[c_maxDepth + 2];
+        u32 stackSize = 1;
+        stack[0] = 0;
+        while (stackSize)
+        {
+            Node const& node = m_nodes[stack[--stackSize]];
+            if (Batch::IntersectBox(node.BoundsMin, node.BoundsMax, span, entries.data()) == FLT_MAX)
+                continue;
+            if (node.IsLeaf())
+            {
+                TriangleSpan triangles = leafTriangles(node);
+                for (size_t i = 0; i < span.count; ++i)
+                {
+                    if (entries[i] == FLT_MAX)
+                        continue;
+                    TriangleHit nearest;
+                    nearest.distance = rays.distance[i];
+                    if (!Batch::IntersectTriangles(rays.start.Get(i), rays.direction.Get(i), triangles, nearest))
+                        continue;
+                    rays.distance[i] = nearest.distance;
+                    hits[i].Triangle = m_triangleIds[node.LeftOrFirst + nearest.index];
+                    hits[i].Distance = nearest.distance;
+                    hits[i].U = nearest.u;
+                    hits[i].V = nearest.v;
+                    found = true;
+                }
+                continue;
+            }
+            //near child first for the first ray, along the axis the children are furthest apart on
+            Node const& left = m_nodes[node.LeftOrFirst];
+            Node const& right = m_nodes[node.LeftOrFirst + 1];
+            Vector3 separation = (right.BoundsMin + right.BoundsMax) - (left.BoundsMin + left.BoundsMax);
+            float towardsRight = span.inverseX[0] * separation.x;
+            if (Math::Abs(separation.y) > Math::Abs(separation.x) && Math::Abs(separation.y) >= Math::Abs(separation.z))
+                towardsRight = span.inverseY[0] * separation.y;
+            else if (Math::Abs(separation.z) > Math::Abs(separation.x) && Math::Abs(separation.z) > Math::Abs(separation.y))
+                towardsRight = span.inverseZ[0] * separation.z;
+            bool leftNear = towardsRight >= 0.0f;
+            stack[stackSize++] = leftNear ? node.LeftOrFirst + 1 : node.LeftOrFirst;
+            stack[stackSize++] = leftNear ? node.LeftOrFirst : node.LeftOrFirst + 1;
+        }
+        return found;
+    }
+
+    Math::TriangleSpan TriangleBvh::leafTriangles(Node const& leaf) const
+    {
+        TriangleSpan triangles;
+        triangles.x = m_corners.x.data() + leaf.LeftOrFirst;
+        triangles.y = m_corners.y.data() + leaf.LeftOrFirst;
+        triangles.z = m_corners.z.data() + leaf.LeftOrFirst;
+        triangles.edge1X = m_edges1.x.data() + leaf.LeftOrFirst;
+        triangles.edge1Y = m_edges1.y.data() + leaf.LeftOrFirst;
+        triangles.edge1Z = m_edges1.z.data() + leaf.LeftOrFirst;
+        triangles.edge2X = m_edges2.x.data() + leaf.LeftOrFirst;
+        triangles.edge2Y = m_edges2.y.data() + leaf.LeftOrFirst;
+        triangles.edge2Z = m_edges2.z.data() + leaf.LeftOrFirst;
+        triangles.count = leaf.Count;
+        return triangles;
+    }
+
+    float TriangleBvh::GetCost() const
+    {
+        if (m_nodes.empty())
+            return 0.0f;
+        float rootArea = surfaceArea(m_nodes[0].BoundsMin, m_nodes[0].BoundsMax);
+        if (rootArea <= 0.0f)
+            return 0.0f;
+        //leaves are padded to whole steps, so the width is the smallest leaf
+        u32 width = m_nodes.size() == 1 ? std::max(m_nodes[0].Count, 1u) : ~0u;
+        for (Node const& node : m_nodes)
+        {
+            if (node.IsLeaf())
+                width = std::min(width, node.Count);
+        }
+        float cost = 0.0f;
+        for (Node const& node : m_nodes)
+        {
+            float area = surfaceArea(node.BoundsMin, node.BoundsMax);
+            cost += node.IsLeaf() ? area * (node.Count / width) : area * c_traversalCost;
+        }
+        return cost / rootArea;
+    }
+
+    TriangleBvh::Benchmark TriangleBvh::Measure(TriangleMesh const& mesh, u32 rays, u32 bruteForceRays)
+    {
+        Benchmark result;
+        TriangleBvh tree;
+        auto start = std::chrono::high_resolution_clock::now();
+        tree.Build(mesh, 1);
+        result.SingleThreadBuildMilliseconds = elapsedMilliseconds(start);
+        start = std::chrono::high_resolution_clock::now();
+        tree.Build(mesh);
+        result.BuildMilliseconds = elapsedMilliseconds(start);
+        result.Triangles = tree.GetTriangleCount();
+        result.Nodes = tree.GetNodeCount();
+        result.Cost = tree.GetCost();
+        if (result.Triangles == 0)
+            return result;
+
+        //from a sphere twice the size of the mesh's towards a random point in the inner half of it
+        BoundingSphere const& sphere = mesh.GetBoundingSphere();
+        std::mt19937 random(4321);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        auto randomDirection = [&]()
+        {
+            Vector3 direction;
+            do
+            {
+                direction = Vector3(unit(random), unit(random), unit(random));
+            } while (direction.LengthSq() > 1.0f || direction.LengthSq() < 1e-6f);
+            return direction.Normalized();
+        };
+        std::vector<Ray> queries(rays);
+        for (Ray& query : queries)
+        {
+            Vector3 from = sphere.center + randomDirection() * (2.0f * sphere.radius);
+            Vector3 to = sphere.center + randomDirection() * (0.5f * sphere.radius * std::abs(unit(random)));
+            query = Ray(from, (to - from).Normalized());
+        }
+
+        std::vector<Hit> hits(rays);
+        std::vector<unsigned char> hitFlags(rays, 0);
+        start = std::chrono::high_resolution_clock::now();
+        for (u32 r = 0; r < rays; ++r)
+            hitFlags[r] = tree.RayCast(queries[r], hits[r]) ? 1 : 0;
+        float milliseconds = elapsedMilliseconds(start);
+        result.Rays = rays;
+        result.RaysHit = static_cast<u32>(std::count(hitFlags.begin(), hitFlags.end(), 1));
+        result.MegaRaysPerSecond = rays / std::max(milliseconds, 1e-3f) * 1e-3f;
+
+        bruteForceRays = std::min(bruteForceRays, rays);
+        std::vector<float> bruteDistances(bruteForceRays, FLT_MAX);
+        std::vector<u32> bruteTriangles(bruteForceRays, 0);
+        start = std::chrono::high_resolution_clock::now();
+        for (u32 r = 0; r < bruteForceRays; ++r)
+        {
+            Vector3 from = queries[r].GetStartPosition();
+            Vector3 direction = queries[r].GetRayDirection();
+            for (u32 t = 0; t < result.Triangles; ++t)
+            {
+                TriangleMesh::TriangleFace const& face = mesh.m_triangles[t];
+                if (intersectTriangle(from, direction, mesh.m_vertices[face.a].position, mesh.m_vertices[face.b].position,
+                                      mesh.m_vertices[face.c].position, bruteDistances[r]))
+                {
+                    bruteTriangles[r] = t;
+                }
+            }
+        }
+        milliseconds = elapsedMilliseconds(start);
+        result.BruteForceRays = bruteForceRays;
+        result.BruteForceMegaRaysPerSecond = bruteForceRays / std::max(milliseconds, 1e-3f) * 1e-3f;
+        for (u32 r = 0; r < bruteForceRays; ++r)
+        {
+            bool bruteHit = bruteDistances[r] != FLT_MAX;
+            //both find the same nearest distance, a ray through a shared edge may report either triangle
+            result.ResultsMatch &= bruteHit == (hitFlags[r] != 0);
+            if (bruteHit && hitFlags[r])
+                result.ResultsMatch &= hits[r].Distance == bruteDistances[r];
+        }
+        return result;
+    }
+
+    void TriangleBvh::buildNode(BuildState& state, std::vector<Node>& nodes, u32 index, u32 begin, u32 end, u32 depth)
+    {
+        Node node;
+        node.BoundsMin = state.BoundsMin[state.Order[begin]];
+        node.BoundsMax = state.BoundsMax[state.Order[begin]];
+        for (u32 i = begin + 1; i < end; ++i)
+        {
+            node.BoundsMin = Min(node.BoundsMin, state.BoundsMin[state.Order[i]]);
+            node.BoundsMax = Max(node.BoundsMax, state.BoundsMax[state.Order[i]]);
+        }
+        u32 mid;
+        if (!splitNode(state, node, begin, end, depth, mid))
+        {
+            node.LeftOrFirst = begin;
+            node.Count = end - begin;
+            nodes[index] = node;
+            return;
+        }
+        //nodes grows below, so it is only written through indices
+        u32 left = static_cast<u32>(nodes.size());
+        node.LeftOrFirst = left;
+        nodes[index] = node;
+        nodes.resize(left + 2);
+        buildNode(state, nodes, left, begin, mid, depth + 1);
+        buildNode(state, nodes, left + 1, mid, end, depth + 1);
+    }
+
+    bool TriangleBvh::splitNode(BuildState& state, Node const& node, u32 begin, u32 end, u32 depth, u32& mid)
+    {
+        u32 count = end - begin;
+        if (count <= 1 || depth >= c_maxDepth)
+            return false;
+
+        Vector3 centerMin = state.Centers[state.Order[begin]];
+        Vector3 centerMax = centerMin;
+        for (u32 i = begin + 1; i < end; ++i)
+        {
+            centerMin = Min(centerMin, state.Centers[state.Order[i]]);
+            centerMax = Max(centerMax, state.Centers[state.Order[i]]);
+        }
+
+        //unlike the object tree every axis is binned, meshes are often long along one axis and split best across it
+        struct Bin
+        {
+            Vector3 BoundsMin;
+            Vector3 BoundsMax;
+            u32 Count = 0;
+        };
+        float bestCost = FLT_MAX;
+        unsigned bestAxis = 0;
+        u32 bestSplit = c_sahBins;
+        for (unsigned axis = 0; axis < 3; ++axis)
+        {
+            float spread = centerMax[axis] - centerMin[axis];
+            if (spread <= 0.0f)
+                continue;
+            Bin bins[c_sahBins];
+            float binScale = c_sahBins / spread;
+            for (u32 i = begin; i < end; ++i)
+            {
+                u32 triangle = state.Order[i];
+                u32 b = std::min(static_cast<u32>((state.Centers[triangle][axis] - centerMin[axis]) * binScale), c_sahBins - 1);
+                Bin& bin = bins[b];
+                bin.BoundsMin = bin.Count ? Min(bin.BoundsMin, state.BoundsMin[triangle]) : state.BoundsMin[triangle];
+                bin.BoundsMax = bin.Count ? Max(bin.BoundsMax, state.BoundsMax[triangle]) : state.BoundsMax[triangle];
+                ++bin.Count;
+            }
+
+            //sweep from the right to get the cost of everything right of each split
+            float rightCost[c_sahBins];
+            Vector3 sweepMin, sweepMax;
+            u32 sweepCount = 0;
+            for (u32 b = c_sahBins - 1; b > 0; --b)
+            {
+                if (bins[b].Count)
+                {
+                    sweepMin = sweepCount ? Min(sweepMin, bins[b].BoundsMin) : bins[b].BoundsMin;
+                    sweepMax = sweepCount ? Max(sweepMax, bins[b].BoundsMax) : bins[b].BoundsMax;
+                    sweepCount += bins[b].Count;
+                }
+                rightCost[b] = sweepCount ? surfaceArea(sweepMin, sweepMax) * state.StepsOf(sweepCount) : -1.0f;
+            }
+
+            //split after bin b: left is [0, b], right is [b + 1, bins)
+            sweepCount = 0;
+            for (u32 b = 0; b + 1 < c_sahBins; ++b)
+            {
+                if (bins[b].Count)
+                {
+                    sweepMin = sweepCount ? Min(sweepMin, bins[b].BoundsMin) : bins[b].BoundsMin;
+                    sweepMax = sweepCount ? Max(sweepMax, bins[b].BoundsMax) : bins[b].BoundsMax;
+                    sweepCount += bins[b].Count;
+                }
+                if (sweepCount == 0 || rightCost[b + 1] < 0.0f)
+                    continue;
+                float cost = surfaceArea(sweepMin, sweepMax) * state.StepsOf(sweepCount) + rightCost[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        float area = surfaceArea(node.BoundsMin, node.BoundsMax);
+        if (bestSplit != c_sahBins)
+        {
+            //a leaf costs its area times its steps, an inner node one traversal step more than its children
+            if (count <= state.MaxLeaf && area * state.StepsOf(count) <= area * c_traversalCost + bestCost)
+                return false;
+            float binScale = c_sahBins / (centerMax[bestAxis] - centerMin[bestAxis]);
+            auto split = std::partition(state.Order.begin() + begin, state.Order.begin() + end, [&](u32 triangle)
+            {
+                u32 b = static_cast<u32>((state.Centers[triangle][bestAxis] - centerMin[bestAxis]) * binScale);
+                return std::min(b, c_sahBins - 1) <= bestSplit;
+            });
+            mid = static_cast<u32>(split - state.Order.begin());
+            if (mid != begin && mid != end)
+                return true;
+        }
+        //all centers in one spot (or one bin), any split is as good as another
+        if (count <= state.MaxLeaf)
+            return false;
+        mid = begin + count / 2;
+        return true;
+    }
+
+    void TriangleBvh::pack(BuildState const& state)
+    {
+        //leaves in node order, each padded to whole Batch steps with triangles that have no area
+        u32 packedCount = 0;
+        for (Node const& node : m_nodes)
+        {
+            if (node.IsLeaf())
+                packedCount += (node.Count + state.Width - 1) / state.Width * state.Width;
+        }
+        m_corners.Resize(packedCount);
+        m_edges1.Resize(packedCount);
+        m_edges2.Resize(packedCount);
+        m_triangleIds.resize(packedCount);
+        u32 slot = 0;
+        for (Node& node : m_nodes)
+        {
+            if (!node.IsLeaf())
+                continue;
+            u32 first = slot;
+            for (u32 i = node.LeftOrFirst; i < node.LeftOrFirst + node.Count; ++i, ++slot)
+            {
+                u32 triangle = state.Order[i];
+                m_triangleIds[slot] = triangle;
+                Vector3 const* vertices = &state.Vertices[3 * triangle];
+                m_corners.Set(slot, vertices[0]);
+                m_edges1.Set(slot, vertices[1] - vertices[0]);
+                m_edges2.Set(slot, vertices[2] - vertices[0]);
+            }
+            for (; (slot - first) % state.Width; ++slot)
+            {
+                m_triangleIds[slot] = m_triangleIds[slot - 1];
+                m_corners.Set(slot, m_corners.Get(slot - 1));
+                m_edges1.Set(slot, Vector3(0.0f, 0.0f, 0.0f));
+                m_edges2.Set(slot, Vector3(0.0f, 0.0f, 0.0f));
+            }
+            node.LeftOrFirst = first;
+            node.Count = slot - first;
+        }
+    }
+}
@@ -3,6 +3,21 @@
 #include "graphics/TriangleMesh.h"
 #include "math/Math.h"
 
+namespace
+{
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    float median(std::vector<float> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+}
+
 namespace Graphics
 {
     using namespace Math;
@@ -46,6 +61,8 @@ namespace Graphics
             ibo.AddTriangle(tri.a, tri.b, tri.c);
         }
 
+        calculateUvDensity();
+
         // upload the contents of the VBO and IBO to the GPU and build the VAO
         array->Build(this);
 
@@ -56,12 +73,15 @@ namespace Graphics
     }
 
     void TriangleMesh::Preprocess(DefaultUvType defaultUvType)
+    {
+        Preprocess(defaultUvType, Math::MathTier::Precise);
+    }
+
+    void TriangleMesh::Preprocess(DefaultUvType defaultUvType, Math::MathTier uvTier)
     {
         // various useful steps for preparing this model for rendering; none of
         // these would be done for a game
-        centerMesh();
-        normalizeVertices();
-        CalculateBoundingSphere();
+        preparePositions();
 
         std::vector<std::vector<unsigned> > adjList;
         adjList.resize(this->GetVertexCount());
@@ -118,7 +138,7 @@ namespace Graphics
             break;
         case Graphics::DefaultUvType::Spherical:
         default:
-            CalcUvSpherical();
+            CalcUvSpherical(uvTier);
             break;
         }
         CalcTanBitan();
@@ -204,17 +224,54 @@ namespace Graphics
 
     void TriangleMesh::CalculateBoundingSphere()
     {
-        m_boudingSphere.center = m_center;
-        float farestDistSq = 0;
-        for (auto& i : m_vertices)
+        Math::Vector3Array positions = loadPositions();
+        calculateBoundingSphere(positions.GetSpan());
+    }
+
+    bool TriangleMesh::RayCast(Ray const& localRay, TriangleBvh::Hit& hit)
+    {
+        return GetBvh()->RayCast(localRay, hit);
+    }
+
+    std::shared_ptr<TriangleBvh> TriangleMesh::GetBvh()
+    {
+        if (!m_bvh)
         {
-            float distSq = i.position.LengthSq();
-            if (distSq > farestDistSq)
-            {
-                farestDistSq = distSq;
-            }
+            m_bvh = std::make_shared<TriangleBvh>();
+            m_bvh->Build(*this);
+        }
+        return m_bvh;
+    }
+
+    bool TriangleMesh::RayCast(Ray const& localRay, float* t)
+    {
+        //the sphere is much cheaper to miss than the tree
+        float sphereT;
+        if (!m_boudingSphere.CheckRayCollision(localRay, &sphereT))
+            return false;
+        TriangleBvh::Hit hit;
+        if (!RayCast(localRay, hit))
+            return false;
+        *t = hit.Distance;
+        return true;
+    }
+
+    void TriangleMesh::calculateUvDensity()
+    {
+        float surfaceArea = 0.0f;
+        float uvArea = 0.0f;
+        for (TriangleFace const& tri : m_triangles)
+        {
+            Vertex const& a = m_vertices[tri.a];
+            Vertex const& b = m_vertices[tri.b];
+            Vertex const& c = m_vertices[tri.c];
+            surfaceArea += Cross(b.position - a.position, c.position - a.position).Length();
+            Math::Vector2 uvEdge0 = b.uv - a.uv;
+            Math::Vector2 uvEdge1 = c.uv - a.uv;
+            uvArea += Math::Abs(uvEdge0.x * uvEdge1.y - uvEdge0.y * uvEdge1.x);
         }
-        m_boudingSphere.radius = Math::Sqrt(farestDistSq);
+        //meshes without UVs keep the default of one
+        m_uvDensity = surfaceArea > 0.0f && uvArea > 0.0f ? Math::Sqrt(uvArea / surfaceArea) : 1.0f;
     }
 
     size_t TriangleMesh::GetVertexSize()
@@ -253,37 +310,54 @@ namespace Graphics
     /* helper methods */
 
 
-    void TriangleMesh::centerMesh()
+    void TriangleMesh::preparePositions()
+    {
+        m_bvh.reset();
+        Math::Vector3Array positions = loadPositions();
+        centerMesh(positions.GetSpan());
+        normalizeVertices(positions.GetSpan());
+        calculateBoundingSphere(positions.GetSpan());
+        storePositions(positions);
+    }
+
+
+    Math::Vector3Array TriangleMesh::loadPositions() const
+    {
+        Math::Vector3Array positions(m_vertices.size());
+        if (!m_vertices.empty())
+            Math::Batch::Load(&m_vertices[0].position, sizeof(Vertex), positions.GetSpan());
+        return positions;
+    }
+
+
+    void TriangleMesh::storePositions(Math::Vector3Array& positions)
+    {
+        if (!m_vertices.empty())
+            Math::Batch::Store(positions.GetSpan(), &m_vertices[0].position, sizeof(Vertex));
+    }
+
+
+    void TriangleMesh::centerMesh(Math::Vector3Span positions)
     {
         // find the centroid of the entire mesh (average of all vertices, hoping for
         // no overflow) and translate all vertices by the negative of this centroid
         // to ensure all transformations are about the origin
-        for (auto& vert : m_vertices)
-            m_center += vert.position;
-        m_center *= 1.f / static_cast<f32>(m_vertices.size());
+        m_center += Math::Batch::Sum(positions);
+        m_center *= 1.f / static_cast<f32>(positions.count);
         // translate by negative centroid to center model at (0, 0, 0)
         m_center = -m_center;
-        for (auto& vert : m_vertices)
-            vert.position += m_center;
+        Math::Batch::Translate(positions, m_center, positions);
     }
 
 
-    void TriangleMesh::normalizeVertices()
+    void TriangleMesh::normalizeVertices(Math::Vector3Span positions)
     {
         // find the extent of this mesh and normalize all vertices by scaling them
         // by the inverse of the smallest value of the extent (that isn't zero)
-        Vector3 minimum = m_vertices[0].position;
-        Vector3 maximum = m_vertices[0].position;
-        for (auto& vert : m_vertices)
-        {
-            f32 x = vert.position.x, y = vert.position.y, z = vert.position.z;
-            minimum.x = std::min(minimum.x, x);
-            minimum.y = std::min(minimum.y, y);
-            minimum.z = std::min(minimum.z, z);
-            maximum.x = std::max(maximum.x, x);
-            maximum.y = std::max(maximum.y, y);
-            maximum.z = std::max(maximum.z, z);
-        }
+        if (positions.count == 0)
+            return;
+        Vector3 minimum, maximum;
+        Math::Batch::MinMax(positions, minimum, maximum);
         Vector3 extent = maximum - minimum;
         f32 minExtentLength = 0.f;
         bool xZero = IsZero(extent.x);
@@ -321,22 +395,32 @@ namespace Graphics
         else
             minExtentLength = std::min(std::min(extent.x, extent.y), extent.z);
         f32 scalar = 1.f / minExtentLength; // guaranteed to not be 1/0
-        for (auto& vert : m_vertices)
-            vert.position *= scalar;
+        Math::Batch::Scale(positions, scalar, positions);
     }
 
-    TriangleMesh* TriangleMesh::CalcUvSpherical()
+    void TriangleMesh::calculateBoundingSphere(Math::Vector3Span positions)
     {
-		for (auto& i : m_vertices)
-		{
+        //the positions are already centered, m_center is the offset that did it
+        m_boudingSphere.center = Math::Vector3(0.0f);
+        m_boudingSphere.radius = Math::Sqrt(Math::Batch::MaxLengthSq(positions));
+    }
 
-			Vector3 vec = i.position.Normalized();
-			float theta = std::atan2(-vec.z, vec.x);
-			float u = (theta + Math::c_Pi) / Math::c_TwoPi;
-			float phi = std::acos(vec.y);
-			float v = (phi) / Math::c_Pi;
-			i.uv.x = Clamp(u);
-			i.uv.y = Clamp(v);
+    TriangleMesh* TriangleMesh::CalcUvSpherical(Math::MathTier tier)
+    {
+        Math::Vector3Array directions = loadPositions();
+        Math::Batch::Normalize(directions.GetSpan(), directions.GetSpan());
+        size_t count = m_vertices.size();
+        for (size_t i = 0; i < count; ++i)
+            directions.z[i] = -directions.z[i];
+        //theta and phi reuse the x and y arrays
+        Math::Batch::ArcTan2(tier, directions.z.data(), directions.x.data(), directions.x.data(), count);
+        Math::Batch::ArcCos(tier, directions.y.data(), directions.y.data(), count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			float u = (directions.x[i] + Math::c_Pi) / Math::c_TwoPi;
+			float v = (directions.y[i]) / Math::c_Pi;
+			m_vertices[i].uv.x = Clamp(u);
+			m_vertices[i].uv.y = Clamp(v);
 		}
         return this;
     }
@@ -444,4 +528,64 @@ namespace Graphics
         }
         return this;
     }
+
+    TriangleMesh::PreprocessBenchmark TriangleMesh::MeasurePreprocess(u32 resolution, u32 runs)
+    {
+        //a UV sphere with shared vertices, the poles are rows of vertices like any other
+        resolution = std::max(resolution, 2u);
+        TriangleMesh sphere;
+        for (u32 ring = 0; ring <= resolution; ++ring)
+        {
+            float phi = c_Pi * ring / resolution;
+            for (u32 segment = 0; segment <= resolution; ++segment)
+            {
+                float theta = c_TwoPi * segment / resolution;
+                sphere.AddVertex(Sin(phi) * Cos(theta), Cos(phi), Sin(phi) * Sin(theta));
+            }
+        }
+        for (u32 ring = 0; ring < resolution; ++ring)
+        {
+            for (u32 segment = 0; segment < resolution; ++segment)
+            {
+                u32 corner = ring * (resolution + 1) + segment;
+                sphere.AddTriangle(corner, corner + resolution + 1, corner + 1);
+                sphere.AddTriangle(corner + 1, corner + resolution + 1, corner + resolution + 2);
+            }
+        }
+
+        PreprocessBenchmark benchmark;
+        benchmark.Vertices = static_cast<u32>(sphere.m_vertices.size());
+        benchmark.Triangles = static_cast<u32>(sphere.m_triangles.size());
+        std::vector<float> preprocess, tangents, fastPreprocess;
+        for (u32 run = 0; run < std::max(runs, 1u); ++run)
+        {
+            TriangleMesh mesh = sphere;
+            auto start = std::chrono::high_resolution_clock::now();
+            mesh.Preprocess(DefaultUvType::Spherical);
+            preprocess.push_back(elapsedMilliseconds(start));
+
+            //fresh tangents on the preprocessed mesh, CalcTanBitan adds to what is there
+            for (Vertex& vertex : mesh.m_vertices)
+                vertex.tangent = vertex.bitangent = Vector3(0, 0, 0);
+            mesh.m_tangent.clear();
+            mesh.m_bitangent.clear();
+            start = std::chrono::high_resolution_clock::now();
+            mesh.CalcTanBitan();
+            tangents.push_back(elapsedMilliseconds(start));
+
+            TriangleMesh fast = sphere;
+            start = std::chrono::high_resolution_clock::now();
+            fast.Preprocess(DefaultUvType::Spherical, Math::MathTier::Fast);
+            fastPreprocess.push_back(elapsedMilliseconds(start));
+            for (size_t i = 0; i < mesh.m_vertices.size(); ++i)
+            {
+                Vector2 difference = Math::Abs(fast.m_vertices[i].uv - mesh.m_vertices[i].uv);
+                benchmark.FastUvError = std::max(benchmark.FastUvError, std::max(difference.x, difference.y));
+            }
+        }
+        benchmark.PreprocessMilliseconds = median(preprocess);
+        benchmark.TangentMilliseconds = median(tangents);
+        benchmark.FastPreprocessMilliseconds = median(fastPreprocess);
+        return benchmark;
+    }
 }
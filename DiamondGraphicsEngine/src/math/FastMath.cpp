@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file FastMath.cpp
+/// The accuracy and speed benchmark of the math policies.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/FastMath.h"
+#include "framework/ParallelFor.h"
+
+namespace
+{
+    using namespace Math;
+
+    const unsigned c_TimingSamples = 4096;
+    const unsigned c_TimingRuns = 5;
+
+    //absolute error, relative once the result is larger than 1 so Log's large results count by their precision
+    double errorOf(float value, double exact, bool relative)
+    {
+        double difference = std::abs(static_cast<double>(value) - exact);
+        return difference / (relative ? std::abs(exact) : std::max(1.0, std::abs(exact)));
+    }
+
+    //floats per job of the error sweep
+    const u32 c_SweepChunk = 1u << 20;
+
+    //the bit patterns of a run of floats of one sign, ordered by magnitude
+    struct BitRange
+    {
+        uint32_t First;
+        uint64_t Count;
+    };
+
+    uint32_t bitsOf(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+
+    //every float in [minimum, maximum], -0 and +0 included, as a range per sign
+    std::vector<BitRange> bitRanges(float minimum, float maximum)
+    {
+        std::vector<BitRange> ranges;
+        if (maximum >= 0.0f)
+        {
+            uint32_t first = bitsOf(minimum > 0.0f ? minimum : 0.0f);
+            ranges.push_back({ first, uint64_t(bitsOf(maximum)) - first + 1 });
+        }
+        if (minimum <= 0.0f)
+        {
+            uint32_t first = bitsOf(maximum < 0.0f ? -maximum : 0.0f) | 0x80000000u;
+            ranges.push_back({ first, uint64_t(bitsOf(-minimum) | 0x80000000u) - first + 1 });
+        }
+        return ranges;
+    }
+
+    //largest error(x) over every stride-th float in [minimum, maximum] on every core, a NaN error
+    //counts as infinite; inputs is how many were checked
+    template <typename Error>
+    double maxErrorOver(float minimum, float maximum, unsigned stride, Error error, unsigned long long& inputs)
+    {
+        stride = std::max(stride, 1u);
+        double maxError = 0.0;
+        inputs = 0;
+        for (BitRange const& range : bitRanges(minimum, maximum))
+        {
+            uint64_t count = (range.Count + stride - 1) / stride;
+            u32 chunks = static_cast<u32>((count + c_SweepChunk - 1) / c_SweepChunk);
+            std::vector<double> chunkErrors(chunks, 0.0);
+            ParallelFor(chunks, 1, [&](u32 begin, u32 end)
+            {
+                for (u32 chunk = begin; chunk < end; ++chunk)
+                {
+                    uint64_t last = std::min(count, uint64_t(chunk + 1) * c_SweepChunk);
+                    double chunkError = 0.0;
+                    for (uint64_t i = uint64_t(chunk) * c_SweepChunk; i < last; ++i)
+                    {
+                        uint32_t pattern = static_cast<uint32_t>(range.First + i * stride);
+                        float x;
+                        std::memcpy(&x, &pattern, sizeof(x));
+                        double e = error(x);
+                        chunkError = std::isnan(e) ? std::numeric_limits<double>::infinity() : std::max(chunkError, e);
+                    }
+                    chunkErrors[chunk] = chunkError;
+                }
+            });
+            for (double chunkError : chunkErrors)
+                maxError = std::max(maxError, chunkError);
+            inputs += count;
+        }
+        return maxError;
+    }
+
+    //median time of one call of function(i) over c_TimingSamples inputs
+    template <typename Function>
+    float nanosecondsPerCall(Function function)
+    {
+        volatile float sink = 0.0f;
+        std::vector<float> nanoseconds;
+        for (unsigned run = 0; run < c_TimingRuns; ++run)
+        {
+            float sum = 0.0f;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned i = 0; i < c_TimingSamples; ++i)
+                sum += function(i);
+            std::chrono::duration<float, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+            nanoseconds.push_back(elapsed.count() / c_TimingSamples);
+            sink = sink + sum;
+        }
+        std::sort(nanoseconds.begin(), nanoseconds.end());
+        return nanoseconds[c_TimingRuns / 2];
+    }
+
+    //one function of one tier: its error over the domain, and the time of it and of its precise version
+    struct Measurement
+    {
+        char const* Function;
+        MathTier Tier;
+        double Bound;
+    };
+
+    template <typename Error, typename Time, typename PreciseTime>
+    FastMathBenchmark measure(Measurement const& measurement, float minimum, float maximum, unsigned stride,
+                              Error error, Time time, PreciseTime preciseTime)
+    {
+        FastMathBenchmark benchmark;
+        benchmark.Function = measurement.Function;
+        benchmark.Tier = measurement.Tier;
+        benchmark.ErrorBound = measurement.Bound;
+        benchmark.MaxError = maxErrorOver(minimum, maximum, stride, error, benchmark.Inputs);
+        benchmark.Nanoseconds = nanosecondsPerCall(time);
+        benchmark.PreciseNanoseconds = nanosecondsPerCall(preciseTime);
+        benchmark.Passed = benchmark.MaxError <= benchmark.ErrorBound;
+        return benchmark;
+    }
+
+    template <typename Policy>
+    void measureTier(std::vector<FastMathBenchmark>& benchmarks, unsigned stride, double const bounds[7])
+    {
+        const MathTier tier = Policy::Tier;
+        std::mt19937 random(1);
+        auto samples = [&](float minimum, float maximum)
+        {
+            std::uniform_real_distribution<float> distribution(minimum, maximum);
+            std::vector<float> values(c_TimingSamples);
+            for (float& value : values)
+                value = distribution(random);
+            return values;
+        };
+        std::vector<float> angles = samples(-c_TwoPi, c_TwoPi), units = samples(-1.0f, 1.0f);
+        std::vector<float> exponents = samples(-20.0f, 20.0f), positives = samples(0.001f, 1000.0f);
+
+        benchmarks.push_back(measure({ "Sin", tier, bounds[0] }, -8192.0f, 8192.0f, stride,
+            [](float x) { return errorOf(Policy::Sin(x), std::sin(static_cast<double>(x)), false); },
+            [&](unsigned i) { return Policy::Sin(angles[i]); },
+            [&](unsigned i) { return PreciseMath::Sin(angles[i]); }));
+        benchmarks.push_back(measure({ "Cos", tier, bounds[1] }, -8192.0f, 8192.0f, stride,
+            [](float x) { return errorOf(Policy::Cos(x), std::cos(static_cast<double>(x)), false); },
+            [&](unsigned i) { return Policy::Cos(angles[i]); },
+            [&](unsigned i) { return PreciseMath::Cos(angles[i]); }));
+        //every finite float as y against x = 1 and x = -1, and as x against y = 1, covers every branch
+        benchmarks.push_back(measure({ "ArcTan2", tier, bounds[2] }, -FLT_MAX, FLT_MAX, stride,
+            [](float x)
+            {
+                double error = errorOf(Policy::ArcTan2(x, 1.0f), std::atan2(static_cast<double>(x), 1.0), false);
+                error = std::max(error, errorOf(Policy::ArcTan2(x, -1.0f), std::atan2(static_cast<double>(x), -1.0), false));
+                return std::max(error, errorOf(Policy::ArcTan2(1.0f, x), std::atan2(1.0, static_cast<double>(x)), false));
+            },
+            [&](unsigned i) { return Policy::ArcTan2(units[i], units[c_TimingSamples - 1 - i]); },
+            [&](unsigned i) { return PreciseMath::ArcTan2(units[i], units[c_TimingSamples - 1 - i]); }));
+        benchmarks.push_back(measure({ "ArcCos", tier, bounds[3] }, -1.0f, 1.0f, stride,
+            [](float x) { return errorOf(Policy::ArcCos(x), std::acos(static_cast<double>(x)), false); },
+            [&](unsigned i) { return Policy::ArcCos(units[i]); },
+            [&](unsigned i) { return PreciseMath::ArcCos(units[i]); }));
+        benchmarks.push_back(measure({ "Exp", tier, bounds[4] }, FastMathConstants::c_ExpMin, FastMathConstants::c_ExpMax, stride,
+            [](float x) { return errorOf(Policy::Exp(x), std::exp(static_cast<double>(x)), true); },
+            [&](unsigned i) { return Policy::Exp(exponents[i]); },
+            [&](unsigned i) { return PreciseMath::Exp(exponents[i]); }));
+        benchmarks.push_back(measure({ "Log", tier, bounds[5] }, std::numeric_limits<float>::denorm_min(), FLT_MAX, stride,
+            [](float x) { return errorOf(Policy::Log(x), std::log(static_cast<double>(x)), false); },
+            [&](unsigned i) { return Policy::Log(positives[i]); },
+            [&](unsigned i) { return PreciseMath::Log(positives[i]); }));
+        benchmarks.push_back(measure({ "Rsqrt", tier, bounds[6] }, FLT_MIN, FLT_MAX, stride,
+            [](float x) { return errorOf(Policy::Rsqrt(x), 1.0 / std::sqrt(static_cast<double>(x)), true); },
+            [&](unsigned i) { return Policy::Rsqrt(positives[i]); },
+            [&](unsigned i) { return PreciseMath::Rsqrt(positives[i]); }));
+    }
+}
+
+namespace Math
+{
+    std::vector<FastMathBenchmark> FastMathBenchmark::Measure(unsigned stride)
+    {
+        //the bounds TieredMath documents, in the order Sin, Cos, ArcTan2, ArcCos, Exp, Log, Rsqrt
+        const double fastBounds[7] = { 9.5e-8, 9.5e-8, 1.4e-7, 1.5e-7, 8.5e-8, 8.5e-8, 4.8e-6 };
+        const double approximateBounds[7] = { 1.3e-5, 1.3e-5, 1.2e-5, 4.6e-5, 1.3e-4, 1.95e-4, 1.8e-3 };
+        std::vector<FastMathBenchmark> benchmarks;
+        measureTier<FastMath>(benchmarks, stride, fastBounds);
+        measureTier<ApproxMath>(benchmarks, stride, approximateBounds);
+        return benchmarks;
+    }
+}
@@ -0,0 +1,552 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatch.cpp
+/// Backend selection, the scalar backend and the benchmark of Batch.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/MathBatch.h"
+#include "math/MathBatchKernels.h"
+#include "math/MathFunctions.h"
+#include "math/Quaternion.h"
+
+#if MATH_BATCH_X86
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+namespace
+{
+    using namespace Math;
+
+#if MATH_BATCH_X86
+    void cpuid(unsigned leaf, unsigned subleaf, unsigned registers[4])
+    {
+#if defined(_MSC_VER)
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (unsigned i = 0; i < 4; ++i)
+            registers[i] = static_cast<unsigned>(values[i]);
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    //register state the OS saves on a context switch, only valid with OSXSAVE
+    unsigned long long enabledRegisterState()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned low = 0, high = 0;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+    }
+#endif
+
+    BatchBackend detectBackend()
+    {
+#if MATH_BATCH_X86
+        unsigned registers[4];
+        cpuid(0, 0, registers);
+        unsigned maxLeaf = registers[0];
+        cpuid(1, 0, registers);
+        bool sse2 = (registers[3] & (1u << 26)) != 0;
+        bool osxsave = (registers[2] & (1u << 27)) != 0;
+        bool avx = (registers[2] & (1u << 28)) != 0;
+        if (!sse2)
+            return BatchBackend::Scalar;
+        if (!osxsave || !avx || maxLeaf < 7)
+            return BatchBackend::SSE2;
+
+        //the CPU having the instructions is not enough, the OS must save the wider registers
+        unsigned long long state = enabledRegisterState();
+        bool ymmSaved = (state & 0x6) == 0x6;
+        bool zmmSaved = (state & 0xE6) == 0xE6;
+        cpuid(7, 0, registers);
+        bool avx2 = (registers[1] & (1u << 5)) != 0;
+        bool avx512 = (registers[1] & (1u << 16)) != 0;
+        if (avx512 && zmmSaved)
+            return BatchBackend::AVX512;
+        if (avx2 && ymmSaved)
+            return BatchBackend::AVX2;
+        return BatchBackend::SSE2;
+#else
+        return BatchBackend::Scalar;
+#endif
+    }
+
+    BatchKernels const& kernelsOf(BatchBackend backend)
+    {
+        switch (backend)
+        {
+#if MATH_BATCH_X86
+        case BatchBackend::SSE2: return GetBatchKernelsSse2();
+        case BatchBackend::AVX2: return GetBatchKernelsAvx2();
+        case BatchBackend::AVX512: return GetBatchKernelsAvx512();
+#endif
+        default: return GetBatchKernelsScalar();
+        }
+    }
+
+    //the backend is looked up once and then only changed by SetBackend
+    std::atomic<BatchBackend>& currentBackend()
+    {
+        static std::atomic<BatchBackend> backend(Batch::GetBestBackend());
+        return backend;
+    }
+
+    BatchKernels const& kernels()
+    {
+        return kernelsOf(currentBackend().load(std::memory_order_relaxed));
+    }
+
+    //the Precise tier of the FastMath.h functions is libm one element at a time, on every backend
+    void mapPrecise(float (*function)(float), float const* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = function(in[i]);
+    }
+
+    namespace Benchmarking
+    {
+        const unsigned c_Runs = 5;
+
+        //largest |simd - scalar| in ULPs of the largest magnitude in scalar
+        float ulpError(std::vector<float> const& simd, std::vector<float> const& scalar)
+        {
+            float largest = 0.0f;
+            for (float value : scalar)
+                largest = std::max(largest, std::abs(value));
+            float ulp = largest > 0.0f ? std::ldexp(std::numeric_limits<float>::epsilon(), std::ilogb(largest))
+                                       : std::numeric_limits<float>::denorm_min();
+            float error = 0.0f;
+            for (size_t i = 0; i < simd.size(); ++i)
+                error = std::max(error, std::abs(simd[i] - scalar[i]) / ulp);
+            return error;
+        }
+
+        //the median of c_Runs runs of run is timed, then collect flattens its results to compare them,
+        //to exact when it is given, to the scalar backend otherwise
+        template <typename Run, typename Collect>
+        std::vector<Batch::Benchmark> measureKernel(char const* operation, float ulpTolerance, unsigned count, Run run,
+                                                    Collect collect, std::vector<float> const& exact = {})
+        {
+            std::vector<Batch::Benchmark> benchmarks;
+            std::vector<float> reference = exact;
+            for (unsigned backend = 0; backend <= static_cast<unsigned>(Batch::GetBestBackend()); ++backend)
+            {
+                Batch::Benchmark benchmark;
+                benchmark.Operation = operation;
+                benchmark.Backend = static_cast<BatchBackend>(backend);
+                benchmark.UlpTolerance = ulpTolerance;
+                Batch::SetBackend(benchmark.Backend);
+
+                std::vector<float> nanoseconds;
+                for (unsigned i = 0; i < c_Runs; ++i)
+                {
+                    auto start = std::chrono::high_resolution_clock::now();
+                    run();
+                    std::chrono::duration<float, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+                    nanoseconds.push_back(elapsed.count());
+                }
+                std::sort(nanoseconds.begin(), nanoseconds.end());
+                benchmark.ElementsPerNanosecond = count / std::max(nanoseconds[c_Runs / 2], 1.0f);
+
+                std::vector<float> results;
+                collect(results);
+                if (benchmark.Backend == BatchBackend::Scalar && exact.empty())
+                    reference = results;
+                benchmark.MaxUlps = ulpError(results, reference);
+                benchmark.Passed = benchmark.MaxUlps <= ulpTolerance;
+                benchmarks.push_back(benchmark);
+            }
+            return benchmarks;
+        }
+    }
+}
+
+namespace Math
+{
+    BatchKernels const& GetBatchKernelsScalar()
+    {
+        return BatchKernelTable<ScalarLanes>::Get();
+    }
+
+    BatchBackend Batch::GetBackend()
+    {
+        return currentBackend().load(std::memory_order_relaxed);
+    }
+
+    BatchBackend Batch::GetBestBackend()
+    {
+        static const BatchBackend best = detectBackend();
+        return best;
+    }
+
+    void Batch::SetBackend(BatchBackend backend)
+    {
+        currentBackend().store(std::min(backend, GetBestBackend()), std::memory_order_relaxed);
+    }
+
+    char const* Batch::GetBackendName(BatchBackend backend)
+    {
+        switch (backend)
+        {
+        case BatchBackend::SSE2: return "SSE2";
+        case BatchBackend::AVX2: return "AVX2";
+        case BatchBackend::AVX512: return "AVX-512";
+        default: return "Scalar";
+        }
+    }
+
+    unsigned Batch::GetWidth(BatchBackend backend)
+    {
+        switch (backend)
+        {
+        case BatchBackend::SSE2: return 4;
+        case BatchBackend::AVX2: return 8;
+        case BatchBackend::AVX512: return 16;
+        default: return 1;
+        }
+    }
+
+    void Batch::Load(Vector3 const* first, size_t strideBytes, Vector3Span out)
+    {
+        char const* source = reinterpret_cast<char const*>(first);
+        for (size_t i = 0; i < out.count; ++i, source += strideBytes)
+        {
+            Vector3 const& vector = *reinterpret_cast<Vector3 const*>(source);
+            out.x[i] = vector.x;
+            out.y[i] = vector.y;
+            out.z[i] = vector.z;
+        }
+    }
+
+    void Batch::Store(Vector3Span in, Vector3* first, size_t strideBytes)
+    {
+        char* destination = reinterpret_cast<char*>(first);
+        for (size_t i = 0; i < in.count; ++i, destination += strideBytes)
+            *reinterpret_cast<Vector3*>(destination) = Vector3(in.x[i], in.y[i], in.z[i]);
+    }
+
+    void Batch::TransformPoints(Mat4Param matrix, Vector3Span in, Vector3Span out)
+    {
+        kernels().TransformPoints(matrix, in, out);
+    }
+
+    void Batch::TransformNormals(Mat4Param matrix, Vector3Span in, Vector3Span out)
+    {
+        kernels().TransformNormals(matrix, in, out);
+    }
+
+    void Batch::Translate(Vector3Span in, Vec3Param offset, Vector3Span out)
+    {
+        kernels().Translate(in, offset, out);
+    }
+
+    void Batch::Scale(Vector3Span in, float scale, Vector3Span out)
+    {
+        kernels().Scale(in, scale, out);
+    }
+
+    void Batch::Normalize(Vector3Span in, Vector3Span out)
+    {
+        kernels().Normalize(in, out);
+    }
+
+    void Batch::Dot(Vector3Span lhs, Vector3Span rhs, float* out)
+    {
+        kernels().Dot(lhs, rhs, out);
+    }
+
+    Vector3 Batch::Sum(Vector3Span in)
+    {
+        return kernels().Sum(in);
+    }
+
+    void Batch::MinMax(Vector3Span in, Vector3& minimum, Vector3& maximum)
+    {
+        kernels().MinMax(in, minimum, maximum);
+    }
+
+    float Batch::MaxLengthSq(Vector3Span in)
+    {
+        return kernels().MaxLengthSq(in);
+    }
+
+    void Batch::TransformSpheres(Matrix4 const* transforms, SphereSpan in, SphereSpan out)
+    {
+        kernels().TransformSpheres(transforms, in, out);
+    }
+
+    size_t Batch::TestSpheres(Vector4 const* planes, unsigned planeCount, SphereSpan spheres, unsigned char* inside)
+    {
+        return kernels().TestSpheres(planes, planeCount, spheres, inside);
+    }
+
+    bool Batch::IntersectTriangles(Vec3Param start, Vec3Param direction, TriangleSpan triangles, TriangleHit& hit)
+    {
+        return kernels().IntersectTriangles(start, direction, triangles, hit);
+    }
+
+    float Batch::IntersectBox(Vec3Param minimum, Vec3Param maximum, RaySpan rays, float* entries)
+    {
+        return kernels().IntersectBox(minimum, maximum, rays, entries);
+    }
+
+    void Batch::Sin(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::Sin, in, out, count);
+        else
+            kernels().Sin(tier, in, out, count);
+    }
+
+    void Batch::Cos(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::Cos, in, out, count);
+        else
+            kernels().Cos(tier, in, out, count);
+    }
+
+    void Batch::ArcTan2(MathTier tier, float const* y, float const* x, float* out, size_t count)
+    {
+        if (tier != MathTier::Precise)
+            return kernels().ArcTan2(tier, y, x, out, count);
+        for (size_t i = 0; i < count; ++i)
+            out[i] = PreciseMath::ArcTan2(y[i], x[i]);
+    }
+
+    void Batch::ArcCos(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::ArcCos, in, out, count);
+        else
+            kernels().ArcCos(tier, in, out, count);
+    }
+
+    void Batch::Exp(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::Exp, in, out, count);
+        else
+            kernels().Exp(tier, in, out, count);
+    }
+
+    void Batch::Log(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::Log, in, out, count);
+        else
+            kernels().Log(tier, in, out, count);
+    }
+
+    void Batch::Rsqrt(MathTier tier, float const* in, float* out, size_t count)
+    {
+        if (tier == MathTier::Precise)
+            mapPrecise(&PreciseMath::Rsqrt, in, out, count);
+        else
+            kernels().Rsqrt(tier, in, out, count);
+    }
+
+    std::vector<Batch::Benchmark> Batch::Measure(unsigned count, unsigned seed)
+    {
+        using namespace Benchmarking;
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        //an odd count, so every backend runs its scalar tail too
+        count |= 1;
+        Vector3Array points(count), directions(count), results(count);
+        SphereArray spheres(count), transformed(count);
+        std::vector<Matrix4> transforms(count);
+        std::vector<float> dots(count);
+        std::vector<unsigned char> inside(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            points.Set(i, Vector3(position(random), position(random), position(random)));
+            directions.Set(i, Vector3(unit(random), unit(random), unit(random)));
+            spheres.x[i] = points.x[i];
+            spheres.y[i] = points.y[i];
+            spheres.z[i] = points.z[i];
+            spheres.radius[i] = scale(random);
+            Quaternion rotation = Quaternion(unit(random), unit(random), unit(random), unit(random)).Normalized();
+            transforms[i] = BuildTransform(Vector3(position(random), position(random), position(random)), rotation,
+                                           Vector3(scale(random), scale(random), scale(random)));
+        }
+        Matrix4 transform = transforms[0];
+        //a box of planes cutting through the points, about a third of the spheres end up inside
+        Vector4 planes[6] = { Vector4(1, 0, 0, 7), Vector4(-1, 0, 0, 7), Vector4(0, 1, 0, 7),
+                              Vector4(0, -1, 0, 7), Vector4(0, 0, 1, 7), Vector4(0, 0, -1, 7) };
+
+        auto flatten = [&](std::vector<float>& out)
+        {
+            out.assign(results.x.begin(), results.x.end());
+            out.insert(out.end(), results.y.begin(), results.y.end());
+            out.insert(out.end(), results.z.begin(), results.z.end());
+        };
+        Vector3 sum, minimum, maximum;
+        float maxLengthSq = 0.0f;
+        size_t insideCount = 0;
+
+        BatchBackend backend = GetBackend();
+        std::vector<Benchmark> benchmarks;
+        auto add = [&](std::vector<Benchmark> const& kernel) { benchmarks.insert(benchmarks.end(), kernel.begin(), kernel.end()); };
+        add(measureKernel("transform points", 0.0f, count,
+            [&]() { TransformPoints(transform, points.GetSpan(), results.GetSpan()); }, flatten));
+        add(measureKernel("transform normals", 0.0f, count,
+            [&]() { TransformNormals(transform, directions.GetSpan(), results.GetSpan()); }, flatten));
+        add(measureKernel("translate", 0.0f, count,
+            [&]() { Translate(points.GetSpan(), Vector3(1.0f, -2.0f, 3.0f), results.GetSpan()); }, flatten));
+        add(measureKernel("scale", 0.0f, count,
+            [&]() { Scale(points.GetSpan(), 0.37f, results.GetSpan()); }, flatten));
+        add(measureKernel("normalize", 0.0f, count,
+            [&]() { Normalize(directions.GetSpan(), results.GetSpan()); }, flatten));
+        add(measureKernel("dot", 0.0f, count,
+            [&]() { Dot(points.GetSpan(), directions.GetSpan(), dots.data()); },
+            [&](std::vector<float>& out) { out = dots; }));
+        //the backends sum in different orders, so they are all checked against a double precision sum;
+        //the scalar loop is itself ~190 ULPs off it over 64k elements
+        double exactSum[3] = { 0.0, 0.0, 0.0 };
+        for (unsigned i = 0; i < count; ++i)
+        {
+            exactSum[0] += points.x[i];
+            exactSum[1] += points.y[i];
+            exactSum[2] += points.z[i];
+        }
+        add(measureKernel("sum", 512.0f, count,
+            [&]() { sum = Sum(points.GetSpan()); },
+            [&](std::vector<float>& out) { out.assign(sum.ToFloats(), sum.ToFloats() + 3); },
+            { float(exactSum[0]), float(exactSum[1]), float(exactSum[2]) }));
+        add(measureKernel("min/max", 0.0f, count,
+            [&]() { MinMax(points.GetSpan(), minimum, maximum); },
+            [&](std::vector<float>& out)
+            {
+                out.assign(minimum.ToFloats(), minimum.ToFloats() + 3);
+                out.insert(out.end(), maximum.ToFloats(), maximum.ToFloats() + 3);
+            }));
+        add(measureKernel("max length squared", 0.0f, count,
+            [&]() { maxLengthSq = MaxLengthSq(points.GetSpan()); },
+            [&](std::vector<float>& out) { out.assign(1, maxLengthSq); }));
+        add(measureKernel("transform spheres", 0.0f, count,
+            [&]() { TransformSpheres(transforms.data(), spheres.GetSpan(), transformed.GetSpan()); },
+            [&](std::vector<float>& out)
+            {
+                out.assign(transformed.x.begin(), transformed.x.end());
+                out.insert(out.end(), transformed.y.begin(), transformed.y.end());
+                out.insert(out.end(), transformed.z.begin(), transformed.z.end());
+                out.insert(out.end(), transformed.radius.begin(), transformed.radius.end());
+            }));
+        add(measureKernel("test spheres", 0.0f, count,
+            [&]() { insideCount = TestSpheres(planes, 6, spheres.GetSpan(), inside.data()); },
+            [&](std::vector<float>& out)
+            {
+                out.assign(inside.begin(), inside.end());
+                out.push_back(static_cast<float>(insideCount));
+            }));
+
+        //triangles at the points with the directions as one edge and the directions turned around as the other,
+        //rays from outside the points through the middle, every one of them against every triangle
+        TriangleSpan triangles;
+        triangles.x = points.x.data();
+        triangles.y = points.y.data();
+        triangles.z = points.z.data();
+        triangles.edge1X = directions.x.data();
+        triangles.edge1Y = directions.y.data();
+        triangles.edge1Z = directions.z.data();
+        triangles.edge2X = directions.y.data();
+        triangles.edge2Y = directions.z.data();
+        triangles.edge2Z = directions.x.data();
+        triangles.count = count;
+        const unsigned rayCount = 16;
+        std::vector<Vector3> rayStarts(rayCount), rayDirections(rayCount);
+        std::vector<TriangleHit> hits(rayCount);
+        for (unsigned r = 0; r < rayCount; ++r)
+        {
+            rayStarts[r] = Vector3(unit(random), unit(random), unit(random)).Normalized() * 40.0f;
+            rayDirections[r] = (Vector3(unit(random), unit(random), unit(random)) - rayStarts[r]).Normalized();
+        }
+        add(measureKernel("intersect triangles", 0.0f, count * rayCount,
+            [&]()
+            {
+                for (unsigned r = 0; r < rayCount; ++r)
+                {
+                    hits[r] = TriangleHit();
+                    IntersectTriangles(rayStarts[r], rayDirections[r], triangles, hits[r]);
+                }
+            },
+            [&](std::vector<float>& out)
+            {
+                out.clear();
+                for (TriangleHit const& hit : hits)
+                {
+                    out.push_back(static_cast<float>(hit.index));
+                    out.push_back(hit.distance);
+                    out.push_back(hit.u);
+                    out.push_back(hit.v);
+                }
+            }));
+
+        //rays from the points along the directions against a box in the middle, some of them starting inside it
+        RayArray rays(count);
+        for (unsigned i = 0; i < count; ++i)
+            rays.Set(i, points.Get(i), directions.Get(i), i % 4 ? FLT_MAX : 3.0f);
+        std::vector<float> entries(count);
+        float nearestEntry = FLT_MAX;
+        add(measureKernel("intersect box", 0.0f, count,
+            [&]() { nearestEntry = IntersectBox(Vector3(-4.0f, -3.0f, -2.0f), Vector3(2.0f, 3.0f, 4.0f), rays.GetSpan(), entries.data()); },
+            [&](std::vector<float>& out)
+            {
+                out = entries;
+                out.push_back(nearestEntry);
+            }));
+
+        //the fast math kernels over their domains, checked against FastMath and ApproxMath themselves
+        std::uniform_real_distribution<float> angle(-100.0f, 100.0f), cosine(-1.1f, 1.1f), exponent(-100.0f, 100.0f);
+        std::vector<float> angles(count), tangents(count), cosines(count), exponents(count), positives(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            angles[i] = angle(random);
+            tangents[i] = position(random);
+            cosines[i] = cosine(random);
+            exponents[i] = exponent(random);
+            //normal floats, denormals take microcode assists that would dominate the timing
+            positives[i] = std::exp(0.8f * exponent(random));
+        }
+        std::vector<float> values(count), exact(count);
+        auto collectValues = [&](std::vector<float>& out) { out = values; };
+        auto measureTiers = [&](char const* fastName, char const* approximateName, std::vector<float> const& in,
+                                void (*function)(MathTier, float const*, float*, size_t), float (*fast)(float),
+                                float (*approximate)(float))
+        {
+            std::transform(in.begin(), in.end(), exact.begin(), fast);
+            add(measureKernel(fastName, 0.0f, count,
+                [&]() { function(MathTier::Fast, in.data(), values.data(), count); }, collectValues, exact));
+            std::transform(in.begin(), in.end(), exact.begin(), approximate);
+            add(measureKernel(approximateName, 0.0f, count,
+                [&]() { function(MathTier::Approximate, in.data(), values.data(), count); }, collectValues, exact));
+        };
+        measureTiers("fast sin", "approximate sin", angles, &Sin, &FastMath::Sin, &ApproxMath::Sin);
+        measureTiers("fast cos", "approximate cos", angles, &Cos, &FastMath::Cos, &ApproxMath::Cos);
+        std::transform(points.y.begin(), points.y.end(), tangents.begin(), exact.begin(), &FastMath::ArcTan2);
+        add(measureKernel("fast atan2", 0.0f, count,
+            [&]() { ArcTan2(MathTier::Fast, points.y.data(), tangents.data(), values.data(), count); }, collectValues, exact));
+        std::transform(points.y.begin(), points.y.end(), tangents.begin(), exact.begin(), &ApproxMath::ArcTan2);
+        add(measureKernel("approximate atan2", 0.0f, count,
+            [&]() { ArcTan2(MathTier::Approximate, points.y.data(), tangents.data(), values.data(), count); }, collectValues, exact));
+        measureTiers("fast acos", "approximate acos", cosines, &ArcCos, &FastMath::ArcCos, &ApproxMath::ArcCos);
+        measureTiers("fast exp", "approximate exp", exponents, &Exp, &FastMath::Exp, &ApproxMath::Exp);
+        measureTiers("fast log", "approximate log", positives, &Log, &FastMath::Log, &ApproxMath::Log);
+        measureTiers("fast rsqrt", "approximate rsqrt", positives, &Rsqrt, &FastMath::Rsqrt, &ApproxMath::Rsqrt);
+        SetBackend(backend);
+        return benchmarks;
+    }
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatchAvx2.cpp
+/// The 8 wide AVX2 backend of Batch.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/MathBatch.h"
+
+#if MATH_BATCH_X86
+//MSVC emits any intrinsic, GCC and Clang only in functions built for its instruction set. Their
+//multiplies and adds must not be fused, or the results would differ from the scalar kernels.
+#if defined(__clang__)
+  #pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+  #pragma clang fp contract(off)
+#elif defined(__GNUC__)
+  #pragma GCC target("avx2")
+  #pragma GCC optimize("fp-contract=off")
+#endif
+
+#include <immintrin.h>
+#include "math/MathBatchKernels.h"
+
+namespace Math
+{
+    namespace
+    {
+        struct Avx2Lanes
+        {
+            typedef __m256 Float;
+            typedef __m256i Int;
+            typedef __m256 Mask;
+            static const unsigned Width = 8;
+
+            static Float Load(float const* source) { return _mm256_loadu_ps(source); }
+            static void Store(float* destination, Float value) { _mm256_storeu_ps(destination, value); }
+            static Float Set(float value) { return _mm256_set1_ps(value); }
+            static Float Add(Float lhs, Float rhs) { return _mm256_add_ps(lhs, rhs); }
+            static Float Sub(Float lhs, Float rhs) { return _mm256_sub_ps(lhs, rhs); }
+            static Float Mul(Float lhs, Float rhs) { return _mm256_mul_ps(lhs, rhs); }
+            static Float Div(Float lhs, Float rhs) { return _mm256_div_ps(lhs, rhs); }
+            static Float Min(Float lhs, Float rhs) { return _mm256_min_ps(lhs, rhs); }
+            static Float Max(Float lhs, Float rhs) { return _mm256_max_ps(lhs, rhs); }
+            static Float Sqrt(Float value) { return _mm256_sqrt_ps(value); }
+            static Mask Less(Float lhs, Float rhs) { return _mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ); }
+            static Mask LessEqual(Float lhs, Float rhs) { return _mm256_cmp_ps(lhs, rhs, _CMP_LE_OQ); }
+            static Mask Equal(Float lhs, Float rhs) { return _mm256_cmp_ps(lhs, rhs, _CMP_EQ_OQ); }
+            static Mask And(Mask lhs, Mask rhs) { return _mm256_and_ps(lhs, rhs); }
+            static Mask Or(Mask lhs, Mask rhs) { return _mm256_or_ps(lhs, rhs); }
+            static Mask NoLanes() { return _mm256_setzero_ps(); }
+            static unsigned Bits(Mask mask) { return static_cast<unsigned>(_mm256_movemask_ps(mask)); }
+            static Float Select(Mask mask, Float ifTrue, Float ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, mask); }
+
+            static Int AsInt(Float value) { return _mm256_castps_si256(value); }
+            static Float AsFloat(Int bits) { return _mm256_castsi256_ps(bits); }
+            static Int IntSet(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+            static Int IntAdd(Int lhs, Int rhs) { return _mm256_add_epi32(lhs, rhs); }
+            static Int IntSub(Int lhs, Int rhs) { return _mm256_sub_epi32(lhs, rhs); }
+            static Int IntAnd(Int lhs, Int rhs) { return _mm256_and_si256(lhs, rhs); }
+            static Int IntXor(Int lhs, Int rhs) { return _mm256_xor_si256(lhs, rhs); }
+            static Mask IntEqual(Int lhs, Int rhs) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(lhs, rhs)); }
+            static Int ShiftLeft(Int value, int count) { return _mm256_slli_epi32(value, count); }
+            static Int ShiftRight(Int value, int count) { return _mm256_srai_epi32(value, count); }
+            static Float IntToFloat(Int value) { return _mm256_cvtepi32_ps(value); }
+
+            static void LoadRows(Matrix4 const* transforms, Float rows[3][4])
+            {
+                for (unsigned r = 0; r < 3; ++r)
+                {
+                    //transforms 0-3 in the low half, 4-7 in the high half, then a 4x4 transpose in each half
+                    __m256 row0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(transforms[0].m[r])), _mm_loadu_ps(transforms[4].m[r]), 1);
+                    __m256 row1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(transforms[1].m[r])), _mm_loadu_ps(transforms[5].m[r]), 1);
+                    __m256 row2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(transforms[2].m[r])), _mm_loadu_ps(transforms[6].m[r]), 1);
+                    __m256 row3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(transforms[3].m[r])), _mm_loadu_ps(transforms[7].m[r]), 1);
+                    __m256 low01 = _mm256_unpacklo_ps(row0, row1);
+                    __m256 low23 = _mm256_unpacklo_ps(row2, row3);
+                    __m256 high01 = _mm256_unpackhi_ps(row0, row1);
+                    __m256 high23 = _mm256_unpackhi_ps(row2, row3);
+                    rows[r][0] = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(1, 0, 1, 0));
+                    rows[r][1] = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(3, 2, 3, 2));
+                    rows[r][2] = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(1, 0, 1, 0));
+                    rows[r][3] = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(3, 2, 3, 2));
+                }
+            }
+        };
+    }
+
+    BatchKernels const& GetBatchKernelsAvx2()
+    {
+        return BatchKernelTable<Avx2Lanes>::Get();
+    }
+}
+
+#if defined(__clang__)
+  #pragma clang attribute pop
+#endif
+#endif
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatchAvx512.cpp
+/// The 16 wide AVX-512 (AVX-512F) backend of Batch.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/MathBatch.h"
+
+#if MATH_BATCH_X86
+//MSVC emits any intrinsic, GCC and Clang only in functions built for its instruction set. Their
+//multiplies and adds must not be fused, or the results would differ from the scalar kernels.
+#if defined(__clang__)
+  #pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+  #pragma clang fp contract(off)
+#elif defined(__GNUC__)
+  #pragma GCC target("avx512f")
+  #pragma GCC optimize("fp-contract=off")
+#endif
+
+#include <immintrin.h>
+#include "math/MathBatchKernels.h"
+
+namespace Math
+{
+    namespace
+    {
+        struct Avx512Lanes
+        {
+            typedef __m512 Float;
+            typedef __m512i Int;
+            typedef __mmask16 Mask;
+            static const unsigned Width = 16;
+
+            static Float Load(float const* source) { return _mm512_loadu_ps(source); }
+            static void Store(float* destination, Float value) { _mm512_storeu_ps(destination, value); }
+            static Float Set(float value) { return _mm512_set1_ps(value); }
+            static Float Add(Float lhs, Float rhs) { return _mm512_add_ps(lhs, rhs); }
+            static Float Sub(Float lhs, Float rhs) { return _mm512_sub_ps(lhs, rhs); }
+            static Float Mul(Float lhs, Float rhs) { return _mm512_mul_ps(lhs, rhs); }
+            static Float Div(Float lhs, Float rhs) { return _mm512_div_ps(lhs, rhs); }
+            static Float Min(Float lhs, Float rhs) { return _mm512_min_ps(lhs, rhs); }
+            static Float Max(Float lhs, Float rhs) { return _mm512_max_ps(lhs, rhs); }
+            static Float Sqrt(Float value) { return _mm512_sqrt_ps(value); }
+            static Mask Less(Float lhs, Float rhs) { return _mm512_cmp_ps_mask(lhs, rhs, _CMP_LT_OQ); }
+            static Mask LessEqual(Float lhs, Float rhs) { return _mm512_cmp_ps_mask(lhs, rhs, _CMP_LE_OQ); }
+            static Mask Equal(Float lhs, Float rhs) { return _mm512_cmp_ps_mask(lhs, rhs, _CMP_EQ_OQ); }
+            static Mask And(Mask lhs, Mask rhs) { return static_cast<Mask>(lhs & rhs); }
+            static Mask Or(Mask lhs, Mask rhs) { return static_cast<Mask>(lhs | rhs); }
+            static Mask NoLanes() { return 0; }
+            static unsigned Bits(Mask mask) { return mask; }
+            static Float Select(Mask mask, Float ifTrue, Float ifFalse) { return _mm512_mask_blend_ps(mask, ifFalse, ifTrue); }
+
+            static Int AsInt(Float value) { return _mm512_castps_si512(value); }
+            static Float AsFloat(Int bits) { return _mm512_castsi512_ps(bits); }
+            static Int IntSet(uint32_t value) { return _mm512_set1_epi32(static_cast<int>(value)); }
+            static Int IntAdd(Int lhs, Int rhs) { return _mm512_add_epi32(lhs, rhs); }
+            static Int IntSub(Int lhs, Int rhs) { return _mm512_sub_epi32(lhs, rhs); }
+            static Int IntAnd(Int lhs, Int rhs) { return _mm512_and_si512(lhs, rhs); }
+            static Int IntXor(Int lhs, Int rhs) { return _mm512_xor_si512(lhs, rhs); }
+            static Mask IntEqual(Int lhs, Int rhs) { return _mm512_cmpeq_epi32_mask(lhs, rhs); }
+            static Int ShiftLeft(Int value, int count) { return _mm512_slli_epi32(value, static_cast<unsigned>(count)); }
+            static Int ShiftRight(Int value, int count) { return _mm512_srai_epi32(value, static_cast<unsigned>(count)); }
+            static Float IntToFloat(Int value) { return _mm512_cvtepi32_ps(value); }
+
+            //row r of transforms[first], [first + 4], [first + 8] and [first + 12], one per 128 bit lane
+            static __m512 loadRow(Matrix4 const* transforms, unsigned first, unsigned r)
+            {
+                __m512 row = _mm512_castps128_ps512(_mm_loadu_ps(transforms[first].m[r]));
+                row = _mm512_insertf32x4(row, _mm_loadu_ps(transforms[first + 4].m[r]), 1);
+                row = _mm512_insertf32x4(row, _mm_loadu_ps(transforms[first + 8].m[r]), 2);
+                return _mm512_insertf32x4(row, _mm_loadu_ps(transforms[first + 12].m[r]), 3);
+            }
+
+            static void LoadRows(Matrix4 const* transforms, Float rows[3][4])
+            {
+                for (unsigned r = 0; r < 3; ++r)
+                {
+                    //a 4x4 transpose in each 128 bit lane
+                    __m512 row0 = loadRow(transforms, 0, r);
+                    __m512 row1 = loadRow(transforms, 1, r);
+                    __m512 row2 = loadRow(transforms, 2, r);
+                    __m512 row3 = loadRow(transforms, 3, r);
+                    __m512 low01 = _mm512_unpacklo_ps(row0, row1);
+                    __m512 low23 = _mm512_unpacklo_ps(row2, row3);
+                    __m512 high01 = _mm512_unpackhi_ps(row0, row1);
+                    __m512 high23 = _mm512_unpackhi_ps(row2, row3);
+                    rows[r][0] = _mm512_shuffle_ps(low01, low23, _MM_SHUFFLE(1, 0, 1, 0));
+                    rows[r][1] = _mm512_shuffle_ps(low01, low23, _MM_SHUFFLE(3, 2, 3, 2));
+                    rows[r][2] = _mm512_shuffle_ps(high01, high23, _MM_SHUFFLE(1, 0, 1, 0));
+                    rows[r][3] = _mm512_shuffle_ps(high01, high23, _MM_SHUFFLE(3, 2, 3, 2));
+                }
+            }
+        };
+    }
+
+    BatchKernels const& GetBatchKernelsAvx512()
+    {
+        return BatchKernelTable<Avx512Lanes>::Get();
+    }
+}
+
+#if defined(__clang__)
+  #pragma clang attribute pop
+#endif
+#endif
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathBatchSse2.cpp
+/// The 4 wide SSE2 backend of Batch.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/MathBatch.h"
+
+#if MATH_BATCH_X86
+//MSVC emits any intrinsic, GCC and Clang only in functions built for its instruction set. Their
+//multiplies and adds must not be fused, or the results would differ from the scalar kernels.
+#if defined(__clang__)
+  #pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+  #pragma clang fp contract(off)
+#elif defined(__GNUC__)
+  #pragma GCC target("sse2")
+  #pragma GCC optimize("fp-contract=off")
+#endif
+
+#include <emmintrin.h>
+#include "math/MathBatchKernels.h"
+
+namespace Math
+{
+    namespace
+    {
+        struct Sse2Lanes
+        {
+            typedef __m128 Float;
+            typedef __m128i Int;
+            typedef __m128 Mask;
+            static const unsigned Width = 4;
+
+            static Float Load(float const* source) { return _mm_loadu_ps(source); }
+            static void Store(float* destination, Float value) { _mm_storeu_ps(destination, value); }
+            static Float Set(float value) { return _mm_set1_ps(value); }
+            static Float Add(Float lhs, Float rhs) { return _mm_add_ps(lhs, rhs); }
+            static Float Sub(Float lhs, Float rhs) { return _mm_sub_ps(lhs, rhs); }
+            static Float Mul(Float lhs, Float rhs) { return _mm_mul_ps(lhs, rhs); }
+            static Float Div(Float lhs, Float rhs) { return _mm_div_ps(lhs, rhs); }
+            static Float Min(Float lhs, Float rhs) { return _mm_min_ps(lhs, rhs); }
+            static Float Max(Float lhs, Float rhs) { return _mm_max_ps(lhs, rhs); }
+            static Float Sqrt(Float value) { return _mm_sqrt_ps(value); }
+            static Mask Less(Float lhs, Float rhs) { return _mm_cmplt_ps(lhs, rhs); }
+            static Mask LessEqual(Float lhs, Float rhs) { return _mm_cmple_ps(lhs, rhs); }
+            static Mask Equal(Float lhs, Float rhs) { return _mm_cmpeq_ps(lhs, rhs); }
+            static Mask And(Mask lhs, Mask rhs) { return _mm_and_ps(lhs, rhs); }
+            static Mask Or(Mask lhs, Mask rhs) { return _mm_or_ps(lhs, rhs); }
+            static Mask NoLanes() { return _mm_setzero_ps(); }
+            static unsigned Bits(Mask mask) { return static_cast<unsigned>(_mm_movemask_ps(mask)); }
+            static Float Select(Mask mask, Float ifTrue, Float ifFalse)
+            {
+                return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+            }
+
+            static Int AsInt(Float value) { return _mm_castps_si128(value); }
+            static Float AsFloat(Int bits) { return _mm_castsi128_ps(bits); }
+            static Int IntSet(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+            static Int IntAdd(Int lhs, Int rhs) { return _mm_add_epi32(lhs, rhs); }
+            static Int IntSub(Int lhs, Int rhs) { return _mm_sub_epi32(lhs, rhs); }
+            static Int IntAnd(Int lhs, Int rhs) { return _mm_and_si128(lhs, rhs); }
+            static Int IntXor(Int lhs, Int rhs) { return _mm_xor_si128(lhs, rhs); }
+            static Mask IntEqual(Int lhs, Int rhs) { return _mm_castsi128_ps(_mm_cmpeq_epi32(lhs, rhs)); }
+            static Int ShiftLeft(Int value, int count) { return _mm_slli_epi32(value, count); }
+            static Int ShiftRight(Int value, int count) { return _mm_srai_epi32(value, count); }
+            static Float IntToFloat(Int value) { return _mm_cvtepi32_ps(value); }
+
+            static void LoadRows(Matrix4 const* transforms, Float rows[3][4])
+            {
+                for (unsigned r = 0; r < 3; ++r)
+                {
+                    __m128 row0 = _mm_loadu_ps(transforms[0].m[r]);
+                    __m128 row1 = _mm_loadu_ps(transforms[1].m[r]);
+                    __m128 row2 = _mm_loadu_ps(transforms[2].m[r]);
+                    __m128 row3 = _mm_loadu_ps(transforms[3].m[r]);
+                    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+                    rows[r][0] = row0;
+                    rows[r][1] = row1;
+                    rows[r][2] = row2;
+                    rows[r][3] = row3;
+                }
+            }
+        };
+    }
+
+    BatchKernels const& GetBatchKernelsSse2()
+    {
+        return BatchKernelTable<Sse2Lanes>::Get();
+    }
+}
+
+#if defined(__clang__)
+  #pragma clang attribute pop
+#endif
+#endif
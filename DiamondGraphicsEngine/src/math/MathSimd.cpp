@@ -0,0 +1,859 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+/// \file MathSimd.cpp
+/// Implementation of the SIMD kernels behind Vector4, Matrix4 and Quaternion.
+///
+///////////////////////////////////////////////////////////////////////////////
+#include "Precompiled.h"
+#include "math/MathSimd.h"
+#include "math/MathFunctions.h"
+
+namespace
+{
+    using namespace Math;
+
+#if MATH_SIMD_SSE2
+    inline __m128 splat(__m128 value, int lane)
+    {
+        switch (lane)
+        {
+        case 0: return _mm_shuffle_ps(value, value, MATH_SHUFFLE(0, 0, 0, 0));
+        case 1: return _mm_shuffle_ps(value, value, MATH_SHUFFLE(1, 1, 1, 1));
+        case 2: return _mm_shuffle_ps(value, value, MATH_SHUFFLE(2, 2, 2, 2));
+        default: return _mm_shuffle_ps(value, value, MATH_SHUFFLE(3, 3, 3, 3));
+        }
+    }
+
+    const int c_SignBit = std::numeric_limits<int>::min();
+
+    inline __m128 signs(bool x, bool y, bool z, bool w)
+    {
+        return _mm_castsi128_ps(_mm_setr_epi32(x ? c_SignBit : 0, y ? c_SignBit : 0, z ? c_SignBit : 0, w ? c_SignBit : 0));
+    }
+
+    //a 2x2 matrix in one register is (m00, m01, m10, m11)
+    inline __m128 mat2Mul(__m128 lhs, __m128 rhs)
+    {
+        return _mm_add_ps(_mm_mul_ps(lhs, _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(0, 3, 0, 3))),
+                          _mm_mul_ps(_mm_shuffle_ps(lhs, lhs, MATH_SHUFFLE(1, 0, 3, 2)),
+                                     _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(2, 1, 2, 1))));
+    }
+
+    //adjugate(lhs) * rhs
+    inline __m128 mat2AdjMul(__m128 lhs, __m128 rhs)
+    {
+        return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(lhs, lhs, MATH_SHUFFLE(3, 3, 0, 0)), rhs),
+                          _mm_mul_ps(_mm_shuffle_ps(lhs, lhs, MATH_SHUFFLE(1, 1, 2, 2)),
+                                     _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(2, 3, 0, 1))));
+    }
+
+    //lhs * adjugate(rhs)
+    inline __m128 mat2MulAdj(__m128 lhs, __m128 rhs)
+    {
+        return _mm_sub_ps(_mm_mul_ps(lhs, _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(3, 0, 3, 0))),
+                          _mm_mul_ps(_mm_shuffle_ps(lhs, lhs, MATH_SHUFFLE(1, 0, 3, 2)),
+                                     _mm_shuffle_ps(rhs, rhs, MATH_SHUFFLE(2, 1, 2, 1))));
+    }
+#endif
+
+    //v + w * t + q x t with t = 2 * (q x v), what the scalar backend rotates with
+    Vector3 rotated(QuatParam quat, Vec3Param vector)
+    {
+        Vector3 axis(quat.x, quat.y, quat.z);
+        Vector3 t = Cross(axis, vector) * 2.0f;
+        return vector + t * quat.w + Cross(axis, t);
+    }
+
+    void slerpWeights(float cosTheta, float tValue, float& startVal, float& endVal)
+    {
+        //Quaternion Interpolation With Extra Spins, Graphics Gems III, as in Math::Slerp
+        const float cSlerpEpsilon = 0.00001f;
+        bool flip = cosTheta < 0.0f;
+        if (flip)
+            cosTheta = -cosTheta;
+
+        if ((1.0f - cosTheta) > cSlerpEpsilon)
+        {
+            float theta = Math::ArcCos(cosTheta);
+            float sinTheta = Math::Sin(theta);
+            startVal = Math::Sin((1.0f - tValue) * theta) / sinTheta;
+            endVal = Math::Sin(tValue * theta) / sinTheta;
+        }
+        else
+        {
+            startVal = 1.0f - tValue;
+            endVal = tValue;
+        }
+
+        if (flip)
+            endVal = -endVal;
+    }
+}
+
+namespace Math
+{
+    char const* Simd::GetBackendName()
+    {
+#if MATH_SIMD_AVX2
+        return "AVX2";
+#elif MATH_SIMD_SSE41
+        return "SSE4.1";
+#elif MATH_SIMD_SSE2
+        return "SSE2";
+#else
+        return "Scalar";
+#endif
+    }
+
+    Matrix4 Simd::Concat(Mat4Param lhs, Mat4Param rhs)
+    {
+#if MATH_SIMD_AVX2
+        //two rows of the result at a time, every rhs row in both halves
+        Matrix4 ret;
+        __m256 rhs0 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(rhs.m[0]));
+        __m256 rhs1 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(rhs.m[1]));
+        __m256 rhs2 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(rhs.m[2]));
+        __m256 rhs3 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(rhs.m[3]));
+        for (int r = 0; r < 4; r += 2)
+        {
+            __m256 rows = _mm256_loadu_ps(lhs.m[r]);
+            __m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), rhs0);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x55), rhs1));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xAA), rhs2));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xFF), rhs3));
+            _mm256_storeu_ps(ret.m[r], sum);
+        }
+        return ret;
+#elif MATH_SIMD_SSE2
+        //a row of the result is the rhs rows scaled by a lhs row, summed in the order of the scalar loop
+        Matrix4 ret;
+        __m128 rhs0 = _mm_loadu_ps(rhs.m[0]);
+        __m128 rhs1 = _mm_loadu_ps(rhs.m[1]);
+        __m128 rhs2 = _mm_loadu_ps(rhs.m[2]);
+        __m128 rhs3 = _mm_loadu_ps(rhs.m[3]);
+        for (int r = 0; r < 4; ++r)
+        {
+            __m128 row = _mm_loadu_ps(lhs.m[r]);
+            __m128 sum = _mm_mul_ps(splat(row, 0), rhs0);
+            sum = _mm_add_ps(sum, _mm_mul_ps(splat(row, 1), rhs1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(splat(row, 2), rhs2));
+            sum = _mm_add_ps(sum, _mm_mul_ps(splat(row, 3), rhs3));
+            _mm_storeu_ps(ret.m[r], sum);
+        }
+        return ret;
+#else
+        return Scalar::Concat(lhs, rhs);
+#endif
+    }
+
+    Matrix4 Simd::Transposed(Mat4Param matrix)
+    {
+#if MATH_SIMD_SSE2
+        __m128 row0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 row1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 row2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 row3 = _mm_loadu_ps(matrix.m[3]);
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+        Matrix4 ret;
+        _mm_storeu_ps(ret.m[0], row0);
+        _mm_storeu_ps(ret.m[1], row1);
+        _mm_storeu_ps(ret.m[2], row2);
+        _mm_storeu_ps(ret.m[3], row3);
+        return ret;
+#else
+        return Scalar::Transposed(matrix);
+#endif
+    }
+
+    Matrix4 Simd::Inverted(Mat4Param matrix)
+    {
+#if MATH_SIMD_SSE2
+        //block inverse on the four 2x2 sub matrices | A B |
+        //                                           | C D |
+        __m128 row0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 row1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 row2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 row3 = _mm_loadu_ps(matrix.m[3]);
+        __m128 a = _mm_movelh_ps(row0, row1);
+        __m128 b = _mm_movehl_ps(row1, row0);
+        __m128 c = _mm_movelh_ps(row2, row3);
+        __m128 d = _mm_movehl_ps(row3, row2);
+
+        //(|A|, |B|, |C|, |D|)
+        __m128 determinants = _mm_sub_ps(
+            _mm_mul_ps(_mm_shuffle_ps(row0, row2, MATH_SHUFFLE(0, 2, 0, 2)), _mm_shuffle_ps(row1, row3, MATH_SHUFFLE(1, 3, 1, 3))),
+            _mm_mul_ps(_mm_shuffle_ps(row0, row2, MATH_SHUFFLE(1, 3, 1, 3)), _mm_shuffle_ps(row1, row3, MATH_SHUFFLE(0, 2, 0, 2))));
+        __m128 detA = splat(determinants, 0);
+        __m128 detB = splat(determinants, 1);
+        __m128 detC = splat(determinants, 2);
+        __m128 detD = splat(determinants, 3);
+
+        __m128 adjDC = mat2AdjMul(d, c);
+        __m128 adjAB = mat2AdjMul(a, b);
+        //adjugates of the blocks of the inverse, times |M|
+        __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, adjDC));
+        __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, adjAB));
+        __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, adjAB));
+        __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, adjDC));
+
+        //|M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+        __m128 trace = _mm_mul_ps(adjAB, _mm_shuffle_ps(adjDC, adjDC, MATH_SHUFFLE(0, 2, 1, 3)));
+        trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, MATH_SHUFFLE(2, 3, 0, 1)));
+        trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, MATH_SHUFFLE(1, 0, 3, 2)));
+        __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+        //the sign flips undo the adjugates
+        __m128 scale = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+        x = _mm_mul_ps(x, scale);
+        y = _mm_mul_ps(y, scale);
+        z = _mm_mul_ps(z, scale);
+        w = _mm_mul_ps(w, scale);
+
+        Matrix4 ret;
+        _mm_storeu_ps(ret.m[0], _mm_shuffle_ps(x, y, MATH_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(ret.m[1], _mm_shuffle_ps(x, y, MATH_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(ret.m[2], _mm_shuffle_ps(z, w, MATH_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(ret.m[3], _mm_shuffle_ps(z, w, MATH_SHUFFLE(2, 0, 2, 0)));
+        return ret;
+#else
+        return Scalar::Inverted(matrix);
+#endif
+    }
+
+    Matrix4 Simd::AffineInverted(Mat4Param matrix)
+    {
+#if MATH_SIMD_SSE2
+        //the inverse of the 3x3 part has the cross products of its rows as columns
+        __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        __m128 row0 = _mm_and_ps(_mm_loadu_ps(matrix.m[0]), xyzMask);
+        __m128 row1 = _mm_and_ps(_mm_loadu_ps(matrix.m[1]), xyzMask);
+        __m128 row2 = _mm_and_ps(_mm_loadu_ps(matrix.m[2]), xyzMask);
+        __m128 column0 = SimdCross(row1, row2);
+        __m128 column1 = SimdCross(row2, row0);
+        __m128 column2 = SimdCross(row0, row1);
+        __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), SimdDot(row0, column0));
+        column0 = _mm_mul_ps(column0, inverseDeterminant);
+        column1 = _mm_mul_ps(column1, inverseDeterminant);
+        column2 = _mm_mul_ps(column2, inverseDeterminant);
+
+        //-R^-1 * t, then a 1 in w for the last row
+        __m128 translation = _mm_mul_ps(column0, _mm_set1_ps(matrix.m03));
+        translation = _mm_add_ps(translation, _mm_mul_ps(column1, _mm_set1_ps(matrix.m13)));
+        translation = _mm_add_ps(translation, _mm_mul_ps(column2, _mm_set1_ps(matrix.m23)));
+        translation = _mm_xor_ps(translation, signs(true, true, true, false));
+#if MATH_SIMD_SSE41
+        __m128 column3 = _mm_blend_ps(translation, _mm_set1_ps(1.0f), 0x8);
+#else
+        __m128 column3 = _mm_or_ps(_mm_and_ps(translation, xyzMask), _mm_andnot_ps(xyzMask, _mm_set1_ps(1.0f)));
+#endif
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+        Matrix4 ret;
+        _mm_storeu_ps(ret.m[0], column0);
+        _mm_storeu_ps(ret.m[1], column1);
+        _mm_storeu_ps(ret.m[2], column2);
+        _mm_storeu_ps(ret.m[3], column3);
+        return ret;
+#else
+        return Scalar::AffineInverted(matrix);
+#endif
+    }
+
+    Matrix4 Simd::TrsInverted(Mat4Param matrix)
+    {
+#if MATH_SIMD_SSE2
+        //the columns are the rotated axes times their scale, so the inverse has them
+        //as rows divided by their squared lengths, one division for all three
+        __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        __m128 row0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 row1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 row2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row0, row0), _mm_mul_ps(row1, row1)), _mm_mul_ps(row2, row2));
+        __m128 inverseScale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), lengthSq), xyzMask);
+
+        //-(R S)^-1 * t is the scaled rows summed with the translation as weights, then a 1 in w
+        __m128 translation = _mm_mul_ps(row0, splat(row0, 3));
+        translation = _mm_add_ps(translation, _mm_mul_ps(row1, splat(row1, 3)));
+        translation = _mm_add_ps(translation, _mm_mul_ps(row2, splat(row2, 3)));
+        __m128 column3 = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), _mm_mul_ps(translation, inverseScale));
+        //masked again after the multiply, a negative translation times 0 would leave -0 in the last row
+        __m128 column0 = _mm_and_ps(_mm_mul_ps(row0, inverseScale), xyzMask);
+        __m128 column1 = _mm_and_ps(_mm_mul_ps(row1, inverseScale), xyzMask);
+        __m128 column2 = _mm_and_ps(_mm_mul_ps(row2, inverseScale), xyzMask);
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+        Matrix4 ret;
+        _mm_storeu_ps(ret.m[0], column0);
+        _mm_storeu_ps(ret.m[1], column1);
+        _mm_storeu_ps(ret.m[2], column2);
+        _mm_storeu_ps(ret.m[3], column3);
+        return ret;
+#else
+        return Scalar::TrsInverted(matrix);
+#endif
+    }
+
+    Vector4 Simd::Transform(Mat4Param matrix, Vec4Param vector)
+    {
+#if MATH_SIMD_SSE2
+        //the columns scaled by the vector, summed in the order of the scalar dot products
+        __m128 column0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 column1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 column2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 column3 = _mm_loadu_ps(matrix.m[3]);
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+        __m128 v = SimdLoad(vector);
+        __m128 sum = _mm_mul_ps(column0, splat(v, 0));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column1, splat(v, 1)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column2, splat(v, 2)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column3, splat(v, 3)));
+        return SimdStoreVector4(sum);
+#else
+        return Scalar::Transform(matrix, vector);
+#endif
+    }
+
+    Vector3 Simd::TransformPoint(Mat4Param matrix, Vec3Param point)
+    {
+#if MATH_SIMD_SSE2
+        __m128 column0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 column1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 column2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 column3 = _mm_loadu_ps(matrix.m[3]);
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+        __m128 sum = _mm_mul_ps(column0, _mm_set1_ps(point.x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column1, _mm_set1_ps(point.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column2, _mm_set1_ps(point.z)));
+        sum = _mm_add_ps(sum, column3);
+        return SimdStoreVector3(sum);
+#else
+        return Scalar::TransformPoint(matrix, point);
+#endif
+    }
+
+    Vector3 Simd::TransformNormal(Mat4Param matrix, Vec3Param normal)
+    {
+#if MATH_SIMD_SSE2
+        __m128 column0 = _mm_loadu_ps(matrix.m[0]);
+        __m128 column1 = _mm_loadu_ps(matrix.m[1]);
+        __m128 column2 = _mm_loadu_ps(matrix.m[2]);
+        __m128 column3 = _mm_loadu_ps(matrix.m[3]);
+        _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+        __m128 sum = _mm_mul_ps(column0, _mm_set1_ps(normal.x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column1, _mm_set1_ps(normal.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column2, _mm_set1_ps(normal.z)));
+        return SimdStoreVector3(sum);
+#else
+        return Scalar::TransformNormal(matrix, normal);
+#endif
+    }
+
+    Vector4 Simd::Normalized(Vec4Param vector)
+    {
+#if MATH_SIMD_SSE2
+        __m128 v = SimdLoad(vector);
+        return SimdStoreVector4(_mm_div_ps(v, _mm_sqrt_ps(SimdDot(v, v))));
+#else
+        return Scalar::Normalized(vector);
+#endif
+    }
+
+    Quaternion Simd::Multiply(QuatParam lhs, QuatParam rhs)
+    {
+#if MATH_SIMD_SSE2
+        //every lhs lane times a signed swizzle of rhs
+        __m128 l = SimdLoad(lhs);
+        __m128 r = SimdLoad(rhs);
+        __m128 sum = _mm_mul_ps(splat(l, 3), r);
+        sum = _mm_add_ps(sum, _mm_mul_ps(splat(l, 0),
+            _mm_xor_ps(_mm_shuffle_ps(r, r, MATH_SHUFFLE(3, 2, 1, 0)), signs(false, true, false, true))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(splat(l, 1),
+            _mm_xor_ps(_mm_shuffle_ps(r, r, MATH_SHUFFLE(2, 3, 0, 1)), signs(false, false, true, true))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(splat(l, 2),
+            _mm_xor_ps(_mm_shuffle_ps(r, r, MATH_SHUFFLE(1, 0, 3, 2)), signs(true, false, false, true))));
+        Quaternion ret;
+        _mm_storeu_ps(&ret.x, sum);
+        return ret;
+#else
+        return Scalar::Multiply(lhs, rhs);
+#endif
+    }
+
+    Vector3 Simd::Rotated(QuatParam quat, Vec3Param vector)
+    {
+#if MATH_SIMD_SSE2
+        __m128 q = SimdLoad(quat);
+        __m128 v = SimdLoad(vector);
+        __m128 t = SimdCross(q, v);
+        t = _mm_add_ps(t, t);
+        __m128 ret = _mm_add_ps(v, _mm_mul_ps(splat(q, 3), t));
+        return SimdStoreVector3(_mm_add_ps(ret, SimdCross(q, t)));
+#else
+        return rotated(quat, vector);
+#endif
+    }
+
+    Quaternion Simd::Slerp(QuatParam start, QuatParam end, float tValue)
+    {
+#if MATH_SIMD_SSE2
+        __m128 s = SimdLoad(start);
+        __m128 e = SimdLoad(end);
+        float startVal, endVal;
+        slerpWeights(_mm_cvtss_f32(SimdDot(s, e)), tValue, startVal, endVal);
+        Quaternion ret;
+        _mm_storeu_ps(&ret.x, _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(startVal)), _mm_mul_ps(e, _mm_set1_ps(endVal))));
+        return ret;
+#else
+        return Scalar::Slerp(start, end, tValue);
+#endif
+    }
+
+    ////////// Scalar ////////////////////////////////////////////////////////////
+
+    Matrix4 Simd::Scalar::Concat(Mat4Param lhs, Mat4Param rhs)
+    {
+        Matrix4 ret;
+
+        ret.ZeroOut();
+
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int i = 0; i < 4; ++i)
+                {
+                    ret.m[r][c] += lhs.m[r][i] * rhs.m[i][c];
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    Matrix4 Simd::Scalar::Transposed(Mat4Param matrix)
+    {
+        Matrix4 ret = matrix;
+        Math::Swap(ret.m01, ret.m10);
+        Math::Swap(ret.m02, ret.m20);
+        Math::Swap(ret.m03, ret.m30);
+        Math::Swap(ret.m12, ret.m21);
+        Math::Swap(ret.m13, ret.m31);
+        Math::Swap(ret.m23, ret.m32);
+        return ret;
+    }
+
+    Matrix4 Simd::Scalar::Inverted(Mat4Param matrix)
+    {
+        Matrix4 inverted;
+        float determinant = matrix.Determinant();
+        //ErrorIf(Math::IsZero(determinant), "Matrix4 - Uninvertible matrix.");
+        determinant = 1.0f / determinant;
+        inverted.m00 = matrix.m12 * matrix.m23 * matrix.m31 - matrix.m13 * matrix.m22 * matrix.m31;
+        inverted.m00 += matrix.m13 * matrix.m21 * matrix.m32 - matrix.m11 * matrix.m23 * matrix.m32;
+        inverted.m00 += matrix.m11 * matrix.m22 * matrix.m33 - matrix.m12 * matrix.m21 * matrix.m33;
+        inverted.m00 *= determinant;
+
+        inverted.m01 = matrix.m03 * matrix.m22 * matrix.m31 - matrix.m02 * matrix.m23 * matrix.m31;
+        inverted.m01 += matrix.m01 * matrix.m23 * matrix.m32 - matrix.m03 * matrix.m21 * matrix.m32;
+        inverted.m01 += matrix.m02 * matrix.m21 * matrix.m33 - matrix.m01 * matrix.m22 * matrix.m33;
+        inverted.m01 *= determinant;
+
+        inverted.m02 = matrix.m02 * matrix.m13 * matrix.m31 - matrix.m03 * matrix.m12 * matrix.m31;
+        inverted.m02 += matrix.m03 * matrix.m11 * matrix.m32 - matrix.m01 * matrix.m13 * matrix.m32;
+        inverted.m02 += matrix.m01 * matrix.m12 * matrix.m33 - matrix.m02 * matrix.m11 * matrix.m33;
+        inverted.m02 *= determinant;
+
+        inverted.m03 = matrix.m03 * matrix.m12 * matrix.m21 - matrix.m02 * matrix.m13 * matrix.m21;
+        inverted.m03 += matrix.m01 * matrix.m13 * matrix.m22 - matrix.m03 * matrix.m11 * matrix.m22;
+        inverted.m03 += matrix.m02 * matrix.m11 * matrix.m23 - matrix.m01 * matrix.m12 * matrix.m23;
+        inverted.m03 *= determinant;
+
+        inverted.m10 = matrix.m13 * matrix.m22 * matrix.m30 - matrix.m12 * matrix.m23 * matrix.m30;
+        inverted.m10 += matrix.m10 * matrix.m23 * matrix.m32 - matrix.m13 * matrix.m20 * matrix.m32;
+        inverted.m10 += matrix.m12 * matrix.m20 * matrix.m33 - matrix.m10 * matrix.m22 * matrix.m33;
+        inverted.m10 *= determinant;
+
+        inverted.m11 = matrix.m02 * matrix.m23 * matrix.m30 - matrix.m03 * matrix.m22 * matrix.m30;
+        inverted.m11 += matrix.m03 * matrix.m20 * matrix.m32 - matrix.m00 * matrix.m23 * matrix.m32;
+        inverted.m11 += matrix.m00 * matrix.m22 * matrix.m33 - matrix.m02 * matrix.m20 * matrix.m33;
+        inverted.m11 *= determinant;
+
+        inverted.m12 = matrix.m03 * matrix.m12 * matrix.m30 - matrix.m02 * matrix.m13 * matrix.m30;
+        inverted.m12 += matrix.m00 * matrix.m13 * matrix.m32 - matrix.m03 * matrix.m10 * matrix.m32;
+        inverted.m12 += matrix.m02 * matrix.m10 * matrix.m33 - matrix.m00 * matrix.m12 * matrix.m33;
+        inverted.m12 *= determinant;
+
+        inverted.m13 = matrix.m02 * matrix.m13 * matrix.m20 - matrix.m03 * matrix.m12 * matrix.m20;
+        inverted.m13 += matrix.m03 * matrix.m10 * matrix.m22 - matrix.m00 * matrix.m13 * matrix.m22;
+        inverted.m13 += matrix.m00 * matrix.m12 * matrix.m23 - matrix.m02 * matrix.m10 * matrix.m23;
+        inverted.m13 *= determinant;
+
+        inverted.m20 = matrix.m11 * matrix.m23 * matrix.m30 - matrix.m13 * matrix.m21 * matrix.m30;
+        inverted.m20 += matrix.m13 * matrix.m20 * matrix.m31 - matrix.m10 * matrix.m23 * matrix.m31;
+        inverted.m20 += matrix.m10 * matrix.m21 * matrix.m33 - matrix.m11 * matrix.m20 * matrix.m33;
+        inverted.m20 *= determinant;
+
+        inverted.m21 = matrix.m03 * matrix.m21 * matrix.m30 - matrix.m01 * matrix.m23 * matrix.m30;
+        inverted.m21 += matrix.m00 * matrix.m23 * matrix.m31 - matrix.m03 * matrix.m20 * matrix.m31;
+        inverted.m21 += matrix.m01 * matrix.m20 * matrix.m33 - matrix.m00 * matrix.m21 * matrix.m33;
+        inverted.m21 *= determinant;
+
+        inverted.m22 = matrix.m01 * matrix.m13 * matrix.m30 - matrix.m03 * matrix.m11 * matrix.m30;
+        inverted.m22 += matrix.m03 * matrix.m10 * matrix.m31 - matrix.m00 * matrix.m13 * matrix.m31;
+        inverted.m22 += matrix.m00 * matrix.m11 * matrix.m33 - matrix.m01 * matrix.m10 * matrix.m33;
+        inverted.m22 *= determinant;
+
+        inverted.m23 = matrix.m03 * matrix.m11 * matrix.m20 - matrix.m01 * matrix.m13 * matrix.m20;
+        inverted.m23 += matrix.m00 * matrix.m13 * matrix.m21 - matrix.m03 * matrix.m10 * matrix.m21;
+        inverted.m23 += matrix.m01 * matrix.m10 * matrix.m23 - matrix.m00 * matrix.m11 * matrix.m23;
+        inverted.m23 *= determinant;
+
+        inverted.m30 = matrix.m12 * matrix.m21 * matrix.m30 - matrix.m11 * matrix.m22 * matrix.m30;
+        inverted.m30 += matrix.m10 * matrix.m22 * matrix.m31 - matrix.m12 * matrix.m20 * matrix.m31;
+        inverted.m30 += matrix.m11 * matrix.m20 * matrix.m32 - matrix.m10 * matrix.m21 * matrix.m32;
+        inverted.m30 *= determinant;
+
+        inverted.m31 = matrix.m01 * matrix.m22 * matrix.m30 - matrix.m02 * matrix.m21 * matrix.m30;
+        inverted.m31 += matrix.m02 * matrix.m20 * matrix.m31 - matrix.m00 * matrix.m22 * matrix.m31;
+        inverted.m31 += matrix.m00 * matrix.m21 * matrix.m32 - matrix.m01 * matrix.m20 * matrix.m32;
+        inverted.m31 *= determinant;
+
+        inverted.m32 = matrix.m02 * matrix.m11 * matrix.m30 - matrix.m01 * matrix.m12 * matrix.m30;
+        inverted.m32 += matrix.m00 * matrix.m12 * matrix.m31 - matrix.m02 * matrix.m10 * matrix.m31;
+        inverted.m32 += matrix.m01 * matrix.m10 * matrix.m32 - matrix.m00 * matrix.m11 * matrix.m32;
+        inverted.m32 *= determinant;
+
+        inverted.m33 = matrix.m01 * matrix.m12 * matrix.m20 - matrix.m02 * matrix.m11 * matrix.m20;
+        inverted.m33 += matrix.m02 * matrix.m10 * matrix.m21 - matrix.m00 * matrix.m12 * matrix.m21;
+        inverted.m33 += matrix.m00 * matrix.m11 * matrix.m22 - matrix.m01 * matrix.m10 * matrix.m22;
+        inverted.m33 *= determinant;
+
+        return inverted;
+    }
+
+    Matrix4 Simd::Scalar::AffineInverted(Mat4Param matrix)
+    {
+        Vector3 row0(matrix.m00, matrix.m01, matrix.m02);
+        Vector3 row1(matrix.m10, matrix.m11, matrix.m12);
+        Vector3 row2(matrix.m20, matrix.m21, matrix.m22);
+        Vector3 column0 = Cross(row1, row2);
+        Vector3 column1 = Cross(row2, row0);
+        Vector3 column2 = Cross(row0, row1);
+        float inverseDeterminant = 1.0f / Math::Dot(row0, column0);
+        column0 *= inverseDeterminant;
+        column1 *= inverseDeterminant;
+        column2 *= inverseDeterminant;
+        Vector3 translation = -(column0 * matrix.m03 + column1 * matrix.m13 + column2 * matrix.m23);
+
+        Matrix4 ret;
+        ret.m00 = column0.x; ret.m01 = column1.x; ret.m02 = column2.x; ret.m03 = translation.x;
+        ret.m10 = column0.y; ret.m11 = column1.y; ret.m12 = column2.y; ret.m13 = translation.y;
+        ret.m20 = column0.z; ret.m21 = column1.z; ret.m22 = column2.z; ret.m23 = translation.z;
+        ret.m30 = 0.0f;      ret.m31 = 0.0f;      ret.m32 = 0.0f;      ret.m33 = 1.0f;
+        return ret;
+    }
+
+    Matrix4 Simd::Scalar::TrsInverted(Mat4Param matrix)
+    {
+        Vector3 column0(matrix.m00, matrix.m10, matrix.m20);
+        Vector3 column1(matrix.m01, matrix.m11, matrix.m21);
+        Vector3 column2(matrix.m02, matrix.m12, matrix.m22);
+        Vector3 translation(matrix.m03, matrix.m13, matrix.m23);
+        float inverseScale0 = 1.0f / column0.LengthSq();
+        float inverseScale1 = 1.0f / column1.LengthSq();
+        float inverseScale2 = 1.0f / column2.LengthSq();
+
+        Matrix4 ret;
+        ret.m00 = column0.x * inverseScale0; ret.m01 = column0.y * inverseScale0; ret.m02 = column0.z * inverseScale0;
+        ret.m10 = column1.x * inverseScale1; ret.m11 = column1.y * inverseScale1; ret.m12 = column1.z * inverseScale1;
+        ret.m20 = column2.x * inverseScale2; ret.m21 = column2.y * inverseScale2; ret.m22 = column2.z * inverseScale2;
+        ret.m03 = 0.0f - Math::Dot(column0, translation) * inverseScale0;
+        ret.m13 = 0.0f - Math::Dot(column1, translation) * inverseScale1;
+        ret.m23 = 0.0f - Math::Dot(column2, translation) * inverseScale2;
+        ret.m30 = 0.0f; ret.m31 = 0.0f; ret.m32 = 0.0f; ret.m33 = 1.0f;
+        return ret;
+    }
+
+    Vector4 Simd::Scalar::Transform(Mat4Param matrix, Vec4Param vector)
+    {
+        float x = Math::Dot(matrix.Cross(0), vector);
+        float y = Math::Dot(matrix.Cross(1), vector);
+        float z = Math::Dot(matrix.Cross(2), vector);
+        float w = Math::Dot(matrix.Cross(3), vector);
+        return Vector4(x, y, z, w);
+    }
+
+    Vector3 Simd::Scalar::TransformPoint(Mat4Param matrix, Vec3Param point)
+    {
+        float x = Math::Dot(*(Vector3*)&matrix[0], point) + matrix[0][3];
+        float y = Math::Dot(*(Vector3*)&matrix[1], point) + matrix[1][3];
+        float z = Math::Dot(*(Vector3*)&matrix[2], point) + matrix[2][3];
+        return Vector3(x, y, z);
+    }
+
+    Vector3 Simd::Scalar::TransformNormal(Mat4Param matrix, Vec3Param normal)
+    {
+        float x = Math::Dot(*(Vector3*)&matrix[0], normal);
+        float y = Math::Dot(*(Vector3*)&matrix[1], normal);
+        float z = Math::Dot(*(Vector3*)&matrix[2], normal);
+        return Vector3(x, y, z);
+    }
+
+    Vector4 Simd::Scalar::Normalized(Vec4Param vector)
+    {
+        float length = Sqrt(Math::Dot(vector, vector));
+        return Vector4(vector.x / length, vector.y / length, vector.z / length, vector.w / length);
+    }
+
+    Quaternion Simd::Scalar::Multiply(QuatParam lhs, QuatParam rhs)
+    {
+        return Quaternion(lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,
+                          lhs.w * rhs.y + lhs.y * rhs.w + lhs.z * rhs.x - lhs.x * rhs.z,
+                          lhs.w * rhs.z + lhs.z * rhs.w + lhs.x * rhs.y - lhs.y * rhs.x,
+                          lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z);
+    }
+
+    Vector3 Simd::Scalar::Rotated(QuatParam quat, Vec3Param vector)
+    {
+        Quaternion conjugate(-quat.x, -quat.y, -quat.z, quat.w);
+        Quaternion result = Multiply(quat, Quaternion(vector.x, vector.y, vector.z, 0.0f));
+        result = Multiply(result, conjugate);
+        return Vector3(result.x, result.y, result.z);
+    }
+
+    Quaternion Simd::Scalar::Slerp(QuatParam start, QuatParam end, float tValue)
+    {
+        float cosTheta = (start.x * end.x) + (start.y * end.y) + (start.z * end.z) + (start.w * end.w);
+        float startVal, endVal;
+        slerpWeights(cosTheta, tValue, startVal, endVal);
+        return Quaternion(startVal * start.x + endVal * end.x,
+                          startVal * start.y + endVal * end.y,
+                          startVal * start.z + endVal * end.z,
+                          startVal * start.w + endVal * end.w);
+    }
+
+    ////////// Measure ///////////////////////////////////////////////////////////
+
+    namespace
+    {
+        const unsigned c_Samples = 256;
+        //smallest determinant of a projective sample, relative to that of the affine one it is made from
+        const float c_MinDeterminantRatio = 0.25f;
+
+        //difference in ULPs of the largest element of the reference, 0 when the bits match;
+        //a NaN on one side only is an infinite difference
+        float ulpError(float const* simd, float const* scalar, unsigned count, bool& bitExact)
+        {
+            float largest = 0.0f;
+            for (unsigned i = 0; i < count; ++i)
+                largest = std::max(largest, std::abs(scalar[i]));
+            float ulp = largest > 0.0f ? std::ldexp(std::numeric_limits<float>::epsilon(), std::ilogb(largest))
+                                       : std::numeric_limits<float>::denorm_min();
+            float error = 0.0f;
+            for (unsigned i = 0; i < count; ++i)
+            {
+                bitExact = bitExact && std::memcmp(simd + i, scalar + i, sizeof(float)) == 0;
+                if (std::isnan(simd[i]) != std::isnan(scalar[i]))
+                    return std::numeric_limits<float>::infinity();
+                if (!std::isnan(simd[i]))
+                    error = std::max(error, std::abs(simd[i] - scalar[i]) / ulp);
+            }
+            return error;
+        }
+
+        template <typename Function>
+        float nanosecondsPerCall(unsigned iterations, Function function)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned i = 0; i < iterations; ++i)
+                function(i % c_Samples);
+            std::chrono::duration<float, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+            return elapsed.count() / iterations;
+        }
+
+        //compare simd(i) to scalar(i) on every sample, then time both writing their results out, unless iterations is 0
+        template <typename Result, typename SimdFunction, typename ScalarFunction>
+        Simd::Benchmark measureOperation(char const* operation, float ulpTolerance, unsigned iterations,
+                                         SimdFunction simd, ScalarFunction scalar)
+        {
+            static_assert(sizeof(Result) % sizeof(float) == 0, "Results are compared as floats.");
+            Simd::Benchmark benchmark;
+            benchmark.Operation = operation;
+            benchmark.UlpTolerance = ulpTolerance;
+
+            std::vector<Result> simdResults(c_Samples), scalarResults(c_Samples);
+            for (unsigned i = 0; i < c_Samples; ++i)
+            {
+                simdResults[i] = simd(i);
+                scalarResults[i] = scalar(i);
+                benchmark.MaxUlps = std::max(benchmark.MaxUlps, ulpError(reinterpret_cast<float const*>(&simdResults[i]),
+                    reinterpret_cast<float const*>(&scalarResults[i]), sizeof(Result) / sizeof(float), benchmark.BitExact));
+            }
+            benchmark.Passed = benchmark.MaxUlps <= ulpTolerance;
+            if (iterations == 0)
+                return benchmark;
+
+            benchmark.ScalarNanoseconds = nanosecondsPerCall(iterations, [&](unsigned i) { scalarResults[i] = scalar(i); });
+            benchmark.SimdNanoseconds = nanosecondsPerCall(iterations, [&](unsigned i) { simdResults[i] = simd(i); });
+            return benchmark;
+        }
+
+        //unit quaternions, affine transforms of them, and projective transforms close to those
+        struct Samples
+        {
+            std::vector<Quaternion> Quats = std::vector<Quaternion>(c_Samples);
+            std::vector<Vector3> Points = std::vector<Vector3>(c_Samples);
+            std::vector<Vector4> Vectors = std::vector<Vector4>(c_Samples);
+            std::vector<Matrix4> Affine = std::vector<Matrix4>(c_Samples);
+            std::vector<Matrix4> Projective = std::vector<Matrix4>(c_Samples);
+            std::vector<float> Weights = std::vector<float>(c_Samples);
+        };
+
+        Samples randomSamples(unsigned seed)
+        {
+            std::mt19937 random(seed);
+            std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+            std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+
+            Samples samples;
+            for (unsigned i = 0; i < c_Samples; ++i)
+            {
+                Quaternion quat(unit(random), unit(random), unit(random), unit(random));
+                samples.Quats[i] = quat.Normalized();
+                samples.Points[i] = Vector3(position(random), position(random), position(random));
+                samples.Vectors[i] = Vector4(position(random), position(random), position(random), unit(random));
+                samples.Affine[i] = BuildTransform(samples.Points[i], samples.Quats[i],
+                                                   Vector3(scale(random), scale(random), scale(random)));
+                //the bottom row is drawn again while it takes the matrix near singular, where
+                //two float inverses need not agree
+                samples.Projective[i] = samples.Affine[i];
+                do
+                {
+                    samples.Projective[i].m30 = 0.2f * unit(random);
+                    samples.Projective[i].m31 = 0.2f * unit(random);
+                    samples.Projective[i].m32 = 0.2f * unit(random);
+                    samples.Projective[i].m33 = scale(random);
+                } while (std::abs(samples.Projective[i].Determinant()) < c_MinDeterminantRatio * std::abs(samples.Affine[i].Determinant()));
+                samples.Weights[i] = weight(random);
+            }
+            return samples;
+        }
+
+        //the first samples replaced by the inputs random ones rarely hit: identities, half turns,
+        //large and small scales and vectors, zero, the ends of a slerp, and slerps between equal
+        //and opposite quaternions (samples 1 and 0 with end() below)
+        void addEdgeCases(Samples& samples)
+        {
+            const Quaternion quats[] = { Quaternion::c_Identity, Quaternion::c_Identity, Quaternion::c_Identity,
+                                         Quaternion(1, 0, 0, 0), Quaternion(0, 1, 0, 0), Quaternion(0, 0, 1, 0),
+                                         Quaternion(0, 0, 0, -1), Quaternion(0.5f, 0.5f, 0.5f, 0.5f) };
+            const Vector3 scales[] = { Vector3(1, 1, 1), Vector3(1, 1, 1), Vector3(1000, 1000, 1000),
+                                       Vector3(0.001f, 0.001f, 0.001f), Vector3(1, 1, 1), Vector3(0.01f, 1, 100),
+                                       Vector3(1, 1, 1), Vector3(3, 3, 3) };
+            const Vector3 points[] = { Vector3(0, 0, 0), Vector3(1000, -1000, 1000), Vector3(0, 0, 0),
+                                       Vector3(1e-6f, 0, 0), Vector3(0, 0, 0), Vector3(-5, 0, 5), Vector3(0, 1, 0),
+                                       Vector3(1e4f, 1e4f, 1e4f) };
+            const Vector4 vectors[] = { Vector4(0, 0, 0, 1), Vector4(1, 0, 0, 0), Vector4(1e6f, -1e6f, 1e6f, 0),
+                                        Vector4(1e-6f, 1e-6f, -1e-6f, 1e-6f), Vector4(0, 0, 1e-3f, 0),
+                                        Vector4(-1, -1, -1, -1), Vector4(3, 4, 0, 0), Vector4(0, 0, 0, -2) };
+            const float weights[] = { 0.0f, 1.0f, 0.5f, 0.0f, 1.0f, 0.25f, 0.75f, 0.5f };
+            const unsigned count = sizeof(quats) / sizeof(quats[0]);
+            static_assert(count <= c_Samples, "More edge cases than samples.");
+            for (unsigned i = 0; i < count; ++i)
+            {
+                samples.Quats[i] = quats[i];
+                samples.Points[i] = points[i];
+                samples.Vectors[i] = vectors[i];
+                samples.Affine[i] = BuildTransform(points[i], quats[i], scales[i]);
+                samples.Projective[i] = samples.Affine[i];
+                samples.Weights[i] = weights[i];
+            }
+        }
+
+        std::vector<Simd::Benchmark> measureOperations(Samples const& samples, unsigned iterations)
+        {
+            std::vector<Quaternion> const& quats = samples.Quats;
+            std::vector<Vector3> const& points = samples.Points;
+            std::vector<Vector4> const& vectors = samples.Vectors;
+            std::vector<Matrix4> const& affine = samples.Affine;
+            std::vector<Matrix4> const& projective = samples.Projective;
+            std::vector<float> const& weights = samples.Weights;
+            //every other slerp starts from a neighbour, the rest on the far side of the sphere
+            auto end = [&](unsigned i) { return i % 2 ? quats[(i + 1) % c_Samples] : -quats[(i + 1) % c_Samples]; };
+            auto next = [&](unsigned i) { return (i + 1) % c_Samples; };
+
+            //every tolerance is above the largest difference Compare(16384) finds, four million samples
+            std::vector<Simd::Benchmark> benchmarks;
+            benchmarks.push_back(measureOperation<Matrix4>("Matrix4 concat", 0.0f, iterations,
+                [&](unsigned i) { return Simd::Concat(projective[i], affine[next(i)]); },
+                [&](unsigned i) { return Simd::Scalar::Concat(projective[i], affine[next(i)]); }));
+            benchmarks.push_back(measureOperation<Matrix4>("Matrix4 transpose", 0.0f, iterations,
+                [&](unsigned i) { return Simd::Transposed(projective[i]); },
+                [&](unsigned i) { return Simd::Scalar::Transposed(projective[i]); }));
+            //the two cofactor expansions sum in another order, up to ~45 ULPs apart
+            benchmarks.push_back(measureOperation<Matrix4>("Matrix4 inverse", 64.0f, iterations,
+                [&](unsigned i) { return Simd::Inverted(projective[i]); },
+                [&](unsigned i) { return Simd::Scalar::Inverted(projective[i]); }));
+            benchmarks.push_back(measureOperation<Matrix4>("Matrix4 affine inverse", 16.0f, iterations,
+                [&](unsigned i) { return Simd::AffineInverted(affine[i]); },
+                [&](unsigned i) { return Simd::Scalar::Inverted(affine[i]); }));
+            //orthogonal to float precision only, hence the tolerance against the exact general inverse
+            benchmarks.push_back(measureOperation<Matrix4>("Matrix4 TRS inverse", 64.0f, iterations,
+                [&](unsigned i) { return Simd::TrsInverted(affine[i]); },
+                [&](unsigned i) { return Simd::Scalar::Inverted(affine[i]); }));
+            benchmarks.push_back(measureOperation<Vector4>("Matrix4 transform", 0.0f, iterations,
+                [&](unsigned i) { return Simd::Transform(projective[i], vectors[i]); },
+                [&](unsigned i) { return Simd::Scalar::Transform(projective[i], vectors[i]); }));
+            benchmarks.push_back(measureOperation<Vector3>("Matrix4 transform point", 0.0f, iterations,
+                [&](unsigned i) { return Simd::TransformPoint(affine[i], points[next(i)]); },
+                [&](unsigned i) { return Simd::Scalar::TransformPoint(affine[i], points[next(i)]); }));
+            benchmarks.push_back(measureOperation<Vector3>("Matrix4 transform normal", 0.0f, iterations,
+                [&](unsigned i) { return Simd::TransformNormal(affine[i], points[next(i)]); },
+                [&](unsigned i) { return Simd::Scalar::TransformNormal(affine[i], points[next(i)]); }));
+            benchmarks.push_back(measureOperation<Vector4>("Vector4 normalize", 4.0f, iterations,
+                [&](unsigned i) { return Simd::Normalized(vectors[i]); },
+                [&](unsigned i) { return Simd::Scalar::Normalized(vectors[i]); }));
+            benchmarks.push_back(measureOperation<Quaternion>("Quaternion multiply", 4.0f, iterations,
+                [&](unsigned i) { return Simd::Multiply(quats[i], quats[next(i)]); },
+                [&](unsigned i) { return Simd::Scalar::Multiply(quats[i], quats[next(i)]); }));
+            benchmarks.push_back(measureOperation<Vector3>("Quaternion rotate vector", 16.0f, iterations,
+                [&](unsigned i) { return Simd::Rotated(quats[i], points[i]); },
+                [&](unsigned i) { return Simd::Scalar::Rotated(quats[i], points[i]); }));
+            benchmarks.push_back(measureOperation<Quaternion>("Quaternion slerp", 8.0f, iterations,
+                [&](unsigned i) { return Simd::Slerp(quats[i], end(i), weights[i]); },
+                [&](unsigned i) { return Simd::Scalar::Slerp(quats[i], end(i), weights[i]); }));
+            return benchmarks;
+        }
+    }
+
+    std::vector<Simd::Benchmark> Simd::Measure(unsigned iterations, unsigned seed)
+    {
+        return measureOperations(randomSamples(seed), iterations);
+    }
+
+    std::vector<Simd::Benchmark> Simd::Compare(unsigned seeds, unsigned firstSeed)
+    {
+        std::vector<Benchmark> results;
+        for (unsigned seed = firstSeed; seed < firstSeed + seeds; ++seed)
+        {
+            Samples samples = randomSamples(seed);
+            if (seed == firstSeed)
+                addEdgeCases(samples);
+            std::vector<Benchmark> compared = measureOperations(samples, 0);
+            if (results.empty())
+            {
+                results = compared;
+                continue;
+            }
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                results[i].MaxUlps = std::max(results[i].MaxUlps, compared[i].MaxUlps);
+                results[i].BitExact = results[i].BitExact && compared[i].BitExact;
+                results[i].Passed = results[i].Passed && compared[i].Passed;
+            }
+        }
+        return results;
+    }
+}
@@ -10,6 +10,7 @@
 #include "Precompiled.h"
 #include "math/Matrix4.h"
 #include "math/MathFunctions.h"
+#include "math/MathSimd.h"
 #include "framework/Debug.h"
 
 namespace Math
@@ -170,136 +171,31 @@ namespace Math
         return !(*this == rhs);
     }
 
-    float Matrix4::operator()(unsigned r, unsigned c) const
+    Matrix4 Matrix4::Transposed() const
     {
-        //ErrorIf(r > 3, "Matrix4 - Index out of range.");
-        //ErrorIf(c > 3, "Matrix4 - Index out of range.");
-
-#ifdef ColumnBasis
-        return array[c + r * 4];
-#else
-    return array[r + c * 4];
-#endif
+        return Simd::Transposed(*this);
     }
 
-    float& Matrix4::operator()(unsigned r, unsigned c)
+    Mat4Ref Matrix4::Transpose()
     {
-        //ErrorIf(r > 3, "Matrix4 - Index out of range.");
-        //ErrorIf(c > 3, "Matrix4 - Index out of range.");
-
-#ifdef ColumnBasis
-        return array[c + r * 4];
-#else
-    return array[r + c * 4];
-#endif
+        *this = Simd::Transposed(*this);
+        return *this;
     }
 
-
-    Matrix4 Matrix4::Transposed() const
+    Matrix4 Matrix4::Inverted() const
     {
-        Matrix4 ret = *this;
-        ret.Transpose();
-        return ret;
+        //ErrorIf(Math::IsZero(Determinant()), "Matrix4 - Uninvertible matrix.");
+        return Simd::Inverted(*this);
     }
 
-    Mat4Ref Matrix4::Transpose()
+    Matrix4 Matrix4::AffineInverted() const
     {
-        Math::Swap(m01, m10);
-        Math::Swap(m02, m20);
-        Math::Swap(m03, m30);
-        Math::Swap(m12, m21);
-        Math::Swap(m13, m31);
-        Math::Swap(m23, m32);
-        return *this;
+        return Simd::AffineInverted(*this);
     }
 
-    Matrix4 Matrix4::Inverted() const
+    Matrix4 Matrix4::TrsInverted() const
     {
-        Matrix4 inverted;
-        float determinant = Determinant();
-        //ErrorIf(Math::IsZero(determinant), "Matrix4 - Uninvertible matrix.");
-        determinant = 1.0f / determinant;
-        inverted.m00 = m12 * m23 * m31 - m13 * m22 * m31;
-        inverted.m00 += m13 * m21 * m32 - m11 * m23 * m32;
-        inverted.m00 += m11 * m22 * m33 - m12 * m21 * m33;
-        inverted.m00 *= determinant;
-
-        inverted.m01 = m03 * m22 * m31 - m02 * m23 * m31;
-        inverted.m01 += m01 * m23 * m32 - m03 * m21 * m32;
-        inverted.m01 += m02 * m21 * m33 - m01 * m22 * m33;
-        inverted.m01 *= determinant;
-
-        inverted.m02 = m02 * m13 * m31 - m03 * m12 * m31;
-        inverted.m02 += m03 * m11 * m32 - m01 * m13 * m32;
-        inverted.m02 += m01 * m12 * m33 - m02 * m11 * m33;
-        inverted.m02 *= determinant;
-
-        inverted.m03 = m03 * m12 * m21 - m02 * m13 * m21;
-        inverted.m03 += m01 * m13 * m22 - m03 * m11 * m22;
-        inverted.m03 += m02 * m11 * m23 - m01 * m12 * m23;
-        inverted.m03 *= determinant;
-
-        inverted.m10 = m13 * m22 * m30 - m12 * m23 * m30;
-        inverted.m10 += m10 * m23 * m32 - m13 * m20 * m32;
-        inverted.m10 += m12 * m20 * m33 - m10 * m22 * m33;
-        inverted.m10 *= determinant;
-
-        inverted.m11 = m02 * m23 * m30 - m03 * m22 * m30;
-        inverted.m11 += m03 * m20 * m32 - m00 * m23 * m32;
-        inverted.m11 += m00 * m22 * m33 - m02 * m20 * m33;
-        inverted.m11 *= determinant;
-
-        inverted.m12 = m03 * m12 * m30 - m02 * m13 * m30;
-        inverted.m12 += m00 * m13 * m32 - m03 * m10 * m32;
-        inverted.m12 += m02 * m10 * m33 - m00 * m12 * m33;
-        inverted.m12 *= determinant;
-
-        inverted.m13 = m02 * m13 * m20 - m03 * m12 * m20;
-        inverted.m13 += m03 * m10 * m22 - m00 * m13 * m22;
-        inverted.m13 += m00 * m12 * m23 - m02 * m10 * m23;
-        inverted.m13 *= determinant;
-
-        inverted.m20 = m11 * m23 * m30 - m13 * m21 * m30;
-        inverted.m20 += m13 * m20 * m31 - m10 * m23 * m31;
-        inverted.m20 += m10 * m21 * m33 - m11 * m20 * m33;
-        inverted.m20 *= determinant;
-
-        inverted.m21 = m03 * m21 * m30 - m01 * m23 * m30;
-        inverted.m21 += m00 * m23 * m31 - m03 * m20 * m31;
-        inverted.m21 += m01 * m20 * m33 - m00 * m21 * m33;
-        inverted.m21 *= determinant;
-
-        inverted.m22 = m01 * m13 * m30 - m03 * m11 * m30;
-        inverted.m22 += m03 * m10 * m31 - m00 * m13 * m31;
-        inverted.m22 += m00 * m11 * m33 - m01 * m10 * m33;
-        inverted.m22 *= determinant;
-
-        inverted.m23 = m03 * m11 * m20 - m01 * m13 * m20;
-        inverted.m23 += m00 * m13 * m21 - m03 * m10 * m21;
-        inverted.m23 += m01 * m10 * m23 - m00 * m11 * m23;
-        inverted.m23 *= determinant;
-
-        inverted.m30 = m12 * m21 * m30 - m11 * m22 * m30;
-        inverted.m30 += m10 * m22 * m31 - m12 * m20 * m31;
-        inverted.m30 += m11 * m20 * m32 - m10 * m21 * m32;
-        inverted.m30 *= determinant;
-
-        inverted.m31 = m01 * m22 * m30 - m02 * m21 * m30;
-        inverted.m31 += m02 * m20 * m31 - m00 * m22 * m31;
-        inverted.m31 += m00 * m21 * m32 - m01 * m20 * m32;
-        inverted.m31 *= determinant;
-
-        inverted.m32 = m02 * m11 * m30 - m01 * m12 * m30;
-        inverted.m32 += m00 * m12 * m31 - m02 * m10 * m31;
-        inverted.m32 += m01 * m10 * m32 - m00 * m11 * m32;
-        inverted.m32 *= determinant;
-
-        inverted.m33 = m01 * m12 * m20 - m02 * m11 * m20;
-        inverted.m33 += m02 * m10 * m21 - m00 * m12 * m21;
-        inverted.m33 += m00 * m11 * m22 - m01 * m10 * m22;
-        inverted.m33 *= determinant;
-
-        return inverted;
+        return Simd::TrsInverted(*this);
     }
 
     Mat4Ref Matrix4::Invert()
@@ -310,22 +206,7 @@ namespace Math
 
     Matrix4 Matrix4::Concat(Mat4Param rhs) const
     {
-        Matrix4 ret;
-
-        ret.ZeroOut();
-
-        for (int r = 0; r < 4; ++r)
-        {
-            for (int c = 0; c < 4; ++c)
-            {
-                for (int i = 0; i < 4; ++i)
-                {
-                    ret.m[r][c] += m[r][i] * rhs.m[i][c];
-                }
-            }
-        }
-
-        return ret;
+        return Simd::Concat(*this, rhs);
     }
 
     Mat4Ref Matrix4::SetIdentity()
@@ -685,19 +566,6 @@ namespace Math
 #endif
     }
 
-    Matrix4::CrossVector Matrix4::Cross(unsigned index) const
-    {
-        const Matrix4& self = *this;
-
-        //ErrorIf(index > 3, "Matrix4 - Index out of range.");
-#ifdef ColumnBasis
-        return self[index];
-#else
-    return Vector4(array[index],     array[4 + index], 
-      array[8 + index], array[12 + index]);
-#endif
-    }
-
     void Matrix4::SetBasis(unsigned index, Vec4Param basisVector)
     {
         SetBasis(index, basisVector.x, basisVector.y, basisVector.z, basisVector.w);
@@ -880,21 +748,13 @@ namespace Math
 
     Vector4 Transform(Mat4Param mat, Vec4Param vector)
     {
-        float x = Dot(mat.Cross(0), vector);
-        float y = Dot(mat.Cross(1), vector);
-        float z = Dot(mat.Cross(2), vector);
-        float w = Dot(mat.Cross(3), vector);
-        return Vector4(x, y, z, w);
+        return Simd::Transform(mat, vector);
     }
 
     void Transform(Mat4Param mat, Vec4Ptr vector)
     {
         //ErrorIf(vector == NULL, "Matrix4 - Null pointer passed for vector.");
-        float x = Dot(mat.Cross(0), *vector);
-        float y = Dot(mat.Cross(1), *vector);
-        float z = Dot(mat.Cross(2), *vector);
-        float w = Dot(mat.Cross(3), *vector);
-        vector->Set(x, y, z, w);
+        *vector = Simd::Transform(mat, *vector);
     }
 
     Matrix4 BuildTransform(Vec3Param translate, QuatParam rotate, Vec3Param scale)
@@ -913,18 +773,12 @@ namespace Math
 
     Vector3 TransformPoint(Mat4Param matrix, Vec3Param point)
     {
-        float x = Dot(*(Vector3*)&matrix[0], point) + matrix[0][3];
-        float y = Dot(*(Vector3*)&matrix[1], point) + matrix[1][3];
-        float z = Dot(*(Vector3*)&matrix[2], point) + matrix[2][3];
-        return Vector3(x, y, z);
+        return Simd::TransformPoint(matrix, point);
     }
 
     Vector3 TransformNormal(Mat4Param matrix, Vec3Param normal)
     {
-        float x = Dot(*(Vector3*)&matrix[0], normal);
-        float y = Dot(*(Vector3*)&matrix[1], normal);
-        float z = Dot(*(Vector3*)&matrix[2], normal);
-        return Vector3(x, y, z);
+        return Simd::TransformNormal(matrix, normal);
     }
 
     Vector3 TransformPointProjected(Mat4Param matrix, Vec3Param point)
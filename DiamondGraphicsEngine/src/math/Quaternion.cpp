@@ -10,6 +10,7 @@
 #include "Precompiled.h"
 #include "math/Quaternion.h"
 #include "math/MathFunctions.h"
+#include "math/MathSimd.h"
 
 namespace Math
 {
@@ -61,11 +62,7 @@ void Quaternion::operator-=(QuatParam rhs)
 
 void Quaternion::operator*=(QuatParam rhs)
 {
-  Quat lhs(*this);
-  x = lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y;
-  y = lhs.w * rhs.y + lhs.y * rhs.w + lhs.z * rhs.x - lhs.x * rhs.z;
-  z = lhs.w * rhs.z + lhs.z * rhs.w + lhs.x * rhs.y - lhs.y * rhs.x;
-  w = lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z;
+  *this = Simd::Multiply(*this, rhs);
 }
 
 void Quaternion::operator*=(float rhs)
@@ -93,10 +90,7 @@ Quaternion Quaternion::operator-() const
 
 Quaternion Quaternion::operator*(QuatParam quat) const
 {
-  return Quat(w * quat.x + x * quat.w + y * quat.z - z * quat.y,
-              w * quat.y + y * quat.w + z * quat.x - x * quat.z,
-              w * quat.z + z * quat.w + x * quat.y - y * quat.x,
-              w * quat.w - x * quat.x - y * quat.y - z * quat.z);
+  return Simd::Multiply(*this, quat);
 }
 
 Quaternion Quaternion::operator+(QuatParam rhs) const
@@ -279,22 +273,13 @@ Quaternion Quaternion::Logarithm() const
 
 void Quaternion::RotateVector(Vec3Ptr vector)
 {
-  Quat tempVec = Math::ToQuaternion(*vector);
-  Quat conjugate(-x, -y, -z, w);
-  Quat result(*this);
-  result *= tempVec;
-  result *= conjugate;
-  vector->Set(result.x, result.y, result.z);
+  *vector = Simd::Rotated(*this, *vector);
 }
 
 Vector3 Quaternion::RotatedVector(Vec3Param vector) const
 {
-  Quat tempVec = Math::ToQuaternion(vector);
-  Quat conjugate(-x, -y, -z, w);
-  Quat result(*this);
-  result *= tempVec;
-  result *= conjugate;
-  return Vector3(result.x, result.y, result.z);
+  //same as q * v * q^-1 for a unit quaternion, without the two full products
+  return Simd::Rotated(*this, vector);
 }
 
 void Quaternion::ZeroOut()
@@ -382,43 +367,7 @@ Quaternion Slerp(QuatParam start, QuatParam end, float tValue)
   // Quaternion Interpolation With Extra Spins, pp. 96f, 461f
   // Jack Morrison, Graphics Gems III, AP Professional
   //
-
-  const float cSlerpEpsilon = 0.00001f;
-
-  bool flip;
-
-  float cosTheta = Dot(start, end); 
-
-  //Check to ensure that the shortest path is taken (cosine of the angle between 
-  //the two quaternions is positive).
-  if((flip = (cosTheta < 0.0f)))
-  {
-    cosTheta = -cosTheta;
-  }
-
-  float startVal, endVal;
-  if((1.0f - cosTheta) > cSlerpEpsilon)
-  {
-    float theta = Math::ArcCos(cosTheta);
-    float sinTheta = Math::Sin(theta);
-    startVal = Math::Sin((1.0f - tValue) * theta) / sinTheta;
-    endVal = Math::Sin(tValue * theta) / sinTheta;
-  }
-  else
-  {
-    startVal = 1.0f - tValue;
-    endVal = tValue;
-  }
-
-  if(flip)
-  {
-    endVal = -endVal;
-  }
-
-  return Quaternion(startVal * start.x + endVal * end.x,
-                    startVal * start.y + endVal * end.y,
-                    startVal * start.z + endVal * end.z,
-                    startVal * start.w + endVal * end.w);
+  return Simd::Slerp(start, end, tValue);
 }
 
 Quaternion CreateDiagonalizer(Mat3Param matrix)
@@ -21,92 +21,12 @@ namespace Math
 
   namespace
   {
-    const float cTemp = -0.0f;
-    const unsigned cSignBit = *reinterpret_cast<unsigned const*>(&cTemp);
-    const float cNegative = -1.0f;
-    const float cPositive = 1.0f;
-
     float gZeroForInf = 0.0f;
     float gInfinite = 1.0f / gZeroForInf;
   }
 
   const float& c_Infinite = gInfinite;
 
-  float Epsilon()
-  {
-    return 0.000001f;
-  }
-
-  float PositiveMax()
-  {
-    return FLT_MAX;
-  }
-
-  float PositiveMin()
-  {
-    return FLT_MIN;
-  }
-
-  bool Equal(float lhs, float rhs)
-  {
-    return Abs(lhs - rhs) <= Epsilon() * (Abs(lhs) + abs(rhs) + 1.0f);
-  }
-
-  bool NotEqual(float lhs, float rhs)
-  {
-    return !Equal(lhs, rhs);
-  }
-
-  bool IsZero(float val)
-  {
-    return Abs(val) <= Epsilon();
-  }
-
-  bool IsNegative(float number)
-  {
-    return GetSign(number) == cNegative;
-  }
-
-  bool IsPositive(float number)
-  {
-    return GetSign(number) == cPositive;
-  }
-
-  bool LessThan(float lhs, float rhs)
-  {
-    return lhs < rhs;
-  }
-
-  bool LessThanOrEqual(float lhs, float rhs)
-  {
-    return lhs <= rhs;
-  }
-
-  bool GreaterThan(float lhs, float rhs)
-  {
-    return lhs > rhs;
-  }
-
-  bool GreaterThanOrEqual(float lhs, float rhs)
-  {
-    return lhs >= rhs;
-  }
-
-  float Sqrt(float val)
-  {
-    return std::sqrt(val);
-  }
-
-  float Rsqrt(float val)
-  {
-    return 1.0f / std::sqrt(val);
-  }
-
-  float Sq(float sqrt)
-  {
-    return sqrt * sqrt;
-  }
-
   float Pow(float base, float exp)
   {
     return std::pow(base, exp);
@@ -117,38 +37,11 @@ namespace Math
     return std::log(val);
   }
 
-  float Abs(float val)
-  {
-    return std::abs(val);
-  }
-
-  int Abs(int val)
-  {
-    return std::abs(val);
-  }
-
   float FMod(float dividend, float divisor)
   {
     return fmod(dividend, divisor);
   }
 
-  float GetSign(float val)
-  {
-    return (*reinterpret_cast<unsigned*>(&val) & cSignBit) != 0 ? cNegative
-      : cPositive;
-    //return lhs >= 0.0f ? 1.0f : -1.0f;
-  }
-
-  float Cos(float val)
-  {
-    return std::cos(val);
-  }
-
-  float Sin(float val)
-  {
-    return std::sin(val);
-  }
-
   float Tan(float angle)
   {
     return std::tan(angle);
@@ -177,16 +70,6 @@ namespace Math
     return std::atan2(y, x);
   }
 
-  float RadToDeg(float radians)
-  {
-    return (180.0f / c_Pi) * radians;
-  }
-
-  float DegToRad(float degrees)
-  {
-    return (c_Pi / 180.0f) * degrees;
-  }
-
   bool IsValid(float val)
   {
 #ifdef _MSC_VER
@@ -196,19 +79,4 @@ namespace Math
 #endif
   }
 
-  float Round(float val)
-  {
-    return std::floor(val + 0.5f);
-  }
-
-  float Ceil(float val)
-  {
-    return std::ceil(val);
-  }
-
-  float Floor(float val)
-  {
-    return std::floor(val);
-  }
-
 }// namespace Math
@@ -18,12 +18,6 @@ const Vector2 Vector2::cXAxis(1.0f, 0.0f);
 const Vector2 Vector2::cYAxis(0.0f, 1.0f);
 
 
-Vector2::Vector2(float x_, float y_)
-{
-  x = x_;
-  y = y_;
-}
-
 Vector2::Vector2(ConstRealPointer data)
 {
   array[0] = data[0];
@@ -48,72 +42,6 @@ float Vector2::operator[](unsigned index) const
 }
 
 
-////////// Unary Operators /////////////////////////////////////////////////////
-
-Vector2 Vector2::operator-() const
-{
-  return Vector2(-x, -y);
-}
-
-
-////////// Binary Assignment Operators (reals) /////////////////////////////////
-
-void Vector2::operator*=(float rhs)
-{
-  x *= rhs;
-  y *= rhs;
-}
-
-void Vector2::operator/=(float rhs)
-{
-  //ErrorIf(Math::IsZero(rhs), "Math::Vector2 - Division by zero.");
-  x /= rhs;
-  y /= rhs;
-}
-
-
-////////// Binary Operators (reals) ////////////////////////////////////////////
-
-Vector2 Vector2::operator*(float rhs) const
-{
-  return Vector2(x * rhs, y * rhs);
-}
-
-Vector2 Vector2::operator/(float rhs) const
-{
-  //ErrorIf(Math::IsZero(rhs), "Math::Vector2 - Division by zero.");
-  return Vector2(x / rhs, y / rhs);
-}
-
-
-////////// Binary Assignment Operators (Vectors) ///////////////////////////////
-
-void Vector2::operator+=(Vec2Param rhs)
-{
-  x += rhs.x;
-  y += rhs.y;
-}
-
-void Vector2::operator-=(Vec2Param rhs)
-{
-  x -= rhs.x;
-  y -= rhs.y;
-}
-
-
-////////// Binary Operators (Vectors) //////////////////////////////////////////
-
-Vector2 Vector2::operator+(Vec2Param rhs) const
-{
-  return Vector2(x + rhs.x, y + rhs.y);
-}
-
-Vector2 Vector2::operator-(Vec2Param rhs) const
-{
-  return Vector2(x - rhs.x, y - rhs.y);
-}
-
-
 ////////// Binary Vector Comparisons ///////////////////////////////////////////
 
 bool Vector2::operator==(Vec2Param rhs) const
@@ -154,18 +82,6 @@ void Vector2::AddScaledVector(Vec2Param vector, float scalar)
   y += vector.y * scalar;
 }
 
-float Vector2::Dot(Vec2Param rhs) const
-{
-  return x * rhs.x + y * rhs.y;
-}
-
-Vector2 Vector2::operator/(Vec2Param rhs) const
-{
-  //ErrorIf(rhs.x == 0.0f || rhs.y == 0.0f, 
-          //"Vector2 - Division by zero.");
-  return Vector2(x / rhs.x, y / rhs.y);
-}
-
 void Vector2::operator*=(Vec2Param rhs)
 {
   x *= rhs.x;
@@ -178,21 +94,6 @@ void Vector2::operator/=(Vec2Param rhs)
   y /= rhs.y;
 }
 
-Vector2 Vector2::operator*(Vec2Param rhs) const
-{
-  return Vector2(x * rhs.x, y * rhs.y);
-}
-
-float Vector2::Length() const
-{
-  return Sqrt(LengthSq());
-}
-
-float Vector2::LengthSq() const
-{
-  return Dot(*this);
-}
-
 Vector2 Vector2::Normalized() const
 {
   Vector2 ret = *this;
@@ -234,36 +135,16 @@ void Vector2::Splat(float value)
   x = y = value;
 }
 
-Vector2 operator*(float lhs, Vec2Param rhs)
-{
-  return rhs * lhs;
-}
-
 float Distance(Vec2Param lhs, Vec2Param rhs)
 {
   return (rhs - lhs).Length();
 }
 
-float Dot(Vec2Param lhs, Vec2Param rhs)
-{
-  return lhs.Dot(rhs);
-}
-
 float Cross(Vec2Param lhs, Vec2Param rhs)
 {
   return lhs.x * rhs.y - rhs.x * lhs.y;
 }
 
-float Length(Vec2Param vect)
-{
-  return vect.Length();
-}
-
-float LengthSq(Vec2Param vect)
-{
-  return vect.LengthSq();
-}
-
 Vector2 Normalized(Vec2Param vect)
 {
   return vect.Normalized();
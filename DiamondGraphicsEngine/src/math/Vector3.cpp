@@ -29,20 +29,6 @@ namespace Math
     return (float const*)this;
   }
 
-  Vector3::Vector3(float xx, float yy, float zz)
-  {
-    x = xx;
-    y = yy;
-    z = zz;
-  }
-
-  Vector3::Vector3(float xyz)
-  {
-    x = xyz;
-    y = xyz;
-    z = xyz;
-  }
-
   Vector3::Vector3(Vec2Param rhs, float zz)
   {
     x = rhs.x;
@@ -70,30 +56,6 @@ namespace Math
   }
 
   //---------------------------------------------------- Binary Vector Comparisons
-  bool Vector3::operator==(Vec3Param rhs) const
-  {
-    return Math::Equal(x, rhs.x) &&
-      Math::Equal(y, rhs.y) &&
-      Math::Equal(z, rhs.z);
-  }
-
-  bool Vector3::operator!=(Vec3Param rhs) const
-  {
-    return !(*this == rhs);
-  }
-
-  void Vector3::Set(float x_, float y_, float z_)
-  {
-    x = x_;
-    y = y_;
-    z = z_;
-  }
-
-  void Vector3::Splat(float xyz)
-  {
-    x = y = z = xyz;
-  }
-
   void Vector3::ScaleByVector(Vec3Param rhs)
   {
     x *= rhs.x;
@@ -101,20 +63,6 @@ namespace Math
     z *= rhs.z;
   }
 
-  void Vector3::ZeroOut()
-  {
-    x = 0.0f;
-    y = 0.0f;
-    z = 0.0f;
-  }
-
-  void Vector3::AddScaledVector(Vec3Param vector, float scalar)
-  {
-    x += vector.x * scalar;
-    y += vector.y * scalar;
-    z += vector.z * scalar;
-  }
-
   Vector3 Vector3::Reflect(Vec3Param rhs) const
   {
     Vector3 reflect = rhs;
@@ -130,30 +78,6 @@ namespace Math
     return axis * dot;
   }
 
-  float Vector3::Length() const
-  {
-    return Sqrt(LengthSq());
-  }
-
-  float Vector3::LengthSq() const
-  {
-    return Dot(*this);
-  }
-
-  Vector3 Vector3::Normalized() const
-  {
-    Vector3 ret = *this;;
-    ret /= Length();
-    return ret;
-  }
-
-  float Vector3::Normalize()
-  {
-    float length = Length();
-    *this /= length;
-    return length;
-  }
-
   void Vector3::Ceil()
   {
     x = Math::Ceil(x);
@@ -189,21 +113,6 @@ namespace Math
     z = Math::Round(z);
   }
 
-  float Vector3::AttemptNormalize()
-  {
-    float lengthSq = LengthSq();
-
-    //Although the squared length may not be zero, the sqrt of a small number
-    //may be truncated to zero, causing a divide by zero crash.  This is why
-    //we check to make sure that it is larger than our epsilon squared.
-    if (lengthSq >= Epsilon() * Epsilon())
-    {
-      lengthSq = Sqrt(lengthSq);
-      *this /= lengthSq;
-    }
-    return lengthSq;
-  }
-
   Vec3Ref Vector3::Negate()
   {
     (*this) *= -1.0f;
@@ -215,15 +124,6 @@ namespace Math
     return IsValid(x) && IsValid(y) && IsValid(z);
   }
 
-  Vector3 Vector3::Cross(Vec3Param v) const
-  {
-    const float _x = y * v.z - z * v.y;
-    const float _y = z * v.x - x * v.z;
-    const float _z = x * v.y - y * v.x;
-
-    return Vector3(_x, _y, _z);
-  }
-
   void Vector3::InvertComponents()
   {
     x = 1.0f / x;
@@ -232,16 +132,6 @@ namespace Math
   }
 
   //------------------------------------------------------------- Global Functions
-  Vector3 operator*(float lhs, Vec3Param rhs)
-  {
-    return rhs * lhs;
-  }
-
-  float Distance(Vec3Param lhs, Vec3Param rhs)
-  {
-    return Length(rhs - lhs);
-  }
-
   Vector3 ScaledByVector(Vec3Param lhs, Vec3Param rhs)
   {
     return lhs * rhs;
@@ -252,21 +142,6 @@ namespace Math
     return lhs / rhs;
   }
 
-  float Length(Vec3Param vect)
-  {
-    return vect.Length();
-  }
-
-  float LengthSq(Vec3Param vect)
-  {
-    return vect.LengthSq();
-  }
-
-  Vector3 Normalized(Vec3Param vect)
-  {
-    return vect.Normalized();
-  }
-
   float Normalize(Vec3Ptr vect)
   {
     ErrorIf(vect == NULL, "Vector3 - Null pointer passed for vector.");
@@ -279,11 +154,6 @@ namespace Math
     return vect->AttemptNormalize();
   }
 
-  Vector3 Cross(Vec3Param lhs, Vec3Param rhs)
-  {
-    return lhs.Cross(rhs);
-  }
-
   Vector3 Cross2d(Vec3Param lhs, Vec3Param rhs)
   {
     Vector3 result = Vector3::cZero;
@@ -308,32 +178,6 @@ namespace Math
     return Vector3(-vec.x, -vec.y, -vec.z);
   }
 
-  Vector3 Abs(Vec3Param vec)
-  {
-    return Vector3(Math::Abs(vec.x), Math::Abs(vec.y), Math::Abs(vec.z));
-  }
-
-  Vector3 Min(Vec3Param lhs, Vec3Param rhs)
-  {
-    return Vector3(Math::Min(lhs.x, rhs.x),
-      Math::Min(lhs.y, rhs.y),
-      Math::Min(lhs.z, rhs.z));
-  }
-
-  Vector3 Max(Vec3Param lhs, Vec3Param rhs)
-  {
-    return Vector3(Math::Max(lhs.x, rhs.x),
-      Math::Max(lhs.y, rhs.y),
-      Math::Max(lhs.z, rhs.z));
-  }
-
-  Vector3 Lerp(Vec3Param start, Vec3Param end, float tValue)
-  {
-    return Vector3(start[0] + tValue * (end[0] - start[0]),
-      start[1] + tValue * (end[1] - start[1]),
-      start[2] + tValue * (end[2] - start[2]));
-  }
-
   void Clamp(Vec3Ptr vec, float min, float max)
   {
     //ErrorIf(vec == NULL, "Vector3 - Null pointer passed for vector.");
@@ -383,111 +227,4 @@ namespace Math
   }
 
 
-  //-------------------------------------------------------------- Unary Operators
-  Vector3 Vector3::operator-() const
-  {
-    return Vector3(-x, -y, -z);
-  }
-
-  //------------------------------------------ Binary Assignment Operators (reals)
-  void Vector3::operator*=(float rhs)
-  {
-    x *= rhs;
-    y *= rhs;
-    z *= rhs;
-  }
-
-  void Vector3::operator/=(float rhs)
-  {
-    //ErrorIf(rhs == 0.0f, "Math::Vector3 - Division by zero.");
-    x /= rhs;
-    y /= rhs;
-    z /= rhs;
-  }
-
-  //----------------------------------------------------- Binary Operators (reals)
-
-  Vector3 Vector3::operator*(float rhs) const
-  {
-    Vector3 ret = *this;
-    ret *= rhs;
-    return ret;
-  }
-
-  Vector3 Vector3::operator/(float rhs) const
-  {
-    //ErrorIf(Math::IsZero(rhs), "Math::Vector3 - Division by zero.");
-    Vector3 ret = *this;
-    ret /= rhs;
-    return ret;
-  }
-
-  //----------------------------------------- Binary Assignment Operator (Vectors)
-
-  void Vector3::operator+=(Vec3Param rhs)
-  {
-    x += rhs.x;
-    y += rhs.y;
-    z += rhs.z;
-  }
-
-  void Vector3::operator-=(Vec3Param rhs)
-  {
-    x -= rhs.x;
-    y -= rhs.y;
-    z -= rhs.z;
-  }
-
-  //--------------------------------------------------- Binary Operators (Vectors)
-  Vector3 Vector3::operator+(Vec3Param rhs) const
-  {
-    Vector3 ret = *this;
-    ret += rhs;
-    return ret;
-  }
-
-  Vector3 Vector3::operator-(Vec3Param rhs) const
-  {
-    Vector3 ret = *this;
-    ret -= rhs;
-    return ret;
-  }
-
-  Vector3 Vector3::operator*(Vec3Param rhs) const
-  {
-    return Vector3(x * rhs.x, y * rhs.y, z * rhs.z);
-  }
-
-  Vector3 Vector3::operator/(Vec3Param rhs) const
-  {
-   // ErrorIf(rhs.x == 0.0f || rhs.y == 0.0f || rhs.z == 0.0f,
-      //"Vector3 - Division by zero.");
-    return Vector3(x / rhs.x, y / rhs.y, z / rhs.z);
-  }
-
-  void Vector3::operator*=(Vec3Param rhs)
-  {
-    x *= rhs.x;
-    y *= rhs.y;
-    z *= rhs.z;
-  }
-
-  void Vector3::operator/=(Vec3Param rhs)
-  {
-    x /= rhs.x;
-    y /= rhs.y;
-    z /= rhs.z;
-  }
-
-  float Vector3::Dot(Vec3Param v) const
-  {
-    return x * v.x + y * v.y + z * v.z;
-  }
-
-  float Dot(Vec3Param lhs, Vec3Param rhs)
-  {
-    return lhs.Dot(rhs);
-  }
-
-
 }// namespace Math
@@ -9,6 +9,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "Precompiled.h"
 #include "math/Vector4.h"
+#include "math/MathSimd.h"
 #define ErrorIf 
 #define Error
 namespace Math
@@ -30,14 +31,6 @@ namespace Math
     return (float const*)this;
   }
 
-  Vector4::Vector4(float x_, float y_, float z_, float w_)
-  {
-    x = x_;
-    y = y_;
-    z = z_;
-    w = w_;
-  }
-
   Vector4::Vector4(ConstRealPointer data)
   {
     array[0] = data[0];
@@ -51,37 +44,8 @@ namespace Math
     x = y = z = w = xyzw;
   }
 
-  float& Vector4::operator[](unsigned index)
-  {
-    ErrorIf(index > 3, "Math::Vector4 - Subscript out of range.");
-    return array[index];
-  }
-
-  float Vector4::operator[](unsigned index) const
-  {
-    ErrorIf(index > 3, "Math::Vector4 - Subscript out of range.");
-    return array[index];
-  }
-
-
-  ////////// Unary Operators /////////////////////////////////////////////////////
-
-  Vector4 Vector4::operator-() const
-  {
-    return Vector4(-x, -y, -z, -w);
-  }
-
-
   ////////// Binary Assignment Operators (reals) /////////////////////////////////
 
-  void Vector4::operator*=(float rhs)
-  {
-    x *= rhs;
-    y *= rhs;
-    z *= rhs;
-    w *= rhs;
-  }
-
   void Vector4::operator/=(float rhs)
   {
     ErrorIf(Math::IsZero(rhs), "Math::Vector4 - Division by zero.");
@@ -94,11 +58,6 @@ namespace Math
 
   ////////// Binary Operators (reals) ////////////////////////////////////////////
 
-  Vector4 Vector4::operator*(float rhs) const
-  {
-    return Vector4(x * rhs, y * rhs, z * rhs, w * rhs);
-  }
-
   Vector4 Vector4::operator/(float rhs) const
   {
     ErrorIf(Math::IsZero(rhs), "Math::Vector4 - Division by zero.");
@@ -108,30 +67,6 @@ namespace Math
 
   ////////// Binary Assignment Operator (Vectors) ////////////////////////////////
 
-  void Vector4::operator+=(Vec4Param rhs)
-  {
-    x += rhs.x;
-    y += rhs.y;
-    z += rhs.z;
-    w += rhs.w;
-  }
-
-  void Vector4::operator-=(Vec4Param rhs)
-  {
-    x -= rhs.x;
-    y -= rhs.y;
-    z -= rhs.z;
-    w -= rhs.w;
-  }
-
-  void Vector4::operator*=(Vec4Param rhs)
-  {
-    x *= rhs.x;
-    y *= rhs.y;
-    z *= rhs.z;
-    w *= rhs.w;
-  }
-
   void Vector4::operator/=(Vec4Param rhs)
   {
     x /= rhs.x;
@@ -140,19 +75,6 @@ namespace Math
     w /= rhs.w;
   }
 
-  ////////// Binary Operators (Vectors) //////////////////////////////////////////
-
-  Vector4 Vector4::operator+(Vec4Param rhs) const
-  {
-    return Vector4(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
-  }
-
-  Vector4 Vector4::operator-(Vec4Param rhs) const
-  {
-    return Vector4(x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w);
-  }
-
-
   ///////// Binary Vector Comparisons ////////////////////////////////////////////
 
   bool Vector4::operator==(Vec4Param rhs) const
@@ -192,11 +114,6 @@ namespace Math
     return *this * rhs;
   }
 
-  Vector4 Vector4::operator*(Vec4Param rhs) const
-  {
-    return Vector4(x * rhs.x, y * rhs.y, z * rhs.z, w * rhs.w);
-  }
-
   Vector4 Vector4::operator/(Vec4Param rhs) const
   {
     ErrorIf(rhs.x == 0.0f || rhs.y == 0.0f ||
@@ -222,26 +139,9 @@ namespace Math
     w += vector.w * scalar;
   }
 
-  float Vector4::Dot(Vec4Param rhs) const
-  {
-    return (x * rhs.x) + (y * rhs.y) + (z * rhs.z) + (w * rhs.w);
-  }
-
-  float Vector4::Length() const
-  {
-    return Sqrt(LengthSq());
-  }
-
-  float Vector4::LengthSq() const
-  {
-    return Dot(*this);
-  }
-
   Vector4 Vector4::Normalized() const
   {
-    Vector4 ret = *this;
-    ret /= Length();
-    return ret;
+    return Simd::Normalized(*this);
   }
 
   float Vector4::Normalize()
@@ -273,16 +173,6 @@ namespace Math
     return IsValid(x) && IsValid(y) && IsValid(z) && IsValid(w);
   }
 
-  Vector4 operator*(float lhs, Vec4Param rhs)
-  {
-    return rhs * lhs;
-  }
-
-  float Dot(Vec4Param lhs, Vec4Param rhs)
-  {
-    return lhs.Dot(rhs);
-  }
-
   float Length(Vec4Param vect)
   {
     return vect.Length();